@@ -49,6 +49,27 @@ typedef struct _GstImx2dCompositorPadClass GstImx2dCompositorPadClass;
 GType gst_imx_2d_compositor_pad_get_type(void);
 
 
+/* The parameters a pad's frame is blitted with. These are
+ * gathered once per output frame. By comparing them with
+ * the ones from the previous output frame, it is possible
+ * to find out if the area covered by the pad's frame changed. */
+typedef struct
+{
+	/* Only used for comparisons. Never dereferenced, since
+	 * the buffer may no longer exist by the next frame. */
+	gconstpointer input_buffer;
+	GstClockTime input_pts;
+	Imx2dRegion inner_region;
+	Imx2dBlitMargin combined_margin;
+	gboolean use_crop_rectangle;
+	Imx2dRegion crop_rectangle;
+	Imx2dRotation rotation;
+	gint alpha;
+	gboolean opaque;
+}
+GstImx2dCompositorPadBlitState;
+
+
 struct _GstImx2dCompositorPad
 {
 	GstVideoAggregatorPad parent;
@@ -66,6 +87,21 @@ struct _GstImx2dCompositorPad
 	 * buffers, so those are filled in later. */
 	Imx2dSurfaceDesc input_surface_desc;
 
+	/* Precomputed blit from input_surface to the compositor's
+	 * output surface. Discarded when the region coordinates
+	 * are recalculated, and when the compositor stops (since
+	 * plans must not outlive the blitter they belong to). */
+	Imx2dBlitPlan *blit_plan;
+
+	/* blit_state is filled in the first pad walk in
+	 * aggregate_frames() and used for the blits in the
+	 * second walk. last_blit_state contains the state
+	 * from the last output frame this pad contributed to,
+	 * and is only valid if last_blit_state_valid is TRUE. */
+	GstImx2dCompositorPadBlitState blit_state;
+	GstImx2dCompositorPadBlitState last_blit_state;
+	gboolean last_blit_state_valid;
+
 	/* Terminology:
 	 *
 	 * inner_region = The region covered by the actual
@@ -137,6 +173,7 @@ struct _GstImx2dCompositorPad
 	gboolean force_aspect_ratio;
 	gboolean input_crop;
 	gdouble alpha;
+	gboolean opaque;
 };
 
 
@@ -161,7 +198,8 @@ enum
 	PROP_PAD_VIDEO_DIRECTION,
 	PROP_PAD_FORCE_ASPECT_RATIO,
 	PROP_PAD_INPUT_CROP,
-	PROP_PAD_ALPHA
+	PROP_PAD_ALPHA,
+	PROP_PAD_OPAQUE
 };
 
 #define DEFAULT_PAD_XPOS 0
@@ -177,6 +215,7 @@ enum
 #define DEFAULT_PAD_FORCE_ASPECT_RATIO TRUE
 #define DEFAULT_PAD_INPUT_CROP TRUE
 #define DEFAULT_PAD_ALPHA 1.0
+#define DEFAULT_PAD_OPAQUE FALSE
 
 
 static void gst_imx_2d_compositor_pad_video_direction_interface_init(G_GNUC_UNUSED GstVideoDirectionInterface *iface)
@@ -201,6 +240,8 @@ static GstPadProbeReturn gst_imx_2d_compositor_downstream_event_probe(GstPad *pa
 
 static void gst_imx_2d_compositor_pad_recalculate_regions_if_needed(GstImx2dCompositorPad *self, GstVideoInfo *output_video_info);
 static GstVideoOrientationMethod gst_imx_2d_compositor_pad_get_current_video_direction(GstImx2dCompositorPad *self);
+static void gst_imx_2d_compositor_pad_update_blit_state(GstImx2dCompositorPad *self, GstBuffer *input_buffer);
+static void gst_imx_2d_compositor_pad_add_blit_state_damage(GstImx2dCompositorPadBlitState const *blit_state, Imx2dSurface *damage_surface);
 
 
 static void gst_imx_2d_compositor_pad_class_init(GstImx2dCompositorPadClass *klass)
@@ -365,6 +406,18 @@ static void gst_imx_2d_compositor_pad_class_init(GstImx2dCompositorPadClass *kla
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_CONTROLLABLE
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_PAD_OPAQUE,
+		g_param_spec_boolean(
+			"opaque",
+			"Opaque",
+			"Whether or not input frames are fully opaque even if their format has an alpha channel; "
+			"if true, these frames are blitted without alpha blending",
+			DEFAULT_PAD_OPAQUE,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
 }
 
 
@@ -383,6 +436,7 @@ static void gst_imx_2d_compositor_pad_init(GstImx2dCompositorPad *self)
 	self->force_aspect_ratio = DEFAULT_PAD_FORCE_ASPECT_RATIO;
 	self->input_crop = DEFAULT_PAD_INPUT_CROP;
 	self->alpha = DEFAULT_PAD_ALPHA;
+	self->opaque = DEFAULT_PAD_OPAQUE;
 
 	self->tag_video_direction = DEFAULT_PAD_VIDEO_DIRECTION;
 
@@ -391,6 +445,12 @@ static void gst_imx_2d_compositor_pad_init(GstImx2dCompositorPad *self)
 	self->input_surface = imx_2d_surface_create(NULL);
 	memset(&(self->input_surface_desc), 0, sizeof(self->input_surface_desc));
 
+	self->blit_plan = NULL;
+
+	memset(&(self->blit_state), 0, sizeof(self->blit_state));
+	memset(&(self->last_blit_state), 0, sizeof(self->last_blit_state));
+	self->last_blit_state_valid = FALSE;
+
 	self->region_coords_need_update = TRUE;
 
 	self->inner_region_fills_output_frame = TRUE;
@@ -407,6 +467,8 @@ static void gst_imx_2d_compositor_pad_finalize(GObject *object)
 {
 	GstImx2dCompositorPad *self = GST_IMX_2D_COMPOSITOR_PAD(object);
 
+	imx_2d_blit_plan_destroy(self->blit_plan);
+
 	if (self->input_surface != NULL)
 		imx_2d_surface_destroy(self->input_surface);
 
@@ -513,6 +575,12 @@ static void gst_imx_2d_compositor_pad_set_property(GObject *object, guint prop_i
 			GST_OBJECT_UNLOCK(self);
 			break;
 
+		case PROP_PAD_OPAQUE:
+			GST_OBJECT_LOCK(self);
+			self->opaque = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -604,6 +672,12 @@ static void gst_imx_2d_compositor_pad_get_property(GObject *object, guint prop_i
 			GST_OBJECT_UNLOCK(self);
 			break;
 
+		case PROP_PAD_OPAQUE:
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->opaque);
+			GST_OBJECT_UNLOCK(self);
+			break;
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -678,6 +752,7 @@ static GstPadProbeReturn gst_imx_2d_compositor_downstream_event_probe(GstPad *pa
 			compositor_pad->input_surface_desc.width = GST_VIDEO_INFO_WIDTH(&video_info);
 			compositor_pad->input_surface_desc.height = GST_VIDEO_INFO_HEIGHT(&video_info);
 			compositor_pad->input_surface_desc.format = gst_imx_2d_convert_from_gst_video_format(GST_VIDEO_INFO_FORMAT(&video_info), &input_video_tile_layout);
+			gst_imx_2d_set_surface_desc_colorimetry(&(compositor_pad->input_surface_desc), &video_info);
 
 			compositor_pad->region_coords_need_update = TRUE;
 
@@ -829,6 +904,10 @@ static void gst_imx_2d_compositor_pad_recalculate_regions_if_needed(GstImx2dComp
 
 	GST_DEBUG_OBJECT(self, "calculated inner region: %" IMX_2D_REGION_FORMAT, IMX_2D_REGION_ARGS(&(self->inner_region)));
 
+	/* The blit plan was computed for the old regions. */
+	imx_2d_blit_plan_destroy(self->blit_plan);
+	self->blit_plan = NULL;
+
 	/* Mark the coordinates as updated so they are not
 	 * needlessly recalculated later. */
 	self->region_coords_need_update = FALSE;
@@ -841,6 +920,77 @@ static GstVideoOrientationMethod gst_imx_2d_compositor_pad_get_current_video_dir
 }
 
 
+static void gst_imx_2d_compositor_pad_update_blit_state(GstImx2dCompositorPad *self, GstBuffer *input_buffer)
+{
+	GstImx2dCompositorPadBlitState *blit_state = &(self->blit_state);
+	gboolean input_crop;
+	gint alpha;
+
+	/* Blit states are compared with memcmp(), so also
+	 * zero the fields that may not be filled below. */
+	memset(blit_state, 0, sizeof(GstImx2dCompositorPadBlitState));
+
+	blit_state->input_buffer = input_buffer;
+	blit_state->input_pts = GST_BUFFER_PTS(input_buffer);
+
+	{
+		/* Lock the pad so we can get copies of its property
+		 * values safely. Otherwise, the pad's set_property()
+		 * function may be called concurrently, leading to
+		 * race conditions. */
+		GST_OBJECT_LOCK(self);
+
+		input_crop = self->input_crop;
+		blit_state->rotation = gst_imx_2d_convert_from_video_orientation_method(gst_imx_2d_compositor_pad_get_current_video_direction(self));
+
+		alpha = (gint)(self->alpha * 255);
+		blit_state->alpha = CLAMP(alpha, 0, 255);
+		blit_state->opaque = self->opaque;
+
+		memcpy(&(blit_state->inner_region), &(self->inner_region), sizeof(Imx2dRegion));
+		memcpy(&(blit_state->combined_margin), &(self->combined_margin), sizeof(Imx2dBlitMargin));
+
+		GST_OBJECT_UNLOCK(self);
+	}
+
+	if (input_crop)
+	{
+		GstVideoCropMeta *crop_meta = gst_buffer_get_video_crop_meta(input_buffer);
+
+		if (crop_meta != NULL)
+		{
+			blit_state->use_crop_rectangle = TRUE;
+			blit_state->crop_rectangle.x1 = crop_meta->x;
+			blit_state->crop_rectangle.y1 = crop_meta->y;
+			blit_state->crop_rectangle.x2 = crop_meta->x + crop_meta->width;
+			blit_state->crop_rectangle.y2 = crop_meta->y + crop_meta->height;
+
+			GST_LOG_OBJECT(
+				self,
+				"using crop rectangle (%d, %d) - (%d, %d)",
+				blit_state->crop_rectangle.x1, blit_state->crop_rectangle.y1,
+				blit_state->crop_rectangle.x2, blit_state->crop_rectangle.y2
+			);
+		}
+	}
+}
+
+
+static void gst_imx_2d_compositor_pad_add_blit_state_damage(GstImx2dCompositorPadBlitState const *blit_state, Imx2dSurface *damage_surface)
+{
+	/* The damaged area is the inner region plus its
+	 * margin, since the blit writes to both of them. */
+	Imx2dRegion region;
+
+	region.x1 = blit_state->inner_region.x1 - blit_state->combined_margin.left_margin;
+	region.y1 = blit_state->inner_region.y1 - blit_state->combined_margin.top_margin;
+	region.x2 = blit_state->inner_region.x2 + blit_state->combined_margin.right_margin;
+	region.y2 = blit_state->inner_region.y2 + blit_state->combined_margin.bottom_margin;
+
+	imx_2d_surface_add_damage_region(damage_surface, &region);
+}
+
+
 
 
 /********** GstImx2dCompositor **********/
@@ -848,10 +998,28 @@ static GstVideoOrientationMethod gst_imx_2d_compositor_pad_get_current_video_dir
 enum
 {
 	PROP_0,
-	PROP_BACKGROUND_COLOR
+	PROP_BACKGROUND_COLOR,
+	PROP_PARTIAL_REDRAW,
+	PROP_STATS,
+	PROP_SHARED_BLITTER
 };
 
 #define DEFAULT_BACKGROUND_COLOR 0x000000
+#define DEFAULT_PARTIAL_REDRAW FALSE
+#define DEFAULT_SHARED_BLITTER FALSE
+
+
+/* Attached as qdata to the first memory block of intermediate
+ * buffers. Used for finding out how many frames ago the
+ * buffer's contents were composed (the "buffer age"). */
+typedef struct
+{
+	GstImx2dCompositor *compositor;
+	guint64 frame_number;
+}
+GstImx2dCompositorFrameTag;
+
+static GQuark gst_imx_2d_compositor_frame_tag_quark;
 
 
 
@@ -873,10 +1041,12 @@ G_DEFINE_ABSTRACT_TYPE_WITH_CODE(
 
 /* General element operations. */
 static void gst_imx_2d_compositor_dispose(GObject *object);
+static void gst_imx_2d_compositor_finalize(GObject *object);
 static void gst_imx_2d_compositor_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
 static void gst_imx_2d_compositor_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
 static GstPad* gst_imx_2d_compositor_request_new_pad(GstElement *element, GstPadTemplate *templ, const gchar *req_name, GstCaps const *caps);
 static void gst_imx_2d_compositor_release_pad(GstElement *element, GstPad *pad);
+static void gst_imx_2d_compositor_set_context(GstElement *element, GstContext *context);
 
 /* Allocator. */
 static gboolean gst_imx_2d_compositor_decide_allocation(GstAggregator *aggregator, GstQuery *query);
@@ -886,6 +1056,7 @@ static gboolean gst_imx_2d_compositor_propose_allocation(GstAggregator *aggregat
 static gboolean gst_imx_2d_compositor_start(GstAggregator *aggregator);
 static gboolean gst_imx_2d_compositor_stop(GstAggregator *aggregator);
 static gboolean gst_imx_2d_compositor_sink_query(GstAggregator *aggregator, GstAggregatorPad *pad, GstQuery *query);
+static gboolean gst_imx_2d_compositor_src_query(GstAggregator *aggregator, GstQuery *query);
 
 /* Caps handling. */
 static gboolean gst_imx_2d_compositor_negotiated_src_caps(GstAggregator *aggregator, GstCaps *caps);
@@ -895,6 +1066,10 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 
 /* Misc GstImx2dCompositor functionality. */
 static gboolean gst_imx_2d_compositor_create_blitter(GstImx2dCompositor *self);
+static Imx2dBlitter* gst_imx_2d_compositor_create_blitter_for_sharing(gpointer user_data);
+static gboolean gst_imx_2d_compositor_handle_context_query(GstImx2dCompositor *self, GstQuery *query);
+static void gst_imx_2d_compositor_set_up_output_damage(GstImx2dCompositor *self, GstBuffer *intermediate_buffer);
+static void gst_imx_2d_compositor_tag_intermediate_buffer(GstImx2dCompositor *self, GstBuffer *intermediate_buffer, gboolean contents_valid);
 
 
 static void gst_imx_2d_compositor_class_init(GstImx2dCompositorClass *klass)
@@ -914,22 +1089,28 @@ static void gst_imx_2d_compositor_class_init(GstImx2dCompositorClass *klass)
 	video_aggregator_class = GST_VIDEO_AGGREGATOR_CLASS(klass);
 
 	object_class->dispose      = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_dispose);
+	object_class->finalize     = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_finalize);
 	object_class->set_property = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_set_property);
 	object_class->get_property = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_get_property);
 
 	element_class->request_new_pad = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_request_new_pad);
 	element_class->release_pad     = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_release_pad);
+	element_class->set_context     = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_set_context);
 
 	aggregator_class->decide_allocation   = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_decide_allocation);
 	aggregator_class->propose_allocation  = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_propose_allocation);
 	aggregator_class->start               = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_start);
 	aggregator_class->stop                = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_stop);
 	aggregator_class->sink_query          = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_sink_query);
+	aggregator_class->src_query           = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_src_query);
 	aggregator_class->negotiated_src_caps = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_negotiated_src_caps);
 
 	video_aggregator_class->aggregate_frames = GST_DEBUG_FUNCPTR(gst_imx_2d_compositor_aggregate_frames);
 
 	klass->create_blitter = NULL;
+	klass->shared_blitter_backend_name = NULL;
+
+	gst_imx_2d_compositor_frame_tag_quark = g_quark_from_static_string("gst-imx-2d-compositor-frame-tag");
 
 	g_object_class_install_property(
 		object_class,
@@ -944,12 +1125,46 @@ static void gst_imx_2d_compositor_class_init(GstImx2dCompositorClass *klass)
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_PARTIAL_REDRAW,
+		g_param_spec_boolean(
+			"partial-redraw",
+			"Partial redraw",
+			"Only redraw the parts of output frames that changed since the output buffer was last composed; "
+			"must not be enabled if downstream modifies output frames in place (like textoverlay does)",
+			DEFAULT_PARTIAL_REDRAW,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_STATS,
+		gst_imx_2d_stats_param_spec_new()
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_SHARED_BLITTER,
+		gst_imx_2d_shared_blitter_param_spec_new()
+	);
 }
 
 
 static void gst_imx_2d_compositor_init(GstImx2dCompositor *self)
 {
+	self->blitter = NULL;
+	self->shared_blitter = NULL;
+	self->owns_blitter = FALSE;
+
 	self->background_color = DEFAULT_BACKGROUND_COLOR;
+	self->partial_redraw = DEFAULT_PARTIAL_REDRAW;
+	self->use_shared_blitter = DEFAULT_SHARED_BLITTER;
+
+	memset(self->damage_history, 0, sizeof(self->damage_history));
+	self->frame_number = 0;
+	self->full_redraw_needed = TRUE;
+
+	gst_imx_2d_stats_tracker_init(&(self->stats_tracker), GST_OBJECT(self));
 
 	/* NOTE: This is created here instead of in start() because new
 	 * compositor pads may appear before start() runs. When a new pad
@@ -1015,6 +1230,16 @@ static void gst_imx_2d_compositor_dispose(GObject *object)
 }
 
 
+static void gst_imx_2d_compositor_finalize(GObject *object)
+{
+	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(object);
+
+	gst_imx_2d_stats_tracker_cleanup(&(self->stats_tracker));
+
+	G_OBJECT_CLASS(gst_imx_2d_compositor_parent_class)->finalize(object);
+}
+
+
 static void gst_imx_2d_compositor_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
 {
 	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(object);
@@ -1025,6 +1250,23 @@ static void gst_imx_2d_compositor_set_property(GObject *object, guint prop_id, G
 		{
 			GST_OBJECT_LOCK(self);
 			self->background_color = g_value_get_uint(value);
+			self->full_redraw_needed = TRUE;
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_PARTIAL_REDRAW:
+		{
+			GST_OBJECT_LOCK(self);
+			self->partial_redraw = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_SHARED_BLITTER:
+		{
+			GST_OBJECT_LOCK(self);
+			self->use_shared_blitter = g_value_get_boolean(value);
 			GST_OBJECT_UNLOCK(self);
 			break;
 		}
@@ -1050,6 +1292,26 @@ static void gst_imx_2d_compositor_get_property(GObject *object, guint prop_id, G
 			break;
 		}
 
+		case PROP_PARTIAL_REDRAW:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->partial_redraw);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_SHARED_BLITTER:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->use_shared_blitter);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_STATS:
+			g_value_take_boxed(value, gst_imx_2d_stats_tracker_create_structure(&(self->stats_tracker)));
+			break;
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -1057,6 +1319,27 @@ static void gst_imx_2d_compositor_get_property(GObject *object, guint prop_id, G
 }
 
 
+static void gst_imx_2d_compositor_set_context(GstElement *element, GstContext *context)
+{
+	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(element);
+	GstImx2dCompositorClass *klass = GST_IMX_2D_COMPOSITOR_CLASS(G_OBJECT_GET_CLASS(self));
+	gboolean accept_shared_blitter;
+
+	/* Only pick up a shared blitter from the context if this element
+	 * is actually configured to use one and has no blitter yet.
+	 * Otherwise, it would lock (and later unref) a blitter that
+	 * is not the one it is actually blitting with. */
+	GST_OBJECT_LOCK(self);
+	accept_shared_blitter = self->use_shared_blitter && (self->blitter == NULL);
+	GST_OBJECT_UNLOCK(self);
+
+	if (accept_shared_blitter)
+		gst_imx_2d_shared_blitter_handle_set_context(element, context, klass->shared_blitter_backend_name, &(self->shared_blitter));
+
+	GST_ELEMENT_CLASS(gst_imx_2d_compositor_parent_class)->set_context(element, context);
+}
+
+
 static GstPad* gst_imx_2d_compositor_request_new_pad(GstElement *element, GstPadTemplate *templ, const gchar *req_name, GstCaps const *caps)
 {
 	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(element);
@@ -1111,6 +1394,12 @@ static void gst_imx_2d_compositor_release_pad(GstElement *element, GstPad *pad)
 	 * not happen automatically. */
 	gst_child_proxy_child_removed(GST_CHILD_PROXY(element), G_OBJECT(pad), GST_OBJECT_NAME(pad));
 
+	/* The area that was covered by the pad's frames
+	 * has to be redrawn without that pad's frames. */
+	GST_OBJECT_LOCK(element);
+	GST_IMX_2D_COMPOSITOR(element)->full_redraw_needed = TRUE;
+	GST_OBJECT_UNLOCK(element);
+
 	GST_ELEMENT_CLASS(gst_imx_2d_compositor_parent_class)->release_pad(element, pad);
 }
 
@@ -1166,6 +1455,7 @@ static gboolean gst_imx_2d_compositor_propose_allocation(GstAggregator *aggregat
 static gboolean gst_imx_2d_compositor_start(GstAggregator *aggregator)
 {
 	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(aggregator);
+	guint i;
 
 	self->video_buffer_pool = NULL;
 
@@ -1183,6 +1473,18 @@ static gboolean gst_imx_2d_compositor_start(GstAggregator *aggregator)
 	/* imx_2d_surface_create() is never supposed to return NULL. */
 	g_assert(self->output_surface != NULL);
 
+	for (i = 0; i < GST_IMX_2D_COMPOSITOR_DAMAGE_HISTORY_LENGTH; ++i)
+	{
+		self->damage_history[i] = imx_2d_surface_create(NULL);
+		g_assert(self->damage_history[i] != NULL);
+	}
+
+	/* Output buffers may contain frames from before the
+	 * element was stopped, so start with a full redraw. */
+	GST_OBJECT_LOCK(self);
+	self->full_redraw_needed = TRUE;
+	GST_OBJECT_UNLOCK(self);
+
 	return TRUE;
 
 error:
@@ -1194,6 +1496,31 @@ error:
 static gboolean gst_imx_2d_compositor_stop(GstAggregator *aggregator)
 {
 	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(aggregator);
+	GstImx2dSharedBlitter *shared_blitter;
+	GList *walk;
+	guint i;
+
+	/* The pads' blit plans refer to the blitter and
+	 * the output surface, so discard them first. */
+	GST_OBJECT_LOCK(self);
+	walk = GST_ELEMENT_CAST(aggregator)->sinkpads;
+	for (; walk != NULL; walk = g_list_next(walk))
+	{
+		GstImx2dCompositorPad *compositor_pad = GST_IMX_2D_COMPOSITOR_PAD_CAST(walk->data);
+		imx_2d_blit_plan_destroy(compositor_pad->blit_plan);
+		compositor_pad->blit_plan = NULL;
+		compositor_pad->last_blit_state_valid = FALSE;
+	}
+	GST_OBJECT_UNLOCK(self);
+
+	for (i = 0; i < GST_IMX_2D_COMPOSITOR_DAMAGE_HISTORY_LENGTH; ++i)
+	{
+		if (self->damage_history[i] != NULL)
+		{
+			imx_2d_surface_destroy(self->damage_history[i]);
+			self->damage_history[i] = NULL;
+		}
+	}
 
 	if (self->output_surface != NULL)
 	{
@@ -1201,11 +1528,20 @@ static gboolean gst_imx_2d_compositor_stop(GstAggregator *aggregator)
 		self->output_surface = NULL;
 	}
 
-	if (self->blitter != NULL)
-	{
+	if (self->owns_blitter && (self->blitter != NULL))
 		imx_2d_blitter_destroy(self->blitter);
-		self->blitter = NULL;
-	}
+	self->blitter = NULL;
+	self->owns_blitter = FALSE;
+
+	/* If the blitter came from the shared blitter, the latter
+	 * destroys it once no one uses it anymore. */
+	GST_OBJECT_LOCK(self);
+	shared_blitter = self->shared_blitter;
+	self->shared_blitter = NULL;
+	GST_OBJECT_UNLOCK(self);
+
+	if (shared_blitter != NULL)
+		gst_object_unref(GST_OBJECT(shared_blitter));
 
 	if (self->video_buffer_pool != NULL)
 	{
@@ -1270,12 +1606,28 @@ static gboolean gst_imx_2d_compositor_sink_query(GstAggregator *aggregator, GstA
 			return TRUE;
 		}
 
+		case GST_QUERY_CONTEXT:
+		{
+			if (gst_imx_2d_compositor_handle_context_query(GST_IMX_2D_COMPOSITOR(aggregator), query))
+				return TRUE;
+			return GST_AGGREGATOR_CLASS(gst_imx_2d_compositor_parent_class)->sink_query(aggregator, pad, query);
+		}
+
 		default:
 			return GST_AGGREGATOR_CLASS(gst_imx_2d_compositor_parent_class)->sink_query(aggregator, pad, query);
 	}
 }
 
 
+static gboolean gst_imx_2d_compositor_src_query(GstAggregator *aggregator, GstQuery *query)
+{
+	if ((GST_QUERY_TYPE(query) == GST_QUERY_CONTEXT) && gst_imx_2d_compositor_handle_context_query(GST_IMX_2D_COMPOSITOR(aggregator), query))
+		return TRUE;
+
+	return GST_AGGREGATOR_CLASS(gst_imx_2d_compositor_parent_class)->src_query(aggregator, query);
+}
+
+
 static gboolean gst_imx_2d_compositor_negotiated_src_caps(GstAggregator *aggregator, GstCaps *caps)
 {
 	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(aggregator);
@@ -1311,6 +1663,7 @@ static gboolean gst_imx_2d_compositor_negotiated_src_caps(GstAggregator *aggrega
 	output_surface_desc.width = GST_VIDEO_INFO_WIDTH(&output_video_info);
 	output_surface_desc.height = GST_VIDEO_INFO_HEIGHT(&output_video_info);
 	output_surface_desc.format = gst_imx_2d_convert_from_gst_video_format(GST_VIDEO_INFO_FORMAT(&output_video_info), NULL);
+	gst_imx_2d_set_surface_desc_colorimetry(&output_surface_desc, &output_video_info);
 
 	for (i = 0; i < GST_VIDEO_INFO_N_PLANES(&output_video_info); ++i)
 		output_surface_desc.plane_strides[i] = GST_VIDEO_INFO_PLANE_STRIDE(&output_video_info, i);
@@ -1319,6 +1672,11 @@ static gboolean gst_imx_2d_compositor_negotiated_src_caps(GstAggregator *aggrega
 
 	imx_2d_surface_set_desc(self->output_surface, &output_surface_desc);
 
+	/* The damage history surfaces need the same size
+	 * as the output surface to clip damage regions. */
+	for (i = 0; i < GST_IMX_2D_COMPOSITOR_DAMAGE_HISTORY_LENGTH; ++i)
+		imx_2d_surface_set_desc(self->damage_history[i], &output_surface_desc);
+
 	self->output_video_info = output_video_info;
 
 	/* Mark all pads to have their region coordinates recalculated
@@ -1335,6 +1693,10 @@ static gboolean gst_imx_2d_compositor_negotiated_src_caps(GstAggregator *aggrega
 		compositor_pad->region_coords_need_update = TRUE;
 	}
 
+	/* Existing output buffers must not be partially
+	 * redrawn, since their size or format may differ. */
+	self->full_redraw_needed = TRUE;
+
 	GST_OBJECT_UNLOCK(self);
 
 	return GST_AGGREGATOR_CLASS(gst_imx_2d_compositor_parent_class)->negotiated_src_caps(aggregator, caps);
@@ -1344,17 +1706,29 @@ static gboolean gst_imx_2d_compositor_negotiated_src_caps(GstAggregator *aggrega
 static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *videoaggregator, GstBuffer *output_buffer)
 {
 	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(videoaggregator);
+	GstImx2dCompositorClass *klass = GST_IMX_2D_COMPOSITOR_CLASS(G_OBJECT_GET_CLASS(self));
 	GstFlowReturn flow_ret = GST_FLOW_OK;
 	GList *walk;
 	Imx2dBlitParams blit_params;
 	gboolean background_needs_to_be_cleared = TRUE;
 	gboolean blitting_started = FALSE;
+	gboolean blitter_locked = FALSE;
 	GstBuffer *intermediate_buffer = NULL;
+	GSList *uploaded_input_buffers = NULL;
+	Imx2dSurface *frame_damage;
 
 	GST_LOG_OBJECT(self, "aggregating frames");
 
 	g_assert(self->blitter != NULL);
 
+	/* Start this frame's damage history entry. This is done before
+	 * anything else, since the entry still contains the damage
+	 * regions of an older frame, and these must not be used for
+	 * this frame, even if aggregating it fails. */
+	self->frame_number++;
+	frame_damage = self->damage_history[self->frame_number % GST_IMX_2D_COMPOSITOR_DAMAGE_HISTORY_LENGTH];
+	imx_2d_surface_clear_damage(frame_damage);
+
 	/* Acquire an intermediate buffer from the internal DMA buffer pool.
 	 * If the internal DMA buffer pool and the output video buffer pool
 	 * are one and the same, this simply ref output_buffer and returns
@@ -1368,6 +1742,9 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 	gst_imx_2d_assign_output_buffer_to_surface(self->output_surface, intermediate_buffer, &(self->output_video_info));
 
 	/* Start the imx2d blit sequence. */
+	gst_imx_2d_shared_blitter_lock(self->shared_blitter, &(self->stats_tracker));
+	blitter_locked = TRUE;
+
 	if (!imx_2d_blitter_start(self->blitter, self->output_surface))
 	{
 		GST_ERROR_OBJECT(self, "starting blitter failed");
@@ -1376,6 +1753,15 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 
 	blitting_started = TRUE;
 
+	/* Record the background clearing and all of the blits in one
+	 * batch. This allows the blitter to set up shared states only
+	 * once, and to combine blits if the backend supports that. */
+	if (!imx_2d_blitter_begin_batch(self->blitter))
+	{
+		GST_ERROR_OBJECT(self, "beginning blitter batch failed");
+		goto error;
+	}
+
 	memset(&blit_params, 0, sizeof(blit_params));
 
 	/* Lock the compositor to prevent pads from being added/removed
@@ -1383,10 +1769,12 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 	GST_OBJECT_LOCK(self);
 
 	/* In this first walk, we look at each compositor sinkpad,
-	 * update their regions if necessary, and determine if at
-	 * least one of them produces frames that are 100% opaque
-	 * and fully cover the screen. If so, we do not need to clear
-	 * the output frame first. */
+	 * update their regions and blit states if necessary, and
+	 * determine if at least one of them produces frames that
+	 * are 100% opaque and fully cover the screen. If so, we do
+	 * not need to clear the output frame first. Also, the parts
+	 * of the output frame that changed since the last frame
+	 * are recorded in frame_damage. */
 	GST_LOG_OBJECT(self, "looking at %" G_GUINT16_FORMAT " sinkpad(s) to see if the background needs to be cleared", GST_ELEMENT_CAST(videoaggregator)->numsinkpads);
 	walk = GST_ELEMENT_CAST(videoaggregator)->sinkpads;
 	for (; walk != NULL; walk = g_list_next(walk))
@@ -1405,9 +1793,34 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 				"pad %s has no input buffer",
 				GST_PAD_NAME(compositor_pad)
 			);
+
+			/* If the pad contributed to the last frame,
+			 * the area it covered needs to be redrawn. */
+			if (compositor_pad->last_blit_state_valid)
+			{
+				gst_imx_2d_compositor_pad_add_blit_state_damage(&(compositor_pad->last_blit_state), frame_damage);
+				compositor_pad->last_blit_state_valid = FALSE;
+			}
+
 			continue;
 		}
 
+		gst_imx_2d_compositor_pad_update_blit_state(compositor_pad, input_buffer);
+
+		/* If anything about the pad's blit changed, then both the
+		 * area it covered previously and the area it covers now
+		 * need to be redrawn. A new input frame is detected by
+		 * the change of the buffer pointer or the timestamp. */
+		if (!compositor_pad->last_blit_state_valid || (memcmp(&(compositor_pad->blit_state), &(compositor_pad->last_blit_state), sizeof(GstImx2dCompositorPadBlitState)) != 0))
+		{
+			if (compositor_pad->last_blit_state_valid)
+				gst_imx_2d_compositor_pad_add_blit_state_damage(&(compositor_pad->last_blit_state), frame_damage);
+			gst_imx_2d_compositor_pad_add_blit_state_damage(&(compositor_pad->blit_state), frame_damage);
+
+			memcpy(&(compositor_pad->last_blit_state), &(compositor_pad->blit_state), sizeof(GstImx2dCompositorPadBlitState));
+			compositor_pad->last_blit_state_valid = TRUE;
+		}
+
 		GST_LOG_OBJECT(
 			self,
 			"pad %s:  inner/total regions fill output frame: %d/%d  alpha: %f  margin color: %#08" G_GINT32_MODIFIER "x",
@@ -1431,7 +1844,7 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 
 		if (background_needs_to_be_cleared)
 		{
-			if (GST_VIDEO_INFO_HAS_ALPHA(&(videoaggregator_pad->info)))
+			if (GST_VIDEO_INFO_HAS_ALPHA(&(videoaggregator_pad->info)) && !(compositor_pad->blit_state.opaque))
 			{
 				GST_LOG_OBJECT(
 					self,
@@ -1492,6 +1905,17 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 		}
 	}
 
+	if (self->full_redraw_needed)
+	{
+		GST_LOG_OBJECT(self, "entire output frame needs to be redrawn");
+		imx_2d_surface_add_damage_region(frame_damage, NULL);
+		self->full_redraw_needed = FALSE;
+	}
+
+	/* Restrict the background clearing and the blits below to
+	 * the parts of the intermediate buffer that are outdated. */
+	gst_imx_2d_compositor_set_up_output_damage(self, intermediate_buffer);
+
 	if (background_needs_to_be_cleared)
 	{
 		GST_LOG_OBJECT(self, "need to clear background with color %#06" G_GINT32_MODIFIER "x", self->background_color & 0xFFFFFF);
@@ -1514,12 +1938,7 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 		GstVideoAggregatorPad *videoaggregator_pad = walk->data;
 		GstImx2dCompositorPad *compositor_pad = GST_IMX_2D_COMPOSITOR_PAD_CAST(videoaggregator_pad);
 		GstBuffer *input_buffer;
-		gboolean input_crop;
-		Imx2dRegion inner_region;
-		Imx2dBlitMargin combined_margin;
-		Imx2dRegion crop_rectangle;
-		GstVideoOrientationMethod video_direction;
-		gint alpha;
+		GstImx2dCompositorPadBlitState *blit_state = &(compositor_pad->blit_state);
 		GstBuffer *uploaded_input_buffer;
 		int blit_ret;
 
@@ -1535,25 +1954,6 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 		if (G_UNLIKELY(input_buffer == NULL))
 			continue;
 
-		{
-			/* Lock the pad so we can get copies of its property
-			 * values safely. Otherwise, the pad's set_property()
-			 * function may be called concurrently, leading to
-			 * race conditions. */
-			GST_OBJECT_LOCK(compositor_pad);
-
-			input_crop = compositor_pad->input_crop;
-			video_direction = gst_imx_2d_compositor_pad_get_current_video_direction(compositor_pad);
-
-			alpha = (gint)(compositor_pad->alpha * 255);
-			alpha = CLAMP(alpha, 0, 255);
-
-			memcpy(&inner_region, &(compositor_pad->inner_region), sizeof(inner_region));
-			memcpy(&combined_margin, &(compositor_pad->combined_margin), sizeof(combined_margin));
-
-			GST_OBJECT_UNLOCK(compositor_pad);
-		}
-
 		/* Upload the input buffer. The uploader creates a deep
 		 * copy if necessary, but tries to avoid that if possible
 		 * by passing through the buffer (if it consists purely
@@ -1572,57 +1972,72 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 			&(videoaggregator_pad->info)
 		);
 
+		/* Frames from pads that are marked as opaque are blitted
+		 * without alpha blending, even if they have an alpha channel. */
+		compositor_pad->input_surface_desc.is_opaque = blit_state->opaque;
+
 		imx_2d_surface_set_desc(compositor_pad->input_surface, &(compositor_pad->input_surface_desc));
 
 
-		/* Fill the blit parameters. */
+		/* Fill the blit parameters. The blit state was
+		 * already filled in the first walk above. */
 
 		GST_LOG_OBJECT(
 			self,
 			"combined margin: %d/%d/%d/%d  margin color: %#08" G_GINT32_MODIFIER "x",
-			combined_margin.left_margin,
-			combined_margin.top_margin,
-			combined_margin.right_margin,
-			combined_margin.bottom_margin,
-			(guint32)(combined_margin.color)
+			blit_state->combined_margin.left_margin,
+			blit_state->combined_margin.top_margin,
+			blit_state->combined_margin.right_margin,
+			blit_state->combined_margin.bottom_margin,
+			(guint32)(blit_state->combined_margin.color)
 		);
 
-		blit_params.margin = &combined_margin;
-		blit_params.source_region = NULL;
-		blit_params.dest_region = &inner_region;
-		blit_params.rotation = gst_imx_2d_convert_from_video_orientation_method(video_direction);
-		blit_params.alpha = alpha;
+		blit_params.margin = &(blit_state->combined_margin);
 
-		if (input_crop)
+		/* If the margin is fully opaque, and the hardware does not
+		 * draw it as part of the blit for free, draw it separately
+		 * with one multi-region fill. Translucent margins are still
+		 * drawn by the blit, since fills are always opaque. */
+		if (!(klass->hardware_capabilities->draws_blit_margins_for_free)
+		 && ((blit_state->combined_margin.color >> 24) == 255)
+		 && (blit_state->alpha == 255))
 		{
-			GstVideoCropMeta *crop_meta = gst_buffer_get_video_crop_meta(input_buffer);
+			Imx2dRegion margin_regions[4];
+			int num_margin_regions;
 
-			if (crop_meta != NULL)
-			{
-				crop_rectangle.x1 = crop_meta->x;
-				crop_rectangle.y1 = crop_meta->y;
-				crop_rectangle.x2 = crop_meta->x + crop_meta->width;
-				crop_rectangle.y2 = crop_meta->y + crop_meta->height;
-
-				blit_params.source_region = &crop_rectangle;
+			num_margin_regions = imx_2d_blit_margin_get_regions(&(blit_state->combined_margin), &(blit_state->inner_region), margin_regions);
 
-				GST_LOG_OBJECT(
-					self,
-					"using crop rectangle (%d, %d) - (%d, %d)",
-					crop_rectangle.x1, crop_rectangle.y1,
-					crop_rectangle.x2, crop_rectangle.y2
-				);
+			if ((num_margin_regions > 0) && !imx_2d_blitter_fill_regions(self->blitter, margin_regions, num_margin_regions, blit_state->combined_margin.color & 0x00FFFFFF))
+			{
+				GST_ERROR_OBJECT(self, "filling margin failed");
+				gst_buffer_unref(uploaded_input_buffer);
+				goto error_while_locked;
 			}
+
+			blit_params.margin = NULL;
 		}
 
+		blit_params.source_region = blit_state->use_crop_rectangle ? &(blit_state->crop_rectangle) : NULL;
+		blit_params.dest_region = &(blit_state->inner_region);
+		blit_params.rotation = blit_state->rotation;
+		blit_params.alpha = blit_state->alpha;
 
-		/* Now perform the actual blit. */
 
-		blit_ret = imx_2d_blitter_do_blit(self->blitter, compositor_pad->input_surface, &blit_params);
+		/* Now record the actual blit. */
 
+		blit_ret = gst_imx_2d_blit_with_plan(
+			self->blitter,
+			&(compositor_pad->blit_plan),
+			compositor_pad->input_surface,
+			self->output_surface,
+			&blit_params
+		);
 
-		/* Discard the uploaded version of the input buffer. */
-		gst_buffer_unref(uploaded_input_buffer);
+
+		/* The uploaded version of the input buffer must be kept
+		 * alive until the blitter is finished, since the batched
+		 * blit is not performed until the batch is submitted. */
+		uploaded_input_buffers = g_slist_prepend(uploaded_input_buffers, uploaded_input_buffer);
 
 
 		if (!blit_ret)
@@ -1634,6 +2049,12 @@ static GstFlowReturn gst_imx_2d_compositor_aggregate_frames(GstVideoAggregator *
 
 	GST_OBJECT_UNLOCK(self);
 
+	if (!imx_2d_blitter_submit_batch(self->blitter))
+	{
+		GST_ERROR_OBJECT(self, "submitting blitter batch failed");
+		goto error;
+	}
+
 
 finish:
 	if (blitting_started && !imx_2d_blitter_finish(self->blitter))
@@ -1642,6 +2063,17 @@ finish:
 		flow_ret = GST_FLOW_ERROR;
 	}
 
+	if (blitter_locked)
+		gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
+
+	/* Discard the uploaded versions of the input buffers. */
+	g_slist_free_full(uploaded_input_buffers, (GDestroyNotify)gst_buffer_unref);
+
+	/* Record when the intermediate buffer's contents were composed
+	 * so that the next partial redraw into it knows what to redraw. */
+	if (intermediate_buffer != NULL)
+		gst_imx_2d_compositor_tag_intermediate_buffer(self, intermediate_buffer, (flow_ret == GST_FLOW_OK));
+
 	if (flow_ret == GST_FLOW_OK)
 	{
 		/* The blitter is done. Transfer the resulting pixels to the output buffer.
@@ -1679,22 +2111,187 @@ error_while_locked:
 static gboolean gst_imx_2d_compositor_create_blitter(GstImx2dCompositor *self)
 {
 	GstImx2dCompositorClass *klass = GST_IMX_2D_COMPOSITOR_CLASS(G_OBJECT_GET_CLASS(self));
+	gboolean use_shared_blitter;
 
 	g_assert(klass->create_blitter != NULL);
 	g_assert(self->blitter == NULL);
 
-	if (G_UNLIKELY((self->blitter = klass->create_blitter(self)) == NULL))
+	GST_OBJECT_LOCK(self);
+	use_shared_blitter = self->use_shared_blitter;
+	GST_OBJECT_UNLOCK(self);
+
+	if (use_shared_blitter && (klass->shared_blitter_backend_name == NULL))
 	{
-		GST_ERROR_OBJECT(self, "could not create blitter");
-		return FALSE;
+		GST_WARNING_OBJECT(self, "shared blitters are not supported by this element; creating own blitter");
+		use_shared_blitter = FALSE;
 	}
 
-	GST_DEBUG_OBJECT(self, "created new blitter %" GST_PTR_FORMAT, (gpointer)(self->blitter));
+	if (use_shared_blitter)
+	{
+		if (!gst_imx_2d_shared_blitter_ensure(GST_ELEMENT(self), klass->shared_blitter_backend_name, &(self->shared_blitter), gst_imx_2d_compositor_create_blitter_for_sharing, self))
+			return FALSE;
+
+		self->blitter = gst_imx_2d_shared_blitter_get_blitter(self->shared_blitter);
+		self->owns_blitter = FALSE;
+		GST_DEBUG_OBJECT(self, "using shared blitter %" GST_PTR_FORMAT, (gpointer)(self->shared_blitter));
+	}
+	else
+	{
+		GstImx2dSharedBlitter *stale_shared_blitter;
+
+		/* Drop any shared blitter that got stored before sharing
+		 * was disabled, so the lock/unlock calls become no-ops. */
+		GST_OBJECT_LOCK(self);
+		stale_shared_blitter = self->shared_blitter;
+		self->shared_blitter = NULL;
+		GST_OBJECT_UNLOCK(self);
+
+		if (stale_shared_blitter != NULL)
+			gst_object_unref(GST_OBJECT(stale_shared_blitter));
+
+		if (G_UNLIKELY((self->blitter = klass->create_blitter(self)) == NULL))
+		{
+			GST_ERROR_OBJECT(self, "could not create blitter");
+			return FALSE;
+		}
+
+		self->owns_blitter = TRUE;
+		GST_DEBUG_OBJECT(self, "created new blitter %" GST_PTR_FORMAT, (gpointer)(self->blitter));
+	}
+
+	/* Other elements may be using a shared blitter right now. */
+	gst_imx_2d_shared_blitter_lock(self->shared_blitter, NULL);
+	gst_imx_2d_stats_tracker_attach(&(self->stats_tracker), self->blitter);
+	gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
 
 	return TRUE;
 }
 
 
+static Imx2dBlitter* gst_imx_2d_compositor_create_blitter_for_sharing(gpointer user_data)
+{
+	GstImx2dCompositor *self = GST_IMX_2D_COMPOSITOR(user_data);
+	GstImx2dCompositorClass *klass = GST_IMX_2D_COMPOSITOR_CLASS(G_OBJECT_GET_CLASS(self));
+	return klass->create_blitter(self);
+}
+
+
+static gboolean gst_imx_2d_compositor_handle_context_query(GstImx2dCompositor *self, GstQuery *query)
+{
+	GstImx2dCompositorClass *klass = GST_IMX_2D_COMPOSITOR_CLASS(G_OBJECT_GET_CLASS(self));
+	GstImx2dSharedBlitter *shared_blitter;
+	gboolean ret;
+
+	GST_OBJECT_LOCK(self);
+	shared_blitter = (self->shared_blitter != NULL) ? gst_object_ref(self->shared_blitter) : NULL;
+	GST_OBJECT_UNLOCK(self);
+
+	ret = gst_imx_2d_shared_blitter_handle_context_query(GST_ELEMENT(self), query, klass->shared_blitter_backend_name, shared_blitter);
+
+	if (shared_blitter != NULL)
+		gst_object_unref(GST_OBJECT(shared_blitter));
+
+	return ret;
+}
+
+
+static void gst_imx_2d_compositor_set_up_output_damage(GstImx2dCompositor *self, GstBuffer *intermediate_buffer)
+{
+	GstImx2dCompositorFrameTag const *frame_tag;
+	guint64 frame_number;
+	Imx2dRegion const *damage_regions;
+	int num_damage_regions;
+	Imx2dRegion const *output_region;
+
+	/* The output surface's damage regions are the union of the
+	 * damage regions of all frames that were composed after the
+	 * intermediate buffer's contents were. If the buffer is new,
+	 * or its contents are too old, it is redrawn entirely. */
+
+	imx_2d_surface_clear_damage(self->output_surface);
+
+	if (!self->partial_redraw)
+		goto full_redraw;
+
+	frame_tag = gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(gst_buffer_peek_memory(intermediate_buffer, 0)), gst_imx_2d_compositor_frame_tag_quark);
+	if ((frame_tag == NULL) || (frame_tag->compositor != self))
+	{
+		GST_LOG_OBJECT(self, "intermediate buffer has no contents from this compositor; redrawing entire frame");
+		goto full_redraw;
+	}
+
+	if ((self->frame_number - frame_tag->frame_number) > GST_IMX_2D_COMPOSITOR_DAMAGE_HISTORY_LENGTH)
+	{
+		GST_LOG_OBJECT(
+			self,
+			"intermediate buffer contents are from frame %" G_GUINT64_FORMAT ", which is too old; redrawing entire frame",
+			frame_tag->frame_number
+		);
+		goto full_redraw;
+	}
+
+	for (frame_number = frame_tag->frame_number + 1; frame_number <= self->frame_number; ++frame_number)
+	{
+		Imx2dSurface *frame_damage = self->damage_history[frame_number % GST_IMX_2D_COMPOSITOR_DAMAGE_HISTORY_LENGTH];
+		int i;
+
+		num_damage_regions = imx_2d_surface_get_damage_regions(frame_damage, &damage_regions);
+		for (i = 0; i < num_damage_regions; ++i)
+			imx_2d_surface_add_damage_region(self->output_surface, &(damage_regions[i]));
+	}
+
+	/* Damage tracking adds overhead to each blit, so
+	 * do not use it if everything needs to be redrawn. */
+	num_damage_regions = imx_2d_surface_get_damage_regions(self->output_surface, &damage_regions);
+	output_region = imx_2d_surface_get_region(self->output_surface);
+	if ((num_damage_regions == 1) && (memcmp(&(damage_regions[0]), output_region, sizeof(Imx2dRegion)) == 0))
+	{
+		GST_LOG_OBJECT(self, "entire frame is damaged");
+		goto full_redraw;
+	}
+
+	GST_LOG_OBJECT(
+		self,
+		"intermediate buffer contents are from frame %" G_GUINT64_FORMAT "; redrawing %d damage region(s)",
+		frame_tag->frame_number,
+		num_damage_regions
+	);
+
+	imx_2d_surface_set_damage_tracking(self->output_surface, TRUE);
+	return;
+
+full_redraw:
+	imx_2d_surface_clear_damage(self->output_surface);
+	imx_2d_surface_set_damage_tracking(self->output_surface, FALSE);
+}
+
+
+static void gst_imx_2d_compositor_tag_intermediate_buffer(GstImx2dCompositor *self, GstBuffer *intermediate_buffer, gboolean contents_valid)
+{
+	GstMiniObject *memory = GST_MINI_OBJECT_CAST(gst_buffer_peek_memory(intermediate_buffer, 0));
+	GstImx2dCompositorFrameTag *frame_tag;
+
+	if (!contents_valid)
+	{
+		/* Compositing failed, so the buffer's contents are
+		 * undefined, and a partial redraw is not possible. */
+		gst_mini_object_set_qdata(memory, gst_imx_2d_compositor_frame_tag_quark, NULL, NULL);
+		return;
+	}
+
+	/* Reuse existing tags to avoid allocations for every frame. */
+	frame_tag = gst_mini_object_get_qdata(memory, gst_imx_2d_compositor_frame_tag_quark);
+	if ((frame_tag == NULL) || (frame_tag->compositor != self))
+	{
+		frame_tag = g_new0(GstImx2dCompositorFrameTag, 1);
+		frame_tag->compositor = self;
+		gst_mini_object_set_qdata(memory, gst_imx_2d_compositor_frame_tag_quark, frame_tag, g_free);
+	}
+
+	frame_tag->frame_number = self->frame_number;
+}
+
+
 void gst_imx_2d_compositor_common_class_init(GstImx2dCompositorClass *klass, Imx2dHardwareCapabilities const *capabilities)
 {
 	GstElementClass *element_class;
@@ -23,6 +23,8 @@
 #include <gst/video/video.h>
 #include "imx2d/imx2d.h"
 #include "gst/imx/video/gstimxvideobufferpool.h"
+#include "gstimx2dsharedblitter.h"
+#include "gstimx2dstats.h"
 
 
 G_BEGIN_DECLS
@@ -37,6 +39,12 @@ G_BEGIN_DECLS
 #define GST_IS_IMX_2D_COMPOSITOR_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_IMX_2D_COMPOSITOR))
 
 
+/* How many output frames the damage history covers. If an output
+ * buffer was last composed more frames ago than this, it is redrawn
+ * entirely, even if partial redraws are enabled. */
+#define GST_IMX_2D_COMPOSITOR_DAMAGE_HISTORY_LENGTH 8
+
+
 typedef struct _GstImx2dCompositor GstImx2dCompositor;
 typedef struct _GstImx2dCompositorClass GstImx2dCompositorClass;
 
@@ -51,12 +59,37 @@ struct _GstImx2dCompositor
 
 	GstImxVideoBufferPool *video_buffer_pool;
 
+	/* If the shared-blitter property is enabled, this blitter
+	 * belongs to shared_blitter, and every blitter sequence must
+	 * be enclosed in gst_imx_2d_shared_blitter_lock() and
+	 * gst_imx_2d_shared_blitter_unlock() calls. */
 	Imx2dBlitter *blitter;
+	GstImx2dSharedBlitter *shared_blitter;
+	/* TRUE if blitter was created by this element (and not taken
+	 * from shared_blitter), meaning that stop() must destroy it. */
+	gboolean owns_blitter;
 
 	GstVideoInfo output_video_info;
 	Imx2dSurface *output_surface;
 
 	guint32 background_color;
+	gboolean partial_redraw;
+	gboolean use_shared_blitter;
+
+	/* Damage regions of the last output frames. These surfaces
+	 * have no DMA buffers assigned; they are only used for their
+	 * damage region lists. The damage regions of output frame
+	 * number N are stored in damage_history[N % LENGTH]. */
+	Imx2dSurface *damage_history[GST_IMX_2D_COMPOSITOR_DAMAGE_HISTORY_LENGTH];
+	/* Number of the current output frame. This is never reset,
+	 * since the frame numbers stored in the output buffers'
+	 * memory blocks must not be mistaken for newer ones. */
+	guint64 frame_number;
+	/* Set when something changed that affects the entire
+	 * output frame, like the background color. */
+	gboolean full_redraw_needed;
+
+	GstImx2dStatsTracker stats_tracker;
 };
 
 
@@ -66,6 +99,10 @@ struct _GstImx2dCompositorClass
 
 	Imx2dBlitter* (*create_blitter)(GstImx2dCompositor *imx_2d_compositor);
 
+	/* Name of the backend for the shared blitter context type.
+	 * NULL if the subclass does not support shared blitters. */
+	gchar const *shared_blitter_backend_name;
+
 	Imx2dHardwareCapabilities const *hardware_capabilities;
 };
 
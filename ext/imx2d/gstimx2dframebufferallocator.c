@@ -0,0 +1,431 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <gst/gst.h>
+#include <gst/allocators/allocators.h>
+#include "gst/imx/common/gstimxdmabufferallocator.h"
+#include "gstimx2dframebufferallocator.h"
+
+
+GST_DEBUG_CATEGORY_STATIC(imx_2d_framebuffer_allocator_debug);
+#define GST_CAT_DEFAULT imx_2d_framebuffer_allocator_debug
+
+
+#define GST_IMX_2D_FRAMEBUFFER_MEMORY_TYPE "Imx2dFramebufferMemory"
+
+
+typedef struct
+{
+	/* This must be the first field, since the wrapped
+	 * DMA buffer's map function casts it to this struct. */
+	ImxWrappedDmaBuffer dma_buffer;
+	guint8 *virtual_address;
+	gboolean in_use;
+}
+FramebufferPage;
+
+
+typedef struct _GstImx2dFramebufferMemory GstImx2dFramebufferMemory;
+
+
+struct _GstImx2dFramebufferMemory
+{
+	GstMemory parent;
+	gint page;
+};
+
+
+struct _GstImx2dFramebufferAllocator
+{
+	GstAllocator parent;
+
+	guint8 *mapped_framebuffer;
+	gsize mapped_framebuffer_size;
+
+	FramebufferPage *pages;
+	gint num_pages;
+	/* Only the first num_allocatable_pages pages are handed out.
+	 * The remaining ones are reserved for the sink's blitter. */
+	gint num_allocatable_pages;
+	gsize page_size;
+};
+
+
+struct _GstImx2dFramebufferAllocatorClass
+{
+	GstAllocatorClass parent_class;
+};
+
+
+static void gst_imx_2d_framebuffer_allocator_phys_mem_allocator_iface_init(gpointer iface, gpointer iface_data);
+static guintptr gst_imx_2d_framebuffer_allocator_get_phys_addr(GstPhysMemoryAllocator *allocator, GstMemory *memory);
+
+static void gst_imx_2d_framebuffer_allocator_dma_buffer_allocator_iface_init(gpointer iface, gpointer iface_data);
+static ImxDmaBuffer* gst_imx_2d_framebuffer_allocator_get_dma_buffer(GstImxDmaBufferAllocator *allocator, GstMemory *memory);
+
+
+G_DEFINE_TYPE_WITH_CODE(
+	GstImx2dFramebufferAllocator, gst_imx_2d_framebuffer_allocator, GST_TYPE_ALLOCATOR,
+	G_IMPLEMENT_INTERFACE(GST_TYPE_PHYS_MEMORY_ALLOCATOR,    gst_imx_2d_framebuffer_allocator_phys_mem_allocator_iface_init)
+	G_IMPLEMENT_INTERFACE(GST_TYPE_IMX_DMA_BUFFER_ALLOCATOR, gst_imx_2d_framebuffer_allocator_dma_buffer_allocator_iface_init)
+)
+
+static void gst_imx_2d_framebuffer_allocator_finalize(GObject *object);
+
+static GstMemory* gst_imx_2d_framebuffer_allocator_alloc(GstAllocator *allocator, gsize size, GstAllocationParams *params);
+static void gst_imx_2d_framebuffer_allocator_free(GstAllocator *allocator, GstMemory *memory);
+
+static gpointer gst_imx_2d_framebuffer_allocator_map(GstMemory *memory, GstMapInfo *info, gsize maxsize);
+static void gst_imx_2d_framebuffer_allocator_unmap(GstMemory *memory, GstMapInfo *info);
+static GstMemory * gst_imx_2d_framebuffer_allocator_copy(GstMemory *memory, gssize offset, gssize size);
+static GstMemory * gst_imx_2d_framebuffer_allocator_share(GstMemory *memory, gssize offset, gssize size);
+static gboolean gst_imx_2d_framebuffer_allocator_is_span(GstMemory *memory1, GstMemory *memory2, gsize *offset);
+
+static uint8_t* framebuffer_page_map(ImxWrappedDmaBuffer *wrapped_dma_buffer, unsigned int flags, int *error);
+static void framebuffer_page_unmap(ImxWrappedDmaBuffer *wrapped_dma_buffer);
+
+
+
+
+static void gst_imx_2d_framebuffer_allocator_class_init(GstImx2dFramebufferAllocatorClass *klass)
+{
+	GObjectClass *object_class;
+	GstAllocatorClass *allocator_class;
+
+	GST_DEBUG_CATEGORY_INIT(imx_2d_framebuffer_allocator_debug, "imx2dframebufferallocator", 0, "NXP i.MX 2D allocator for direct scanout into framebuffer pages");
+
+	object_class = G_OBJECT_CLASS(klass);
+	allocator_class = GST_ALLOCATOR_CLASS(klass);
+
+	object_class->finalize = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_allocator_finalize);
+	allocator_class->alloc = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_allocator_alloc);
+	allocator_class->free = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_allocator_free);
+}
+
+
+static void gst_imx_2d_framebuffer_allocator_init(GstImx2dFramebufferAllocator *self)
+{
+	GstAllocator *allocator = GST_ALLOCATOR(self);
+
+	allocator->mem_type       = GST_IMX_2D_FRAMEBUFFER_MEMORY_TYPE;
+	allocator->mem_map_full   = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_allocator_map);
+	allocator->mem_unmap_full = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_allocator_unmap);
+	allocator->mem_copy       = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_allocator_copy);
+	allocator->mem_share      = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_allocator_share);
+	allocator->mem_is_span    = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_allocator_is_span);
+
+	self->mapped_framebuffer = MAP_FAILED;
+	self->mapped_framebuffer_size = 0;
+	self->pages = NULL;
+	self->num_pages = 0;
+	self->num_allocatable_pages = 0;
+	self->page_size = 0;
+}
+
+
+static void gst_imx_2d_framebuffer_allocator_finalize(GObject *object)
+{
+	GstImx2dFramebufferAllocator *self = GST_IMX_2D_FRAMEBUFFER_ALLOCATOR(object);
+
+	if (self->mapped_framebuffer != MAP_FAILED)
+		munmap(self->mapped_framebuffer, self->mapped_framebuffer_size);
+
+	g_free(self->pages);
+
+	G_OBJECT_CLASS(gst_imx_2d_framebuffer_allocator_parent_class)->finalize(object);
+}
+
+
+static void gst_imx_2d_framebuffer_allocator_phys_mem_allocator_iface_init(gpointer iface, gpointer G_GNUC_UNUSED iface_data)
+{
+	GstPhysMemoryAllocatorInterface *phys_mem_allocator_iface = (GstPhysMemoryAllocatorInterface *)iface;
+	phys_mem_allocator_iface->get_phys_addr = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_allocator_get_phys_addr);
+}
+
+
+static guintptr gst_imx_2d_framebuffer_allocator_get_phys_addr(GstPhysMemoryAllocator *allocator, GstMemory *memory)
+{
+	GstImx2dFramebufferAllocator *self = GST_IMX_2D_FRAMEBUFFER_ALLOCATOR(allocator);
+	GstImx2dFramebufferMemory *framebuffer_memory = (GstImx2dFramebufferMemory *)memory;
+	return self->pages[framebuffer_memory->page].dma_buffer.physical_address + memory->offset;
+}
+
+
+static void gst_imx_2d_framebuffer_allocator_dma_buffer_allocator_iface_init(gpointer iface, gpointer G_GNUC_UNUSED iface_data)
+{
+	GstImxDmaBufferAllocatorInterface *imx_dma_buffer_allocator_iface = (GstImxDmaBufferAllocatorInterface *)iface;
+	imx_dma_buffer_allocator_iface->get_dma_buffer = GST_DEBUG_FUNCPTR(gst_imx_2d_framebuffer_allocator_get_dma_buffer);
+}
+
+
+static ImxDmaBuffer* gst_imx_2d_framebuffer_allocator_get_dma_buffer(GstImxDmaBufferAllocator *allocator, GstMemory *memory)
+{
+	GstImx2dFramebufferAllocator *self = GST_IMX_2D_FRAMEBUFFER_ALLOCATOR(allocator);
+	GstImx2dFramebufferMemory *framebuffer_memory = (GstImx2dFramebufferMemory *)memory;
+	return (ImxDmaBuffer *)&(self->pages[framebuffer_memory->page].dma_buffer);
+}
+
+
+static GstMemory* gst_imx_2d_framebuffer_allocator_alloc(GstAllocator *allocator, gsize size, GstAllocationParams *params)
+{
+	GstImx2dFramebufferAllocator *self = GST_IMX_2D_FRAMEBUFFER_ALLOCATOR(allocator);
+	GstImx2dFramebufferMemory *framebuffer_memory;
+	gint page;
+
+	if ((size + params->padding) > self->page_size)
+	{
+		GST_ERROR_OBJECT(self, "requested %" G_GSIZE_FORMAT " byte(s) plus %" G_GSIZE_FORMAT " byte(s) of padding, but pages only have %" G_GSIZE_FORMAT " byte(s)", size, params->padding, self->page_size);
+		return NULL;
+	}
+
+	GST_OBJECT_LOCK(self);
+
+	for (page = 0; page < self->num_allocatable_pages; ++page)
+	{
+		if (!self->pages[page].in_use)
+			break;
+	}
+
+	if (page == self->num_allocatable_pages)
+	{
+		GST_OBJECT_UNLOCK(self);
+		GST_ERROR_OBJECT(self, "all %d allocatable framebuffer page(s) are in use", self->num_allocatable_pages);
+		return NULL;
+	}
+
+	self->pages[page].in_use = TRUE;
+
+	GST_OBJECT_UNLOCK(self);
+
+	framebuffer_memory = g_slice_alloc0(sizeof(GstImx2dFramebufferMemory));
+	gst_memory_init(GST_MEMORY_CAST(framebuffer_memory), params->flags | GST_MEMORY_FLAG_PHYSICALLY_CONTIGUOUS, allocator, NULL, self->page_size, 0, 0, size);
+	framebuffer_memory->page = page;
+
+	GST_DEBUG_OBJECT(self, "allocated framebuffer page %d for memory %p", page, (gpointer)framebuffer_memory);
+
+	return GST_MEMORY_CAST(framebuffer_memory);
+}
+
+
+static void gst_imx_2d_framebuffer_allocator_free(GstAllocator *allocator, GstMemory *memory)
+{
+	GstImx2dFramebufferAllocator *self = GST_IMX_2D_FRAMEBUFFER_ALLOCATOR(allocator);
+	GstImx2dFramebufferMemory *framebuffer_memory = (GstImx2dFramebufferMemory *)memory;
+
+	/* Shared memory blocks do not own the page. */
+	if (memory->parent == NULL)
+	{
+		GST_DEBUG_OBJECT(self, "releasing framebuffer page %d", framebuffer_memory->page);
+
+		GST_OBJECT_LOCK(self);
+		self->pages[framebuffer_memory->page].in_use = FALSE;
+		GST_OBJECT_UNLOCK(self);
+	}
+
+	g_slice_free1(sizeof(GstImx2dFramebufferMemory), framebuffer_memory);
+}
+
+
+static gpointer gst_imx_2d_framebuffer_allocator_map(GstMemory *memory, GstMapInfo *info, G_GNUC_UNUSED gsize maxsize)
+{
+	GstImx2dFramebufferAllocator *self = GST_IMX_2D_FRAMEBUFFER_ALLOCATOR(memory->allocator);
+	GstImx2dFramebufferMemory *framebuffer_memory = (GstImx2dFramebufferMemory *)memory;
+
+	/* Make sure any asynchronous write into this memory is done. */
+	if (!gst_imx_dma_buffer_memory_wait_fence(memory))
+	{
+		GST_ERROR_OBJECT(self, "could not map memory: asynchronous operation on memory failed");
+		return NULL;
+	}
+
+	GST_LOG_OBJECT(self, "mapping framebuffer page %d with flags %#x", framebuffer_memory->page, (guint)(info->flags));
+
+	return self->pages[framebuffer_memory->page].virtual_address;
+}
+
+
+static void gst_imx_2d_framebuffer_allocator_unmap(G_GNUC_UNUSED GstMemory *memory, G_GNUC_UNUSED GstMapInfo *info)
+{
+	/* The framebuffer stays mapped until the allocator is finalized. */
+}
+
+
+static GstMemory * gst_imx_2d_framebuffer_allocator_copy(GstMemory *memory, gssize offset, gssize size)
+{
+	GstImx2dFramebufferAllocator *self = GST_IMX_2D_FRAMEBUFFER_ALLOCATOR(memory->allocator);
+	GstImx2dFramebufferMemory *framebuffer_memory = (GstImx2dFramebufferMemory *)memory;
+	GstMemory *copy;
+	GstMapInfo map_info;
+
+	/* Copies cannot be placed in the framebuffer, since there are
+	 * no spare pages. Copy into system memory instead. */
+
+	if (size == -1)
+		size = ((gssize)(memory->size) > offset) ? ((gssize)(memory->size) - offset) : 0;
+
+	copy = gst_allocator_alloc(NULL, size, NULL);
+	if (G_UNLIKELY(copy == NULL))
+	{
+		GST_ERROR_OBJECT(self, "could not allocate system memory for copy");
+		return NULL;
+	}
+
+	if (!gst_imx_dma_buffer_memory_wait_fence(memory) || !gst_memory_map(copy, &map_info, GST_MAP_WRITE))
+	{
+		GST_ERROR_OBJECT(self, "could not prepare copy");
+		gst_memory_unref(copy);
+		return NULL;
+	}
+
+	memcpy(map_info.data, self->pages[framebuffer_memory->page].virtual_address + memory->offset + offset, size);
+	gst_memory_unmap(copy, &map_info);
+
+	return copy;
+}
+
+
+static GstMemory * gst_imx_2d_framebuffer_allocator_share(GstMemory *memory, gssize offset, gssize size)
+{
+	GstImx2dFramebufferMemory *framebuffer_memory = (GstImx2dFramebufferMemory *)memory;
+	GstImx2dFramebufferMemory *new_framebuffer_memory;
+	GstMemory *parent;
+
+	if (size == -1)
+		size = ((gssize)(memory->size) > offset) ? ((gssize)(memory->size) - offset) : 0;
+
+	if ((parent = memory->parent) == NULL)
+		parent = memory;
+
+	new_framebuffer_memory = g_slice_alloc0(sizeof(GstImx2dFramebufferMemory));
+	gst_memory_init(GST_MEMORY_CAST(new_framebuffer_memory), GST_MINI_OBJECT_FLAGS(parent) | GST_MINI_OBJECT_FLAG_LOCK_READONLY | GST_MEMORY_FLAG_PHYSICALLY_CONTIGUOUS, memory->allocator, parent, memory->maxsize, memory->align, memory->offset + offset, size);
+	new_framebuffer_memory->page = framebuffer_memory->page;
+
+	return GST_MEMORY_CAST(new_framebuffer_memory);
+}
+
+
+static gboolean gst_imx_2d_framebuffer_allocator_is_span(G_GNUC_UNUSED GstMemory *memory1, G_GNUC_UNUSED GstMemory *memory2, G_GNUC_UNUSED gsize *offset)
+{
+	/* Pages are handed out as separate frames, so
+	 * treating two of them as one span makes no sense. */
+	return FALSE;
+}
+
+
+static uint8_t* framebuffer_page_map(ImxWrappedDmaBuffer *wrapped_dma_buffer, G_GNUC_UNUSED unsigned int flags, G_GNUC_UNUSED int *error)
+{
+	FramebufferPage *page = (FramebufferPage *)wrapped_dma_buffer;
+	return page->virtual_address;
+}
+
+
+static void framebuffer_page_unmap(G_GNUC_UNUSED ImxWrappedDmaBuffer *wrapped_dma_buffer)
+{
+}
+
+
+GstAllocator* gst_imx_2d_framebuffer_allocator_new(Imx2dLinuxFramebuffer *framebuffer, gint num_reserved_pages)
+{
+	GstImx2dFramebufferAllocator *self;
+	gint page;
+
+	g_assert(framebuffer != NULL);
+	g_assert(num_reserved_pages >= 0);
+
+	self = GST_IMX_2D_FRAMEBUFFER_ALLOCATOR_CAST(g_object_new(gst_imx_2d_framebuffer_allocator_get_type(), NULL));
+
+	self->num_pages = imx_2d_linux_framebuffer_get_num_fb_pages(framebuffer);
+	self->num_allocatable_pages = MAX(self->num_pages - num_reserved_pages, 0);
+	self->page_size = imx_2d_linux_framebuffer_get_page_size(framebuffer);
+	self->mapped_framebuffer_size = self->page_size * self->num_pages;
+
+	/* Map the framebuffer here instead of relying on the framebuffer
+	 * wrapper, since memory blocks may outlive said wrapper. */
+	self->mapped_framebuffer = mmap(NULL, self->mapped_framebuffer_size, PROT_READ | PROT_WRITE, MAP_SHARED, imx_2d_linux_framebuffer_get_fd(framebuffer), 0);
+	if (self->mapped_framebuffer == MAP_FAILED)
+	{
+		GST_ERROR_OBJECT(self, "could not map framebuffer: %s (%d)", strerror(errno), errno);
+		gst_object_unref(GST_OBJECT(self));
+		return NULL;
+	}
+
+	self->pages = g_new0(FramebufferPage, self->num_pages);
+	for (page = 0; page < self->num_pages; ++page)
+	{
+		FramebufferPage *framebuffer_page = &(self->pages[page]);
+
+		imx_dma_buffer_init_wrapped_buffer(&(framebuffer_page->dma_buffer));
+		framebuffer_page->dma_buffer.map = framebuffer_page_map;
+		framebuffer_page->dma_buffer.unmap = framebuffer_page_unmap;
+		framebuffer_page->dma_buffer.fd = -1;
+		framebuffer_page->dma_buffer.physical_address = imx_2d_linux_framebuffer_get_page_physical_address(framebuffer, page);
+		framebuffer_page->dma_buffer.size = self->page_size;
+
+		framebuffer_page->virtual_address = self->mapped_framebuffer + self->page_size * page;
+		framebuffer_page->in_use = FALSE;
+	}
+
+	GST_DEBUG_OBJECT(self, "created new framebuffer allocator with %d page(s) of %" G_GSIZE_FORMAT " byte(s), %d of which are reserved", self->num_pages, self->page_size, self->num_pages - self->num_allocatable_pages);
+
+	/* Clear floating flag */
+	gst_object_ref_sink(GST_OBJECT(self));
+
+	return GST_ALLOCATOR_CAST(self);
+}
+
+
+gsize gst_imx_2d_framebuffer_allocator_get_page_size(GstAllocator *allocator)
+{
+	return GST_IMX_2D_FRAMEBUFFER_ALLOCATOR(allocator)->page_size;
+}
+
+
+gint gst_imx_2d_framebuffer_allocator_get_page_of_buffer(GstAllocator *allocator, GstBuffer *buffer)
+{
+	GstMemory *memory;
+
+	g_assert(allocator != NULL);
+	g_assert(buffer != NULL);
+
+	if (gst_buffer_n_memory(buffer) != 1)
+		return -1;
+
+	memory = gst_buffer_peek_memory(buffer, 0);
+	if ((memory->allocator != allocator) || (memory->offset != 0))
+		return -1;
+
+	return ((GstImx2dFramebufferMemory *)memory)->page;
+}
+
+
+gboolean gst_imx_2d_framebuffer_allocator_is_page_in_use(GstAllocator *allocator, gint page)
+{
+	GstImx2dFramebufferAllocator *self = GST_IMX_2D_FRAMEBUFFER_ALLOCATOR(allocator);
+	gboolean in_use;
+
+	g_assert((page >= 0) && (page < self->num_pages));
+
+	GST_OBJECT_LOCK(self);
+	in_use = self->pages[page].in_use;
+	GST_OBJECT_UNLOCK(self);
+
+	return in_use;
+}
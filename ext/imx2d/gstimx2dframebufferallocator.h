@@ -0,0 +1,84 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef GST_IMX_2D_FRAMEBUFFER_ALLOCATOR_H
+#define GST_IMX_2D_FRAMEBUFFER_ALLOCATOR_H
+
+#include <gst/gst.h>
+#include "imx2d/linux_framebuffer.h"
+
+
+G_BEGIN_DECLS
+
+
+/* The GstImx2dFramebufferAllocator is an internal allocator used by
+ * the imx2d video sink for direct scanout. Instead of allocating new
+ * memory, it hands out the pages of an Imx2dLinuxFramebuffer, one page
+ * per GstMemory. Upstream can then write frames directly into scanout
+ * memory, and the sink only has to pan the framebuffer to the page
+ * of the frame to show it.
+ *
+ * There are only as many memory blocks as there are framebuffer pages,
+ * minus the number of reserved pages. Reserved pages are never handed
+ * out, so the sink can blit frames into them without overwriting frames
+ * that upstream is still holding. Allocations fail if all other pages
+ * are in use. Allocations also fail if the requested size exceeds the
+ * page size.
+ *
+ * The allocator implements the GstImxDmaBufferAllocator and
+ * GstPhysMemoryAllocator interfaces, so elements that want to access
+ * the pages with DMA can do so. The allocator maps the framebuffer on
+ * its own, so its memory blocks stay valid even after the framebuffer
+ * wrapper was destroyed (the framebuffer memory itself stays in place).
+ */
+
+
+#define GST_TYPE_IMX_2D_FRAMEBUFFER_ALLOCATOR             (gst_imx_2d_framebuffer_allocator_get_type())
+#define GST_IMX_2D_FRAMEBUFFER_ALLOCATOR(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_IMX_2D_FRAMEBUFFER_ALLOCATOR, GstImx2dFramebufferAllocator))
+#define GST_IMX_2D_FRAMEBUFFER_ALLOCATOR_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_IMX_2D_FRAMEBUFFER_ALLOCATOR, GstImx2dFramebufferAllocatorClass))
+#define GST_IMX_2D_FRAMEBUFFER_ALLOCATOR_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), GST_TYPE_IMX_2D_FRAMEBUFFER_ALLOCATOR, GstImx2dFramebufferAllocatorClass))
+#define GST_IMX_2D_FRAMEBUFFER_ALLOCATOR_CAST(obj)        ((GstImx2dFramebufferAllocator *)(obj))
+#define GST_IS_IMX_2D_FRAMEBUFFER_ALLOCATOR(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_IMX_2D_FRAMEBUFFER_ALLOCATOR))
+#define GST_IS_IMX_2D_FRAMEBUFFER_ALLOCATOR_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_IMX_2D_FRAMEBUFFER_ALLOCATOR))
+
+
+typedef struct _GstImx2dFramebufferAllocator GstImx2dFramebufferAllocator;
+typedef struct _GstImx2dFramebufferAllocatorClass GstImx2dFramebufferAllocatorClass;
+
+
+GType gst_imx_2d_framebuffer_allocator_get_type(void);
+
+GstAllocator* gst_imx_2d_framebuffer_allocator_new(Imx2dLinuxFramebuffer *framebuffer, gint num_reserved_pages);
+
+gsize gst_imx_2d_framebuffer_allocator_get_page_size(GstAllocator *allocator);
+
+/* Returns the number of the framebuffer page the buffer's memory
+ * refers to, or -1 if the buffer does not consist of exactly one
+ * whole page memory block from this allocator. */
+gint gst_imx_2d_framebuffer_allocator_get_page_of_buffer(GstAllocator *allocator, GstBuffer *buffer);
+
+/* Returns TRUE if the page is currently handed out as a memory block.
+ * Such pages belong to upstream (or to its buffer pool) and must not
+ * be written into by anyone else. Reserved pages are never in use. */
+gboolean gst_imx_2d_framebuffer_allocator_is_page_in_use(GstAllocator *allocator, gint page);
+
+
+G_END_DECLS
+
+
+#endif /* GST_IMX_2D_FRAMEBUFFER_ALLOCATOR_H */
@@ -697,6 +697,81 @@ void gst_imx_2d_assign_output_buffer_to_surface(Imx2dSurface *surface, GstBuffer
 }
 
 
+void gst_imx_2d_set_surface_desc_colorimetry(Imx2dSurfaceDesc *surface_desc, GstVideoInfo const *video_info)
+{
+	GstVideoColorimetry const *colorimetry = &(GST_VIDEO_INFO_COLORIMETRY(video_info));
+
+	switch (colorimetry->matrix)
+	{
+		case GST_VIDEO_COLOR_MATRIX_BT601: surface_desc->color_matrix = IMX_2D_COLOR_MATRIX_BT601; break;
+		case GST_VIDEO_COLOR_MATRIX_BT709: surface_desc->color_matrix = IMX_2D_COLOR_MATRIX_BT709; break;
+		case GST_VIDEO_COLOR_MATRIX_BT2020: surface_desc->color_matrix = IMX_2D_COLOR_MATRIX_BT2020; break;
+		default: surface_desc->color_matrix = IMX_2D_COLOR_MATRIX_DEFAULT; break;
+	}
+
+	switch (colorimetry->range)
+	{
+		case GST_VIDEO_COLOR_RANGE_0_255: surface_desc->color_range = IMX_2D_COLOR_RANGE_FULL; break;
+		case GST_VIDEO_COLOR_RANGE_16_235: surface_desc->color_range = IMX_2D_COLOR_RANGE_LIMITED; break;
+		default: surface_desc->color_range = IMX_2D_COLOR_RANGE_DEFAULT; break;
+	}
+
+	GST_LOG(
+		"surface colorimetry: matrix: %s  range: %s",
+		imx_2d_color_matrix_to_string(surface_desc->color_matrix),
+		imx_2d_color_range_to_string(surface_desc->color_range)
+	);
+}
+
+
+static gboolean wait_for_imx_2d_fence(gpointer fence)
+{
+	return imx_2d_fence_wait((Imx2dFence *)fence) != 0;
+}
+
+
+void gst_imx_2d_set_fence_on_buffer(GstBuffer *buffer, Imx2dFence *fence)
+{
+	guint memory_index;
+
+	g_assert(buffer != NULL);
+	g_assert(fence != NULL);
+
+	for (memory_index = 0; memory_index < gst_buffer_n_memory(buffer); ++memory_index)
+	{
+		gst_imx_dma_buffer_memory_set_fence(
+			gst_buffer_peek_memory(buffer, memory_index),
+			imx_2d_fence_ref(fence),
+			wait_for_imx_2d_fence,
+			(GDestroyNotify)imx_2d_fence_unref
+		);
+	}
+}
+
+
+gboolean gst_imx_2d_blit_with_plan(Imx2dBlitter *blitter, Imx2dBlitPlan **blit_plan, Imx2dSurface *source, Imx2dSurface *dest, Imx2dBlitParams const *params)
+{
+	g_assert(blitter != NULL);
+	g_assert(blit_plan != NULL);
+
+	if ((*blit_plan != NULL) && !imx_2d_blit_plan_matches(*blit_plan, source, dest, params))
+	{
+		GST_LOG("blit params changed; discarding blit plan");
+		imx_2d_blit_plan_destroy(*blit_plan);
+		*blit_plan = NULL;
+	}
+
+	if (*blit_plan == NULL)
+	{
+		*blit_plan = imx_2d_blit_plan_create(blitter, source, dest, params);
+		if (*blit_plan == NULL)
+			return FALSE;
+	}
+
+	return imx_2d_blitter_do_planned_blit(blitter, *blit_plan);
+}
+
+
 void gst_imx_2d_align_output_video_info(GstVideoInfo *output_video_info, gint *num_padding_rows, Imx2dHardwareCapabilities const *hardware_capabilities)
 {
 	GstVideoInfo original_output_video_info;
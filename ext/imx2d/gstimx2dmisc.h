@@ -70,6 +70,29 @@ void gst_imx_2d_assign_input_buffer_to_surface(
 );
 void gst_imx_2d_assign_output_buffer_to_surface(Imx2dSurface *surface, GstBuffer *output_buffer, GstVideoInfo const *output_video_info);
 
+/* Sets the color_matrix and color_range fields of the surface
+ * description according to the colorimetry in video_info. */
+void gst_imx_2d_set_surface_desc_colorimetry(Imx2dSurfaceDesc *surface_desc, GstVideoInfo const *video_info);
+
+/* Associates the fence with all memory blocks in the buffer (see
+ * gst_imx_dma_buffer_memory_set_fence()). Mapping these memory blocks
+ * or uploading the buffer then waits until the fence is signaled.
+ * Each memory block holds its own reference to the fence. */
+void gst_imx_2d_set_fence_on_buffer(GstBuffer *buffer, Imx2dFence *fence);
+
+/* Blits with the blit plan in *blit_plan. If *blit_plan is NULL, or
+ * if it does not match the given surfaces and params, a new plan is
+ * created first (and the old one is destroyed). Elements destroy their
+ * plans when the regions or caps change, but thanks to this check,
+ * per-frame params such as crop rectangles are handled correctly too. */
+gboolean gst_imx_2d_blit_with_plan(
+	Imx2dBlitter *blitter,
+	Imx2dBlitPlan **blit_plan,
+	Imx2dSurface *source,
+	Imx2dSurface *dest,
+	Imx2dBlitParams const *params
+);
+
 void gst_imx_2d_align_output_video_info(GstVideoInfo *output_video_info, gint *num_padding_rows, Imx2dHardwareCapabilities const *hardware_capabilities);
 
 Imx2dRotation gst_imx_2d_convert_from_video_orientation_method(GstVideoOrientationMethod method);
@@ -0,0 +1,1838 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <stdio.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "gst/imx/common/gstimxdmabufferallocator.h"
+#include "gst/imx/video/gstimxvideobufferpool.h"
+#include "gstimx2dmultiscaler.h"
+#include "gstimx2dmisc.h"
+
+
+GST_DEBUG_CATEGORY_STATIC(imx_2d_multi_scaler_debug);
+#define GST_CAT_DEFAULT imx_2d_multi_scaler_debug
+
+
+/* Cached quark to avoid contention on the global quark table lock */
+static GQuark meta_tag_video_quark;
+
+
+
+
+/********** GstImx2dMultiScalerSrcPad **********/
+
+
+#define GST_TYPE_IMX_2D_MULTI_SCALER_SRC_PAD             (gst_imx_2d_multi_scaler_src_pad_get_type())
+#define GST_IMX_2D_MULTI_SCALER_SRC_PAD(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_IMX_2D_MULTI_SCALER_SRC_PAD, GstImx2dMultiScalerSrcPad))
+#define GST_IMX_2D_MULTI_SCALER_SRC_PAD_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_IMX_2D_MULTI_SCALER_SRC_PAD, GstImx2dMultiScalerSrcPadClass))
+#define GST_IMX_2D_MULTI_SCALER_SRC_PAD_CAST(obj)        ((GstImx2dMultiScalerSrcPad *)(obj))
+#define GST_IS_IMX_2D_MULTI_SCALER_SRC_PAD(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_IMX_2D_MULTI_SCALER_SRC_PAD))
+#define GST_IS_IMX_2D_MULTI_SCALER_SRC_PAD_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_IMX_2D_MULTI_SCALER_SRC_PAD))
+
+
+typedef struct _GstImx2dMultiScalerSrcPad GstImx2dMultiScalerSrcPad;
+typedef struct _GstImx2dMultiScalerSrcPadClass GstImx2dMultiScalerSrcPadClass;
+
+
+GType gst_imx_2d_multi_scaler_src_pad_get_type(void);
+
+
+struct _GstImx2dMultiScalerSrcPad
+{
+	GstPad parent;
+
+	/* The fields below up to the QoS fields are only
+	 * accessed with the sink pad's stream lock held. */
+
+	/* Set to FALSE when the input caps change, when the
+	 * pad is released, and when the element is stopped.
+	 * The pad is then renegotiated before it gets the
+	 * next output frame. */
+	gboolean negotiated;
+
+	GstVideoInfo output_video_info;
+
+	/* Output buffer pool of this pad. Each src pad has
+	 * its own pool, since each one has its own caps and
+	 * its own downstream allocation query. */
+	GstImxVideoBufferPool *video_buffer_pool;
+
+	/* imx2d output surface. This is created once per pad,
+	 * and has the DMA buffers of each output frame assigned. */
+	Imx2dSurface *output_surface;
+
+	/* Precomputed blit from the input surface to output_surface.
+	 * Discarded when the pad is renegotiated, and when the element
+	 * stops (since plans must not outlive their blitter). */
+	Imx2dBlitPlan *blit_plan;
+
+	/* Per-frame state. Only valid in the chain function. */
+	gboolean render_frame;
+	GstBuffer *output_buffer;
+	GstBuffer *intermediate_buffer;
+	Imx2dFence *fence;
+
+	/* QoS information from downstream of this pad. These
+	 * fields are protected by the pad's object lock, since
+	 * QoS events arrive in downstream streaming threads. */
+	gdouble proportion;
+	GstClockTime earliest_time;
+	guint64 num_processed;
+	guint64 num_dropped;
+};
+
+
+struct _GstImx2dMultiScalerSrcPadClass
+{
+	GstPadClass parent_class;
+};
+
+
+enum
+{
+	PROP_SRC_PAD_0,
+	PROP_SRC_PAD_PROCESSED,
+	PROP_SRC_PAD_DROPPED
+};
+
+
+G_DEFINE_TYPE(GstImx2dMultiScalerSrcPad, gst_imx_2d_multi_scaler_src_pad, GST_TYPE_PAD)
+
+
+static void gst_imx_2d_multi_scaler_src_pad_finalize(GObject *object);
+static void gst_imx_2d_multi_scaler_src_pad_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
+static void gst_imx_2d_multi_scaler_src_pad_reset_negotiation(GstImx2dMultiScalerSrcPad *self);
+static GstImxVideoBufferPool* gst_imx_2d_multi_scaler_src_pad_clear_negotiation(GstImx2dMultiScalerSrcPad *self);
+static void gst_imx_2d_multi_scaler_release_video_buffer_pool(GstImxVideoBufferPool *video_buffer_pool);
+static void gst_imx_2d_multi_scaler_src_pad_reset_qos(GstImx2dMultiScalerSrcPad *self);
+
+
+
+
+static void gst_imx_2d_multi_scaler_src_pad_class_init(GstImx2dMultiScalerSrcPadClass *klass)
+{
+	GObjectClass *object_class;
+
+	object_class = G_OBJECT_CLASS(klass);
+
+	object_class->finalize     = GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_src_pad_finalize);
+	object_class->get_property = GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_src_pad_get_property);
+
+	g_object_class_install_property(
+		object_class,
+		PROP_SRC_PAD_PROCESSED,
+		g_param_spec_uint64(
+			"processed",
+			"Processed",
+			"Number of output frames rendered for this pad",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_SRC_PAD_DROPPED,
+		g_param_spec_uint64(
+			"dropped",
+			"Dropped",
+			"Number of frames that were not rendered for this pad because they would have been too late downstream",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+}
+
+
+static void gst_imx_2d_multi_scaler_src_pad_init(GstImx2dMultiScalerSrcPad *self)
+{
+	self->negotiated = FALSE;
+	gst_video_info_init(&(self->output_video_info));
+	self->video_buffer_pool = NULL;
+	self->output_surface = imx_2d_surface_create(NULL);
+	self->blit_plan = NULL;
+
+	self->render_frame = FALSE;
+	self->output_buffer = NULL;
+	self->intermediate_buffer = NULL;
+	self->fence = NULL;
+
+	gst_imx_2d_multi_scaler_src_pad_reset_qos(self);
+	self->num_processed = 0;
+	self->num_dropped = 0;
+}
+
+
+static void gst_imx_2d_multi_scaler_src_pad_finalize(GObject *object)
+{
+	GstImx2dMultiScalerSrcPad *self = GST_IMX_2D_MULTI_SCALER_SRC_PAD(object);
+
+	gst_imx_2d_multi_scaler_src_pad_reset_negotiation(self);
+
+	if (self->output_surface != NULL)
+		imx_2d_surface_destroy(self->output_surface);
+
+	G_OBJECT_CLASS(gst_imx_2d_multi_scaler_src_pad_parent_class)->finalize(object);
+}
+
+
+static void gst_imx_2d_multi_scaler_src_pad_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	GstImx2dMultiScalerSrcPad *self = GST_IMX_2D_MULTI_SCALER_SRC_PAD(object);
+
+	switch (prop_id)
+	{
+		case PROP_SRC_PAD_PROCESSED:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint64(value, self->num_processed);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_SRC_PAD_DROPPED:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint64(value, self->num_dropped);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static void gst_imx_2d_multi_scaler_src_pad_reset_negotiation(GstImx2dMultiScalerSrcPad *self)
+{
+	GstImxVideoBufferPool *video_buffer_pool = gst_imx_2d_multi_scaler_src_pad_clear_negotiation(self);
+
+	if (video_buffer_pool != NULL)
+		gst_imx_2d_multi_scaler_release_video_buffer_pool(video_buffer_pool);
+}
+
+
+/* Like gst_imx_2d_multi_scaler_src_pad_reset_negotiation(), except that
+ * the video buffer pool is not released. Instead, it is returned (or NULL
+ * if there is none), and the caller has to release it with
+ * gst_imx_2d_multi_scaler_release_video_buffer_pool(). This is useful
+ * when the pool cannot be deactivated right away because a lock is held. */
+static GstImxVideoBufferPool* gst_imx_2d_multi_scaler_src_pad_clear_negotiation(GstImx2dMultiScalerSrcPad *self)
+{
+	GstImxVideoBufferPool *video_buffer_pool;
+
+	self->negotiated = FALSE;
+
+	imx_2d_blit_plan_destroy(self->blit_plan);
+	self->blit_plan = NULL;
+
+	video_buffer_pool = self->video_buffer_pool;
+	self->video_buffer_pool = NULL;
+
+	return video_buffer_pool;
+}
+
+
+static void gst_imx_2d_multi_scaler_release_video_buffer_pool(GstImxVideoBufferPool *video_buffer_pool)
+{
+	/* The output video buffer pool was activated by us, so
+	 * it has to be deactivated here as well. The internal
+	 * DMA buffer pool is deactivated by the video buffer
+	 * pool itself. Deactivating takes the pools' own locks
+	 * and frees their buffers, so this must not be called
+	 * while holding the element's object lock. */
+	gst_buffer_pool_set_active(gst_imx_video_buffer_pool_get_output_video_buffer_pool(video_buffer_pool), FALSE);
+	gst_object_unref(GST_OBJECT(video_buffer_pool));
+}
+
+
+static void gst_imx_2d_multi_scaler_src_pad_reset_qos(GstImx2dMultiScalerSrcPad *self)
+{
+	GST_OBJECT_LOCK(self);
+	self->proportion = 1.0;
+	self->earliest_time = GST_CLOCK_TIME_NONE;
+	GST_OBJECT_UNLOCK(self);
+}
+
+
+
+
+/********** GstImx2dMultiScaler **********/
+
+
+enum
+{
+	PROP_0,
+	PROP_INPUT_CROP,
+	PROP_STATS,
+	PROP_SHARED_BLITTER
+};
+
+
+#define DEFAULT_INPUT_CROP TRUE
+#define DEFAULT_SHARED_BLITTER FALSE
+
+
+G_DEFINE_ABSTRACT_TYPE(GstImx2dMultiScaler, gst_imx_2d_multi_scaler, GST_TYPE_ELEMENT)
+
+
+/* Base class function overloads. */
+
+/* General element operations. */
+static void gst_imx_2d_multi_scaler_finalize(GObject *object);
+static void gst_imx_2d_multi_scaler_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
+static void gst_imx_2d_multi_scaler_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
+static GstStateChangeReturn gst_imx_2d_multi_scaler_change_state(GstElement *element, GstStateChange transition);
+static GstPad* gst_imx_2d_multi_scaler_request_new_pad(GstElement *element, GstPadTemplate *templ, const gchar *req_name, GstCaps const *caps);
+static void gst_imx_2d_multi_scaler_release_pad(GstElement *element, GstPad *pad);
+static void gst_imx_2d_multi_scaler_set_context(GstElement *element, GstContext *context);
+
+/* Pad functions. */
+static gboolean gst_imx_2d_multi_scaler_sink_event(GstPad *pad, GstObject *parent, GstEvent *event);
+static gboolean gst_imx_2d_multi_scaler_sink_query(GstPad *pad, GstObject *parent, GstQuery *query);
+static GstFlowReturn gst_imx_2d_multi_scaler_chain(GstPad *pad, GstObject *parent, GstBuffer *input_buffer);
+static gboolean gst_imx_2d_multi_scaler_src_event(GstPad *pad, GstObject *parent, GstEvent *event);
+static gboolean gst_imx_2d_multi_scaler_src_query(GstPad *pad, GstObject *parent, GstQuery *query);
+
+
+/* GstImx2dMultiScaler specific functions. */
+
+static gboolean gst_imx_2d_multi_scaler_start(GstImx2dMultiScaler *self);
+static void gst_imx_2d_multi_scaler_stop(GstImx2dMultiScaler *self);
+static gboolean gst_imx_2d_multi_scaler_create_blitter(GstImx2dMultiScaler *self);
+static Imx2dBlitter* gst_imx_2d_multi_scaler_create_blitter_for_sharing(gpointer user_data);
+static gboolean gst_imx_2d_multi_scaler_handle_context_query(GstImx2dMultiScaler *self, GstQuery *query);
+static gboolean gst_imx_2d_multi_scaler_set_input_caps(GstImx2dMultiScaler *self, GstCaps *input_caps);
+static GstCaps* gst_imx_2d_multi_scaler_get_src_caps(GstImx2dMultiScaler *self, GstPad *srcpad, GstCaps *filter);
+static GstCaps* gst_imx_2d_multi_scaler_fixate_src_caps(GstImx2dMultiScaler *self, GstCaps *caps);
+static gboolean gst_imx_2d_multi_scaler_negotiate_src_pad(GstImx2dMultiScaler *self, GstImx2dMultiScalerSrcPad *srcpad);
+static gboolean gst_imx_2d_multi_scaler_check_qos(GstImx2dMultiScaler *self, GstImx2dMultiScalerSrcPad *srcpad, GstBuffer *input_buffer);
+static void gst_imx_2d_multi_scaler_reset_src_pads(GstImx2dMultiScaler *self, gboolean reset_negotiation);
+static void gst_imx_2d_multi_scaler_copy_metadata(GstBuffer *input_buffer, GstBuffer *output_buffer);
+static gboolean gst_imx_2d_multi_scaler_copy_meta(GstBuffer *input_buffer, GstMeta **meta, gpointer user_data);
+
+
+
+
+static void gst_imx_2d_multi_scaler_class_init(GstImx2dMultiScalerClass *klass)
+{
+	GObjectClass *object_class;
+	GstElementClass *element_class;
+
+	gst_imx_2d_setup_logging();
+
+	GST_DEBUG_CATEGORY_INIT(imx_2d_multi_scaler_debug, "imx2dmultiscaler", 0, "NXP i.MX 2D multi scaler base class");
+
+	meta_tag_video_quark = g_quark_from_static_string(GST_META_TAG_VIDEO_STR);
+
+	object_class = G_OBJECT_CLASS(klass);
+	element_class = GST_ELEMENT_CLASS(klass);
+
+	object_class->finalize         = GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_finalize);
+	object_class->set_property     = GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_set_property);
+	object_class->get_property     = GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_get_property);
+
+	element_class->change_state    = GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_change_state);
+	element_class->request_new_pad = GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_request_new_pad);
+	element_class->release_pad     = GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_release_pad);
+	element_class->set_context     = GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_set_context);
+
+	klass->start = NULL;
+	klass->stop = NULL;
+	klass->create_blitter = NULL;
+	klass->shared_blitter_backend_name = NULL;
+
+	g_object_class_install_property(
+		object_class,
+		PROP_INPUT_CROP,
+		g_param_spec_boolean(
+			"input-crop",
+			"Input crop",
+			"Whether or not to crop input frames based on their video crop metadata",
+			DEFAULT_INPUT_CROP,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_STATS,
+		gst_imx_2d_stats_param_spec_new()
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_SHARED_BLITTER,
+		gst_imx_2d_shared_blitter_param_spec_new()
+	);
+}
+
+
+static void gst_imx_2d_multi_scaler_init(GstImx2dMultiScaler *self)
+{
+	GstElementClass *element_class = GST_ELEMENT_GET_CLASS(self);
+
+	self->sinkpad = gst_pad_new_from_template(gst_element_class_get_pad_template(element_class, "sink"), "sink");
+	gst_pad_set_event_function(self->sinkpad, GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_sink_event));
+	gst_pad_set_query_function(self->sinkpad, GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_sink_query));
+	gst_pad_set_chain_function(self->sinkpad, GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_chain));
+	gst_element_add_pad(GST_ELEMENT(self), self->sinkpad);
+
+	self->uploader = NULL;
+	self->imx_dma_buffer_allocator = NULL;
+
+	self->blitter = NULL;
+	self->shared_blitter = NULL;
+	self->owns_blitter = FALSE;
+
+	/* NOTE: This is created here instead of in start() because
+	 * src pads may be requested before start() runs, and these
+	 * have to be added to the flow combiner. */
+	self->flow_combiner = gst_flow_combiner_new();
+
+	self->next_src_pad_index = 0;
+
+	self->input_video_info_set = FALSE;
+	gst_video_info_init(&(self->input_video_info));
+
+	self->input_surface = NULL;
+
+	gst_segment_init(&(self->segment), GST_FORMAT_UNDEFINED);
+
+	self->input_crop = DEFAULT_INPUT_CROP;
+	self->use_shared_blitter = DEFAULT_SHARED_BLITTER;
+
+	gst_imx_2d_stats_tracker_init(&(self->stats_tracker), GST_OBJECT(self));
+}
+
+
+static void gst_imx_2d_multi_scaler_finalize(GObject *object)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(object);
+
+	gst_flow_combiner_free(self->flow_combiner);
+	gst_imx_2d_stats_tracker_cleanup(&(self->stats_tracker));
+
+	G_OBJECT_CLASS(gst_imx_2d_multi_scaler_parent_class)->finalize(object);
+}
+
+
+static void gst_imx_2d_multi_scaler_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(object);
+
+	switch (prop_id)
+	{
+		case PROP_INPUT_CROP:
+		{
+			GST_OBJECT_LOCK(self);
+			self->input_crop = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_SHARED_BLITTER:
+		{
+			GST_OBJECT_LOCK(self);
+			self->use_shared_blitter = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static void gst_imx_2d_multi_scaler_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(object);
+
+	switch (prop_id)
+	{
+		case PROP_INPUT_CROP:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->input_crop);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_SHARED_BLITTER:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->use_shared_blitter);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_STATS:
+			g_value_take_boxed(value, gst_imx_2d_stats_tracker_create_structure(&(self->stats_tracker)));
+			break;
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static GstStateChangeReturn gst_imx_2d_multi_scaler_change_state(GstElement *element, GstStateChange transition)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(element);
+	GstStateChangeReturn ret = GST_STATE_CHANGE_SUCCESS;
+
+	g_assert(self != NULL);
+
+	switch (transition)
+	{
+		case GST_STATE_CHANGE_NULL_TO_READY:
+		{
+			if (!gst_imx_2d_multi_scaler_start(self))
+				return GST_STATE_CHANGE_FAILURE;
+			break;
+		}
+
+		case GST_STATE_CHANGE_READY_TO_PAUSED:
+		{
+			gst_segment_init(&(self->segment), GST_FORMAT_UNDEFINED);
+			gst_flow_combiner_reset(self->flow_combiner);
+			gst_imx_2d_multi_scaler_reset_src_pads(self, FALSE);
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	ret = GST_ELEMENT_CLASS(gst_imx_2d_multi_scaler_parent_class)->change_state(element, transition);
+	if (ret == GST_STATE_CHANGE_FAILURE)
+		return ret;
+
+	switch (transition)
+	{
+		case GST_STATE_CHANGE_PAUSED_TO_READY:
+		{
+			/* The pads are deactivated at this point, so the
+			 * streaming thread is no longer using their pools. */
+			gst_imx_2d_multi_scaler_reset_src_pads(self, TRUE);
+
+			GST_OBJECT_LOCK(self);
+			self->input_video_info_set = FALSE;
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case GST_STATE_CHANGE_READY_TO_NULL:
+			gst_imx_2d_multi_scaler_stop(self);
+			break;
+
+		default:
+			break;
+	}
+
+	return ret;
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_forward_sticky_event(G_GNUC_UNUSED GstPad *pad, GstEvent **event, gpointer user_data)
+{
+	GstPad *srcpad = GST_PAD_CAST(user_data);
+
+	/* Each src pad negotiates its own caps, so the
+	 * sink pad's caps must not be forwarded. The segment
+	 * must come after the caps, so it is held back until
+	 * gst_imx_2d_multi_scaler_negotiate_src_pad() pushed
+	 * this pad's caps. */
+	if ((GST_EVENT_TYPE(*event) != GST_EVENT_CAPS) && (GST_EVENT_TYPE(*event) != GST_EVENT_SEGMENT))
+		gst_pad_store_sticky_event(srcpad, *event);
+
+	return TRUE;
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_negotiate_linked_src_pad(GstPad *srcpad, gpointer user_data)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(user_data);
+
+	/* Unlinked pads are negotiated in the chain
+	 * function once they are linked. */
+	if (!gst_pad_is_linked(srcpad))
+		return FALSE;
+
+	/* Clear the reconfigure flag that was set when the pad got
+	 * linked, since the pad is negotiated right here. If the
+	 * negotiation fails, let the chain function retry. */
+	gst_pad_check_reconfigure(srcpad);
+	if (!gst_imx_2d_multi_scaler_negotiate_src_pad(self, GST_IMX_2D_MULTI_SCALER_SRC_PAD(srcpad)))
+		gst_pad_mark_reconfigure(srcpad);
+
+	return FALSE;
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_push_segment(GstPad *srcpad, gpointer user_data)
+{
+	GstEvent *segment_event = GST_EVENT_CAST(user_data);
+
+	/* Pads without caps get the segment after their caps
+	 * were pushed in gst_imx_2d_multi_scaler_negotiate_src_pad(). */
+	if (gst_pad_has_current_caps(srcpad))
+		gst_pad_push_event(srcpad, gst_event_ref(segment_event));
+
+	return FALSE;
+}
+
+
+static GstPad* gst_imx_2d_multi_scaler_request_new_pad(GstElement *element, GstPadTemplate *templ, const gchar *req_name, G_GNUC_UNUSED GstCaps const *caps)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(element);
+	GstPad *srcpad;
+	gchar *name;
+	guint index;
+
+	GST_OBJECT_LOCK(self);
+	if ((req_name != NULL) && (sscanf(req_name, "src_%u", &index) == 1))
+	{
+		if (index >= self->next_src_pad_index)
+			self->next_src_pad_index = index + 1;
+	}
+	else
+		index = self->next_src_pad_index++;
+	GST_OBJECT_UNLOCK(self);
+
+	name = g_strdup_printf("src_%u", index);
+	srcpad = GST_PAD_CAST(g_object_new(
+		GST_TYPE_IMX_2D_MULTI_SCALER_SRC_PAD,
+		"name", name,
+		"direction", templ->direction,
+		"template", templ,
+		NULL
+	));
+	g_free(name);
+
+	if (G_UNLIKELY(GST_IMX_2D_MULTI_SCALER_SRC_PAD(srcpad)->output_surface == NULL))
+	{
+		GST_ERROR_OBJECT(self, "new request pad has no imx2d output surface");
+		gst_object_unref(GST_OBJECT(srcpad));
+		return NULL;
+	}
+
+	gst_pad_set_event_function(srcpad, GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_src_event));
+	gst_pad_set_query_function(srcpad, GST_DEBUG_FUNCPTR(gst_imx_2d_multi_scaler_src_query));
+
+	/* Activate the pad if we are already streaming, since otherwise,
+	 * the sticky events below could not be stored in it. */
+	if (GST_STATE(self) > GST_STATE_READY)
+		gst_pad_set_active(srcpad, TRUE);
+
+	GST_PAD_STREAM_LOCK(self->sinkpad);
+	gst_flow_combiner_add_pad(self->flow_combiner, srcpad);
+	/* Give the new pad the stream-start, tag, etc. events the
+	 * other pads already got. The segment follows once the
+	 * pad's caps were pushed. */
+	gst_pad_sticky_events_foreach(self->sinkpad, gst_imx_2d_multi_scaler_forward_sticky_event, srcpad);
+	GST_PAD_STREAM_UNLOCK(self->sinkpad);
+
+	if (!gst_element_add_pad(element, srcpad))
+	{
+		GST_ERROR_OBJECT(self, "could not add new request pad %s", GST_PAD_NAME(srcpad));
+
+		GST_PAD_STREAM_LOCK(self->sinkpad);
+		gst_flow_combiner_remove_pad(self->flow_combiner, srcpad);
+		GST_PAD_STREAM_UNLOCK(self->sinkpad);
+
+		gst_pad_set_active(srcpad, FALSE);
+		gst_object_unref(GST_OBJECT(srcpad));
+		return NULL;
+	}
+
+	GST_DEBUG_OBJECT(self, "created and added new request pad %s:%s", GST_DEBUG_PAD_NAME(srcpad));
+
+	return srcpad;
+}
+
+
+static void gst_imx_2d_multi_scaler_release_pad(GstElement *element, GstPad *pad)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(element);
+
+	GST_DEBUG_OBJECT(self, "releasing request pad %s:%s", GST_DEBUG_PAD_NAME(pad));
+
+	/* Deactivate the pad first, so that pushes into it return
+	 * GST_FLOW_FLUSHING instead of waiting for downstream. Then
+	 * take the stream lock to make sure the chain function is
+	 * not using the pad's pool and blit plan while they are
+	 * discarded. */
+	gst_pad_set_active(pad, FALSE);
+
+	GST_PAD_STREAM_LOCK(self->sinkpad);
+	gst_flow_combiner_remove_pad(self->flow_combiner, pad);
+	gst_imx_2d_multi_scaler_src_pad_reset_negotiation(GST_IMX_2D_MULTI_SCALER_SRC_PAD(pad));
+	GST_PAD_STREAM_UNLOCK(self->sinkpad);
+
+	gst_element_remove_pad(element, pad);
+}
+
+
+static void gst_imx_2d_multi_scaler_set_context(GstElement *element, GstContext *context)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(element);
+	GstImx2dMultiScalerClass *klass = GST_IMX_2D_MULTI_SCALER_CLASS(G_OBJECT_GET_CLASS(self));
+	gboolean accept_shared_blitter;
+
+	/* Only pick up a shared blitter from the context if this element
+	 * is actually configured to use one and has no blitter yet.
+	 * Otherwise, it would lock (and later unref) a blitter that
+	 * is not the one it is actually blitting with. */
+	GST_OBJECT_LOCK(self);
+	accept_shared_blitter = self->use_shared_blitter && (self->blitter == NULL);
+	GST_OBJECT_UNLOCK(self);
+
+	if (accept_shared_blitter)
+		gst_imx_2d_shared_blitter_handle_set_context(element, context, klass->shared_blitter_backend_name, &(self->shared_blitter));
+
+	GST_ELEMENT_CLASS(gst_imx_2d_multi_scaler_parent_class)->set_context(element, context);
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(parent);
+
+	switch (GST_EVENT_TYPE(event))
+	{
+		case GST_EVENT_CAPS:
+		{
+			GstCaps *caps;
+			gboolean ret;
+
+			/* The input caps are not forwarded. Instead, each
+			 * linked src pad negotiates and pushes its own caps
+			 * right away, so that downstream gets them before
+			 * the segment. */
+			gst_event_parse_caps(event, &caps);
+			ret = gst_imx_2d_multi_scaler_set_input_caps(self, caps);
+			gst_event_unref(event);
+
+			if (ret)
+				gst_pad_forward(pad, gst_imx_2d_multi_scaler_negotiate_linked_src_pad, self);
+
+			return ret;
+		}
+
+		case GST_EVENT_SEGMENT:
+		{
+			GstSegment const *segment;
+
+			gst_event_parse_segment(event, &segment);
+
+			if (segment->format != GST_FORMAT_TIME)
+				GST_WARNING_OBJECT(self, "segment format is %s instead of TIME; QoS will not work", gst_format_get_name(segment->format));
+
+			gst_segment_copy_into(segment, &(self->segment));
+
+			/* Only forward the segment to src pads that already
+			 * pushed their caps, since the segment must not
+			 * arrive downstream before the caps do. */
+			gst_pad_forward(pad, gst_imx_2d_multi_scaler_push_segment, event);
+			gst_event_unref(event);
+
+			return TRUE;
+		}
+
+		case GST_EVENT_FLUSH_STOP:
+		{
+			gst_segment_init(&(self->segment), GST_FORMAT_UNDEFINED);
+			gst_flow_combiner_reset(self->flow_combiner);
+			gst_imx_2d_multi_scaler_reset_src_pads(self, FALSE);
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	/* Forward all other events to all src pads. */
+	return gst_pad_event_default(pad, parent, event);
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_sink_query(GstPad *pad, GstObject *parent, GstQuery *query)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(parent);
+
+	switch (GST_QUERY_TYPE(query))
+	{
+		case GST_QUERY_CAPS:
+		{
+			GstCaps *filter, *caps;
+
+			/* The outputs are scaled and converted independently
+			 * of each other, so the input caps do not depend on
+			 * the caps of the src pads. */
+
+			gst_query_parse_caps(query, &filter);
+
+			caps = gst_pad_get_pad_template_caps(pad);
+
+			if (filter != NULL)
+			{
+				GstCaps *unfiltered_caps = caps;
+				caps = gst_caps_intersect_full(filter, unfiltered_caps, GST_CAPS_INTERSECT_FIRST);
+				gst_caps_unref(unfiltered_caps);
+			}
+
+			gst_query_set_caps_result(query, caps);
+			gst_caps_unref(caps);
+
+			return TRUE;
+		}
+
+		case GST_QUERY_ALLOCATION:
+		{
+			/* Let upstream know that we can handle GstVideoMeta and GstVideoCropMeta.
+			 * Overlay compositions are not rendered, so we do not add that meta. */
+			gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, 0);
+			gst_query_add_allocation_meta(query, GST_VIDEO_CROP_META_API_TYPE, 0);
+			return TRUE;
+		}
+
+		case GST_QUERY_CONTEXT:
+		{
+			if (gst_imx_2d_multi_scaler_handle_context_query(self, query))
+				return TRUE;
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	return gst_pad_query_default(pad, parent, query);
+}
+
+
+static GstFlowReturn gst_imx_2d_multi_scaler_chain(G_GNUC_UNUSED GstPad *pad, GstObject *parent, GstBuffer *input_buffer)
+{
+	Imx2dBlitParams blit_params;
+	GstFlowReturn flow_ret = GST_FLOW_OK;
+	GstFlowReturn combined_flow_ret = GST_FLOW_OK;
+	gboolean input_crop;
+	Imx2dRegion crop_rectangle;
+	GList *srcpads = NULL;
+	GList *l;
+	guint num_frames_to_render = 0;
+	GstBuffer *uploaded_input_buffer = NULL;
+	gboolean blitter_locked = FALSE;
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(parent);
+
+	/* Initial checks. */
+
+	if (G_UNLIKELY(!self->input_video_info_set))
+	{
+		GST_ELEMENT_ERROR(self, CORE, NEGOTIATION, (NULL), ("unknown format"));
+		gst_buffer_unref(input_buffer);
+		return GST_FLOW_NOT_NEGOTIATED;
+	}
+
+	if (!gst_imx_2d_check_input_buffer_structure(input_buffer, GST_VIDEO_INFO_N_PLANES(&(self->input_video_info))))
+	{
+		gst_buffer_unref(input_buffer);
+		return GST_FLOW_ERROR;
+	}
+
+
+	/* Create local copies of the property values and the src pad
+	 * list so that we can use them without risking race conditions
+	 * if another thread is setting new values or requesting new
+	 * pads while this function is running. Released pads are
+	 * not an issue, since release_pad() takes the stream lock. */
+	GST_OBJECT_LOCK(self);
+	input_crop = self->input_crop;
+	for (l = GST_ELEMENT(self)->srcpads; l != NULL; l = l->next)
+		srcpads = g_list_prepend(srcpads, gst_object_ref(GST_OBJECT(l->data)));
+	GST_OBJECT_UNLOCK(self);
+
+	srcpads = g_list_reverse(srcpads);
+
+	if (srcpads == NULL)
+	{
+		GST_LOG_OBJECT(self, "there are no src pads; discarding input buffer");
+		flow_ret = gst_flow_combiner_update_flow(self->flow_combiner, GST_FLOW_NOT_LINKED);
+		goto finish;
+	}
+
+
+	/* Find out which src pads need an output frame, and
+	 * (re)negotiate and acquire output buffers for them. */
+
+	for (l = srcpads; l != NULL; l = l->next)
+	{
+		GstImx2dMultiScalerSrcPad *srcpad = GST_IMX_2D_MULTI_SCALER_SRC_PAD(l->data);
+		GstFlowReturn pad_flow_ret;
+
+		srcpad->render_frame = FALSE;
+
+		if (!gst_pad_is_linked(GST_PAD(srcpad)))
+		{
+			GST_LOG_OBJECT(self, "pad %s:%s is not linked; skipping", GST_DEBUG_PAD_NAME(srcpad));
+			combined_flow_ret = gst_flow_combiner_update_pad_flow(self->flow_combiner, GST_PAD(srcpad), GST_FLOW_NOT_LINKED);
+			continue;
+		}
+
+		if (gst_pad_check_reconfigure(GST_PAD(srcpad)) || !srcpad->negotiated)
+		{
+			if (!gst_imx_2d_multi_scaler_negotiate_src_pad(self, srcpad))
+			{
+				pad_flow_ret = GST_PAD_IS_FLUSHING(srcpad) ? GST_FLOW_FLUSHING : GST_FLOW_NOT_NEGOTIATED;
+				if (pad_flow_ret == GST_FLOW_NOT_NEGOTIATED)
+					gst_pad_mark_reconfigure(GST_PAD(srcpad));
+				combined_flow_ret = gst_flow_combiner_update_pad_flow(self->flow_combiner, GST_PAD(srcpad), pad_flow_ret);
+				continue;
+			}
+		}
+
+		if (!gst_imx_2d_multi_scaler_check_qos(self, srcpad, input_buffer))
+			continue;
+
+		pad_flow_ret = gst_buffer_pool_acquire_buffer(
+			gst_imx_video_buffer_pool_get_output_video_buffer_pool(srcpad->video_buffer_pool),
+			&(srcpad->output_buffer),
+			NULL
+		);
+		if (G_UNLIKELY(pad_flow_ret != GST_FLOW_OK))
+		{
+			GST_ERROR_OBJECT(self, "could not acquire output buffer for pad %s:%s: %s", GST_DEBUG_PAD_NAME(srcpad), gst_flow_get_name(pad_flow_ret));
+			combined_flow_ret = gst_flow_combiner_update_pad_flow(self->flow_combiner, GST_PAD(srcpad), pad_flow_ret);
+			continue;
+		}
+
+		/* Acquire an intermediate buffer from the internal DMA buffer pool.
+		 * See gst_imx_2d_video_transform_transform_frame() for details. */
+		pad_flow_ret = gst_imx_video_buffer_pool_acquire_intermediate_buffer(srcpad->video_buffer_pool, srcpad->output_buffer, &(srcpad->intermediate_buffer));
+		if (G_UNLIKELY(pad_flow_ret != GST_FLOW_OK))
+		{
+			gst_buffer_replace(&(srcpad->output_buffer), NULL);
+			combined_flow_ret = gst_flow_combiner_update_pad_flow(self->flow_combiner, GST_PAD(srcpad), pad_flow_ret);
+			continue;
+		}
+
+		gst_imx_2d_assign_output_buffer_to_surface(srcpad->output_surface, srcpad->intermediate_buffer, &(srcpad->output_video_info));
+
+		srcpad->render_frame = TRUE;
+		num_frames_to_render++;
+	}
+
+	if (num_frames_to_render == 0)
+	{
+		GST_LOG_OBJECT(self, "no src pad needs this frame; skipping upload and blits");
+		flow_ret = combined_flow_ret;
+		goto finish;
+	}
+
+
+	/* Upload the input buffer once for all outputs. See
+	 * gst_imx_2d_video_transform_transform_frame() for details. */
+
+	flow_ret = gst_imx_video_uploader_perform(self->uploader, input_buffer, &uploaded_input_buffer);
+	if (G_UNLIKELY(flow_ret != GST_FLOW_OK))
+		goto error;
+
+	gst_imx_2d_assign_input_buffer_to_surface(
+		uploaded_input_buffer,
+		self->input_surface,
+		&(self->input_surface_desc),
+		&(self->input_video_info)
+	);
+
+	imx_2d_surface_set_desc(self->input_surface, &(self->input_surface_desc));
+
+
+	/* Fill the blit parameters. These are the same for all outputs. */
+
+	memset(&blit_params, 0, sizeof(blit_params));
+	blit_params.source_region = NULL;
+	blit_params.dest_region = NULL;
+	blit_params.rotation = IMX_2D_ROTATION_NONE;
+	blit_params.alpha = 255;
+
+	if (input_crop)
+	{
+		GstVideoCropMeta *crop_meta = gst_buffer_get_video_crop_meta(input_buffer);
+
+		if (crop_meta != NULL)
+		{
+			crop_rectangle.x1 = crop_meta->x;
+			crop_rectangle.y1 = crop_meta->y;
+			crop_rectangle.x2 = crop_meta->x + crop_meta->width;
+			crop_rectangle.y2 = crop_meta->y + crop_meta->height;
+
+			blit_params.source_region = &crop_rectangle;
+
+			GST_LOG_OBJECT(
+				self,
+				"using crop rectangle (%d, %d) - (%d, %d)",
+				crop_rectangle.x1, crop_rectangle.y1,
+				crop_rectangle.x2, crop_rectangle.y2
+			);
+		}
+	}
+
+
+	/* Render all outputs. Each output is one blitter sequence, since
+	 * sequences have one destination surface. All sequences are
+	 * finished asynchronously and waited for afterwards, so that
+	 * backends with asynchronous finish (like G2D) can process
+	 * them back to back. The blitter is locked only once for all
+	 * of them, so other elements that use a shared blitter cannot
+	 * get in between. */
+
+	GST_LOG_OBJECT(self, "rendering %u output frame(s)", num_frames_to_render);
+
+	gst_imx_2d_shared_blitter_lock(self->shared_blitter, &(self->stats_tracker));
+	blitter_locked = TRUE;
+
+	for (l = srcpads; l != NULL; l = l->next)
+	{
+		GstImx2dMultiScalerSrcPad *srcpad = GST_IMX_2D_MULTI_SCALER_SRC_PAD(l->data);
+
+		if (!srcpad->render_frame)
+			continue;
+
+		if (!imx_2d_blitter_start(self->blitter, srcpad->output_surface))
+		{
+			GST_ERROR_OBJECT(self, "starting blitter failed");
+			goto error;
+		}
+
+		if (!gst_imx_2d_blit_with_plan(self->blitter, &(srcpad->blit_plan), self->input_surface, srcpad->output_surface, &blit_params))
+		{
+			GST_ERROR_OBJECT(self, "blitting failed");
+			/* Still end the sequence, to not leave the blitter
+			 * in a started state. The fence is waited for
+			 * in the error cleanup below. */
+			imx_2d_blitter_finish_async(self->blitter, &(srcpad->fence));
+			goto error;
+		}
+
+		if (!imx_2d_blitter_finish_async(self->blitter, &(srcpad->fence)))
+		{
+			GST_ERROR_OBJECT(self, "finishing blitter failed");
+			goto error;
+		}
+	}
+
+	gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
+	blitter_locked = FALSE;
+
+
+	/* Wait for the blits, transfer the pixels to the output buffers
+	 * if necessary, and push the output buffers downstream. */
+
+	for (l = srcpads; l != NULL; l = l->next)
+	{
+		GstImx2dMultiScalerSrcPad *srcpad = GST_IMX_2D_MULTI_SCALER_SRC_PAD(l->data);
+		gboolean fence_ok;
+		GstFlowReturn pad_flow_ret;
+
+		if (!srcpad->render_frame)
+			continue;
+
+		fence_ok = imx_2d_fence_wait(srcpad->fence);
+		imx_2d_fence_unref(srcpad->fence);
+		srcpad->fence = NULL;
+
+		if (!fence_ok)
+		{
+			GST_ERROR_OBJECT(self, "blitter sequence for pad %s:%s failed", GST_DEBUG_PAD_NAME(srcpad));
+			goto error;
+		}
+
+		/* See gst_imx_2d_video_transform_transform_frame() for details
+		 * about the intermediate buffer. This consumes the intermediate
+		 * buffer's reference. */
+		if (!gst_imx_video_buffer_pool_transfer_to_output_buffer(srcpad->video_buffer_pool, srcpad->intermediate_buffer, srcpad->output_buffer))
+		{
+			GST_ERROR_OBJECT(self, "could not transfer intermediate buffer contents to output buffer of pad %s:%s", GST_DEBUG_PAD_NAME(srcpad));
+			srcpad->intermediate_buffer = NULL;
+			goto error;
+		}
+
+		srcpad->intermediate_buffer = NULL;
+		srcpad->render_frame = FALSE;
+
+		gst_imx_2d_multi_scaler_copy_metadata(input_buffer, srcpad->output_buffer);
+
+		GST_OBJECT_LOCK(srcpad);
+		srcpad->num_processed++;
+		GST_OBJECT_UNLOCK(srcpad);
+
+		GST_LOG_OBJECT(self, "pushing output buffer %" GST_PTR_FORMAT " to pad %s:%s", (gpointer)(srcpad->output_buffer), GST_DEBUG_PAD_NAME(srcpad));
+
+		pad_flow_ret = gst_pad_push(GST_PAD(srcpad), srcpad->output_buffer);
+		srcpad->output_buffer = NULL;
+
+		combined_flow_ret = gst_flow_combiner_update_pad_flow(self->flow_combiner, GST_PAD(srcpad), pad_flow_ret);
+	}
+
+	flow_ret = combined_flow_ret;
+
+	GST_LOG_OBJECT(self, "multi scaler frame processing complete; combined flow return: %s", gst_flow_get_name(flow_ret));
+
+
+finish:
+	if (blitter_locked)
+		gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
+
+	/* Clean up the per-frame state of src pads that did not
+	 * get their frames pushed because of an error. Pending
+	 * sequences have to finish before their buffers can go. */
+	for (l = srcpads; l != NULL; l = l->next)
+	{
+		GstImx2dMultiScalerSrcPad *srcpad = GST_IMX_2D_MULTI_SCALER_SRC_PAD(l->data);
+
+		if (srcpad->fence != NULL)
+		{
+			imx_2d_fence_wait(srcpad->fence);
+			imx_2d_fence_unref(srcpad->fence);
+			srcpad->fence = NULL;
+		}
+
+		gst_buffer_replace(&(srcpad->intermediate_buffer), NULL);
+		gst_buffer_replace(&(srcpad->output_buffer), NULL);
+		srcpad->render_frame = FALSE;
+	}
+
+	g_list_free_full(srcpads, (GDestroyNotify)gst_object_unref);
+
+	/* Discard the uploaded version of the input buffer. */
+	if (uploaded_input_buffer != NULL)
+		gst_buffer_unref(uploaded_input_buffer);
+	gst_buffer_unref(input_buffer);
+
+	return flow_ret;
+
+error:
+	if (flow_ret == GST_FLOW_OK)
+		flow_ret = GST_FLOW_ERROR;
+	goto finish;
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_src_event(GstPad *pad, GstObject *parent, GstEvent *event)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(parent);
+
+	switch (GST_EVENT_TYPE(event))
+	{
+		case GST_EVENT_QOS:
+		{
+			GstImx2dMultiScalerSrcPad *srcpad = GST_IMX_2D_MULTI_SCALER_SRC_PAD(pad);
+			GstQOSType type;
+			gdouble proportion;
+			GstClockTimeDiff diff;
+			GstClockTime timestamp;
+
+			gst_event_parse_qos(event, &type, &proportion, &diff, &timestamp);
+
+			GST_LOG_OBJECT(
+				self,
+				"got QoS event on pad %s:%s: proportion %f diff %" G_GINT64_FORMAT " timestamp %" GST_TIME_FORMAT,
+				GST_DEBUG_PAD_NAME(pad),
+				proportion,
+				diff,
+				GST_TIME_ARGS(timestamp)
+			);
+
+			/* Like GstBaseTransform, ignore throttling requests. */
+			if (type != GST_QOS_TYPE_THROTTLE)
+			{
+				GST_OBJECT_LOCK(srcpad);
+				srcpad->proportion = proportion;
+				srcpad->earliest_time = timestamp + diff;
+				GST_OBJECT_UNLOCK(srcpad);
+			}
+
+			/* The QoS event is not forwarded upstream, since it only
+			 * concerns this src pad. Upstream dropping frames because
+			 * one branch is late would starve the other branches. */
+			gst_event_unref(event);
+			return TRUE;
+		}
+
+		default:
+			break;
+	}
+
+	return gst_pad_event_default(pad, parent, event);
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_src_query(GstPad *pad, GstObject *parent, GstQuery *query)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(parent);
+
+	switch (GST_QUERY_TYPE(query))
+	{
+		case GST_QUERY_CAPS:
+		{
+			GstCaps *filter, *caps;
+
+			gst_query_parse_caps(query, &filter);
+			caps = gst_imx_2d_multi_scaler_get_src_caps(self, pad, filter);
+			gst_query_set_caps_result(query, caps);
+			gst_caps_unref(caps);
+
+			return TRUE;
+		}
+
+		case GST_QUERY_CONTEXT:
+		{
+			if (gst_imx_2d_multi_scaler_handle_context_query(self, query))
+				return TRUE;
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	return gst_pad_query_default(pad, parent, query);
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_start(GstImx2dMultiScaler *self)
+{
+	GstImx2dMultiScalerClass *klass = GST_IMX_2D_MULTI_SCALER_CLASS(G_OBJECT_GET_CLASS(self));
+
+	self->input_video_info_set = FALSE;
+
+	self->imx_dma_buffer_allocator = gst_imx_allocator_new();
+	if (self->imx_dma_buffer_allocator == NULL)
+	{
+		GST_ERROR_OBJECT(self, "creating DMA buffer allocator failed");
+		goto error;
+	}
+
+	self->uploader = gst_imx_video_uploader_new(self->imx_dma_buffer_allocator, klass->hardware_capabilities->stride_alignment, klass->hardware_capabilities->total_row_count_alignment);
+	if (self->uploader == NULL)
+	{
+		GST_ERROR_OBJECT(self, "creating DMA video uploader failed");
+		goto error;
+	}
+
+	if ((klass->start != NULL) && !(klass->start(self)))
+	{
+		GST_ERROR_OBJECT(self, "start() failed");
+		goto error;
+	}
+
+	if (!gst_imx_2d_multi_scaler_create_blitter(self))
+	{
+		GST_ERROR_OBJECT(self, "creating blitter failed");
+		goto error;
+	}
+
+	self->input_surface = imx_2d_surface_create(NULL);
+	if (self->input_surface == NULL)
+	{
+		GST_ERROR_OBJECT(self, "creating input surface failed");
+		goto error;
+	}
+
+	return TRUE;
+
+error:
+	gst_imx_2d_multi_scaler_stop(self);
+	return FALSE;
+}
+
+
+static void gst_imx_2d_multi_scaler_stop(GstImx2dMultiScaler *self)
+{
+	GstImx2dMultiScalerClass *klass = GST_IMX_2D_MULTI_SCALER_CLASS(G_OBJECT_GET_CLASS(self));
+	GstImx2dSharedBlitter *shared_blitter;
+
+	if ((klass->stop != NULL) && !(klass->stop(self)))
+		GST_ERROR_OBJECT(self, "stop() failed");
+
+	/* The blit plans must be gone before the blitter is destroyed. */
+	gst_imx_2d_multi_scaler_reset_src_pads(self, TRUE);
+
+	if (self->input_surface != NULL)
+	{
+		imx_2d_surface_destroy(self->input_surface);
+		self->input_surface = NULL;
+	}
+
+	if (self->owns_blitter && (self->blitter != NULL))
+		imx_2d_blitter_destroy(self->blitter);
+	self->blitter = NULL;
+	self->owns_blitter = FALSE;
+
+	/* If the blitter came from the shared blitter, the latter
+	 * destroys it once no one uses it anymore. */
+	GST_OBJECT_LOCK(self);
+	shared_blitter = self->shared_blitter;
+	self->shared_blitter = NULL;
+	GST_OBJECT_UNLOCK(self);
+
+	if (shared_blitter != NULL)
+		gst_object_unref(GST_OBJECT(shared_blitter));
+
+	if (self->uploader != NULL)
+	{
+		gst_object_unref(GST_OBJECT(self->uploader));
+		self->uploader = NULL;
+	}
+
+	if (self->imx_dma_buffer_allocator != NULL)
+	{
+		gst_object_unref(GST_OBJECT(self->imx_dma_buffer_allocator));
+		self->imx_dma_buffer_allocator = NULL;
+	}
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_create_blitter(GstImx2dMultiScaler *self)
+{
+	GstImx2dMultiScalerClass *klass = GST_IMX_2D_MULTI_SCALER_CLASS(G_OBJECT_GET_CLASS(self));
+	gboolean use_shared_blitter;
+
+	g_assert(klass->create_blitter != NULL);
+	g_assert(self->blitter == NULL);
+
+	GST_OBJECT_LOCK(self);
+	use_shared_blitter = self->use_shared_blitter;
+	GST_OBJECT_UNLOCK(self);
+
+	if (use_shared_blitter && (klass->shared_blitter_backend_name == NULL))
+	{
+		GST_WARNING_OBJECT(self, "shared blitters are not supported by this element; creating own blitter");
+		use_shared_blitter = FALSE;
+	}
+
+	if (use_shared_blitter)
+	{
+		if (!gst_imx_2d_shared_blitter_ensure(GST_ELEMENT(self), klass->shared_blitter_backend_name, &(self->shared_blitter), gst_imx_2d_multi_scaler_create_blitter_for_sharing, self))
+			return FALSE;
+
+		self->blitter = gst_imx_2d_shared_blitter_get_blitter(self->shared_blitter);
+		self->owns_blitter = FALSE;
+		GST_DEBUG_OBJECT(self, "using shared blitter %" GST_PTR_FORMAT, (gpointer)(self->shared_blitter));
+	}
+	else
+	{
+		GstImx2dSharedBlitter *stale_shared_blitter;
+
+		/* Drop any shared blitter that got stored before sharing
+		 * was disabled, so the lock/unlock calls become no-ops. */
+		GST_OBJECT_LOCK(self);
+		stale_shared_blitter = self->shared_blitter;
+		self->shared_blitter = NULL;
+		GST_OBJECT_UNLOCK(self);
+
+		if (stale_shared_blitter != NULL)
+			gst_object_unref(GST_OBJECT(stale_shared_blitter));
+
+		if (G_UNLIKELY((self->blitter = klass->create_blitter(self)) == NULL))
+		{
+			GST_ERROR_OBJECT(self, "could not create blitter");
+			return FALSE;
+		}
+
+		self->owns_blitter = TRUE;
+		GST_DEBUG_OBJECT(self, "created new blitter %" GST_PTR_FORMAT, (gpointer)(self->blitter));
+	}
+
+	/* Other elements may be using a shared blitter right now. */
+	gst_imx_2d_shared_blitter_lock(self->shared_blitter, NULL);
+	gst_imx_2d_stats_tracker_attach(&(self->stats_tracker), self->blitter);
+	gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
+
+	return TRUE;
+}
+
+
+static Imx2dBlitter* gst_imx_2d_multi_scaler_create_blitter_for_sharing(gpointer user_data)
+{
+	GstImx2dMultiScaler *self = GST_IMX_2D_MULTI_SCALER(user_data);
+	GstImx2dMultiScalerClass *klass = GST_IMX_2D_MULTI_SCALER_CLASS(G_OBJECT_GET_CLASS(self));
+	return klass->create_blitter(self);
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_handle_context_query(GstImx2dMultiScaler *self, GstQuery *query)
+{
+	GstImx2dMultiScalerClass *klass = GST_IMX_2D_MULTI_SCALER_CLASS(G_OBJECT_GET_CLASS(self));
+	GstImx2dSharedBlitter *shared_blitter;
+	gboolean ret;
+
+	GST_OBJECT_LOCK(self);
+	shared_blitter = (self->shared_blitter != NULL) ? gst_object_ref(self->shared_blitter) : NULL;
+	GST_OBJECT_UNLOCK(self);
+
+	ret = gst_imx_2d_shared_blitter_handle_context_query(GST_ELEMENT(self), query, klass->shared_blitter_backend_name, shared_blitter);
+
+	if (shared_blitter != NULL)
+		gst_object_unref(GST_OBJECT(shared_blitter));
+
+	return ret;
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_set_input_caps(GstImx2dMultiScaler *self, GstCaps *input_caps)
+{
+	GstVideoInfo input_video_info;
+	GstImx2dTileLayout input_video_tile_layout;
+
+	g_assert(self->blitter != NULL);
+
+	GST_DEBUG_OBJECT(self, "setting input caps: %" GST_PTR_FORMAT, (gpointer)input_caps);
+
+	if (!gst_imx_video_info_from_caps(&input_video_info, input_caps, &input_video_tile_layout, NULL))
+	{
+		GST_ERROR_OBJECT(self, "cannot convert input caps to video info; input caps: %" GST_PTR_FORMAT, (gpointer)input_caps);
+		return FALSE;
+	}
+
+	if (!gst_imx_video_uploader_set_input_video_info(self->uploader, &input_video_info))
+	{
+		GST_ERROR_OBJECT(self, "could not configure uploader with new caps / video info");
+		return FALSE;
+	}
+
+	/* Fill the input surface description with values that can't change
+	 * in between buffers. (Plane stride and offset values can change.
+	 * This is unlikely to happen, but it is not impossible.) */
+	self->input_surface_desc.width = GST_VIDEO_INFO_WIDTH(&input_video_info);
+	self->input_surface_desc.height = GST_VIDEO_INFO_HEIGHT(&input_video_info);
+	self->input_surface_desc.format = gst_imx_2d_convert_from_gst_video_format(GST_VIDEO_INFO_FORMAT(&input_video_info), &input_video_tile_layout);
+	gst_imx_2d_set_surface_desc_colorimetry(&(self->input_surface_desc), &input_video_info);
+
+	GST_OBJECT_LOCK(self);
+	self->input_video_info = input_video_info;
+	self->input_video_info_set = TRUE;
+	GST_OBJECT_UNLOCK(self);
+
+	/* The output caps are fixated based on the input size, pixel
+	 * aspect ratio, and frame rate, so renegotiate all src pads. */
+	gst_imx_2d_multi_scaler_reset_src_pads(self, TRUE);
+
+	return TRUE;
+}
+
+
+static GstCaps* gst_imx_2d_multi_scaler_get_src_caps(GstImx2dMultiScaler *self, GstPad *srcpad, GstCaps *filter)
+{
+	GstCaps *caps;
+
+	caps = gst_pad_get_pad_template_caps(srcpad);
+
+	/* Size and format can be freely chosen for each output,
+	 * but the frame rate is always that of the input. */
+	GST_OBJECT_LOCK(self);
+	if (self->input_video_info_set)
+	{
+		caps = gst_caps_make_writable(caps);
+		gst_caps_set_simple(
+			caps,
+			"framerate", GST_TYPE_FRACTION,
+			GST_VIDEO_INFO_FPS_N(&(self->input_video_info)),
+			GST_VIDEO_INFO_FPS_D(&(self->input_video_info)),
+			NULL
+		);
+	}
+	GST_OBJECT_UNLOCK(self);
+
+	if (filter != NULL)
+	{
+		GstCaps *unfiltered_caps = caps;
+		caps = gst_caps_intersect_full(filter, unfiltered_caps, GST_CAPS_INTERSECT_FIRST);
+		gst_caps_unref(unfiltered_caps);
+	}
+
+	return caps;
+}
+
+
+static GstCaps* gst_imx_2d_multi_scaler_fixate_src_caps(GstImx2dMultiScaler *self, GstCaps *caps)
+{
+	GstVideoInfo const *input_video_info = &(self->input_video_info);
+	GstStructure *structure;
+	gint in_dar_n, in_dar_d;
+	gint par_n = 1, par_d = 1;
+	gint width = 0, height = 0;
+	gboolean width_fixed, height_fixed;
+	gint num, den;
+
+	GST_DEBUG_OBJECT(self, "trying to fixate output caps %" GST_PTR_FORMAT, (gpointer)caps);
+
+	caps = gst_caps_truncate(caps);
+	caps = gst_caps_make_writable(caps);
+	structure = gst_caps_get_structure(caps, 0);
+
+	/* Prefer the input format to avoid needless color space conversions. */
+	if (gst_structure_has_field(structure, "format"))
+		gst_structure_fixate_field_string(structure, "format", gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(input_video_info)));
+
+	/* Missing PAR on the output means square pixels. */
+	if (gst_structure_has_field(structure, "pixel-aspect-ratio"))
+		gst_structure_fixate_field_nearest_fraction(structure, "pixel-aspect-ratio", 1, 1);
+	else
+		gst_structure_set(structure, "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1, NULL);
+	gst_structure_get_fraction(structure, "pixel-aspect-ratio", &par_n, &par_d);
+
+	/* Pick a width and/or height that keeps the display aspect
+	 * ratio of the input. If downstream fixed both, use them. */
+	width_fixed = gst_structure_get_int(structure, "width", &width);
+	height_fixed = gst_structure_get_int(structure, "height", &height);
+
+	if (!gst_util_fraction_multiply(
+		GST_VIDEO_INFO_WIDTH(input_video_info), GST_VIDEO_INFO_HEIGHT(input_video_info),
+		GST_VIDEO_INFO_PAR_N(input_video_info), GST_VIDEO_INFO_PAR_D(input_video_info),
+		&in_dar_n, &in_dar_d
+	))
+	{
+		GST_WARNING_OBJECT(self, "could not calculate input display aspect ratio - integer overflow");
+		in_dar_n = in_dar_d = 0;
+	}
+
+	if ((in_dar_n > 0) && (in_dar_d > 0))
+	{
+		if (!width_fixed && !height_fixed)
+		{
+			gst_structure_fixate_field_nearest_int(structure, "width", GST_VIDEO_INFO_WIDTH(input_video_info));
+			width_fixed = gst_structure_get_int(structure, "width", &width);
+		}
+
+		if (width_fixed && !height_fixed)
+		{
+			/* height = width * PAR / DAR */
+			if (gst_util_fraction_multiply(in_dar_d, in_dar_n, par_n, par_d, &num, &den))
+				gst_structure_fixate_field_nearest_int(structure, "height", (gint)gst_util_uint64_scale_int(width, num, den));
+		}
+		else if (!width_fixed && height_fixed)
+		{
+			/* width = height * DAR / PAR */
+			if (gst_util_fraction_multiply(in_dar_n, in_dar_d, par_d, par_n, &num, &den))
+				gst_structure_fixate_field_nearest_int(structure, "width", (gint)gst_util_uint64_scale_int(height, num, den));
+		}
+	}
+
+	if (gst_structure_has_field(structure, "framerate"))
+		gst_structure_fixate_field_nearest_fraction(structure, "framerate", GST_VIDEO_INFO_FPS_N(input_video_info), GST_VIDEO_INFO_FPS_D(input_video_info));
+
+	caps = gst_caps_fixate(caps);
+
+	GST_DEBUG_OBJECT(self, "fixated output caps to %" GST_PTR_FORMAT, (gpointer)caps);
+
+	return caps;
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_negotiate_src_pad(GstImx2dMultiScaler *self, GstImx2dMultiScalerSrcPad *srcpad)
+{
+	guint i;
+	gint num_padding_rows;
+	GstCaps *src_caps;
+	GstCaps *peer_caps;
+	GstCaps *output_caps = NULL;
+	GstQuery *query = NULL;
+	GstEvent *segment_event;
+	GstVideoInfo output_video_info;
+	Imx2dSurfaceDesc output_surface_desc;
+	gboolean ret = FALSE;
+
+	g_assert(self->blitter != NULL);
+
+	gst_imx_2d_multi_scaler_src_pad_reset_negotiation(srcpad);
+
+	/* Ask downstream what it can handle, and pick the caps
+	 * that are closest to the input frames. */
+
+	src_caps = gst_imx_2d_multi_scaler_get_src_caps(self, GST_PAD(srcpad), NULL);
+	peer_caps = gst_pad_peer_query_caps(GST_PAD(srcpad), src_caps);
+	gst_caps_unref(src_caps);
+
+	GST_DEBUG_OBJECT(self, "pad %s:%s: downstream caps: %" GST_PTR_FORMAT, GST_DEBUG_PAD_NAME(srcpad), (gpointer)peer_caps);
+
+	if (gst_caps_is_empty(peer_caps))
+	{
+		GST_ERROR_OBJECT(self, "pad %s:%s: no caps are compatible with downstream", GST_DEBUG_PAD_NAME(srcpad));
+		gst_caps_unref(peer_caps);
+		goto finish;
+	}
+
+	output_caps = gst_imx_2d_multi_scaler_fixate_src_caps(self, peer_caps);
+
+	if (!gst_video_info_from_caps(&output_video_info, output_caps))
+	{
+		GST_ERROR_OBJECT(self, "pad %s:%s: cannot convert output caps to video info; output caps: %" GST_PTR_FORMAT, GST_DEBUG_PAD_NAME(srcpad), (gpointer)output_caps);
+		goto finish;
+	}
+
+	if (!gst_pad_push_event(GST_PAD(srcpad), gst_event_new_caps(output_caps)))
+	{
+		GST_ERROR_OBJECT(self, "pad %s:%s: downstream did not accept output caps %" GST_PTR_FORMAT, GST_DEBUG_PAD_NAME(srcpad), (gpointer)output_caps);
+		goto finish;
+	}
+
+	/* If this is the first time caps were pushed through this
+	 * pad, the segment was held back so far. Push it now. */
+	segment_event = gst_pad_get_sticky_event(GST_PAD(srcpad), GST_EVENT_SEGMENT, 0);
+	if (segment_event == NULL)
+	{
+		segment_event = gst_pad_get_sticky_event(self->sinkpad, GST_EVENT_SEGMENT, 0);
+		if (segment_event != NULL)
+			gst_pad_push_event(GST_PAD(srcpad), segment_event);
+	}
+	else
+		gst_event_unref(segment_event);
+
+	/* The stride values may require alignment according to the blitter's
+	 * capabilities. Adjust the output video's fields to match those. */
+	gst_imx_2d_align_output_video_info(&output_video_info, &num_padding_rows, imx_2d_blitter_get_hardware_capabilities(self->blitter));
+
+	memset(&output_surface_desc, 0, sizeof(output_surface_desc));
+	output_surface_desc.width = GST_VIDEO_INFO_WIDTH(&output_video_info);
+	output_surface_desc.height = GST_VIDEO_INFO_HEIGHT(&output_video_info);
+	output_surface_desc.format = gst_imx_2d_convert_from_gst_video_format(GST_VIDEO_INFO_FORMAT(&output_video_info), NULL);
+	gst_imx_2d_set_surface_desc_colorimetry(&output_surface_desc, &output_video_info);
+
+	for (i = 0; i < GST_VIDEO_INFO_N_PLANES(&output_video_info); ++i)
+		output_surface_desc.plane_strides[i] = GST_VIDEO_INFO_PLANE_STRIDE(&output_video_info, i);
+
+	output_surface_desc.num_padding_rows = num_padding_rows;
+
+	imx_2d_surface_set_desc(srcpad->output_surface, &output_surface_desc);
+
+	/* Set up the output buffer pool of this pad based
+	 * on what its downstream allocation query says. */
+
+	query = gst_query_new_allocation(output_caps, TRUE);
+	if (!gst_pad_peer_query(GST_PAD(srcpad), query))
+		GST_DEBUG_OBJECT(self, "pad %s:%s: downstream did not answer the allocation query; using defaults", GST_DEBUG_PAD_NAME(srcpad));
+
+	srcpad->video_buffer_pool = gst_imx_video_buffer_pool_new(
+		self->imx_dma_buffer_allocator,
+		query,
+		&output_video_info
+	);
+	if (srcpad->video_buffer_pool == NULL)
+	{
+		GST_ERROR_OBJECT(self, "pad %s:%s: could not create video buffer pool", GST_DEBUG_PAD_NAME(srcpad));
+		goto finish;
+	}
+
+	gst_object_ref_sink(srcpad->video_buffer_pool);
+
+	if (!gst_buffer_pool_set_active(gst_imx_video_buffer_pool_get_output_video_buffer_pool(srcpad->video_buffer_pool), TRUE))
+	{
+		GST_ERROR_OBJECT(self, "pad %s:%s: could not activate output video buffer pool", GST_DEBUG_PAD_NAME(srcpad));
+		gst_object_unref(GST_OBJECT(srcpad->video_buffer_pool));
+		srcpad->video_buffer_pool = NULL;
+		goto finish;
+	}
+
+	srcpad->output_video_info = output_video_info;
+	srcpad->negotiated = TRUE;
+
+	GST_DEBUG_OBJECT(self, "pad %s:%s: negotiated output caps %" GST_PTR_FORMAT, GST_DEBUG_PAD_NAME(srcpad), (gpointer)output_caps);
+
+	ret = TRUE;
+
+finish:
+	if (query != NULL)
+		gst_query_unref(query);
+	if (output_caps != NULL)
+		gst_caps_unref(output_caps);
+	return ret;
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_check_qos(GstImx2dMultiScaler *self, GstImx2dMultiScalerSrcPad *srcpad, GstBuffer *input_buffer)
+{
+	GstClockTime timestamp = GST_BUFFER_PTS(input_buffer);
+	GstClockTime running_time;
+	GstClockTime earliest_time;
+	gdouble proportion;
+	guint64 num_processed, num_dropped;
+	GstMessage *qos_message;
+
+	/* Returns FALSE if the frame would arrive too late downstream
+	 * of this src pad, in which case it is not rendered for this
+	 * pad. This mirrors the QoS handling in GstBaseTransform. */
+
+	if (!GST_CLOCK_TIME_IS_VALID(timestamp) || (self->segment.format != GST_FORMAT_TIME))
+		return TRUE;
+
+	running_time = gst_segment_to_running_time(&(self->segment), GST_FORMAT_TIME, timestamp);
+	if (!GST_CLOCK_TIME_IS_VALID(running_time))
+		return TRUE;
+
+	GST_OBJECT_LOCK(srcpad);
+
+	earliest_time = srcpad->earliest_time;
+	proportion = srcpad->proportion;
+
+	if (!GST_CLOCK_TIME_IS_VALID(earliest_time) || (running_time > earliest_time))
+	{
+		GST_OBJECT_UNLOCK(srcpad);
+		return TRUE;
+	}
+
+	srcpad->num_dropped++;
+	num_processed = srcpad->num_processed;
+	num_dropped = srcpad->num_dropped;
+
+	GST_OBJECT_UNLOCK(srcpad);
+
+	GST_DEBUG_OBJECT(
+		self,
+		"pad %s:%s: skipping frame since it would be too late: running time %" GST_TIME_FORMAT " earliest time %" GST_TIME_FORMAT,
+		GST_DEBUG_PAD_NAME(srcpad),
+		GST_TIME_ARGS(running_time),
+		GST_TIME_ARGS(earliest_time)
+	);
+
+	/* The src pad is the source of the QoS message, so
+	 * applications can tell which output dropped the frame. */
+	qos_message = gst_message_new_qos(
+		GST_OBJECT(srcpad),
+		FALSE,
+		running_time,
+		gst_segment_to_stream_time(&(self->segment), GST_FORMAT_TIME, timestamp),
+		timestamp,
+		GST_BUFFER_DURATION(input_buffer)
+	);
+	gst_message_set_qos_values(qos_message, GST_CLOCK_DIFF(running_time, earliest_time), proportion, 1000000);
+	gst_message_set_qos_stats(qos_message, GST_FORMAT_BUFFERS, num_processed, num_dropped);
+	gst_element_post_message(GST_ELEMENT(self), qos_message);
+
+	return FALSE;
+}
+
+
+static void gst_imx_2d_multi_scaler_reset_src_pads(GstImx2dMultiScaler *self, gboolean reset_negotiation)
+{
+	GList *l;
+	GList *video_buffer_pools = NULL;
+
+	/* Called with the sink pad's stream lock held, or
+	 * while the sink pad is inactive, so the src pads'
+	 * negotiation state is not in use. */
+
+	GST_OBJECT_LOCK(self);
+
+	for (l = GST_ELEMENT(self)->srcpads; l != NULL; l = l->next)
+	{
+		GstImx2dMultiScalerSrcPad *srcpad = GST_IMX_2D_MULTI_SCALER_SRC_PAD(l->data);
+
+		if (reset_negotiation)
+		{
+			GstImxVideoBufferPool *video_buffer_pool = gst_imx_2d_multi_scaler_src_pad_clear_negotiation(srcpad);
+			if (video_buffer_pool != NULL)
+				video_buffer_pools = g_list_prepend(video_buffer_pools, video_buffer_pool);
+		}
+		gst_imx_2d_multi_scaler_src_pad_reset_qos(srcpad);
+	}
+
+	GST_OBJECT_UNLOCK(self);
+
+	/* Release the pools only after the object lock
+	 * was released. See gst_imx_2d_multi_scaler_release_video_buffer_pool()
+	 * for the reason why. */
+	g_list_free_full(video_buffer_pools, (GDestroyNotify)gst_imx_2d_multi_scaler_release_video_buffer_pool);
+}
+
+
+static void gst_imx_2d_multi_scaler_copy_metadata(GstBuffer *input_buffer, GstBuffer *output_buffer)
+{
+	/* Copy PTS, DTS, duration, offset, offset-end
+	 * These do not change in the scaling operation */
+	GST_BUFFER_DTS(output_buffer) = GST_BUFFER_DTS(input_buffer);
+	GST_BUFFER_PTS(output_buffer) = GST_BUFFER_PTS(input_buffer);
+	GST_BUFFER_DURATION(output_buffer) = GST_BUFFER_DURATION(input_buffer);
+	GST_BUFFER_OFFSET(output_buffer) = GST_BUFFER_OFFSET(input_buffer);
+	GST_BUFFER_OFFSET_END(output_buffer) = GST_BUFFER_OFFSET_END(input_buffer);
+
+	/* Make sure the GST_BUFFER_FLAG_TAG_MEMORY flag isn't copied,
+	 * otherwise the output buffer will be reallocated all the time */
+	GST_BUFFER_FLAGS(output_buffer) = GST_BUFFER_FLAGS(input_buffer);
+	GST_BUFFER_FLAG_UNSET(output_buffer, GST_BUFFER_FLAG_TAG_MEMORY);
+
+	gst_buffer_foreach_meta(input_buffer, gst_imx_2d_multi_scaler_copy_meta, output_buffer);
+}
+
+
+static gboolean gst_imx_2d_multi_scaler_copy_meta(GstBuffer *input_buffer, GstMeta **meta, gpointer user_data)
+{
+	GstBuffer *output_buffer = GST_BUFFER_CAST(user_data);
+	GstMetaInfo const *info = (*meta)->info;
+	gchar const * const *tags;
+	gboolean copy;
+
+	/* Copy the metas the video transform (and GstBaseTransform)
+	 * would copy: those without tags, and those whose only tag
+	 * is the video one. Metas that refer to the size or contents
+	 * of the input frame (like the crop meta) are not valid for
+	 * the scaled output frames. */
+
+	tags = gst_meta_api_type_get_tags(info->api);
+
+	copy = (tags == NULL)
+	    || (tags[0] == NULL)
+	    || ((g_strv_length((gchar **)tags) == 1) && gst_meta_api_type_has_tag(info->api, meta_tag_video_quark));
+
+	if (copy && (info->transform_func != NULL))
+	{
+		GstMetaTransformCopy copy_data = { FALSE, 0, -1 };
+		info->transform_func(output_buffer, *meta, input_buffer, _gst_meta_transform_copy, &copy_data);
+	}
+
+	return TRUE;
+}
+
+
+void gst_imx_2d_multi_scaler_common_class_init(GstImx2dMultiScalerClass *klass, Imx2dHardwareCapabilities const *capabilities)
+{
+	GstElementClass *element_class;
+	GstCaps *sink_template_caps;
+	GstCaps *src_template_caps;
+	GstPadTemplate *sink_template;
+	GstPadTemplate *src_template;
+
+	element_class = GST_ELEMENT_CLASS(klass);
+
+	klass->hardware_capabilities = capabilities;
+
+	sink_template_caps = gst_imx_2d_get_caps_from_imx2d_capabilities(capabilities, GST_PAD_SINK);
+	src_template_caps = gst_imx_2d_get_caps_from_imx2d_capabilities(capabilities, GST_PAD_SRC);
+
+	sink_template = gst_pad_template_new("sink", GST_PAD_SINK, GST_PAD_ALWAYS, sink_template_caps);
+	src_template = gst_pad_template_new_with_gtype("src_%u", GST_PAD_SRC, GST_PAD_REQUEST, src_template_caps, GST_TYPE_IMX_2D_MULTI_SCALER_SRC_PAD);
+
+	gst_element_class_add_pad_template(element_class, sink_template);
+	gst_element_class_add_pad_template(element_class, src_template);
+}
@@ -0,0 +1,137 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef GST_IMX_2D_MULTI_SCALER_H
+#define GST_IMX_2D_MULTI_SCALER_H
+
+#include <gst/gst.h>
+#include <gst/base/gstflowcombiner.h>
+#include <gst/video/video.h>
+#include "gst/imx/video/gstimxvideouploader.h"
+#include "imx2d/imx2d.h"
+#include "gstimx2dmisc.h"
+#include "gstimx2dsharedblitter.h"
+#include "gstimx2dstats.h"
+
+
+G_BEGIN_DECLS
+
+
+/* The multi scaler has one sink pad and any number of "src_%u"
+ * request pads. Each src pad negotiates its own caps with its
+ * downstream peer, so each one can have a different size and
+ * format. Input frames are uploaded once, and all outputs are
+ * rendered from that uploaded frame while the blitter is locked
+ * once, which avoids the repeated uploads and blitter setups of
+ * a tee followed by several video transforms.
+ *
+ * Each src pad has its own output buffer pool and its own QoS
+ * state. QoS events from downstream of one src pad only affect
+ * that pad; frames that would be late on that pad are not
+ * rendered for it, while the other pads still get them. QoS
+ * events are therefore not forwarded upstream. To keep one
+ * slow branch from blocking the others, put a queue after each
+ * src pad, like with tee. */
+
+
+#define GST_TYPE_IMX_2D_MULTI_SCALER             (gst_imx_2d_multi_scaler_get_type())
+#define GST_IMX_2D_MULTI_SCALER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_IMX_2D_MULTI_SCALER, GstImx2dMultiScaler))
+#define GST_IMX_2D_MULTI_SCALER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_IMX_2D_MULTI_SCALER, GstImx2dMultiScalerClass))
+#define GST_IMX_2D_MULTI_SCALER_GET_CLASS(klass) (G_TYPE_INSTANCE_GET_CLASS((obj), GST_TYPE_IMX_2D_MULTI_SCALER, GstImx2dMultiScalerClass))
+#define GST_IMX_2D_MULTI_SCALER_CAST(obj)        ((GstImx2dMultiScaler *)(obj))
+#define GST_IS_IMX_2D_MULTI_SCALER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_IMX_2D_MULTI_SCALER))
+#define GST_IS_IMX_2D_MULTI_SCALER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_IMX_2D_MULTI_SCALER))
+
+
+typedef struct _GstImx2dMultiScaler GstImx2dMultiScaler;
+typedef struct _GstImx2dMultiScalerClass GstImx2dMultiScalerClass;
+
+
+struct _GstImx2dMultiScaler
+{
+	GstElement parent;
+
+	/*< private >*/
+
+	GstPad *sinkpad;
+
+	GstImxVideoUploader *uploader;
+	GstAllocator *imx_dma_buffer_allocator;
+
+	/* If the shared-blitter property is enabled, this blitter
+	 * belongs to shared_blitter, and every blitter sequence must
+	 * be enclosed in gst_imx_2d_shared_blitter_lock() and
+	 * gst_imx_2d_shared_blitter_unlock() calls. */
+	Imx2dBlitter *blitter;
+	GstImx2dSharedBlitter *shared_blitter;
+	/* TRUE if blitter was created by this element (and not taken
+	 * from shared_blitter), meaning that stop() must destroy it. */
+	gboolean owns_blitter;
+
+	/* Combines the flow returns of the src pads. Only accessed
+	 * with the sink pad's stream lock held. */
+	GstFlowCombiner *flow_combiner;
+
+	/* Index for the name of the next src pad that is
+	 * requested without a name. */
+	guint next_src_pad_index;
+
+	gboolean input_video_info_set;
+	GstVideoInfo input_video_info;
+
+	Imx2dSurface *input_surface;
+	Imx2dSurfaceDesc input_surface_desc;
+
+	/* Segment from the sink pad. Used for converting input
+	 * buffer timestamps to running times for QoS. */
+	GstSegment segment;
+
+	gboolean input_crop;
+	gboolean use_shared_blitter;
+
+	GstImx2dStatsTracker stats_tracker;
+};
+
+
+struct _GstImx2dMultiScalerClass
+{
+	GstElementClass parent_class;
+
+	gboolean (*start)(GstImx2dMultiScaler *imx_2d_multi_scaler);
+	gboolean (*stop)(GstImx2dMultiScaler *imx_2d_multi_scaler);
+
+	Imx2dBlitter* (*create_blitter)(GstImx2dMultiScaler *imx_2d_multi_scaler);
+
+	/* Name of the backend for the shared blitter context type.
+	 * NULL if the subclass does not support shared blitters. */
+	gchar const *shared_blitter_backend_name;
+
+	Imx2dHardwareCapabilities const *hardware_capabilities;
+};
+
+
+GType gst_imx_2d_multi_scaler_get_type(void);
+
+
+void gst_imx_2d_multi_scaler_common_class_init(GstImx2dMultiScalerClass *klass, Imx2dHardwareCapabilities const *capabilities);
+
+
+G_END_DECLS
+
+
+#endif /* GST_IMX_2D_MULTI_SCALER_H */
@@ -0,0 +1,382 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <gst/gst.h>
+#include "gstimx2dsharedblitter.h"
+
+
+GST_DEBUG_CATEGORY_STATIC(imx_2d_shared_blitter_debug);
+#define GST_CAT_DEFAULT imx_2d_shared_blitter_debug
+
+
+#define SHARED_BLITTER_FIELD_NAME "shared-blitter"
+
+
+struct _GstImx2dSharedBlitter
+{
+	GstObject parent;
+
+	Imx2dBlitter *blitter;
+
+	/* Held from the start to the end of an element's
+	 * blitter sequence. Not to be confused with the
+	 * object lock, which is not used for this purpose,
+	 * since sequences can take a while. */
+	GMutex sequence_mutex;
+};
+
+
+struct _GstImx2dSharedBlitterClass
+{
+	GstObjectClass parent_class;
+};
+
+
+G_DEFINE_TYPE(GstImx2dSharedBlitter, gst_imx_2d_shared_blitter, GST_TYPE_OBJECT)
+
+
+static void gst_imx_2d_shared_blitter_finalize(GObject *object);
+
+static gchar* get_context_type(gchar const *backend_name);
+static gboolean has_shared_blitter(GstElement *element, GstImx2dSharedBlitter **shared_blitter);
+static gboolean run_context_query(GstElement *element, GstQuery *query);
+static gboolean run_context_query_on_pad(GstElement *element, GstPad *pad, gpointer user_data);
+
+
+static void gst_imx_2d_shared_blitter_class_init(GstImx2dSharedBlitterClass *klass)
+{
+	GObjectClass *object_class;
+
+	GST_DEBUG_CATEGORY_INIT(imx_2d_shared_blitter_debug, "imx2dsharedblitter", 0, "NXP i.MX 2D shared blitter");
+
+	object_class = G_OBJECT_CLASS(klass);
+	object_class->finalize = GST_DEBUG_FUNCPTR(gst_imx_2d_shared_blitter_finalize);
+}
+
+
+static void gst_imx_2d_shared_blitter_init(GstImx2dSharedBlitter *self)
+{
+	self->blitter = NULL;
+	g_mutex_init(&(self->sequence_mutex));
+}
+
+
+static void gst_imx_2d_shared_blitter_finalize(GObject *object)
+{
+	GstImx2dSharedBlitter *self = GST_IMX_2D_SHARED_BLITTER(object);
+
+	GST_DEBUG_OBJECT(self, "destroying shared blitter %p", (gpointer)(self->blitter));
+
+	if (self->blitter != NULL)
+		imx_2d_blitter_destroy(self->blitter);
+
+	g_mutex_clear(&(self->sequence_mutex));
+
+	G_OBJECT_CLASS(gst_imx_2d_shared_blitter_parent_class)->finalize(object);
+}
+
+
+GstImx2dSharedBlitter* gst_imx_2d_shared_blitter_new(gchar const *backend_name, Imx2dBlitter *blitter)
+{
+	GstImx2dSharedBlitter *shared_blitter;
+	gchar *name;
+
+	g_assert(backend_name != NULL);
+	g_assert(blitter != NULL);
+
+	name = g_strdup_printf("imx2d-shared-blitter-%s", backend_name);
+	shared_blitter = g_object_new(gst_imx_2d_shared_blitter_get_type(), "name", name, NULL);
+	g_free(name);
+
+	/* Clear floating flag */
+	gst_object_ref_sink(GST_OBJECT(shared_blitter));
+
+	shared_blitter->blitter = blitter;
+
+	GST_DEBUG_OBJECT(shared_blitter, "created shared blitter %p", (gpointer)blitter);
+
+	return shared_blitter;
+}
+
+
+Imx2dBlitter* gst_imx_2d_shared_blitter_get_blitter(GstImx2dSharedBlitter *shared_blitter)
+{
+	g_assert(shared_blitter != NULL);
+	return shared_blitter->blitter;
+}
+
+
+void gst_imx_2d_shared_blitter_lock(GstImx2dSharedBlitter *shared_blitter, GstImx2dStatsTracker *stats_tracker)
+{
+	if (shared_blitter == NULL)
+		return;
+
+	g_mutex_lock(&(shared_blitter->sequence_mutex));
+
+	/* The previous sequence may have been another element's, so
+	 * make sure the stats of this one end up in the right tracker. */
+	if (stats_tracker != NULL)
+		gst_imx_2d_stats_tracker_install(stats_tracker, shared_blitter->blitter);
+}
+
+
+void gst_imx_2d_shared_blitter_unlock(GstImx2dSharedBlitter *shared_blitter)
+{
+	if (shared_blitter == NULL)
+		return;
+
+	/* The element's tracker may be gone by the time the
+	 * blitter is used again (or destroyed), so uninstall it. */
+	imx_2d_blitter_set_stats_func(shared_blitter->blitter, NULL, NULL);
+
+	g_mutex_unlock(&(shared_blitter->sequence_mutex));
+}
+
+
+gboolean gst_imx_2d_shared_blitter_handle_set_context(GstElement *element, GstContext *context, gchar const *backend_name, GstImx2dSharedBlitter **shared_blitter)
+{
+	gchar *context_type;
+	gboolean is_our_type;
+	GstStructure const *structure;
+	GstImx2dSharedBlitter *context_shared_blitter = NULL;
+	gboolean stored = FALSE;
+
+	g_assert(element != NULL);
+	g_assert(context != NULL);
+	g_assert(shared_blitter != NULL);
+
+	if (backend_name == NULL)
+		return FALSE;
+
+	context_type = get_context_type(backend_name);
+	is_our_type = gst_context_has_context_type(context, context_type);
+	g_free(context_type);
+
+	if (!is_our_type)
+		return FALSE;
+
+	structure = gst_context_get_structure(context);
+	if (!gst_structure_get(structure, SHARED_BLITTER_FIELD_NAME, GST_TYPE_IMX_2D_SHARED_BLITTER, &context_shared_blitter, NULL))
+	{
+		GST_WARNING_OBJECT(element, "shared blitter context has no valid \"%s\" field", SHARED_BLITTER_FIELD_NAME);
+		return FALSE;
+	}
+
+	/* Once an element uses a shared blitter, it keeps using it
+	 * until it is stopped, since its blit plans, surfaces etc.
+	 * may already be associated with it. */
+	GST_OBJECT_LOCK(element);
+	if (*shared_blitter == NULL)
+	{
+		*shared_blitter = context_shared_blitter;
+		context_shared_blitter = NULL;
+		stored = TRUE;
+	}
+	GST_OBJECT_UNLOCK(element);
+
+	if (stored)
+		GST_DEBUG_OBJECT(element, "got shared blitter %" GST_PTR_FORMAT " from context", (gpointer)(*shared_blitter));
+
+	if (context_shared_blitter != NULL)
+		gst_object_unref(GST_OBJECT(context_shared_blitter));
+
+	return stored;
+}
+
+
+gboolean gst_imx_2d_shared_blitter_handle_context_query(GstElement *element, GstQuery *query, gchar const *backend_name, GstImx2dSharedBlitter *shared_blitter)
+{
+	gchar const *query_context_type;
+	gchar *context_type;
+	gboolean is_our_type;
+	GstContext *old_context;
+	GstContext *context;
+	GstStructure *structure;
+
+	g_assert(element != NULL);
+	g_assert(query != NULL);
+
+	if ((GST_QUERY_TYPE(query) != GST_QUERY_CONTEXT) || (backend_name == NULL) || (shared_blitter == NULL))
+		return FALSE;
+
+	if (!gst_query_parse_context_type(query, &query_context_type))
+		return FALSE;
+
+	context_type = get_context_type(backend_name);
+	is_our_type = (g_strcmp0(query_context_type, context_type) == 0);
+
+	if (!is_our_type)
+	{
+		g_free(context_type);
+		return FALSE;
+	}
+
+	gst_query_parse_context(query, &old_context);
+	if (old_context != NULL)
+		context = gst_context_copy(old_context);
+	else
+		context = gst_context_new(context_type, TRUE);
+
+	structure = gst_context_writable_structure(context);
+	gst_structure_set(structure, SHARED_BLITTER_FIELD_NAME, GST_TYPE_IMX_2D_SHARED_BLITTER, shared_blitter, NULL);
+
+	gst_query_set_context(query, context);
+	gst_context_unref(context);
+	g_free(context_type);
+
+	GST_DEBUG_OBJECT(element, "answered context query with shared blitter %" GST_PTR_FORMAT, (gpointer)shared_blitter);
+
+	return TRUE;
+}
+
+
+gboolean gst_imx_2d_shared_blitter_ensure(GstElement *element, gchar const *backend_name, GstImx2dSharedBlitter **shared_blitter, GstImx2dSharedBlitterCreateFunc create_func, gpointer user_data)
+{
+	gchar *context_type;
+	GstQuery *query;
+	GstContext *context;
+	GstMessage *message;
+	GstImx2dSharedBlitter *new_shared_blitter;
+	Imx2dBlitter *blitter;
+
+	g_assert(element != NULL);
+	g_assert(backend_name != NULL);
+	g_assert(shared_blitter != NULL);
+	g_assert(create_func != NULL);
+
+	/* The application or the bin may already have set the context. */
+	if (has_shared_blitter(element, shared_blitter))
+		return TRUE;
+
+	context_type = get_context_type(backend_name);
+
+	/* Ask the neighbors first. If one of them has the context, set
+	 * it on this element, which stores the shared blitter through
+	 * gst_imx_2d_shared_blitter_handle_set_context(). */
+	query = gst_query_new_context(context_type);
+	if (run_context_query(element, query))
+	{
+		gst_query_parse_context(query, &context);
+		GST_DEBUG_OBJECT(element, "found shared blitter context %" GST_PTR_FORMAT " in context query", (gpointer)context);
+		gst_element_set_context(element, context);
+	}
+	gst_query_unref(query);
+
+	if (has_shared_blitter(element, shared_blitter))
+		goto finish;
+
+	/* Then ask the application (and the bins, which keep contexts
+	 * that were posted earlier) with a need-context message. This
+	 * is handled synchronously, so if someone has the context,
+	 * it is set on this element by the time this returns. */
+	GST_DEBUG_OBJECT(element, "posting need-context message for context type \"%s\"", context_type);
+	message = gst_message_new_need_context(GST_OBJECT(element), context_type);
+	gst_element_post_message(element, message);
+
+	if (has_shared_blitter(element, shared_blitter))
+		goto finish;
+
+	/* Nobody has a shared blitter for this backend yet, so create
+	 * one, and let the others know about it. */
+	blitter = create_func(user_data);
+	if (blitter == NULL)
+	{
+		GST_ERROR_OBJECT(element, "could not create blitter for shared blitter");
+		g_free(context_type);
+		return FALSE;
+	}
+
+	new_shared_blitter = gst_imx_2d_shared_blitter_new(backend_name, blitter);
+
+	context = gst_context_new(context_type, TRUE);
+	gst_structure_set(gst_context_writable_structure(context), SHARED_BLITTER_FIELD_NAME, GST_TYPE_IMX_2D_SHARED_BLITTER, new_shared_blitter, NULL);
+	gst_object_unref(GST_OBJECT(new_shared_blitter));
+
+	gst_element_set_context(element, context);
+
+	GST_DEBUG_OBJECT(element, "posting have-context message with new shared blitter context %" GST_PTR_FORMAT, (gpointer)context);
+	message = gst_message_new_have_context(GST_OBJECT(element), context);
+	gst_element_post_message(element, message);
+
+finish:
+	g_free(context_type);
+
+	if (!has_shared_blitter(element, shared_blitter))
+	{
+		GST_ERROR_OBJECT(element, "element did not store the shared blitter; is its set_context vfunc forwarding contexts?");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+GParamSpec* gst_imx_2d_shared_blitter_param_spec_new(void)
+{
+	return g_param_spec_boolean(
+		"shared-blitter",
+		"Shared blitter",
+		"Share one blitter (and its hardware context) with other elements in the pipeline that use the same "
+		"backend and have this enabled; takes effect when the element is started (ignored if the backend "
+		"does not support sharing)",
+		FALSE,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+	);
+}
+
+
+static gchar* get_context_type(gchar const *backend_name)
+{
+	return g_strconcat(GST_IMX_2D_SHARED_BLITTER_CONTEXT_TYPE_PREFIX, backend_name, NULL);
+}
+
+
+static gboolean has_shared_blitter(GstElement *element, GstImx2dSharedBlitter **shared_blitter)
+{
+	gboolean ret;
+
+	GST_OBJECT_LOCK(element);
+	ret = (*shared_blitter != NULL);
+	GST_OBJECT_UNLOCK(element);
+
+	return ret;
+}
+
+
+static gboolean run_context_query(GstElement *element, GstQuery *query)
+{
+	/* Downstream first, then upstream. This follows the
+	 * order suggested by the GstContext documentation. */
+	if (!gst_element_foreach_src_pad(element, run_context_query_on_pad, query))
+		return TRUE;
+
+	if (!gst_element_foreach_sink_pad(element, run_context_query_on_pad, query))
+		return TRUE;
+
+	return FALSE;
+}
+
+
+static gboolean run_context_query_on_pad(G_GNUC_UNUSED GstElement *element, GstPad *pad, gpointer user_data)
+{
+	GstQuery *query = (GstQuery *)user_data;
+
+	/* Returning FALSE stops the iteration,
+	 * so return FALSE if the query succeeded. */
+	return !gst_pad_peer_query(pad, query);
+}
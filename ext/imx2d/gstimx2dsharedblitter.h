@@ -0,0 +1,121 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef GST_IMX_2D_SHARED_BLITTER_H
+#define GST_IMX_2D_SHARED_BLITTER_H
+
+#include <gst/gst.h>
+#include "imx2d/imx2d.h"
+#include "gstimx2dstats.h"
+
+
+G_BEGIN_DECLS
+
+
+/* The GstImx2dSharedBlitter is an internal object used in imx2d based
+ * GStreamer elements. It allows for several elements to use one and
+ * the same imx2d blitter instead of each creating their own. This
+ * is useful with backends like G2D, where each blitter has its own
+ * GPU context and its own internal DMA buffers, and all contexts
+ * compete for the same hardware. With the G2D backend's worker
+ * thread enabled, a shared blitter also means that one single
+ * thread submits all G2D work of all participating elements.
+ *
+ * Shared blitters are distributed with GstContext. Each backend has
+ * its own context type, which is GST_IMX_2D_SHARED_BLITTER_CONTEXT_TYPE_PREFIX
+ * plus the backend name, for example "gst.imx.2d.shared-blitter.g2d".
+ * The context contains the shared blitter in its "shared-blitter"
+ * field. gst_imx_2d_shared_blitter_ensure() tries to get that context
+ * from the element's peers and from the application (in that order).
+ * If neither has it, it creates a new shared blitter and posts it in
+ * a GST_MESSAGE_HAVE_CONTEXT message. Bins then pass it on to their
+ * other children. Elements must forward contexts they get in their
+ * set_context vfunc to gst_imx_2d_shared_blitter_handle_set_context(),
+ * and context queries to gst_imx_2d_shared_blitter_handle_context_query().
+ *
+ * Imx2dBlitter instances are not thread safe, and the elements use them
+ * from their own streaming threads. Therefore, elements must call
+ * gst_imx_2d_shared_blitter_lock() before imx_2d_blitter_start() and
+ * gst_imx_2d_shared_blitter_unlock() after imx_2d_blitter_finish()
+ * (or imx_2d_blitter_finish_async()). The lock functions also install
+ * the element's stats tracker in the blitter for the duration of the
+ * sequence. (The statistics of a sequence that was finished with
+ * imx_2d_blitter_finish_async() are therefore counted by the element
+ * that starts the next sequence.) Both functions do nothing if the
+ * shared blitter is NULL, so elements can call them unconditionally.
+ *
+ * Blit plans are not tied to an element, so elements can keep their
+ * plans as usual. They can be destroyed without holding the lock.
+ */
+
+
+#define GST_TYPE_IMX_2D_SHARED_BLITTER             (gst_imx_2d_shared_blitter_get_type())
+#define GST_IMX_2D_SHARED_BLITTER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_IMX_2D_SHARED_BLITTER, GstImx2dSharedBlitter))
+#define GST_IMX_2D_SHARED_BLITTER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_IMX_2D_SHARED_BLITTER, GstImx2dSharedBlitterClass))
+#define GST_IMX_2D_SHARED_BLITTER_GET_CLASS(klass) (G_TYPE_INSTANCE_GET_CLASS((obj), GST_TYPE_IMX_2D_SHARED_BLITTER, GstImx2dSharedBlitterClass))
+#define GST_IMX_2D_SHARED_BLITTER_CAST(obj)        ((GstImx2dSharedBlitter *)(obj))
+#define GST_IS_IMX_2D_SHARED_BLITTER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_IMX_2D_SHARED_BLITTER))
+#define GST_IS_IMX_2D_SHARED_BLITTER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_IMX_2D_SHARED_BLITTER))
+
+
+#define GST_IMX_2D_SHARED_BLITTER_CONTEXT_TYPE_PREFIX "gst.imx.2d.shared-blitter."
+
+
+typedef struct _GstImx2dSharedBlitter GstImx2dSharedBlitter;
+typedef struct _GstImx2dSharedBlitterClass GstImx2dSharedBlitterClass;
+
+
+typedef Imx2dBlitter* (*GstImx2dSharedBlitterCreateFunc)(gpointer user_data);
+
+
+GType gst_imx_2d_shared_blitter_get_type(void);
+
+/* Takes ownership over the blitter. It is destroyed
+ * when the last reference to the shared blitter is gone. */
+GstImx2dSharedBlitter* gst_imx_2d_shared_blitter_new(gchar const *backend_name, Imx2dBlitter *blitter);
+
+Imx2dBlitter* gst_imx_2d_shared_blitter_get_blitter(GstImx2dSharedBlitter *shared_blitter);
+
+void gst_imx_2d_shared_blitter_lock(GstImx2dSharedBlitter *shared_blitter, GstImx2dStatsTracker *stats_tracker);
+void gst_imx_2d_shared_blitter_unlock(GstImx2dSharedBlitter *shared_blitter);
+
+/* Stores a new ref to the shared blitter from the context in
+ * *shared_blitter if the context is the one of the given backend
+ * and *shared_blitter is NULL. Returns TRUE if it was stored. */
+gboolean gst_imx_2d_shared_blitter_handle_set_context(GstElement *element, GstContext *context, gchar const *backend_name, GstImx2dSharedBlitter **shared_blitter);
+
+/* Answers context queries for the given backend's shared blitter.
+ * Returns FALSE if the query is not such a query, or if
+ * shared_blitter is NULL. */
+gboolean gst_imx_2d_shared_blitter_handle_context_query(GstElement *element, GstQuery *query, gchar const *backend_name, GstImx2dSharedBlitter *shared_blitter);
+
+/* Makes sure *shared_blitter is set, either by looking up an
+ * existing shared blitter as described above, or by creating
+ * a new one with a blitter from create_func. *shared_blitter
+ * is accessed with the element's object lock held, since
+ * set_context may be called concurrently. Returns FALSE if
+ * creating the blitter failed. */
+gboolean gst_imx_2d_shared_blitter_ensure(GstElement *element, gchar const *backend_name, GstImx2dSharedBlitter **shared_blitter, GstImx2dSharedBlitterCreateFunc create_func, gpointer user_data);
+
+GParamSpec* gst_imx_2d_shared_blitter_param_spec_new(void);
+
+
+G_END_DECLS
+
+
+#endif /* GST_IMX_2D_SHARED_BLITTER_H */
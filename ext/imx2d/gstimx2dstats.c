@@ -0,0 +1,224 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* GstTracerRecord is only exposed if this is defined. */
+#define GST_USE_UNSTABLE_API
+
+#include <string.h>
+#include "gstimx2dstats.h"
+
+
+static GstTracerRecord *op_tracer_record;
+
+
+static GstTracerRecord* get_op_tracer_record(void)
+{
+	static gsize initialized = 0;
+
+	if (g_once_init_enter(&initialized))
+	{
+		op_tracer_record = gst_tracer_record_new(
+			"imx2d-op.class",
+			"element", GST_TYPE_STRUCTURE, gst_structure_new(
+				"value",
+				"type", G_TYPE_GTYPE, G_TYPE_STRING,
+				"related", GST_TYPE_TRACER_VALUE_SCOPE, GST_TRACER_VALUE_SCOPE_ELEMENT,
+				"description", G_TYPE_STRING, "Name of the element that performed the operation",
+				NULL
+			),
+			"op", GST_TYPE_STRUCTURE, gst_structure_new(
+				"value",
+				"type", G_TYPE_GTYPE, G_TYPE_STRING,
+				"description", G_TYPE_STRING, "Operation type (blit, fill-region, batch, finish)",
+				NULL
+			),
+			"backend", GST_TYPE_STRUCTURE, gst_structure_new(
+				"value",
+				"type", G_TYPE_GTYPE, G_TYPE_STRING,
+				"description", G_TYPE_STRING, "imx2d backend that performed the operation",
+				NULL
+			),
+			"num-ops", GST_TYPE_STRUCTURE, gst_structure_new(
+				"value",
+				"type", G_TYPE_GTYPE, G_TYPE_UINT,
+				"description", G_TYPE_STRING, "Number of blits and fills included in the operation",
+				NULL
+			),
+			"pixels", GST_TYPE_STRUCTURE, gst_structure_new(
+				"value",
+				"type", G_TYPE_GTYPE, G_TYPE_UINT64,
+				"description", G_TYPE_STRING, "Number of written destination pixels",
+				NULL
+			),
+			"bytes", GST_TYPE_STRUCTURE, gst_structure_new(
+				"value",
+				"type", G_TYPE_GTYPE, G_TYPE_UINT64,
+				"description", G_TYPE_STRING, "Approximate number of read and written bytes",
+				NULL
+			),
+			"submit-ts", GST_TYPE_STRUCTURE, gst_structure_new(
+				"value",
+				"type", G_TYPE_GTYPE, G_TYPE_UINT64,
+				"description", G_TYPE_STRING, "Monotonic clock timestamp of the operation's submission, in ns",
+				NULL
+			),
+			"completion-ts", GST_TYPE_STRUCTURE, gst_structure_new(
+				"value",
+				"type", G_TYPE_GTYPE, G_TYPE_UINT64,
+				"description", G_TYPE_STRING, "Monotonic clock timestamp of the operation's completion, in ns",
+				NULL
+			),
+			NULL
+		);
+		GST_OBJECT_FLAG_SET(op_tracer_record, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+
+		g_once_init_leave(&initialized, 1);
+	}
+
+	return op_tracer_record;
+}
+
+
+static void stats_func(Imx2dOpStats const *op_stats, void *user_data)
+{
+	GstImx2dStatsTracker *tracker = (GstImx2dStatsTracker *)user_data;
+
+	g_mutex_lock(&(tracker->mutex));
+	imx_2d_blitter_stats_add(&(tracker->stats), op_stats);
+	g_mutex_unlock(&(tracker->mutex));
+
+	gst_tracer_record_log(
+		get_op_tracer_record(),
+		GST_OBJECT_NAME(tracker->object),
+		imx_2d_op_type_to_string(op_stats->op_type),
+		op_stats->backend_name,
+		(guint)(op_stats->num_ops),
+		(guint64)(op_stats->num_pixels),
+		(guint64)(op_stats->num_bytes),
+		(guint64)(op_stats->submit_time),
+		(guint64)(op_stats->completion_time)
+	);
+}
+
+
+void gst_imx_2d_stats_tracker_init(GstImx2dStatsTracker *tracker, GstObject *object)
+{
+	g_assert(tracker != NULL);
+
+	tracker->object = object;
+	g_mutex_init(&(tracker->mutex));
+	memset(&(tracker->stats), 0, sizeof(Imx2dBlitterStats));
+	tracker->backend_name = NULL;
+
+	/* Register the record type right away, so that tracers
+	 * know about it before the first operation is logged. */
+	get_op_tracer_record();
+}
+
+
+void gst_imx_2d_stats_tracker_cleanup(GstImx2dStatsTracker *tracker)
+{
+	g_assert(tracker != NULL);
+	g_mutex_clear(&(tracker->mutex));
+}
+
+
+void gst_imx_2d_stats_tracker_attach(GstImx2dStatsTracker *tracker, Imx2dBlitter *blitter)
+{
+	g_assert(tracker != NULL);
+	g_assert(blitter != NULL);
+
+	g_mutex_lock(&(tracker->mutex));
+	memset(&(tracker->stats), 0, sizeof(Imx2dBlitterStats));
+	tracker->backend_name = imx_2d_blitter_get_backend_name(blitter);
+	g_mutex_unlock(&(tracker->mutex));
+
+	gst_imx_2d_stats_tracker_install(tracker, blitter);
+}
+
+
+void gst_imx_2d_stats_tracker_install(GstImx2dStatsTracker *tracker, Imx2dBlitter *blitter)
+{
+	g_assert(tracker != NULL);
+	g_assert(blitter != NULL);
+
+	imx_2d_blitter_set_stats_func(blitter, stats_func, tracker);
+}
+
+
+GstStructure* gst_imx_2d_stats_tracker_create_structure(GstImx2dStatsTracker *tracker)
+{
+	GstStructure *structure;
+	Imx2dBlitterStats stats;
+	gchar const *backend_name;
+	int op_type;
+
+	g_assert(tracker != NULL);
+
+	g_mutex_lock(&(tracker->mutex));
+	stats = tracker->stats;
+	backend_name = tracker->backend_name;
+	g_mutex_unlock(&(tracker->mutex));
+
+	structure = gst_structure_new(
+		"imx2d-stats",
+		"backend", G_TYPE_STRING, (backend_name != NULL) ? backend_name : "",
+		NULL
+	);
+
+	for (op_type = 0; op_type < IMX_2D_NUM_OP_TYPES; ++op_type)
+	{
+		gchar const *op_name = imx_2d_op_type_to_string(op_type);
+		gchar *count_name = g_strdup_printf("%s-count", op_name);
+		gchar *pixels_name = g_strdup_printf("%s-pixels", op_name);
+		gchar *bytes_name = g_strdup_printf("%s-bytes", op_name);
+		gchar *total_time_name = g_strdup_printf("%s-total-time", op_name);
+		gchar *max_time_name = g_strdup_printf("%s-max-time", op_name);
+
+		gst_structure_set(
+			structure,
+			count_name, G_TYPE_UINT64, (guint64)(stats.num_ops[op_type]),
+			pixels_name, G_TYPE_UINT64, (guint64)(stats.num_pixels[op_type]),
+			bytes_name, G_TYPE_UINT64, (guint64)(stats.num_bytes[op_type]),
+			total_time_name, G_TYPE_UINT64, (guint64)(stats.total_duration[op_type]),
+			max_time_name, G_TYPE_UINT64, (guint64)(stats.max_duration[op_type]),
+			NULL
+		);
+
+		g_free(count_name);
+		g_free(pixels_name);
+		g_free(bytes_name);
+		g_free(total_time_name);
+		g_free(max_time_name);
+	}
+
+	return structure;
+}
+
+
+GParamSpec* gst_imx_2d_stats_param_spec_new(void)
+{
+	return g_param_spec_boxed(
+		"stats",
+		"Statistics",
+		"Number of pixels, approximate number of bytes, and total and maximum duration "
+		"of the blitter operations since the element was started, per operation type",
+		GST_TYPE_STRUCTURE,
+		G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+	);
+}
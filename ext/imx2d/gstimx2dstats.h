@@ -0,0 +1,67 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef GST_IMX_2D_STATS_H
+#define GST_IMX_2D_STATS_H
+
+#include <gst/gst.h>
+#include "imx2d/imx2d.h"
+
+
+G_BEGIN_DECLS
+
+
+/* Accumulates the statistics of the blitter of an element, and
+ * logs each operation as an "imx2d-op" GstTracer record. The
+ * statistics are guarded by their own mutex, since blitter
+ * operations can be performed while the object lock is held. */
+typedef struct
+{
+	GstObject *object;
+	GMutex mutex;
+	Imx2dBlitterStats stats;
+	gchar const *backend_name;
+}
+GstImx2dStatsTracker;
+
+
+void gst_imx_2d_stats_tracker_init(GstImx2dStatsTracker *tracker, GstObject *object);
+void gst_imx_2d_stats_tracker_cleanup(GstImx2dStatsTracker *tracker);
+
+/* Resets the accumulated statistics and installs the
+ * tracker's stats function in the given blitter. */
+void gst_imx_2d_stats_tracker_attach(GstImx2dStatsTracker *tracker, Imx2dBlitter *blitter);
+
+/* Installs the tracker's stats function in the given blitter without
+ * resetting the statistics. Used with shared blitters, which are
+ * used by the trackers of several elements in turn. */
+void gst_imx_2d_stats_tracker_install(GstImx2dStatsTracker *tracker, Imx2dBlitter *blitter);
+
+/* Creates an "imx2d-stats" structure with the accumulated statistics.
+ * For each operation type, it contains the fields "<op>-count",
+ * "<op>-pixels", "<op>-bytes", "<op>-total-time", and "<op>-max-time"
+ * (times in nanoseconds), plus a "backend" string field. */
+GstStructure* gst_imx_2d_stats_tracker_create_structure(GstImx2dStatsTracker *tracker);
+
+GParamSpec* gst_imx_2d_stats_param_spec_new(void);
+
+
+G_END_DECLS
+
+
+#endif /* GST_IMX_2D_STATS_H */
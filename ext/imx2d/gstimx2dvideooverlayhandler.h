@@ -61,7 +61,10 @@ G_BEGIN_DECLS
  * blitter operation sequence on its own. (This is intentional;
  * it allows for combining operations from somewhere else with
  * blitter operations performed by that function without having
- * to start/finish multiple sequences.)
+ * to start/finish multiple sequences.) For the same reason, it
+ * can be called while an imx2d blitter batch is being recorded.
+ * Its blits are then added to that batch. The cached overlay
+ * surfaces stay valid until the batch is submitted.
  */
 
 
@@ -16,9 +16,11 @@
  * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <config.h>
 #include <gst/gst.h>
 #include "gst/imx/common/gstimxdmabufferallocator.h"
 #include "gstimx2dvideosink.h"
+#include "gstimx2dframebufferallocator.h"
 #include "gstimx2dmisc.h"
 
 
@@ -31,6 +33,7 @@ enum
 	PROP_0,
 	PROP_DROP_FRAMES,
 	PROP_FRAMEBUFFER_NAME,
+	PROP_DRM_DEVICE_NAME,
 	PROP_INPUT_CROP,
 	PROP_VIDEO_DIRECTION,
 	PROP_CLEAR_AT_NULL,
@@ -44,12 +47,19 @@ enum
 	PROP_LEFT_MARGIN,
 	PROP_TOP_MARGIN,
 	PROP_RIGHT_MARGIN,
-	PROP_BOTTOM_MARGIN
+	PROP_BOTTOM_MARGIN,
+	PROP_STATS,
+	PROP_SHARED_BLITTER,
+	PROP_DIRECT_SCANOUT,
+	PROP_FLIP_LATENCY,
+	PROP_MAX_FLIP_LATENCY,
+	PROP_MISSED_VBLANKS
 };
 
 
 #define DEFAULT_DROP_FRAMES FALSE
 #define DEFAULT_FRAMEBUFFER_NAME "/dev/fb0"
+#define DEFAULT_DRM_DEVICE_NAME NULL
 #define DEFAULT_INPUT_CROP TRUE
 #define DEFAULT_VIDEO_DIRECTION GST_VIDEO_ORIENTATION_IDENTITY
 #define DEFAULT_CLEAR_AT_NULL FALSE
@@ -64,6 +74,14 @@ enum
 #define DEFAULT_TOP_MARGIN 0
 #define DEFAULT_RIGHT_MARGIN 0
 #define DEFAULT_BOTTOM_MARGIN 0
+#define DEFAULT_SHARED_BLITTER FALSE
+#define DEFAULT_DIRECT_SCANOUT FALSE
+
+/* Number of framebuffer pages that are never handed out to upstream
+ * with direct scanout. Frames that cannot be shown as is are blitted
+ * into these pages, since upstream may still be writing into the
+ * pages of its buffer pool. */
+#define GST_IMX_2D_VIDEO_SINK_NUM_RESERVED_FB_PAGES 1
 
 
 static void gst_imx_2d_video_sink_video_direction_interface_init(G_GNUC_UNUSED GstVideoDirectionInterface *iface)
@@ -84,10 +102,13 @@ G_DEFINE_ABSTRACT_TYPE_WITH_CODE(
 
 /* General element operations. */
 static void gst_imx_2d_video_sink_dispose(GObject *object);
+static void gst_imx_2d_video_sink_finalize(GObject *object);
 static void gst_imx_2d_video_sink_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
 static void gst_imx_2d_video_sink_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
 static GstStateChangeReturn gst_imx_2d_video_sink_change_state(GstElement *element, GstStateChange transition);
+static void gst_imx_2d_video_sink_set_context(GstElement *element, GstContext *context);
 static gboolean gst_imx_2d_video_sink_event(GstBaseSink *sink, GstEvent *event);
+static gboolean gst_imx_2d_video_sink_query(GstBaseSink *sink, GstQuery *query);
 
 /* Caps handling. */
 static gboolean gst_imx_2d_video_sink_set_caps(GstBaseSink *sink, GstCaps *caps);
@@ -102,10 +123,22 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 static gboolean gst_imx_2d_video_sink_start(GstImx2dVideoSink *self);
 static void gst_imx_2d_video_sink_stop(GstImx2dVideoSink *self);
 static gboolean gst_imx_2d_video_sink_create_blitter(GstImx2dVideoSink *self);
+static Imx2dBlitter* gst_imx_2d_video_sink_create_blitter_for_sharing(gpointer user_data);
 static GstVideoOrientationMethod gst_imx_2d_video_sink_get_current_video_direction(GstImx2dVideoSink *self);
 static gboolean gst_imx_2d_video_sink_flip_pages(GstImx2dVideoSink *self);
+static gpointer gst_imx_2d_video_sink_flip_thread_func(gpointer user_data);
+static gboolean gst_imx_2d_video_sink_acquire_write_fb_page(GstImx2dVideoSink *self, int excluded_page);
+static gboolean gst_imx_2d_video_sink_queue_flip(GstImx2dVideoSink *self, int page, GstBuffer *buffer, guint32 drm_framebuffer_id, Imx2dRegion const *drm_source_region, Imx2dRegion const *drm_dest_region);
+static void gst_imx_2d_video_sink_wait_for_flips(GstImx2dVideoSink *self);
+static gboolean gst_imx_2d_video_sink_can_scan_out_directly(GstImx2dVideoSink *self, GstVideoInfo const *video_info);
+static gboolean gst_imx_2d_video_sink_scan_out_buffer(GstImx2dVideoSink *self, GstBuffer *input_buffer, gint page);
+static void gst_imx_2d_video_sink_set_write_fb_page(GstImx2dVideoSink *self, int page);
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+static gboolean gst_imx_2d_video_sink_show_frame_with_plane(GstImx2dVideoSink *self, GstBuffer *buffer, Imx2dRegion const *source_region, Imx2dRegion const *dest_region, gboolean *frame_shown);
+#endif
 static gboolean gst_imx_2d_video_clear_total_region(GstImx2dVideoSink *self, gboolean clear_on_all_pages);
-static void gst_imx_2d_video_sink_recalculate_regions_if_needed(GstImx2dVideoSink *self);
+static gboolean gst_imx_2d_video_clear_region(GstImx2dVideoSink *self, Imx2dRegion const *region, gboolean clear_on_all_pages);
+static gboolean gst_imx_2d_video_sink_recalculate_regions_if_needed(GstImx2dVideoSink *self, Imx2dRegion *region_to_clear);
 
 
 
@@ -127,13 +160,16 @@ static void gst_imx_2d_video_sink_class_init(GstImx2dVideoSinkClass *klass)
 	video_sink_class = GST_VIDEO_SINK_CLASS(klass);
 
 	object_class->dispose               = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_dispose);
+	object_class->finalize              = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_finalize);
 	object_class->set_property          = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_set_property);
 	object_class->get_property          = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_get_property);
 
 	element_class->change_state         = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_change_state);
+	element_class->set_context          = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_set_context);
 
 	base_sink_class->set_caps           = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_set_caps);
 	base_sink_class->event              = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_event);
+	base_sink_class->query              = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_query);
 	base_sink_class->propose_allocation = GST_DEBUG_FUNCPTR(gst_imx_2d_video_sink_propose_allocation);
 
 	video_sink_class->show_frame        = GST_DEBUG_FUNCPTR(gst_imx_blitter_video_sink_show_frame);
@@ -160,6 +196,19 @@ static void gst_imx_2d_video_sink_class_init(GstImx2dVideoSinkClass *klass)
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_DRM_DEVICE_NAME,
+		g_param_spec_string(
+			"drm-device",
+			"DRM device name",
+			"The device name of the DRM device to render to with DRM/KMS atomic commits instead of the framebuffer; "
+			"if the display controller can show the input frames with a plane, no blit is performed; "
+			"takes effect when the element is started",
+			DEFAULT_DRM_DEVICE_NAME,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
 	g_object_class_install_property(
 		object_class,
 		PROP_INPUT_CROP,
@@ -312,6 +361,66 @@ static void gst_imx_2d_video_sink_class_init(GstImx2dVideoSinkClass *klass)
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_STATS,
+		gst_imx_2d_stats_param_spec_new()
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_SHARED_BLITTER,
+		gst_imx_2d_shared_blitter_param_spec_new()
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_DIRECT_SCANOUT,
+		g_param_spec_boolean(
+			"direct-scanout",
+			"Direct scanout",
+			"Let upstream write frames directly into framebuffer pages if the input matches the framebuffer's "
+			"format, size, and stride, and no transformation is needed; the frames are then shown by panning "
+			"instead of blitting; requires use-vsync; not supported with drm-device; takes effect when the element is started",
+			DEFAULT_DIRECT_SCANOUT,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_FLIP_LATENCY,
+		g_param_spec_uint64(
+			"flip-latency",
+			"Flip latency",
+			"Average time in nanoseconds from submitting a frame until it is shown; only measured if use-vsync is enabled or drm-device is set",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_MAX_FLIP_LATENCY,
+		g_param_spec_uint64(
+			"max-flip-latency",
+			"Maximum flip latency",
+			"Maximum time in nanoseconds from submitting a frame until it is shown; only measured if use-vsync is enabled or drm-device is set",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_MISSED_VBLANKS,
+		g_param_spec_uint64(
+			"missed-vblanks",
+			"Missed vertical blanks",
+			"Number of vertical blanks at which an already queued page was not shown yet; only counted if use-vsync "
+			"is enabled or drm-device is set, and the display driver provides display timings",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
 }
 
 
@@ -321,18 +430,40 @@ static void gst_imx_2d_video_sink_init(GstImx2dVideoSink *self)
 	self->imx_dma_buffer_allocator = NULL;
 
 	self->blitter = NULL;
+	self->shared_blitter = NULL;
+	self->owns_blitter = FALSE;
 
 	gst_video_info_init(&(self->input_video_info));
 	self->input_surface = NULL;
 
 	self->framebuffer = NULL;
+	self->drm_output = NULL;
+
+	self->framebuffer_allocator = NULL;
+	self->scanout_buffer = NULL;
+	self->scanout_possible_at_allocation = FALSE;
+	self->scanout_reconfigure_requested = FALSE;
+
+	self->flip_thread = NULL;
+	g_mutex_init(&(self->flip_mutex));
+	g_cond_init(&(self->flip_cond));
+	self->num_flips = 0;
+	self->total_flip_latency = 0;
+	self->max_flip_latency = 0;
+	self->num_missed_vblanks = 0;
+	self->previous_displayed_time = GST_CLOCK_TIME_NONE;
+
+	self->blit_plan = NULL;
 
 	self->drop_frames = DEFAULT_DROP_FRAMES;
 	self->framebuffer_name = g_strdup(DEFAULT_FRAMEBUFFER_NAME);
+	self->drm_device_name = g_strdup(DEFAULT_DRM_DEVICE_NAME);
 	self->input_crop = DEFAULT_INPUT_CROP;
 	self->video_direction = DEFAULT_VIDEO_DIRECTION;
 	self->clear_at_null = DEFAULT_CLEAR_AT_NULL;
 	self->clear_on_relocate = DEFAULT_CLEAR_ON_RELOCATE;
+	self->use_shared_blitter = DEFAULT_SHARED_BLITTER;
+	self->direct_scanout = DEFAULT_DIRECT_SCANOUT;
 	self->use_vsync = DEFAULT_USE_VSYNC;
 	self->force_aspect_ratio = DEFAULT_FORCE_ASPECT_RATIO;
 	self->window_x_coord = DEFAULT_WINDOW_X_COORD;
@@ -349,6 +480,8 @@ static void gst_imx_2d_video_sink_init(GstImx2dVideoSink *self)
 	self->drop_frames_changed = FALSE;
 
 	self->region_coords_need_update = TRUE;
+
+	gst_imx_2d_stats_tracker_init(&(self->stats_tracker), GST_OBJECT(self));
 }
 
 
@@ -357,11 +490,25 @@ static void gst_imx_2d_video_sink_dispose(GObject *object)
 	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(object);
 
 	g_free(self->framebuffer_name);
+	g_free(self->drm_device_name);
 
 	G_OBJECT_CLASS(gst_imx_2d_video_sink_parent_class)->dispose(object);
 }
 
 
+static void gst_imx_2d_video_sink_finalize(GObject *object)
+{
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(object);
+
+	gst_imx_2d_stats_tracker_cleanup(&(self->stats_tracker));
+
+	g_cond_clear(&(self->flip_cond));
+	g_mutex_clear(&(self->flip_mutex));
+
+	G_OBJECT_CLASS(gst_imx_2d_video_sink_parent_class)->finalize(object);
+}
+
+
 static void gst_imx_2d_video_sink_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
 {
 	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(object);
@@ -394,6 +541,19 @@ static void gst_imx_2d_video_sink_set_property(GObject *object, guint prop_id, G
 			break;
 		}
 
+		case PROP_DRM_DEVICE_NAME:
+		{
+			gchar const *new_drm_device_name = g_value_get_string(value);
+
+			/* An empty string is treated like NULL, meaning
+			 * that the framebuffer is used instead. */
+			GST_OBJECT_LOCK(self);
+			g_free(self->drm_device_name);
+			self->drm_device_name = ((new_drm_device_name != NULL) && (new_drm_device_name[0] != '\0')) ? g_strdup(new_drm_device_name) : NULL;
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
 		case PROP_INPUT_CROP:
 		{
 			GST_OBJECT_LOCK(self);
@@ -406,6 +566,8 @@ static void gst_imx_2d_video_sink_set_property(GObject *object, guint prop_id, G
 		{
 			GST_OBJECT_LOCK(self);
 			self->video_direction = g_value_get_enum(value);
+			/* The letterbox depends on whether the frame is transposed. */
+			self->region_coords_need_update = TRUE;
 			GST_OBJECT_UNLOCK(self);
 			break;
 		}
@@ -515,6 +677,22 @@ static void gst_imx_2d_video_sink_set_property(GObject *object, guint prop_id, G
 			break;
 		}
 
+		case PROP_SHARED_BLITTER:
+		{
+			GST_OBJECT_LOCK(self);
+			self->use_shared_blitter = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_DIRECT_SCANOUT:
+		{
+			GST_OBJECT_LOCK(self);
+			self->direct_scanout = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -545,6 +723,14 @@ static void gst_imx_2d_video_sink_get_property(GObject *object, guint prop_id, G
 			break;
 		}
 
+		case PROP_DRM_DEVICE_NAME:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_string(value, self->drm_device_name);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
 		case PROP_INPUT_CROP:
 		{
 			GST_OBJECT_LOCK(self);
@@ -657,6 +843,50 @@ static void gst_imx_2d_video_sink_get_property(GObject *object, guint prop_id, G
 			break;
 		}
 
+		case PROP_SHARED_BLITTER:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->use_shared_blitter);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_DIRECT_SCANOUT:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->direct_scanout);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_STATS:
+			g_value_take_boxed(value, gst_imx_2d_stats_tracker_create_structure(&(self->stats_tracker)));
+			break;
+
+		case PROP_FLIP_LATENCY:
+		{
+			g_mutex_lock(&(self->flip_mutex));
+			g_value_set_uint64(value, (self->num_flips > 0) ? (self->total_flip_latency / self->num_flips) : 0);
+			g_mutex_unlock(&(self->flip_mutex));
+			break;
+		}
+
+		case PROP_MAX_FLIP_LATENCY:
+		{
+			g_mutex_lock(&(self->flip_mutex));
+			g_value_set_uint64(value, self->max_flip_latency);
+			g_mutex_unlock(&(self->flip_mutex));
+			break;
+		}
+
+		case PROP_MISSED_VBLANKS:
+		{
+			g_mutex_lock(&(self->flip_mutex));
+			g_value_set_uint64(value, self->num_missed_vblanks);
+			g_mutex_unlock(&(self->flip_mutex));
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -702,6 +932,27 @@ static GstStateChangeReturn gst_imx_2d_video_sink_change_state(GstElement *eleme
 }
 
 
+static void gst_imx_2d_video_sink_set_context(GstElement *element, GstContext *context)
+{
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(element);
+	GstImx2dVideoSinkClass *klass = GST_IMX_2D_VIDEO_SINK_CLASS(G_OBJECT_GET_CLASS(self));
+	gboolean accept_shared_blitter;
+
+	/* Only pick up a shared blitter from the context if this element
+	 * is actually configured to use one and has no blitter yet.
+	 * Otherwise, it would lock (and later unref) a blitter that
+	 * is not the one it is actually blitting with. */
+	GST_OBJECT_LOCK(self);
+	accept_shared_blitter = self->use_shared_blitter && (self->blitter == NULL);
+	GST_OBJECT_UNLOCK(self);
+
+	if (accept_shared_blitter)
+		gst_imx_2d_shared_blitter_handle_set_context(element, context, klass->shared_blitter_backend_name, &(self->shared_blitter));
+
+	GST_ELEMENT_CLASS(gst_imx_2d_video_sink_parent_class)->set_context(element, context);
+}
+
+
 static gboolean gst_imx_2d_video_sink_event(GstBaseSink *sink, GstEvent *event)
 {
 	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(sink);
@@ -719,6 +970,7 @@ static gboolean gst_imx_2d_video_sink_event(GstBaseSink *sink, GstEvent *event)
 			{
 				GST_OBJECT_LOCK(self);
 				self->tag_video_direction = new_tag_video_direction;
+				self->region_coords_need_update = TRUE;
 				GST_OBJECT_UNLOCK(self);
 			}
 
@@ -733,6 +985,32 @@ static gboolean gst_imx_2d_video_sink_event(GstBaseSink *sink, GstEvent *event)
 }
 
 
+static gboolean gst_imx_2d_video_sink_query(GstBaseSink *sink, GstQuery *query)
+{
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(sink);
+	GstImx2dVideoSinkClass *klass = GST_IMX_2D_VIDEO_SINK_CLASS(G_OBJECT_GET_CLASS(self));
+	GstImx2dSharedBlitter *shared_blitter;
+	gboolean ret;
+
+	if (GST_QUERY_TYPE(query) == GST_QUERY_CONTEXT)
+	{
+		GST_OBJECT_LOCK(self);
+		shared_blitter = (self->shared_blitter != NULL) ? gst_object_ref(self->shared_blitter) : NULL;
+		GST_OBJECT_UNLOCK(self);
+
+		ret = gst_imx_2d_shared_blitter_handle_context_query(GST_ELEMENT(self), query, klass->shared_blitter_backend_name, shared_blitter);
+
+		if (shared_blitter != NULL)
+			gst_object_unref(GST_OBJECT(shared_blitter));
+
+		if (ret)
+			return TRUE;
+	}
+
+	return GST_BASE_SINK_CLASS(gst_imx_2d_video_sink_parent_class)->query(sink, query);
+}
+
+
 static gboolean gst_imx_2d_video_sink_set_caps(GstBaseSink *sink, GstCaps *caps)
 {
 	GstVideoInfo input_video_info;
@@ -765,6 +1043,20 @@ static gboolean gst_imx_2d_video_sink_set_caps(GstBaseSink *sink, GstCaps *caps)
 	self->input_surface_desc.width = GST_VIDEO_INFO_WIDTH(&input_video_info);
 	self->input_surface_desc.height = GST_VIDEO_INFO_HEIGHT(&input_video_info);
 	self->input_surface_desc.format = gst_imx_2d_convert_from_gst_video_format(GST_VIDEO_INFO_FORMAT(&input_video_info), &tile_layout);
+	gst_imx_2d_set_surface_desc_colorimetry(&(self->input_surface_desc), &input_video_info);
+
+	imx_2d_blit_plan_destroy(self->blit_plan);
+	self->blit_plan = NULL;
+
+	/* The letterbox depends on the frame size and pixel aspect ratio. */
+	GST_OBJECT_LOCK(self);
+	self->region_coords_need_update = TRUE;
+	GST_OBJECT_UNLOCK(self);
+
+	/* The new frames may be importable and shown
+	 * with a plane even if the old ones were not. */
+	self->plane_scanout_tested = FALSE;
+	self->plane_scanout_impossible = FALSE;
 
 	return TRUE;
 
@@ -773,8 +1065,15 @@ error:
 }
 
 
-static gboolean gst_imx_2d_video_sink_propose_allocation(G_GNUC_UNUSED GstBaseSink *sink, GstQuery *query)
+static gboolean gst_imx_2d_video_sink_propose_allocation(GstBaseSink *sink, GstQuery *query)
 {
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(sink);
+	GstCaps *caps;
+	gboolean need_pool;
+	GstVideoInfo video_info;
+	gboolean can_scan_out;
+	gboolean propose_scanout_pool;
+
 	/* Not chaining up to the base class since it does not have
 	 * its own propose_allocation implementation - its vmethod
 	 * propose_allocation pointer is set to NULL. */
@@ -783,6 +1082,53 @@ static gboolean gst_imx_2d_video_sink_propose_allocation(G_GNUC_UNUSED GstBaseSi
 	gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, 0);
 	gst_query_add_allocation_meta(query, GST_VIDEO_CROP_META_API_TYPE, 0);
 
+	gst_query_parse_allocation(query, &caps, &need_pool);
+
+	GST_OBJECT_LOCK(self);
+	self->scanout_reconfigure_requested = FALSE;
+	can_scan_out = (self->framebuffer_allocator != NULL)
+	            && (caps != NULL)
+	            && gst_video_info_from_caps(&video_info, caps)
+	            && gst_imx_2d_video_sink_can_scan_out_directly(self, &video_info);
+	/* Remember this so that show_frame can ask upstream for a new
+	 * allocation query if the outcome changes (for example, because
+	 * the video-direction property was modified). */
+	self->scanout_possible_at_allocation = can_scan_out;
+	GST_OBJECT_UNLOCK(self);
+
+	propose_scanout_pool = can_scan_out && need_pool;
+
+	if (propose_scanout_pool)
+	{
+		GstBufferPool *pool;
+		GstStructure *pool_config;
+		guint num_pool_buffers = self->num_fb_pages - GST_IMX_2D_VIDEO_SINK_NUM_RESERVED_FB_PAGES;
+
+		/* The pool must not allocate more buffers than there are
+		 * allocatable pages. One page is reserved for frames that
+		 * have to be blitted, and one page is always being shown,
+		 * so upstream can use the other ones while that happens. */
+
+		pool = gst_video_buffer_pool_new();
+		pool_config = gst_buffer_pool_get_config(pool);
+		gst_buffer_pool_config_set_params(pool_config, caps, GST_VIDEO_INFO_SIZE(&video_info), num_pool_buffers, num_pool_buffers);
+		gst_buffer_pool_config_set_allocator(pool_config, self->framebuffer_allocator, NULL);
+		gst_buffer_pool_config_add_option(pool_config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+
+		if (!gst_buffer_pool_set_config(pool, pool_config))
+		{
+			GST_WARNING_OBJECT(self, "could not configure direct scanout buffer pool; not proposing it");
+			gst_object_unref(GST_OBJECT(pool));
+			return TRUE;
+		}
+
+		GST_DEBUG_OBJECT(self, "proposing direct scanout buffer pool with %u framebuffer page(s)", num_pool_buffers);
+
+		gst_query_add_allocation_pool(query, pool, GST_VIDEO_INFO_SIZE(&video_info), num_pool_buffers, num_pool_buffers);
+		gst_query_add_allocation_param(query, self->framebuffer_allocator, NULL);
+		gst_object_unref(GST_OBJECT(pool));
+	}
+
 	return TRUE;
 }
 
@@ -790,15 +1136,24 @@ static gboolean gst_imx_2d_video_sink_propose_allocation(G_GNUC_UNUSED GstBaseSi
 static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_sink, GstBuffer *input_buffer)
 {
 	Imx2dBlitParams blit_params;
-	GstFlowReturn flow_ret;
+	GstFlowReturn flow_ret = GST_FLOW_OK;
 	gboolean input_crop;
 	gboolean drop_frames, drop_frames_changed;
 	Imx2dRegion inner_region;
 	Imx2dBlitMargin combined_margin;
+	Imx2dRegion margin_regions[4];
+	int num_margin_regions = 0;
 	Imx2dRegion crop_rectangle;
 	GstVideoOrientationMethod video_direction;
 	GstBuffer *uploaded_input_buffer = NULL;
+	gboolean blitter_locked = FALSE;
+	gboolean can_scan_out = FALSE;
+	gboolean request_reconfigure = FALSE;
+	gboolean clear_old_total_region;
+	Imx2dRegion old_total_region;
+	gint scanout_page = -1;
 	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK_CAST(video_sink);
+	GstImx2dVideoSinkClass *klass = GST_IMX_2D_VIDEO_SINK_CLASS(G_OBJECT_GET_CLASS(self));
 
 	g_assert(self->blitter != NULL);
 
@@ -815,7 +1170,7 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 	self->drop_frames_changed = FALSE;
 
 	/* This must be called with the object lock held. */
-	gst_imx_2d_video_sink_recalculate_regions_if_needed(self);
+	clear_old_total_region = gst_imx_2d_video_sink_recalculate_regions_if_needed(self, &old_total_region);
 
 	memcpy(&inner_region, &(self->inner_region), sizeof(inner_region));
 	memcpy(&combined_margin, &(self->combined_margin), sizeof(combined_margin));
@@ -823,9 +1178,42 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 	 * assume that the margin were invisible and skip it. */
 	combined_margin.color = 0xFF000000;
 
+	if (self->framebuffer_allocator != NULL)
+	{
+		can_scan_out = gst_imx_2d_video_sink_can_scan_out_directly(self, &(self->input_video_info));
+
+		if ((can_scan_out != self->scanout_possible_at_allocation) && !(self->scanout_reconfigure_requested))
+		{
+			request_reconfigure = TRUE;
+			self->scanout_reconfigure_requested = TRUE;
+		}
+	}
+
 	GST_OBJECT_UNLOCK(self);
 
 
+	/* Clearing waits for the flip thread, which can take several
+	 * vertical blanks, and the flip thread logs with this element
+	 * as the object, which takes the object lock. For these reasons,
+	 * the old total region is cleared only after unlocking. */
+	if (clear_old_total_region)
+	{
+		GST_TRACE_OBJECT(self, "clearing old total region %" IMX_2D_REGION_FORMAT " after it was relocated", IMX_2D_REGION_ARGS(&old_total_region));
+		if (!gst_imx_2d_video_clear_region(self, &old_total_region, TRUE))
+			goto error;
+	}
+
+
+	/* If direct scanout became possible or impossible since the last
+	 * allocation query, let upstream renegotiate the allocation, so
+	 * that it can switch to or away from the framebuffer page pool. */
+	if (request_reconfigure)
+	{
+		GST_DEBUG_OBJECT(self, "direct scanout is now %s; requesting new allocation query from upstream", can_scan_out ? "possible" : "impossible");
+		gst_pad_push_event(GST_BASE_SINK_PAD(self), gst_event_new_reconfigure());
+	}
+
+
 	/* Check if the drop-frames property changed. If it changed
 	 * from false to true, paint the output region black. */
 	if (drop_frames)
@@ -834,17 +1222,34 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 
 		if (drop_frames_changed)
 		{
+			/* This also shows one of the cleared pages. */
 			if (!gst_imx_2d_video_clear_total_region(self, TRUE))
 				goto error;
-
-			if (!gst_imx_2d_video_sink_flip_pages(self))
-				goto error;
 		}
 
 		return GST_FLOW_OK;
 	}
 
 
+	/* If upstream wrote the frame into one of the framebuffer pages,
+	 * and it can be shown as is, just pan to that page. */
+	if (self->framebuffer_allocator != NULL)
+		scanout_page = gst_imx_2d_framebuffer_allocator_get_page_of_buffer(self->framebuffer_allocator, input_buffer);
+
+	if (scanout_page >= 0)
+	{
+		GstVideoCropMeta *crop_meta = input_crop ? gst_buffer_get_video_crop_meta(input_buffer) : NULL;
+
+		if ((crop_meta != NULL) && ((crop_meta->x != 0) || (crop_meta->y != 0) || ((gint)(crop_meta->width) != GST_VIDEO_INFO_WIDTH(&(self->input_video_info))) || ((gint)(crop_meta->height) != GST_VIDEO_INFO_HEIGHT(&(self->input_video_info)))))
+			can_scan_out = FALSE;
+
+		if (can_scan_out)
+			return gst_imx_2d_video_sink_scan_out_buffer(self, input_buffer, scanout_page) ? GST_FLOW_OK : GST_FLOW_ERROR;
+
+		GST_LOG_OBJECT(self, "frame is in framebuffer page %d, but cannot be shown as is; blitting it", scanout_page);
+	}
+
+
 	/* Upload the input buffer. The uploader creates a deep  copy if necessary,
 	 * but tries to avoid that if possible by passing through the buffer (if it
 	 * consists purely of imxdmabuffer backend gstmemory blocks) or by
@@ -870,7 +1275,6 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 	/* Fill the blit parameters. */
 
 	memset(&blit_params, 0, sizeof(blit_params));
-	blit_params.margin = &combined_margin;
 	blit_params.source_region = NULL;
 	blit_params.dest_region = &inner_region;
 	blit_params.rotation = gst_imx_2d_convert_from_video_orientation_method(video_direction);
@@ -899,17 +1303,81 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 	}
 
 
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+	/* With DRM output, try to show the frame with a plane first.
+	 * The display controller then does the scaling, and the blit
+	 * is skipped entirely. Plane rotation is not used, so this is
+	 * only attempted if no rotation / flipping is requested. */
+	if ((self->drm_output != NULL) && (video_direction == GST_VIDEO_ORIENTATION_IDENTITY))
+	{
+		Imx2dRegion full_frame_region;
+		gboolean frame_shown;
+
+		if (blit_params.source_region == NULL)
+		{
+			full_frame_region.x1 = 0;
+			full_frame_region.y1 = 0;
+			full_frame_region.x2 = GST_VIDEO_INFO_WIDTH(&(self->input_video_info));
+			full_frame_region.y2 = GST_VIDEO_INFO_HEIGHT(&(self->input_video_info));
+		}
+
+		if (!gst_imx_2d_video_sink_show_frame_with_plane(
+			self,
+			uploaded_input_buffer,
+			(blit_params.source_region != NULL) ? blit_params.source_region : &full_frame_region,
+			&inner_region,
+			&frame_shown
+		))
+			goto error;
+
+		if (frame_shown)
+			goto finish;
+	}
+#endif
+
+
+	/* Pick a page to blit into. This blocks if all pages are still
+	 * queued for or shown by the flip thread. Pages that belong to
+	 * upstream's direct scanout pool are skipped, which includes
+	 * the frame's own page if it is in one. */
+	if (!gst_imx_2d_video_sink_acquire_write_fb_page(self, scanout_page))
+		goto error;
+
+	/* The margin only has to be drawn if the page does not contain it
+	 * yet. If the hardware does not draw the margin as part of the blit
+	 * for free, draw the margin separately with one multi-region fill.
+	 * This sets up the fill state only once for all margin rectangles. */
+	if (!(self->margin_valid_on_page[self->write_fb_page]))
+	{
+		if (klass->hardware_capabilities->draws_blit_margins_for_free)
+			blit_params.margin = &combined_margin;
+		else
+			num_margin_regions = imx_2d_blit_margin_get_regions(&combined_margin, &inner_region, margin_regions);
+
+		GST_LOG_OBJECT(self, "drawing margin into framebuffer page %d", self->write_fb_page);
+	}
+
+
 	/* Now perform the actual blit. */
 
 	GST_LOG_OBJECT(self, "beginning blitting procedure to transform the frame");
 
+	gst_imx_2d_shared_blitter_lock(self->shared_blitter, &(self->stats_tracker));
+	blitter_locked = TRUE;
+
 	if (!imx_2d_blitter_start(self->blitter, self->framebuffer_surface))
 	{
 		GST_ERROR_OBJECT(self, "starting blitter failed");
 		goto error;
 	}
 
-	if (!imx_2d_blitter_do_blit(self->blitter, self->input_surface, &blit_params))
+	if ((num_margin_regions > 0) && !imx_2d_blitter_fill_regions(self->blitter, margin_regions, num_margin_regions, 0x000000))
+	{
+		GST_ERROR_OBJECT(self, "filling margin failed");
+		goto error;
+	}
+
+	if (!gst_imx_2d_blit_with_plan(self->blitter, &(self->blit_plan), self->input_surface, self->framebuffer_surface, &blit_params))
 	{
 		GST_ERROR_OBJECT(self, "blitting failed");
 		goto error;
@@ -921,22 +1389,37 @@ static GstFlowReturn gst_imx_blitter_video_sink_show_frame(GstVideoSink *video_s
 		goto error;
 	}
 
+	gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
+	blitter_locked = FALSE;
+
+	self->margin_valid_on_page[self->write_fb_page] = TRUE;
+
 
+	/* Hand the page over to the flip thread. This does not wait
+	 * for the pan, so the next frame can be processed right away. */
 	if (!gst_imx_2d_video_sink_flip_pages(self))
 		goto error;
 
+	/* The blitted page covers the whole window, and flipping
+	 * to it turns off the plane, so the letterbox and margin
+	 * areas have to be cleared again if the next frame is
+	 * shown with a plane. */
+	self->plane_scanout_active = FALSE;
+
 
 	GST_LOG_OBJECT(self, "blitting procedure finished successfully; frame output complete");
 
 
 finish:
+	if (blitter_locked)
+		gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
 	/* Discard the uploaded version of the input buffer. */
 	if (uploaded_input_buffer != NULL)
 		gst_buffer_unref(uploaded_input_buffer);
 	return flow_ret;
 
 error:
-	if (flow_ret != GST_FLOW_OK)
+	if (flow_ret == GST_FLOW_OK)
 		flow_ret = GST_FLOW_ERROR;
 	goto finish;
 }
@@ -947,7 +1430,9 @@ static gboolean gst_imx_2d_video_sink_start(GstImx2dVideoSink *self)
 	gboolean ret = TRUE;
 	GstImx2dVideoSinkClass *klass = GST_IMX_2D_VIDEO_SINK_CLASS(G_OBJECT_GET_CLASS(self));
 	gboolean use_vsync;
+	gboolean direct_scanout;
 	gchar *framebuffer_name = NULL;
+	gchar *drm_device_name = NULL;
 
 	self->imx_dma_buffer_allocator = gst_imx_allocator_new();
 	self->uploader = gst_imx_video_uploader_new(self->imx_dma_buffer_allocator, klass->hardware_capabilities->stride_alignment, klass->hardware_capabilities->total_row_count_alignment);
@@ -962,10 +1447,13 @@ static gboolean gst_imx_2d_video_sink_start(GstImx2dVideoSink *self)
 
 	self->region_coords_need_update = TRUE;
 	self->total_region_valid = FALSE;
+	memset(self->margin_valid_on_page, 0, sizeof(self->margin_valid_on_page));
 
 	GST_OBJECT_LOCK(self);
 	framebuffer_name = g_strdup(self->framebuffer_name);
+	drm_device_name = g_strdup(self->drm_device_name);
 	use_vsync = self->use_vsync;
+	direct_scanout = self->direct_scanout;
 	GST_OBJECT_UNLOCK(self);
 
 	/* We call start _after_ the allocator & uploader were
@@ -990,24 +1478,92 @@ static gboolean gst_imx_2d_video_sink_start(GstImx2dVideoSink *self)
 		goto error;
 	}
 
-	self->framebuffer = imx_2d_linux_framebuffer_create(framebuffer_name, use_vsync);
-	if (self->framebuffer == NULL)
+	self->plane_scanout_tested = FALSE;
+	self->plane_scanout_possible = FALSE;
+	self->plane_scanout_impossible = FALSE;
+	self->plane_scanout_active = FALSE;
+	self->displayed_drm_framebuffer_id = 0;
+
+	if (drm_device_name != NULL)
 	{
-		GST_ERROR_OBJECT(self, "creating output framebuffer using device \"%s\" failed", framebuffer_name);
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+		self->drm_output = imx_2d_linux_drm_output_create(drm_device_name);
+		if (self->drm_output == NULL)
+		{
+			GST_ERROR_OBJECT(self, "creating DRM output using device \"%s\" failed", drm_device_name);
+			goto error;
+		}
+
+		/* KMS always flips pages at the vertical blank, and the
+		 * DRM output already shows page 0 after its modeset, so
+		 * page flipping is used regardless of use-vsync. */
+		self->num_fb_pages = imx_2d_linux_drm_output_get_num_pages(self->drm_output);
+		self->refresh_period = imx_2d_linux_drm_output_get_refresh_period(self->drm_output);
+		use_vsync = TRUE;
+
+		if (direct_scanout)
+		{
+			GST_WARNING_OBJECT(self, "direct scanout is not supported with DRM output; frames are shown with planes instead where possible");
+			direct_scanout = FALSE;
+		}
+#else
+		GST_ERROR_OBJECT(self, "DRM device \"%s\" was specified, but DRM/KMS output support was not built", drm_device_name);
 		goto error;
+#endif
+	}
+	else
+	{
+		self->framebuffer = imx_2d_linux_framebuffer_create(framebuffer_name, use_vsync);
+		if (self->framebuffer == NULL)
+		{
+			GST_ERROR_OBJECT(self, "creating output framebuffer using device \"%s\" failed", framebuffer_name);
+			goto error;
+		}
+
+		self->num_fb_pages = imx_2d_linux_framebuffer_get_num_fb_pages(self->framebuffer);
+		if (use_vsync)
+			self->refresh_period = imx_2d_linux_framebuffer_get_refresh_period(self->framebuffer);
 	}
 
 	if (use_vsync)
 	{
+		int page;
+
 		self->write_fb_page = 1;
 		self->display_fb_page = 0;
 
-		imx_2d_linux_framebuffer_set_write_fb_page(self->framebuffer, self->write_fb_page);
-		if (!imx_2d_linux_framebuffer_set_display_fb_page(self->framebuffer, self->display_fb_page))
+		gst_imx_2d_video_sink_set_write_fb_page(self, self->write_fb_page);
+		if ((self->framebuffer != NULL) && !imx_2d_linux_framebuffer_set_display_fb_page(self->framebuffer, self->display_fb_page))
 		{
 			GST_ERROR_OBJECT(self, "could not set initial framebuffer display page");
 			goto error;
 		}
+
+		for (page = 0; page < self->num_fb_pages; ++page)
+			self->page_states[page] = GST_IMX_2D_VIDEO_SINK_PAGE_STATE_FREE;
+		self->page_states[self->display_fb_page] = GST_IMX_2D_VIDEO_SINK_PAGE_STATE_DISPLAYED;
+		self->last_queued_fb_page = self->display_fb_page;
+
+		self->flip_thread_stop = FALSE;
+		self->flip_in_progress = FALSE;
+		self->flip_error = FALSE;
+		self->flip_queue_start = 0;
+		self->flip_queue_length = 0;
+		/* Atomic commits block until the vertical blank,
+		 * so no separate wait is needed with DRM output. */
+		self->wait_for_vsync_supported = (self->framebuffer != NULL);
+
+		g_mutex_lock(&(self->flip_mutex));
+		self->num_flips = 0;
+		self->total_flip_latency = 0;
+		self->max_flip_latency = 0;
+		self->num_missed_vblanks = 0;
+		self->previous_displayed_time = GST_CLOCK_TIME_NONE;
+		g_mutex_unlock(&(self->flip_mutex));
+
+		GST_DEBUG_OBJECT(self, "using %d framebuffer pages; refresh period: %" GST_TIME_FORMAT, self->num_fb_pages, GST_TIME_ARGS(self->refresh_period));
+
+		self->flip_thread = g_thread_new("imx2dvideosink-flip", gst_imx_2d_video_sink_flip_thread_func, self);
 	}
 	else
 	{
@@ -1015,17 +1571,46 @@ static gboolean gst_imx_2d_video_sink_start(GstImx2dVideoSink *self)
 		self->display_fb_page = 0;
 	}
 
-	self->num_fb_pages = imx_2d_linux_framebuffer_get_num_fb_pages(self->framebuffer);
+	if (direct_scanout)
+	{
+		/* Without page flipping, upstream would have to write
+		 * into the page that is being shown. Besides the reserved
+		 * pages, one page is shown while upstream writes into
+		 * another one. */
+		if (self->num_fb_pages < (GST_IMX_2D_VIDEO_SINK_NUM_RESERVED_FB_PAGES + 2))
+		{
+			GST_WARNING_OBJECT(self, "direct scanout requires use-vsync to be enabled; disabling direct scanout");
+		}
+		else
+		{
+			self->framebuffer_allocator = gst_imx_2d_framebuffer_allocator_new(self->framebuffer, GST_IMX_2D_VIDEO_SINK_NUM_RESERVED_FB_PAGES);
+			if (self->framebuffer_allocator == NULL)
+				GST_WARNING_OBJECT(self, "could not create framebuffer allocator; disabling direct scanout");
+		}
+	}
+
+	self->scanout_possible_at_allocation = FALSE;
+	self->scanout_reconfigure_requested = FALSE;
 
-	self->framebuffer_surface = imx_2d_linux_framebuffer_get_surface(self->framebuffer);
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+	if (self->drm_output != NULL)
+	{
+		self->framebuffer_surface = imx_2d_linux_drm_output_get_surface(self->drm_output);
+		GST_INFO_OBJECT(self, "DRM output using device \"%s\" set up", drm_device_name);
+	}
+	else
+#endif
+	{
+		self->framebuffer_surface = imx_2d_linux_framebuffer_get_surface(self->framebuffer);
+		GST_INFO_OBJECT(self, "framebuffer using device \"%s\" set up", framebuffer_name);
+	}
 	g_assert(self->framebuffer_surface != NULL);
 
 	self->framebuffer_surface_desc = imx_2d_surface_get_desc(self->framebuffer_surface);
 
-	GST_INFO_OBJECT(self, "framebuffer using device \"%s\" set up", framebuffer_name);
-
 finish:
 	g_free(framebuffer_name);
+	g_free(drm_device_name);
 	return ret;
 
 error:
@@ -1038,17 +1623,21 @@ error:
 static void gst_imx_2d_video_sink_stop(GstImx2dVideoSink *self)
 {
 	GstImx2dVideoSinkClass *klass = GST_IMX_2D_VIDEO_SINK_CLASS(G_OBJECT_GET_CLASS(self));
+	GstImx2dSharedBlitter *shared_blitter;
 
 	if ((klass->stop != NULL) && !(klass->stop(self)))
 		GST_ERROR_OBJECT(self, "stop() failed");
 
+	imx_2d_blit_plan_destroy(self->blit_plan);
+	self->blit_plan = NULL;
+
 	if (self->input_surface != NULL)
 	{
 		imx_2d_surface_destroy(self->input_surface);
 		self->input_surface = NULL;
 	}
 
-	if (self->framebuffer != NULL)
+	if ((self->framebuffer != NULL) || (self->drm_output != NULL))
 	{
 		gboolean clear_at_null;
 
@@ -1062,16 +1651,82 @@ static void gst_imx_2d_video_sink_stop(GstImx2dVideoSink *self)
 			gst_imx_2d_video_clear_total_region(self, FALSE);
 		}
 
-		imx_2d_linux_framebuffer_destroy(self->framebuffer);
-		self->framebuffer = NULL;
+		/* Let the flip thread finish the queued flips
+		 * (including the one that shows the cleared
+		 * page) before shutting it down. */
+		if (self->flip_thread != NULL)
+		{
+			gst_imx_2d_video_sink_wait_for_flips(self);
+
+			g_mutex_lock(&(self->flip_mutex));
+			self->flip_thread_stop = TRUE;
+			g_cond_broadcast(&(self->flip_cond));
+			g_mutex_unlock(&(self->flip_mutex));
+
+			g_thread_join(self->flip_thread);
+			self->flip_thread = NULL;
+
+			/* If the flip thread failed, there may still be
+			 * queued flips. Release their buffers. */
+			while (self->flip_queue_length > 0)
+			{
+				GstImx2dVideoSinkFlip *flip = &(self->flip_queue[self->flip_queue_start]);
+				if (flip->buffer != NULL)
+					gst_buffer_unref(flip->buffer);
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+				imx_2d_linux_drm_output_release_framebuffer(self->drm_output, flip->drm_framebuffer_id);
+#endif
+				self->flip_queue_start = (self->flip_queue_start + 1) % IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES;
+				self->flip_queue_length--;
+			}
+		}
+
+		if (self->framebuffer != NULL)
+		{
+			imx_2d_linux_framebuffer_destroy(self->framebuffer);
+			self->framebuffer = NULL;
+		}
+
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+		if (self->drm_output != NULL)
+		{
+			/* The framebuffer of the last frame that was shown with
+			 * a plane may still be on screen. Removing it turns off
+			 * that plane, so it can be released right away. */
+			imx_2d_linux_drm_output_release_framebuffer(self->drm_output, self->displayed_drm_framebuffer_id);
+			self->displayed_drm_framebuffer_id = 0;
+
+			imx_2d_linux_drm_output_destroy(self->drm_output);
+			self->drm_output = NULL;
+		}
+#endif
 	}
 
-	if (self->blitter != NULL)
+	gst_buffer_replace(&(self->scanout_buffer), NULL);
+
+	/* Memory blocks that are still in upstream buffer pools
+	 * keep the allocator (and its framebuffer mapping) alive. */
+	if (self->framebuffer_allocator != NULL)
 	{
-		imx_2d_blitter_destroy(self->blitter);
-		self->blitter = NULL;
+		gst_object_unref(GST_OBJECT(self->framebuffer_allocator));
+		self->framebuffer_allocator = NULL;
 	}
 
+	if (self->owns_blitter && (self->blitter != NULL))
+		imx_2d_blitter_destroy(self->blitter);
+	self->blitter = NULL;
+	self->owns_blitter = FALSE;
+
+	/* If the blitter came from the shared blitter, the latter
+	 * destroys it once no one uses it anymore. */
+	GST_OBJECT_LOCK(self);
+	shared_blitter = self->shared_blitter;
+	self->shared_blitter = NULL;
+	GST_OBJECT_UNLOCK(self);
+
+	if (shared_blitter != NULL)
+		gst_object_unref(GST_OBJECT(shared_blitter));
+
 	if (self->uploader != NULL)
 	{
 		gst_object_unref(GST_OBJECT(self->uploader));
@@ -1089,22 +1744,71 @@ static void gst_imx_2d_video_sink_stop(GstImx2dVideoSink *self)
 static gboolean gst_imx_2d_video_sink_create_blitter(GstImx2dVideoSink *self)
 {
 	GstImx2dVideoSinkClass *klass = GST_IMX_2D_VIDEO_SINK_CLASS(G_OBJECT_GET_CLASS(self));
+	gboolean use_shared_blitter;
 
 	g_assert(klass->create_blitter != NULL);
 	g_assert(self->blitter == NULL);
 
-	if (G_UNLIKELY((self->blitter = klass->create_blitter(self)) == NULL))
+	GST_OBJECT_LOCK(self);
+	use_shared_blitter = self->use_shared_blitter;
+	GST_OBJECT_UNLOCK(self);
+
+	if (use_shared_blitter && (klass->shared_blitter_backend_name == NULL))
 	{
-		GST_ERROR_OBJECT(self, "could not create blitter");
-		return FALSE;
+		GST_WARNING_OBJECT(self, "shared blitters are not supported by this element; creating own blitter");
+		use_shared_blitter = FALSE;
+	}
+
+	if (use_shared_blitter)
+	{
+		if (!gst_imx_2d_shared_blitter_ensure(GST_ELEMENT(self), klass->shared_blitter_backend_name, &(self->shared_blitter), gst_imx_2d_video_sink_create_blitter_for_sharing, self))
+			return FALSE;
+
+		self->blitter = gst_imx_2d_shared_blitter_get_blitter(self->shared_blitter);
+		self->owns_blitter = FALSE;
+		GST_DEBUG_OBJECT(self, "using shared blitter %" GST_PTR_FORMAT, (gpointer)(self->shared_blitter));
 	}
+	else
+	{
+		GstImx2dSharedBlitter *stale_shared_blitter;
 
-	GST_DEBUG_OBJECT(self, "created new blitter %" GST_PTR_FORMAT, (gpointer)(self->blitter));
+		/* Drop any shared blitter that got stored before sharing
+		 * was disabled, so the lock/unlock calls become no-ops. */
+		GST_OBJECT_LOCK(self);
+		stale_shared_blitter = self->shared_blitter;
+		self->shared_blitter = NULL;
+		GST_OBJECT_UNLOCK(self);
+
+		if (stale_shared_blitter != NULL)
+			gst_object_unref(GST_OBJECT(stale_shared_blitter));
+
+		if (G_UNLIKELY((self->blitter = klass->create_blitter(self)) == NULL))
+		{
+			GST_ERROR_OBJECT(self, "could not create blitter");
+			return FALSE;
+		}
+
+		self->owns_blitter = TRUE;
+		GST_DEBUG_OBJECT(self, "created new blitter %" GST_PTR_FORMAT, (gpointer)(self->blitter));
+	}
+
+	/* Other elements may be using a shared blitter right now. */
+	gst_imx_2d_shared_blitter_lock(self->shared_blitter, NULL);
+	gst_imx_2d_stats_tracker_attach(&(self->stats_tracker), self->blitter);
+	gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
 
 	return TRUE;
 }
 
 
+static Imx2dBlitter* gst_imx_2d_video_sink_create_blitter_for_sharing(gpointer user_data)
+{
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(user_data);
+	GstImx2dVideoSinkClass *klass = GST_IMX_2D_VIDEO_SINK_CLASS(G_OBJECT_GET_CLASS(self));
+	return klass->create_blitter(self);
+}
+
+
 static GstVideoOrientationMethod gst_imx_2d_video_sink_get_current_video_direction(GstImx2dVideoSink *self)
 {
 	return (self->video_direction == GST_VIDEO_ORIENTATION_AUTO) ? self->tag_video_direction : self->video_direction;
@@ -1113,81 +1817,518 @@ static GstVideoOrientationMethod gst_imx_2d_video_sink_get_current_video_directi
 
 static gboolean gst_imx_2d_video_sink_flip_pages(GstImx2dVideoSink *self)
 {
-	if (!self->use_vsync)
+	/* The write page must have been acquired with
+	 * gst_imx_2d_video_sink_acquire_write_fb_page()
+	 * before anything was written into it. */
+
+	if (self->flip_thread == NULL)
+		return TRUE;
+
+	return gst_imx_2d_video_sink_queue_flip(self, self->write_fb_page, NULL, 0, NULL, NULL);
+}
+
+
+static gpointer gst_imx_2d_video_sink_flip_thread_func(gpointer user_data)
+{
+	GstImx2dVideoSink *self = GST_IMX_2D_VIDEO_SINK(user_data);
+
+	g_mutex_lock(&(self->flip_mutex));
+
+	while (TRUE)
+	{
+		GstImx2dVideoSinkFlip flip;
+		GstBuffer *previous_buffer = NULL;
+		guint32 previous_drm_framebuffer_id = 0;
+		gboolean wait_for_vsync;
+		gboolean pan_ok;
+		GstClockTime dequeue_time, pan_time, completion_time, latency;
+
+		while (!(self->flip_thread_stop) && (self->flip_queue_length == 0))
+			g_cond_wait(&(self->flip_cond), &(self->flip_mutex));
+
+		if (self->flip_thread_stop)
+			break;
+
+		flip = self->flip_queue[self->flip_queue_start];
+		self->flip_queue_start = (self->flip_queue_start + 1) % IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES;
+		self->flip_queue_length--;
+		self->flip_in_progress = TRUE;
+		wait_for_vsync = self->wait_for_vsync_supported;
+
+		g_mutex_unlock(&(self->flip_mutex));
+
+		/* Pan and wait for the vertical blank without holding
+		 * the mutex, so the streaming thread can meanwhile
+		 * queue the next page. Drivers that do not block in
+		 * FBIOPAN_DISPLAY until the vertical blank need the
+		 * explicit wait, otherwise the page that was shown
+		 * until now might be overwritten while it is still
+		 * being scanned out. Drivers that do block would wait
+		 * for two vertical blanks per flip with that explicit
+		 * wait, so it is skipped once the pan is found to take
+		 * a considerable part of a refresh period. With DRM
+		 * output, the atomic commit itself blocks until the
+		 * vertical blank. */
+		dequeue_time = g_get_monotonic_time() * 1000;
+
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+		if (self->drm_output != NULL)
+		{
+			GST_LOG_OBJECT(self, "committing DRM page %d with plane framebuffer %" G_GUINT32_FORMAT, flip.page, flip.drm_framebuffer_id);
+			pan_ok = imx_2d_linux_drm_output_commit(self->drm_output, flip.page, flip.drm_framebuffer_id, &(flip.drm_source_region), &(flip.drm_dest_region), FALSE);
+		}
+		else
+#endif
+		{
+			GST_LOG_OBJECT(self, "flipping to framebuffer page %d", flip.page);
+			pan_ok = imx_2d_linux_framebuffer_set_display_fb_page(self->framebuffer, flip.page);
+		}
+
+		pan_time = g_get_monotonic_time() * 1000;
+
+		if (pan_ok && wait_for_vsync && (self->refresh_period > 0) && ((gint64)(pan_time - dequeue_time) >= (self->refresh_period / 2)))
+		{
+			GST_INFO_OBJECT(self, "framebuffer pan took %" GST_TIME_FORMAT " and therefore blocks until vsync; not waiting for vsync separately", GST_TIME_ARGS(pan_time - dequeue_time));
+			wait_for_vsync = FALSE;
+		}
+
+		if (pan_ok && wait_for_vsync && !imx_2d_linux_framebuffer_wait_for_vsync(self->framebuffer))
+		{
+			GST_INFO_OBJECT(self, "framebuffer does not support waiting for vsync; relying on the pan to wait for it");
+			wait_for_vsync = FALSE;
+		}
+
+		completion_time = g_get_monotonic_time() * 1000;
+
+		g_mutex_lock(&(self->flip_mutex));
+
+		self->flip_in_progress = FALSE;
+		self->wait_for_vsync_supported = wait_for_vsync;
+
+		if (pan_ok)
+		{
+			latency = completion_time - flip.queue_time;
+
+			self->num_flips++;
+			self->total_flip_latency += latency;
+			self->max_flip_latency = MAX(self->max_flip_latency, latency);
+			/* Round the number of refresh periods between the two
+			 * displayed frames to be robust against jitter. Pages
+			 * that were queued after the previous one was shown
+			 * are not counted, since the sink had nothing to show
+			 * then, and no vertical blank was missed by the flip. */
+			if ((self->refresh_period > 0) && GST_CLOCK_TIME_IS_VALID(self->previous_displayed_time) && (flip.queue_time <= self->previous_displayed_time))
+			{
+				guint64 num_periods = (completion_time - self->previous_displayed_time + self->refresh_period / 2) / self->refresh_period;
+				if (num_periods > 1)
+					self->num_missed_vblanks += num_periods - 1;
+			}
+			self->previous_displayed_time = completion_time;
+
+			/* A page of -1 means that a plane shows the frame
+			 * on top of the page that is already being shown. */
+			if (flip.page >= 0)
+			{
+				if (self->display_fb_page != flip.page)
+				{
+					self->page_states[self->display_fb_page] = GST_IMX_2D_VIDEO_SINK_PAGE_STATE_FREE;
+					self->display_fb_page = flip.page;
+				}
+				self->page_states[flip.page] = GST_IMX_2D_VIDEO_SINK_PAGE_STATE_DISPLAYED;
+			}
+
+			/* The page of the previously shown frame is no longer
+			 * shown, so if upstream wrote that frame directly into
+			 * the page, it can now reuse it. Hold on to the new
+			 * buffer for the same reason. The same applies to
+			 * the buffer of a frame shown with a plane. */
+			previous_buffer = self->scanout_buffer;
+			self->scanout_buffer = flip.buffer;
+			previous_drm_framebuffer_id = self->displayed_drm_framebuffer_id;
+			self->displayed_drm_framebuffer_id = flip.drm_framebuffer_id;
+		}
+		else
+		{
+			GST_ERROR_OBJECT(self, "could not set new framebuffer display page");
+			self->flip_error = TRUE;
+			if (flip.page >= 0)
+				self->page_states[flip.page] = GST_IMX_2D_VIDEO_SINK_PAGE_STATE_FREE;
+			previous_buffer = flip.buffer;
+			previous_drm_framebuffer_id = flip.drm_framebuffer_id;
+		}
+
+		g_cond_broadcast(&(self->flip_cond));
+
+		if ((previous_buffer != NULL) || (previous_drm_framebuffer_id != 0))
+		{
+			/* Unref outside of the mutex, since this may
+			 * return the buffer to upstream's pool. */
+			g_mutex_unlock(&(self->flip_mutex));
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+			imx_2d_linux_drm_output_release_framebuffer(self->drm_output, previous_drm_framebuffer_id);
+#endif
+			if (previous_buffer != NULL)
+				gst_buffer_unref(previous_buffer);
+			g_mutex_lock(&(self->flip_mutex));
+		}
+	}
+
+	g_mutex_unlock(&(self->flip_mutex));
+
+	return NULL;
+}
+
+
+static gboolean gst_imx_2d_video_sink_acquire_write_fb_page(GstImx2dVideoSink *self, int excluded_page)
+{
+	int i, page = -1;
+	gboolean ret = TRUE;
+
+	if (self->flip_thread == NULL)
 		return TRUE;
 
-	self->display_fb_page = self->write_fb_page;
-	self->write_fb_page = (self->write_fb_page + 1) % self->num_fb_pages;
+	g_mutex_lock(&(self->flip_mutex));
+
+	while (!(self->flip_error))
+	{
+		/* Start after the most recently queued page to cycle
+		 * through all pages instead of always reusing the
+		 * same ones. */
+		for (i = 1; i <= self->num_fb_pages; ++i)
+		{
+			int candidate = (self->last_queued_fb_page + i) % self->num_fb_pages;
+			if ((candidate != excluded_page)
+			 && (self->page_states[candidate] == GST_IMX_2D_VIDEO_SINK_PAGE_STATE_FREE)
+			 && ((self->framebuffer_allocator == NULL) || !gst_imx_2d_framebuffer_allocator_is_page_in_use(self->framebuffer_allocator, candidate)))
+			{
+				page = candidate;
+				break;
+			}
+		}
+
+		if (page >= 0)
+			break;
+
+		GST_LOG_OBJECT(self, "no free framebuffer page; waiting for the flip thread");
+		g_cond_wait(&(self->flip_cond), &(self->flip_mutex));
+	}
+
+	if (self->flip_error)
+		ret = FALSE;
+
+	g_mutex_unlock(&(self->flip_mutex));
+
+	if (ret)
+	{
+		self->write_fb_page = page;
+		gst_imx_2d_video_sink_set_write_fb_page(self, self->write_fb_page);
+	}
+
+	return ret;
+}
+
 
-	imx_2d_linux_framebuffer_set_write_fb_page(self->framebuffer, self->write_fb_page);
-	if (!imx_2d_linux_framebuffer_set_display_fb_page(self->framebuffer, self->display_fb_page))
+static gboolean gst_imx_2d_video_sink_queue_flip(GstImx2dVideoSink *self, int page, GstBuffer *buffer, guint32 drm_framebuffer_id, Imx2dRegion const *drm_source_region, Imx2dRegion const *drm_dest_region)
+{
+	GstImx2dVideoSinkFlip *flip;
+	gboolean ret = TRUE;
+
+	g_mutex_lock(&(self->flip_mutex));
+
+	while (!(self->flip_error) && (self->flip_queue_length == IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES))
+		g_cond_wait(&(self->flip_cond), &(self->flip_mutex));
+
+	if (self->flip_error)
+	{
+		/* The flip thread would have released the
+		 * framebuffer once it is no longer shown. */
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+		imx_2d_linux_drm_output_release_framebuffer(self->drm_output, drm_framebuffer_id);
+#endif
+		ret = FALSE;
+		goto finish;
+	}
+
+	flip = &(self->flip_queue[(self->flip_queue_start + self->flip_queue_length) % IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES]);
+	flip->page = page;
+	flip->buffer = (buffer != NULL) ? gst_buffer_ref(buffer) : NULL;
+	flip->drm_framebuffer_id = drm_framebuffer_id;
+	if (drm_framebuffer_id != 0)
 	{
-		GST_ERROR_OBJECT(self, "could not set new framebuffer display page");
+		memcpy(&(flip->drm_source_region), drm_source_region, sizeof(Imx2dRegion));
+		memcpy(&(flip->drm_dest_region), drm_dest_region, sizeof(Imx2dRegion));
+	}
+	flip->queue_time = g_get_monotonic_time() * 1000;
+	self->flip_queue_length++;
+
+	if (page >= 0)
+	{
+		self->page_states[page] = GST_IMX_2D_VIDEO_SINK_PAGE_STATE_PENDING;
+		self->last_queued_fb_page = page;
+	}
+
+	g_cond_broadcast(&(self->flip_cond));
+
+finish:
+	g_mutex_unlock(&(self->flip_mutex));
+	return ret;
+}
+
+
+static void gst_imx_2d_video_sink_wait_for_flips(GstImx2dVideoSink *self)
+{
+	if (self->flip_thread == NULL)
+		return;
+
+	g_mutex_lock(&(self->flip_mutex));
+	while (!(self->flip_error) && ((self->flip_queue_length > 0) || self->flip_in_progress))
+		g_cond_wait(&(self->flip_cond), &(self->flip_mutex));
+	g_mutex_unlock(&(self->flip_mutex));
+}
+
+
+static gboolean gst_imx_2d_video_sink_can_scan_out_directly(GstImx2dVideoSink *self, GstVideoInfo const *video_info)
+{
+	/* This must be called with the object lock held. */
+
+	Imx2dSurfaceDesc const *fb_desc = self->framebuffer_surface_desc;
+
+	g_assert(self->framebuffer_allocator != NULL);
+
+	/* The frame must have the exact memory layout of a framebuffer page ... */
+	if ((gst_imx_2d_convert_from_gst_video_format(GST_VIDEO_INFO_FORMAT(video_info), NULL) != fb_desc->format)
+	 || (GST_VIDEO_INFO_WIDTH(video_info) != fb_desc->width)
+	 || (GST_VIDEO_INFO_HEIGHT(video_info) != fb_desc->height)
+	 || (GST_VIDEO_INFO_N_PLANES(video_info) != 1)
+	 || (GST_VIDEO_INFO_PLANE_STRIDE(video_info, 0) != fb_desc->plane_strides[0])
+	 || (GST_VIDEO_INFO_SIZE(video_info) > gst_imx_2d_framebuffer_allocator_get_page_size(self->framebuffer_allocator)))
+		return FALSE;
+
+	/* ... and it must cover the whole screen as is. */
+	if ((self->window_x_coord != 0) || (self->window_y_coord != 0)
+	 || ((self->window_width != 0) && ((gint)(self->window_width) != fb_desc->width))
+	 || ((self->window_height != 0) && ((gint)(self->window_height) != fb_desc->height))
+	 || (self->extra_margin.left_margin != 0) || (self->extra_margin.top_margin != 0)
+	 || (self->extra_margin.right_margin != 0) || (self->extra_margin.bottom_margin != 0)
+	 || (gst_imx_2d_video_sink_get_current_video_direction(self) != GST_VIDEO_ORIENTATION_IDENTITY))
+		return FALSE;
+
+	return TRUE;
+}
+
+
+static gboolean gst_imx_2d_video_sink_scan_out_buffer(GstImx2dVideoSink *self, GstBuffer *input_buffer, gint page)
+{
+	/* Make sure upstream finished writing into the page
+	 * (for example with an asynchronous blit) first. */
+	if (!gst_imx_dma_buffer_memory_wait_fence(gst_buffer_peek_memory(input_buffer, 0)))
+	{
+		GST_ERROR_OBJECT(self, "asynchronous write into framebuffer page %d failed", page);
 		return FALSE;
 	}
-	else
+
+	GST_LOG_OBJECT(self, "showing frame by panning to framebuffer page %d", page);
+
+	/* Upstream wrote a whole frame into the page,
+	 * so whatever margin it contained is gone. */
+	self->margin_valid_on_page[page] = FALSE;
+
+	/* The flip thread holds on to the buffer until another
+	 * frame is shown. Otherwise, it would go back to the pool,
+	 * and upstream could write into the page while it is
+	 * still visible. */
+	return gst_imx_2d_video_sink_queue_flip(self, page, input_buffer, 0, NULL, NULL);
+}
+
+
+static void gst_imx_2d_video_sink_set_write_fb_page(GstImx2dVideoSink *self, int page)
+{
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+	if (self->drm_output != NULL)
+	{
+		imx_2d_linux_drm_output_set_write_page(self->drm_output, page);
+		return;
+	}
+#endif
+
+	imx_2d_linux_framebuffer_set_write_fb_page(self->framebuffer, page);
+}
+
+
+#ifdef WITH_IMX2D_LINUX_DRM_OUTPUT
+static gboolean gst_imx_2d_video_sink_show_frame_with_plane(GstImx2dVideoSink *self, GstBuffer *buffer, Imx2dRegion const *source_region, Imx2dRegion const *dest_region, gboolean *frame_shown)
+{
+	guint32 framebuffer_id;
+
+	*frame_shown = FALSE;
+
+	if (self->plane_scanout_impossible)
+		return TRUE;
+
+	/* The framebuffer refers to the input frame's DMA-BUF directly,
+	 * so the frame must be fully written before it can be shown. */
+	if (!gst_imx_dma_buffer_memory_wait_fence(gst_buffer_peek_memory(buffer, 0)))
+	{
+		GST_ERROR_OBJECT(self, "asynchronous write into input frame failed");
+		return FALSE;
+	}
+
+	framebuffer_id = imx_2d_linux_drm_output_import_surface(self->drm_output, self->input_surface);
+	if (framebuffer_id == 0)
+	{
+		GST_DEBUG_OBJECT(self, "could not import input frame as DRM framebuffer; blitting frames until the caps change");
+		self->plane_scanout_impossible = TRUE;
 		return TRUE;
+	}
+
+	/* Whether the display controller can show the frame depends
+	 * on the format and on the scaling factors, so test again
+	 * whenever the regions change. The test commit must not be
+	 * run concurrently with the flip thread's commits. */
+	if (!(self->plane_scanout_tested)
+	 || (memcmp(source_region, &(self->plane_scanout_tested_source_region), sizeof(Imx2dRegion)) != 0)
+	 || (memcmp(dest_region, &(self->plane_scanout_tested_dest_region), sizeof(Imx2dRegion)) != 0))
+	{
+		gst_imx_2d_video_sink_wait_for_flips(self);
+
+		self->plane_scanout_possible = imx_2d_linux_drm_output_commit(self->drm_output, -1, framebuffer_id, source_region, dest_region, TRUE);
+		self->plane_scanout_tested = TRUE;
+		memcpy(&(self->plane_scanout_tested_source_region), source_region, sizeof(Imx2dRegion));
+		memcpy(&(self->plane_scanout_tested_dest_region), dest_region, sizeof(Imx2dRegion));
+
+		GST_DEBUG_OBJECT(
+			self,
+			"plane scanout from source region (%d, %d) - (%d, %d) to dest region (%d, %d) - (%d, %d) is %s",
+			source_region->x1, source_region->y1, source_region->x2, source_region->y2,
+			dest_region->x1, dest_region->y1, dest_region->x2, dest_region->y2,
+			self->plane_scanout_possible ? "possible" : "not possible; blitting instead"
+		);
+	}
+
+	if (!(self->plane_scanout_possible))
+	{
+		imx_2d_linux_drm_output_release_framebuffer(self->drm_output, framebuffer_id);
+		return TRUE;
+	}
+
+	/* The plane only covers the inner region. The letterbox and
+	 * margin areas around it show the primary plane's page, so
+	 * clear the pages when switching over from blitted frames. */
+	if (!(self->plane_scanout_active))
+	{
+		if (!gst_imx_2d_video_clear_total_region(self, TRUE))
+		{
+			imx_2d_linux_drm_output_release_framebuffer(self->drm_output, framebuffer_id);
+			return FALSE;
+		}
+
+		self->plane_scanout_active = TRUE;
+	}
+
+	GST_LOG_OBJECT(self, "showing frame with plane using DRM framebuffer %" G_GUINT32_FORMAT, framebuffer_id);
+
+	/* The flip thread holds on to the buffer and releases
+	 * the framebuffer once another frame is shown. */
+	if (!gst_imx_2d_video_sink_queue_flip(self, -1, buffer, framebuffer_id, source_region, dest_region))
+		return FALSE;
+
+	*frame_shown = TRUE;
+	return TRUE;
 }
+#endif
 
 
 static gboolean gst_imx_2d_video_clear_total_region(GstImx2dVideoSink *self, gboolean clear_on_all_pages)
+{
+	if (!self->total_region_valid)
+		return TRUE;
+
+	return gst_imx_2d_video_clear_region(self, &(self->total_region), clear_on_all_pages);
+}
+
+
+static gboolean gst_imx_2d_video_clear_region(GstImx2dVideoSink *self, Imx2dRegion const *region, gboolean clear_on_all_pages)
 {
 	int page_index;
 	int num_pages;
+	gboolean ret = TRUE;
 
-	if (!self->total_region_valid)
-		return TRUE;
+	num_pages = clear_on_all_pages ? self->num_fb_pages : 1;
 
-	num_pages = clear_on_all_pages ? imx_2d_linux_framebuffer_get_num_fb_pages(self->framebuffer) : 1;
+	/* Clearing all pages includes the ones that are queued
+	 * for flipping, so wait until the flip thread is done
+	 * with them. Otherwise, clear a free page. */
+	if (clear_on_all_pages)
+		gst_imx_2d_video_sink_wait_for_flips(self);
+	else if (!gst_imx_2d_video_sink_acquire_write_fb_page(self, -1))
+		return FALSE;
 
 	for (page_index = 0; page_index < num_pages; ++page_index)
 	{
-		if (self->use_vsync && clear_on_all_pages)
+		if ((self->flip_thread != NULL) && clear_on_all_pages)
 		{
 			GST_DEBUG_OBJECT(self, "clearing FB page %d", page_index);
-			imx_2d_linux_framebuffer_set_write_fb_page(self->framebuffer, page_index);
+			gst_imx_2d_video_sink_set_write_fb_page(self, page_index);
 		}
 
+		gst_imx_2d_shared_blitter_lock(self->shared_blitter, &(self->stats_tracker));
+
 		if (!imx_2d_blitter_start(self->blitter, self->framebuffer_surface))
 		{
 			GST_ERROR_OBJECT(self, "starting blitter failed");
-			return FALSE;
+			ret = FALSE;
 		}
-
-		if (!imx_2d_blitter_fill_region(self->blitter, &(self->total_region), 0xFF000000))
+		else if (!imx_2d_blitter_fill_region(self->blitter, region, 0xFF000000))
 		{
 			GST_ERROR_OBJECT(self, "blitting failed");
-			return FALSE;
+			ret = FALSE;
 		}
-
-		if (!imx_2d_blitter_finish(self->blitter))
+		else if (!imx_2d_blitter_finish(self->blitter))
 		{
 			GST_ERROR_OBJECT(self, "finishing blitter failed");
-			return FALSE;
+			ret = FALSE;
 		}
+
+		gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
+
+		if (!ret)
+			return FALSE;
 	}
 
-	self->write_fb_page = 0;
-	gst_imx_2d_video_sink_flip_pages(self);
+	/* Show a cleared page. If all pages were cleared, any
+	 * free page will do; acquiring it also restores the
+	 * framebuffer's write page that was changed above. */
+	if (clear_on_all_pages && !gst_imx_2d_video_sink_acquire_write_fb_page(self, -1))
+		return FALSE;
+
+	/* Flipping to a cleared page also turns off
+	 * the plane if a frame was shown with one. */
+	self->plane_scanout_active = FALSE;
 
-	return TRUE;
+	return gst_imx_2d_video_sink_flip_pages(self);
 }
 
 
-static void gst_imx_2d_video_sink_recalculate_regions_if_needed(GstImx2dVideoSink *self)
+static gboolean gst_imx_2d_video_sink_recalculate_regions_if_needed(GstImx2dVideoSink *self, Imx2dRegion *region_to_clear)
 {
-	/* This must be called with the object lock held. */
+	/* This must be called with the object lock held. Clearing
+	 * must not be done with that lock held, so if the old total
+	 * region needs to be cleared, it is copied to region_to_clear,
+	 * and TRUE is returned. The caller then clears it after
+	 * releasing the lock. */
 
 	gint input_width, input_height;
 	gint window_width, window_height;
+	gboolean clear_old_total_region = FALSE;
 
 	if (!self->region_coords_need_update)
-		return;
+		return FALSE;
 
-	if (self->clear_on_relocate)
+	if (self->clear_on_relocate && self->total_region_valid)
 	{
 		GST_TRACE_OBJECT(self, "need to clear total region %" IMX_2D_REGION_FORMAT " before relocating it", IMX_2D_REGION_ARGS(&(self->total_region)));
-		gst_imx_2d_video_clear_total_region(self, TRUE);
+		memcpy(region_to_clear, &(self->total_region), sizeof(Imx2dRegion));
+		clear_old_total_region = TRUE;
 	}
 
 	input_width = GST_VIDEO_INFO_WIDTH(&(self->input_video_info));
@@ -1291,9 +2432,17 @@ static void gst_imx_2d_video_sink_recalculate_regions_if_needed(GstImx2dVideoSin
 
 	GST_DEBUG_OBJECT(self, "calculated inner region: %" IMX_2D_REGION_FORMAT, IMX_2D_REGION_ARGS(&(self->inner_region)));
 
+	/* The blit plan was computed for the old regions, and the
+	 * margins in the pages were drawn for the old regions. */
+	imx_2d_blit_plan_destroy(self->blit_plan);
+	self->blit_plan = NULL;
+	memset(self->margin_valid_on_page, 0, sizeof(self->margin_valid_on_page));
+
 	/* Mark the coordinates as updated so they are not
 	 * needlessly recalculated later. */
 	self->region_coords_need_update = FALSE;
+
+	return clear_old_total_region;
 }
 
 
@@ -24,6 +24,9 @@
 #include "gst/imx/video/gstimxvideouploader.h"
 #include "imx2d/imx2d.h"
 #include "imx2d/linux_framebuffer.h"
+#include "imx2d/linux_drm_output.h"
+#include "gstimx2dsharedblitter.h"
+#include "gstimx2dstats.h"
 
 
 G_BEGIN_DECLS
@@ -42,6 +45,40 @@ typedef struct _GstImx2dVideoSink GstImx2dVideoSink;
 typedef struct _GstImx2dVideoSinkClass GstImx2dVideoSinkClass;
 
 
+/* States of framebuffer pages when page flipping is used.
+ * FREE pages can be written into. PENDING pages are queued
+ * for the flip thread. The DISPLAYED page is the one that
+ * the flip thread most recently panned to. */
+typedef enum
+{
+	GST_IMX_2D_VIDEO_SINK_PAGE_STATE_FREE,
+	GST_IMX_2D_VIDEO_SINK_PAGE_STATE_PENDING,
+	GST_IMX_2D_VIDEO_SINK_PAGE_STATE_DISPLAYED
+}
+GstImx2dVideoSinkPageState;
+
+
+typedef struct
+{
+	/* Page to show. With DRM output, this can be -1
+	 * to keep showing the current page, which is the
+	 * case when the frame is shown by a plane. */
+	int page;
+	/* Buffer whose memory is the page (with direct
+	 * scanout) or the imported DRM framebuffer, or
+	 * NULL if the frame was blitted. */
+	GstBuffer *buffer;
+	/* Imported DRM framebuffer to show with a plane,
+	 * or 0 if none. The flip thread releases it once
+	 * another framebuffer is shown. */
+	guint32 drm_framebuffer_id;
+	Imx2dRegion drm_source_region;
+	Imx2dRegion drm_dest_region;
+	GstClockTime queue_time;
+}
+GstImx2dVideoSinkFlip;
+
+
 struct _GstImx2dVideoSink
 {
 	GstVideoSink parent;
@@ -51,23 +88,69 @@ struct _GstImx2dVideoSink
 	GstImxVideoUploader *uploader;
 	GstAllocator *imx_dma_buffer_allocator;
 
+	/* If the shared-blitter property is enabled, this blitter
+	 * belongs to shared_blitter, and every blitter sequence must
+	 * be enclosed in gst_imx_2d_shared_blitter_lock() and
+	 * gst_imx_2d_shared_blitter_unlock() calls. */
 	Imx2dBlitter *blitter;
+	GstImx2dSharedBlitter *shared_blitter;
+	/* TRUE if blitter was created by this element (and not taken
+	 * from shared_blitter), meaning that stop() must destroy it. */
+	gboolean owns_blitter;
 
 	GstVideoInfo input_video_info;
 	Imx2dSurface *input_surface;
 	Imx2dSurfaceDesc input_surface_desc;
 
+	/* Only one of these two is set. If the drm-device
+	 * property is set, frames are output with DRM/KMS,
+	 * otherwise with the Linux framebuffer. In both cases,
+	 * framebuffer_surface is the surface to blit into. */
 	Imx2dLinuxFramebuffer *framebuffer;
+	Imx2dLinuxDrmOutput *drm_output;
 	Imx2dSurface *framebuffer_surface;
 	Imx2dSurfaceDesc const *framebuffer_surface_desc;
 
+	/* DRM plane scanout states. If the display controller
+	 * can show the input frames with a plane (including any
+	 * scaling), no blit is necessary. Whether it can is
+	 * checked with a test-only commit whenever the source or
+	 * destination region changes. plane_scanout_impossible
+	 * is set if the input frames cannot be imported at all;
+	 * it is reset when the caps change. plane_scanout_active
+	 * is TRUE if the last frame was shown with a plane. */
+	gboolean plane_scanout_tested;
+	gboolean plane_scanout_possible;
+	gboolean plane_scanout_impossible;
+	gboolean plane_scanout_active;
+	Imx2dRegion plane_scanout_tested_source_region;
+	Imx2dRegion plane_scanout_tested_dest_region;
+
+	/* Direct scanout states. framebuffer_allocator is only
+	 * set if the direct-scanout property is enabled and page
+	 * flipping is used. scanout_buffer is the buffer whose
+	 * page is currently shown (if that frame was shown by
+	 * panning); it is accessed with flip_mutex held. The
+	 * other two fields are accessed with the object lock held. */
+	GstAllocator *framebuffer_allocator;
+	GstBuffer *scanout_buffer;
+	gboolean scanout_possible_at_allocation;
+	gboolean scanout_reconfigure_requested;
+
+	/* Precomputed blit from input_surface to framebuffer_surface.
+	 * Discarded when the caps or the region coordinates change. */
+	Imx2dBlitPlan *blit_plan;
+
 	gboolean drop_frames;
 	gchar *framebuffer_name;
+	gchar *drm_device_name;
 	gboolean input_crop;
 	GstVideoOrientationMethod video_direction;
 	gboolean use_vsync;
 	gboolean clear_at_null;
 	gboolean clear_on_relocate;
+	gboolean use_shared_blitter;
+	gboolean direct_scanout;
 	gboolean force_aspect_ratio;
 	gint window_x_coord, window_y_coord;
 	guint window_width, window_height;
@@ -81,6 +164,44 @@ struct _GstImx2dVideoSink
 	int display_fb_page;
 	int num_fb_pages;
 
+	/* Page flipping states. With use-vsync enabled, the
+	 * framebuffer is panned in flip_thread, so show_frame
+	 * does not have to wait for the pan and the vertical
+	 * blank. show_frame blits into a FREE page and queues
+	 * it; it only blocks if no page is FREE. All fields
+	 * below as well as display_fb_page and
+	 * displayed_drm_framebuffer_id are accessed with
+	 * flip_mutex held. flip_cond is signaled whenever the
+	 * queue or the page states change. The flip thread
+	 * never takes the object lock. */
+	GThread *flip_thread;
+	GMutex flip_mutex;
+	GCond flip_cond;
+	gboolean flip_thread_stop;
+	gboolean flip_in_progress;
+	gboolean flip_error;
+	GstImx2dVideoSinkFlip flip_queue[IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES];
+	int flip_queue_start, flip_queue_length;
+	GstImx2dVideoSinkPageState page_states[IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES];
+	int last_queued_fb_page;
+	guint32 displayed_drm_framebuffer_id;
+	gboolean wait_for_vsync_supported;
+	/* In nanoseconds. 0 if unknown. */
+	gint64 refresh_period;
+
+	/* Flip statistics. The latency is the time from queuing
+	 * a page until the flip thread finished showing it. If a
+	 * page was already queued when the previous one was shown,
+	 * it should be shown one refresh period later; any further
+	 * refresh period that passes until then counts as a missed
+	 * vertical blank. previous_displayed_time is the time when
+	 * the previous page was shown, or GST_CLOCK_TIME_NONE. */
+	guint64 num_flips;
+	guint64 total_flip_latency;
+	guint64 max_flip_latency;
+	guint64 num_missed_vblanks;
+	GstClockTime previous_displayed_time;
+
 	/* Terminology:
 	 *
 	 * inner_region = The region covered by the actual
@@ -127,6 +248,15 @@ struct _GstImx2dVideoSink
 
 	gboolean region_coords_need_update;
 	gboolean total_region_valid;
+
+	/* Per-page flags that are TRUE if the page's combined_margin
+	 * area already contains the black margin pixels for the current
+	 * regions. Frames blitted into such a page skip the margin fill,
+	 * so the letterbox bars are not repainted on every frame. All
+	 * flags are cleared when the regions are recalculated. */
+	gboolean margin_valid_on_page[IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES];
+
+	GstImx2dStatsTracker stats_tracker;
 };
 
 
@@ -139,6 +269,10 @@ struct _GstImx2dVideoSinkClass
 
 	Imx2dBlitter* (*create_blitter)(GstImx2dVideoSink *imx_2d_video_sink);
 
+	/* Name of the backend for the shared blitter context type.
+	 * NULL if the subclass does not support shared blitters. */
+	gchar const *shared_blitter_backend_name;
+
 	Imx2dHardwareCapabilities const *hardware_capabilities;
 };
 
@@ -33,13 +33,23 @@ enum
 	PROP_0,
 	PROP_INPUT_CROP,
 	PROP_VIDEO_DIRECTION,
-	PROP_DISABLE_PASSTHROUGH
+	PROP_DISABLE_PASSTHROUGH,
+	PROP_ASYNC_FINISH,
+	PROP_MAX_FRAMES_IN_FLIGHT,
+	PROP_CROP_META_PASSTHROUGHS,
+	PROP_CAPS_CACHE_HITS,
+	PROP_CAPS_CACHE_MISSES,
+	PROP_STATS,
+	PROP_SHARED_BLITTER
 };
 
 
 #define DEFAULT_INPUT_CROP TRUE
 #define DEFAULT_VIDEO_DIRECTION GST_VIDEO_ORIENTATION_IDENTITY
 #define DEFAULT_DISABLE_PASSTHROUGH FALSE
+#define DEFAULT_ASYNC_FINISH FALSE
+#define DEFAULT_MAX_FRAMES_IN_FLIGHT 1
+#define DEFAULT_SHARED_BLITTER FALSE
 
 
 /* Cached quark to avoid contention on the global quark table lock */
@@ -63,15 +73,20 @@ G_DEFINE_ABSTRACT_TYPE_WITH_CODE(
 /* Base class function overloads. */
 
 /* General element operations. */
+static void gst_imx_2d_video_transform_finalize(GObject *object);
 static void gst_imx_2d_video_transform_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
 static void gst_imx_2d_video_transform_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
 static GstStateChangeReturn gst_imx_2d_video_transform_change_state(GstElement *element, GstStateChange transition);
+static void gst_imx_2d_video_transform_set_context(GstElement *element, GstContext *context);
+static gboolean gst_imx_2d_video_transform_query(GstBaseTransform *transform, GstPadDirection direction, GstQuery *query);
 static gboolean gst_imx_2d_video_transform_sink_event(GstBaseTransform *transform, GstEvent *event);
 static gboolean gst_imx_2d_video_transform_src_event(GstBaseTransform *transform, GstEvent *event);
 
 /* Caps handling. */
 static GstCaps* gst_imx_2d_video_transform_transform_caps(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *filter);
+static GstCaps* gst_imx_2d_video_transform_transform_caps_uncached(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *filter);
 static GstCaps* gst_imx_2d_video_transform_fixate_caps(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *othercaps);
+static GstCaps* gst_imx_2d_video_transform_fixate_caps_uncached(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *othercaps);
 static GstCaps* gst_imx_2d_video_transform_fixate_size_caps(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *othercaps);
 static void gst_imx_2d_video_transform_fixate_format_caps(GstBaseTransform *transform, GstCaps *caps, GstCaps *othercaps);
 static gboolean gst_imx_2d_video_transform_set_caps(GstBaseTransform *transform, GstCaps *input_caps, GstCaps *output_caps);
@@ -95,7 +110,12 @@ static gboolean gst_imx_2d_video_transform_copy_metadata(GstBaseTransform *trans
 static gboolean gst_imx_2d_video_transform_start(GstImx2dVideoTransform *self);
 static void gst_imx_2d_video_transform_stop(GstImx2dVideoTransform *self);
 static gboolean gst_imx_2d_video_transform_create_blitter(GstImx2dVideoTransform *self);
+static Imx2dBlitter* gst_imx_2d_video_transform_create_blitter_for_sharing(gpointer user_data);
+static void gst_imx_2d_video_transform_wait_for_pending_blits(GstImx2dVideoTransform *self, guint max_num_pending_blits);
 static GstVideoOrientationMethod gst_imx_2d_video_transform_get_current_video_direction(GstImx2dVideoTransform *self);
+static GstCaps* gst_imx_2d_video_transform_lookup_caps_cache(GstImx2dVideoTransformCapsCacheEntry *cache, GstPadDirection direction, GstCaps *caps, GstCaps *other_caps);
+static void gst_imx_2d_video_transform_insert_into_caps_cache(GstImx2dVideoTransformCapsCacheEntry *cache, guint *next_entry, GstPadDirection direction, GstCaps *caps, GstCaps *other_caps, GstCaps *result);
+static void gst_imx_2d_video_transform_clear_caps_caches(GstImx2dVideoTransform *self);
 
 
 
@@ -116,13 +136,16 @@ static void gst_imx_2d_video_transform_class_init(GstImx2dVideoTransformClass *k
 	element_class = GST_ELEMENT_CLASS(klass);
 	base_transform_class = GST_BASE_TRANSFORM_CLASS(klass);
 
+	object_class->finalize                      = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_finalize);
 	object_class->set_property                  = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_set_property);
 	object_class->get_property                  = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_get_property);
 
 	element_class->change_state                 = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_change_state);
+	element_class->set_context                  = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_set_context);
 
 	base_transform_class->sink_event            = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_sink_event);
 	base_transform_class->src_event             = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_src_event);
+	base_transform_class->query                 = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_query);
 	base_transform_class->transform_caps        = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_transform_caps);
 	base_transform_class->fixate_caps           = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_fixate_caps);
 	base_transform_class->set_caps              = GST_DEBUG_FUNCPTR(gst_imx_2d_video_transform_set_caps);
@@ -142,6 +165,7 @@ static void gst_imx_2d_video_transform_class_init(GstImx2dVideoTransformClass *k
 	klass->start = NULL;
 	klass->stop = NULL;
 	klass->create_blitter = NULL;
+	klass->shared_blitter_backend_name = NULL;
 
 	g_object_class_install_property(
 		object_class,
@@ -166,6 +190,80 @@ static void gst_imx_2d_video_transform_class_init(GstImx2dVideoTransformClass *k
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
 		)
 	);
+	g_object_class_install_property(
+		object_class,
+		PROP_ASYNC_FINISH,
+		g_param_spec_boolean(
+			"async-finish",
+			"Asynchronous finish",
+			"Push output frames without waiting for the blitter to finish; a completion fence is attached "
+			"to the frames instead, and waited on when the frames are mapped or used by i.MX elements "
+			"(only enable this if downstream does not access the frames' DMA buffers in other ways)",
+			DEFAULT_ASYNC_FINISH,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_MAX_FRAMES_IN_FLIGHT,
+		g_param_spec_uint(
+			"max-frames-in-flight",
+			"Maximum frames in flight",
+			"Maximum number of frames whose blits may still be in progress while the next frame is "
+			"uploaded and submitted; 1 = wait for the previous frame's blit before starting the next one "
+			"(only used if async-finish is enabled)",
+			1, GST_IMX_2D_VIDEO_TRANSFORM_MAX_FRAMES_IN_FLIGHT,
+			DEFAULT_MAX_FRAMES_IN_FLIGHT,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_CROP_META_PASSTHROUGHS,
+		g_param_spec_uint64(
+			"crop-meta-passthroughs",
+			"Crop meta passthroughs",
+			"Number of frames that were passed through along with their video crop metadata "
+			"instead of being cropped by the blitter, since downstream can crop by itself",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_CAPS_CACHE_HITS,
+		g_param_spec_uint64(
+			"caps-cache-hits",
+			"Caps cache hits",
+			"Number of caps transformations and fixations that were answered from the caps cache",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_CAPS_CACHE_MISSES,
+		g_param_spec_uint64(
+			"caps-cache-misses",
+			"Caps cache misses",
+			"Number of caps transformations and fixations that had to be computed",
+			0, G_MAXUINT64,
+			0,
+			G_PARAM_READABLE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_STATS,
+		gst_imx_2d_stats_param_spec_new()
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_SHARED_BLITTER,
+		gst_imx_2d_shared_blitter_param_spec_new()
+	);
 }
 
 
@@ -174,12 +272,19 @@ void gst_imx_2d_video_transform_init(GstImx2dVideoTransform *self)
 	GstBaseTransform *base_transform = GST_BASE_TRANSFORM(self);
 
 	self->blitter = NULL;
+	self->shared_blitter = NULL;
+	self->owns_blitter = FALSE;
 
 	self->inout_info_equal = FALSE;
 	self->inout_info_set = FALSE;
 
 	self->passing_through_overlay_meta = FALSE;
 
+	self->crop_meta_passthrough_possible = FALSE;
+	self->downstream_supports_crop_meta = FALSE;
+	self->passing_through_crop_meta = FALSE;
+	self->num_crop_meta_passthroughs = 0;
+
 	gst_video_info_init(&(self->input_video_info));
 	gst_video_info_init(&(self->output_video_info));
 
@@ -193,9 +298,26 @@ void gst_imx_2d_video_transform_init(GstImx2dVideoTransform *self)
 	self->input_crop = DEFAULT_INPUT_CROP;
 	self->video_direction = DEFAULT_VIDEO_DIRECTION;
 	self->disable_passthrough = DEFAULT_DISABLE_PASSTHROUGH;
+	self->async_finish = DEFAULT_ASYNC_FINISH;
+	self->max_frames_in_flight = DEFAULT_MAX_FRAMES_IN_FLIGHT;
+	self->use_shared_blitter = DEFAULT_SHARED_BLITTER;
 
 	self->tag_video_direction = DEFAULT_VIDEO_DIRECTION;
 
+	self->pending_blits_start = 0;
+	self->num_pending_blits = 0;
+
+	self->blit_plan = NULL;
+
+	memset(self->transform_caps_cache, 0, sizeof(self->transform_caps_cache));
+	self->transform_caps_cache_next = 0;
+	memset(self->fixate_caps_cache, 0, sizeof(self->fixate_caps_cache));
+	self->fixate_caps_cache_next = 0;
+	self->num_caps_cache_hits = 0;
+	self->num_caps_cache_misses = 0;
+
+	gst_imx_2d_stats_tracker_init(&(self->stats_tracker), GST_OBJECT(self));
+
 	/* Set passthrough initially to FALSE. Passthrough will
 	 * be enabled/disabled on a per-frame basis in
 	 * gst_imx_2d_video_transform_prepare_output_buffer(). */
@@ -205,6 +327,17 @@ void gst_imx_2d_video_transform_init(GstImx2dVideoTransform *self)
 }
 
 
+static void gst_imx_2d_video_transform_finalize(GObject *object)
+{
+	GstImx2dVideoTransform *self = GST_IMX_2D_VIDEO_TRANSFORM(object);
+
+	gst_imx_2d_video_transform_clear_caps_caches(self);
+	gst_imx_2d_stats_tracker_cleanup(&(self->stats_tracker));
+
+	G_OBJECT_CLASS(gst_imx_2d_video_transform_parent_class)->finalize(object);
+}
+
+
 static void gst_imx_2d_video_transform_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
 {
 	GstImx2dVideoTransform *self = GST_IMX_2D_VIDEO_TRANSFORM(object);
@@ -235,10 +368,39 @@ static void gst_imx_2d_video_transform_set_property(GObject *object, guint prop_
 			break;
 		}
 
+		case PROP_ASYNC_FINISH:
+		{
+			GST_OBJECT_LOCK(self);
+			self->async_finish = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_MAX_FRAMES_IN_FLIGHT:
+		{
+			GST_OBJECT_LOCK(self);
+			self->max_frames_in_flight = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_SHARED_BLITTER:
+		{
+			GST_OBJECT_LOCK(self);
+			self->use_shared_blitter = g_value_get_boolean(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
-			break;
+			return;
 	}
+
+	/* Do not let cached caps outlive the configuration they
+	 * were computed with. Property changes are rare, so
+	 * this costs next to nothing. */
+	gst_imx_2d_video_transform_clear_caps_caches(self);
 }
 
 
@@ -272,6 +434,58 @@ static void gst_imx_2d_video_transform_get_property(GObject *object, guint prop_
 			break;
 		}
 
+		case PROP_ASYNC_FINISH:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->async_finish);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_MAX_FRAMES_IN_FLIGHT:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->max_frames_in_flight);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_SHARED_BLITTER:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_boolean(value, self->use_shared_blitter);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_CROP_META_PASSTHROUGHS:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint64(value, self->num_crop_meta_passthroughs);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_CAPS_CACHE_HITS:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint64(value, self->num_caps_cache_hits);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_CAPS_CACHE_MISSES:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint64(value, self->num_caps_cache_misses);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_STATS:
+			g_value_take_boxed(value, gst_imx_2d_stats_tracker_create_structure(&(self->stats_tracker)));
+			break;
+
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 			break;
@@ -317,6 +531,53 @@ static GstStateChangeReturn gst_imx_2d_video_transform_change_state(GstElement *
 }
 
 
+static void gst_imx_2d_video_transform_set_context(GstElement *element, GstContext *context)
+{
+	GstImx2dVideoTransform *self = GST_IMX_2D_VIDEO_TRANSFORM(element);
+	GstImx2dVideoTransformClass *klass = GST_IMX_2D_VIDEO_TRANSFORM_CLASS(G_OBJECT_GET_CLASS(self));
+	gboolean accept_shared_blitter;
+
+	/* Only pick up a shared blitter from the context if this element
+	 * is actually configured to use one and has no blitter yet.
+	 * Otherwise, it would lock (and later unref) a blitter that
+	 * is not the one it is actually blitting with. */
+	GST_OBJECT_LOCK(self);
+	accept_shared_blitter = self->use_shared_blitter && (self->blitter == NULL);
+	GST_OBJECT_UNLOCK(self);
+
+	if (accept_shared_blitter)
+		gst_imx_2d_shared_blitter_handle_set_context(element, context, klass->shared_blitter_backend_name, &(self->shared_blitter));
+
+	GST_ELEMENT_CLASS(gst_imx_2d_video_transform_parent_class)->set_context(element, context);
+}
+
+
+static gboolean gst_imx_2d_video_transform_query(GstBaseTransform *transform, GstPadDirection direction, GstQuery *query)
+{
+	GstImx2dVideoTransform *self = GST_IMX_2D_VIDEO_TRANSFORM(transform);
+	GstImx2dVideoTransformClass *klass = GST_IMX_2D_VIDEO_TRANSFORM_CLASS(G_OBJECT_GET_CLASS(self));
+	GstImx2dSharedBlitter *shared_blitter;
+	gboolean ret;
+
+	if (GST_QUERY_TYPE(query) == GST_QUERY_CONTEXT)
+	{
+		GST_OBJECT_LOCK(self);
+		shared_blitter = (self->shared_blitter != NULL) ? gst_object_ref(self->shared_blitter) : NULL;
+		GST_OBJECT_UNLOCK(self);
+
+		ret = gst_imx_2d_shared_blitter_handle_context_query(GST_ELEMENT(self), query, klass->shared_blitter_backend_name, shared_blitter);
+
+		if (shared_blitter != NULL)
+			gst_object_unref(GST_OBJECT(shared_blitter));
+
+		if (ret)
+			return TRUE;
+	}
+
+	return GST_BASE_TRANSFORM_CLASS(gst_imx_2d_video_transform_parent_class)->query(transform, direction, query);
+}
+
+
 static gboolean gst_imx_2d_video_transform_sink_event(GstBaseTransform *transform, GstEvent *event)
 {
 	GstImx2dVideoTransform *self = GST_IMX_2D_VIDEO_TRANSFORM(transform);
@@ -396,6 +657,52 @@ static gboolean gst_imx_2d_video_transform_src_event(GstBaseTransform *transform
 			break;
 		}
 
+		case GST_EVENT_QOS:
+		{
+			GstQOSType type;
+			gdouble proportion;
+			GstClockTimeDiff diff;
+			GstClockTime timestamp;
+			GstClockTime frame_duration = 0;
+			gboolean ret;
+
+			gst_event_parse_qos(event, &type, &proportion, &diff, &timestamp);
+
+			/* GstBaseTransform skips frames whose running time is not
+			 * past timestamp + diff, that is, only frames that were
+			 * already late when downstream sent this event. While
+			 * downstream is late, the frames after that typically are
+			 * late as well by the time they are uploaded and blitted,
+			 * so they would be dropped by the sink after all the work
+			 * was done. Like GstVideoDecoder and GstVideoAggregator,
+			 * expect the lateness to persist, and skip frames that
+			 * are earlier than timestamp + 2*diff + one frame duration.
+			 * The base class still does the actual skipping, and posts
+			 * QoS messages with the processed and dropped counts. */
+			if ((type == GST_QOS_TYPE_THROTTLE) || (diff <= 0) || !GST_CLOCK_TIME_IS_VALID(timestamp))
+				break;
+
+			GST_OBJECT_LOCK(self);
+			if (GST_VIDEO_INFO_FPS_N(&(self->output_video_info)) > 0)
+				frame_duration = gst_util_uint64_scale_int_round(GST_SECOND, GST_VIDEO_INFO_FPS_D(&(self->output_video_info)), GST_VIDEO_INFO_FPS_N(&(self->output_video_info)));
+			GST_OBJECT_UNLOCK(self);
+
+			/* Chain up first, since the base class forwards the
+			 * event upstream and also updates its QoS values. */
+			ret = GST_BASE_TRANSFORM_CLASS(gst_imx_2d_video_transform_parent_class)->src_event(transform, event);
+
+			GST_LOG_OBJECT(
+				self,
+				"downstream is late by %" GST_STIME_FORMAT "; skipping frames earlier than %" GST_TIME_FORMAT,
+				GST_STIME_ARGS(diff),
+				GST_TIME_ARGS(timestamp + 2 * diff + frame_duration)
+			);
+
+			gst_base_transform_update_qos(transform, proportion, 2 * diff + frame_duration, timestamp);
+
+			return ret;
+		}
+
 		default:
 			break;
 	}
@@ -405,6 +712,35 @@ static gboolean gst_imx_2d_video_transform_src_event(GstBaseTransform *transform
 
 
 static GstCaps* gst_imx_2d_video_transform_transform_caps(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *filter)
+{
+	GstImx2dVideoTransform *self = GST_IMX_2D_VIDEO_TRANSFORM(transform);
+	GstCaps *transformed_caps;
+
+	GST_OBJECT_LOCK(self);
+	transformed_caps = gst_imx_2d_video_transform_lookup_caps_cache(self->transform_caps_cache, direction, caps, filter);
+	if (transformed_caps != NULL)
+		self->num_caps_cache_hits++;
+	else
+		self->num_caps_cache_misses++;
+	GST_OBJECT_UNLOCK(self);
+
+	if (transformed_caps != NULL)
+	{
+		GST_LOG_OBJECT(self, "using cached transformed caps %" GST_PTR_FORMAT, (gpointer)transformed_caps);
+		return transformed_caps;
+	}
+
+	transformed_caps = gst_imx_2d_video_transform_transform_caps_uncached(transform, direction, caps, filter);
+
+	GST_OBJECT_LOCK(self);
+	gst_imx_2d_video_transform_insert_into_caps_cache(self->transform_caps_cache, &(self->transform_caps_cache_next), direction, caps, filter, transformed_caps);
+	GST_OBJECT_UNLOCK(self);
+
+	return transformed_caps;
+}
+
+
+static GstCaps* gst_imx_2d_video_transform_transform_caps_uncached(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *filter)
 {
 	GstCaps *unfiltered_caps, *transformed_caps;
 	GstStructure *structure;
@@ -488,7 +824,7 @@ static GstCaps* gst_imx_2d_video_transform_transform_caps(GstBaseTransform *tran
 	 * structures with and without that caps feature. Note tthat when merging,
 	 * we place the copy _first_. This causes caps with the caps feature to
 	 * come first, and those without to come after. This is important to make
-	 * sure that when gst_imx_2d_video_transform_fixate_caps() is called, the
+	 * sure that when gst_imx_2d_video_transform_fixate_caps_uncached() is called, the
 	 * very first caps contain the caps feature. In cases where downstream cannot
 	 * handle that caps feature, only caps without that feature will make it
 	 * through the filter below, so this case is also covered. */
@@ -562,7 +898,7 @@ static GstCaps* gst_imx_2d_video_transform_transform_caps(GstBaseTransform *tran
 
 
 /* NOTE: The following functions are taken almost 1:1 from the upstream videoconvert element:
- * gst_imx_2d_video_transform_fixate_caps
+ * gst_imx_2d_video_transform_fixate_caps_uncached
  * gst_imx_2d_video_transform_fixate_size_caps
  * score_value
  * gst_imx_2d_video_transform_fixate_format_caps
@@ -570,6 +906,42 @@ static GstCaps* gst_imx_2d_video_transform_transform_caps(GstBaseTransform *tran
 
 
 static GstCaps* gst_imx_2d_video_transform_fixate_caps(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *othercaps)
+{
+	GstImx2dVideoTransform *self = GST_IMX_2D_VIDEO_TRANSFORM(transform);
+	GstCaps *result;
+
+	GST_OBJECT_LOCK(self);
+	result = gst_imx_2d_video_transform_lookup_caps_cache(self->fixate_caps_cache, direction, caps, othercaps);
+	if (result != NULL)
+		self->num_caps_cache_hits++;
+	else
+		self->num_caps_cache_misses++;
+	GST_OBJECT_UNLOCK(self);
+
+	if (result != NULL)
+	{
+		GST_LOG_OBJECT(self, "using cached fixated caps %" GST_PTR_FORMAT, (gpointer)result);
+		gst_caps_unref(othercaps);
+		return result;
+	}
+
+	/* The uncached function takes ownership over othercaps and may
+	 * modify them, so keep a reference for the cache entry. Since
+	 * this makes othercaps non-writable, they are copied instead. */
+	gst_caps_ref(othercaps);
+	result = gst_imx_2d_video_transform_fixate_caps_uncached(transform, direction, caps, othercaps);
+
+	GST_OBJECT_LOCK(self);
+	gst_imx_2d_video_transform_insert_into_caps_cache(self->fixate_caps_cache, &(self->fixate_caps_cache_next), direction, caps, othercaps, result);
+	GST_OBJECT_UNLOCK(self);
+
+	gst_caps_unref(othercaps);
+
+	return result;
+}
+
+
+static GstCaps* gst_imx_2d_video_transform_fixate_caps_uncached(GstBaseTransform *transform, GstPadDirection direction, GstCaps *caps, GstCaps *othercaps)
 {
 	GstCaps *result;
 
@@ -1237,6 +1609,10 @@ static gboolean gst_imx_2d_video_transform_set_caps(GstBaseTransform *transform,
 		return FALSE;
 	}
 
+	/* Let pending blitter sequences finish before the
+	 * uploader, surfaces, and blit plan are reconfigured. */
+	gst_imx_2d_video_transform_wait_for_pending_blits(self, 0);
+
 	if (!gst_imx_video_uploader_set_input_video_info(self->uploader, &input_video_info))
 	{
 		GST_ERROR_OBJECT(self, "could not configure uploader with new caps / video info");
@@ -1288,12 +1664,27 @@ static gboolean gst_imx_2d_video_transform_set_caps(GstBaseTransform *transform,
 	else
 		GST_DEBUG_OBJECT(self, "input and output caps are not equal");
 
+	/* Check if frames can be passed through with their crop meta instead
+	 * of being cropped by the blitter. This requires that everything
+	 * except for the size is the same. The output size cannot be larger
+	 * than the input size, since the crop rectangle must match the output
+	 * size. Whether or not the crop rectangle of a frame actually matches
+	 * is checked in gst_imx_2d_video_transform_prepare_output_buffer(). */
+	self->crop_meta_passthrough_possible = (GST_VIDEO_INFO_WIDTH(&output_video_info) <= GST_VIDEO_INFO_WIDTH(&input_video_info))
+	                                    && (GST_VIDEO_INFO_HEIGHT(&output_video_info) <= GST_VIDEO_INFO_HEIGHT(&input_video_info))
+	                                    && (GST_VIDEO_INFO_FORMAT(&input_video_info) == GST_VIDEO_INFO_FORMAT(&output_video_info))
+	                                    && (input_video_tile_layout == GST_IMX_2D_TILE_LAYOUT_NONE)
+	                                    && (input_has_overlay_meta == output_has_overlay_meta);
+
+	GST_DEBUG_OBJECT(self, "crop meta passthrough possible: %d", self->crop_meta_passthrough_possible);
+
 	/* Fill the input surface description with values that can't change
 	 * in between buffers. (Plane stride and offset values can change.
 	 * This is unlikely to happen, but it is not impossible.) */
 	self->input_surface_desc.width = GST_VIDEO_INFO_WIDTH(&input_video_info);
 	self->input_surface_desc.height = GST_VIDEO_INFO_HEIGHT(&input_video_info);
 	self->input_surface_desc.format = gst_imx_2d_convert_from_gst_video_format(GST_VIDEO_INFO_FORMAT(&input_video_info), &input_video_tile_layout);
+	gst_imx_2d_set_surface_desc_colorimetry(&(self->input_surface_desc), &input_video_info);
 
 	/* Fill the output surface description. None of its values can change
 	 * in between buffers, since we allocate the output buffers ourselves.
@@ -1305,6 +1696,7 @@ static gboolean gst_imx_2d_video_transform_set_caps(GstBaseTransform *transform,
 	output_surface_desc.width = GST_VIDEO_INFO_WIDTH(&output_video_info);
 	output_surface_desc.height = GST_VIDEO_INFO_HEIGHT(&output_video_info);
 	output_surface_desc.format = gst_imx_2d_convert_from_gst_video_format(GST_VIDEO_INFO_FORMAT(&output_video_info), NULL);
+	gst_imx_2d_set_surface_desc_colorimetry(&output_surface_desc, &output_video_info);
 
 	for (i = 0; i < GST_VIDEO_INFO_N_PLANES(&output_video_info); ++i)
 		output_surface_desc.plane_strides[i] = GST_VIDEO_INFO_PLANE_STRIDE(&output_video_info, i);
@@ -1313,6 +1705,9 @@ static gboolean gst_imx_2d_video_transform_set_caps(GstBaseTransform *transform,
 
 	imx_2d_surface_set_desc(self->output_surface, &output_surface_desc);
 
+	imx_2d_blit_plan_destroy(self->blit_plan);
+	self->blit_plan = NULL;
+
 	gst_caps_replace(&(self->input_caps), input_caps);
 
 	gst_imx_2d_video_overlay_handler_clear_cached_overlays(self->overlay_handler);
@@ -1409,6 +1804,14 @@ static gboolean gst_imx_2d_video_transform_decide_allocation(GstBaseTransform *t
 		self->video_buffer_pool = NULL;
 	}
 
+	/* Passing through frames with their crop meta produces frames that
+	 * are larger than what the output caps say. Downstream then needs
+	 * the video meta for the frame layout and the crop meta for the
+	 * region to show. */
+	self->downstream_supports_crop_meta = gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL)
+	                                   && gst_query_find_allocation_meta(query, GST_VIDEO_CROP_META_API_TYPE, NULL);
+	GST_DEBUG_OBJECT(self, "downstream supports video & crop meta: %d", self->downstream_supports_crop_meta);
+
 	self->video_buffer_pool = gst_imx_video_buffer_pool_new(
 		self->imx_dma_buffer_allocator,
 		query,
@@ -1442,6 +1845,14 @@ static GstFlowReturn gst_imx_2d_video_transform_prepare_output_buffer(GstBaseTra
 	 * - Input crop is disabled, or it is enabled & the input buffer's video
 	 *   crop meta defines a rectangle that contains the entire frame
 	 * - Output rotation is disabled (= set to IMX_2D_ROTATION_NONE)
+	 *
+	 * If these conditions are met except that the input buffer's crop
+	 * rectangle has the size of the output frames (and not the size of
+	 * the input frames), and downstream can handle video and crop meta,
+	 * then the frame is passed through along with its crop meta, and
+	 * downstream does the cropping. In that case, *output_buffer is set
+	 * to a shallow copy of input_buffer, since the buffer's video meta
+	 * may have to be added.
 	 */
 
 	g_assert(self->uploader != NULL);
@@ -1506,6 +1917,24 @@ static GstFlowReturn gst_imx_2d_video_transform_prepare_output_buffer(GstBaseTra
 		}
 
 		GST_LOG_OBJECT(self, "=> passthrough: %s", passthrough ? "yes" : "no");
+
+		/* Overlays must be blended into the frame, which is impossible
+		 * when passing through the crop meta, unless downstream is
+		 * the one that takes care of them. */
+		self->passing_through_crop_meta = !passthrough
+		                               && (input_buffer != NULL)
+		                               && input_crop
+		                               && has_crop_meta
+		                               && self->crop_meta_passthrough_possible
+		                               && self->downstream_supports_crop_meta
+		                               && identity_video_direction
+		                               && are_both_pools_same
+		                               && !disable_passthrough
+		                               && (self->passing_through_overlay_meta || (gst_buffer_get_video_overlay_composition_meta(input_buffer) == NULL))
+		                               && (video_crop_meta->width == (guint)GST_VIDEO_INFO_WIDTH(&(self->output_video_info)))
+		                               && (video_crop_meta->height == (guint)GST_VIDEO_INFO_HEIGHT(&(self->output_video_info)));
+
+		GST_LOG_OBJECT(self, "=> crop meta passthrough: %s", self->passing_through_crop_meta ? "yes" : "no");
 	}
 
 	if (passthrough)
@@ -1514,6 +1943,38 @@ static GstFlowReturn gst_imx_2d_video_transform_prepare_output_buffer(GstBaseTra
 		return GST_FLOW_OK;
 	}
 
+	if (self->passing_through_crop_meta)
+	{
+		/* This only copies the buffer's metadata and references its
+		 * memory blocks. The pixels themselves are not copied. */
+		*output_buffer = gst_buffer_copy(input_buffer);
+		GST_BUFFER_FLAG_UNSET(*output_buffer, GST_BUFFER_FLAG_TAG_MEMORY);
+
+		/* The output caps describe the cropped frame, so downstream
+		 * needs a video meta that describes the actual frame layout. */
+		if (gst_buffer_get_video_meta(*output_buffer) == NULL)
+		{
+			GstVideoInfo const *info = &(self->input_video_info);
+
+			gst_buffer_add_video_meta_full(
+				*output_buffer,
+				GST_VIDEO_FRAME_FLAG_NONE,
+				GST_VIDEO_INFO_FORMAT(info),
+				GST_VIDEO_INFO_WIDTH(info),
+				GST_VIDEO_INFO_HEIGHT(info),
+				GST_VIDEO_INFO_N_PLANES(info),
+				(gsize *)(info->offset),
+				(gint *)(info->stride)
+			);
+		}
+
+		GST_OBJECT_LOCK(self);
+		self->num_crop_meta_passthroughs++;
+		GST_OBJECT_UNLOCK(self);
+
+		return GST_FLOW_OK;
+	}
+
 	return GST_BASE_TRANSFORM_CLASS(gst_imx_2d_video_transform_parent_class)->prepare_output_buffer(transform, input_buffer, output_buffer);
 }
 
@@ -1523,10 +1984,13 @@ static GstFlowReturn gst_imx_2d_video_transform_transform_frame(GstBaseTransform
 	Imx2dBlitParams blit_params;
 	GstFlowReturn flow_ret = GST_FLOW_OK;
 	gboolean input_crop;
+	gboolean async_finish;
+	guint max_frames_in_flight;
 	Imx2dRegion crop_rectangle;
 	GstVideoOrientationMethod video_direction;
 	GstBuffer *uploaded_input_buffer = NULL;
 	GstBuffer *intermediate_buffer = NULL;
+	gboolean blitter_locked = FALSE;
 	GstImx2dVideoTransform *self = GST_IMX_2D_VIDEO_TRANSFORM(transform);
 
 	/* Initial checks. */
@@ -1543,6 +2007,12 @@ static GstFlowReturn gst_imx_2d_video_transform_transform_frame(GstBaseTransform
 		return GST_FLOW_OK;
 	}
 
+	if (self->passing_through_crop_meta)
+	{
+		GST_LOG_OBJECT(self, "passing buffer through along with its crop meta");
+		return GST_FLOW_OK;
+	}
+
 	if (!gst_imx_2d_check_input_buffer_structure(input_buffer, GST_VIDEO_INFO_N_PLANES(&(self->input_video_info))))
 		return GST_FLOW_ERROR;
 
@@ -1552,10 +2022,31 @@ static GstFlowReturn gst_imx_2d_video_transform_transform_frame(GstBaseTransform
 	 * values while this function is running. */
 	GST_OBJECT_LOCK(self);
 	input_crop = self->input_crop;
+	async_finish = self->async_finish;
+	max_frames_in_flight = self->max_frames_in_flight;
 	video_direction = gst_imx_2d_video_transform_get_current_video_direction(self);
 	GST_OBJECT_UNLOCK(self);
 
 
+	/* If previous frames' blitter sequences were finished
+	 * asynchronously, make sure there is room for this frame's
+	 * sequence. With max-frames-in-flight set to 1, this waits
+	 * until the previous frame's sequence is done. Typically,
+	 * the oldest sequence is already done by the time we get
+	 * here, since pushing the previous frames downstream and
+	 * receiving this frame from upstream overlapped with it.
+	 * The input buffers of pending sequences are kept alive,
+	 * so the uploader cannot overwrite them in the meantime. */
+	gst_imx_2d_video_transform_wait_for_pending_blits(self, max_frames_in_flight - 1);
+
+	/* The overlay handler replaces its cached overlay buffers
+	 * when the overlay composition changes. Pending sequences
+	 * may still read from these, so wait for all of them if
+	 * this frame has overlays to render. */
+	if (!self->passing_through_overlay_meta && (gst_buffer_get_video_overlay_composition_meta(input_buffer) != NULL))
+		gst_imx_2d_video_transform_wait_for_pending_blits(self, 0);
+
+
 	GST_LOG_OBJECT(self, "beginning frame transform by uploading input buffer");
 
 	/* Upload the input buffer. The uploader creates a deep  copy if necessary,
@@ -1628,13 +2119,24 @@ static GstFlowReturn gst_imx_2d_video_transform_transform_frame(GstBaseTransform
 
 	GST_LOG_OBJECT(self, "beginning blitting procedure to transform the frame");
 
+	gst_imx_2d_shared_blitter_lock(self->shared_blitter, &(self->stats_tracker));
+	blitter_locked = TRUE;
+
 	if (!imx_2d_blitter_start(self->blitter, self->output_surface))
 	{
 		GST_ERROR_OBJECT(self, "starting blitter failed");
 		goto error;
 	}
 
-	if (!imx_2d_blitter_do_blit(self->blitter, self->input_surface, &blit_params))
+	/* Record the frame blit and the overlay blits in one batch,
+	 * so the blitter can hand them over to the backend in one go. */
+	if (!imx_2d_blitter_begin_batch(self->blitter))
+	{
+		GST_ERROR_OBJECT(self, "beginning blitter batch failed");
+		goto error;
+	}
+
+	if (!gst_imx_2d_blit_with_plan(self->blitter, &(self->blit_plan), self->input_surface, self->output_surface, &blit_params))
 	{
 		GST_ERROR_OBJECT(self, "blitting failed");
 		goto error;
@@ -1650,12 +2152,48 @@ static GstFlowReturn gst_imx_2d_video_transform_transform_frame(GstBaseTransform
 		}
 	}
 
-	if (!imx_2d_blitter_finish(self->blitter))
+	if (!imx_2d_blitter_submit_batch(self->blitter))
+	{
+		GST_ERROR_OBJECT(self, "submitting blitter batch failed");
+		goto error;
+	}
+
+	if (async_finish)
+	{
+		Imx2dFence *fence;
+
+		if (!imx_2d_blitter_finish_async(self->blitter, &fence))
+		{
+			GST_ERROR_OBJECT(self, "finishing blitter failed");
+			goto error;
+		}
+
+		/* Mapping or uploading the output frame waits on the fence. If the
+		 * intermediate buffer is not the output buffer, then the transfer
+		 * below maps the intermediate buffer, so it waits right away. */
+		gst_imx_2d_set_fence_on_buffer(intermediate_buffer, fence);
+
+		{
+			GstImx2dVideoTransformPendingBlit *pending_blit;
+
+			g_assert(self->num_pending_blits < GST_IMX_2D_VIDEO_TRANSFORM_MAX_FRAMES_IN_FLIGHT);
+
+			pending_blit = &(self->pending_blits[(self->pending_blits_start + self->num_pending_blits) % GST_IMX_2D_VIDEO_TRANSFORM_MAX_FRAMES_IN_FLIGHT]);
+			pending_blit->fence = fence;
+			pending_blit->input_buffer = uploaded_input_buffer;
+			self->num_pending_blits++;
+		}
+		uploaded_input_buffer = NULL;
+	}
+	else if (!imx_2d_blitter_finish(self->blitter))
 	{
 		GST_ERROR_OBJECT(self, "finishing blitter failed");
 		goto error;
 	}
 
+	gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
+	blitter_locked = FALSE;
+
 
 	/* The blitter is done. Transfer the resulting pixels to the output buffer.
 	 * If the internal DMA buffer pool and the output video buffer pool are
@@ -1696,6 +2234,8 @@ static GstFlowReturn gst_imx_2d_video_transform_transform_frame(GstBaseTransform
 
 
 finish:
+	if (blitter_locked)
+		gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
 	/* Discard the uploaded version of the input buffer. */
 	if (uploaded_input_buffer != NULL)
 		gst_buffer_unref(uploaded_input_buffer);
@@ -1781,6 +2321,14 @@ static gboolean gst_imx_2d_video_transform_start(GstImx2dVideoTransform *self)
 
 	self->passing_through_overlay_meta = FALSE;
 
+	self->crop_meta_passthrough_possible = FALSE;
+	self->downstream_supports_crop_meta = FALSE;
+	self->passing_through_crop_meta = FALSE;
+
+	GST_OBJECT_LOCK(self);
+	self->num_crop_meta_passthroughs = 0;
+	GST_OBJECT_UNLOCK(self);
+
 	self->video_buffer_pool = NULL;
 
 	self->tag_video_direction = DEFAULT_VIDEO_DIRECTION;
@@ -1848,10 +2396,16 @@ error:
 static void gst_imx_2d_video_transform_stop(GstImx2dVideoTransform *self)
 {
 	GstImx2dVideoTransformClass *klass = GST_IMX_2D_VIDEO_TRANSFORM_CLASS(G_OBJECT_GET_CLASS(self));
+	GstImx2dSharedBlitter *shared_blitter;
 
 	if ((klass->stop != NULL) && !(klass->stop(self)))
 		GST_ERROR_OBJECT(self, "stop() failed");
 
+	gst_imx_2d_video_transform_wait_for_pending_blits(self, 0);
+
+	imx_2d_blit_plan_destroy(self->blit_plan);
+	self->blit_plan = NULL;
+
 	gst_caps_replace(&(self->input_caps), NULL);
 
 	if (self->overlay_handler != NULL)
@@ -1872,11 +2426,20 @@ static void gst_imx_2d_video_transform_stop(GstImx2dVideoTransform *self)
 		self->output_surface = NULL;
 	}
 
-	if (self->blitter != NULL)
-	{
+	if (self->owns_blitter && (self->blitter != NULL))
 		imx_2d_blitter_destroy(self->blitter);
-		self->blitter = NULL;
-	}
+	self->blitter = NULL;
+	self->owns_blitter = FALSE;
+
+	/* If the blitter came from the shared blitter, the latter
+	 * destroys it once no one uses it anymore. */
+	GST_OBJECT_LOCK(self);
+	shared_blitter = self->shared_blitter;
+	self->shared_blitter = NULL;
+	GST_OBJECT_UNLOCK(self);
+
+	if (shared_blitter != NULL)
+		gst_object_unref(GST_OBJECT(shared_blitter));
 
 	if (self->uploader != NULL)
 	{
@@ -1901,22 +2464,173 @@ static void gst_imx_2d_video_transform_stop(GstImx2dVideoTransform *self)
 static gboolean gst_imx_2d_video_transform_create_blitter(GstImx2dVideoTransform *self)
 {
 	GstImx2dVideoTransformClass *klass = GST_IMX_2D_VIDEO_TRANSFORM_CLASS(G_OBJECT_GET_CLASS(self));
+	gboolean use_shared_blitter;
 
 	g_assert(klass->create_blitter != NULL);
 	g_assert(self->blitter == NULL);
 
-	if (G_UNLIKELY((self->blitter = klass->create_blitter(self)) == NULL))
+	GST_OBJECT_LOCK(self);
+	use_shared_blitter = self->use_shared_blitter;
+	GST_OBJECT_UNLOCK(self);
+
+	if (use_shared_blitter && (klass->shared_blitter_backend_name == NULL))
 	{
-		GST_ERROR_OBJECT(self, "could not create blitter");
-		return FALSE;
+		GST_WARNING_OBJECT(self, "shared blitters are not supported by this element; creating own blitter");
+		use_shared_blitter = FALSE;
+	}
+
+	if (use_shared_blitter)
+	{
+		if (!gst_imx_2d_shared_blitter_ensure(GST_ELEMENT(self), klass->shared_blitter_backend_name, &(self->shared_blitter), gst_imx_2d_video_transform_create_blitter_for_sharing, self))
+			return FALSE;
+
+		self->blitter = gst_imx_2d_shared_blitter_get_blitter(self->shared_blitter);
+		self->owns_blitter = FALSE;
+		GST_DEBUG_OBJECT(self, "using shared blitter %" GST_PTR_FORMAT, (gpointer)(self->shared_blitter));
 	}
+	else
+	{
+		GstImx2dSharedBlitter *stale_shared_blitter;
+
+		/* Drop any shared blitter that got stored before sharing
+		 * was disabled, so the lock/unlock calls become no-ops. */
+		GST_OBJECT_LOCK(self);
+		stale_shared_blitter = self->shared_blitter;
+		self->shared_blitter = NULL;
+		GST_OBJECT_UNLOCK(self);
+
+		if (stale_shared_blitter != NULL)
+			gst_object_unref(GST_OBJECT(stale_shared_blitter));
 
-	GST_DEBUG_OBJECT(self, "created new blitter %" GST_PTR_FORMAT, (gpointer)(self->blitter));
+		if (G_UNLIKELY((self->blitter = klass->create_blitter(self)) == NULL))
+		{
+			GST_ERROR_OBJECT(self, "could not create blitter");
+			return FALSE;
+		}
+
+		self->owns_blitter = TRUE;
+		GST_DEBUG_OBJECT(self, "created new blitter %" GST_PTR_FORMAT, (gpointer)(self->blitter));
+	}
+
+	/* Other elements may be using a shared blitter right now. */
+	gst_imx_2d_shared_blitter_lock(self->shared_blitter, NULL);
+	gst_imx_2d_stats_tracker_attach(&(self->stats_tracker), self->blitter);
+	gst_imx_2d_shared_blitter_unlock(self->shared_blitter);
 
 	return TRUE;
 }
 
 
+static Imx2dBlitter* gst_imx_2d_video_transform_create_blitter_for_sharing(gpointer user_data)
+{
+	GstImx2dVideoTransform *self = GST_IMX_2D_VIDEO_TRANSFORM(user_data);
+	GstImx2dVideoTransformClass *klass = GST_IMX_2D_VIDEO_TRANSFORM_CLASS(G_OBJECT_GET_CLASS(self));
+	return klass->create_blitter(self);
+}
+
+
+static void gst_imx_2d_video_transform_wait_for_pending_blits(GstImx2dVideoTransform *self, guint max_num_pending_blits)
+{
+	/* Sequences are executed in the order they were submitted, so
+	 * the fences are waited on oldest first. Sequences that are
+	 * already done are always retired, even if there would be
+	 * room for them, to release their input buffers early. */
+	while (self->num_pending_blits > 0)
+	{
+		GstImx2dVideoTransformPendingBlit *pending_blit = &(self->pending_blits[self->pending_blits_start]);
+
+		if (self->num_pending_blits > max_num_pending_blits)
+		{
+			GST_LOG_OBJECT(self, "waiting for pending blitter sequence to finish (%u pending)", self->num_pending_blits);
+
+			/* A failure is not reported as an error here, since whoever
+			 * maps or uploads the output frame gets notified about it. */
+			if (!imx_2d_fence_wait(pending_blit->fence))
+				GST_WARNING_OBJECT(self, "asynchronously finished blitter sequence failed");
+		}
+		else if (!imx_2d_fence_poll(pending_blit->fence))
+			break;
+
+		imx_2d_fence_unref(pending_blit->fence);
+		pending_blit->fence = NULL;
+		gst_buffer_replace(&(pending_blit->input_buffer), NULL);
+
+		self->pending_blits_start = (self->pending_blits_start + 1) % GST_IMX_2D_VIDEO_TRANSFORM_MAX_FRAMES_IN_FLIGHT;
+		self->num_pending_blits--;
+	}
+}
+
+
+static gboolean gst_imx_2d_video_transform_caps_equal(GstCaps *caps1, GstCaps *caps2)
+{
+	if (caps1 == caps2)
+		return TRUE;
+	if ((caps1 == NULL) || (caps2 == NULL))
+		return FALSE;
+	/* Strict equality is required, since the order of the
+	 * structures in the caps matters for the results. */
+	return gst_caps_is_strictly_equal(caps1, caps2);
+}
+
+
+static GstCaps* gst_imx_2d_video_transform_lookup_caps_cache(GstImx2dVideoTransformCapsCacheEntry *cache, GstPadDirection direction, GstCaps *caps, GstCaps *other_caps)
+{
+	guint i;
+
+	for (i = 0; i < GST_IMX_2D_VIDEO_TRANSFORM_CAPS_CACHE_SIZE; ++i)
+	{
+		GstImx2dVideoTransformCapsCacheEntry *entry = &(cache[i]);
+
+		if ((entry->caps != NULL)
+		 && (entry->direction == direction)
+		 && gst_imx_2d_video_transform_caps_equal(entry->caps, caps)
+		 && gst_imx_2d_video_transform_caps_equal(entry->other_caps, other_caps))
+			return gst_caps_ref(entry->result);
+	}
+
+	return NULL;
+}
+
+
+static void gst_imx_2d_video_transform_insert_into_caps_cache(GstImx2dVideoTransformCapsCacheEntry *cache, guint *next_entry, GstPadDirection direction, GstCaps *caps, GstCaps *other_caps, GstCaps *result)
+{
+	GstImx2dVideoTransformCapsCacheEntry *entry = &(cache[*next_entry]);
+
+	/* Keeping references makes the cached caps immutable; anyone
+	 * who wants to modify them has to make a copy first. */
+	entry->direction = direction;
+	gst_caps_replace(&(entry->caps), caps);
+	gst_caps_replace(&(entry->other_caps), other_caps);
+	gst_caps_replace(&(entry->result), result);
+
+	*next_entry = (*next_entry + 1) % GST_IMX_2D_VIDEO_TRANSFORM_CAPS_CACHE_SIZE;
+}
+
+
+static void gst_imx_2d_video_transform_clear_caps_caches(GstImx2dVideoTransform *self)
+{
+	guint i;
+
+	GST_OBJECT_LOCK(self);
+
+	for (i = 0; i < GST_IMX_2D_VIDEO_TRANSFORM_CAPS_CACHE_SIZE; ++i)
+	{
+		gst_caps_replace(&(self->transform_caps_cache[i].caps), NULL);
+		gst_caps_replace(&(self->transform_caps_cache[i].other_caps), NULL);
+		gst_caps_replace(&(self->transform_caps_cache[i].result), NULL);
+
+		gst_caps_replace(&(self->fixate_caps_cache[i].caps), NULL);
+		gst_caps_replace(&(self->fixate_caps_cache[i].other_caps), NULL);
+		gst_caps_replace(&(self->fixate_caps_cache[i].result), NULL);
+	}
+
+	self->transform_caps_cache_next = 0;
+	self->fixate_caps_cache_next = 0;
+
+	GST_OBJECT_UNLOCK(self);
+}
+
+
 static GstVideoOrientationMethod gst_imx_2d_video_transform_get_current_video_direction(GstImx2dVideoTransform *self)
 {
 	return (self->video_direction == GST_VIDEO_ORIENTATION_AUTO) ? self->tag_video_direction : self->video_direction;
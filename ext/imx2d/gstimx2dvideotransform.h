@@ -26,6 +26,8 @@
 #include "gst/imx/video/gstimxvideouploader.h"
 #include "imx2d/imx2d.h"
 #include "gstimx2dmisc.h"
+#include "gstimx2dsharedblitter.h"
+#include "gstimx2dstats.h"
 #include "gstimx2dvideooverlayhandler.h"
 
 
@@ -45,6 +47,40 @@ typedef struct _GstImx2dVideoTransform GstImx2dVideoTransform;
 typedef struct _GstImx2dVideoTransformClass GstImx2dVideoTransformClass;
 
 
+/* Upper limit for the max-frames-in-flight property. */
+#define GST_IMX_2D_VIDEO_TRANSFORM_MAX_FRAMES_IN_FLIGHT 8
+
+
+/* Number of entries in each of the caps caches (see below). */
+#define GST_IMX_2D_VIDEO_TRANSFORM_CAPS_CACHE_SIZE 8
+
+
+/* Result of a transform_caps or fixate_caps call, along with the
+ * arguments it was computed from. For transform_caps entries,
+ * other_caps is the filter (which can be NULL). For fixate_caps
+ * entries, other_caps is the othercaps argument. An entry whose
+ * caps field is NULL is unused. */
+typedef struct
+{
+	GstPadDirection direction;
+	GstCaps *caps;
+	GstCaps *other_caps;
+	GstCaps *result;
+}
+GstImx2dVideoTransformCapsCacheEntry;
+
+
+/* Asynchronously finished blitter sequence that may still be in
+ * progress. The input buffer that was used in that sequence must
+ * be kept alive until the fence is signaled. */
+typedef struct
+{
+	Imx2dFence *fence;
+	GstBuffer *input_buffer;
+}
+GstImx2dVideoTransformPendingBlit;
+
+
 struct _GstImx2dVideoTransform
 {
 	GstBaseTransform parent;
@@ -56,13 +92,34 @@ struct _GstImx2dVideoTransform
 
 	GstImxVideoBufferPool *video_buffer_pool;
 
+	/* If the shared-blitter property is enabled, this blitter
+	 * belongs to shared_blitter, and every blitter sequence must
+	 * be enclosed in gst_imx_2d_shared_blitter_lock() and
+	 * gst_imx_2d_shared_blitter_unlock() calls. */
 	Imx2dBlitter *blitter;
+	GstImx2dSharedBlitter *shared_blitter;
+	/* TRUE if blitter was created by this element (and not taken
+	 * from shared_blitter), meaning that stop() must destroy it. */
+	gboolean owns_blitter;
 
 	gboolean inout_info_equal;
 	gboolean inout_info_set;
 
 	gboolean passing_through_overlay_meta;
 
+	/* TRUE if input and output caps only differ in their size, and
+	 * the output is not larger than the input. Frames whose crop
+	 * rectangle has the output size can then be passed through
+	 * along with their crop meta instead of being cropped by the
+	 * blitter, provided that downstream can handle both the video
+	 * and the crop meta (downstream_supports_crop_meta). */
+	gboolean crop_meta_passthrough_possible;
+	gboolean downstream_supports_crop_meta;
+	/* Set by gst_imx_2d_video_transform_prepare_output_buffer()
+	 * if the current frame is passed through with its crop meta. */
+	gboolean passing_through_crop_meta;
+	guint64 num_crop_meta_passthroughs;
+
 	GstVideoInfo input_video_info;
 	GstVideoInfo output_video_info;
 
@@ -73,13 +130,43 @@ struct _GstImx2dVideoTransform
 
 	Imx2dSurfaceDesc input_surface_desc;
 
+	/* Precomputed blit from input_surface to output_surface.
+	 * Discarded when the caps change. */
+	Imx2dBlitPlan *blit_plan;
+
 	GstImx2dVideoOverlayHandler *overlay_handler;
 
 	gboolean input_crop;
 	GstVideoOrientationMethod video_direction;
 	gboolean disable_passthrough;
+	gboolean async_finish;
+	guint max_frames_in_flight;
+	gboolean use_shared_blitter;
 
 	GstVideoOrientationMethod tag_video_direction;
+
+	/* Ring buffer of asynchronously finished blitter sequences,
+	 * oldest first. With async-finish enabled, up to
+	 * max_frames_in_flight sequences can be pending, so that
+	 * the next frame can be uploaded and submitted while the
+	 * blitter is still working on the previous ones. */
+	GstImx2dVideoTransformPendingBlit pending_blits[GST_IMX_2D_VIDEO_TRANSFORM_MAX_FRAMES_IN_FLIGHT];
+	guint pending_blits_start;
+	guint num_pending_blits;
+
+	/* Caches for transform_caps and fixate_caps results. Caps queries
+	 * are frequent during renegotiation (for example, while a window
+	 * is being resized), and usually repeat the same arguments. The
+	 * oldest entry is replaced when a cache is full. These fields
+	 * are protected by the object lock. */
+	GstImx2dVideoTransformCapsCacheEntry transform_caps_cache[GST_IMX_2D_VIDEO_TRANSFORM_CAPS_CACHE_SIZE];
+	guint transform_caps_cache_next;
+	GstImx2dVideoTransformCapsCacheEntry fixate_caps_cache[GST_IMX_2D_VIDEO_TRANSFORM_CAPS_CACHE_SIZE];
+	guint fixate_caps_cache_next;
+	guint64 num_caps_cache_hits;
+	guint64 num_caps_cache_misses;
+
+	GstImx2dStatsTracker stats_tracker;
 };
 
 
@@ -92,6 +179,10 @@ struct _GstImx2dVideoTransformClass
 
 	Imx2dBlitter* (*create_blitter)(GstImx2dVideoTransform *imx_2d_video_transform);
 
+	/* Name of the backend for the shared blitter context type.
+	 * NULL if the subclass does not support shared blitters. */
+	gchar const *shared_blitter_backend_name;
+
 	Imx2dHardwareCapabilities const *hardware_capabilities;
 };
 
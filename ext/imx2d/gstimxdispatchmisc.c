@@ -0,0 +1,181 @@
+#include <config.h>
+#include <string.h>
+#include "imx2d/backend/dispatch/dispatch_blitter.h"
+#ifdef WITH_IMX2D_G2D_BACKEND
+#include "imx2d/backend/g2d/g2d_blitter.h"
+#endif
+#ifdef WITH_IMX2D_IPU_BACKEND
+#include "imx2d/backend/ipu/ipu_blitter.h"
+#endif
+#ifdef WITH_IMX2D_PXP_BACKEND
+#include "imx2d/backend/pxp/pxp_blitter.h"
+#endif
+#ifdef WITH_IMX2D_SW_BACKEND
+#include "imx2d/backend/sw/sw_blitter.h"
+#endif
+#include "gstimxdispatchmisc.h"
+
+
+GST_DEBUG_CATEGORY_STATIC(imx_dispatch_debug);
+#define GST_CAT_DEFAULT imx_dispatch_debug
+
+
+typedef struct
+{
+	gchar const *name;
+	Imx2dBlitter* (*create_blitter)(void);
+	Imx2dHardwareCapabilities const * (*get_hardware_capabilities)(void);
+}
+DispatchEngineBackend;
+
+
+#ifdef WITH_IMX2D_SW_BACKEND
+static Imx2dBlitter* create_sw_blitter(void)
+{
+	/* Use one thread per core, like the software elements do by default. */
+	return imx_2d_backend_sw_blitter_create_threaded(0, 0);
+}
+#endif
+
+
+/* The order of this list is also the order in which the engines are
+ * added to dispatch blitters. If two engines have the same estimated
+ * cost for an operation, the one that was added first is used. */
+static DispatchEngineBackend const engine_backends[] =
+{
+#ifdef WITH_IMX2D_G2D_BACKEND
+	{ "g2d", imx_2d_backend_g2d_blitter_create, imx_2d_backend_g2d_get_hardware_capabilities },
+#endif
+#ifdef WITH_IMX2D_PXP_BACKEND
+	{ "pxp", imx_2d_backend_pxp_blitter_create, imx_2d_backend_pxp_get_hardware_capabilities },
+#endif
+#ifdef WITH_IMX2D_IPU_BACKEND
+	{ "ipu", imx_2d_backend_ipu_blitter_create, imx_2d_backend_ipu_get_hardware_capabilities },
+#endif
+#ifdef WITH_IMX2D_SW_BACKEND
+	{ "sw", create_sw_blitter, imx_2d_backend_sw_get_hardware_capabilities },
+#endif
+	{ NULL, NULL, NULL }
+};
+
+
+static void init_debug_category(void)
+{
+	static gsize initialized = 0;
+
+	if (g_once_init_enter(&initialized))
+	{
+		GST_DEBUG_CATEGORY_INIT(imx_dispatch_debug, "imxdispatch", 0, "NXP i.MX 2D dispatch blitter");
+		g_once_init_leave(&initialized, 1);
+	}
+}
+
+
+Imx2dHardwareCapabilities const * gst_imx_dispatch_get_hardware_capabilities(void)
+{
+	static gsize initialized = 0;
+	static Imx2dHardwareCapabilities capabilities;
+	static Imx2dPixelFormat source_formats[IMX_2D_NUM_PIXEL_FORMATS];
+	static Imx2dPixelFormat dest_formats[IMX_2D_NUM_PIXEL_FORMATS];
+
+	if (g_once_init_enter(&initialized))
+	{
+		Imx2dHardwareCapabilities const *backend_capabilities[G_N_ELEMENTS(engine_backends)];
+		int num_backends;
+
+		for (num_backends = 0; engine_backends[num_backends].name != NULL; ++num_backends)
+			backend_capabilities[num_backends] = engine_backends[num_backends].get_hardware_capabilities();
+
+		imx_2d_backend_dispatch_merge_hardware_capabilities(
+			backend_capabilities, num_backends,
+			&capabilities,
+			source_formats, dest_formats
+		);
+
+		g_once_init_leave(&initialized, 1);
+	}
+
+	return &capabilities;
+}
+
+
+static gboolean add_engine(GstObject *object, Imx2dBlitter *dispatch_blitter, DispatchEngineBackend const *backend)
+{
+	Imx2dBlitter *engine_blitter;
+
+	engine_blitter = backend->create_blitter();
+	if (engine_blitter == NULL)
+	{
+		GST_INFO_OBJECT(object, "could not create %s blitter; not using it as an engine", backend->name);
+		return FALSE;
+	}
+
+	if (!imx_2d_backend_dispatch_blitter_add_engine(dispatch_blitter, backend->name, engine_blitter, NULL))
+	{
+		GST_WARNING_OBJECT(object, "could not add %s engine", backend->name);
+		imx_2d_blitter_destroy(engine_blitter);
+		return FALSE;
+	}
+
+	GST_DEBUG_OBJECT(object, "added %s engine", backend->name);
+
+	return TRUE;
+}
+
+
+Imx2dBlitter* gst_imx_dispatch_create_blitter(GstObject *object, gchar const *engines)
+{
+	Imx2dBlitter *dispatch_blitter;
+	guint i;
+
+	init_debug_category();
+
+	dispatch_blitter = imx_2d_backend_dispatch_blitter_create();
+
+	if ((engines == NULL) || (engines[0] == '\0'))
+	{
+		for (i = 0; engine_backends[i].name != NULL; ++i)
+			add_engine(object, dispatch_blitter, &(engine_backends[i]));
+	}
+	else
+	{
+		gchar **engine_names = g_strsplit(engines, ",", -1);
+
+		for (i = 0; engine_names[i] != NULL; ++i)
+		{
+			gchar const *engine_name = g_strstrip(engine_names[i]);
+			guint j;
+
+			for (j = 0; engine_backends[j].name != NULL; ++j)
+			{
+				if (strcmp(engine_backends[j].name, engine_name) == 0)
+					break;
+			}
+
+			if (engine_backends[j].name == NULL)
+			{
+				GST_ERROR_OBJECT(object, "unknown or unavailable engine \"%s\"", engine_name);
+				g_strfreev(engine_names);
+				goto error;
+			}
+
+			add_engine(object, dispatch_blitter, &(engine_backends[j]));
+		}
+
+		g_strfreev(engine_names);
+	}
+
+	if (imx_2d_backend_dispatch_blitter_get_num_engines(dispatch_blitter) == 0)
+	{
+		GST_ERROR_OBJECT(object, "none of the engines could be created");
+		goto error;
+	}
+
+	GST_DEBUG_OBJECT(object, "created dispatch blitter with %d engine(s)", imx_2d_backend_dispatch_blitter_get_num_engines(dispatch_blitter));
+
+	return dispatch_blitter;
+
+error:
+	imx_2d_blitter_destroy(dispatch_blitter);
+	return NULL;
+}
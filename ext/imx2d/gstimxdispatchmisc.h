@@ -0,0 +1,45 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef GST_IMX_DISPATCH_MISC_H
+#define GST_IMX_DISPATCH_MISC_H
+
+#include <gst/gst.h>
+#include "imx2d/imx2d.h"
+
+
+G_BEGIN_DECLS
+
+
+/* Returns the merged capabilities of all backends that were enabled
+ * at build time. Used for the pad templates of the dispatch elements. */
+Imx2dHardwareCapabilities const * gst_imx_dispatch_get_hardware_capabilities(void);
+
+/* Creates a dispatch blitter with the backends in the comma-separated
+ * engines list (for example "g2d,sw") as engines. If engines is NULL
+ * or empty, all backends that were enabled at build time are used.
+ * Backends that cannot be created at runtime (for example, because the
+ * device is missing) are skipped. Returns NULL if the list is invalid
+ * or none of the engines could be created. */
+Imx2dBlitter* gst_imx_dispatch_create_blitter(GstObject *object, gchar const *engines);
+
+
+G_END_DECLS
+
+
+#endif /* GST_IMX_DISPATCH_MISC_H */
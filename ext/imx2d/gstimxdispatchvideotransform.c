@@ -0,0 +1,190 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "gstimx2dmisc.h"
+#include "gstimx2dvideotransform.h"
+#include "gstimxdispatchmisc.h"
+#include "gstimxdispatchvideotransform.h"
+
+
+GST_DEBUG_CATEGORY_STATIC(imx_dispatch_video_transform_debug);
+#define GST_CAT_DEFAULT imx_dispatch_video_transform_debug
+
+
+enum
+{
+	PROP_0,
+	PROP_ENGINES
+};
+
+
+#define DEFAULT_ENGINES NULL
+
+
+struct _GstImxDispatchVideoTransform
+{
+	GstImx2dVideoTransform parent;
+
+	gchar *engines;
+};
+
+
+struct _GstImxDispatchVideoTransformClass
+{
+	GstImx2dVideoTransformClass parent_class;
+};
+
+
+G_DEFINE_TYPE(GstImxDispatchVideoTransform, gst_imx_dispatch_video_transform, GST_TYPE_IMX_2D_VIDEO_TRANSFORM)
+
+
+static void gst_imx_dispatch_video_transform_finalize(GObject *object);
+static void gst_imx_dispatch_video_transform_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
+static void gst_imx_dispatch_video_transform_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
+
+static Imx2dBlitter* gst_imx_dispatch_video_transform_create_blitter(GstImx2dVideoTransform *imx_2d_video_transform);
+
+
+
+
+static void gst_imx_dispatch_video_transform_class_init(GstImxDispatchVideoTransformClass *klass)
+{
+	GObjectClass *object_class;
+	GstElementClass *element_class;
+	GstImx2dVideoTransformClass *imx_2d_video_transform_class;
+
+	GST_DEBUG_CATEGORY_INIT(imx_dispatch_video_transform_debug, "imxdispatchvideotransform", 0, "NXP i.MX dispatch video transform");
+
+	object_class = G_OBJECT_CLASS(klass);
+	element_class = GST_ELEMENT_CLASS(klass);
+
+	object_class->finalize     = GST_DEBUG_FUNCPTR(gst_imx_dispatch_video_transform_finalize);
+	object_class->set_property = GST_DEBUG_FUNCPTR(gst_imx_dispatch_video_transform_set_property);
+	object_class->get_property = GST_DEBUG_FUNCPTR(gst_imx_dispatch_video_transform_get_property);
+	imx_2d_video_transform_class = GST_IMX_2D_VIDEO_TRANSFORM_CLASS(klass);
+
+	imx_2d_video_transform_class->start = NULL;
+	imx_2d_video_transform_class->stop = NULL;
+	imx_2d_video_transform_class->create_blitter = GST_DEBUG_FUNCPTR(gst_imx_dispatch_video_transform_create_blitter);
+
+	gst_imx_2d_video_transform_common_class_init(
+		imx_2d_video_transform_class,
+		gst_imx_dispatch_get_hardware_capabilities()
+	);
+
+	g_object_class_install_property(
+		object_class,
+		PROP_ENGINES,
+		g_param_spec_string(
+			"engines",
+			"Engines",
+			"Comma-separated list of 2D backends to route blits to, like \"g2d,sw\"; each blit goes to the "
+			"engine with the lowest estimated cost; empty = all backends enabled at build time "
+			"(takes effect when the element is started)",
+			DEFAULT_ENGINES,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+
+	gst_element_class_set_static_metadata(
+		element_class,
+		"i.MX dispatch video transform",
+		"Filter/Converter/Video/Scaler/Transform/Effect/Hardware",
+		"Video transformation that routes each blit to the cheapest of the available i.MX 2D backends",
+		"Carlos Rafael Giani <crg7475@mailbox.org>"
+	);
+}
+
+
+void gst_imx_dispatch_video_transform_init(GstImxDispatchVideoTransform *self)
+{
+	self->engines = g_strdup(DEFAULT_ENGINES);
+}
+
+
+static void gst_imx_dispatch_video_transform_finalize(GObject *object)
+{
+	GstImxDispatchVideoTransform *self = GST_IMX_DISPATCH_VIDEO_TRANSFORM(object);
+
+	g_free(self->engines);
+
+	G_OBJECT_CLASS(gst_imx_dispatch_video_transform_parent_class)->finalize(object);
+}
+
+
+static void gst_imx_dispatch_video_transform_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
+{
+	GstImxDispatchVideoTransform *self = GST_IMX_DISPATCH_VIDEO_TRANSFORM(object);
+
+	switch (prop_id)
+	{
+		case PROP_ENGINES:
+		{
+			GST_OBJECT_LOCK(self);
+			g_free(self->engines);
+			self->engines = g_value_dup_string(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static void gst_imx_dispatch_video_transform_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	GstImxDispatchVideoTransform *self = GST_IMX_DISPATCH_VIDEO_TRANSFORM(object);
+
+	switch (prop_id)
+	{
+		case PROP_ENGINES:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_string(value, self->engines);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static Imx2dBlitter* gst_imx_dispatch_video_transform_create_blitter(GstImx2dVideoTransform *imx_2d_video_transform)
+{
+	GstImxDispatchVideoTransform *self = GST_IMX_DISPATCH_VIDEO_TRANSFORM(imx_2d_video_transform);
+	Imx2dBlitter *blitter;
+	gchar *engines;
+
+	GST_OBJECT_LOCK(self);
+	engines = g_strdup(self->engines);
+	GST_OBJECT_UNLOCK(self);
+
+	blitter = gst_imx_dispatch_create_blitter(GST_OBJECT(self), engines);
+
+	g_free(engines);
+
+	return blitter;
+}
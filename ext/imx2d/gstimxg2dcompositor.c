@@ -53,6 +53,7 @@ static void gst_imx_g2d_compositor_class_init(GstImxG2DCompositorClass *klass)
 	imx_2d_compositor_class = GST_IMX_2D_COMPOSITOR_CLASS(klass);
 
 	imx_2d_compositor_class->create_blitter = GST_DEBUG_FUNCPTR(gst_imx_g2d_compositor_create_blitter);
+	imx_2d_compositor_class->shared_blitter_backend_name = "g2d";
 
 	gst_imx_2d_compositor_common_class_init(
 		imx_2d_compositor_class,
@@ -0,0 +1,83 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "imx2d/backend/g2d/g2d_blitter.h"
+#include "gstimx2dmisc.h"
+#include "gstimx2dmultiscaler.h"
+#include "gstimxg2dmultiscaler.h"
+
+
+struct _GstImxG2DMultiScaler
+{
+	GstImx2dMultiScaler parent;
+};
+
+
+struct _GstImxG2DMultiScalerClass
+{
+	GstImx2dMultiScalerClass parent_class;
+};
+
+
+G_DEFINE_TYPE(GstImxG2DMultiScaler, gst_imx_g2d_multi_scaler, GST_TYPE_IMX_2D_MULTI_SCALER)
+
+
+static Imx2dBlitter* gst_imx_g2d_multi_scaler_create_blitter(GstImx2dMultiScaler *imx_2d_multi_scaler);
+
+
+
+
+static void gst_imx_g2d_multi_scaler_class_init(GstImxG2DMultiScalerClass *klass)
+{
+	GstElementClass *element_class;
+	GstImx2dMultiScalerClass *imx_2d_multi_scaler_class;
+
+	element_class = GST_ELEMENT_CLASS(klass);
+	imx_2d_multi_scaler_class = GST_IMX_2D_MULTI_SCALER_CLASS(klass);
+
+	imx_2d_multi_scaler_class->start = NULL;
+	imx_2d_multi_scaler_class->stop = NULL;
+	imx_2d_multi_scaler_class->create_blitter = GST_DEBUG_FUNCPTR(gst_imx_g2d_multi_scaler_create_blitter);
+	imx_2d_multi_scaler_class->shared_blitter_backend_name = "g2d";
+
+	gst_imx_2d_multi_scaler_common_class_init(
+		imx_2d_multi_scaler_class,
+		imx_2d_backend_g2d_get_hardware_capabilities()
+	);
+
+	gst_element_class_set_static_metadata(
+		element_class,
+		"i.MX G2D multi scaler",
+		"Filter/Converter/Video/Scaler/Hardware",
+		"Scales and converts one video stream into several outputs using the Vivante G2D API on i.MX platforms",
+		"Carlos Rafael Giani <crg7475@mailbox.org>"
+	);
+}
+
+
+void gst_imx_g2d_multi_scaler_init(G_GNUC_UNUSED GstImxG2DMultiScaler *self)
+{
+}
+
+
+static Imx2dBlitter* gst_imx_g2d_multi_scaler_create_blitter(G_GNUC_UNUSED GstImx2dMultiScaler *imx_2d_multi_scaler)
+{
+	return imx_2d_backend_g2d_blitter_create();
+}
@@ -0,0 +1,83 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2021  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "imx2d/backend/ipu/ipu_blitter.h"
+#include "gstimx2dmisc.h"
+#include "gstimx2dmultiscaler.h"
+#include "gstimxipumultiscaler.h"
+
+
+struct _GstImxIPUMultiScaler
+{
+	GstImx2dMultiScaler parent;
+};
+
+
+struct _GstImxIPUMultiScalerClass
+{
+	GstImx2dMultiScalerClass parent_class;
+};
+
+
+G_DEFINE_TYPE(GstImxIPUMultiScaler, gst_imx_ipu_multi_scaler, GST_TYPE_IMX_2D_MULTI_SCALER)
+
+
+static Imx2dBlitter* gst_imx_ipu_multi_scaler_create_blitter(GstImx2dMultiScaler *imx_2d_multi_scaler);
+
+
+
+
+static void gst_imx_ipu_multi_scaler_class_init(GstImxIPUMultiScalerClass *klass)
+{
+	GstElementClass *element_class;
+	GstImx2dMultiScalerClass *imx_2d_multi_scaler_class;
+
+	element_class = GST_ELEMENT_CLASS(klass);
+	imx_2d_multi_scaler_class = GST_IMX_2D_MULTI_SCALER_CLASS(klass);
+
+	imx_2d_multi_scaler_class->start = NULL;
+	imx_2d_multi_scaler_class->stop = NULL;
+	imx_2d_multi_scaler_class->create_blitter = GST_DEBUG_FUNCPTR(gst_imx_ipu_multi_scaler_create_blitter);
+	imx_2d_multi_scaler_class->shared_blitter_backend_name = "ipu";
+
+	gst_imx_2d_multi_scaler_common_class_init(
+		imx_2d_multi_scaler_class,
+		imx_2d_backend_ipu_get_hardware_capabilities()
+	);
+
+	gst_element_class_set_static_metadata(
+		element_class,
+		"i.MX IPU multi scaler",
+		"Filter/Converter/Video/Scaler/Hardware",
+		"Scales and converts one video stream into several outputs using the i.MX IPU",
+		"Carlos Rafael Giani <crg7475@mailbox.org>"
+	);
+}
+
+
+void gst_imx_ipu_multi_scaler_init(G_GNUC_UNUSED GstImxIPUMultiScaler *self)
+{
+}
+
+
+static Imx2dBlitter* gst_imx_ipu_multi_scaler_create_blitter(G_GNUC_UNUSED GstImx2dMultiScaler *imx_2d_multi_scaler)
+{
+	return imx_2d_backend_ipu_blitter_create();
+}
@@ -55,6 +55,7 @@ static void gst_imx_ipu_video_transform_class_init(GstImxIPUVideoTransformClass
 	imx_2d_video_transform_class->start = NULL;
 	imx_2d_video_transform_class->stop = NULL;
 	imx_2d_video_transform_class->create_blitter = GST_DEBUG_FUNCPTR(gst_imx_ipu_video_transform_create_blitter);
+	imx_2d_video_transform_class->shared_blitter_backend_name = "ipu";
 
 	gst_imx_2d_video_transform_common_class_init(
 		imx_2d_video_transform_class,
@@ -55,6 +55,7 @@ static void gst_imx_pxp_video_sink_class_init(GstImxPxPVideoSinkClass *klass)
 	imx_2d_video_sink_class->start = NULL;
 	imx_2d_video_sink_class->stop = NULL;
 	imx_2d_video_sink_class->create_blitter = GST_DEBUG_FUNCPTR(gst_imx_pxp_video_sink_create_blitter);
+	imx_2d_video_sink_class->shared_blitter_backend_name = "pxp";
 
 	gst_imx_2d_video_sink_common_class_init(
 		imx_2d_video_sink_class,
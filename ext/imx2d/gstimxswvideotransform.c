@@ -0,0 +1,241 @@
+/* gstreamer-imx: GStreamer plugins for the i.MX SoCs
+ * Copyright (C) 2020  Carlos Rafael Giani
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "imx2d/backend/sw/sw_blitter.h"
+#include "gstimx2dmisc.h"
+#include "gstimx2dvideotransform.h"
+#include "gstimxswvideotransform.h"
+
+
+GST_DEBUG_CATEGORY_STATIC(imx_sw_video_transform_debug);
+#define GST_CAT_DEFAULT imx_sw_video_transform_debug
+
+
+enum
+{
+	PROP_0,
+	PROP_NUM_THREADS,
+	PROP_CPU_AFFINITY
+};
+
+
+#define DEFAULT_NUM_THREADS 0
+#define DEFAULT_CPU_AFFINITY NULL
+
+
+struct _GstImxSwVideoTransform
+{
+	GstImx2dVideoTransform parent;
+
+	guint num_threads;
+	gchar *cpu_affinity;
+};
+
+
+struct _GstImxSwVideoTransformClass
+{
+	GstImx2dVideoTransformClass parent_class;
+};
+
+
+G_DEFINE_TYPE(GstImxSwVideoTransform, gst_imx_sw_video_transform, GST_TYPE_IMX_2D_VIDEO_TRANSFORM)
+
+
+static void gst_imx_sw_video_transform_finalize(GObject *object);
+static void gst_imx_sw_video_transform_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
+static void gst_imx_sw_video_transform_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
+
+static Imx2dBlitter* gst_imx_sw_video_transform_create_blitter(GstImx2dVideoTransform *imx_2d_video_transform);
+
+
+
+
+static void gst_imx_sw_video_transform_class_init(GstImxSwVideoTransformClass *klass)
+{
+	GObjectClass *object_class;
+	GstElementClass *element_class;
+	GstImx2dVideoTransformClass *imx_2d_video_transform_class;
+
+	GST_DEBUG_CATEGORY_INIT(imx_sw_video_transform_debug, "imxswvideotransform", 0, "NXP i.MX software video transform");
+
+	object_class = G_OBJECT_CLASS(klass);
+	element_class = GST_ELEMENT_CLASS(klass);
+
+	object_class->finalize     = GST_DEBUG_FUNCPTR(gst_imx_sw_video_transform_finalize);
+	object_class->set_property = GST_DEBUG_FUNCPTR(gst_imx_sw_video_transform_set_property);
+	object_class->get_property = GST_DEBUG_FUNCPTR(gst_imx_sw_video_transform_get_property);
+	imx_2d_video_transform_class = GST_IMX_2D_VIDEO_TRANSFORM_CLASS(klass);
+
+	imx_2d_video_transform_class->start = NULL;
+	imx_2d_video_transform_class->stop = NULL;
+	imx_2d_video_transform_class->create_blitter = GST_DEBUG_FUNCPTR(gst_imx_sw_video_transform_create_blitter);
+
+	gst_imx_2d_video_transform_common_class_init(
+		imx_2d_video_transform_class,
+		imx_2d_backend_sw_get_hardware_capabilities()
+	);
+
+	g_object_class_install_property(
+		object_class,
+		PROP_NUM_THREADS,
+		g_param_spec_uint(
+			"num-threads",
+			"Number of threads",
+			"Number of threads to process each frame with, split into horizontal bands; "
+			"0 = one thread per online CPU core (takes effect when the element is started)",
+			0, IMX_2D_BACKEND_SW_MAX_NUM_THREADS,
+			DEFAULT_NUM_THREADS,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+	g_object_class_install_property(
+		object_class,
+		PROP_CPU_AFFINITY,
+		g_param_spec_string(
+			"cpu-affinity",
+			"CPU affinity",
+			"CPUs to pin the worker threads to, as a list like \"0-3,6\", or \"big\" for the cores with "
+			"the highest capacity on big.LITTLE SoCs; empty = no pinning (takes effect when the element is started)",
+			DEFAULT_CPU_AFFINITY,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
+
+	gst_element_class_set_static_metadata(
+		element_class,
+		"i.MX software video transform",
+		"Filter/Converter/Video/Scaler/Transform/Effect",
+		"Video transformation using the imx2d CPU based software blitter",
+		"Carlos Rafael Giani <crg7475@mailbox.org>"
+	);
+}
+
+
+void gst_imx_sw_video_transform_init(GstImxSwVideoTransform *self)
+{
+	self->num_threads = DEFAULT_NUM_THREADS;
+	self->cpu_affinity = g_strdup(DEFAULT_CPU_AFFINITY);
+}
+
+
+static void gst_imx_sw_video_transform_finalize(GObject *object)
+{
+	GstImxSwVideoTransform *self = GST_IMX_SW_VIDEO_TRANSFORM(object);
+
+	g_free(self->cpu_affinity);
+
+	G_OBJECT_CLASS(gst_imx_sw_video_transform_parent_class)->finalize(object);
+}
+
+
+static void gst_imx_sw_video_transform_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
+{
+	GstImxSwVideoTransform *self = GST_IMX_SW_VIDEO_TRANSFORM(object);
+
+	switch (prop_id)
+	{
+		case PROP_NUM_THREADS:
+		{
+			GST_OBJECT_LOCK(self);
+			self->num_threads = g_value_get_uint(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_CPU_AFFINITY:
+		{
+			GST_OBJECT_LOCK(self);
+			g_free(self->cpu_affinity);
+			self->cpu_affinity = g_value_dup_string(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static void gst_imx_sw_video_transform_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	GstImxSwVideoTransform *self = GST_IMX_SW_VIDEO_TRANSFORM(object);
+
+	switch (prop_id)
+	{
+		case PROP_NUM_THREADS:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_uint(value, self->num_threads);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		case PROP_CPU_AFFINITY:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_string(value, self->cpu_affinity);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static Imx2dBlitter* gst_imx_sw_video_transform_create_blitter(GstImx2dVideoTransform *imx_2d_video_transform)
+{
+	GstImxSwVideoTransform *self = GST_IMX_SW_VIDEO_TRANSFORM(imx_2d_video_transform);
+	Imx2dBlitter *blitter;
+	guint num_threads;
+	gchar *cpu_affinity;
+	uint64_t cpu_affinity_mask;
+
+	GST_OBJECT_LOCK(self);
+	num_threads = self->num_threads;
+	cpu_affinity = g_strdup(self->cpu_affinity);
+	GST_OBJECT_UNLOCK(self);
+
+	if (!imx_2d_backend_sw_parse_cpu_affinity(cpu_affinity, &cpu_affinity_mask))
+	{
+		GST_ERROR_OBJECT(self, "invalid CPU affinity \"%s\"", cpu_affinity);
+		g_free(cpu_affinity);
+		return NULL;
+	}
+
+	g_free(cpu_affinity);
+
+	blitter = imx_2d_backend_sw_blitter_create_threaded(num_threads, cpu_affinity_mask);
+	if (blitter != NULL)
+	{
+		GST_DEBUG_OBJECT(
+			self,
+			"created software blitter with %d thread(s) and CPU affinity mask %#" G_GINT64_MODIFIER "x",
+			imx_2d_backend_sw_blitter_get_num_threads(blitter),
+			(guint64)cpu_affinity_mask
+		);
+	}
+
+	return blitter;
+}
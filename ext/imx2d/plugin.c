@@ -20,18 +20,27 @@
 #include <gst/gst.h>
 
 #ifdef WITH_GST_IMX2D_COMPOSITOR
+#include "gstimxdispatchcompositor.h"
 #include "gstimxg2dcompositor.h"
+#include "gstimxswcompositor.h"
 #endif
 
 #ifdef WITH_GST_IMX2D_VIDEOSINK
 #include "gstimxg2dvideosink.h"
 #include "gstimxipuvideosink.h"
 #include "gstimxpxpvideosink.h"
+#include "gstimxswvideosink.h"
 #endif
 
+#include "gstimxdispatchvideotransform.h"
+#include "gstimxg2dmultiscaler.h"
+#include "gstimxipumultiscaler.h"
+#include "gstimxpxpmultiscaler.h"
+#include "gstimxswmultiscaler.h"
 #include "gstimxg2dvideotransform.h"
 #include "gstimxipuvideotransform.h"
 #include "gstimxpxpvideotransform.h"
+#include "gstimxswvideotransform.h"
 
 
 static gboolean plugin_init(GstPlugin *plugin)
@@ -45,6 +54,7 @@ static gboolean plugin_init(GstPlugin *plugin)
 #ifdef WITH_GST_IMX2D_VIDEOSINK
 	ret = ret && gst_element_register(plugin, "imxg2dvideosink", GST_RANK_NONE, gst_imx_g2d_video_sink_get_type());
 #endif
+	ret = ret && gst_element_register(plugin, "imxg2dmultiscaler", GST_RANK_NONE, gst_imx_g2d_multi_scaler_get_type());
 	ret = ret && gst_element_register(plugin, "imxg2dvideotransform", GST_RANK_NONE, gst_imx_g2d_video_transform_get_type());
 #endif
 
@@ -52,6 +62,7 @@ static gboolean plugin_init(GstPlugin *plugin)
 #ifdef WITH_GST_IMX2D_VIDEOSINK
 	ret = ret && gst_element_register(plugin, "imxipuvideosink", GST_RANK_NONE, gst_imx_ipu_video_sink_get_type());
 #endif
+	ret = ret && gst_element_register(plugin, "imxipumultiscaler", GST_RANK_NONE, gst_imx_ipu_multi_scaler_get_type());
 	ret = ret && gst_element_register(plugin, "imxipuvideotransform", GST_RANK_NONE, gst_imx_ipu_video_transform_get_type());
 #endif
 
@@ -59,9 +70,28 @@ static gboolean plugin_init(GstPlugin *plugin)
 #ifdef WITH_GST_IMX2D_VIDEOSINK
 	ret = ret && gst_element_register(plugin, "imxpxpvideosink", GST_RANK_NONE, gst_imx_pxp_video_sink_get_type());
 #endif
+	ret = ret && gst_element_register(plugin, "imxpxpmultiscaler", GST_RANK_NONE, gst_imx_pxp_multi_scaler_get_type());
 	ret = ret && gst_element_register(plugin, "imxpxpvideotransform", GST_RANK_NONE, gst_imx_pxp_video_transform_get_type());
 #endif
 
+#ifdef WITH_IMX2D_SW_BACKEND
+#ifdef WITH_GST_IMX2D_COMPOSITOR
+	ret = ret && gst_element_register(plugin, "imxswcompositor", GST_RANK_NONE, gst_imx_sw_compositor_get_type());
+#endif
+#ifdef WITH_GST_IMX2D_VIDEOSINK
+	ret = ret && gst_element_register(plugin, "imxswvideosink", GST_RANK_NONE, gst_imx_sw_video_sink_get_type());
+#endif
+	ret = ret && gst_element_register(plugin, "imxswmultiscaler", GST_RANK_NONE, gst_imx_sw_multi_scaler_get_type());
+	ret = ret && gst_element_register(plugin, "imxswvideotransform", GST_RANK_NONE, gst_imx_sw_video_transform_get_type());
+#endif
+
+#ifdef WITH_GST_IMX2D_DISPATCH
+#ifdef WITH_GST_IMX2D_COMPOSITOR
+	ret = ret && gst_element_register(plugin, "imxdispatchcompositor", GST_RANK_NONE, gst_imx_dispatch_compositor_get_type());
+#endif
+	ret = ret && gst_element_register(plugin, "imxdispatchvideotransform", GST_RANK_NONE, gst_imx_dispatch_video_transform_get_type());
+#endif
+
 	return ret;
 }
 
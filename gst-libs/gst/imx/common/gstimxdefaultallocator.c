@@ -209,6 +209,13 @@ static gpointer gst_imx_default_allocator_map(GstMemory *memory, GstMapInfo *inf
 	if (info->flags & GST_MAP_FLAG_IMX_MANUAL_SYNC)
 		flags |= IMX_DMA_BUFFER_MAPPING_FLAG_MANUAL_SYNC;
 
+	/* Make sure any asynchronous write into this memory is done. */
+	if (!gst_imx_dma_buffer_memory_wait_fence(memory))
+	{
+		GST_ERROR_OBJECT(memory->allocator, "could not map memory: asynchronous operation on memory failed");
+		return NULL;
+	}
+
 	mapped_virtual_address = imx_dma_buffer_map(imx_dma_memory->dmabuffer, flags, &error);
 	if (mapped_virtual_address == NULL)
 		GST_ERROR_OBJECT(memory->allocator, "could not map memory: %s (%d)", strerror(error), error);
@@ -376,6 +376,14 @@ static gpointer gst_imx_dmabuf_allocator_mem_map_full(GstMemory *memory, GstMapI
 	flags |= (info->flags & GST_MAP_WRITE) ? IMX_DMA_BUFFER_MAPPING_FLAG_WRITE : 0;
 	flags |= (info->flags & GST_MAP_FLAG_IMX_MANUAL_SYNC) ? IMX_DMA_BUFFER_MAPPING_FLAG_MANUAL_SYNC : 0;
 
+	/* Make sure any asynchronous write into this memory is done. */
+	if (G_UNLIKELY(!gst_imx_dma_buffer_memory_wait_fence(memory)))
+	{
+		GST_ERROR_OBJECT(memory->allocator, "could not map imxdmabuffer %p: asynchronous operation on memory failed", (gpointer)imx_dma_buffer);
+		mapped_virtual_address = NULL;
+		goto finish;
+	}
+
 	mapped_virtual_address = imx_dma_buffer_map(imx_dma_buffer, flags, &error);
 	if (G_UNLIKELY(mapped_virtual_address == NULL))
 	{
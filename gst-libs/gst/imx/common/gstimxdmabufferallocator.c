@@ -98,6 +98,92 @@ ImxDmaBuffer* gst_imx_get_dma_buffer_from_buffer(GstBuffer *buffer)
 }
 
 
+typedef struct
+{
+	gpointer fence;
+	GstImxDmaBufferFenceWaitFunc wait_func;
+	GDestroyNotify destroy_func;
+}
+GstImxDmaBufferFence;
+
+
+static GQuark gst_imx_dma_buffer_fence_quark(void)
+{
+	static GQuark quark = 0;
+	if (G_UNLIKELY(quark == 0))
+		quark = g_quark_from_static_string("GstImxDmaBufferFence");
+	return quark;
+}
+
+
+static void gst_imx_dma_buffer_fence_free(gpointer data)
+{
+	GstImxDmaBufferFence *fence_data = (GstImxDmaBufferFence *)data;
+	if (fence_data->destroy_func != NULL)
+		fence_data->destroy_func(fence_data->fence);
+	g_slice_free(GstImxDmaBufferFence, fence_data);
+}
+
+
+/**
+ * gst_imx_dma_buffer_memory_set_fence:
+ * @memory: a #GstMemory that is backed by an ImxDmaBuffer
+ * @fence: (nullable): Fence to associate with the memory, or NULL to remove the current fence
+ * @wait_func: Function that waits for @fence
+ * @destroy_func: (nullable): Function to call on @fence once it is no longer needed
+ *
+ * Associates a completion fence with @memory. This is used by producers that
+ * write into the memory asynchronously (for example, with a 2D blitter). The
+ * i.MX DMA buffer allocators wait on the fence when the memory is mapped, and
+ * gst_imx_dma_buffer_memory_wait_fence() can be used to wait on it before
+ * the memory is accessed in other ways (for example, by a hardware unit).
+ *
+ * Any fence that was previously associated with @memory is destroyed.
+ */
+void gst_imx_dma_buffer_memory_set_fence(GstMemory *memory, gpointer fence, GstImxDmaBufferFenceWaitFunc wait_func, GDestroyNotify destroy_func)
+{
+	GstImxDmaBufferFence *fence_data = NULL;
+
+	g_return_if_fail(memory != NULL);
+	g_return_if_fail((fence == NULL) || (wait_func != NULL));
+
+	if (fence != NULL)
+	{
+		fence_data = g_slice_new(GstImxDmaBufferFence);
+		fence_data->fence = fence;
+		fence_data->wait_func = wait_func;
+		fence_data->destroy_func = destroy_func;
+	}
+
+	gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(memory), gst_imx_dma_buffer_fence_quark(), fence_data, gst_imx_dma_buffer_fence_free);
+}
+
+
+/**
+ * gst_imx_dma_buffer_memory_wait_fence:
+ * @memory: a #GstMemory
+ *
+ * Waits on the fence that was associated with @memory by calling
+ * gst_imx_dma_buffer_memory_set_fence(). If there is no such fence,
+ * this function returns immediately.
+ *
+ * Returns: FALSE if the operation associated with the fence failed, TRUE otherwise.
+ */
+gboolean gst_imx_dma_buffer_memory_wait_fence(GstMemory *memory)
+{
+	GstImxDmaBufferFence *fence_data;
+
+	if (G_UNLIKELY(memory == NULL))
+		return TRUE;
+
+	fence_data = gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(memory), gst_imx_dma_buffer_fence_quark());
+	if (fence_data == NULL)
+		return TRUE;
+
+	return fence_data->wait_func(fence_data->fence);
+}
+
+
 /**
  * gst_imx_allocator_new:
  *
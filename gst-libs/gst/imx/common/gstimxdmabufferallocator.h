@@ -63,6 +63,17 @@ struct _GstImxDmaBufferAllocatorInterface
 };
 
 
+/**
+ * GstImxDmaBufferFenceWaitFunc:
+ * @fence: Fence to wait for.
+ *
+ * Blocks until the operation associated with @fence is done.
+ *
+ * Returns: TRUE if the operation succeeded, FALSE otherwise.
+ */
+typedef gboolean (*GstImxDmaBufferFenceWaitFunc)(gpointer fence);
+
+
 GType gst_imx_dma_buffer_allocator_get_type(void);
 
 gboolean gst_imx_is_imx_dma_buffer_memory(GstMemory *memory);
@@ -71,6 +82,9 @@ gboolean gst_imx_has_imx_dma_buffer_memory(GstBuffer *buffer);
 ImxDmaBuffer* gst_imx_get_dma_buffer_from_memory(GstMemory *memory);
 ImxDmaBuffer* gst_imx_get_dma_buffer_from_buffer(GstBuffer *buffer);
 
+void gst_imx_dma_buffer_memory_set_fence(GstMemory *memory, gpointer fence, GstImxDmaBufferFenceWaitFunc wait_func, GDestroyNotify destroy_func);
+gboolean gst_imx_dma_buffer_memory_wait_fence(GstMemory *memory);
+
 GstAllocator* gst_imx_allocator_new(void);
 
 
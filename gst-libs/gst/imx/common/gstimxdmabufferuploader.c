@@ -422,6 +422,20 @@ GstFlowReturn gst_imx_dma_buffer_uploader_perform(GstImxDmaBufferUploader *uploa
 
 		if (is_all_imxdmabuffer_memory)
 		{
+			/* The caller accesses the memory blocks directly (typically
+			 * with hardware units), so if an upstream element is still
+			 * writing into them asynchronously, wait until it is done. */
+			for (memory_idx = 0; memory_idx < (gint)gst_buffer_n_memory(input_buffer); ++memory_idx)
+			{
+				GstMemory *memory = gst_buffer_peek_memory(input_buffer, memory_idx);
+
+				if (!gst_imx_dma_buffer_memory_wait_fence(memory))
+				{
+					GST_ERROR_OBJECT(uploader, "asynchronous operation on memory #%d of input buffer failed", memory_idx);
+					return GST_FLOW_ERROR;
+				}
+			}
+
 			GST_LOG_OBJECT(uploader, "input buffer consists only of imxdmabuffer memory blocks; passing through buffer");
 			*output_buffer = gst_buffer_ref(input_buffer);
 			return GST_FLOW_OK;
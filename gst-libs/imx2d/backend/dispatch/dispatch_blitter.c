@@ -0,0 +1,828 @@
+/* Needed for clock_gettime() */
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <config.h>
+
+#include "imx2d/imx2d_priv.h"
+#include "dispatch_blitter.h"
+
+
+/* How strongly each measurement affects the cost table.
+ * Smaller values make the costs more stable, but slower
+ * to adapt to the actual engine performance. */
+#define COST_UPDATE_WEIGHT 0.125
+
+/* Limits for the ratio between measured and predicted duration of an
+ * engine sequence. This keeps outliers (for example, a sequence that
+ * was delayed because the process was preempted) from distorting the
+ * cost table too much. */
+#define MIN_COST_UPDATE_RATIO 0.25
+#define MAX_COST_UPDATE_RATIO 4.0
+
+/* Added to the cost of an engine other than the one that is currently
+ * active. Switching engines requires finishing the sequence of the
+ * active engine, which is wasteful if the other engine is only
+ * marginally cheaper. */
+#define ENGINE_SWITCH_PENALTY_NS 50000.0
+
+#define MAX_NUM_ENGINE_RECORDS 16
+#define MAX_ENGINE_NAME_LENGTH 32
+
+
+
+
+/* Process-wide engine records */
+
+
+/* The cost table and usage count of an engine are shared by all dispatch
+ * blitters in the process, since they describe the engine itself, not a
+ * particular blitter. Records are never removed, so what was learned
+ * about an engine survives the destruction of dispatch blitters. */
+typedef struct
+{
+	char name[MAX_ENGINE_NAME_LENGTH];
+	Imx2dDispatchCosts costs;
+	/* Number of dispatch blitters that are currently
+	 * running an engine sequence on this engine. */
+	int num_active_sequences;
+}
+EngineRecord;
+
+
+static pthread_mutex_t engine_records_mutex = PTHREAD_MUTEX_INITIALIZER;
+static EngineRecord engine_records[MAX_NUM_ENGINE_RECORDS];
+static int num_engine_records = 0;
+
+
+/* Must be called with the engine_records_mutex locked. */
+static EngineRecord* find_engine_record(char const *engine_name)
+{
+	int i;
+
+	for (i = 0; i < num_engine_records; ++i)
+	{
+		if (strcmp(engine_records[i].name, engine_name) == 0)
+			return &(engine_records[i]);
+	}
+
+	return NULL;
+}
+
+
+
+
+/* Capability and cost helpers */
+
+
+static BOOL format_has_alpha(Imx2dPixelFormat format)
+{
+	switch (format)
+	{
+		case IMX_2D_PIXEL_FORMAT_RGBA8888:
+		case IMX_2D_PIXEL_FORMAT_BGRA8888:
+		case IMX_2D_PIXEL_FORMAT_ARGB8888:
+		case IMX_2D_PIXEL_FORMAT_ABGR8888:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+
+static BOOL is_format_in_list(Imx2dPixelFormat format, Imx2dPixelFormat const *formats, int num_formats)
+{
+	int i;
+
+	for (i = 0; i < num_formats; ++i)
+	{
+		if (formats[i] == format)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+
+/* Checks the sizes, strides, and buffer layout of a surface against
+ * the capabilities of an engine. The format is checked separately,
+ * since the allowed formats differ for source and dest surfaces. */
+static BOOL can_engine_access_surface(Imx2dHardwareCapabilities const *capabilities, Imx2dSurface *surface)
+{
+	Imx2dSurfaceDesc const *desc = imx_2d_surface_get_desc(surface);
+	Imx2dPixelFormatInfo const *fmt_info = imx_2d_get_pixel_format_info(desc->format);
+	int plane_nr;
+
+	if ((desc->width < capabilities->min_width) || (desc->width > capabilities->max_width)
+	 || (desc->height < capabilities->min_height) || (desc->height > capabilities->max_height))
+		return FALSE;
+
+	for (plane_nr = 0; plane_nr < fmt_info->num_planes; ++plane_nr)
+	{
+		if ((desc->plane_strides[plane_nr] % capabilities->stride_alignment) != 0)
+			return FALSE;
+
+		if (!capabilities->can_handle_multi_buffer_surfaces && (plane_nr > 0)
+		 && (imx_2d_surface_get_dma_buffer(surface, plane_nr) != imx_2d_surface_get_dma_buffer(surface, 0)))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+static Imx2dDispatchOpType get_blit_op_type(Imx2dInternalBlitParams const *internal_blit_params)
+{
+	Imx2dRegion const *source_region;
+	Imx2dRegion const *dest_region = internal_blit_params->dest_region;
+	Imx2dSurfaceDesc const *source_desc = imx_2d_surface_get_desc(internal_blit_params->source);
+
+	/* Sources marked as opaque are not blended, even if they have an alpha channel. */
+	if ((internal_blit_params->dest_surface_alpha != 255) || (format_has_alpha(source_desc->format) && !(source_desc->is_opaque)))
+		return IMX_2D_DISPATCH_OP_TYPE_BLEND;
+
+	if (internal_blit_params->rotation != IMX_2D_ROTATION_NONE)
+		return IMX_2D_DISPATCH_OP_TYPE_ROTATE;
+
+	source_region = (internal_blit_params->source_region != NULL) ? internal_blit_params->source_region : &(internal_blit_params->source->region);
+
+	if (((source_region->x2 - source_region->x1) != (dest_region->x2 - dest_region->x1))
+	 || ((source_region->y2 - source_region->y1) != (dest_region->y2 - dest_region->y1)))
+		return IMX_2D_DISPATCH_OP_TYPE_SCALE;
+
+	return IMX_2D_DISPATCH_OP_TYPE_COPY;
+}
+
+
+static long get_region_num_pixels(Imx2dRegion const *region)
+{
+	return (long)(region->x2 - region->x1) * (region->y2 - region->y1);
+}
+
+
+static inline int64_t get_monotonic_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((int64_t)(ts.tv_sec)) * 1000000000 + ts.tv_nsec;
+}
+
+
+
+
+/* Dispatch blitter */
+
+
+typedef struct
+{
+	char name[MAX_ENGINE_NAME_LENGTH];
+	Imx2dBlitter *blitter;
+	Imx2dHardwareCapabilities const *capabilities;
+	long num_dispatched_ops;
+}
+DispatchEngine;
+
+
+typedef struct _Imx2dDispatchBlitter Imx2dDispatchBlitter;
+
+
+struct _Imx2dDispatchBlitter
+{
+	Imx2dBlitter parent;
+
+	DispatchEngine engines[IMX_2D_BACKEND_DISPATCH_MAX_NUM_ENGINES];
+	int num_engines;
+
+	Imx2dHardwareCapabilities capabilities;
+	Imx2dPixelFormat source_formats[IMX_2D_NUM_PIXEL_FORMATS];
+	Imx2dPixelFormat dest_formats[IMX_2D_NUM_PIXEL_FORMATS];
+
+	/* The engine whose sequence is currently running, or -1 if
+	 * none is. Engine sequences are started on demand, when the
+	 * first operation is routed to an engine. */
+	int active_engine_index;
+	/* Start time of the active engine sequence, and the sum of the
+	 * costs that were predicted for the operations in it. These are
+	 * compared against each other when the sequence is finished to
+	 * refine the cost table. op_types_in_sequence is a bitmask with
+	 * one bit per Imx2dDispatchOpType used in the sequence. */
+	int64_t sequence_start_time;
+	double sequence_predicted_ns;
+	unsigned int op_types_in_sequence;
+};
+
+
+static void imx_2d_backend_dispatch_blitter_destroy(Imx2dBlitter *blitter);
+
+static int imx_2d_backend_dispatch_blitter_start(Imx2dBlitter *blitter);
+static int imx_2d_backend_dispatch_blitter_finish(Imx2dBlitter *blitter);
+
+static int imx_2d_backend_dispatch_blitter_do_blit(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params);
+static int imx_2d_backend_dispatch_blitter_fill_region(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams *internal_fill_region_params);
+
+static Imx2dHardwareCapabilities const * imx_2d_backend_dispatch_blitter_get_hardware_capabilities(Imx2dBlitter *blitter);
+
+static int imx_2d_backend_dispatch_blitter_fill_regions(Imx2dBlitter *blitter, Imx2dInternalFillRegionsParams *internal_fill_regions_params);
+
+
+static Imx2dBlitterClass imx_2d_backend_dispatch_blitter_class =
+{
+	imx_2d_backend_dispatch_blitter_destroy,
+
+	imx_2d_backend_dispatch_blitter_start,
+	imx_2d_backend_dispatch_blitter_finish,
+
+	imx_2d_backend_dispatch_blitter_do_blit,
+	imx_2d_backend_dispatch_blitter_fill_region,
+
+	imx_2d_backend_dispatch_blitter_get_hardware_capabilities,
+
+	NULL,
+	NULL,
+
+	NULL,
+	NULL,
+	NULL,
+
+	imx_2d_backend_dispatch_blitter_fill_regions,
+
+	"dispatch"
+};
+
+
+static int finish_active_engine_sequence(Imx2dDispatchBlitter *dispatch_blitter)
+{
+	DispatchEngine *engine;
+	EngineRecord *record;
+	int64_t measured_ns;
+	int ret;
+
+	if (dispatch_blitter->active_engine_index < 0)
+		return TRUE;
+
+	engine = &(dispatch_blitter->engines[dispatch_blitter->active_engine_index]);
+	dispatch_blitter->active_engine_index = -1;
+
+	ret = imx_2d_blitter_finish(engine->blitter);
+	measured_ns = get_monotonic_time_ns() - dispatch_blitter->sequence_start_time;
+
+	pthread_mutex_lock(&engine_records_mutex);
+
+	record = find_engine_record(engine->name);
+	assert(record != NULL);
+
+	record->num_active_sequences--;
+
+	/* The measurement covers the entire sequence, so it cannot be
+	 * attributed to individual operations. Instead, the costs of all
+	 * operation types in the sequence are scaled by how far off the
+	 * prediction was. Failed sequences are not measured, since they
+	 * may have been aborted early. */
+	if (ret && (dispatch_blitter->sequence_predicted_ns > 0.0))
+	{
+		double ratio = (double)measured_ns / dispatch_blitter->sequence_predicted_ns;
+		double factor;
+		int op_type;
+
+		ratio = MAX(ratio, MIN_COST_UPDATE_RATIO);
+		ratio = MIN(ratio, MAX_COST_UPDATE_RATIO);
+		factor = (1.0 - COST_UPDATE_WEIGHT) + COST_UPDATE_WEIGHT * ratio;
+
+		for (op_type = 0; op_type < IMX_2D_DISPATCH_NUM_OP_TYPES; ++op_type)
+		{
+			if (dispatch_blitter->op_types_in_sequence & (1u << op_type))
+				record->costs.ns_per_pixel[op_type] *= factor;
+		}
+
+		IMX_2D_LOG(
+			TRACE,
+			"%s engine sequence took %lld ns, predicted: %.0f ns; scaled costs of used op types by %f",
+			engine->name,
+			(long long)measured_ns,
+			dispatch_blitter->sequence_predicted_ns,
+			factor
+		);
+	}
+
+	pthread_mutex_unlock(&engine_records_mutex);
+
+	if (!ret)
+		IMX_2D_LOG(ERROR, "could not finish %s engine sequence", engine->name);
+
+	return ret;
+}
+
+
+/* Picks the cheapest engine for an operation, starts its sequence if
+ * necessary, and returns its index. Returns -1 if no engine can
+ * handle the operation, or if the engine could not be started. */
+static int select_engine(Imx2dDispatchBlitter *dispatch_blitter, Imx2dSurface *source, Imx2dDispatchOpType op_type, long num_pixels)
+{
+	Imx2dSurface *dest = dispatch_blitter->parent.dest;
+	Imx2dPixelFormat dest_format = imx_2d_surface_get_desc(dest)->format;
+	int engine_index;
+	int best_engine_index = -1;
+	double best_cost = 0.0, best_base_cost = 0.0;
+	DispatchEngine *engine;
+	EngineRecord *record;
+
+	pthread_mutex_lock(&engine_records_mutex);
+
+	for (engine_index = 0; engine_index < dispatch_blitter->num_engines; ++engine_index)
+	{
+		Imx2dHardwareCapabilities const *capabilities;
+		double ns_per_pixel, base_cost, cost;
+		int num_other_users;
+
+		engine = &(dispatch_blitter->engines[engine_index]);
+		capabilities = engine->capabilities;
+		record = find_engine_record(engine->name);
+		assert(record != NULL);
+
+		ns_per_pixel = record->costs.ns_per_pixel[op_type];
+		if (ns_per_pixel < 0.0)
+			continue;
+
+		if (!is_format_in_list(dest_format, capabilities->supported_dest_pixel_formats, capabilities->num_supported_dest_pixel_formats)
+		 || !can_engine_access_surface(capabilities, dest))
+			continue;
+
+		if ((source != NULL)
+		 && (!is_format_in_list(imx_2d_surface_get_desc(source)->format, capabilities->supported_source_pixel_formats, capabilities->num_supported_source_pixel_formats)
+		  || !can_engine_access_surface(capabilities, source)))
+			continue;
+
+		/* Other dispatch blitters that currently use this engine
+		 * have to share it with this one, so it will be slower. */
+		num_other_users = record->num_active_sequences - ((engine_index == dispatch_blitter->active_engine_index) ? 1 : 0);
+		base_cost = (record->costs.ns_per_op + ns_per_pixel * num_pixels) * (1 + num_other_users);
+
+		cost = base_cost;
+		if ((dispatch_blitter->active_engine_index >= 0) && (engine_index != dispatch_blitter->active_engine_index))
+			cost += ENGINE_SWITCH_PENALTY_NS;
+
+		if ((best_engine_index < 0) || (cost < best_cost))
+		{
+			best_engine_index = engine_index;
+			best_cost = cost;
+			best_base_cost = base_cost;
+		}
+	}
+
+	pthread_mutex_unlock(&engine_records_mutex);
+
+	if (best_engine_index < 0)
+	{
+		if (source != NULL)
+		{
+			IMX_2D_LOG(
+				ERROR,
+				"no engine can blit from %s to %s with op type %d",
+				imx_2d_pixel_format_to_string(imx_2d_surface_get_desc(source)->format),
+				imx_2d_pixel_format_to_string(dest_format),
+				(int)op_type
+			);
+		}
+		else
+		{
+			IMX_2D_LOG(
+				ERROR,
+				"no engine can fill regions in %s surfaces",
+				imx_2d_pixel_format_to_string(dest_format)
+			);
+		}
+
+		return -1;
+	}
+
+	engine = &(dispatch_blitter->engines[best_engine_index]);
+
+	if (best_engine_index != dispatch_blitter->active_engine_index)
+	{
+		/* Operations must be executed in order. Since engines run
+		 * independently of each other, the sequence of the previous
+		 * engine has to be finished before the next one can start. */
+		if (!finish_active_engine_sequence(dispatch_blitter))
+			return -1;
+
+		if (!imx_2d_blitter_start(engine->blitter, dest))
+		{
+			IMX_2D_LOG(ERROR, "could not start %s engine sequence", engine->name);
+			return -1;
+		}
+
+		pthread_mutex_lock(&engine_records_mutex);
+		record = find_engine_record(engine->name);
+		record->num_active_sequences++;
+		pthread_mutex_unlock(&engine_records_mutex);
+
+		dispatch_blitter->active_engine_index = best_engine_index;
+		dispatch_blitter->sequence_start_time = get_monotonic_time_ns();
+		dispatch_blitter->sequence_predicted_ns = 0.0;
+		dispatch_blitter->op_types_in_sequence = 0;
+	}
+
+	dispatch_blitter->sequence_predicted_ns += best_base_cost;
+	dispatch_blitter->op_types_in_sequence |= 1u << op_type;
+	engine->num_dispatched_ops++;
+
+	IMX_2D_LOG(TRACE, "routing op type %d with %ld pixel(s) to %s engine; estimated cost: %.0f ns", (int)op_type, num_pixels, engine->name, best_base_cost);
+
+	return best_engine_index;
+}
+
+
+static void imx_2d_backend_dispatch_blitter_destroy(Imx2dBlitter *blitter)
+{
+	Imx2dDispatchBlitter *dispatch_blitter = (Imx2dDispatchBlitter *)blitter;
+	int i;
+
+	assert(blitter != NULL);
+
+	finish_active_engine_sequence(dispatch_blitter);
+
+	for (i = 0; i < dispatch_blitter->num_engines; ++i)
+		imx_2d_blitter_destroy(dispatch_blitter->engines[i].blitter);
+
+	free(dispatch_blitter);
+}
+
+
+static int imx_2d_backend_dispatch_blitter_start(Imx2dBlitter *blitter)
+{
+	Imx2dDispatchBlitter *dispatch_blitter = (Imx2dDispatchBlitter *)blitter;
+
+	if (dispatch_blitter->num_engines == 0)
+	{
+		IMX_2D_LOG(ERROR, "dispatch blitter has no engines");
+		return FALSE;
+	}
+
+	/* A sequence may still be running if the previous one was
+	 * aborted without finishing it. */
+	if (dispatch_blitter->active_engine_index >= 0)
+	{
+		IMX_2D_LOG(DEBUG, "finishing engine sequence left over from the previous sequence");
+		finish_active_engine_sequence(dispatch_blitter);
+	}
+
+	return TRUE;
+}
+
+
+static int imx_2d_backend_dispatch_blitter_finish(Imx2dBlitter *blitter)
+{
+	return finish_active_engine_sequence((Imx2dDispatchBlitter *)blitter);
+}
+
+
+static int imx_2d_backend_dispatch_blitter_do_blit(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params)
+{
+	Imx2dDispatchBlitter *dispatch_blitter = (Imx2dDispatchBlitter *)blitter;
+	Imx2dRegion const *expanded_dest_region;
+	Imx2dBlitter *engine_blitter;
+	int engine_index;
+
+	expanded_dest_region = (internal_blit_params->expanded_dest_region != NULL) ? internal_blit_params->expanded_dest_region : internal_blit_params->dest_region;
+
+	engine_index = select_engine(
+		dispatch_blitter,
+		internal_blit_params->source,
+		get_blit_op_type(internal_blit_params),
+		get_region_num_pixels(expanded_dest_region)
+	);
+	if (engine_index < 0)
+		return FALSE;
+
+	/* The params were already checked and clipped by imx2d, so
+	 * they can be passed to the engine's vfunc directly. */
+	engine_blitter = dispatch_blitter->engines[engine_index].blitter;
+	return engine_blitter->blitter_class->do_blit(engine_blitter, internal_blit_params);
+}
+
+
+static int imx_2d_backend_dispatch_blitter_fill_region(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams *internal_fill_region_params)
+{
+	Imx2dDispatchBlitter *dispatch_blitter = (Imx2dDispatchBlitter *)blitter;
+	Imx2dBlitter *engine_blitter;
+	int engine_index;
+
+	engine_index = select_engine(
+		dispatch_blitter,
+		NULL,
+		IMX_2D_DISPATCH_OP_TYPE_FILL,
+		get_region_num_pixels(internal_fill_region_params->dest_region)
+	);
+	if (engine_index < 0)
+		return FALSE;
+
+	engine_blitter = dispatch_blitter->engines[engine_index].blitter;
+	return engine_blitter->blitter_class->fill_region(engine_blitter, internal_fill_region_params);
+}
+
+
+static int imx_2d_backend_dispatch_blitter_fill_regions(Imx2dBlitter *blitter, Imx2dInternalFillRegionsParams *internal_fill_regions_params)
+{
+	Imx2dDispatchBlitter *dispatch_blitter = (Imx2dDispatchBlitter *)blitter;
+	Imx2dBlitter *engine_blitter;
+	int engine_index;
+	int i;
+	long num_pixels = 0;
+
+	/* All regions go to the same engine, which is selected
+	 * based on the total number of pixels to fill. */
+	for (i = 0; i < internal_fill_regions_params->num_dest_regions; ++i)
+		num_pixels += get_region_num_pixels(&(internal_fill_regions_params->dest_regions[i]));
+
+	engine_index = select_engine(
+		dispatch_blitter,
+		NULL,
+		IMX_2D_DISPATCH_OP_TYPE_FILL,
+		num_pixels
+	);
+	if (engine_index < 0)
+		return FALSE;
+
+	engine_blitter = dispatch_blitter->engines[engine_index].blitter;
+
+	if (engine_blitter->blitter_class->fill_regions != NULL)
+		return engine_blitter->blitter_class->fill_regions(engine_blitter, internal_fill_regions_params);
+
+	for (i = 0; i < internal_fill_regions_params->num_dest_regions; ++i)
+	{
+		Imx2dInternalFillRegionParams internal_fill_region_params;
+
+		internal_fill_region_params.dest_region = &(internal_fill_regions_params->dest_regions[i]);
+		internal_fill_region_params.fill_color = internal_fill_regions_params->fill_color;
+
+		if (!engine_blitter->blitter_class->fill_region(engine_blitter, &internal_fill_region_params))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+static Imx2dHardwareCapabilities const * imx_2d_backend_dispatch_blitter_get_hardware_capabilities(Imx2dBlitter *blitter)
+{
+	Imx2dDispatchBlitter *dispatch_blitter = (Imx2dDispatchBlitter *)blitter;
+	return &(dispatch_blitter->capabilities);
+}
+
+
+
+
+Imx2dBlitter* imx_2d_backend_dispatch_blitter_create(void)
+{
+	Imx2dDispatchBlitter *dispatch_blitter;
+
+	dispatch_blitter = malloc(sizeof(Imx2dDispatchBlitter));
+	assert(dispatch_blitter != NULL);
+
+	memset(dispatch_blitter, 0, sizeof(Imx2dDispatchBlitter));
+
+	dispatch_blitter->parent.blitter_class = &imx_2d_backend_dispatch_blitter_class;
+	dispatch_blitter->active_engine_index = -1;
+
+	imx_2d_backend_dispatch_merge_hardware_capabilities(NULL, 0, &(dispatch_blitter->capabilities), dispatch_blitter->source_formats, dispatch_blitter->dest_formats);
+
+	return (Imx2dBlitter *)dispatch_blitter;
+}
+
+
+int imx_2d_backend_dispatch_blitter_add_engine(Imx2dBlitter *blitter, char const *engine_name, Imx2dBlitter *engine_blitter, Imx2dDispatchCosts const *initial_costs)
+{
+	Imx2dDispatchBlitter *dispatch_blitter = (Imx2dDispatchBlitter *)blitter;
+	Imx2dHardwareCapabilities const *engine_capabilities[IMX_2D_BACKEND_DISPATCH_MAX_NUM_ENGINES];
+	DispatchEngine *engine;
+	EngineRecord *record;
+	int i;
+
+	assert(blitter != NULL);
+	assert(engine_name != NULL);
+	assert(engine_blitter != NULL);
+	assert(dispatch_blitter->active_engine_index < 0);
+
+	if (dispatch_blitter->num_engines >= IMX_2D_BACKEND_DISPATCH_MAX_NUM_ENGINES)
+	{
+		IMX_2D_LOG(ERROR, "cannot add %s engine: dispatch blitter already has the maximum of %d engines", engine_name, IMX_2D_BACKEND_DISPATCH_MAX_NUM_ENGINES);
+		return FALSE;
+	}
+
+	if (strlen(engine_name) >= MAX_ENGINE_NAME_LENGTH)
+	{
+		IMX_2D_LOG(ERROR, "cannot add %s engine: name is too long", engine_name);
+		return FALSE;
+	}
+
+	pthread_mutex_lock(&engine_records_mutex);
+
+	record = find_engine_record(engine_name);
+	if (record == NULL)
+	{
+		if (num_engine_records >= MAX_NUM_ENGINE_RECORDS)
+		{
+			pthread_mutex_unlock(&engine_records_mutex);
+			IMX_2D_LOG(ERROR, "cannot add %s engine: too many different engines in this process", engine_name);
+			return FALSE;
+		}
+
+		record = &(engine_records[num_engine_records++]);
+		memset(record, 0, sizeof(EngineRecord));
+		strcpy(record->name, engine_name);
+
+		if (initial_costs != NULL)
+			record->costs = *initial_costs;
+		else
+			imx_2d_backend_dispatch_get_default_costs(engine_name, &(record->costs));
+	}
+
+	pthread_mutex_unlock(&engine_records_mutex);
+
+	engine = &(dispatch_blitter->engines[dispatch_blitter->num_engines]);
+	strcpy(engine->name, engine_name);
+	engine->blitter = engine_blitter;
+	engine->capabilities = imx_2d_blitter_get_hardware_capabilities(engine_blitter);
+	engine->num_dispatched_ops = 0;
+	dispatch_blitter->num_engines++;
+
+	for (i = 0; i < dispatch_blitter->num_engines; ++i)
+		engine_capabilities[i] = dispatch_blitter->engines[i].capabilities;
+
+	imx_2d_backend_dispatch_merge_hardware_capabilities(
+		engine_capabilities, dispatch_blitter->num_engines,
+		&(dispatch_blitter->capabilities),
+		dispatch_blitter->source_formats, dispatch_blitter->dest_formats
+	);
+
+	IMX_2D_LOG(DEBUG, "added %s engine to dispatch blitter; number of engines now: %d", engine_name, dispatch_blitter->num_engines);
+
+	return TRUE;
+}
+
+
+int imx_2d_backend_dispatch_blitter_get_num_engines(Imx2dBlitter *blitter)
+{
+	assert(blitter != NULL);
+	return ((Imx2dDispatchBlitter *)blitter)->num_engines;
+}
+
+
+long imx_2d_backend_dispatch_blitter_get_num_dispatched_ops(Imx2dBlitter *blitter, int engine_index)
+{
+	Imx2dDispatchBlitter *dispatch_blitter = (Imx2dDispatchBlitter *)blitter;
+
+	assert(blitter != NULL);
+	assert((engine_index >= 0) && (engine_index < dispatch_blitter->num_engines));
+
+	return dispatch_blitter->engines[engine_index].num_dispatched_ops;
+}
+
+
+void imx_2d_backend_dispatch_get_default_costs(char const *engine_name, Imx2dDispatchCosts *costs)
+{
+	/* Rough estimates, ordered like Imx2dDispatchOpType:
+	 * copy, scale, rotate, blend, fill.
+	 * The PxP and IPU backends cannot blend, and the IPU
+	 * backend cannot fill regions. The PxP performs rotation
+	 * as part of its pipeline, so it is preferred for that. */
+	static struct
+	{
+		char const *name;
+		Imx2dDispatchCosts costs;
+	}
+	const default_costs[] =
+	{
+		{ "g2d", { { 0.5, 0.8, 3.0, 1.0, 0.3 }, 60000.0 } },
+		{ "pxp", { { 2.0, 2.5, 2.0, IMX_2D_DISPATCH_COST_UNSUPPORTED, 1.0 }, 40000.0 } },
+		{ "ipu", { { 2.5, 3.0, 4.0, IMX_2D_DISPATCH_COST_UNSUPPORTED, IMX_2D_DISPATCH_COST_UNSUPPORTED }, 80000.0 } },
+		{ "sw", { { 5.0, 15.0, 20.0, 25.0, 2.0 }, 5000.0 } }
+	};
+	static Imx2dDispatchCosts const generic_costs = { { 10.0, 10.0, 10.0, 10.0, 10.0 }, 10000.0 };
+	unsigned int i;
+
+	assert(engine_name != NULL);
+	assert(costs != NULL);
+
+	for (i = 0; i < sizeof(default_costs) / sizeof(default_costs[0]); ++i)
+	{
+		if (strcmp(default_costs[i].name, engine_name) == 0)
+		{
+			*costs = default_costs[i].costs;
+			return;
+		}
+	}
+
+	*costs = generic_costs;
+}
+
+
+int imx_2d_backend_dispatch_get_engine_costs(char const *engine_name, Imx2dDispatchCosts *costs)
+{
+	EngineRecord *record;
+
+	assert(engine_name != NULL);
+	assert(costs != NULL);
+
+	pthread_mutex_lock(&engine_records_mutex);
+
+	record = find_engine_record(engine_name);
+	if (record != NULL)
+		*costs = record->costs;
+
+	pthread_mutex_unlock(&engine_records_mutex);
+
+	return (record != NULL);
+}
+
+
+static int merge_formats(Imx2dPixelFormat *merged_formats, int num_merged_formats, Imx2dPixelFormat const *formats, int num_formats)
+{
+	int i;
+
+	for (i = 0; i < num_formats; ++i)
+	{
+		if (!is_format_in_list(formats[i], merged_formats, num_merged_formats))
+		{
+			assert(num_merged_formats < IMX_2D_NUM_PIXEL_FORMATS);
+			merged_formats[num_merged_formats++] = formats[i];
+		}
+	}
+
+	return num_merged_formats;
+}
+
+
+void imx_2d_backend_dispatch_merge_hardware_capabilities(
+	Imx2dHardwareCapabilities const **capabilities, int num_capabilities,
+	Imx2dHardwareCapabilities *merged,
+	Imx2dPixelFormat *source_formats, Imx2dPixelFormat *dest_formats
+)
+{
+	int i;
+
+	assert(merged != NULL);
+	assert(source_formats != NULL);
+	assert(dest_formats != NULL);
+	assert((num_capabilities == 0) || (capabilities != NULL));
+
+	memset(merged, 0, sizeof(Imx2dHardwareCapabilities));
+
+	merged->supported_source_pixel_formats = source_formats;
+	merged->supported_dest_pixel_formats = dest_formats;
+	merged->min_width = INT_MAX;
+	merged->min_height = INT_MAX;
+	merged->width_step_size = 1;
+	merged->height_step_size = 1;
+	merged->stride_alignment = 1;
+	merged->total_row_count_alignment = 1;
+	merged->can_handle_multi_buffer_surfaces = 1;
+	merged->draws_blit_margins_for_free = 1;
+	merged->max_downscale_factor = 0;
+
+	for (i = 0; i < num_capabilities; ++i)
+	{
+		Imx2dHardwareCapabilities const *caps = capabilities[i];
+
+		merged->num_supported_source_pixel_formats = merge_formats(
+			source_formats, merged->num_supported_source_pixel_formats,
+			caps->supported_source_pixel_formats, caps->num_supported_source_pixel_formats
+		);
+		merged->num_supported_dest_pixel_formats = merge_formats(
+			dest_formats, merged->num_supported_dest_pixel_formats,
+			caps->supported_dest_pixel_formats, caps->num_supported_dest_pixel_formats
+		);
+
+		merged->min_width = MIN(merged->min_width, caps->min_width);
+		merged->max_width = MAX(merged->max_width, caps->max_width);
+		merged->min_height = MIN(merged->min_height, caps->min_height);
+		merged->max_height = MAX(merged->max_height, caps->max_height);
+
+		/* The step sizes and alignments are all powers of two,
+		 * so the largest one is a multiple of all others. */
+		merged->width_step_size = MAX(merged->width_step_size, caps->width_step_size);
+		merged->height_step_size = MAX(merged->height_step_size, caps->height_step_size);
+		merged->stride_alignment = MAX(merged->stride_alignment, caps->stride_alignment);
+		merged->total_row_count_alignment = MAX(merged->total_row_count_alignment, caps->total_row_count_alignment);
+
+		merged->can_handle_multi_buffer_surfaces = merged->can_handle_multi_buffer_surfaces && caps->can_handle_multi_buffer_surfaces;
+		merged->draws_blit_margins_for_free = merged->draws_blit_margins_for_free && caps->draws_blit_margins_for_free;
+
+		/* Use the strictest limit, since any engine
+		 * may end up executing a blit. 0 means "no limit". */
+		if ((caps->max_downscale_factor > 0) && ((merged->max_downscale_factor == 0) || (caps->max_downscale_factor < merged->max_downscale_factor)))
+			merged->max_downscale_factor = caps->max_downscale_factor;
+	}
+
+	if (num_capabilities == 0)
+	{
+		merged->min_width = 0;
+		merged->min_height = 0;
+	}
+}
@@ -0,0 +1,183 @@
+#ifndef IMX2D_BACKEND_DISPATCH_BLITTER_H
+#define IMX2D_BACKEND_DISPATCH_BLITTER_H
+
+#include <imx2d/imx2d.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Imx2dDispatchOpType:
+ * @IMX_2D_DISPATCH_OP_TYPE_COPY: Blit without scaling, rotation, and blending.
+ * @IMX_2D_DISPATCH_OP_TYPE_SCALE: Blit with scaling, but without rotation and blending.
+ * @IMX_2D_DISPATCH_OP_TYPE_ROTATE: Blit with rotation or flipping, but without blending.
+ * @IMX_2D_DISPATCH_OP_TYPE_BLEND: Blit with alpha blending, either because the source
+ *     format has an alpha channel, or because the blit's alpha value is not 255.
+ * @IMX_2D_DISPATCH_OP_TYPE_FILL: Region fill.
+ *
+ * Operation types the dispatch blitter keeps separate costs for.
+ */
+typedef enum
+{
+	IMX_2D_DISPATCH_OP_TYPE_COPY = 0,
+	IMX_2D_DISPATCH_OP_TYPE_SCALE,
+	IMX_2D_DISPATCH_OP_TYPE_ROTATE,
+	IMX_2D_DISPATCH_OP_TYPE_BLEND,
+	IMX_2D_DISPATCH_OP_TYPE_FILL,
+
+	IMX_2D_DISPATCH_NUM_OP_TYPES
+}
+Imx2dDispatchOpType;
+
+
+/* Per-pixel cost value for operation types an engine cannot perform. */
+#define IMX_2D_DISPATCH_COST_UNSUPPORTED (-1.0)
+
+
+/**
+ * Imx2dDispatchCosts:
+ * @ns_per_pixel: Estimated cost of each operation type, in nanoseconds
+ *     per destination pixel. If an engine cannot perform an operation
+ *     type, its entry is set to IMX_2D_DISPATCH_COST_UNSUPPORTED.
+ * @ns_per_op: Fixed setup cost of each operation, in nanoseconds.
+ *
+ * Cost table of one engine. The dispatch blitter uses these tables
+ * to estimate how long an operation would take on each engine.
+ */
+typedef struct
+{
+	double ns_per_pixel[IMX_2D_DISPATCH_NUM_OP_TYPES];
+	double ns_per_op;
+}
+Imx2dDispatchCosts;
+
+
+#define IMX_2D_BACKEND_DISPATCH_MAX_NUM_ENGINES 8
+
+
+/**
+ * imx_2d_backend_dispatch_blitter_create:
+ *
+ * Creates a new @Imx2dBlitter that does not blit by itself, but instead
+ * routes each blit and fill operation to one of several other blitters
+ * (the "engines"). Engines are added with
+ * @imx_2d_backend_dispatch_blitter_add_engine.
+ *
+ * Each operation is routed to the engine with the lowest estimated cost
+ * among those that can handle the operation's pixel formats, surface
+ * sizes, and strides. The estimate is based on the engine's cost table,
+ * and on how many other dispatch blitters are currently using the same
+ * engine, so concurrent dispatch blitters are spread across the engines.
+ * The cost tables are refined with the measured duration of the
+ * operations. Engines are identified by name, and all dispatch blitters
+ * in the process share the cost table and usage count of an engine name.
+ *
+ * Operations are executed in order. If consecutive operations are routed
+ * to different engines, the sequence of the first engine is finished
+ * before the second engine starts.
+ *
+ * To destroy the created blitter, use @imx_2d_blitter_destroy. This
+ * also destroys the engine blitters.
+ *
+ * Returns: Pointer to a newly created dispatch blitter.
+ */
+Imx2dBlitter* imx_2d_backend_dispatch_blitter_create(void);
+
+/**
+ * imx_2d_backend_dispatch_blitter_add_engine:
+ * @blitter: Dispatch blitter to add the engine to.
+ * @engine_name: Name of the engine, for example "g2d" or "pxp".
+ * @engine_blitter: Blitter that performs the operations of this engine.
+ *     The dispatch blitter takes ownership over it.
+ * @initial_costs: Cost table to start with if this is the first time
+ *     an engine with this name is added in this process. If NULL,
+ *     the table returned by @imx_2d_backend_dispatch_get_default_costs
+ *     is used.
+ *
+ * Adds an engine to the dispatch blitter. This must not be called
+ * between @imx_2d_blitter_start and @imx_2d_blitter_finish.
+ *
+ * Returns: Nonzero if the engine was added, zero otherwise. In the
+ *     latter case, @engine_blitter is not taken over by the dispatch
+ *     blitter.
+ */
+int imx_2d_backend_dispatch_blitter_add_engine(Imx2dBlitter *blitter, char const *engine_name, Imx2dBlitter *engine_blitter, Imx2dDispatchCosts const *initial_costs);
+
+/**
+ * imx_2d_backend_dispatch_blitter_get_num_engines:
+ * @blitter: Dispatch blitter to query.
+ *
+ * Returns: Number of engines added to the dispatch blitter.
+ */
+int imx_2d_backend_dispatch_blitter_get_num_engines(Imx2dBlitter *blitter);
+
+/**
+ * imx_2d_backend_dispatch_blitter_get_num_dispatched_ops:
+ * @blitter: Dispatch blitter to query.
+ * @engine_index: Index of the engine, in the order the engines were added.
+ *
+ * Returns: Number of operations this dispatch blitter routed
+ *     to the given engine so far.
+ */
+long imx_2d_backend_dispatch_blitter_get_num_dispatched_ops(Imx2dBlitter *blitter, int engine_index);
+
+/**
+ * imx_2d_backend_dispatch_get_default_costs:
+ * @engine_name: Engine name to get the default costs for.
+ * @costs: Cost table to fill.
+ *
+ * Fills @costs with built-in initial estimates for the engines
+ * "g2d", "pxp", "ipu", and "sw". For other names, a generic
+ * table is used. These are only rough starting points; the
+ * dispatch blitter refines them at runtime.
+ */
+void imx_2d_backend_dispatch_get_default_costs(char const *engine_name, Imx2dDispatchCosts *costs);
+
+/**
+ * imx_2d_backend_dispatch_get_engine_costs:
+ * @engine_name: Name of the engine to get the costs for.
+ * @costs: Cost table to fill.
+ *
+ * Fills @costs with the current, measurement-refined cost
+ * table of the given engine.
+ *
+ * Returns: Nonzero if an engine with this name was added to a
+ *     dispatch blitter in this process, zero otherwise.
+ */
+int imx_2d_backend_dispatch_get_engine_costs(char const *engine_name, Imx2dDispatchCosts *costs);
+
+/**
+ * imx_2d_backend_dispatch_merge_hardware_capabilities:
+ * @capabilities: Array of capabilities to merge.
+ * @num_capabilities: Number of entries in @capabilities.
+ * @merged: Structure to write the merged capabilities to.
+ * @source_formats: Array with room for IMX_2D_NUM_PIXEL_FORMATS entries.
+ *     The supported_source_pixel_formats of @merged point to this array.
+ * @dest_formats: Array with room for IMX_2D_NUM_PIXEL_FORMATS entries.
+ *     The supported_dest_pixel_formats of @merged point to this array.
+ *
+ * Merges the capabilities of several engines into the capabilities
+ * of a dispatch blitter that uses these engines. The merged pixel
+ * formats and size ranges are the unions of those of the engines.
+ * The alignments are the largest ones of the engines, so that
+ * surfaces allocated with these alignments can be used by all engines.
+ *
+ * Note that a blit only succeeds if at least one engine supports
+ * both its source and its destination format.
+ */
+void imx_2d_backend_dispatch_merge_hardware_capabilities(
+	Imx2dHardwareCapabilities const **capabilities, int num_capabilities,
+	Imx2dHardwareCapabilities *merged,
+	Imx2dPixelFormat *source_formats, Imx2dPixelFormat *dest_formats
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* IMX2D_BACKEND_DISPATCH_BLITTER_H */
@@ -12,6 +12,24 @@
 #include "g2d_blitter.h"
 
 
+/* The DPU-based G2D emulation does not have the per-thread restriction,
+ * and opens its handle only once anyway (see the note below), so the
+ * worker thread is only needed with "real" 2D GPU cores. */
+#if defined(IMX2D_G2D_PERSISTENT_HANDLE) && !defined(IMX2D_G2D_IMPLEMENTATION_BASED_ON_DPU)
+#define IMX2D_G2D_USE_WORKER_THREAD
+#include <pthread.h>
+#endif
+
+
+/* g2d_multi_blit() is not available in all G2D versions, and the
+ * DPU-based emulation needs a g2d_finish() call after every blit,
+ * which defeats the purpose of combining blits. */
+#if defined(IMX2D_G2D_HAS_MULTI_BLIT) && !defined(IMX2D_G2D_IMPLEMENTATION_BASED_ON_DPU)
+#define IMX2D_G2D_USE_MULTI_BLIT
+#define IMX2D_G2D_MAX_MULTI_BLIT_LAYERS 8
+#endif
+
+
 /* Disabled YVYU, since there is a bug in G2D - G2D_YUYV and G2D_YVYU
  * actually refer to the same pixel format (G2D_YUYV)
  *
@@ -92,6 +110,14 @@ static BOOL g2d_format_has_alpha(enum g2d_format format)
 }
 
 
+/* Sources with an alpha channel need blending unless they are marked
+ * as opaque, in which case a plain copy or scale blit is used. */
+static BOOL source_needs_blending(Imx2dSurface *source, enum g2d_format source_g2d_format)
+{
+	return g2d_format_has_alpha(source_g2d_format) && !(imx_2d_surface_get_desc(source)->is_opaque);
+}
+
+
 static BOOL get_g2d_format(Imx2dPixelFormat imx_2d_format, enum g2d_format *fmt)
 {
 	BOOL ret = TRUE;
@@ -170,11 +196,14 @@ static char const * g2d_tile_layout_to_string(enum g2d_tiling tiling)
 }
 
 
-static BOOL fill_g2d_surface_info(struct g2d_surface *g2d_surface, Imx2dSurface *imx_2d_surface)
+/* Surface information is filled in two steps. The layout (format,
+ * stride, dimensions) only depends on the surface description, while
+ * the planes depend on the DMA buffers that are currently assigned
+ * to the surface. Blit plans fill in the layout only once, and the
+ * planes for every blit. */
+
+static BOOL fill_g2d_surface_layout(struct g2d_surface *g2d_surface, Imx2dSurface *imx_2d_surface)
 {
-	int i;
-	imx_physical_address_t physical_address;
-	ImxDmaBuffer *dma_buffer;
 	Imx2dPixelFormatInfo const *fmt_info;
 	Imx2dSurfaceDesc const *desc = imx_2d_surface_get_desc(imx_2d_surface);
 
@@ -184,7 +213,6 @@ static BOOL fill_g2d_surface_info(struct g2d_surface *g2d_surface, Imx2dSurface
 		IMX_2D_LOG(ERROR, "could not get information about pixel format");
 		return FALSE;
 	}
-	assert(fmt_info->num_planes <= 3);
 
 	if (!get_g2d_format(desc->format, &(g2d_surface->format)))
 	{
@@ -197,6 +225,26 @@ static BOOL fill_g2d_surface_info(struct g2d_surface *g2d_surface, Imx2dSurface
 	g2d_surface->width = g2d_surface->stride;
 	g2d_surface->height = desc->height + desc->num_padding_rows;
 
+	return TRUE;
+}
+
+
+static BOOL fill_g2d_surface_planes(struct g2d_surface *g2d_surface, Imx2dSurface *imx_2d_surface)
+{
+	int i;
+	imx_physical_address_t physical_address;
+	ImxDmaBuffer *dma_buffer;
+	Imx2dPixelFormatInfo const *fmt_info;
+	Imx2dSurfaceDesc const *desc = imx_2d_surface_get_desc(imx_2d_surface);
+
+	fmt_info = imx_2d_get_pixel_format_info(desc->format);
+	if (fmt_info == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not get information about pixel format");
+		return FALSE;
+	}
+	assert(fmt_info->num_planes <= 3);
+
 	for (i = 0; i < fmt_info->num_planes; ++i)
 	{
 		dma_buffer = imx_2d_surface_get_dma_buffer(imx_2d_surface, i);
@@ -231,11 +279,18 @@ static BOOL fill_g2d_surface_info(struct g2d_surface *g2d_surface, Imx2dSurface
 }
 
 
-static BOOL fill_g2d_surfaceEx_info(struct g2d_surfaceEx *g2d_surfaceEx, Imx2dSurface *imx_2d_surface)
+static BOOL fill_g2d_surface_info(struct g2d_surface *g2d_surface, Imx2dSurface *imx_2d_surface)
+{
+	return fill_g2d_surface_layout(g2d_surface, imx_2d_surface)
+	    && fill_g2d_surface_planes(g2d_surface, imx_2d_surface);
+}
+
+
+static BOOL fill_g2d_surfaceEx_layout(struct g2d_surfaceEx *g2d_surfaceEx, Imx2dSurface *imx_2d_surface)
 {
 	Imx2dSurfaceDesc const *desc = imx_2d_surface_get_desc(imx_2d_surface);
 
-	if (!fill_g2d_surface_info(&(g2d_surfaceEx->base), imx_2d_surface))
+	if (!fill_g2d_surface_layout(&(g2d_surfaceEx->base), imx_2d_surface))
 		return FALSE;
 
 	switch (desc->format)
@@ -259,6 +314,13 @@ static BOOL fill_g2d_surfaceEx_info(struct g2d_surfaceEx *g2d_surfaceEx, Imx2dSu
 }
 
 
+static BOOL fill_g2d_surfaceEx_info(struct g2d_surfaceEx *g2d_surfaceEx, Imx2dSurface *imx_2d_surface)
+{
+	return fill_g2d_surfaceEx_layout(g2d_surfaceEx, imx_2d_surface)
+	    && fill_g2d_surface_planes(&(g2d_surfaceEx->base), imx_2d_surface);
+}
+
+
 #define DUMP_G2D_SURFACE_TO_LOG(DESC, SURFACE) \
 	do { \
 		IMX_2D_LOG(TRACE, \
@@ -279,6 +341,49 @@ static BOOL fill_g2d_surfaceEx_info(struct g2d_surfaceEx *g2d_surfaceEx, Imx2dSu
 typedef struct _Imx2dG2DBlitter Imx2dG2DBlitter;
 
 
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+typedef enum
+{
+	G2D_WORKER_COMMAND_NONE = 0,
+	G2D_WORKER_COMMAND_FINISH,
+	G2D_WORKER_COMMAND_FINISH_ASYNC,
+	G2D_WORKER_COMMAND_DO_BLIT,
+	G2D_WORKER_COMMAND_FILL_REGION,
+	G2D_WORKER_COMMAND_FILL_REGIONS,
+	G2D_WORKER_COMMAND_SUBMIT_BATCH,
+	G2D_WORKER_COMMAND_DO_PLANNED_BLIT,
+	G2D_WORKER_COMMAND_QUIT
+}
+Imx2dG2DWorkerCommand;
+
+
+typedef struct
+{
+	Imx2dInternalBatchOp *ops;
+	int num_ops;
+}
+Imx2dG2DWorkerBatchParams;
+
+
+typedef struct
+{
+	Imx2dInternalBlitParams *internal_blit_params;
+	void *plan_data;
+}
+Imx2dG2DWorkerPlannedBlitParams;
+#endif
+
+
+/* Backend data of blit plans. The G2D surfaces are filled in
+ * except for their planes, which are filled in for each blit. */
+typedef struct
+{
+	struct g2d_surfaceEx source_surf;
+	struct g2d_surfaceEx dest_surf;
+}
+Imx2dG2DBlitPlanData;
+
+
 struct _Imx2dG2DBlitter
 {
 	Imx2dBlitter parent;
@@ -287,8 +392,41 @@ struct _Imx2dG2DBlitter
 
 	struct g2d_surface fill_g2d_surface;
 	ImxDmaBuffer *fill_g2d_surface_dmabuffer;
+	/* TRUE if the fill surface is filled with its current
+	 * clrcolor. See fill_g2d_regions() for details. */
+	BOOL fill_g2d_surface_filled;
 
 	ImxDmaBufferAllocator *internal_dmabuffer_allocator;
+
+	/* Cached G2D_BLEND and G2D_GLOBAL_ALPHA states.
+	 * See set_g2d_blend_state() for details. */
+	int blend_state;
+	int global_alpha_state;
+	/* Cached YUV<->RGB conversion mode.
+	 * See set_g2d_csc_mode() for details. */
+	int csc_mode_state;
+
+#ifdef IMX2D_G2D_USE_MULTI_BLIT
+	BOOL multi_blit_failed;
+#endif
+
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+	/* The worker thread opens the G2D handle when it starts and
+	 * closes it when it ends. All G2D calls are made from within
+	 * that thread. This honors the G2D restriction that all calls
+	 * must come from the thread that opened the handle, while
+	 * avoiding one g2d_open()/g2d_close() pair per sequence. */
+	pthread_t worker_thread;
+	pthread_mutex_t worker_mutex;
+	pthread_cond_t worker_command_cond;
+	pthread_cond_t worker_done_cond;
+	BOOL worker_thread_started;
+	BOOL worker_initialized;
+	BOOL worker_handle_opened;
+	Imx2dG2DWorkerCommand worker_command;
+	void *worker_command_params;
+	int worker_command_result;
+#endif
 };
 
 
@@ -302,6 +440,18 @@ static int imx_2d_backend_g2d_blitter_fill_region(Imx2dBlitter *blitter, Imx2dIn
 
 static Imx2dHardwareCapabilities const * imx_2d_backend_g2d_blitter_get_hardware_capabilities(Imx2dBlitter *blitter);
 
+static int imx_2d_backend_g2d_blitter_submit_batch(Imx2dBlitter *blitter, Imx2dInternalBatchOp *ops, int num_ops);
+
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+static int imx_2d_backend_g2d_blitter_finish_async(Imx2dBlitter *blitter, Imx2dFence *fence);
+#endif
+
+static void* imx_2d_backend_g2d_blitter_create_plan_data(Imx2dBlitter *blitter, Imx2dSurface *dest, Imx2dInternalBlitParams const *internal_blit_params);
+static void imx_2d_backend_g2d_blitter_destroy_plan_data(Imx2dBlitter *blitter, void *plan_data);
+static int imx_2d_backend_g2d_blitter_do_planned_blit(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params, void *plan_data);
+
+static int imx_2d_backend_g2d_blitter_fill_regions(Imx2dBlitter *blitter, Imx2dInternalFillRegionsParams *internal_fill_regions_params);
+
 
 static Imx2dBlitterClass imx_2d_backend_g2d_blitter_class =
 {
@@ -313,7 +463,23 @@ static Imx2dBlitterClass imx_2d_backend_g2d_blitter_class =
 	imx_2d_backend_g2d_blitter_do_blit,
 	imx_2d_backend_g2d_blitter_fill_region,
 
-	imx_2d_backend_g2d_blitter_get_hardware_capabilities
+	imx_2d_backend_g2d_blitter_get_hardware_capabilities,
+
+	imx_2d_backend_g2d_blitter_submit_batch,
+
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+	imx_2d_backend_g2d_blitter_finish_async,
+#else
+	NULL,
+#endif
+
+	imx_2d_backend_g2d_blitter_create_plan_data,
+	imx_2d_backend_g2d_blitter_destroy_plan_data,
+	imx_2d_backend_g2d_blitter_do_planned_blit,
+
+	imx_2d_backend_g2d_blitter_fill_regions,
+
+	"g2d"
 };
 
 
@@ -327,55 +493,31 @@ static Imx2dBlitterClass imx_2d_backend_g2d_blitter_class =
  * therefore, if we are dealing with such a G2D-on-top-of-DPU implementation,
  * we call g2d_open() (and g2d_close()) only once to improve performance.
  *
- * This enhances https://github.com/Freescale/gstreamer-imx/pull/282 . */
-
-
-
-
-static void imx_2d_backend_g2d_blitter_destroy(Imx2dBlitter *blitter)
-{
-	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
-
-	assert(blitter != NULL);
+ * This enhances https://github.com/Freescale/gstreamer-imx/pull/282 .
+ *
+ * With real 2D GPU cores, all G2D calls must come from the thread that
+ * called g2d_open(). If IMX2D_G2D_USE_WORKER_THREAD is defined, a worker
+ * thread is started that owns the G2D handle for the entire lifetime
+ * of the blitter, and all G2D calls are handed over to that thread.
+ * Otherwise, the handle is opened in start() and closed in finish(). */
 
-#ifdef IMX2D_G2D_IMPLEMENTATION_BASED_ON_DPU
-	if (g2d_blitter->g2d_handle != NULL)
-	{
-		if (g2d_close(g2d_blitter->g2d_handle) != 0)
-			IMX_2D_LOG(ERROR, "closing g2d device failed");
-		g2d_blitter->g2d_handle = NULL;
-	}
-#endif
 
-	if (g2d_blitter->fill_g2d_surface_dmabuffer != NULL)
-	{
-		IMX_2D_LOG(DEBUG, "destroying G2D fill surface DMA buffer %p", (void *)(g2d_blitter->fill_g2d_surface_dmabuffer));
-		imx_dma_buffer_deallocate(g2d_blitter->fill_g2d_surface_dmabuffer);
-	}
 
-	if (g2d_blitter->internal_dmabuffer_allocator != NULL)
-	{
-		IMX_2D_LOG(DEBUG, "destroying i.MX DMA buffer allocator %p", (void *)(g2d_blitter->internal_dmabuffer_allocator));
-		imx_dma_buffer_allocator_destroy(g2d_blitter->internal_dmabuffer_allocator);
-	}
 
-	free(blitter);
-}
+static int imx_2d_backend_g2d_blitter_do_blit_impl(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params);
+static int imx_2d_backend_g2d_blitter_fill_region_impl(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams *internal_fill_region_params);
+static int imx_2d_backend_g2d_blitter_fill_regions_impl(Imx2dBlitter *blitter, Imx2dInternalFillRegionsParams *internal_fill_regions_params);
+static int imx_2d_backend_g2d_blitter_submit_batch_impl(Imx2dBlitter *blitter, Imx2dInternalBatchOp *ops, int num_ops);
+static int imx_2d_backend_g2d_blitter_do_planned_blit_impl(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params, void *plan_data);
 
 
-static int imx_2d_backend_g2d_blitter_start(Imx2dBlitter *blitter)
+static BOOL open_g2d_handle(Imx2dG2DBlitter *g2d_blitter)
 {
-	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
-
-#ifdef IMX2D_G2D_IMPLEMENTATION_BASED_ON_DPU
-	if (g2d_blitter->g2d_handle == NULL)
-#endif
+	if (g2d_open(&(g2d_blitter->g2d_handle)) != 0)
 	{
-		if (g2d_open(&(g2d_blitter->g2d_handle)) != 0)
-		{
-			IMX_2D_LOG(ERROR, "opening g2d device failed");
-			return FALSE;
-		}
+		IMX_2D_LOG(ERROR, "opening g2d device failed");
+		g2d_blitter->g2d_handle = NULL;
+		return FALSE;
 	}
 
 	if (g2d_make_current(g2d_blitter->g2d_handle, G2D_HARDWARE_2D) != 0)
@@ -387,310 +529,1027 @@ static int imx_2d_backend_g2d_blitter_start(Imx2dBlitter *blitter)
 		return FALSE;
 	}
 
+	/* The blending and CSC states of a newly opened handle are not known. */
+	g2d_blitter->blend_state = -1;
+	g2d_blitter->global_alpha_state = -1;
+	g2d_blitter->csc_mode_state = -1;
+
 	return TRUE;
 }
 
 
-static int imx_2d_backend_g2d_blitter_finish(Imx2dBlitter *blitter)
+static void close_g2d_handle(Imx2dG2DBlitter *g2d_blitter)
 {
-#ifdef IMX2D_G2D_IMPLEMENTATION_BASED_ON_DPU
-	/* When G2D is emulated on top of the DPU, g2d_finish() is
-	 * called after every blit. And, we can't call g2d_close()
-	 * here, because the DPU-emulated version of that function
-	 * is slow. (It is called in destroy().) So, when the
-	 * DPU-based emulation is used, do nothing here. */
-	IMX_2D_UNUSED_PARAM(blitter);
-	return TRUE;
-#else
-	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
-	int ret;
-
-	assert(blitter != NULL);
-
-	ret = (g2d_finish(g2d_blitter->g2d_handle) == 0);
+	if (g2d_blitter->g2d_handle == NULL)
+		return;
 
 	if (g2d_close(g2d_blitter->g2d_handle) != 0)
 		IMX_2D_LOG(ERROR, "closing g2d device failed");
-
-	return ret;
-#endif
+	g2d_blitter->g2d_handle = NULL;
 }
 
 
-static int imx_2d_backend_g2d_blitter_do_blit(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params)
-{
-	BOOL do_alpha;
-	int g2d_ret;
-	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
-	struct g2d_surfaceEx g2d_source_surf, g2d_dest_surf;
-
-	assert(blitter != NULL);
-	assert(blitter->dest != NULL);
-	assert(internal_blit_params != NULL);
-	assert(internal_blit_params->source != NULL);
-
-	assert(g2d_blitter->g2d_handle != NULL);
-
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
 
-	if (!fill_g2d_surfaceEx_info(&g2d_source_surf, internal_blit_params->source) || !fill_g2d_surfaceEx_info(&g2d_dest_surf, blitter->dest))
-		return FALSE;
+static void* g2d_worker_thread_func(void *user_data)
+{
+	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)user_data;
+	BOOL handle_opened;
 
-	copy_region_to_g2d_surface(&(g2d_source_surf.base), internal_blit_params->source, internal_blit_params->source_region);
-	copy_region_to_g2d_surface(&(g2d_dest_surf.base), blitter->dest, internal_blit_params->dest_region);
+	handle_opened = open_g2d_handle(g2d_blitter);
 
-	g2d_source_surf.base.clrcolor = g2d_dest_surf.base.clrcolor = 0xFF000000;
+	pthread_mutex_lock(&(g2d_blitter->worker_mutex));
 
-	do_alpha = (internal_blit_params->dest_surface_alpha != 255) || g2d_format_has_alpha(g2d_source_surf.base.format);
+	g2d_blitter->worker_handle_opened = handle_opened;
+	g2d_blitter->worker_initialized = TRUE;
+	pthread_cond_signal(&(g2d_blitter->worker_done_cond));
 
-	g2d_source_surf.base.rot = g2d_dest_surf.base.rot = G2D_ROTATION_0;
-	switch (internal_blit_params->rotation)
+	while (handle_opened)
 	{
-		case IMX_2D_ROTATION_90:  g2d_dest_surf.base.rot = G2D_ROTATION_90; break;
-		case IMX_2D_ROTATION_180: g2d_dest_surf.base.rot = G2D_ROTATION_180; break;
-		case IMX_2D_ROTATION_270: g2d_dest_surf.base.rot = G2D_ROTATION_270; break;
-		case IMX_2D_ROTATION_FLIP_HORIZONTAL: g2d_source_surf.base.rot = G2D_FLIP_H; break;
-		case IMX_2D_ROTATION_FLIP_VERTICAL: g2d_source_surf.base.rot = G2D_FLIP_V; break;
-		case IMX_2D_ROTATION_UL_LR:
-			g2d_source_surf.base.rot = G2D_FLIP_V;
-			g2d_dest_surf.base.rot = G2D_ROTATION_90;
-			break;
-		case IMX_2D_ROTATION_UR_LL:
-			g2d_source_surf.base.rot = G2D_FLIP_H;
-			g2d_dest_surf.base.rot = G2D_ROTATION_90;
-			break;
-		default: break;
-	}
-
-	DUMP_G2D_SURFACE_TO_LOG("blit source", &g2d_source_surf);
-	DUMP_G2D_SURFACE_TO_LOG("blit dest", &g2d_dest_surf);
+		Imx2dG2DWorkerCommand command;
+		void *params;
+		int result = FALSE;
 
-	IMX_2D_LOG(TRACE, "source tile layout: %s", g2d_tile_layout_to_string(g2d_source_surf.tiling));
-
-	/* If there is an expanded_dest_region, it means that
-	 * there is a margin that must be drawn. */
-	if (internal_blit_params->expanded_dest_region != NULL)
-	{
-		int i;
-		struct g2d_surface margin_g2d_surf;
-		int margin_alpha = (internal_blit_params->margin_fill_color >> 24) & 0xFF;
+		while (g2d_blitter->worker_command == G2D_WORKER_COMMAND_NONE)
+			pthread_cond_wait(&(g2d_blitter->worker_command_cond), &(g2d_blitter->worker_mutex));
 
-		memcpy(&margin_g2d_surf, &g2d_dest_surf, sizeof(struct g2d_surface));
+		command = g2d_blitter->worker_command;
+		params = g2d_blitter->worker_command_params;
 
-		/* G2D clear color is 0x00BBGGRR, margin_fill_color
-		 * is 0x00RRGGBB, so we need to convert.  Also, the
-		 * clear operation exhibited problems when the MSB
-		 * wasn't 0xFF, so set it. */
-		margin_g2d_surf.clrcolor = ((internal_blit_params->margin_fill_color & 0x0000FF) << 16)
-		                         | ((internal_blit_params->margin_fill_color & 0x00FF00))
-		                         | ((internal_blit_params->margin_fill_color & 0xFF0000) >> 16)
-		                         | 0xFF000000;
+		if (command == G2D_WORKER_COMMAND_QUIT)
+			break;
 
-		IMX_2D_LOG(TRACE, "margin fill color: %#08x alpha: %d", internal_blit_params->margin_fill_color & 0x00FFFFFF, margin_alpha);
+		/* The caller is blocked until the command is done,
+		 * so the blitter state can be accessed unlocked. */
+		pthread_mutex_unlock(&(g2d_blitter->worker_mutex));
 
-		if (margin_alpha != 255)
+		switch (command)
 		{
-			/* g2d_clear() ignores alpha blending, so if margin_alpha is not 255,
-			 * use a trick. Take the fill_surface, which is a very small surface,
-			 * fill it with the fill color, and blit it with blending. */
+			case G2D_WORKER_COMMAND_FINISH:
+				result = (g2d_finish(g2d_blitter->g2d_handle) == 0);
+				break;
 
-			g2d_blitter->fill_g2d_surface.clrcolor = margin_g2d_surf.clrcolor;
-			if (g2d_clear(g2d_blitter->g2d_handle, &(g2d_blitter->fill_g2d_surface)) != 0)
+			case G2D_WORKER_COMMAND_FINISH_ASYNC:
 			{
-				IMX_2D_LOG(ERROR, "could not fill margin");
-				return FALSE;
+				/* Nobody waits for this command to be done. Instead,
+				 * the fence is signaled. The fence was ref'd when the
+				 * command was queued, so unref it here. */
+				Imx2dFence *fence = (Imx2dFence *)params;
+				result = (g2d_finish(g2d_blitter->g2d_handle) == 0);
+				imx_2d_fence_signal(fence, result);
+				imx_2d_fence_unref(fence);
+				break;
 			}
 
-			g2d_blitter->fill_g2d_surface.blendfunc = G2D_SRC_ALPHA;
-			g2d_blitter->fill_g2d_surface.global_alpha = margin_alpha;
-			margin_g2d_surf.blendfunc = G2D_ONE_MINUS_SRC_ALPHA;
-			margin_g2d_surf.global_alpha = margin_alpha;
-
-			g2d_enable(g2d_blitter->g2d_handle, G2D_BLEND);
-			g2d_enable(g2d_blitter->g2d_handle, G2D_GLOBAL_ALPHA);
-		}
+			case G2D_WORKER_COMMAND_DO_BLIT:
+				result = imx_2d_backend_g2d_blitter_do_blit_impl((Imx2dBlitter *)g2d_blitter, (Imx2dInternalBlitParams *)params);
+				break;
 
-		for (i = 0; i < 4; ++i)
-		{
-			BOOL skip_margin_region = FALSE;
-
-			/* There are four rectangular margin regions: left, top, right, bottom.
-			 * Figure out their coordinates here and write them directly into the
-			 * margin_g2d_surf structure so we can call g2d_clear() right away.
-			 * skip_margin_region is used in case the computed coordinates yield
-			 * a region that has no pixels because one of its sidelengths is zero. */
-			switch (i)
-			{
-				case 0:
-					margin_g2d_surf.left = internal_blit_params->expanded_dest_region->x1;
-					margin_g2d_surf.top = internal_blit_params->dest_region->y1;
-					margin_g2d_surf.right = internal_blit_params->dest_region->x1;
-					margin_g2d_surf.bottom = internal_blit_params->dest_region->y2;
-					skip_margin_region = (margin_g2d_surf.left == margin_g2d_surf.right);
-					break;
-
-				case 1:
-					margin_g2d_surf.left = internal_blit_params->expanded_dest_region->x1;
-					margin_g2d_surf.top = internal_blit_params->expanded_dest_region->y1;
-					margin_g2d_surf.right = internal_blit_params->expanded_dest_region->x2;
-					margin_g2d_surf.bottom = internal_blit_params->dest_region->y1;
-					skip_margin_region = (margin_g2d_surf.top == margin_g2d_surf.bottom);
-					break;
-
-				case 2:
-					margin_g2d_surf.left = internal_blit_params->dest_region->x2;
-					margin_g2d_surf.top = internal_blit_params->dest_region->y1;
-					margin_g2d_surf.right = internal_blit_params->expanded_dest_region->x2;
-					margin_g2d_surf.bottom = internal_blit_params->dest_region->y2;
-					skip_margin_region = (margin_g2d_surf.left == margin_g2d_surf.right);
-					break;
-
-				case 3:
-					margin_g2d_surf.left = internal_blit_params->expanded_dest_region->x1;
-					margin_g2d_surf.top = internal_blit_params->dest_region->y2;
-					margin_g2d_surf.right = internal_blit_params->expanded_dest_region->x2;
-					margin_g2d_surf.bottom = internal_blit_params->expanded_dest_region->y2;
-					skip_margin_region = (margin_g2d_surf.top == margin_g2d_surf.bottom);
-					break;
-
-				default:
-					assert(FALSE);
-			}
+			case G2D_WORKER_COMMAND_FILL_REGION:
+				result = imx_2d_backend_g2d_blitter_fill_region_impl((Imx2dBlitter *)g2d_blitter, (Imx2dInternalFillRegionParams *)params);
+				break;
 
-			IMX_2D_LOG(TRACE, "margin #%d G2D surface: %d/%d/%d/%d", i, margin_g2d_surf.left, margin_g2d_surf.top, margin_g2d_surf.right, margin_g2d_surf.bottom);
+			case G2D_WORKER_COMMAND_FILL_REGIONS:
+				result = imx_2d_backend_g2d_blitter_fill_regions_impl((Imx2dBlitter *)g2d_blitter, (Imx2dInternalFillRegionsParams *)params);
+				break;
 
-			if (skip_margin_region)
+			case G2D_WORKER_COMMAND_SUBMIT_BATCH:
 			{
-				IMX_2D_LOG(TRACE, "skipping margin");
-				continue;
+				Imx2dG2DWorkerBatchParams *batch_params = (Imx2dG2DWorkerBatchParams *)params;
+				result = imx_2d_backend_g2d_blitter_submit_batch_impl((Imx2dBlitter *)g2d_blitter, batch_params->ops, batch_params->num_ops);
+				break;
 			}
 
-			if (margin_alpha == 255)
+			case G2D_WORKER_COMMAND_DO_PLANNED_BLIT:
 			{
-				IMX_2D_LOG(TRACE, "filling margin with g2d_clear()");
-				if (g2d_clear(g2d_blitter->g2d_handle, &margin_g2d_surf) != 0)
-				{
-					IMX_2D_LOG(ERROR, "could not fill margin");
-					return FALSE;
-				}
+				Imx2dG2DWorkerPlannedBlitParams *planned_blit_params = (Imx2dG2DWorkerPlannedBlitParams *)params;
+				result = imx_2d_backend_g2d_blitter_do_planned_blit_impl((Imx2dBlitter *)g2d_blitter, planned_blit_params->internal_blit_params, planned_blit_params->plan_data);
+				break;
 			}
-			else
-			{
-				IMX_2D_LOG(TRACE, "filling margin with g2d_blit() and the fill surface; alpha = %d", margin_alpha);
 
-				if (g2d_blit(g2d_blitter->g2d_handle, &(g2d_blitter->fill_g2d_surface), &margin_g2d_surf) != 0)
-				{
-					IMX_2D_LOG(ERROR, "could not blit fill surface - drawing margin failed");
-					return FALSE;
-				}
-			}
+			default:
+				assert(FALSE);
 		}
 
-		if (margin_alpha != 255)
-		{
-			g2d_disable(g2d_blitter->g2d_handle, G2D_BLEND);
-			g2d_disable(g2d_blitter->g2d_handle, G2D_GLOBAL_ALPHA);
-		}
+		pthread_mutex_lock(&(g2d_blitter->worker_mutex));
+
+		g2d_blitter->worker_command_result = result;
+		g2d_blitter->worker_command = G2D_WORKER_COMMAND_NONE;
+		pthread_cond_broadcast(&(g2d_blitter->worker_done_cond));
 	}
 
-	if (do_alpha)
-	{
-		g2d_source_surf.base.blendfunc = G2D_SRC_ALPHA;
-		g2d_dest_surf.base.blendfunc = G2D_ONE_MINUS_SRC_ALPHA;
-		g2d_enable(g2d_blitter->g2d_handle, G2D_BLEND);
+	pthread_mutex_unlock(&(g2d_blitter->worker_mutex));
 
-		if (internal_blit_params->dest_surface_alpha != 255)
-		{
-			g2d_enable(g2d_blitter->g2d_handle, G2D_GLOBAL_ALPHA);
-			g2d_source_surf.base.global_alpha = internal_blit_params->dest_surface_alpha;
-			g2d_dest_surf.base.global_alpha = 255 - internal_blit_params->dest_surface_alpha;
-		}
-		else
-			g2d_disable(g2d_blitter->g2d_handle, G2D_GLOBAL_ALPHA);
-	}
-	else
-	{
-		g2d_source_surf.base.blendfunc = G2D_ONE;
-		g2d_dest_surf.base.blendfunc = G2D_ZERO;
-		g2d_source_surf.base.global_alpha = 0;
-		g2d_dest_surf.base.global_alpha = 0;
-		g2d_disable(g2d_blitter->g2d_handle, G2D_BLEND);
-		g2d_disable(g2d_blitter->g2d_handle, G2D_GLOBAL_ALPHA);
-	}
+	close_g2d_handle(g2d_blitter);
 
-	g2d_ret = g2d_blitEx(g2d_blitter->g2d_handle, &g2d_source_surf, &g2d_dest_surf);
+	return NULL;
+}
 
-	if (do_alpha)
-		g2d_disable(g2d_blitter->g2d_handle, G2D_BLEND);
 
-#ifdef IMX2D_G2D_IMPLEMENTATION_BASED_ON_DPU
-	/* When G2D is emulated on top of the DPU, this must be called
-	 * after every blit. Otherwise, the next blit operation may
-	 * take place before the last one finished, causing visible
-	 * flickering and other frame corruptions. */
-	g2d_finish(g2d_blitter->g2d_handle);
-#endif
+/* Must be called with the worker mutex locked. If an asynchronous
+ * command is still being executed, this waits until it is done. */
+static void queue_g2d_worker_command(Imx2dG2DBlitter *g2d_blitter, Imx2dG2DWorkerCommand command, void *params)
+{
+	while (g2d_blitter->worker_command != G2D_WORKER_COMMAND_NONE)
+		pthread_cond_wait(&(g2d_blitter->worker_done_cond), &(g2d_blitter->worker_mutex));
 
-	if (g2d_ret != 0)
-	{
-		IMX_2D_LOG(ERROR, "could not blit surface");
-		return FALSE;
-	}
-	else
-		return TRUE;
+	g2d_blitter->worker_command = command;
+	g2d_blitter->worker_command_params = params;
+	pthread_cond_signal(&(g2d_blitter->worker_command_cond));
 }
 
 
-static int imx_2d_backend_g2d_blitter_fill_region(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams *internal_fill_region_params)
+static int run_in_g2d_worker_thread(Imx2dG2DBlitter *g2d_blitter, Imx2dG2DWorkerCommand command, void *params)
 {
-	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
-	struct g2d_surface g2d_dest_surf;
+	int result;
 
-	assert(blitter != NULL);
-	assert(blitter->dest != NULL);
-	assert(internal_fill_region_params != NULL);
-	assert(internal_fill_region_params->dest_region != NULL);
+	pthread_mutex_lock(&(g2d_blitter->worker_mutex));
 
-	assert(g2d_blitter->g2d_handle != NULL);
+	queue_g2d_worker_command(g2d_blitter, command, params);
 
-	if (!fill_g2d_surface_info(&g2d_dest_surf, blitter->dest))
-		return FALSE;
+	while (g2d_blitter->worker_command != G2D_WORKER_COMMAND_NONE)
+		pthread_cond_wait(&(g2d_blitter->worker_done_cond), &(g2d_blitter->worker_mutex));
 
-	copy_region_to_g2d_surface(&g2d_dest_surf, blitter->dest, internal_fill_region_params->dest_region);
+	result = g2d_blitter->worker_command_result;
 
-	/* G2D clear color is 0x00BBGGRR, margin_fill_color
-	 * is 0x00RRGGBB, so we need to convert.  Also, the
-	 * clear operation exhibited problems when the MSB
-	 * wasn't 0xFF, so set it. */
-	g2d_dest_surf.clrcolor = ((internal_fill_region_params->fill_color & 0x0000FF) << 16)
-	                       | ((internal_fill_region_params->fill_color & 0x00FF00))
-	                       | ((internal_fill_region_params->fill_color & 0xFF0000) >> 16)
-	                       | 0xFF000000;
+	pthread_mutex_unlock(&(g2d_blitter->worker_mutex));
+
+	return result;
+}
+
+
+static BOOL start_g2d_worker_thread(Imx2dG2DBlitter *g2d_blitter)
+{
+	int err;
+	BOOL handle_opened;
+
+	pthread_mutex_init(&(g2d_blitter->worker_mutex), NULL);
+	pthread_cond_init(&(g2d_blitter->worker_command_cond), NULL);
+	pthread_cond_init(&(g2d_blitter->worker_done_cond), NULL);
 
-	if (g2d_clear(g2d_blitter->g2d_handle, &g2d_dest_surf) != 0)
+	err = pthread_create(&(g2d_blitter->worker_thread), NULL, g2d_worker_thread_func, g2d_blitter);
+	if (err != 0)
 	{
-		IMX_2D_LOG(ERROR, "could not clear area");
+		IMX_2D_LOG(ERROR, "could not create G2D worker thread: %s (%d)", strerror(err), err);
 		return FALSE;
 	}
-	else
-		return TRUE;
+
+	g2d_blitter->worker_thread_started = TRUE;
+
+	/* Wait until the worker thread opened the G2D handle. */
+	pthread_mutex_lock(&(g2d_blitter->worker_mutex));
+	while (!g2d_blitter->worker_initialized)
+		pthread_cond_wait(&(g2d_blitter->worker_done_cond), &(g2d_blitter->worker_mutex));
+	handle_opened = g2d_blitter->worker_handle_opened;
+	pthread_mutex_unlock(&(g2d_blitter->worker_mutex));
+
+	return handle_opened;
 }
 
 
-static Imx2dHardwareCapabilities const * imx_2d_backend_g2d_blitter_get_hardware_capabilities(Imx2dBlitter *blitter)
+static void stop_g2d_worker_thread(Imx2dG2DBlitter *g2d_blitter)
 {
-	IMX_2D_UNUSED_PARAM(blitter);
-	return imx_2d_backend_g2d_get_hardware_capabilities();
+	if (!g2d_blitter->worker_thread_started)
+		return;
+
+	/* Queuing the quit command waits for any asynchronous command
+	 * that may still be running, so pending fences get signaled. */
+	pthread_mutex_lock(&(g2d_blitter->worker_mutex));
+	queue_g2d_worker_command(g2d_blitter, G2D_WORKER_COMMAND_QUIT, NULL);
+	pthread_mutex_unlock(&(g2d_blitter->worker_mutex));
+
+	pthread_join(g2d_blitter->worker_thread, NULL);
+	g2d_blitter->worker_thread_started = FALSE;
+
+	pthread_cond_destroy(&(g2d_blitter->worker_done_cond));
+	pthread_cond_destroy(&(g2d_blitter->worker_command_cond));
+	pthread_mutex_destroy(&(g2d_blitter->worker_mutex));
 }
 
+#endif /* IMX2D_G2D_USE_WORKER_THREAD */
 
 
 
-Imx2dBlitter* imx_2d_backend_g2d_blitter_create(void)
+
+static void imx_2d_backend_g2d_blitter_destroy(Imx2dBlitter *blitter)
 {
-	int err;
+	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
+
+	assert(blitter != NULL);
+
+#if defined(IMX2D_G2D_USE_WORKER_THREAD)
+	/* The worker thread closes the G2D handle before it ends. */
+	stop_g2d_worker_thread(g2d_blitter);
+#elif defined(IMX2D_G2D_IMPLEMENTATION_BASED_ON_DPU)
+	close_g2d_handle(g2d_blitter);
+#endif
+
+	if (g2d_blitter->fill_g2d_surface_dmabuffer != NULL)
+	{
+		IMX_2D_LOG(DEBUG, "destroying G2D fill surface DMA buffer %p", (void *)(g2d_blitter->fill_g2d_surface_dmabuffer));
+		imx_dma_buffer_deallocate(g2d_blitter->fill_g2d_surface_dmabuffer);
+	}
+
+	if (g2d_blitter->internal_dmabuffer_allocator != NULL)
+	{
+		IMX_2D_LOG(DEBUG, "destroying i.MX DMA buffer allocator %p", (void *)(g2d_blitter->internal_dmabuffer_allocator));
+		imx_dma_buffer_allocator_destroy(g2d_blitter->internal_dmabuffer_allocator);
+	}
+
+	free(blitter);
+}
+
+
+static int imx_2d_backend_g2d_blitter_start(Imx2dBlitter *blitter)
+{
+#if defined(IMX2D_G2D_USE_WORKER_THREAD)
+	/* The worker thread already holds an open and current
+	 * G2D handle, so there is nothing to do here. */
+	IMX_2D_UNUSED_PARAM(blitter);
+	return TRUE;
+#else
+	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
+
+#ifdef IMX2D_G2D_IMPLEMENTATION_BASED_ON_DPU
+	if (g2d_blitter->g2d_handle != NULL)
+		return TRUE;
+#endif
+
+	return open_g2d_handle(g2d_blitter);
+#endif
+}
+
+
+static int imx_2d_backend_g2d_blitter_finish(Imx2dBlitter *blitter)
+{
+#if defined(IMX2D_G2D_USE_WORKER_THREAD)
+	return run_in_g2d_worker_thread((Imx2dG2DBlitter *)blitter, G2D_WORKER_COMMAND_FINISH, NULL);
+#elif defined(IMX2D_G2D_IMPLEMENTATION_BASED_ON_DPU)
+	/* When G2D is emulated on top of the DPU, g2d_finish() is
+	 * called after every blit. And, we can't call g2d_close()
+	 * here, because the DPU-emulated version of that function
+	 * is slow. (It is called in destroy().) So, when the
+	 * DPU-based emulation is used, do nothing here. */
+	IMX_2D_UNUSED_PARAM(blitter);
+	return TRUE;
+#else
+	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
+	int ret;
+
+	assert(blitter != NULL);
+
+	ret = (g2d_finish(g2d_blitter->g2d_handle) == 0);
+
+	close_g2d_handle(g2d_blitter);
+
+	return ret;
+#endif
+}
+
+
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+static int imx_2d_backend_g2d_blitter_finish_async(Imx2dBlitter *blitter, Imx2dFence *fence)
+{
+	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
+
+	assert(blitter != NULL);
+	assert(fence != NULL);
+
+	/* Queue the g2d_finish() call in the worker thread, but do not
+	 * wait for it. Subsequent commands are queued after it, so the
+	 * next sequence's operations are executed after this one's. */
+	pthread_mutex_lock(&(g2d_blitter->worker_mutex));
+	queue_g2d_worker_command(g2d_blitter, G2D_WORKER_COMMAND_FINISH_ASYNC, imx_2d_fence_ref(fence));
+	pthread_mutex_unlock(&(g2d_blitter->worker_mutex));
+
+	return TRUE;
+}
+#endif
+
+
+static int imx_2d_backend_g2d_blitter_do_blit(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params)
+{
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+	return run_in_g2d_worker_thread((Imx2dG2DBlitter *)blitter, G2D_WORKER_COMMAND_DO_BLIT, internal_blit_params);
+#else
+	return imx_2d_backend_g2d_blitter_do_blit_impl(blitter, internal_blit_params);
+#endif
+}
+
+
+static int imx_2d_backend_g2d_blitter_fill_region(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams *internal_fill_region_params)
+{
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+	return run_in_g2d_worker_thread((Imx2dG2DBlitter *)blitter, G2D_WORKER_COMMAND_FILL_REGION, internal_fill_region_params);
+#else
+	return imx_2d_backend_g2d_blitter_fill_region_impl(blitter, internal_fill_region_params);
+#endif
+}
+
+
+static int imx_2d_backend_g2d_blitter_fill_regions(Imx2dBlitter *blitter, Imx2dInternalFillRegionsParams *internal_fill_regions_params)
+{
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+	return run_in_g2d_worker_thread((Imx2dG2DBlitter *)blitter, G2D_WORKER_COMMAND_FILL_REGIONS, internal_fill_regions_params);
+#else
+	return imx_2d_backend_g2d_blitter_fill_regions_impl(blitter, internal_fill_regions_params);
+#endif
+}
+
+
+static int imx_2d_backend_g2d_blitter_submit_batch(Imx2dBlitter *blitter, Imx2dInternalBatchOp *ops, int num_ops)
+{
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+	/* The whole batch is handed over to the worker thread at once,
+	 * so the thread handover cost is paid once per batch. */
+	Imx2dG2DWorkerBatchParams batch_params = { ops, num_ops };
+	return run_in_g2d_worker_thread((Imx2dG2DBlitter *)blitter, G2D_WORKER_COMMAND_SUBMIT_BATCH, &batch_params);
+#else
+	return imx_2d_backend_g2d_blitter_submit_batch_impl(blitter, ops, num_ops);
+#endif
+}
+
+
+/* G2D_BLEND and G2D_GLOBAL_ALPHA are global states of the G2D handle.
+ * They are cached here to avoid redundant g2d_enable() / g2d_disable()
+ * calls when several operations in a row use the same blending setup.
+ * -1 means that the state is not known (this is the case right after
+ * the G2D handle is opened). */
+static void set_g2d_blend_state(Imx2dG2DBlitter *g2d_blitter, BOOL blend, BOOL global_alpha)
+{
+	blend = !!blend;
+	global_alpha = !!global_alpha;
+
+	if (g2d_blitter->blend_state != blend)
+	{
+		if (blend)
+			g2d_enable(g2d_blitter->g2d_handle, G2D_BLEND);
+		else
+			g2d_disable(g2d_blitter->g2d_handle, G2D_BLEND);
+		g2d_blitter->blend_state = blend;
+	}
+
+	if (g2d_blitter->global_alpha_state != global_alpha)
+	{
+		if (global_alpha)
+			g2d_enable(g2d_blitter->g2d_handle, G2D_GLOBAL_ALPHA);
+		else
+			g2d_disable(g2d_blitter->g2d_handle, G2D_GLOBAL_ALPHA);
+		g2d_blitter->global_alpha_state = global_alpha;
+	}
+}
+
+
+#ifdef IMX2D_G2D_HAS_CSC_MODES
+
+static BOOL g2d_format_is_yuv(enum g2d_format format)
+{
+	switch (format)
+	{
+		case G2D_UYVY:
+		case G2D_YUYV:
+		case G2D_YVYU:
+		case G2D_VYUY:
+		case G2D_NV12:
+		case G2D_NV21:
+		case G2D_NV16:
+		case G2D_NV61:
+		case G2D_YV12:
+		case G2D_I420:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+#endif
+
+
+/* G2D converts between YUV and RGB according to a CSC mode that is
+ * selected with g2d_enable(). The mode is picked from the YUV side of
+ * the operation, which is the source if it is a YUV surface, and the
+ * dest otherwise. source_desc may be NULL if the source is not an
+ * imx2d surface (like the fill surface). G2D has no BT.2020 mode;
+ * BT.709 is used instead, since it is the closer match. Returns -1
+ * if no mode needs to be selected, either because no conversion
+ * takes place or because this G2D version has no CSC modes. */
+static int get_g2d_csc_mode(Imx2dSurfaceDesc const *source_desc, enum g2d_format source_g2d_format, Imx2dSurfaceDesc const *dest_desc, enum g2d_format dest_g2d_format)
+{
+#ifdef IMX2D_G2D_HAS_CSC_MODES
+	Imx2dSurfaceDesc const *yuv_desc;
+	BOOL full_range;
+
+	if ((source_desc != NULL) && g2d_format_is_yuv(source_g2d_format))
+		yuv_desc = source_desc;
+	else if (g2d_format_is_yuv(dest_g2d_format))
+		yuv_desc = dest_desc;
+	else
+		return -1;
+
+	full_range = (yuv_desc->color_range == IMX_2D_COLOR_RANGE_FULL);
+
+	switch (yuv_desc->color_matrix)
+	{
+		case IMX_2D_COLOR_MATRIX_BT709:
+		case IMX_2D_COLOR_MATRIX_BT2020:
+			return full_range ? G2D_YUV_BT_709FR : G2D_YUV_BT_709;
+		default:
+			return full_range ? G2D_YUV_BT_601FR : G2D_YUV_BT_601;
+	}
+#else
+	(void)source_desc;
+	(void)source_g2d_format;
+	(void)dest_desc;
+	(void)dest_g2d_format;
+	return -1;
+#endif
+}
+
+
+/* Like the blending states, the CSC mode is a global state of the
+ * G2D handle, and is cached the same way. A csc_mode of -1 (see
+ * get_g2d_csc_mode()) leaves the current mode as it is. */
+static void set_g2d_csc_mode(Imx2dG2DBlitter *g2d_blitter, int csc_mode)
+{
+#ifdef IMX2D_G2D_HAS_CSC_MODES
+	if ((csc_mode < 0) || (g2d_blitter->csc_mode_state == csc_mode))
+		return;
+
+	IMX_2D_LOG(TRACE, "switching G2D CSC mode to %d", csc_mode);
+
+	g2d_enable(g2d_blitter->g2d_handle, (enum g2d_cap_mode)csc_mode);
+	g2d_blitter->csc_mode_state = csc_mode;
+#else
+	(void)g2d_blitter;
+	(void)csc_mode;
+#endif
+}
+
+
+static void setup_g2d_blending(struct g2d_surface *g2d_source_surf, struct g2d_surface *g2d_dest_surf, BOOL do_alpha, int dest_surface_alpha)
+{
+	if (do_alpha)
+	{
+		g2d_source_surf->blendfunc = G2D_SRC_ALPHA;
+		g2d_dest_surf->blendfunc = G2D_ONE_MINUS_SRC_ALPHA;
+
+		if (dest_surface_alpha != 255)
+		{
+			g2d_source_surf->global_alpha = dest_surface_alpha;
+			g2d_dest_surf->global_alpha = 255 - dest_surface_alpha;
+		}
+	}
+	else
+	{
+		g2d_source_surf->blendfunc = G2D_ONE;
+		g2d_dest_surf->blendfunc = G2D_ZERO;
+		g2d_source_surf->global_alpha = 0;
+		g2d_dest_surf->global_alpha = 0;
+	}
+}
+
+
+/* Sets up the regions, clear colors, and rotations in the G2D source
+ * and dest surfaces. These only depend on the blit params, not on
+ * the DMA buffers, so blit plans only need to do this once. */
+static void setup_g2d_blit_surfaces(struct g2d_surfaceEx *g2d_source_surf, struct g2d_surfaceEx *g2d_dest_surf, Imx2dSurface *dest, Imx2dInternalBlitParams const *internal_blit_params)
+{
+	copy_region_to_g2d_surface(&(g2d_source_surf->base), internal_blit_params->source, internal_blit_params->source_region);
+	copy_region_to_g2d_surface(&(g2d_dest_surf->base), dest, internal_blit_params->dest_region);
+
+	g2d_source_surf->base.clrcolor = g2d_dest_surf->base.clrcolor = 0xFF000000;
+
+	g2d_source_surf->base.rot = g2d_dest_surf->base.rot = G2D_ROTATION_0;
+	switch (internal_blit_params->rotation)
+	{
+		case IMX_2D_ROTATION_90:  g2d_dest_surf->base.rot = G2D_ROTATION_90; break;
+		case IMX_2D_ROTATION_180: g2d_dest_surf->base.rot = G2D_ROTATION_180; break;
+		case IMX_2D_ROTATION_270: g2d_dest_surf->base.rot = G2D_ROTATION_270; break;
+		case IMX_2D_ROTATION_FLIP_HORIZONTAL: g2d_source_surf->base.rot = G2D_FLIP_H; break;
+		case IMX_2D_ROTATION_FLIP_VERTICAL: g2d_source_surf->base.rot = G2D_FLIP_V; break;
+		case IMX_2D_ROTATION_UL_LR:
+			g2d_source_surf->base.rot = G2D_FLIP_V;
+			g2d_dest_surf->base.rot = G2D_ROTATION_90;
+			break;
+		case IMX_2D_ROTATION_UR_LL:
+			g2d_source_surf->base.rot = G2D_FLIP_H;
+			g2d_dest_surf->base.rot = G2D_ROTATION_90;
+			break;
+		default: break;
+	}
+}
+
+
+/* Fills the regions with fill_color, which is in the 0xAARRGGBB format.
+ * If the alpha value is not 255, the color is blended over the existing
+ * pixels. dest_surf_info contains the already filled in G2D surface
+ * information about the blitter's dest surface. The clear color and
+ * blend states are set up once for all regions. */
+static int fill_g2d_regions(Imx2dG2DBlitter *g2d_blitter, Imx2dRegion const *regions, int num_regions, uint32_t fill_color, struct g2d_surface const *dest_surf_info)
+{
+	int i;
+	Imx2dBlitter *blitter = (Imx2dBlitter *)g2d_blitter;
+	struct g2d_surface g2d_dest_surf;
+	int fill_alpha = (fill_color >> 24) & 0xFF;
+
+	memcpy(&g2d_dest_surf, dest_surf_info, sizeof(struct g2d_surface));
+
+	/* G2D clear color is 0x00BBGGRR, fill_color
+	 * is 0x00RRGGBB, so we need to convert.  Also, the
+	 * clear operation exhibited problems when the MSB
+	 * wasn't 0xFF, so set it. */
+	g2d_dest_surf.clrcolor = ((fill_color & 0x0000FF) << 16)
+	                       | ((fill_color & 0x00FF00))
+	                       | ((fill_color & 0xFF0000) >> 16)
+	                       | 0xFF000000;
+
+	IMX_2D_LOG(TRACE, "fill color: %#08x alpha: %d number of regions: %d", fill_color & 0x00FFFFFF, fill_alpha, num_regions);
+
+	if (fill_alpha != 255)
+	{
+		/* g2d_clear() ignores alpha blending, so if fill_alpha is not 255,
+		 * use a trick. Take the fill_surface, which is a very small surface,
+		 * fill it with the fill color, and blit it with blending. The fill
+		 * surface keeps its contents, so it only has to be cleared again
+		 * if the color changes. */
+
+		if (!g2d_blitter->fill_g2d_surface_filled || (g2d_blitter->fill_g2d_surface.clrcolor != g2d_dest_surf.clrcolor))
+		{
+			g2d_blitter->fill_g2d_surface.clrcolor = g2d_dest_surf.clrcolor;
+			if (g2d_clear(g2d_blitter->g2d_handle, &(g2d_blitter->fill_g2d_surface)) != 0)
+			{
+				IMX_2D_LOG(ERROR, "could not clear fill surface");
+				g2d_blitter->fill_g2d_surface_filled = FALSE;
+				return FALSE;
+			}
+			g2d_blitter->fill_g2d_surface_filled = TRUE;
+		}
+
+		g2d_blitter->fill_g2d_surface.blendfunc = G2D_SRC_ALPHA;
+		g2d_blitter->fill_g2d_surface.global_alpha = fill_alpha;
+		g2d_dest_surf.blendfunc = G2D_ONE_MINUS_SRC_ALPHA;
+		g2d_dest_surf.global_alpha = fill_alpha;
+
+		set_g2d_blend_state(g2d_blitter, TRUE, TRUE);
+	}
+
+	set_g2d_csc_mode(g2d_blitter, get_g2d_csc_mode(NULL, g2d_blitter->fill_g2d_surface.format, imx_2d_surface_get_desc(blitter->dest), g2d_dest_surf.format));
+
+	for (i = 0; i < num_regions; ++i)
+	{
+		copy_region_to_g2d_surface(&g2d_dest_surf, blitter->dest, &(regions[i]));
+
+		IMX_2D_LOG(TRACE, "fill region #%d G2D surface: %d/%d/%d/%d", i, g2d_dest_surf.left, g2d_dest_surf.top, g2d_dest_surf.right, g2d_dest_surf.bottom);
+
+		if (fill_alpha == 255)
+		{
+			if (g2d_clear(g2d_blitter->g2d_handle, &g2d_dest_surf) != 0)
+			{
+				IMX_2D_LOG(ERROR, "could not clear area");
+				return FALSE;
+			}
+		}
+		else
+		{
+			if (g2d_blit(g2d_blitter->g2d_handle, &(g2d_blitter->fill_g2d_surface), &g2d_dest_surf) != 0)
+			{
+				IMX_2D_LOG(ERROR, "could not blit fill surface - filling area failed");
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+
+/* Draws the margin (if there is one) and performs the blit. The G2D
+ * surfaces must be fully filled in, that is, their layouts, planes,
+ * and what setup_g2d_blit_surfaces() sets up. */
+static int execute_g2d_blit(Imx2dG2DBlitter *g2d_blitter, Imx2dInternalBlitParams *internal_blit_params, struct g2d_surfaceEx *g2d_source_surf, struct g2d_surfaceEx *g2d_dest_surf)
+{
+	BOOL do_alpha;
+	int g2d_ret;
+
+	do_alpha = (internal_blit_params->dest_surface_alpha != 255) || source_needs_blending(internal_blit_params->source, g2d_source_surf->base.format);
+
+	DUMP_G2D_SURFACE_TO_LOG("blit source", g2d_source_surf);
+	DUMP_G2D_SURFACE_TO_LOG("blit dest", g2d_dest_surf);
+
+	IMX_2D_LOG(TRACE, "source tile layout: %s", g2d_tile_layout_to_string(g2d_source_surf->tiling));
+
+	/* If there is an expanded_dest_region, it means that
+	 * there is a margin that must be drawn. The margin
+	 * regions are filled with the rotation of the dest
+	 * surface, just like the blit itself. */
+	if (internal_blit_params->expanded_dest_region != NULL)
+	{
+		Imx2dBlitMargin margin;
+		Imx2dRegion margin_regions[4];
+		int num_margin_regions;
+		Imx2dRegion const *dest_region = internal_blit_params->dest_region;
+		Imx2dRegion const *expanded_dest_region = internal_blit_params->expanded_dest_region;
+
+		margin.left_margin = dest_region->x1 - expanded_dest_region->x1;
+		margin.top_margin = dest_region->y1 - expanded_dest_region->y1;
+		margin.right_margin = expanded_dest_region->x2 - dest_region->x2;
+		margin.bottom_margin = expanded_dest_region->y2 - dest_region->y2;
+		margin.color = internal_blit_params->margin_fill_color;
+
+		num_margin_regions = imx_2d_blit_margin_get_regions(&margin, dest_region, margin_regions);
+
+		if (!fill_g2d_regions(g2d_blitter, margin_regions, num_margin_regions, internal_blit_params->margin_fill_color, &(g2d_dest_surf->base)))
+		{
+			IMX_2D_LOG(ERROR, "could not fill margin");
+			return FALSE;
+		}
+	}
+
+	setup_g2d_blending(&(g2d_source_surf->base), &(g2d_dest_surf->base), do_alpha, internal_blit_params->dest_surface_alpha);
+	set_g2d_blend_state(g2d_blitter, do_alpha, do_alpha && (internal_blit_params->dest_surface_alpha != 255));
+	set_g2d_csc_mode(g2d_blitter, get_g2d_csc_mode(
+		imx_2d_surface_get_desc(internal_blit_params->source), g2d_source_surf->base.format,
+		imx_2d_surface_get_desc(((Imx2dBlitter *)g2d_blitter)->dest), g2d_dest_surf->base.format
+	));
+
+	g2d_ret = g2d_blitEx(g2d_blitter->g2d_handle, g2d_source_surf, g2d_dest_surf);
+
+#ifdef IMX2D_G2D_IMPLEMENTATION_BASED_ON_DPU
+	/* When G2D is emulated on top of the DPU, this must be called
+	 * after every blit. Otherwise, the next blit operation may
+	 * take place before the last one finished, causing visible
+	 * flickering and other frame corruptions. */
+	g2d_finish(g2d_blitter->g2d_handle);
+#endif
+
+	if (g2d_ret != 0)
+	{
+		IMX_2D_LOG(ERROR, "could not blit surface");
+		return FALSE;
+	}
+	else
+		return TRUE;
+}
+
+/* The dest_surf_info argument contains the already filled in
+ * G2D surface information about the blitter's dest surface.
+ * This way, batches only need to fill it in once. */
+static int blit_with_g2d(Imx2dG2DBlitter *g2d_blitter, Imx2dInternalBlitParams *internal_blit_params, struct g2d_surfaceEx const *dest_surf_info)
+{
+	Imx2dBlitter *blitter = (Imx2dBlitter *)g2d_blitter;
+	struct g2d_surfaceEx g2d_source_surf, g2d_dest_surf;
+
+	assert(internal_blit_params->source != NULL);
+
+	if (!fill_g2d_surfaceEx_info(&g2d_source_surf, internal_blit_params->source))
+		return FALSE;
+	memcpy(&g2d_dest_surf, dest_surf_info, sizeof(struct g2d_surfaceEx));
+
+	setup_g2d_blit_surfaces(&g2d_source_surf, &g2d_dest_surf, blitter->dest, internal_blit_params);
+
+	return execute_g2d_blit(g2d_blitter, internal_blit_params, &g2d_source_surf, &g2d_dest_surf);
+}
+
+
+static int fill_region_with_g2d(Imx2dG2DBlitter *g2d_blitter, Imx2dInternalFillRegionParams *internal_fill_region_params, struct g2d_surface const *dest_surf_info)
+{
+	assert(internal_fill_region_params->dest_region != NULL);
+
+	return fill_g2d_regions(g2d_blitter, internal_fill_region_params->dest_region, 1, internal_fill_region_params->fill_color | 0xFF000000, dest_surf_info);
+}
+
+
+#ifdef IMX2D_G2D_USE_MULTI_BLIT
+
+/* Checks if a batch operation can be part of a g2d_multi_blit() call.
+ * Multiblit works with plain, linear g2d_surface structures, and
+ * the blending enable states are global to all of its layers.
+ * Therefore, only simple blits (no rotation, no margin, no tiling)
+ * qualify, and all layers in one call must share the same blending
+ * states and CSC mode. These are returned in *do_alpha, *global_alpha,
+ * and *csc_mode. */
+static BOOL can_multi_blit(Imx2dBlitter *blitter, Imx2dInternalBatchOp const *op, BOOL *do_alpha, BOOL *global_alpha, int *csc_mode)
+{
+	Imx2dInternalBlitParams const *params = &(op->blit_params);
+	Imx2dSurfaceDesc const *source_desc, *dest_desc;
+	Imx2dPixelFormatInfo const *fmt_info;
+	enum g2d_format source_g2d_format, dest_g2d_format;
+
+	if (op->type != IMX_2D_INTERNAL_BATCH_OP_TYPE_BLIT)
+		return FALSE;
+	if ((params->rotation != IMX_2D_ROTATION_NONE) || (params->expanded_dest_region != NULL))
+		return FALSE;
+
+	source_desc = imx_2d_surface_get_desc(params->source);
+	fmt_info = imx_2d_get_pixel_format_info(source_desc->format);
+	if ((fmt_info == NULL) || fmt_info->is_tiled)
+		return FALSE;
+	if (!get_g2d_format(source_desc->format, &source_g2d_format))
+		return FALSE;
+
+	dest_desc = imx_2d_surface_get_desc(blitter->dest);
+	fmt_info = imx_2d_get_pixel_format_info(dest_desc->format);
+	if ((fmt_info == NULL) || fmt_info->is_tiled)
+		return FALSE;
+	if (!get_g2d_format(dest_desc->format, &dest_g2d_format))
+		return FALSE;
+
+	*do_alpha = (params->dest_surface_alpha != 255) || source_needs_blending(params->source, source_g2d_format);
+	*global_alpha = *do_alpha && (params->dest_surface_alpha != 255);
+	*csc_mode = get_g2d_csc_mode(source_desc, source_g2d_format, dest_desc, dest_g2d_format);
+
+	return TRUE;
+}
+
+
+static int multi_blit_with_g2d(Imx2dG2DBlitter *g2d_blitter, Imx2dInternalBatchOp *ops, int num_ops, BOOL do_alpha, BOOL global_alpha, int csc_mode, struct g2d_surface const *dest_surf_info)
+{
+	int i;
+	Imx2dBlitter *blitter = (Imx2dBlitter *)g2d_blitter;
+	struct g2d_surface_pair surface_pairs[IMX2D_G2D_MAX_MULTI_BLIT_LAYERS];
+	struct g2d_surface_pair *surface_pair_ptrs[IMX2D_G2D_MAX_MULTI_BLIT_LAYERS];
+
+	assert(num_ops <= IMX2D_G2D_MAX_MULTI_BLIT_LAYERS);
+
+	for (i = 0; i < num_ops; ++i)
+	{
+		Imx2dInternalBlitParams *params = &(ops[i].blit_params);
+		struct g2d_surface_pair *surface_pair = &(surface_pairs[i]);
+
+		if (!fill_g2d_surface_info(&(surface_pair->s), params->source))
+			return FALSE;
+		memcpy(&(surface_pair->d), dest_surf_info, sizeof(struct g2d_surface));
+
+		copy_region_to_g2d_surface(&(surface_pair->s), params->source, params->source_region);
+		copy_region_to_g2d_surface(&(surface_pair->d), blitter->dest, params->dest_region);
+
+		surface_pair->s.clrcolor = surface_pair->d.clrcolor = 0xFF000000;
+		surface_pair->s.rot = surface_pair->d.rot = G2D_ROTATION_0;
+
+		setup_g2d_blending(&(surface_pair->s), &(surface_pair->d), do_alpha, params->dest_surface_alpha);
+
+		surface_pair_ptrs[i] = surface_pair;
+	}
+
+	set_g2d_blend_state(g2d_blitter, do_alpha, global_alpha);
+	set_g2d_csc_mode(g2d_blitter, csc_mode);
+
+	IMX_2D_LOG(TRACE, "blitting %d layer(s) with g2d_multi_blit()", num_ops);
+
+	return (g2d_multi_blit(g2d_blitter->g2d_handle, surface_pair_ptrs, num_ops) == 0);
+}
+
+#endif /* IMX2D_G2D_USE_MULTI_BLIT */
+
+
+static int imx_2d_backend_g2d_blitter_do_blit_impl(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params)
+{
+	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
+	struct g2d_surfaceEx g2d_dest_surf;
+
+	assert(blitter != NULL);
+	assert(blitter->dest != NULL);
+	assert(internal_blit_params != NULL);
+
+	assert(g2d_blitter->g2d_handle != NULL);
+
+	if (!fill_g2d_surfaceEx_info(&g2d_dest_surf, blitter->dest))
+		return FALSE;
+
+	return blit_with_g2d(g2d_blitter, internal_blit_params, &g2d_dest_surf);
+}
+
+
+static int imx_2d_backend_g2d_blitter_do_planned_blit_impl(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params, void *plan_data)
+{
+	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
+	Imx2dG2DBlitPlanData *g2d_plan_data = (Imx2dG2DBlitPlanData *)plan_data;
+	struct g2d_surfaceEx g2d_source_surf, g2d_dest_surf;
+
+	assert(blitter != NULL);
+	assert(blitter->dest != NULL);
+	assert(internal_blit_params != NULL);
+	assert(g2d_plan_data != NULL);
+
+	assert(g2d_blitter->g2d_handle != NULL);
+
+	/* Only the planes need to be filled in. Everything
+	 * else was set up when the plan data was created.
+	 * Copies are used, since execute_g2d_blit() modifies
+	 * the blending fields in the surfaces. */
+	memcpy(&g2d_source_surf, &(g2d_plan_data->source_surf), sizeof(struct g2d_surfaceEx));
+	memcpy(&g2d_dest_surf, &(g2d_plan_data->dest_surf), sizeof(struct g2d_surfaceEx));
+
+	if (!fill_g2d_surface_planes(&(g2d_source_surf.base), internal_blit_params->source)
+	 || !fill_g2d_surface_planes(&(g2d_dest_surf.base), blitter->dest))
+		return FALSE;
+
+	return execute_g2d_blit(g2d_blitter, internal_blit_params, &g2d_source_surf, &g2d_dest_surf);
+}
+
+
+static int imx_2d_backend_g2d_blitter_fill_region_impl(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams *internal_fill_region_params)
+{
+	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
+	struct g2d_surface g2d_dest_surf;
+
+	assert(blitter != NULL);
+	assert(blitter->dest != NULL);
+	assert(internal_fill_region_params != NULL);
+
+	assert(g2d_blitter->g2d_handle != NULL);
+
+	if (!fill_g2d_surface_info(&g2d_dest_surf, blitter->dest))
+		return FALSE;
+
+	return fill_region_with_g2d(g2d_blitter, internal_fill_region_params, &g2d_dest_surf);
+}
+
+
+static int imx_2d_backend_g2d_blitter_fill_regions_impl(Imx2dBlitter *blitter, Imx2dInternalFillRegionsParams *internal_fill_regions_params)
+{
+	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
+	struct g2d_surface g2d_dest_surf;
+
+	assert(blitter != NULL);
+	assert(blitter->dest != NULL);
+	assert(internal_fill_regions_params != NULL);
+
+	assert(g2d_blitter->g2d_handle != NULL);
+
+	/* The dest surface info is filled in once for all regions. */
+	if (!fill_g2d_surface_info(&g2d_dest_surf, blitter->dest))
+		return FALSE;
+
+	return fill_g2d_regions(g2d_blitter, internal_fill_regions_params->dest_regions, internal_fill_regions_params->num_dest_regions, internal_fill_regions_params->fill_color | 0xFF000000, &g2d_dest_surf);
+}
+
+
+static int imx_2d_backend_g2d_blitter_submit_batch_impl(Imx2dBlitter *blitter, Imx2dInternalBatchOp *ops, int num_ops)
+{
+	int i;
+	Imx2dG2DBlitter *g2d_blitter = (Imx2dG2DBlitter *)blitter;
+	struct g2d_surfaceEx g2d_dest_surf;
+
+	assert(blitter != NULL);
+	assert(blitter->dest != NULL);
+	assert(ops != NULL);
+
+	assert(g2d_blitter->g2d_handle != NULL);
+
+	/* The dest surface is the same for all operations in the
+	 * batch, so its G2D surface info only needs to be filled once. */
+	if (!fill_g2d_surfaceEx_info(&g2d_dest_surf, blitter->dest))
+		return FALSE;
+
+	i = 0;
+	while (i < num_ops)
+	{
+		Imx2dInternalBatchOp *op = &(ops[i]);
+
+		if (op->type == IMX_2D_INTERNAL_BATCH_OP_TYPE_FILL_REGION)
+		{
+			/* Fill consecutive fill operations with the same
+			 * color together to set up the fill state only once. */
+			Imx2dRegion fill_regions[IMX_2D_MAX_NUM_FILL_REGIONS_PER_CALL];
+			int num_fill_regions = 0;
+			uint32_t fill_color = op->fill_region_params.fill_color;
+
+			while ((i < num_ops) && (num_fill_regions < IMX_2D_MAX_NUM_FILL_REGIONS_PER_CALL)
+			    && (ops[i].type == IMX_2D_INTERNAL_BATCH_OP_TYPE_FILL_REGION)
+			    && (ops[i].fill_region_params.fill_color == fill_color))
+			{
+				assert(ops[i].fill_region_params.dest_region != NULL);
+				fill_regions[num_fill_regions++] = *(ops[i].fill_region_params.dest_region);
+				++i;
+			}
+
+			if (!fill_g2d_regions(g2d_blitter, fill_regions, num_fill_regions, fill_color | 0xFF000000, &(g2d_dest_surf.base)))
+				return FALSE;
+			continue;
+		}
+
+#ifdef IMX2D_G2D_USE_MULTI_BLIT
+		{
+			BOOL do_alpha, global_alpha;
+			int csc_mode;
+
+			if (!g2d_blitter->multi_blit_failed && can_multi_blit(blitter, op, &do_alpha, &global_alpha, &csc_mode))
+			{
+				int num_layers = 1;
+
+				/* Collect subsequent blits that can be done in the same
+				 * g2d_multi_blit() call. The order of the operations is
+				 * retained, since the layers are blended in order. */
+				while (((i + num_layers) < num_ops) && (num_layers < IMX2D_G2D_MAX_MULTI_BLIT_LAYERS))
+				{
+					BOOL next_do_alpha, next_global_alpha;
+					int next_csc_mode;
+
+					if (!can_multi_blit(blitter, &(ops[i + num_layers]), &next_do_alpha, &next_global_alpha, &next_csc_mode))
+						break;
+					if ((next_do_alpha != do_alpha) || (next_global_alpha != global_alpha) || (next_csc_mode != csc_mode))
+						break;
+
+					++num_layers;
+				}
+
+				if (num_layers > 1)
+				{
+					if (multi_blit_with_g2d(g2d_blitter, op, num_layers, do_alpha, global_alpha, csc_mode, &(g2d_dest_surf.base)))
+					{
+						i += num_layers;
+						continue;
+					}
+
+					/* Some G2D implementations export g2d_multi_blit()
+					 * but do not actually support it. Do not try it
+					 * again, and blit the layers individually instead. */
+					IMX_2D_LOG(WARNING, "g2d_multi_blit() failed; falling back to individual blits");
+					g2d_blitter->multi_blit_failed = TRUE;
+				}
+			}
+		}
+#endif
+
+		if (op->plan_data != NULL)
+		{
+			if (!imx_2d_backend_g2d_blitter_do_planned_blit_impl(blitter, &(op->blit_params), op->plan_data))
+				return FALSE;
+		}
+		else if (!blit_with_g2d(g2d_blitter, &(op->blit_params), &g2d_dest_surf))
+			return FALSE;
+		++i;
+	}
+
+	return TRUE;
+}
+
+
+static void* imx_2d_backend_g2d_blitter_create_plan_data(Imx2dBlitter *blitter, Imx2dSurface *dest, Imx2dInternalBlitParams const *internal_blit_params)
+{
+	Imx2dG2DBlitPlanData *plan_data;
+
+	IMX_2D_UNUSED_PARAM(blitter);
+
+	/* This does not call any G2D function, so unlike the
+	 * other vfuncs, it does not have to run in the worker thread. */
+
+	plan_data = malloc(sizeof(Imx2dG2DBlitPlanData));
+	if (plan_data == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not allocate G2D blit plan data");
+		return NULL;
+	}
+
+	memset(plan_data, 0, sizeof(Imx2dG2DBlitPlanData));
+
+	if (!fill_g2d_surfaceEx_layout(&(plan_data->source_surf), internal_blit_params->source)
+	 || !fill_g2d_surfaceEx_layout(&(plan_data->dest_surf), dest))
+	{
+		free(plan_data);
+		return NULL;
+	}
+
+	setup_g2d_blit_surfaces(&(plan_data->source_surf), &(plan_data->dest_surf), dest, internal_blit_params);
+
+	return plan_data;
+}
+
+
+static void imx_2d_backend_g2d_blitter_destroy_plan_data(Imx2dBlitter *blitter, void *plan_data)
+{
+	IMX_2D_UNUSED_PARAM(blitter);
+	free(plan_data);
+}
+
+
+static int imx_2d_backend_g2d_blitter_do_planned_blit(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params, void *plan_data)
+{
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+	Imx2dG2DWorkerPlannedBlitParams planned_blit_params = { internal_blit_params, plan_data };
+	return run_in_g2d_worker_thread((Imx2dG2DBlitter *)blitter, G2D_WORKER_COMMAND_DO_PLANNED_BLIT, &planned_blit_params);
+#else
+	return imx_2d_backend_g2d_blitter_do_planned_blit_impl(blitter, internal_blit_params, plan_data);
+#endif
+}
+
+
+static Imx2dHardwareCapabilities const * imx_2d_backend_g2d_blitter_get_hardware_capabilities(Imx2dBlitter *blitter)
+{
+	IMX_2D_UNUSED_PARAM(blitter);
+	return imx_2d_backend_g2d_get_hardware_capabilities();
+}
+
+
+
+
+Imx2dBlitter* imx_2d_backend_g2d_blitter_create(void)
+{
+	int err;
 
 	/* Set up the internal fill surface that will be used when drawing margins
-	 * that aren't 100% opaque (see imx_2d_backend_g2d_blitter_do_blit() above).
+	 * that aren't 100% opaque (see fill_g2d_regions() above).
 	 * The internal fill surface does not have to be large. In fact, it is desirable
 	 * to make it as small as possible to ensure the g2d_clear() calls in the
 	 * blit() function uses as little bandwidth as possible. For this reason, the
@@ -735,6 +1594,15 @@ Imx2dBlitter* imx_2d_backend_g2d_blitter_create(void)
 
 	g2d_blitter->fill_g2d_surface.planes[0] = imx_dma_buffer_get_physical_address(g2d_blitter->fill_g2d_surface_dmabuffer);
 
+#ifdef IMX2D_G2D_USE_WORKER_THREAD
+	if (!start_g2d_worker_thread(g2d_blitter))
+	{
+		IMX_2D_LOG(ERROR, "could not start G2D worker thread");
+		goto error;
+	}
+	IMX_2D_LOG(DEBUG, "started G2D worker thread; G2D handle stays open until the blitter is destroyed");
+#endif
+
 finish:
 	return (Imx2dBlitter *)g2d_blitter;
 
@@ -758,7 +1626,13 @@ static Imx2dHardwareCapabilities const capabilities = {
 	.stride_alignment = 16,
 	.total_row_count_alignment = 8,
 
-	.can_handle_multi_buffer_surfaces = 1
+	.can_handle_multi_buffer_surfaces = 1,
+
+	.draws_blit_margins_for_free = 0,
+
+	/* The GPU's bilinear filtering only samples 2x2 texels, so
+	 * stronger downscaling produces heavily aliased output. */
+	.max_downscale_factor = 4
 };
 
 Imx2dHardwareCapabilities const * imx_2d_backend_g2d_get_hardware_capabilities(void)
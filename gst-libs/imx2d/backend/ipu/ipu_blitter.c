@@ -174,7 +174,18 @@ static Imx2dBlitterClass imx_2d_backend_ipu_blitter_class =
 	imx_2d_backend_ipu_blitter_do_blit,
 	imx_2d_backend_ipu_blitter_fill_region,
 
-	imx_2d_backend_ipu_blitter_get_hardware_capabilities
+	imx_2d_backend_ipu_blitter_get_hardware_capabilities,
+
+	NULL,
+	NULL,
+
+	NULL,
+	NULL,
+	NULL,
+
+	NULL,
+
+	"ipu"
 };
 
 
@@ -592,7 +603,13 @@ static Imx2dHardwareCapabilities const capabilities = {
 	.stride_alignment = 16,
 	.total_row_count_alignment = 8,
 
-	.can_handle_multi_buffer_surfaces = 0
+	.can_handle_multi_buffer_surfaces = 0,
+
+	.draws_blit_margins_for_free = 0,
+
+	/* The IPU's resizer handles up to 1/8 downscaling by combining its
+	 * downsizer with its resizer. Anything beyond that is rejected. */
+	.max_downscale_factor = 8
 };
 
 Imx2dHardwareCapabilities const * imx_2d_backend_ipu_get_hardware_capabilities(void)
@@ -136,7 +136,18 @@ static Imx2dBlitterClass imx_2d_backend_pxp_blitter_class =
 	imx_2d_backend_pxp_blitter_do_blit,
 	imx_2d_backend_pxp_blitter_fill_region,
 
-	imx_2d_backend_pxp_blitter_get_hardware_capabilities
+	imx_2d_backend_pxp_blitter_get_hardware_capabilities,
+
+	NULL,
+	NULL,
+
+	NULL,
+	NULL,
+	NULL,
+
+	NULL,
+
+	"pxp"
 };
 
 
@@ -360,6 +371,19 @@ static int imx_2d_backend_pxp_blitter_do_blit(Imx2dBlitter *blitter, Imx2dIntern
 	}
 	src_param->pixel_fmt = pxp_format;
 
+	/* The PxP's input CSC only distinguishes between limited range
+	 * ("YCbCr") and full range ("YUV") BT.601 coefficients.
+	 * Other matrices are approximated with BT.601. */
+	pconf->proc_data.yuv = (src_surface_desc->color_range == IMX_2D_COLOR_RANGE_FULL) ? 1 : 0;
+	if ((src_surface_desc->color_matrix != IMX_2D_COLOR_MATRIX_DEFAULT) && (src_surface_desc->color_matrix != IMX_2D_COLOR_MATRIX_BT601))
+	{
+		IMX_2D_LOG(
+			DEBUG,
+			"PxP does not support %s color matrix; using BT.601 instead",
+			imx_2d_color_matrix_to_string(src_surface_desc->color_matrix)
+		);
+	}
+
 	if (ioctl(pxp_blitter->pxp_fd, PXP_IOC_CONFIG_CHAN, pconf) != 0)
 	{
 		IMX_2D_LOG(ERROR, "could not configure PxP channel: %s", strerror(errno));
@@ -487,7 +511,13 @@ static Imx2dHardwareCapabilities const capabilities = {
 	.stride_alignment = 16,
 	.total_row_count_alignment = 8,
 
-	.can_handle_multi_buffer_surfaces = 0
+	.can_handle_multi_buffer_surfaces = 0,
+
+	.draws_blit_margins_for_free = 1,
+
+	/* The PxP's scaler is rated for a downscale factor of up to 1/4
+	 * per direction; beyond that, the output quality degrades. */
+	.max_downscale_factor = 4
 };
 
 Imx2dHardwareCapabilities const * imx_2d_backend_pxp_get_hardware_capabilities(void)
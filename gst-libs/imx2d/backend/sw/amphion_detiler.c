@@ -0,0 +1,500 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <config.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMX2D_SW_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define IMX2D_SW_USE_SSE2
+#endif
+
+#include "imx2d/imx2d_priv.h"
+#include "amphion_tiling.h"
+#include "amphion_detiler.h"
+#include "sw_worker_pool.h"
+
+
+/* Frames are split into bands of this many rows. It divides the
+ * tile height, so a band never straddles two tile rows. */
+#define DETILE_BAND_NUM_ROWS 32
+
+/* Number of tile columns that are read together. 8 columns of
+ * 8 bytes each produce 64 linear bytes, which is one cache line. */
+#define DETILE_COLUMN_GROUP_SIZE 8
+
+
+typedef struct
+{
+	uint8_t const *source_plane;
+	int source_stride;
+	uint8_t *dest_plane;
+	int dest_stride;
+	/* Number of 8-bit output bytes per row. */
+	int num_row_bytes;
+	int num_rows;
+	int first_band;
+	BOOL swap_uv;
+}
+DetilePlaneJob;
+
+
+typedef struct
+{
+	DetilePlaneJob planes[2];
+	BOOL is_10bit;
+	int num_bands;
+}
+DetileJob;
+
+
+struct _Imx2dSwAmphionDetiler
+{
+	SwWorkerPool *worker_pool;
+	/* FALSE if the pool belongs to a software blitter. */
+	BOOL owns_worker_pool;
+
+	DetileJob job;
+};
+
+
+
+
+/* Row detiling */
+
+
+/* Copies one row of a group of DETILE_COLUMN_GROUP_SIZE tiles
+ * into 64 contiguous destination bytes. */
+static inline void copy_tile_group_row(uint8_t *dest, uint8_t const *src)
+{
+#if defined(IMX2D_SW_USE_NEON)
+	int i;
+	for (i = 0; i < DETILE_COLUMN_GROUP_SIZE; i += 2)
+	{
+		uint8x8_t first = vld1_u8(src + (i + 0) * AMPHION_TILE_SIZE);
+		uint8x8_t second = vld1_u8(src + (i + 1) * AMPHION_TILE_SIZE);
+		vst1q_u8(dest + i * AMPHION_TILE_WIDTH, vcombine_u8(first, second));
+	}
+#elif defined(IMX2D_SW_USE_SSE2)
+	int i;
+	for (i = 0; i < DETILE_COLUMN_GROUP_SIZE; i += 2)
+	{
+		__m128i first = _mm_loadl_epi64((__m128i const *)(src + (i + 0) * AMPHION_TILE_SIZE));
+		__m128i second = _mm_loadl_epi64((__m128i const *)(src + (i + 1) * AMPHION_TILE_SIZE));
+		_mm_storeu_si128((__m128i *)(dest + i * AMPHION_TILE_WIDTH), _mm_unpacklo_epi64(first, second));
+	}
+#else
+	int i;
+	for (i = 0; i < DETILE_COLUMN_GROUP_SIZE; ++i)
+		memcpy(dest + i * AMPHION_TILE_WIDTH, src + i * AMPHION_TILE_SIZE, AMPHION_TILE_WIDTH);
+#endif
+}
+
+
+static void swap_uv_row(uint8_t *row, int num_row_bytes)
+{
+	int i;
+
+	for (i = 0; (i + 1) < num_row_bytes; i += 2)
+	{
+		uint8_t tmp = row[i];
+		row[i] = row[i + 1];
+		row[i + 1] = tmp;
+	}
+}
+
+
+/* Detiles rows [first_row, first_row + num_rows) of an 8-bit plane.
+ * The rows must lie within the same tile row. Tiles are read in
+ * groups, and all rows of a group are copied before moving on to
+ * the next group. This way, the source is read sequentially within
+ * each tile, and each destination row gets whole cache lines. */
+static void detile_8bit_rows(DetilePlaneJob const *plane_job, int first_row, int num_rows)
+{
+	uint8_t const *tiled_rows = amphion_tiled_row(plane_job->source_plane, plane_job->source_stride, first_row);
+	uint8_t *dest_rows = plane_job->dest_plane + first_row * plane_job->dest_stride;
+	int num_full_columns = plane_job->num_row_bytes / AMPHION_TILE_WIDTH;
+	int num_remaining_bytes = plane_job->num_row_bytes % AMPHION_TILE_WIDTH;
+	int column, row;
+
+	for (column = 0; column < num_full_columns; column += DETILE_COLUMN_GROUP_SIZE)
+	{
+		int num_group_columns = MIN(DETILE_COLUMN_GROUP_SIZE, num_full_columns - column);
+		uint8_t const *src = tiled_rows + column * AMPHION_TILE_SIZE;
+		uint8_t *dest = dest_rows + column * AMPHION_TILE_WIDTH;
+
+		if (num_group_columns == DETILE_COLUMN_GROUP_SIZE)
+		{
+			for (row = 0; row < num_rows; ++row)
+				copy_tile_group_row(dest + row * plane_job->dest_stride, src + row * AMPHION_TILE_WIDTH);
+		}
+		else
+		{
+			for (row = 0; row < num_rows; ++row)
+			{
+				int i;
+				for (i = 0; i < num_group_columns; ++i)
+					memcpy(dest + row * plane_job->dest_stride + i * AMPHION_TILE_WIDTH, src + row * AMPHION_TILE_WIDTH + i * AMPHION_TILE_SIZE, AMPHION_TILE_WIDTH);
+			}
+		}
+	}
+
+	if (num_remaining_bytes > 0)
+	{
+		uint8_t const *src = tiled_rows + num_full_columns * AMPHION_TILE_SIZE;
+		uint8_t *dest = dest_rows + num_full_columns * AMPHION_TILE_WIDTH;
+
+		for (row = 0; row < num_rows; ++row)
+			memcpy(dest + row * plane_job->dest_stride, src + row * AMPHION_TILE_WIDTH, num_remaining_bytes);
+	}
+
+	if (plane_job->swap_uv)
+	{
+		for (row = 0; row < num_rows; ++row)
+			swap_uv_row(dest_rows + row * plane_job->dest_stride, plane_job->num_row_bytes);
+	}
+}
+
+
+/* 4 packed 10-bit samples occupy 5 bytes. 32 samples occupy 40 bytes,
+ * which are exactly 5 tile columns, so groups of 32 samples can be
+ * gathered with whole 8-byte tile row loads. */
+#define DETILE_10BIT_GROUP_NUM_SAMPLES 32
+#define DETILE_10BIT_GROUP_NUM_COLUMNS 5
+
+
+/* Converts 4 packed big endian 10-bit samples to 8 bits
+ * by keeping their 8 most significant bits. */
+static inline void unpack_10bit_quad(uint8_t *dest, uint8_t const *src)
+{
+	dest[0] = src[0];
+	dest[1] = (uint8_t)((src[1] << 2) | (src[2] >> 6));
+	dest[2] = (uint8_t)((src[2] << 4) | (src[3] >> 4));
+	dest[3] = (uint8_t)((src[3] << 6) | (src[4] >> 2));
+}
+
+
+static void detile_10bit_rows(DetilePlaneJob const *plane_job, int first_row, int num_rows)
+{
+	int num_samples = plane_job->num_row_bytes;
+	int num_full_groups = num_samples / DETILE_10BIT_GROUP_NUM_SAMPLES;
+	int row;
+
+	for (row = 0; row < num_rows; ++row)
+	{
+		uint8_t const *tiled_row = amphion_tiled_row(plane_job->source_plane, plane_job->source_stride, first_row + row);
+		uint8_t *dest_row = plane_job->dest_plane + (first_row + row) * plane_job->dest_stride;
+		int group, sample;
+
+		for (group = 0; group < num_full_groups; ++group)
+		{
+			uint8_t packed[DETILE_10BIT_GROUP_NUM_COLUMNS * AMPHION_TILE_WIDTH];
+			uint8_t const *src = tiled_row + group * DETILE_10BIT_GROUP_NUM_COLUMNS * AMPHION_TILE_SIZE;
+			uint8_t *dest = dest_row + group * DETILE_10BIT_GROUP_NUM_SAMPLES;
+			int i;
+
+			for (i = 0; i < DETILE_10BIT_GROUP_NUM_COLUMNS; ++i)
+				memcpy(packed + i * AMPHION_TILE_WIDTH, src + i * AMPHION_TILE_SIZE, AMPHION_TILE_WIDTH);
+
+			for (i = 0; i < DETILE_10BIT_GROUP_NUM_SAMPLES / 4; ++i)
+				unpack_10bit_quad(dest + i * 4, packed + i * 5);
+		}
+
+		for (sample = num_full_groups * DETILE_10BIT_GROUP_NUM_SAMPLES; sample < num_samples; ++sample)
+			dest_row[sample] = amphion_tiled_row_10bit_sample(tiled_row, sample);
+
+		if (plane_job->swap_uv)
+			swap_uv_row(dest_row, plane_job->num_row_bytes);
+	}
+}
+
+
+static void process_band(void *user_data, int band, int thread_index)
+{
+	DetileJob const *job = (DetileJob const *)user_data;
+	DetilePlaneJob const *plane_job = (band >= job->planes[1].first_band) ? &(job->planes[1]) : &(job->planes[0]);
+	int first_row = (band - plane_job->first_band) * DETILE_BAND_NUM_ROWS;
+	int num_rows = MIN(DETILE_BAND_NUM_ROWS, plane_job->num_rows - first_row);
+
+	IMX_2D_UNUSED_PARAM(thread_index);
+
+	if (job->is_10bit)
+		detile_10bit_rows(plane_job, first_row, num_rows);
+	else
+		detile_8bit_rows(plane_job, first_row, num_rows);
+}
+
+
+
+
+/* Public functions */
+
+
+static BOOL check_formats(Imx2dPixelFormat source_format, Imx2dPixelFormat dest_format)
+{
+	if (!amphion_format_is_tiled(source_format))
+	{
+		IMX_2D_LOG(ERROR, "source format %s is not an Amphion tiled format", imx_2d_pixel_format_to_string(source_format));
+		return FALSE;
+	}
+
+	if ((dest_format != IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV12) && (dest_format != IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV21))
+	{
+		IMX_2D_LOG(ERROR, "cannot detile into destination format %s; only NV12 and NV21 are supported", imx_2d_pixel_format_to_string(dest_format));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+BOOL amphion_check_tiled_strides(Imx2dPixelFormat format, int const *strides, int width)
+{
+	int plane_nr;
+
+	for (plane_nr = 0; plane_nr < 2; ++plane_nr)
+	{
+		/* The UV plane has a U and a V sample for each pair of pixels. */
+		int num_row_samples = (plane_nr == 0) ? width : (((width + 1) / 2) * 2);
+		int min_stride = amphion_min_plane_stride(format, num_row_samples);
+
+		if (((strides[plane_nr] % AMPHION_TILE_WIDTH) != 0) || (strides[plane_nr] < min_stride))
+		{
+			IMX_2D_LOG(ERROR, "stride %d of tiled plane #%d is invalid; it must be a multiple of %d and at least %d", strides[plane_nr], plane_nr, AMPHION_TILE_WIDTH, min_stride);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
+BOOL amphion_check_tiled_surface(Imx2dSurface *surface)
+{
+	Imx2dSurfaceDesc const *desc = imx_2d_surface_get_desc(surface);
+	int plane_nr;
+
+	if (!amphion_check_tiled_strides(desc->format, desc->plane_strides, desc->width))
+		return FALSE;
+
+	for (plane_nr = 0; plane_nr < 2; ++plane_nr)
+	{
+		ImxDmaBuffer *dma_buffer = imx_2d_surface_get_dma_buffer(surface, plane_nr);
+		int num_rows = (plane_nr == 0) ? desc->height : ((desc->height + 1) / 2);
+		int num_tile_rows = (num_rows + AMPHION_TILE_HEIGHT - 1) / AMPHION_TILE_HEIGHT;
+		size_t min_size = (size_t)(imx_2d_surface_get_dma_buffer_offset(surface, plane_nr)) + (size_t)(desc->plane_strides[plane_nr]) * AMPHION_TILE_HEIGHT * num_tile_rows;
+		size_t size;
+
+		if (dma_buffer == NULL)
+		{
+			IMX_2D_LOG(ERROR, "tiled plane #%d has no DMA buffer", plane_nr);
+			return FALSE;
+		}
+
+		size = imx_dma_buffer_get_size(dma_buffer);
+		if (size < min_size)
+		{
+			IMX_2D_LOG(
+				ERROR,
+				"DMA buffer of tiled plane #%d is too small: it has %zu byte(s), but %d tile row(s) with stride %d starting at offset %d need %zu byte(s)",
+				plane_nr, size, num_tile_rows, desc->plane_strides[plane_nr], imx_2d_surface_get_dma_buffer_offset(surface, plane_nr), min_size
+			);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
+Imx2dSwAmphionDetiler* amphion_detiler_create_with_worker_pool(SwWorkerPool *worker_pool)
+{
+	Imx2dSwAmphionDetiler *detiler;
+
+	assert(worker_pool != NULL);
+
+	detiler = malloc(sizeof(Imx2dSwAmphionDetiler));
+	assert(detiler != NULL);
+
+	memset(detiler, 0, sizeof(Imx2dSwAmphionDetiler));
+
+	detiler->worker_pool = worker_pool;
+
+	return detiler;
+}
+
+
+Imx2dSwAmphionDetiler* imx_2d_backend_sw_amphion_detiler_create(int num_threads)
+{
+	Imx2dSwAmphionDetiler *detiler;
+	SwWorkerPool *worker_pool;
+
+	worker_pool = sw_worker_pool_create(num_threads, 0);
+	if (worker_pool == NULL)
+		return NULL;
+
+	detiler = amphion_detiler_create_with_worker_pool(worker_pool);
+	detiler->owns_worker_pool = TRUE;
+
+	IMX_2D_LOG(DEBUG, "created Amphion detiler with %d thread(s)", sw_worker_pool_get_num_threads(worker_pool));
+
+	return detiler;
+}
+
+
+void imx_2d_backend_sw_amphion_detiler_destroy(Imx2dSwAmphionDetiler *detiler)
+{
+	assert(detiler != NULL);
+
+	if (detiler->owns_worker_pool)
+		sw_worker_pool_destroy(detiler->worker_pool);
+
+	free(detiler);
+}
+
+
+int imx_2d_backend_sw_amphion_detiler_get_num_threads(Imx2dSwAmphionDetiler *detiler)
+{
+	assert(detiler != NULL);
+	return sw_worker_pool_get_num_threads(detiler->worker_pool);
+}
+
+
+int imx_2d_backend_sw_amphion_detiler_detile_mapped(
+	Imx2dSwAmphionDetiler *detiler,
+	Imx2dPixelFormat source_format, uint8_t const * const *source_planes, int const *source_strides,
+	Imx2dPixelFormat dest_format, uint8_t * const *dest_planes, int const *dest_strides,
+	int width, int height
+)
+{
+	BOOL source_is_nv21, dest_is_nv21;
+	DetileJob *job = &(detiler->job);
+	int plane_nr;
+
+	assert(detiler != NULL);
+
+	if (!check_formats(source_format, dest_format))
+		return FALSE;
+
+	if ((width <= 0) || (height <= 0))
+		return TRUE;
+
+	if (!amphion_check_tiled_strides(source_format, source_strides, width))
+		return FALSE;
+
+	source_is_nv21 = (source_format == IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128) || (source_format == IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128_10BIT);
+	dest_is_nv21 = (dest_format == IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV21);
+
+	job->is_10bit = amphion_format_is_10bit(source_format);
+	job->num_bands = 0;
+
+	for (plane_nr = 0; plane_nr < 2; ++plane_nr)
+	{
+		DetilePlaneJob *plane_job = &(job->planes[plane_nr]);
+
+		plane_job->source_plane = source_planes[plane_nr];
+		plane_job->source_stride = source_strides[plane_nr];
+		plane_job->dest_plane = dest_planes[plane_nr];
+		plane_job->dest_stride = dest_strides[plane_nr];
+		/* Both planes have one byte per output sample. The UV
+		 * plane has half as many rows, and interleaved U and V
+		 * samples for each pair of pixels. */
+		plane_job->num_row_bytes = (plane_nr == 0) ? width : (((width + 1) / 2) * 2);
+		plane_job->num_rows = (plane_nr == 0) ? height : ((height + 1) / 2);
+		plane_job->first_band = job->num_bands;
+		plane_job->swap_uv = (plane_nr == 1) && (source_is_nv21 != dest_is_nv21);
+
+		job->num_bands += (plane_job->num_rows + DETILE_BAND_NUM_ROWS - 1) / DETILE_BAND_NUM_ROWS;
+	}
+
+	IMX_2D_LOG(
+		TRACE,
+		"detiling %dx%d frame from %s to %s in %d bands with %d thread(s)",
+		width, height,
+		imx_2d_pixel_format_to_string(source_format), imx_2d_pixel_format_to_string(dest_format),
+		job->num_bands, sw_worker_pool_get_num_threads(detiler->worker_pool)
+	);
+
+	return sw_worker_pool_run(detiler->worker_pool, job->num_bands, process_band, job);
+}
+
+
+int imx_2d_backend_sw_amphion_detiler_detile(Imx2dSwAmphionDetiler *detiler, Imx2dSurface *tiled_source, Imx2dSurface *dest)
+{
+	Imx2dSurface *surfaces[2] = { tiled_source, dest };
+	unsigned int const mapping_flags[2] = { IMX_DMA_BUFFER_MAPPING_FLAG_READ, IMX_DMA_BUFFER_MAPPING_FLAG_WRITE };
+	ImxDmaBuffer *mapped_dma_buffers[4];
+	int num_mapped_dma_buffers = 0;
+	uint8_t *planes[2][2];
+	int strides[2][2];
+	Imx2dSurfaceDesc const *source_desc;
+	Imx2dSurfaceDesc const *dest_desc;
+	int surface_nr, plane_nr, i;
+	int ret = FALSE;
+
+	assert(detiler != NULL);
+	assert(tiled_source != NULL);
+	assert(dest != NULL);
+
+	source_desc = imx_2d_surface_get_desc(tiled_source);
+	dest_desc = imx_2d_surface_get_desc(dest);
+
+	if (!check_formats(source_desc->format, dest_desc->format))
+		return FALSE;
+
+	if (!amphion_check_tiled_surface(tiled_source))
+		return FALSE;
+
+	for (surface_nr = 0; surface_nr < 2; ++surface_nr)
+	{
+		Imx2dSurfaceDesc const *desc = imx_2d_surface_get_desc(surfaces[surface_nr]);
+		int first_mapped_dma_buffer = num_mapped_dma_buffers;
+
+		for (plane_nr = 0; plane_nr < 2; ++plane_nr)
+		{
+			ImxDmaBuffer *dma_buffer = imx_2d_surface_get_dma_buffer(surfaces[surface_nr], plane_nr);
+			uint8_t *virtual_address = NULL;
+
+			assert(dma_buffer != NULL);
+
+			/* The Y and UV planes frequently share a DMA buffer. */
+			if ((plane_nr == 1) && (num_mapped_dma_buffers > first_mapped_dma_buffer) && (mapped_dma_buffers[num_mapped_dma_buffers - 1] == dma_buffer))
+			{
+				virtual_address = planes[surface_nr][0] - imx_2d_surface_get_dma_buffer_offset(surfaces[surface_nr], 0);
+			}
+			else
+			{
+				int error = 0;
+
+				virtual_address = imx_dma_buffer_map(dma_buffer, mapping_flags[surface_nr], &error);
+				if (virtual_address == NULL)
+				{
+					IMX_2D_LOG(ERROR, "could not map DMA buffer of plane #%d of %s surface: %s (%d)", plane_nr, (surface_nr == 0) ? "source" : "destination", strerror(error), error);
+					goto finish;
+				}
+
+				mapped_dma_buffers[num_mapped_dma_buffers++] = dma_buffer;
+			}
+
+			planes[surface_nr][plane_nr] = virtual_address + imx_2d_surface_get_dma_buffer_offset(surfaces[surface_nr], plane_nr);
+			strides[surface_nr][plane_nr] = desc->plane_strides[plane_nr];
+		}
+	}
+
+	ret = imx_2d_backend_sw_amphion_detiler_detile_mapped(
+		detiler,
+		source_desc->format, (uint8_t const * const *)(planes[0]), strides[0],
+		dest_desc->format, planes[1], strides[1],
+		MIN(source_desc->width, dest_desc->width),
+		MIN(source_desc->height, dest_desc->height)
+	);
+
+finish:
+	for (i = 0; i < num_mapped_dma_buffers; ++i)
+		imx_dma_buffer_unmap(mapped_dma_buffers[i]);
+
+	return ret;
+}
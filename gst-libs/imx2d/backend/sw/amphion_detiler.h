@@ -0,0 +1,124 @@
+#ifndef IMX2D_BACKEND_SW_AMPHION_DETILER_H
+#define IMX2D_BACKEND_SW_AMPHION_DETILER_H
+
+#include <imx2d/imx2d.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Imx2dSwAmphionDetiler:
+ *
+ * CPU based converter from the Amphion 8x128 tiled formats
+ * (@IMX_2D_PIXEL_FORMAT_TILED_NV12_AMPHION_8x128 and its NV21
+ * and 10-bit variants) to linear NV12 / NV21 frames.
+ *
+ * In these formats, both the Y and the UV plane are subdivided
+ * into tiles that are 8 bytes wide and 128 rows high. The bytes
+ * of a tile are stored contiguously, row by row, and the tiles
+ * are stored in raster order. The 10-bit formats pack 4 samples
+ * into 5 bytes in big endian bit order before the tiling is
+ * applied. The detiler reduces 10-bit samples to 8 bits.
+ *
+ * Frames are split into horizontal bands that are processed in
+ * parallel by a set of worker threads. Within each band, tiles
+ * are read in groups that fill whole cache lines of the linear
+ * destination rows.
+ *
+ * The software blitter uses this detiler internally when blitting
+ * from an Amphion tiled surface to an NV12 or NV21 surface without
+ * scaling, rotation, or blending. It can also be used on its own,
+ * for example by video decoders that only need to detile frames.
+ */
+typedef struct _Imx2dSwAmphionDetiler Imx2dSwAmphionDetiler;
+
+
+/**
+ * imx_2d_backend_sw_amphion_detiler_create:
+ * @num_threads: Number of threads to use for detiling, including
+ *     the thread that calls @imx_2d_backend_sw_amphion_detiler_detile.
+ *     If this is 0, the number of online CPU cores is used.
+ *
+ * Creates a new detiler and starts its worker threads.
+ *
+ * To destroy the created detiler, use @imx_2d_backend_sw_amphion_detiler_destroy.
+ *
+ * Returns: Pointer to a newly created detiler, or NULL in case of failure.
+ */
+Imx2dSwAmphionDetiler* imx_2d_backend_sw_amphion_detiler_create(int num_threads);
+
+/**
+ * imx_2d_backend_sw_amphion_detiler_destroy:
+ * @detiler: Detiler to destroy. Must not be NULL.
+ *
+ * Stops the worker threads of the detiler and frees its resources.
+ */
+void imx_2d_backend_sw_amphion_detiler_destroy(Imx2dSwAmphionDetiler *detiler);
+
+/**
+ * imx_2d_backend_sw_amphion_detiler_get_num_threads:
+ * @detiler: Detiler to query. Must not be NULL.
+ *
+ * Returns: Number of threads the detiler uses, including the calling thread.
+ */
+int imx_2d_backend_sw_amphion_detiler_get_num_threads(Imx2dSwAmphionDetiler *detiler);
+
+/**
+ * imx_2d_backend_sw_amphion_detiler_detile:
+ * @detiler: Detiler to use. Must not be NULL.
+ * @tiled_source: Source surface. Its format must be one of the
+ *     Amphion 8x128 tiled formats. Its plane strides must be
+ *     a multiple of 8, and at least as large as one row of packed
+ *     samples. The DMA buffers of its planes must cover whole
+ *     tile rows (128 rows) at these strides.
+ * @dest: Destination surface. Its format must be either
+ *     @IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV12 or
+ *     @IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV21.
+ *
+ * Detiles the frame in @tiled_source into @dest. If the sizes of
+ * the surfaces differ, only the overlapping top-left area is detiled.
+ * The U and V samples are swapped if the chroma orders of the two
+ * formats differ. This function maps the DMA buffers of both
+ * surfaces, and blocks until the frame is fully detiled.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_backend_sw_amphion_detiler_detile(Imx2dSwAmphionDetiler *detiler, Imx2dSurface *tiled_source, Imx2dSurface *dest);
+
+/**
+ * imx_2d_backend_sw_amphion_detiler_detile_mapped:
+ * @detiler: Detiler to use. Must not be NULL.
+ * @source_format: Amphion 8x128 tiled format of the source planes.
+ * @source_planes: Pointers to the tiled Y and UV planes.
+ * @source_strides: Strides of the tiled Y and UV planes, in bytes.
+ * @dest_format: NV12 or NV21 format of the destination planes.
+ * @dest_planes: Pointers to the first pixel of the linear Y and UV planes.
+ * @dest_strides: Strides of the linear Y and UV planes, in bytes.
+ * @width: Width of the area to detile, in pixels.
+ * @height: Height of the area to detile, in pixels.
+ *
+ * Variant of @imx_2d_backend_sw_amphion_detiler_detile that operates
+ * on already mapped memory. The source planes must start at the
+ * beginning of a tile row. Only the source strides are checked here;
+ * the caller must make sure that the source planes cover whole
+ * tile rows at these strides.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_backend_sw_amphion_detiler_detile_mapped(
+	Imx2dSwAmphionDetiler *detiler,
+	Imx2dPixelFormat source_format, uint8_t const * const *source_planes, int const *source_strides,
+	Imx2dPixelFormat dest_format, uint8_t * const *dest_planes, int const *dest_strides,
+	int width, int height
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* IMX2D_BACKEND_SW_AMPHION_DETILER_H */
@@ -0,0 +1,95 @@
+#ifndef IMX2D_BACKEND_SW_AMPHION_TILING_H
+#define IMX2D_BACKEND_SW_AMPHION_TILING_H
+
+#include <stdint.h>
+#include "imx2d/imx2d_priv.h"
+#include "amphion_detiler.h"
+#include "sw_worker_pool.h"
+
+
+/* Internal addressing helpers and detiler functions for the Amphion 8x128 tiled formats.
+ * See amphion_detiler.h for a description of the layout. */
+
+
+#define AMPHION_TILE_WIDTH 8
+#define AMPHION_TILE_HEIGHT 128
+#define AMPHION_TILE_SIZE (AMPHION_TILE_WIDTH * AMPHION_TILE_HEIGHT)
+
+
+static inline BOOL amphion_format_is_tiled(Imx2dPixelFormat format)
+{
+	switch (format)
+	{
+		case IMX_2D_PIXEL_FORMAT_TILED_NV12_AMPHION_8x128:
+		case IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128:
+		case IMX_2D_PIXEL_FORMAT_TILED_NV12_AMPHION_8x128_10BIT:
+		case IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128_10BIT:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+
+static inline BOOL amphion_format_is_10bit(Imx2dPixelFormat format)
+{
+	return (format == IMX_2D_PIXEL_FORMAT_TILED_NV12_AMPHION_8x128_10BIT)
+	    || (format == IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128_10BIT);
+}
+
+
+/* Returns a pointer to the first byte of row y of the tile row that
+ * contains row y. Byte x of row y is then located at offset
+ * (x / 8) * AMPHION_TILE_SIZE + (x % 8) from that pointer. */
+static inline uint8_t const * amphion_tiled_row(uint8_t const *plane, int stride, int y)
+{
+	return plane + (y / AMPHION_TILE_HEIGHT) * (stride * AMPHION_TILE_HEIGHT) + (y % AMPHION_TILE_HEIGHT) * AMPHION_TILE_WIDTH;
+}
+
+
+static inline uint8_t amphion_tiled_row_byte(uint8_t const *tiled_row, int x)
+{
+	return tiled_row[(x / AMPHION_TILE_WIDTH) * AMPHION_TILE_SIZE + (x % AMPHION_TILE_WIDTH)];
+}
+
+
+/* Returns the 10-bit sample with the given index in a tiled row,
+ * reduced to 8 bits. Samples are packed continuously, with the
+ * most significant bits first. */
+static inline int amphion_tiled_row_10bit_sample(uint8_t const *tiled_row, int sample_index)
+{
+	int bit_offset = sample_index * 10;
+	int byte_offset = bit_offset / 8;
+	int bits = (amphion_tiled_row_byte(tiled_row, byte_offset) << 8) | amphion_tiled_row_byte(tiled_row, byte_offset + 1);
+	return ((bits >> (6 - (bit_offset % 8))) & 0x3FF) >> 2;
+}
+
+
+/* Returns the smallest valid stride of a tiled plane whose rows contain
+ * the given number of samples. This is the number of bytes the packed
+ * samples occupy, rounded up to whole tile columns. */
+static inline int amphion_min_plane_stride(Imx2dPixelFormat format, int num_row_samples)
+{
+	int num_row_bytes = amphion_format_is_10bit(format) ? ((num_row_samples * 10 + 7) / 8) : num_row_samples;
+	return (num_row_bytes + AMPHION_TILE_WIDTH - 1) / AMPHION_TILE_WIDTH * AMPHION_TILE_WIDTH;
+}
+
+
+/* Checks that the Y and UV plane strides are multiples of the tile
+ * width and large enough for frames that are width pixels wide. */
+BOOL amphion_check_tiled_strides(Imx2dPixelFormat format, int const *strides, int width);
+
+/* Like amphion_check_tiled_strides(), but also checks that the DMA
+ * buffer of each plane covers whole tile rows at the plane's stride.
+ * Reading from a tiled surface that fails this check would access
+ * memory past the end of its DMA buffers. */
+BOOL amphion_check_tiled_surface(Imx2dSurface *surface);
+
+
+/* Creates a detiler that uses an existing worker pool instead of
+ * creating its own. The pool must outlive the detiler. This allows
+ * the software blitter to share its pool with its detiler. */
+Imx2dSwAmphionDetiler* amphion_detiler_create_with_worker_pool(SwWorkerPool *worker_pool);
+
+
+#endif /* IMX2D_BACKEND_SW_AMPHION_TILING_H */
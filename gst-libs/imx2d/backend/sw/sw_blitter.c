@@ -0,0 +1,1664 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <inttypes.h>
+
+#include <config.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMX2D_SW_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define IMX2D_SW_USE_SSE2
+#endif
+
+#include "imx2d/imx2d_priv.h"
+#include "amphion_tiling.h"
+#include "amphion_detiler.h"
+#include "sw_worker_pool.h"
+#include "sw_blitter.h"
+
+
+static Imx2dPixelFormat const supported_source_pixel_formats[] =
+{
+	IMX_2D_PIXEL_FORMAT_RGB565,
+	IMX_2D_PIXEL_FORMAT_BGR565,
+	IMX_2D_PIXEL_FORMAT_RGB888,
+	IMX_2D_PIXEL_FORMAT_BGR888,
+	IMX_2D_PIXEL_FORMAT_RGBX8888,
+	IMX_2D_PIXEL_FORMAT_RGBA8888,
+	IMX_2D_PIXEL_FORMAT_BGRX8888,
+	IMX_2D_PIXEL_FORMAT_BGRA8888,
+	IMX_2D_PIXEL_FORMAT_XRGB8888,
+	IMX_2D_PIXEL_FORMAT_ARGB8888,
+	IMX_2D_PIXEL_FORMAT_XBGR8888,
+	IMX_2D_PIXEL_FORMAT_ABGR8888,
+	IMX_2D_PIXEL_FORMAT_GRAY8,
+
+	IMX_2D_PIXEL_FORMAT_PACKED_YUV422_UYVY,
+	IMX_2D_PIXEL_FORMAT_PACKED_YUV422_YUYV,
+	IMX_2D_PIXEL_FORMAT_PACKED_YUV422_YVYU,
+	IMX_2D_PIXEL_FORMAT_PACKED_YUV422_VYUY,
+	IMX_2D_PIXEL_FORMAT_PACKED_YUV444,
+
+	IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV12,
+	IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV21,
+	IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV16,
+	IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV61,
+
+	IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_YV12,
+	IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_I420,
+	IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_Y42B,
+	IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_Y444,
+
+	IMX_2D_PIXEL_FORMAT_TILED_NV12_AMPHION_8x128,
+	IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128,
+	IMX_2D_PIXEL_FORMAT_TILED_NV12_AMPHION_8x128_10BIT,
+	IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128_10BIT
+};
+
+
+/* The Amphion tiled formats are only supported as source formats. */
+static Imx2dPixelFormat const supported_dest_pixel_formats[] =
+{
+	IMX_2D_PIXEL_FORMAT_RGB565,
+	IMX_2D_PIXEL_FORMAT_BGR565,
+	IMX_2D_PIXEL_FORMAT_RGB888,
+	IMX_2D_PIXEL_FORMAT_BGR888,
+	IMX_2D_PIXEL_FORMAT_RGBX8888,
+	IMX_2D_PIXEL_FORMAT_RGBA8888,
+	IMX_2D_PIXEL_FORMAT_BGRX8888,
+	IMX_2D_PIXEL_FORMAT_BGRA8888,
+	IMX_2D_PIXEL_FORMAT_XRGB8888,
+	IMX_2D_PIXEL_FORMAT_ARGB8888,
+	IMX_2D_PIXEL_FORMAT_XBGR8888,
+	IMX_2D_PIXEL_FORMAT_ABGR8888,
+	IMX_2D_PIXEL_FORMAT_GRAY8,
+
+	IMX_2D_PIXEL_FORMAT_PACKED_YUV422_UYVY,
+	IMX_2D_PIXEL_FORMAT_PACKED_YUV422_YUYV,
+	IMX_2D_PIXEL_FORMAT_PACKED_YUV422_YVYU,
+	IMX_2D_PIXEL_FORMAT_PACKED_YUV422_VYUY,
+	IMX_2D_PIXEL_FORMAT_PACKED_YUV444,
+
+	IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV12,
+	IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV21,
+	IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV16,
+	IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV61,
+
+	IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_YV12,
+	IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_I420,
+	IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_Y42B,
+	IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_Y444
+};
+
+
+
+
+/* Pixel layouts and format conversion */
+
+
+/* Internally, the software blitter converts pixels to and from
+ * 32-bit ARGB values in native endianness (0xAARRGGBB). Source
+ * pixels are fetched into a span of such values, the span is
+ * optionally blended with the existing destination pixels,
+ * and then stored in the destination format. */
+
+
+typedef enum
+{
+	SW_LAYOUT_RGB32,
+	SW_LAYOUT_RGB24,
+	SW_LAYOUT_RGB16,
+	SW_LAYOUT_GRAY8,
+	SW_LAYOUT_PACKED_YUV422,
+	SW_LAYOUT_PACKED_YUV444,
+	SW_LAYOUT_SEMI_PLANAR_YUV,
+	SW_LAYOUT_PLANAR_YUV,
+	SW_LAYOUT_TILED_AMPHION,
+	SW_LAYOUT_TILED_AMPHION_10BIT
+}
+SwLayoutType;
+
+
+typedef struct
+{
+	SwLayoutType type;
+	/* RGB32 / RGB24: Byte offsets of the channels within a pixel.
+	 * RGB16: Bit shifts of the 5-bit red and blue fields.
+	 * a_ofs is -1 if the format has no alpha channel. */
+	int r_ofs, g_ofs, b_ofs, a_ofs;
+	/* Packed YUV: Byte offsets within a (macro)pixel.
+	 * Semi planar and Amphion tiled: u_ofs and v_ofs are byte (or,
+	 * with 10-bit formats, sample) offsets within the interleaved
+	 * chroma plane. Planar: u_ofs and v_ofs are the
+	 * indices of the chroma planes. */
+	int y_ofs, u_ofs, v_ofs;
+	/* log2 of the horizontal and vertical chroma subsampling factors. */
+	int chroma_x_shift, chroma_y_shift;
+}
+SwFormatLayout;
+
+
+static SwFormatLayout const * get_sw_format_layout(Imx2dPixelFormat format)
+{
+#define SW_LAYOUT_DESC(FMT, TYPE, R, G, B, A, Y, U, V, CXS, CYS) \
+	case (IMX_2D_PIXEL_FORMAT_##FMT): \
+	{ \
+		static SwFormatLayout const layout = { \
+			(SW_LAYOUT_##TYPE), (R), (G), (B), (A), (Y), (U), (V), (CXS), (CYS) \
+		}; \
+		return &layout; \
+	}
+
+	switch (format)
+	{
+		SW_LAYOUT_DESC(RGB565,   RGB16, 11, 5, 0,  -1, 0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(BGR565,   RGB16, 0,  5, 11, -1, 0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(RGB888,   RGB24, 0,  1, 2,  -1, 0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(BGR888,   RGB24, 2,  1, 0,  -1, 0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(RGBX8888, RGB32, 0,  1, 2,  -1, 0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(RGBA8888, RGB32, 0,  1, 2,  3,  0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(BGRX8888, RGB32, 2,  1, 0,  -1, 0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(BGRA8888, RGB32, 2,  1, 0,  3,  0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(XRGB8888, RGB32, 1,  2, 3,  -1, 0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(ARGB8888, RGB32, 1,  2, 3,  0,  0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(XBGR8888, RGB32, 3,  2, 1,  -1, 0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(ABGR8888, RGB32, 3,  2, 1,  0,  0, 0, 0, 0, 0)
+		SW_LAYOUT_DESC(GRAY8,    GRAY8, 0,  0, 0,  -1, 0, 0, 0, 0, 0)
+
+		SW_LAYOUT_DESC(PACKED_YUV422_UYVY, PACKED_YUV422, 0, 0, 0, -1, 1, 0, 2, 1, 0)
+		SW_LAYOUT_DESC(PACKED_YUV422_YUYV, PACKED_YUV422, 0, 0, 0, -1, 0, 1, 3, 1, 0)
+		SW_LAYOUT_DESC(PACKED_YUV422_YVYU, PACKED_YUV422, 0, 0, 0, -1, 0, 3, 1, 1, 0)
+		SW_LAYOUT_DESC(PACKED_YUV422_VYUY, PACKED_YUV422, 0, 0, 0, -1, 1, 2, 0, 1, 0)
+		SW_LAYOUT_DESC(PACKED_YUV444,      PACKED_YUV444, 0, 0, 0, -1, 0, 1, 2, 0, 0)
+
+		SW_LAYOUT_DESC(SEMI_PLANAR_NV12, SEMI_PLANAR_YUV, 0, 0, 0, -1, 0, 0, 1, 1, 1)
+		SW_LAYOUT_DESC(SEMI_PLANAR_NV21, SEMI_PLANAR_YUV, 0, 0, 0, -1, 0, 1, 0, 1, 1)
+		SW_LAYOUT_DESC(SEMI_PLANAR_NV16, SEMI_PLANAR_YUV, 0, 0, 0, -1, 0, 0, 1, 1, 0)
+		SW_LAYOUT_DESC(SEMI_PLANAR_NV61, SEMI_PLANAR_YUV, 0, 0, 0, -1, 0, 1, 0, 1, 0)
+
+		SW_LAYOUT_DESC(FULLY_PLANAR_YV12, PLANAR_YUV, 0, 0, 0, -1, 0, 2, 1, 1, 1)
+		SW_LAYOUT_DESC(FULLY_PLANAR_I420, PLANAR_YUV, 0, 0, 0, -1, 0, 1, 2, 1, 1)
+		SW_LAYOUT_DESC(FULLY_PLANAR_Y42B, PLANAR_YUV, 0, 0, 0, -1, 0, 1, 2, 1, 0)
+		SW_LAYOUT_DESC(FULLY_PLANAR_Y444, PLANAR_YUV, 0, 0, 0, -1, 0, 1, 2, 0, 0)
+
+		SW_LAYOUT_DESC(TILED_NV12_AMPHION_8x128,       TILED_AMPHION,       0, 0, 0, -1, 0, 0, 1, 1, 1)
+		SW_LAYOUT_DESC(TILED_NV21_AMPHION_8x128,       TILED_AMPHION,       0, 0, 0, -1, 0, 1, 0, 1, 1)
+		SW_LAYOUT_DESC(TILED_NV12_AMPHION_8x128_10BIT, TILED_AMPHION_10BIT, 0, 0, 0, -1, 0, 0, 1, 1, 1)
+		SW_LAYOUT_DESC(TILED_NV21_AMPHION_8x128_10BIT, TILED_AMPHION_10BIT, 0, 0, 0, -1, 0, 1, 0, 1, 1)
+
+		default: return NULL;
+	}
+
+#undef SW_LAYOUT_DESC
+}
+
+
+#define SW_MAKE_ARGB(A, R, G, B) \
+	((((uint32_t)(A)) << 24) | (((uint32_t)(R)) << 16) | (((uint32_t)(G)) << 8) | ((uint32_t)(B)))
+
+#define SW_ARGB_A(ARGB) (((ARGB) >> 24) & 0xFF)
+#define SW_ARGB_R(ARGB) (((ARGB) >> 16) & 0xFF)
+#define SW_ARGB_G(ARGB) (((ARGB) >>  8) & 0xFF)
+#define SW_ARGB_B(ARGB) (((ARGB) >>  0) & 0xFF)
+
+
+static inline int clamp_to_u8(int value)
+{
+	return (value < 0) ? 0 : ((value > 255) ? 255 : value);
+}
+
+
+/* YUV<->RGB conversion coefficients, in 8.8 fixed point. The YUV->RGB
+ * part consists of the luma offset and scale factor plus the four
+ * nonzero chroma factors. The RGB->YUV part is a 3x3 matrix; the luma
+ * offset is added to Y, and 128 is added to U and V. Each U and V row
+ * sums up to zero, so gray RGB values map to neutral chroma. */
+typedef struct
+{
+	int y_offset, y_factor;
+	int v_to_r, u_to_g, v_to_g, u_to_b;
+	int r_to_y, g_to_y, b_to_y;
+	int r_to_u, g_to_u, b_to_u;
+	int r_to_v, g_to_v, b_to_v;
+}
+SwYuvCoefficients;
+
+
+static SwYuvCoefficients const * get_sw_yuv_coefficients(Imx2dColorMatrix matrix, Imx2dColorRange range)
+{
+	static SwYuvCoefficients const coefficients[3][2] = {
+		{
+			/* BT.601 */
+			{ 16, 298, 409, 100, 208, 516,  66, 129, 25,  -38, -74, 112,  112, -94, -18 },
+			{ 0, 256, 359, 88, 183, 454,  77, 150, 29,  -43, -85, 128,  128, -107, -21 }
+		},
+		{
+			/* BT.709 */
+			{ 16, 298, 459, 55, 136, 541,  47, 157, 16,  -26, -87, 113,  112, -102, -10 },
+			{ 0, 256, 403, 48, 120, 475,  54, 184, 18,  -29, -99, 128,  128, -116, -12 }
+		},
+		{
+			/* BT.2020 */
+			{ 16, 298, 430, 48, 167, 548,  58, 149, 13,  -31, -81, 112,  112, -103, -9 },
+			{ 0, 256, 377, 42, 146, 482,  67, 174, 15,  -36, -92, 128,  128, -118, -10 }
+		}
+	};
+	int matrix_index, range_index;
+
+	switch (matrix)
+	{
+		case IMX_2D_COLOR_MATRIX_BT709: matrix_index = 1; break;
+		case IMX_2D_COLOR_MATRIX_BT2020: matrix_index = 2; break;
+		default: matrix_index = 0; break;
+	}
+
+	range_index = (range == IMX_2D_COLOR_RANGE_FULL) ? 1 : 0;
+
+	return &(coefficients[matrix_index][range_index]);
+}
+
+
+static inline uint32_t yuv_to_argb(SwYuvCoefficients const *coeffs, int y, int u, int v)
+{
+	int c = coeffs->y_factor * (y - coeffs->y_offset) + 128;
+	int d = u - 128;
+	int e = v - 128;
+
+	return SW_MAKE_ARGB(
+		0xFF,
+		clamp_to_u8((c + coeffs->v_to_r * e) >> 8),
+		clamp_to_u8((c - coeffs->u_to_g * d - coeffs->v_to_g * e) >> 8),
+		clamp_to_u8((c + coeffs->u_to_b * d) >> 8)
+	);
+}
+
+
+static inline int argb_to_y(SwYuvCoefficients const *coeffs, uint32_t argb)
+{
+	return ((coeffs->r_to_y * (int)SW_ARGB_R(argb) + coeffs->g_to_y * (int)SW_ARGB_G(argb) + coeffs->b_to_y * (int)SW_ARGB_B(argb) + 128) >> 8) + coeffs->y_offset;
+}
+
+
+static inline void argb_to_uv(SwYuvCoefficients const *coeffs, uint32_t argb, int *u, int *v)
+{
+	int r = SW_ARGB_R(argb);
+	int g = SW_ARGB_G(argb);
+	int b = SW_ARGB_B(argb);
+
+	*u = clamp_to_u8(((coeffs->r_to_u * r + coeffs->g_to_u * g + coeffs->b_to_u * b + 128) >> 8) + 128);
+	*v = clamp_to_u8(((coeffs->r_to_v * r + coeffs->g_to_v * g + coeffs->b_to_v * b + 128) >> 8) + 128);
+}
+
+
+/* Per-channel average of two ARGB values (rounding down). */
+static inline uint32_t average_argb(uint32_t first, uint32_t second)
+{
+	return (first & second) + (((first ^ second) >> 1) & 0x7F7F7F7F);
+}
+
+
+static inline int argb_to_gray(uint32_t argb)
+{
+	return (77 * (int)SW_ARGB_R(argb) + 150 * (int)SW_ARGB_G(argb) + 29 * (int)SW_ARGB_B(argb)) >> 8;
+}
+
+
+
+
+/* Surface mapping */
+
+
+typedef struct
+{
+	SwFormatLayout const *layout;
+	/* NULL if the surface's format is not a YUV format. */
+	SwYuvCoefficients const *yuv_coeffs;
+	ImxDmaBuffer *mapped_dma_buffers[3];
+	uint8_t *mapped_virtual_addresses[3];
+	int num_mapped_dma_buffers;
+	uint8_t *planes[3];
+	int strides[3];
+}
+SwMappedSurface;
+
+
+static void unmap_surface(SwMappedSurface *mapped_surface)
+{
+	int i;
+
+	for (i = 0; i < mapped_surface->num_mapped_dma_buffers; ++i)
+		imx_dma_buffer_unmap(mapped_surface->mapped_dma_buffers[i]);
+
+	mapped_surface->num_mapped_dma_buffers = 0;
+}
+
+
+static BOOL map_surface(Imx2dSurface *surface, unsigned int flags, SwMappedSurface *mapped_surface)
+{
+	int plane_nr, i, num_planes;
+	Imx2dSurfaceDesc const *desc;
+
+	assert(surface != NULL);
+	assert(mapped_surface != NULL);
+
+	memset(mapped_surface, 0, sizeof(SwMappedSurface));
+
+	desc = imx_2d_surface_get_desc(surface);
+
+	mapped_surface->layout = get_sw_format_layout(desc->format);
+	if (mapped_surface->layout == NULL)
+	{
+		IMX_2D_LOG(ERROR, "software blitter does not support format %s", imx_2d_pixel_format_to_string(desc->format));
+		return FALSE;
+	}
+
+	switch (mapped_surface->layout->type)
+	{
+		case SW_LAYOUT_RGB32:
+		case SW_LAYOUT_RGB24:
+		case SW_LAYOUT_RGB16:
+		case SW_LAYOUT_GRAY8:
+			break;
+
+		default:
+			mapped_surface->yuv_coeffs = get_sw_yuv_coefficients(desc->color_matrix, desc->color_range);
+	}
+
+	num_planes = imx_2d_get_pixel_format_info(desc->format)->num_planes;
+
+	for (plane_nr = 0; plane_nr < num_planes; ++plane_nr)
+	{
+		ImxDmaBuffer *dma_buffer = imx_2d_surface_get_dma_buffer(surface, plane_nr);
+		uint8_t *virtual_address = NULL;
+
+		assert(dma_buffer != NULL);
+
+		/* Planes frequently share the same DMA buffer. Map
+		 * each distinct DMA buffer only once. */
+		for (i = 0; i < mapped_surface->num_mapped_dma_buffers; ++i)
+		{
+			if (mapped_surface->mapped_dma_buffers[i] == dma_buffer)
+			{
+				virtual_address = mapped_surface->mapped_virtual_addresses[i];
+				break;
+			}
+		}
+
+		if (virtual_address == NULL)
+		{
+			int error = 0;
+
+			virtual_address = imx_dma_buffer_map(dma_buffer, flags, &error);
+			if (virtual_address == NULL)
+			{
+				IMX_2D_LOG(ERROR, "could not map DMA buffer of plane #%d: %s (%d)", plane_nr, strerror(error), error);
+				unmap_surface(mapped_surface);
+				return FALSE;
+			}
+
+			i = mapped_surface->num_mapped_dma_buffers++;
+			mapped_surface->mapped_dma_buffers[i] = dma_buffer;
+			mapped_surface->mapped_virtual_addresses[i] = virtual_address;
+		}
+
+		mapped_surface->planes[plane_nr] = virtual_address + imx_2d_surface_get_dma_buffer_offset(surface, plane_nr);
+		mapped_surface->strides[plane_nr] = desc->plane_strides[plane_nr];
+	}
+
+	return TRUE;
+}
+
+
+
+
+/* Span operations */
+
+
+static inline uint32_t fetch_pixel(SwMappedSurface const *mapped_surface, int x, int y)
+{
+	SwFormatLayout const *layout = mapped_surface->layout;
+
+	switch (layout->type)
+	{
+		case SW_LAYOUT_RGB32:
+		{
+			uint8_t const *p = mapped_surface->planes[0] + y * mapped_surface->strides[0] + x * 4;
+			return SW_MAKE_ARGB((layout->a_ofs >= 0) ? p[layout->a_ofs] : 0xFF, p[layout->r_ofs], p[layout->g_ofs], p[layout->b_ofs]);
+		}
+
+		case SW_LAYOUT_RGB24:
+		{
+			uint8_t const *p = mapped_surface->planes[0] + y * mapped_surface->strides[0] + x * 3;
+			return SW_MAKE_ARGB(0xFF, p[layout->r_ofs], p[layout->g_ofs], p[layout->b_ofs]);
+		}
+
+		case SW_LAYOUT_RGB16:
+		{
+			uint16_t p = *((uint16_t const *)(mapped_surface->planes[0] + y * mapped_surface->strides[0] + x * 2));
+			int r = (p >> layout->r_ofs) & 0x1F;
+			int g = (p >> layout->g_ofs) & 0x3F;
+			int b = (p >> layout->b_ofs) & 0x1F;
+			return SW_MAKE_ARGB(0xFF, (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+		}
+
+		case SW_LAYOUT_GRAY8:
+		{
+			int l = mapped_surface->planes[0][y * mapped_surface->strides[0] + x];
+			return SW_MAKE_ARGB(0xFF, l, l, l);
+		}
+
+		case SW_LAYOUT_PACKED_YUV422:
+		{
+			uint8_t const *p = mapped_surface->planes[0] + y * mapped_surface->strides[0] + (x >> 1) * 4;
+			return yuv_to_argb(mapped_surface->yuv_coeffs, p[layout->y_ofs + (x & 1) * 2], p[layout->u_ofs], p[layout->v_ofs]);
+		}
+
+		case SW_LAYOUT_PACKED_YUV444:
+		{
+			uint8_t const *p = mapped_surface->planes[0] + y * mapped_surface->strides[0] + x * 3;
+			return yuv_to_argb(mapped_surface->yuv_coeffs, p[layout->y_ofs], p[layout->u_ofs], p[layout->v_ofs]);
+		}
+
+		case SW_LAYOUT_SEMI_PLANAR_YUV:
+		{
+			uint8_t const *c = mapped_surface->planes[1]
+			                 + (y >> layout->chroma_y_shift) * mapped_surface->strides[1]
+			                 + (x >> layout->chroma_x_shift) * 2;
+			return yuv_to_argb(mapped_surface->yuv_coeffs, mapped_surface->planes[0][y * mapped_surface->strides[0] + x], c[layout->u_ofs], c[layout->v_ofs]);
+		}
+
+		case SW_LAYOUT_PLANAR_YUV:
+		{
+			int cx = x >> layout->chroma_x_shift;
+			int cy = y >> layout->chroma_y_shift;
+			return yuv_to_argb(
+				mapped_surface->yuv_coeffs,
+				mapped_surface->planes[0][y * mapped_surface->strides[0] + x],
+				mapped_surface->planes[layout->u_ofs][cy * mapped_surface->strides[layout->u_ofs] + cx],
+				mapped_surface->planes[layout->v_ofs][cy * mapped_surface->strides[layout->v_ofs] + cx]
+			);
+		}
+
+		/* Tiled formats are only read through this per-pixel path
+		 * if the blit scales, rotates, blends, or converts to a
+		 * format other than NV12/NV21. Otherwise, the detiler is used. */
+		case SW_LAYOUT_TILED_AMPHION:
+		{
+			uint8_t const *luma_row = amphion_tiled_row(mapped_surface->planes[0], mapped_surface->strides[0], y);
+			uint8_t const *chroma_row = amphion_tiled_row(mapped_surface->planes[1], mapped_surface->strides[1], y >> 1);
+			int cx = (x >> 1) * 2;
+			return yuv_to_argb(
+				mapped_surface->yuv_coeffs,
+				amphion_tiled_row_byte(luma_row, x),
+				amphion_tiled_row_byte(chroma_row, cx + layout->u_ofs),
+				amphion_tiled_row_byte(chroma_row, cx + layout->v_ofs)
+			);
+		}
+
+		case SW_LAYOUT_TILED_AMPHION_10BIT:
+		{
+			uint8_t const *luma_row = amphion_tiled_row(mapped_surface->planes[0], mapped_surface->strides[0], y);
+			uint8_t const *chroma_row = amphion_tiled_row(mapped_surface->planes[1], mapped_surface->strides[1], y >> 1);
+			int cx = (x >> 1) * 2;
+			return yuv_to_argb(
+				mapped_surface->yuv_coeffs,
+				amphion_tiled_row_10bit_sample(luma_row, x),
+				amphion_tiled_row_10bit_sample(chroma_row, cx + layout->u_ofs),
+				amphion_tiled_row_10bit_sample(chroma_row, cx + layout->v_ofs)
+			);
+		}
+
+		default:
+			assert(FALSE);
+			return 0;
+	}
+}
+
+
+/* Fetches source pixels into span. If transposed is FALSE, the
+ * pixels are taken from row fixed_coord at the X coordinates in
+ * coords. Otherwise, they are taken from column fixed_coord at
+ * the Y coordinates in coords. */
+static void fetch_span(SwMappedSurface const *mapped_surface, int const *coords, int fixed_coord, BOOL transposed, int num_pixels, uint32_t *span)
+{
+	int i;
+
+	if (transposed)
+	{
+		for (i = 0; i < num_pixels; ++i)
+			span[i] = fetch_pixel(mapped_surface, fixed_coord, coords[i]);
+	}
+	else
+	{
+		for (i = 0; i < num_pixels; ++i)
+			span[i] = fetch_pixel(mapped_surface, coords[i], fixed_coord);
+	}
+}
+
+
+static void load_span(SwMappedSurface const *mapped_surface, int x, int y, int num_pixels, uint32_t *span)
+{
+	int i;
+
+	for (i = 0; i < num_pixels; ++i)
+		span[i] = fetch_pixel(mapped_surface, x + i, y);
+}
+
+
+/* Computes the chroma of the pixel at span index i. If the chroma
+ * is horizontally subsampled and the next pixel shares the same
+ * chroma sample, the two pixels are averaged. */
+static inline void span_chroma(SwYuvCoefficients const *coeffs, uint32_t const *span, int i, int num_pixels, int x, int chroma_x_shift, int *u, int *v)
+{
+	uint32_t argb = span[i];
+
+	if ((chroma_x_shift > 0) && ((i + 1) < num_pixels) && (((x + i + 1) >> chroma_x_shift) == ((x + i) >> chroma_x_shift)))
+		argb = average_argb(argb, span[i + 1]);
+
+	argb_to_uv(coeffs, argb, u, v);
+}
+
+
+/* Stores span pixels into row y, starting at column x. With vertically
+ * subsampled chroma, write_chroma is used to decide whether or not
+ * the chroma samples of this row shall be written. */
+static void store_span(SwMappedSurface *mapped_surface, int x, int y, int num_pixels, uint32_t const *span, BOOL write_chroma)
+{
+	SwFormatLayout const *layout = mapped_surface->layout;
+	uint8_t *row = mapped_surface->planes[0] + y * mapped_surface->strides[0];
+	int chroma_x_mask = (1 << layout->chroma_x_shift) - 1;
+	int i;
+
+	switch (layout->type)
+	{
+		case SW_LAYOUT_RGB32:
+		{
+			uint8_t *p = row + x * 4;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+			/* BGRA / BGRX byte order matches the internal
+			 * 0xAARRGGBB representation on little endian
+			 * platforms, so the span can be copied as-is. */
+			if ((layout->b_ofs == 0) && (layout->g_ofs == 1) && (layout->r_ofs == 2))
+			{
+				memcpy(p, span, num_pixels * 4);
+				break;
+			}
+#endif
+
+			for (i = 0; i < num_pixels; ++i, p += 4)
+			{
+				p[layout->r_ofs] = SW_ARGB_R(span[i]);
+				p[layout->g_ofs] = SW_ARGB_G(span[i]);
+				p[layout->b_ofs] = SW_ARGB_B(span[i]);
+				p[(layout->a_ofs >= 0) ? layout->a_ofs : (6 - layout->r_ofs - layout->g_ofs - layout->b_ofs)] = SW_ARGB_A(span[i]);
+			}
+			break;
+		}
+
+		case SW_LAYOUT_RGB24:
+		{
+			uint8_t *p = row + x * 3;
+			for (i = 0; i < num_pixels; ++i, p += 3)
+			{
+				p[layout->r_ofs] = SW_ARGB_R(span[i]);
+				p[layout->g_ofs] = SW_ARGB_G(span[i]);
+				p[layout->b_ofs] = SW_ARGB_B(span[i]);
+			}
+			break;
+		}
+
+		case SW_LAYOUT_RGB16:
+		{
+			uint16_t *p = ((uint16_t *)row) + x;
+			for (i = 0; i < num_pixels; ++i)
+			{
+				p[i] = ((SW_ARGB_R(span[i]) >> 3) << layout->r_ofs)
+				     | ((SW_ARGB_G(span[i]) >> 2) << layout->g_ofs)
+				     | ((SW_ARGB_B(span[i]) >> 3) << layout->b_ofs);
+			}
+			break;
+		}
+
+		case SW_LAYOUT_GRAY8:
+		{
+			for (i = 0; i < num_pixels; ++i)
+				row[x + i] = argb_to_gray(span[i]);
+			break;
+		}
+
+		case SW_LAYOUT_PACKED_YUV422:
+		{
+			for (i = 0; i < num_pixels; ++i)
+			{
+				int px = x + i;
+				uint8_t *p = row + (px >> 1) * 4;
+
+				p[layout->y_ofs + (px & 1) * 2] = argb_to_y(mapped_surface->yuv_coeffs, span[i]);
+
+				if (((px & 1) == 0) || (i == 0))
+				{
+					int u, v;
+					span_chroma(mapped_surface->yuv_coeffs, span, i, num_pixels, x, 1, &u, &v);
+					p[layout->u_ofs] = u;
+					p[layout->v_ofs] = v;
+				}
+			}
+			break;
+		}
+
+		case SW_LAYOUT_PACKED_YUV444:
+		{
+			uint8_t *p = row + x * 3;
+			for (i = 0; i < num_pixels; ++i, p += 3)
+			{
+				int u, v;
+				argb_to_uv(mapped_surface->yuv_coeffs, span[i], &u, &v);
+				p[layout->y_ofs] = argb_to_y(mapped_surface->yuv_coeffs, span[i]);
+				p[layout->u_ofs] = u;
+				p[layout->v_ofs] = v;
+			}
+			break;
+		}
+
+		case SW_LAYOUT_SEMI_PLANAR_YUV:
+		case SW_LAYOUT_PLANAR_YUV:
+		{
+			for (i = 0; i < num_pixels; ++i)
+				row[x + i] = argb_to_y(mapped_surface->yuv_coeffs, span[i]);
+
+			if (!write_chroma)
+				break;
+
+			for (i = 0; i < num_pixels; ++i)
+			{
+				int px = x + i;
+				int cx = px >> layout->chroma_x_shift;
+				int cy = y >> layout->chroma_y_shift;
+				int u, v;
+
+				if (((px & chroma_x_mask) != 0) && (i != 0))
+					continue;
+
+				span_chroma(mapped_surface->yuv_coeffs, span, i, num_pixels, x, layout->chroma_x_shift, &u, &v);
+
+				if (layout->type == SW_LAYOUT_SEMI_PLANAR_YUV)
+				{
+					uint8_t *c = mapped_surface->planes[1] + cy * mapped_surface->strides[1] + cx * 2;
+					c[layout->u_ofs] = u;
+					c[layout->v_ofs] = v;
+				}
+				else
+				{
+					mapped_surface->planes[layout->u_ofs][cy * mapped_surface->strides[layout->u_ofs] + cx] = u;
+					mapped_surface->planes[layout->v_ofs][cy * mapped_surface->strides[layout->v_ofs] + cx] = v;
+				}
+			}
+			break;
+		}
+
+		default:
+			assert(FALSE);
+	}
+}
+
+
+static inline uint32_t blend_pixel(uint32_t dest, uint32_t src, int global_alpha)
+{
+	int sa = (SW_ARGB_A(src) * global_alpha + 127) / 255;
+	int ia = 255 - sa;
+
+	return SW_MAKE_ARGB(
+		(255 * sa + SW_ARGB_A(dest) * ia + 127) / 255,
+		(SW_ARGB_R(src) * sa + SW_ARGB_R(dest) * ia + 127) / 255,
+		(SW_ARGB_G(src) * sa + SW_ARGB_G(dest) * ia + 127) / 255,
+		(SW_ARGB_B(src) * sa + SW_ARGB_B(dest) * ia + 127) / 255
+	);
+}
+
+
+/* Blends src over dest ("source over" operator). The source pixel
+ * alpha values are modulated with global_alpha. The result is
+ * written into dest. */
+static void blend_span(uint32_t *dest, uint32_t const *src, int num_pixels, int global_alpha)
+{
+	int i = 0;
+
+#if defined(IMX2D_SW_USE_NEON)
+	uint8x8_t galpha = vdup_n_u8(global_alpha);
+	uint8x8_t full = vdup_n_u8(255);
+
+	for (; (i + 8) <= num_pixels; i += 8)
+	{
+		/* vld4 deinterleaves the native endian 0xAARRGGBB values
+		 * into B, G, R, A lanes (in that order). */
+		uint8x8x4_t s = vld4_u8((uint8_t const *)(src + i));
+		uint8x8x4_t d = vld4_u8((uint8_t const *)(dest + i));
+		uint16x8_t tmp;
+		uint8x8_t sa, ia;
+		int c;
+
+		tmp = vmull_u8(s.val[3], galpha);
+		sa = vraddhn_u16(tmp, vrshrq_n_u16(tmp, 8));
+		ia = vsub_u8(full, sa);
+
+		for (c = 0; c < 3; ++c)
+		{
+			tmp = vmull_u8(s.val[c], sa);
+			tmp = vmlal_u8(tmp, d.val[c], ia);
+			d.val[c] = vraddhn_u16(tmp, vrshrq_n_u16(tmp, 8));
+		}
+
+		tmp = vmull_u8(full, sa);
+		tmp = vmlal_u8(tmp, d.val[3], ia);
+		d.val[3] = vraddhn_u16(tmp, vrshrq_n_u16(tmp, 8));
+
+		vst4_u8((uint8_t *)(dest + i), d);
+	}
+#elif defined(IMX2D_SW_USE_SSE2)
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const bias = _mm_set1_epi16(128);
+	__m128i const full = _mm_set1_epi16(255);
+	__m128i const galpha = _mm_set1_epi16(global_alpha);
+	/* Sets the alpha lanes of the unpacked source pixels to 255, so
+	 * that the alpha lane of the result is sa*255 + da*(255-sa). */
+	__m128i const alpha_lanes = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+
+/* Approximates x/255 with (x + 128 + ((x + 128) >> 8)) >> 8, which
+ * is exact for all products of two 8-bit values. */
+#define SW_SSE2_DIV255(X) \
+	_mm_srli_epi16(_mm_add_epi16(_mm_add_epi16((X), bias), _mm_srli_epi16(_mm_add_epi16((X), bias), 8)), 8)
+
+	for (; (i + 4) <= num_pixels; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((__m128i const *)(src + i));
+		__m128i d = _mm_loadu_si128((__m128i const *)(dest + i));
+		__m128i halves[2];
+		int h;
+
+		for (h = 0; h < 2; ++h)
+		{
+			__m128i sh = (h == 0) ? _mm_unpacklo_epi8(s, zero) : _mm_unpackhi_epi8(s, zero);
+			__m128i dh = (h == 0) ? _mm_unpacklo_epi8(d, zero) : _mm_unpackhi_epi8(d, zero);
+			__m128i sa, ia;
+
+			sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sh, 0xFF), 0xFF);
+			sa = _mm_mullo_epi16(sa, galpha);
+			sa = SW_SSE2_DIV255(sa);
+			ia = _mm_sub_epi16(full, sa);
+
+			sh = _mm_or_si128(_mm_andnot_si128(alpha_lanes, sh), alpha_lanes);
+			halves[h] = _mm_add_epi16(_mm_mullo_epi16(sh, sa), _mm_mullo_epi16(dh, ia));
+			halves[h] = SW_SSE2_DIV255(halves[h]);
+		}
+
+		_mm_storeu_si128((__m128i *)(dest + i), _mm_packus_epi16(halves[0], halves[1]));
+	}
+
+#undef SW_SSE2_DIV255
+#endif
+
+	for (; i < num_pixels; ++i)
+		dest[i] = blend_pixel(dest[i], src[i], global_alpha);
+}
+
+
+/* Computes the source coordinates for nearest neighbor scaling.
+ * Each destination pixel center is mapped to the source pixel
+ * whose area contains the projected center. */
+static void compute_sampling_coords(int *coords, int num_dest_coords, int source_start, int source_length, BOOL reverse)
+{
+	int i;
+
+	for (i = 0; i < num_dest_coords; ++i)
+	{
+		int c = (int)(((int64_t)(2 * i + 1) * source_length) / (2 * num_dest_coords));
+		coords[i] = source_start + (reverse ? (source_length - 1 - c) : c);
+	}
+}
+
+
+/* Rotations with 90-degree components transpose the blit. In that
+ * case, destination columns sample along the source Y axis, and
+ * destination rows sample along the source X axis. */
+static void get_rotation_sampling(Imx2dRotation rotation, BOOL *transposed, BOOL *reverse_columns, BOOL *reverse_rows)
+{
+	switch (rotation)
+	{
+		case IMX_2D_ROTATION_90:              *transposed = TRUE;  *reverse_columns = TRUE;  *reverse_rows = FALSE; break;
+		case IMX_2D_ROTATION_180:             *transposed = FALSE; *reverse_columns = TRUE;  *reverse_rows = TRUE;  break;
+		case IMX_2D_ROTATION_270:             *transposed = TRUE;  *reverse_columns = FALSE; *reverse_rows = TRUE;  break;
+		case IMX_2D_ROTATION_FLIP_HORIZONTAL: *transposed = FALSE; *reverse_columns = TRUE;  *reverse_rows = FALSE; break;
+		case IMX_2D_ROTATION_FLIP_VERTICAL:   *transposed = FALSE; *reverse_columns = FALSE; *reverse_rows = TRUE;  break;
+		case IMX_2D_ROTATION_UL_LR:           *transposed = TRUE;  *reverse_columns = FALSE; *reverse_rows = FALSE; break;
+		case IMX_2D_ROTATION_UR_LL:           *transposed = TRUE;  *reverse_columns = TRUE;  *reverse_rows = TRUE;  break;
+		default:                              *transposed = FALSE; *reverse_columns = FALSE; *reverse_rows = FALSE;
+	}
+}
+
+
+
+
+typedef struct _Imx2dSwBlitter Imx2dSwBlitter;
+
+
+struct _Imx2dSwBlitter
+{
+	Imx2dBlitter parent;
+
+	SwMappedSurface mapped_dest;
+	BOOL dest_mapped;
+
+	/* Pool of threads that process the bands of blits and fills.
+	 * With 1 thread, everything runs in the calling thread. */
+	SwWorkerPool *worker_pool;
+	int num_threads;
+
+	/* Created on demand by the first blit from an Amphion tiled source.
+	 * It uses the worker pool of the blitter. */
+	Imx2dSwAmphionDetiler *amphion_detiler;
+
+	/* Scratch buffers for sampling coordinates and spans.
+	 * They are grown on demand and reused across blits.
+	 * The coordinates are shared by all threads. The
+	 * span buffers contain one span of scratch_size
+	 * pixels for each thread. */
+	int *column_coords;
+	int *row_coords;
+	uint32_t *source_spans;
+	uint32_t *dest_spans;
+	int scratch_size;
+};
+
+
+/* Bands have at least this many rows. */
+#define SW_MIN_BAND_NUM_ROWS 16
+
+/* Using more bands than threads lets faster threads pick up
+ * more bands. This matters on big.LITTLE SoCs, and when some
+ * cores are busy with other work. */
+#define SW_NUM_BANDS_PER_THREAD 2
+
+/* Operations with fewer pixels are not split into bands, since
+ * waking up the worker threads would take longer than the work. */
+#define SW_MIN_NUM_PIXELS_FOR_BANDS (128 * 128)
+
+
+/* Describes a blit or a fill that is split into bands. Destination
+ * rows [y1, y2) are processed. Band N covers rows
+ * [band_base_row + N * num_band_rows, band_base_row + (N+1) * num_band_rows),
+ * clipped to [y1, y2). */
+typedef struct
+{
+	Imx2dSwBlitter *sw_blitter;
+
+	int x1, y1, y2;
+	int width;
+	int band_base_row;
+	int num_band_rows;
+
+	/* Blit parameters. */
+	SwMappedSurface const *mapped_source;
+	BOOL transposed;
+	BOOL do_alpha;
+	int global_alpha;
+
+	/* Fill parameters. */
+	uint32_t fill_color;
+}
+SwBandJob;
+
+
+/* Describes fills of several regions whose bands are processed
+ * in one worker pool run. The bands of jobs[i] are the bands
+ * [first_bands[i], first_bands[i + 1]) of the run. */
+typedef struct
+{
+	SwBandJob jobs[IMX_2D_MAX_NUM_FILL_REGIONS_PER_CALL];
+	int first_bands[IMX_2D_MAX_NUM_FILL_REGIONS_PER_CALL + 1];
+	int num_jobs;
+}
+SwMultiFillJob;
+
+
+static void imx_2d_backend_sw_blitter_destroy(Imx2dBlitter *blitter);
+
+static int imx_2d_backend_sw_blitter_start(Imx2dBlitter *blitter);
+static int imx_2d_backend_sw_blitter_finish(Imx2dBlitter *blitter);
+
+static int imx_2d_backend_sw_blitter_do_blit(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params);
+static int imx_2d_backend_sw_blitter_fill_region(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams *internal_fill_region_params);
+
+static Imx2dHardwareCapabilities const * imx_2d_backend_sw_blitter_get_hardware_capabilities(Imx2dBlitter *blitter);
+
+static int imx_2d_backend_sw_blitter_fill_regions(Imx2dBlitter *blitter, Imx2dInternalFillRegionsParams *internal_fill_regions_params);
+
+
+static Imx2dBlitterClass imx_2d_backend_sw_blitter_class =
+{
+	imx_2d_backend_sw_blitter_destroy,
+
+	imx_2d_backend_sw_blitter_start,
+	imx_2d_backend_sw_blitter_finish,
+
+	imx_2d_backend_sw_blitter_do_blit,
+	imx_2d_backend_sw_blitter_fill_region,
+
+	imx_2d_backend_sw_blitter_get_hardware_capabilities,
+
+	NULL,
+	NULL,
+
+	NULL,
+	NULL,
+	NULL,
+
+	imx_2d_backend_sw_blitter_fill_regions,
+
+	"sw"
+};
+
+
+static BOOL ensure_scratch_space(Imx2dSwBlitter *sw_blitter, int size)
+{
+	if (size <= sw_blitter->scratch_size)
+		return TRUE;
+
+	sw_blitter->column_coords = realloc(sw_blitter->column_coords, size * sizeof(int));
+	sw_blitter->row_coords = realloc(sw_blitter->row_coords, size * sizeof(int));
+	sw_blitter->source_spans = realloc(sw_blitter->source_spans, size * sw_blitter->num_threads * sizeof(uint32_t));
+	sw_blitter->dest_spans = realloc(sw_blitter->dest_spans, size * sw_blitter->num_threads * sizeof(uint32_t));
+
+	if ((sw_blitter->column_coords == NULL) || (sw_blitter->row_coords == NULL) || (sw_blitter->source_spans == NULL) || (sw_blitter->dest_spans == NULL))
+	{
+		IMX_2D_LOG(ERROR, "could not allocate scratch space for %d pixels", size);
+		sw_blitter->scratch_size = 0;
+		return FALSE;
+	}
+
+	sw_blitter->scratch_size = size;
+
+	return TRUE;
+}
+
+
+static inline BOOL row_has_chroma(SwFormatLayout const *layout, int y, int first_row)
+{
+	return ((y & ((1 << layout->chroma_y_shift) - 1)) == 0) || (y == first_row);
+}
+
+
+/* Sets up the band layout of the job and returns the number of bands.
+ * Small operations and blitters with only one thread use a single band. */
+static int setup_bands(Imx2dSwBlitter *sw_blitter, SwBandJob *job)
+{
+	int num_rows = job->y2 - job->y1;
+	int num_bands;
+
+	if ((sw_blitter->num_threads == 1) || ((job->width * num_rows) < SW_MIN_NUM_PIXELS_FOR_BANDS))
+	{
+		job->band_base_row = job->y1;
+		job->num_band_rows = num_rows;
+		return 1;
+	}
+
+	num_bands = sw_blitter->num_threads * SW_NUM_BANDS_PER_THREAD;
+	job->num_band_rows = MAX((num_rows + num_bands - 1) / num_bands, SW_MIN_BAND_NUM_ROWS);
+
+	/* Bands must start at even rows. Otherwise, two bands could
+	 * write to the same chroma row of formats with vertically
+	 * subsampled chroma. */
+	job->num_band_rows = (job->num_band_rows + 1) & ~1;
+	job->band_base_row = job->y1 & ~1;
+
+	return (job->y2 - job->band_base_row + job->num_band_rows - 1) / job->num_band_rows;
+}
+
+
+static inline void get_band_rows(SwBandJob const *job, int band, int *first_row, int *end_row)
+{
+	*first_row = MAX(job->y1, job->band_base_row + band * job->num_band_rows);
+	*end_row = MIN(job->y2, job->band_base_row + (band + 1) * job->num_band_rows);
+}
+
+
+static void log_band_timings(Imx2dSwBlitter *sw_blitter, char const *operation)
+{
+	Imx2dSwBandTiming const *timings;
+	int num_bands, band;
+
+	if (imx_2d_cur_log_level_threshold < IMX_2D_LOG_LEVEL_TRACE)
+		return;
+
+	num_bands = sw_worker_pool_get_band_timings(sw_blitter->worker_pool, &timings);
+
+	for (band = 0; band < num_bands; ++band)
+	{
+		IMX_2D_LOG(
+			TRACE,
+			"%s band %d/%d: thread %d start offset %" PRId64 " ns duration %" PRId64 " ns",
+			operation, band + 1, num_bands,
+			timings[band].thread_index, timings[band].start_offset, timings[band].duration
+		);
+	}
+}
+
+
+static void fill_band(void *user_data, int band, int thread_index)
+{
+	SwBandJob const *job = (SwBandJob const *)user_data;
+	Imx2dSwBlitter *sw_blitter = job->sw_blitter;
+	SwMappedSurface *mapped_dest = &(sw_blitter->mapped_dest);
+	uint32_t *source_span = sw_blitter->source_spans + thread_index * sw_blitter->scratch_size;
+	uint32_t *dest_span = sw_blitter->dest_spans + thread_index * sw_blitter->scratch_size;
+	int alpha = SW_ARGB_A(job->fill_color);
+	int first_row, end_row;
+	int i, y;
+
+	get_band_rows(job, band, &first_row, &end_row);
+
+	for (i = 0; i < job->width; ++i)
+		source_span[i] = job->fill_color;
+
+	for (y = first_row; y < end_row; ++y)
+	{
+		BOOL write_chroma = row_has_chroma(mapped_dest->layout, y, job->y1);
+
+		if (alpha == 255)
+		{
+			store_span(mapped_dest, job->x1, y, job->width, source_span, write_chroma);
+		}
+		else
+		{
+			load_span(mapped_dest, job->x1, y, job->width, dest_span);
+			blend_span(dest_span, source_span, job->width, 255);
+			store_span(mapped_dest, job->x1, y, job->width, dest_span, write_chroma);
+		}
+	}
+}
+
+
+/* Fills the region with the given ARGB color. If the color is not
+ * fully opaque, it is blended over the existing pixels. The region
+ * is clipped against the destination surface. */
+static BOOL fill_rect(Imx2dSwBlitter *sw_blitter, Imx2dRegion const *region, uint32_t argb_color)
+{
+	Imx2dBlitter *blitter = (Imx2dBlitter *)sw_blitter;
+	Imx2dRegion clipped_region;
+	SwBandJob job;
+	int num_bands;
+
+	imx_2d_region_intersect(&clipped_region, region, &(blitter->dest->region));
+
+	if ((clipped_region.x2 <= clipped_region.x1) || (clipped_region.y2 <= clipped_region.y1) || (SW_ARGB_A(argb_color) == 0))
+		return TRUE;
+
+	memset(&job, 0, sizeof(job));
+	job.sw_blitter = sw_blitter;
+	job.x1 = clipped_region.x1;
+	job.y1 = clipped_region.y1;
+	job.y2 = clipped_region.y2;
+	job.width = clipped_region.x2 - clipped_region.x1;
+	job.fill_color = argb_color;
+
+	if (!ensure_scratch_space(sw_blitter, job.width))
+		return FALSE;
+
+	num_bands = setup_bands(sw_blitter, &job);
+	if (!sw_worker_pool_run(sw_blitter->worker_pool, num_bands, fill_band, &job))
+		return FALSE;
+
+	log_band_timings(sw_blitter, "fill");
+
+	return TRUE;
+}
+
+
+static void multi_fill_band(void *user_data, int band, int thread_index)
+{
+	SwMultiFillJob *multi_job = (SwMultiFillJob *)user_data;
+	int i = 0;
+
+	while (band >= multi_job->first_bands[i + 1])
+		++i;
+
+	fill_band(&(multi_job->jobs[i]), band - multi_job->first_bands[i], thread_index);
+}
+
+
+/* Fills the regions with the given opaque ARGB color. The bands of
+ * all regions are processed in one worker pool run, so the worker
+ * threads are woken up only once instead of once per region.
+ *
+ * Only opaque colors are supported, since bands of different regions
+ * may run concurrently, and with formats that have vertically subsampled
+ * chroma, adjacent regions can share chroma rows. With opaque colors,
+ * both write the same values into these rows, while blending would
+ * make the result depend on the order of the bands. */
+static BOOL fill_rects(Imx2dSwBlitter *sw_blitter, Imx2dRegion const *regions, int num_regions, uint32_t argb_color)
+{
+	Imx2dBlitter *blitter = (Imx2dBlitter *)sw_blitter;
+	SwMultiFillJob multi_job;
+	int i, num_bands = 0, max_width = 0;
+
+	assert(num_regions <= IMX_2D_MAX_NUM_FILL_REGIONS_PER_CALL);
+	assert(SW_ARGB_A(argb_color) == 255);
+
+	memset(&multi_job, 0, sizeof(multi_job));
+
+	for (i = 0; i < num_regions; ++i)
+	{
+		Imx2dRegion clipped_region;
+		SwBandJob *job = &(multi_job.jobs[multi_job.num_jobs]);
+
+		imx_2d_region_intersect(&clipped_region, &(regions[i]), &(blitter->dest->region));
+		if ((clipped_region.x2 <= clipped_region.x1) || (clipped_region.y2 <= clipped_region.y1))
+			continue;
+
+		job->sw_blitter = sw_blitter;
+		job->x1 = clipped_region.x1;
+		job->y1 = clipped_region.y1;
+		job->y2 = clipped_region.y2;
+		job->width = clipped_region.x2 - clipped_region.x1;
+		job->fill_color = argb_color;
+
+		max_width = MAX(max_width, job->width);
+
+		multi_job.first_bands[multi_job.num_jobs] = num_bands;
+		num_bands += setup_bands(sw_blitter, job);
+		multi_job.num_jobs++;
+	}
+
+	if (multi_job.num_jobs == 0)
+		return TRUE;
+
+	multi_job.first_bands[multi_job.num_jobs] = num_bands;
+
+	if (!ensure_scratch_space(sw_blitter, max_width))
+		return FALSE;
+
+	if (!sw_worker_pool_run(sw_blitter->worker_pool, num_bands, multi_fill_band, &multi_job))
+		return FALSE;
+
+	log_band_timings(sw_blitter, "multi-region fill");
+
+	return TRUE;
+}
+
+
+/* Copies pixels row by row without any conversion. This is possible
+ * if source and destination formats match, no scaling, rotation, or
+ * blending is needed, and the regions are aligned to the chroma
+ * subsampling grid. Returns FALSE if these conditions are not met. */
+static BOOL try_direct_copy(Imx2dSwBlitter *sw_blitter, SwMappedSurface const *mapped_source, Imx2dSurface *source, Imx2dRegion const *source_region, Imx2dRegion const *dest_region, Imx2dRotation rotation)
+{
+	Imx2dBlitter *blitter = (Imx2dBlitter *)sw_blitter;
+	Imx2dPixelFormat format = imx_2d_surface_get_desc(source)->format;
+	Imx2dPixelFormatInfo const *fmt_info;
+	SwFormatLayout const *layout = mapped_source->layout;
+	int width = dest_region->x2 - dest_region->x1;
+	int height = dest_region->y2 - dest_region->y1;
+	int x_mask, y_mask;
+	int plane_nr;
+
+	/* With YUV formats, the source and destination must also use the
+	 * same YUV coefficients, otherwise the samples need converting. */
+	if ((format != imx_2d_surface_get_desc(blitter->dest)->format)
+	 || (mapped_source->yuv_coeffs != sw_blitter->mapped_dest.yuv_coeffs)
+	 || (rotation != IMX_2D_ROTATION_NONE)
+	 || (width != (source_region->x2 - source_region->x1))
+	 || (height != (source_region->y2 - source_region->y1)))
+		return FALSE;
+
+	x_mask = (1 << layout->chroma_x_shift) - 1;
+	y_mask = (1 << layout->chroma_y_shift) - 1;
+	if (((source_region->x1 | dest_region->x1 | width) & x_mask) || ((source_region->y1 | dest_region->y1 | height) & y_mask))
+		return FALSE;
+
+	fmt_info = imx_2d_get_pixel_format_info(format);
+
+	for (plane_nr = 0; plane_nr < fmt_info->num_planes; ++plane_nr)
+	{
+		/* Plane 0 holds all pixels of packed formats and the
+		 * luma samples of (semi-)planar ones. The other planes
+		 * hold chroma samples, which are interleaved pairs
+		 * in semi-planar formats. */
+		int x_shift = (plane_nr == 0) ? 0 : layout->chroma_x_shift;
+		int y_shift = (plane_nr == 0) ? 0 : layout->chroma_y_shift;
+		int bytes_per_sample = (plane_nr == 0) ? fmt_info->pixel_stride : (fmt_info->is_semi_planar ? 2 : 1);
+		int row_length = (width >> x_shift) * bytes_per_sample;
+		int num_rows = height >> y_shift;
+		uint8_t const *src_row = mapped_source->planes[plane_nr]
+		                       + (source_region->y1 >> y_shift) * mapped_source->strides[plane_nr]
+		                       + (source_region->x1 >> x_shift) * bytes_per_sample;
+		uint8_t *dest_row = sw_blitter->mapped_dest.planes[plane_nr]
+		                  + (dest_region->y1 >> y_shift) * sw_blitter->mapped_dest.strides[plane_nr]
+		                  + (dest_region->x1 >> x_shift) * bytes_per_sample;
+		int row;
+
+		for (row = 0; row < num_rows; ++row)
+		{
+			memcpy(dest_row, src_row, row_length);
+			src_row += mapped_source->strides[plane_nr];
+			dest_row += sw_blitter->mapped_dest.strides[plane_nr];
+		}
+	}
+
+	return TRUE;
+}
+
+
+/* Detiles an Amphion tiled source with the multi-threaded detiler.
+ * This is possible if the destination is NV12 or NV21, the whole
+ * source is blitted without scaling or rotation, the source and
+ * destination use the same YUV coefficients, and the destination
+ * region is aligned to the chroma subsampling grid. Returns FALSE
+ * if these conditions are not met. */
+static BOOL try_amphion_detile(Imx2dSwBlitter *sw_blitter, SwMappedSurface const *mapped_source, Imx2dSurface *source, Imx2dRegion const *source_region, Imx2dRegion const *dest_region, Imx2dRotation rotation)
+{
+	Imx2dBlitter *blitter = (Imx2dBlitter *)sw_blitter;
+	Imx2dSurfaceDesc const *source_desc = imx_2d_surface_get_desc(source);
+	Imx2dPixelFormat dest_format = imx_2d_surface_get_desc(blitter->dest)->format;
+	SwMappedSurface *mapped_dest = &(sw_blitter->mapped_dest);
+	int width = dest_region->x2 - dest_region->x1;
+	int height = dest_region->y2 - dest_region->y1;
+	uint8_t *dest_planes[2];
+
+	if (!amphion_format_is_tiled(source_desc->format)
+	 || ((dest_format != IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV12) && (dest_format != IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV21))
+	 || (mapped_source->yuv_coeffs != mapped_dest->yuv_coeffs)
+	 || (rotation != IMX_2D_ROTATION_NONE)
+	 || (source_region->x1 != 0) || (source_region->y1 != 0)
+	 || (width != (source_region->x2 - source_region->x1))
+	 || (height != (source_region->y2 - source_region->y1))
+	 || ((dest_region->x1 | dest_region->y1) & 1))
+		return FALSE;
+
+	if (sw_blitter->amphion_detiler == NULL)
+	{
+		sw_blitter->amphion_detiler = amphion_detiler_create_with_worker_pool(sw_blitter->worker_pool);
+		if (sw_blitter->amphion_detiler == NULL)
+			return FALSE;
+	}
+
+	dest_planes[0] = mapped_dest->planes[0] + dest_region->y1 * mapped_dest->strides[0] + dest_region->x1;
+	dest_planes[1] = mapped_dest->planes[1] + (dest_region->y1 / 2) * mapped_dest->strides[1] + dest_region->x1;
+
+	if (!imx_2d_backend_sw_amphion_detiler_detile_mapped(
+		sw_blitter->amphion_detiler,
+		source_desc->format, (uint8_t const * const *)(mapped_source->planes), mapped_source->strides,
+		dest_format, dest_planes, mapped_dest->strides,
+		width, height
+	))
+		return FALSE;
+
+	log_band_timings(sw_blitter, "detile");
+
+	return TRUE;
+}
+
+
+static void blit_band(void *user_data, int band, int thread_index)
+{
+	SwBandJob const *job = (SwBandJob const *)user_data;
+	Imx2dSwBlitter *sw_blitter = job->sw_blitter;
+	SwMappedSurface *mapped_dest = &(sw_blitter->mapped_dest);
+	uint32_t *source_span = sw_blitter->source_spans + thread_index * sw_blitter->scratch_size;
+	uint32_t *dest_span = sw_blitter->dest_spans + thread_index * sw_blitter->scratch_size;
+	int first_row, end_row;
+	int y;
+
+	get_band_rows(job, band, &first_row, &end_row);
+
+	for (y = first_row; y < end_row; ++y)
+	{
+		BOOL write_chroma = row_has_chroma(mapped_dest->layout, y, job->y1);
+
+		fetch_span(job->mapped_source, sw_blitter->column_coords, sw_blitter->row_coords[y - job->y1], job->transposed, job->width, source_span);
+
+		if (job->do_alpha)
+		{
+			load_span(mapped_dest, job->x1, y, job->width, dest_span);
+			blend_span(dest_span, source_span, job->width, job->global_alpha);
+			store_span(mapped_dest, job->x1, y, job->width, dest_span, write_chroma);
+		}
+		else
+			store_span(mapped_dest, job->x1, y, job->width, source_span, write_chroma);
+	}
+}
+
+
+static void imx_2d_backend_sw_blitter_destroy(Imx2dBlitter *blitter)
+{
+	Imx2dSwBlitter *sw_blitter = (Imx2dSwBlitter *)blitter;
+
+	assert(blitter != NULL);
+
+	if (sw_blitter->dest_mapped)
+		unmap_surface(&(sw_blitter->mapped_dest));
+
+	/* The detiler uses the worker pool, so it must be destroyed first. */
+	if (sw_blitter->amphion_detiler != NULL)
+		imx_2d_backend_sw_amphion_detiler_destroy(sw_blitter->amphion_detiler);
+
+	if (sw_blitter->worker_pool != NULL)
+		sw_worker_pool_destroy(sw_blitter->worker_pool);
+
+	free(sw_blitter->column_coords);
+	free(sw_blitter->row_coords);
+	free(sw_blitter->source_spans);
+	free(sw_blitter->dest_spans);
+
+	free(blitter);
+}
+
+
+static int imx_2d_backend_sw_blitter_start(Imx2dBlitter *blitter)
+{
+	Imx2dSwBlitter *sw_blitter = (Imx2dSwBlitter *)blitter;
+
+	assert(blitter->dest != NULL);
+
+	if (sw_blitter->dest_mapped)
+		return TRUE;
+
+	if (amphion_format_is_tiled(imx_2d_surface_get_desc(blitter->dest)->format))
+	{
+		IMX_2D_LOG(ERROR, "Amphion tiled formats are not supported as destination formats");
+		return FALSE;
+	}
+
+	if (!map_surface(blitter->dest, IMX_DMA_BUFFER_MAPPING_FLAG_READ | IMX_DMA_BUFFER_MAPPING_FLAG_WRITE, &(sw_blitter->mapped_dest)))
+	{
+		IMX_2D_LOG(ERROR, "could not map destination surface");
+		return FALSE;
+	}
+
+	sw_blitter->dest_mapped = TRUE;
+
+	return TRUE;
+}
+
+
+static int imx_2d_backend_sw_blitter_finish(Imx2dBlitter *blitter)
+{
+	Imx2dSwBlitter *sw_blitter = (Imx2dSwBlitter *)blitter;
+
+	if (!sw_blitter->dest_mapped)
+	{
+		IMX_2D_LOG(ERROR, "no sequence was started");
+		return FALSE;
+	}
+
+	/* All operations were already performed synchronously.
+	 * Unmapping the destination syncs the CPU caches. */
+	unmap_surface(&(sw_blitter->mapped_dest));
+	sw_blitter->dest_mapped = FALSE;
+
+	return TRUE;
+}
+
+
+static int imx_2d_backend_sw_blitter_do_blit(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params)
+{
+	Imx2dSwBlitter *sw_blitter = (Imx2dSwBlitter *)blitter;
+	SwMappedSurface mapped_source;
+	Imx2dRegion const *source_region;
+	Imx2dRegion const *dest_region;
+	Imx2dRegion const *expanded_dest_region;
+	BOOL transposed, reverse_columns, reverse_rows;
+	BOOL do_alpha;
+	int source_width, source_height;
+	int dest_width, dest_height;
+	SwBandJob job;
+	int num_bands;
+	BOOL ret = TRUE;
+
+	if (!sw_blitter->dest_mapped)
+	{
+		IMX_2D_LOG(ERROR, "destination surface is not mapped - cannot blit");
+		return FALSE;
+	}
+
+	source_region = (internal_blit_params->source_region != NULL) ? internal_blit_params->source_region : &(internal_blit_params->source->region);
+	dest_region = internal_blit_params->dest_region;
+	expanded_dest_region = (internal_blit_params->expanded_dest_region != NULL) ? internal_blit_params->expanded_dest_region : dest_region;
+
+	IMX_2D_LOG(
+		TRACE,
+		"software blitter: regions: source: %" IMX_2D_REGION_FORMAT " dest: %" IMX_2D_REGION_FORMAT " expanded dest: %" IMX_2D_REGION_FORMAT,
+		IMX_2D_REGION_ARGS(source_region), IMX_2D_REGION_ARGS(dest_region), IMX_2D_REGION_ARGS(expanded_dest_region)
+	);
+
+	/* Draw the margin as up to four rectangles around the dest region. */
+	if (!imx_2d_region_check_if_equal(expanded_dest_region, dest_region))
+	{
+		Imx2dRegion margin_regions[4] =
+		{
+			{ expanded_dest_region->x1, expanded_dest_region->y1, expanded_dest_region->x2, dest_region->y1 },
+			{ expanded_dest_region->x1, dest_region->y2, expanded_dest_region->x2, expanded_dest_region->y2 },
+			{ expanded_dest_region->x1, dest_region->y1, dest_region->x1, dest_region->y2 },
+			{ dest_region->x2, dest_region->y1, expanded_dest_region->x2, dest_region->y2 }
+		};
+		int i;
+
+		if (SW_ARGB_A(internal_blit_params->margin_fill_color) == 255)
+		{
+			if (!fill_rects(sw_blitter, margin_regions, 4, internal_blit_params->margin_fill_color))
+				return FALSE;
+		}
+		else
+		{
+			for (i = 0; i < 4; ++i)
+			{
+				if (!fill_rect(sw_blitter, &(margin_regions[i]), internal_blit_params->margin_fill_color))
+					return FALSE;
+			}
+		}
+	}
+
+	source_width = source_region->x2 - source_region->x1;
+	source_height = source_region->y2 - source_region->y1;
+	dest_width = dest_region->x2 - dest_region->x1;
+	dest_height = dest_region->y2 - dest_region->y1;
+
+	if ((source_width <= 0) || (source_height <= 0) || (dest_width <= 0) || (dest_height <= 0))
+		return TRUE;
+
+	/* fetch_pixel() and the detiler do not check bounds, so reject
+	 * tiled sources whose planes do not cover whole tiles. */
+	if (amphion_format_is_tiled(imx_2d_surface_get_desc(internal_blit_params->source)->format) && !amphion_check_tiled_surface(internal_blit_params->source))
+	{
+		IMX_2D_LOG(ERROR, "cannot blit from tiled source surface with invalid plane layout");
+		return FALSE;
+	}
+
+	if (!map_surface(internal_blit_params->source, IMX_DMA_BUFFER_MAPPING_FLAG_READ, &mapped_source))
+	{
+		IMX_2D_LOG(ERROR, "could not map source surface");
+		return FALSE;
+	}
+
+	/* Sources marked as opaque are copied even if they have an alpha channel. */
+	do_alpha = (internal_blit_params->dest_surface_alpha != 255)
+	        || ((mapped_source.layout->a_ofs >= 0) && !(imx_2d_surface_get_desc(internal_blit_params->source)->is_opaque));
+
+	if (!do_alpha && try_amphion_detile(sw_blitter, &mapped_source, internal_blit_params->source, source_region, dest_region, internal_blit_params->rotation))
+	{
+		IMX_2D_LOG(TRACE, "detiled pixels with the Amphion detiler");
+		goto finish;
+	}
+
+	if (!do_alpha && try_direct_copy(sw_blitter, &mapped_source, internal_blit_params->source, source_region, dest_region, internal_blit_params->rotation))
+	{
+		IMX_2D_LOG(TRACE, "copied pixels directly");
+		goto finish;
+	}
+
+	if (!ensure_scratch_space(sw_blitter, MAX(dest_width, dest_height)))
+	{
+		unmap_surface(&mapped_source);
+		return FALSE;
+	}
+
+	get_rotation_sampling(internal_blit_params->rotation, &transposed, &reverse_columns, &reverse_rows);
+
+	compute_sampling_coords(
+		sw_blitter->column_coords, dest_width,
+		transposed ? source_region->y1 : source_region->x1,
+		transposed ? source_height : source_width,
+		reverse_columns
+	);
+	compute_sampling_coords(
+		sw_blitter->row_coords, dest_height,
+		transposed ? source_region->x1 : source_region->y1,
+		transposed ? source_width : source_height,
+		reverse_rows
+	);
+
+	memset(&job, 0, sizeof(job));
+	job.sw_blitter = sw_blitter;
+	job.x1 = dest_region->x1;
+	job.y1 = dest_region->y1;
+	job.y2 = dest_region->y2;
+	job.width = dest_width;
+	job.mapped_source = &mapped_source;
+	job.transposed = transposed;
+	job.do_alpha = do_alpha;
+	job.global_alpha = internal_blit_params->dest_surface_alpha;
+
+	num_bands = setup_bands(sw_blitter, &job);
+	ret = sw_worker_pool_run(sw_blitter->worker_pool, num_bands, blit_band, &job);
+	if (ret)
+		log_band_timings(sw_blitter, "blit");
+
+finish:
+	unmap_surface(&mapped_source);
+	return ret;
+}
+
+
+static int imx_2d_backend_sw_blitter_fill_region(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams *internal_fill_region_params)
+{
+	Imx2dSwBlitter *sw_blitter = (Imx2dSwBlitter *)blitter;
+
+	if (!sw_blitter->dest_mapped)
+	{
+		IMX_2D_LOG(ERROR, "destination surface is not mapped - cannot fill region");
+		return FALSE;
+	}
+
+	/* The fill color is 0x00RRGGBB. Fills are always opaque. */
+	return fill_rect(sw_blitter, internal_fill_region_params->dest_region, internal_fill_region_params->fill_color | 0xFF000000);
+}
+
+
+static int imx_2d_backend_sw_blitter_fill_regions(Imx2dBlitter *blitter, Imx2dInternalFillRegionsParams *internal_fill_regions_params)
+{
+	Imx2dSwBlitter *sw_blitter = (Imx2dSwBlitter *)blitter;
+
+	if (!sw_blitter->dest_mapped)
+	{
+		IMX_2D_LOG(ERROR, "destination surface is not mapped - cannot fill regions");
+		return FALSE;
+	}
+
+	/* The fill color is 0x00RRGGBB. Fills are always opaque. */
+	return fill_rects(sw_blitter, internal_fill_regions_params->dest_regions, internal_fill_regions_params->num_dest_regions, internal_fill_regions_params->fill_color | 0xFF000000);
+}
+
+
+static Imx2dHardwareCapabilities const * imx_2d_backend_sw_blitter_get_hardware_capabilities(Imx2dBlitter *blitter)
+{
+	IMX_2D_UNUSED_PARAM(blitter);
+	return imx_2d_backend_sw_get_hardware_capabilities();
+}
+
+
+
+
+Imx2dBlitter* imx_2d_backend_sw_blitter_create(void)
+{
+	return imx_2d_backend_sw_blitter_create_threaded(1, 0);
+}
+
+
+Imx2dBlitter* imx_2d_backend_sw_blitter_create_threaded(int num_threads, uint64_t cpu_affinity_mask)
+{
+	Imx2dSwBlitter *sw_blitter;
+
+	sw_blitter = malloc(sizeof(Imx2dSwBlitter));
+	assert(sw_blitter != NULL);
+
+	memset(sw_blitter, 0, sizeof(Imx2dSwBlitter));
+
+	sw_blitter->parent.blitter_class = &imx_2d_backend_sw_blitter_class;
+
+	sw_blitter->worker_pool = sw_worker_pool_create(num_threads, cpu_affinity_mask);
+	if (sw_blitter->worker_pool == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not create worker pool for software blitter");
+		imx_2d_backend_sw_blitter_destroy((Imx2dBlitter *)sw_blitter);
+		return NULL;
+	}
+
+	sw_blitter->num_threads = sw_worker_pool_get_num_threads(sw_blitter->worker_pool);
+
+#if defined(IMX2D_SW_USE_NEON)
+	IMX_2D_LOG(DEBUG, "created software blitter with %d thread(s); using NEON", sw_blitter->num_threads);
+#elif defined(IMX2D_SW_USE_SSE2)
+	IMX_2D_LOG(DEBUG, "created software blitter with %d thread(s); using SSE2", sw_blitter->num_threads);
+#else
+	IMX_2D_LOG(DEBUG, "created software blitter with %d thread(s); using plain C", sw_blitter->num_threads);
+#endif
+
+	return (Imx2dBlitter *)sw_blitter;
+}
+
+
+int imx_2d_backend_sw_blitter_get_num_threads(Imx2dBlitter *blitter)
+{
+	assert(blitter != NULL);
+	return ((Imx2dSwBlitter *)blitter)->num_threads;
+}
+
+
+int imx_2d_backend_sw_blitter_get_last_band_timings(Imx2dBlitter *blitter, Imx2dSwBandTiming const **timings)
+{
+	assert(blitter != NULL);
+	return sw_worker_pool_get_band_timings(((Imx2dSwBlitter *)blitter)->worker_pool, timings);
+}
+
+
+static Imx2dHardwareCapabilities const capabilities = {
+	.supported_source_pixel_formats = supported_source_pixel_formats,
+	.num_supported_source_pixel_formats = sizeof(supported_source_pixel_formats) / sizeof(Imx2dPixelFormat),
+
+	.supported_dest_pixel_formats = supported_dest_pixel_formats,
+	.num_supported_dest_pixel_formats = sizeof(supported_dest_pixel_formats) / sizeof(Imx2dPixelFormat),
+
+	.min_width = 1, .max_width = INT_MAX, .width_step_size = 1,
+	.min_height = 1, .max_height = INT_MAX, .height_step_size = 1,
+
+	/* Not required by the blitter itself, but it keeps rows
+	 * aligned to the SIMD register width. */
+	.stride_alignment = 16,
+	.total_row_count_alignment = 1,
+
+	.can_handle_multi_buffer_surfaces = 1,
+
+	.draws_blit_margins_for_free = 0,
+
+	/* The nearest neighbor scaler has no limit (and no filtering
+	 * that multiple passes could improve on). */
+	.max_downscale_factor = 0
+};
+
+Imx2dHardwareCapabilities const * imx_2d_backend_sw_get_hardware_capabilities(void)
+{
+	return &capabilities;
+}
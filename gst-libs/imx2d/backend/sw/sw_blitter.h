@@ -0,0 +1,148 @@
+#ifndef IMX2D_BACKEND_SW_BLITTER_H
+#define IMX2D_BACKEND_SW_BLITTER_H
+
+#include <stdint.h>
+#include <imx2d/imx2d.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * IMX_2D_BACKEND_SW_MAX_NUM_THREADS:
+ *
+ * Maximum number of threads a software blitter can use.
+ */
+#define IMX_2D_BACKEND_SW_MAX_NUM_THREADS 16
+
+
+/**
+ * Imx2dSwBandTiming:
+ * @thread_index: Index of the thread that processed the band. 0 is the
+ *     thread that called the blitter function; worker threads have
+ *     indices starting at 1.
+ * @start_offset: Time between the start of the operation and the start
+ *     of the processing of this band, in nanoseconds.
+ * @duration: How long it took to process this band, in nanoseconds.
+ *
+ * Timing information about one band of a multi-threaded operation.
+ */
+typedef struct
+{
+	int thread_index;
+	int64_t start_offset;
+	int64_t duration;
+}
+Imx2dSwBandTiming;
+
+
+/**
+ * imx_2d_backend_sw_blitter_create:
+ *
+ * Creates a new @Imx2dBlitter that performs all operations on the CPU.
+ *
+ * This blitter does not need any 2D hardware. It maps the DMA buffers
+ * of the surfaces into the CPU's address space and scales, rotates,
+ * converts and blends pixels in software. Inner loops use NEON on ARM
+ * and SSE2 on x86 if the compiler targets these instruction sets.
+ *
+ * This is mainly useful on i.MX SoCs that lack a particular 2D unit,
+ * and as a reference and fallback implementation.
+ *
+ * To destroy the created blitter, use @imx_2d_blitter_destroy.
+ *
+ * Returns: Pointer to a newly created software blitter, or NULL in case of failure.
+ */
+Imx2dBlitter* imx_2d_backend_sw_blitter_create(void);
+
+/**
+ * imx_2d_backend_sw_blitter_create_threaded:
+ * @num_threads: Number of threads to use, including the thread that
+ *     calls the blitter functions. If this is 0, the number of online
+ *     CPU cores is used. Values above @IMX_2D_BACKEND_SW_MAX_NUM_THREADS
+ *     are clamped.
+ * @cpu_affinity_mask: Bitmask of CPUs the worker threads shall be pinned
+ *     to (bit N = CPU #N). If this is 0, the worker threads are not pinned.
+ *     The thread that calls the blitter functions is never pinned.
+ *
+ * Variant of @imx_2d_backend_sw_blitter_create that splits blits and fills
+ * into horizontal bands, which are processed in parallel by a pool of worker
+ * threads. @imx_2d_backend_sw_blitter_create is equivalent to calling this
+ * function with @num_threads set to 1.
+ *
+ * On big.LITTLE SoCs, @imx_2d_backend_sw_get_big_cluster_cpu_mask can be
+ * used to keep the worker threads on the fastest cores.
+ *
+ * Returns: Pointer to a newly created software blitter, or NULL in case of failure.
+ */
+Imx2dBlitter* imx_2d_backend_sw_blitter_create_threaded(int num_threads, uint64_t cpu_affinity_mask);
+
+/**
+ * imx_2d_backend_sw_blitter_get_num_threads:
+ * @blitter: Software blitter to query. Must not be NULL.
+ *
+ * Returns: Number of threads the blitter uses, including the calling thread.
+ */
+int imx_2d_backend_sw_blitter_get_num_threads(Imx2dBlitter *blitter);
+
+/**
+ * imx_2d_backend_sw_blitter_get_last_band_timings:
+ * @blitter: Software blitter to query. Must not be NULL.
+ * @timings: Pointer to a variable that gets set to an array of
+ *     @Imx2dSwBandTiming instances, one per band. Must not be NULL.
+ *
+ * Retrieves per-band timing information of the last blit or fill
+ * operation. This is useful for tuning the number of threads and the
+ * CPU affinity. The array remains valid until the next operation.
+ *
+ * Returns: Number of bands of the last operation.
+ */
+int imx_2d_backend_sw_blitter_get_last_band_timings(Imx2dBlitter *blitter, Imx2dSwBandTiming const **timings);
+
+/**
+ * imx_2d_backend_sw_get_big_cluster_cpu_mask:
+ *
+ * Determines which CPUs have the highest capacity. On big.LITTLE SoCs,
+ * these are the cores of the "big" cluster. On SoCs with identical cores,
+ * these are all cores. The capacity is read from sysfs.
+ *
+ * Returns: Bitmask of the CPUs with the highest capacity, or 0 if
+ *     this could not be determined.
+ */
+uint64_t imx_2d_backend_sw_get_big_cluster_cpu_mask(void);
+
+/**
+ * imx_2d_backend_sw_parse_cpu_affinity:
+ * @cpu_affinity: String to parse. Either NULL or empty (meaning no pinning),
+ *     "big" (the CPUs returned by @imx_2d_backend_sw_get_big_cluster_cpu_mask),
+ *     or a comma separated list of CPU numbers and ranges like "0-3,6".
+ * @cpu_affinity_mask: Pointer to the variable that receives the bitmask.
+ *     Must not be NULL.
+ *
+ * Converts a CPU affinity string to a mask for
+ * @imx_2d_backend_sw_blitter_create_threaded.
+ *
+ * Returns: Nonzero if the string is valid, zero otherwise.
+ */
+int imx_2d_backend_sw_parse_cpu_affinity(char const *cpu_affinity, uint64_t *cpu_affinity_mask);
+
+/**
+ * imx_2d_backend_sw_get_hardware_capabilities:
+ *
+ * Returns a const pointer to a static structure that contains
+ * information about the capabilities of the software blitter.
+ *
+ * @Returns Const pointer to the @Imx2dHardwareCapabilities structure.
+ *     This structure is static, and does not have to be freed in any way.
+ */
+Imx2dHardwareCapabilities const * imx_2d_backend_sw_get_hardware_capabilities(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* IMX2D_BACKEND_SW_BLITTER_H */
@@ -0,0 +1,412 @@
+/* Needed for pthread_setaffinity_np() and the CPU_* macros */
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <config.h>
+
+#include "sw_worker_pool.h"
+
+
+struct _SwWorkerPool
+{
+	pthread_t *worker_threads;
+	int num_worker_threads;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t job_cond;
+	pthread_cond_t done_cond;
+
+	/* The current run. Workers process it once for each increment
+	 * of run_generation. next_band is the next band that has not
+	 * yet been picked up by any thread. */
+	SwWorkerPoolBandFunc func;
+	void *user_data;
+	int num_bands;
+	unsigned int run_generation;
+	int next_band;
+	int num_finished_workers;
+	BOOL shutting_down;
+
+	/* Used by worker threads to get their thread index. */
+	int num_started_workers;
+
+	struct timespec run_start_time;
+	Imx2dSwBandTiming *band_timings;
+	int band_timings_capacity;
+};
+
+
+static inline int64_t timespec_diff_ns(struct timespec const *start, struct timespec const *end)
+{
+	return ((int64_t)(end->tv_sec - start->tv_sec)) * 1000000000 + (end->tv_nsec - start->tv_nsec);
+}
+
+
+/* Picks up bands of the current run until none are left. */
+static void process_bands(SwWorkerPool *pool, int thread_index)
+{
+	while (TRUE)
+	{
+		int band;
+		struct timespec band_start_time, band_end_time;
+		Imx2dSwBandTiming *timing;
+
+		pthread_mutex_lock(&(pool->mutex));
+		band = (pool->next_band < pool->num_bands) ? pool->next_band++ : -1;
+		pthread_mutex_unlock(&(pool->mutex));
+
+		if (band < 0)
+			break;
+
+		clock_gettime(CLOCK_MONOTONIC, &band_start_time);
+		pool->func(pool->user_data, band, thread_index);
+		clock_gettime(CLOCK_MONOTONIC, &band_end_time);
+
+		/* Each band has its own timing entry, so
+		 * this needs no synchronization. */
+		timing = &(pool->band_timings[band]);
+		timing->thread_index = thread_index;
+		timing->start_offset = timespec_diff_ns(&(pool->run_start_time), &band_start_time);
+		timing->duration = timespec_diff_ns(&band_start_time, &band_end_time);
+	}
+}
+
+
+static void* worker_thread_func(void *arg)
+{
+	SwWorkerPool *pool = (SwWorkerPool *)arg;
+	unsigned int processed_generation = 0;
+	int thread_index;
+
+	pthread_mutex_lock(&(pool->mutex));
+
+	thread_index = ++(pool->num_started_workers);
+
+	while (TRUE)
+	{
+		while (!pool->shutting_down && (pool->run_generation == processed_generation))
+			pthread_cond_wait(&(pool->job_cond), &(pool->mutex));
+
+		if (pool->shutting_down)
+			break;
+
+		processed_generation = pool->run_generation;
+
+		pthread_mutex_unlock(&(pool->mutex));
+		process_bands(pool, thread_index);
+		pthread_mutex_lock(&(pool->mutex));
+
+		pool->num_finished_workers++;
+		if (pool->num_finished_workers == pool->num_worker_threads)
+			pthread_cond_signal(&(pool->done_cond));
+	}
+
+	pthread_mutex_unlock(&(pool->mutex));
+
+	return NULL;
+}
+
+
+static void pin_thread(pthread_t thread, uint64_t cpu_affinity_mask)
+{
+	cpu_set_t cpu_set;
+	int cpu, err;
+
+	CPU_ZERO(&cpu_set);
+	for (cpu = 0; cpu < 64; ++cpu)
+	{
+		if (cpu_affinity_mask & (((uint64_t)1) << cpu))
+			CPU_SET(cpu, &cpu_set);
+	}
+
+	err = pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set);
+	if (err != 0)
+		IMX_2D_LOG(WARNING, "could not set worker thread CPU affinity mask %#llx: %s (%d)", (unsigned long long)cpu_affinity_mask, strerror(err), err);
+}
+
+
+SwWorkerPool* sw_worker_pool_create(int num_threads, uint64_t cpu_affinity_mask)
+{
+	SwWorkerPool *pool;
+	int i;
+
+	if (num_threads <= 0)
+	{
+		long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = (num_cpus > 0) ? (int)num_cpus : 1;
+	}
+
+	num_threads = MIN(num_threads, IMX_2D_BACKEND_SW_MAX_NUM_THREADS);
+
+	pool = malloc(sizeof(SwWorkerPool));
+	assert(pool != NULL);
+
+	memset(pool, 0, sizeof(SwWorkerPool));
+
+	pthread_mutex_init(&(pool->mutex), NULL);
+	pthread_cond_init(&(pool->job_cond), NULL);
+	pthread_cond_init(&(pool->done_cond), NULL);
+
+	if (num_threads > 1)
+	{
+		pool->worker_threads = malloc(sizeof(pthread_t) * (num_threads - 1));
+		assert(pool->worker_threads != NULL);
+
+		for (i = 0; i < (num_threads - 1); ++i)
+		{
+			int err = pthread_create(&(pool->worker_threads[i]), NULL, worker_thread_func, pool);
+			if (err != 0)
+			{
+				IMX_2D_LOG(ERROR, "could not create worker thread: %s (%d)", strerror(err), err);
+				goto error;
+			}
+
+			pool->num_worker_threads++;
+
+			if (cpu_affinity_mask != 0)
+				pin_thread(pool->worker_threads[i], cpu_affinity_mask);
+		}
+	}
+
+	IMX_2D_LOG(DEBUG, "created worker pool with %d thread(s) and CPU affinity mask %#llx", num_threads, (unsigned long long)cpu_affinity_mask);
+
+	return pool;
+
+error:
+	sw_worker_pool_destroy(pool);
+	return NULL;
+}
+
+
+void sw_worker_pool_destroy(SwWorkerPool *pool)
+{
+	int i;
+
+	assert(pool != NULL);
+
+	pthread_mutex_lock(&(pool->mutex));
+	pool->shutting_down = TRUE;
+	pthread_cond_broadcast(&(pool->job_cond));
+	pthread_mutex_unlock(&(pool->mutex));
+
+	for (i = 0; i < pool->num_worker_threads; ++i)
+		pthread_join(pool->worker_threads[i], NULL);
+
+	pthread_cond_destroy(&(pool->done_cond));
+	pthread_cond_destroy(&(pool->job_cond));
+	pthread_mutex_destroy(&(pool->mutex));
+
+	free(pool->band_timings);
+	free(pool->worker_threads);
+	free(pool);
+}
+
+
+int sw_worker_pool_get_num_threads(SwWorkerPool const *pool)
+{
+	assert(pool != NULL);
+	return pool->num_worker_threads + 1;
+}
+
+
+BOOL sw_worker_pool_run(SwWorkerPool *pool, int num_bands, SwWorkerPoolBandFunc func, void *user_data)
+{
+	assert(pool != NULL);
+	assert(func != NULL);
+
+	if (num_bands > pool->band_timings_capacity)
+	{
+		Imx2dSwBandTiming *band_timings = realloc(pool->band_timings, num_bands * sizeof(Imx2dSwBandTiming));
+		if (band_timings == NULL)
+		{
+			IMX_2D_LOG(ERROR, "could not allocate band timings for %d bands", num_bands);
+			return FALSE;
+		}
+
+		pool->band_timings = band_timings;
+		pool->band_timings_capacity = num_bands;
+	}
+
+	pool->func = func;
+	pool->user_data = user_data;
+	pool->num_bands = num_bands;
+	pool->next_band = 0;
+	clock_gettime(CLOCK_MONOTONIC, &(pool->run_start_time));
+
+	/* Waking up workers is not worth it for a single band. */
+	if ((pool->num_worker_threads == 0) || (num_bands <= 1))
+	{
+		process_bands(pool, 0);
+		return TRUE;
+	}
+
+	pthread_mutex_lock(&(pool->mutex));
+	pool->num_finished_workers = 0;
+	pool->run_generation++;
+	pthread_cond_broadcast(&(pool->job_cond));
+	pthread_mutex_unlock(&(pool->mutex));
+
+	/* The calling thread helps out instead of just waiting. */
+	process_bands(pool, 0);
+
+	/* Wait until every worker has seen this run. Otherwise, a late
+	 * worker could still be reading the run parameters when the
+	 * next run is set up. */
+	pthread_mutex_lock(&(pool->mutex));
+	while (pool->num_finished_workers < pool->num_worker_threads)
+		pthread_cond_wait(&(pool->done_cond), &(pool->mutex));
+	pthread_mutex_unlock(&(pool->mutex));
+
+	return TRUE;
+}
+
+
+int sw_worker_pool_get_band_timings(SwWorkerPool const *pool, Imx2dSwBandTiming const **timings)
+{
+	assert(pool != NULL);
+	assert(timings != NULL);
+
+	*timings = pool->band_timings;
+	return pool->num_bands;
+}
+
+
+
+
+/* CPU affinity helpers */
+
+
+/* Reads a single non-negative integer from a sysfs file.
+ * Returns -1 if the file cannot be read. */
+static long read_sysfs_value(char const *path)
+{
+	FILE *file;
+	long value;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+		return -1;
+
+	if (fscanf(file, "%ld", &value) != 1)
+		value = -1;
+
+	fclose(file);
+
+	return value;
+}
+
+
+uint64_t imx_2d_backend_sw_get_big_cluster_cpu_mask(void)
+{
+	/* cpu_capacity is the preferred source, since it accounts for
+	 * microarchitectural differences. If the kernel does not provide
+	 * it, the maximum frequency is used as an approximation. */
+	static char const *capacity_path_formats[] =
+	{
+		"/sys/devices/system/cpu/cpu%d/cpu_capacity",
+		"/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq"
+	};
+	long num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	unsigned int format_nr;
+
+	num_cpus = MIN(num_cpus, 64);
+
+	for (format_nr = 0; format_nr < sizeof(capacity_path_formats) / sizeof(capacity_path_formats[0]); ++format_nr)
+	{
+		uint64_t mask = 0;
+		long max_capacity = -1;
+		int cpu;
+
+		for (cpu = 0; cpu < num_cpus; ++cpu)
+		{
+			char path[128];
+			long capacity;
+
+			snprintf(path, sizeof(path), capacity_path_formats[format_nr], cpu);
+			capacity = read_sysfs_value(path);
+
+			if (capacity < 0)
+				continue;
+
+			if (capacity > max_capacity)
+			{
+				max_capacity = capacity;
+				mask = 0;
+			}
+
+			if (capacity == max_capacity)
+				mask |= ((uint64_t)1) << cpu;
+		}
+
+		if (mask != 0)
+			return mask;
+	}
+
+	return 0;
+}
+
+
+int imx_2d_backend_sw_parse_cpu_affinity(char const *cpu_affinity, uint64_t *cpu_affinity_mask)
+{
+	uint64_t mask = 0;
+	char const *cur;
+
+	assert(cpu_affinity_mask != NULL);
+
+	if ((cpu_affinity == NULL) || (cpu_affinity[0] == '\0'))
+	{
+		*cpu_affinity_mask = 0;
+		return TRUE;
+	}
+
+	if (strcmp(cpu_affinity, "big") == 0)
+	{
+		*cpu_affinity_mask = imx_2d_backend_sw_get_big_cluster_cpu_mask();
+		return TRUE;
+	}
+
+	cur = cpu_affinity;
+
+	while (TRUE)
+	{
+		char *end;
+		long first_cpu, last_cpu, cpu;
+
+		first_cpu = strtol(cur, &end, 10);
+		if ((end == cur) || (first_cpu < 0) || (first_cpu > 63))
+			return FALSE;
+
+		last_cpu = first_cpu;
+		cur = end;
+
+		if (*cur == '-')
+		{
+			++cur;
+			last_cpu = strtol(cur, &end, 10);
+			if ((end == cur) || (last_cpu < first_cpu) || (last_cpu > 63))
+				return FALSE;
+			cur = end;
+		}
+
+		for (cpu = first_cpu; cpu <= last_cpu; ++cpu)
+			mask |= ((uint64_t)1) << cpu;
+
+		if (*cur == '\0')
+			break;
+		else if (*cur != ',')
+			return FALSE;
+
+		++cur;
+	}
+
+	*cpu_affinity_mask = mask;
+	return TRUE;
+}
@@ -0,0 +1,46 @@
+#ifndef IMX2D_BACKEND_SW_WORKER_POOL_H
+#define IMX2D_BACKEND_SW_WORKER_POOL_H
+
+#include <stdint.h>
+#include "imx2d/imx2d_priv.h"
+#include "sw_blitter.h"
+
+
+/* Internal pool of worker threads for the software backend.
+ *
+ * Work is split into bands, which are numbered 0 to num_bands-1.
+ * sw_worker_pool_run() hands out bands to the worker threads and
+ * to the calling thread until all bands are processed, and only
+ * returns once every thread is done. The calling thread always
+ * has thread index 0; workers have indices 1 to num_threads-1.
+ *
+ * The processing time of each band is recorded, and can be
+ * retrieved after a run with sw_worker_pool_get_band_timings(). */
+
+
+typedef struct _SwWorkerPool SwWorkerPool;
+
+typedef void (*SwWorkerPoolBandFunc)(void *user_data, int band, int thread_index);
+
+
+/* Creates a pool with num_threads threads in total, including the
+ * thread that calls sw_worker_pool_run(). If num_threads is 0, the
+ * number of online CPU cores is used. If cpu_affinity_mask is
+ * nonzero, the worker threads are pinned to the CPUs in that mask.
+ * The calling thread is not pinned. */
+SwWorkerPool* sw_worker_pool_create(int num_threads, uint64_t cpu_affinity_mask);
+void sw_worker_pool_destroy(SwWorkerPool *pool);
+
+int sw_worker_pool_get_num_threads(SwWorkerPool const *pool);
+
+/* Calls func for each band in [0, num_bands), distributed across
+ * all threads of the pool. Blocks until all bands are processed. */
+BOOL sw_worker_pool_run(SwWorkerPool *pool, int num_bands, SwWorkerPoolBandFunc func, void *user_data);
+
+/* Returns the number of bands of the last run, and sets *timings to
+ * an array with one entry per band. The array remains valid until
+ * the next run. */
+int sw_worker_pool_get_band_timings(SwWorkerPool const *pool, Imx2dSwBandTiming const **timings);
+
+
+#endif /* IMX2D_BACKEND_SW_WORKER_POOL_H */
@@ -0,0 +1,1406 @@
+/* imx2d-bench - microbenchmark for imx2d blitter backends
+ *
+ * Runs blit and fill operations over a matrix of pixel format pairs,
+ * resolutions, rotations, alpha values and margin configurations, and
+ * prints the measured throughput and latency percentiles as JSON.
+ *
+ * Each measured iteration is one complete start / operation / finish
+ * sequence, so the latency figures include any backend specific setup
+ * and synchronization costs, just like in the GStreamer elements.
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+
+#include "imx2d/imx2d.h"
+#include "imx2d/imx2d_priv.h"
+
+#ifdef WITH_IMX2D_G2D_BACKEND
+#include "imx2d/backend/g2d/g2d_blitter.h"
+#endif
+#ifdef WITH_IMX2D_IPU_BACKEND
+#include "imx2d/backend/ipu/ipu_blitter.h"
+#endif
+#ifdef WITH_IMX2D_PXP_BACKEND
+#include "imx2d/backend/pxp/pxp_blitter.h"
+#endif
+#ifdef WITH_IMX2D_SW_BACKEND
+#include "imx2d/backend/sw/sw_blitter.h"
+#endif
+
+
+#define BENCH_ALIGN_VAL_TO(LENGTH, ALIGN_SIZE) ((((LENGTH) + (ALIGN_SIZE) - 1) / (ALIGN_SIZE)) * (ALIGN_SIZE))
+
+#define DEFAULT_SOURCE_FORMATS "rgba8888,bgrx8888,rgb565,uyvy,nv12,i420"
+#define DEFAULT_DEST_FORMATS "rgba8888,bgrx8888,rgb565"
+#define DEFAULT_SOURCE_SIZES "1280x720,1920x1080"
+#define DEFAULT_DEST_SIZES "1280x720"
+#define DEFAULT_ROTATIONS "none"
+#define DEFAULT_ALPHAS "255"
+#define DEFAULT_MARGINS "0"
+#define DEFAULT_NUM_ITERATIONS 50
+#define DEFAULT_NUM_WARMUP_ITERATIONS 5
+
+#define MAX_LIST_ENTRIES 64
+
+/* Geometry of the Amphion 8x128 tiled formats. Each plane consists of
+ * whole tiles that are 8 bytes wide and 128 rows high. */
+#define AMPHION_TILE_WIDTH 8
+#define AMPHION_TILE_HEIGHT 128
+
+#define MARGIN_COLOR 0xFF000000
+#define FILL_COLOR 0xFF336699
+
+
+
+
+/***********************/
+/****** NAME TABLES ****/
+/***********************/
+
+
+typedef struct
+{
+	char const *name;
+	Imx2dPixelFormat format;
+}
+BenchPixelFormatName;
+
+static BenchPixelFormatName const pixel_format_names[] =
+{
+	{ "rgb565", IMX_2D_PIXEL_FORMAT_RGB565 },
+	{ "bgr565", IMX_2D_PIXEL_FORMAT_BGR565 },
+	{ "rgb888", IMX_2D_PIXEL_FORMAT_RGB888 },
+	{ "bgr888", IMX_2D_PIXEL_FORMAT_BGR888 },
+	{ "rgbx8888", IMX_2D_PIXEL_FORMAT_RGBX8888 },
+	{ "rgba8888", IMX_2D_PIXEL_FORMAT_RGBA8888 },
+	{ "bgrx8888", IMX_2D_PIXEL_FORMAT_BGRX8888 },
+	{ "bgra8888", IMX_2D_PIXEL_FORMAT_BGRA8888 },
+	{ "xrgb8888", IMX_2D_PIXEL_FORMAT_XRGB8888 },
+	{ "argb8888", IMX_2D_PIXEL_FORMAT_ARGB8888 },
+	{ "xbgr8888", IMX_2D_PIXEL_FORMAT_XBGR8888 },
+	{ "abgr8888", IMX_2D_PIXEL_FORMAT_ABGR8888 },
+	{ "gray8", IMX_2D_PIXEL_FORMAT_GRAY8 },
+	{ "uyvy", IMX_2D_PIXEL_FORMAT_PACKED_YUV422_UYVY },
+	{ "yuyv", IMX_2D_PIXEL_FORMAT_PACKED_YUV422_YUYV },
+	{ "yvyu", IMX_2D_PIXEL_FORMAT_PACKED_YUV422_YVYU },
+	{ "vyuy", IMX_2D_PIXEL_FORMAT_PACKED_YUV422_VYUY },
+	{ "yuv444", IMX_2D_PIXEL_FORMAT_PACKED_YUV444 },
+	{ "nv12", IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV12 },
+	{ "nv21", IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV21 },
+	{ "nv16", IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV16 },
+	{ "nv61", IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV61 },
+	{ "yv12", IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_YV12 },
+	{ "i420", IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_I420 },
+	{ "y42b", IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_Y42B },
+	{ "y444", IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_Y444 },
+	{ "nv12-amphion-8x128", IMX_2D_PIXEL_FORMAT_TILED_NV12_AMPHION_8x128 },
+	{ "nv21-amphion-8x128", IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128 },
+	{ "nv12-amphion-8x128-10bit", IMX_2D_PIXEL_FORMAT_TILED_NV12_AMPHION_8x128_10BIT },
+	{ "nv21-amphion-8x128-10bit", IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128_10BIT },
+	{ NULL, IMX_2D_PIXEL_FORMAT_UNKNOWN }
+};
+
+
+typedef struct
+{
+	char const *name;
+	Imx2dRotation rotation;
+}
+BenchRotationName;
+
+static BenchRotationName const rotation_names[] =
+{
+	{ "none", IMX_2D_ROTATION_NONE },
+	{ "90", IMX_2D_ROTATION_90 },
+	{ "180", IMX_2D_ROTATION_180 },
+	{ "270", IMX_2D_ROTATION_270 },
+	{ "flip-horizontal", IMX_2D_ROTATION_FLIP_HORIZONTAL },
+	{ "flip-vertical", IMX_2D_ROTATION_FLIP_VERTICAL },
+	{ "ul-lr", IMX_2D_ROTATION_UL_LR },
+	{ "ur-ll", IMX_2D_ROTATION_UR_LL },
+	{ NULL, IMX_2D_ROTATION_NONE }
+};
+
+
+typedef Imx2dBlitter* (*BenchCreateBlitterFunc)(void);
+
+typedef struct
+{
+	char const *name;
+	BenchCreateBlitterFunc create;
+}
+BenchBackend;
+
+static BenchBackend const backends[] =
+{
+#ifdef WITH_IMX2D_G2D_BACKEND
+	{ "g2d", imx_2d_backend_g2d_blitter_create },
+#endif
+#ifdef WITH_IMX2D_IPU_BACKEND
+	{ "ipu", imx_2d_backend_ipu_blitter_create },
+#endif
+#ifdef WITH_IMX2D_PXP_BACKEND
+	{ "pxp", imx_2d_backend_pxp_blitter_create },
+#endif
+#ifdef WITH_IMX2D_SW_BACKEND
+	{ "sw", imx_2d_backend_sw_blitter_create },
+#endif
+	{ NULL, NULL }
+};
+
+
+static char const * pixel_format_name(Imx2dPixelFormat format)
+{
+	int i;
+	for (i = 0; pixel_format_names[i].name != NULL; ++i)
+	{
+		if (pixel_format_names[i].format == format)
+			return pixel_format_names[i].name;
+	}
+	return "unknown";
+}
+
+
+static char const * rotation_name(Imx2dRotation rotation)
+{
+	int i;
+	for (i = 0; rotation_names[i].name != NULL; ++i)
+	{
+		if (rotation_names[i].rotation == rotation)
+			return rotation_names[i].name;
+	}
+	return "unknown";
+}
+
+
+
+
+/***********************/
+/****** HEAP MEMORY ****/
+/***********************/
+
+/* A minimal ImxDmaBuffer allocator that uses ordinary heap memory.
+ * Buffers allocated by it have no physical address, so this is only
+ * usable with backends that access pixels through the CPU (that is,
+ * the software blitter). It allows for running the benchmark on
+ * machines that have no i.MX DMA memory allocator available, for
+ * example on CI build hosts. */
+
+
+typedef struct
+{
+	ImxDmaBuffer parent;
+	uint8_t *aligned_pixels;
+	void *pixels;
+	size_t size;
+}
+BenchHeapDmaBuffer;
+
+
+static void bench_heap_allocator_destroy(ImxDmaBufferAllocator *allocator)
+{
+	IMX_2D_UNUSED_PARAM(allocator);
+}
+
+
+static ImxDmaBuffer* bench_heap_allocator_allocate(ImxDmaBufferAllocator *allocator, size_t size, size_t alignment, int *error)
+{
+	BenchHeapDmaBuffer *heap_buffer;
+	uintptr_t address;
+
+	if (alignment == 0)
+		alignment = 1;
+
+	heap_buffer = calloc(1, sizeof(BenchHeapDmaBuffer));
+	if (heap_buffer == NULL)
+		goto error;
+
+	heap_buffer->pixels = malloc(size + alignment - 1);
+	if (heap_buffer->pixels == NULL)
+		goto error;
+
+	address = (uintptr_t)(heap_buffer->pixels);
+	address = BENCH_ALIGN_VAL_TO(address, (uintptr_t)alignment);
+
+	heap_buffer->parent.allocator = allocator;
+	heap_buffer->aligned_pixels = (uint8_t *)address;
+	heap_buffer->size = size;
+
+	return (ImxDmaBuffer *)heap_buffer;
+
+error:
+	if (error != NULL)
+		*error = ENOMEM;
+	free(heap_buffer);
+	return NULL;
+}
+
+
+static void bench_heap_allocator_deallocate(ImxDmaBufferAllocator *allocator, ImxDmaBuffer *buffer)
+{
+	BenchHeapDmaBuffer *heap_buffer = (BenchHeapDmaBuffer *)buffer;
+
+	IMX_2D_UNUSED_PARAM(allocator);
+
+	free(heap_buffer->pixels);
+	free(heap_buffer);
+}
+
+
+static uint8_t* bench_heap_allocator_map(ImxDmaBufferAllocator *allocator, ImxDmaBuffer *buffer, unsigned int flags, int *error)
+{
+	IMX_2D_UNUSED_PARAM(allocator);
+	IMX_2D_UNUSED_PARAM(flags);
+	IMX_2D_UNUSED_PARAM(error);
+	return ((BenchHeapDmaBuffer *)buffer)->aligned_pixels;
+}
+
+
+static void bench_heap_allocator_unmap(ImxDmaBufferAllocator *allocator, ImxDmaBuffer *buffer)
+{
+	IMX_2D_UNUSED_PARAM(allocator);
+	IMX_2D_UNUSED_PARAM(buffer);
+}
+
+
+static imx_physical_address_t bench_heap_allocator_get_physical_address(ImxDmaBufferAllocator *allocator, ImxDmaBuffer *buffer)
+{
+	IMX_2D_UNUSED_PARAM(allocator);
+	IMX_2D_UNUSED_PARAM(buffer);
+	return 0;
+}
+
+
+static int bench_heap_allocator_get_fd(ImxDmaBufferAllocator *allocator, ImxDmaBuffer *buffer)
+{
+	IMX_2D_UNUSED_PARAM(allocator);
+	IMX_2D_UNUSED_PARAM(buffer);
+	return -1;
+}
+
+
+static size_t bench_heap_allocator_get_size(ImxDmaBufferAllocator *allocator, ImxDmaBuffer *buffer)
+{
+	IMX_2D_UNUSED_PARAM(allocator);
+	return ((BenchHeapDmaBuffer *)buffer)->size;
+}
+
+
+static ImxDmaBufferAllocator bench_heap_allocator =
+{
+	.destroy = bench_heap_allocator_destroy,
+	.allocate = bench_heap_allocator_allocate,
+	.deallocate = bench_heap_allocator_deallocate,
+	.map = bench_heap_allocator_map,
+	.unmap = bench_heap_allocator_unmap,
+	.get_physical_address = bench_heap_allocator_get_physical_address,
+	.get_fd = bench_heap_allocator_get_fd,
+	.get_size = bench_heap_allocator_get_size
+};
+
+
+
+
+/***********************/
+/****** SURFACES *******/
+/***********************/
+
+
+typedef struct
+{
+	Imx2dSurface *surface;
+	ImxDmaBuffer *dma_buffer;
+	int width, height;
+}
+BenchSurface;
+
+
+static void bench_surface_free(BenchSurface *bench_surface)
+{
+	if (bench_surface->surface != NULL)
+		imx_2d_surface_destroy(bench_surface->surface);
+	if (bench_surface->dma_buffer != NULL)
+		imx_dma_buffer_deallocate(bench_surface->dma_buffer);
+	memset(bench_surface, 0, sizeof(BenchSurface));
+}
+
+
+static BOOL is_amphion_tiled_format(Imx2dPixelFormat format, BOOL *is_10bit)
+{
+	switch (format)
+	{
+		case IMX_2D_PIXEL_FORMAT_TILED_NV12_AMPHION_8x128:
+		case IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128:
+			*is_10bit = FALSE;
+			return TRUE;
+
+		case IMX_2D_PIXEL_FORMAT_TILED_NV12_AMPHION_8x128_10BIT:
+		case IMX_2D_PIXEL_FORMAT_TILED_NV21_AMPHION_8x128_10BIT:
+			*is_10bit = TRUE;
+			return TRUE;
+
+		default:
+			*is_10bit = FALSE;
+			return FALSE;
+	}
+}
+
+
+static BOOL bench_surface_alloc(BenchSurface *bench_surface, ImxDmaBufferAllocator *allocator, Imx2dHardwareCapabilities const *capabilities, Imx2dPixelFormat format, int width, int height, BOOL fill_pattern)
+{
+	Imx2dPixelFormatInfo const *fmt_info = imx_2d_get_pixel_format_info(format);
+	Imx2dSurfaceDesc desc;
+	int plane_offsets[3] = { 0, 0, 0 };
+	int plane_nr;
+	int stride_alignment;
+	int total_num_rows, num_plane_rows;
+	BOOL is_tiled, is_10bit;
+	size_t total_size;
+	int error = 0;
+
+	assert(fmt_info != NULL);
+
+	memset(bench_surface, 0, sizeof(BenchSurface));
+	memset(&desc, 0, sizeof(desc));
+
+	total_num_rows = BENCH_ALIGN_VAL_TO(height, MAX(capabilities->total_row_count_alignment, 1));
+
+	desc.width = width;
+	desc.height = height;
+	desc.num_padding_rows = total_num_rows - height;
+	desc.format = format;
+
+	/* Same layout as the blitter's own intermediate surfaces. The width
+	 * is rounded up to the subsampling, since odd sized frames still
+	 * have a chroma sample for the last column. With fully planar
+	 * formats, the chroma strides are derived from the luma stride,
+	 * so the luma stride is aligned such that the chroma strides are
+	 * aligned as well. Likewise, the number of chroma rows is rounded
+	 * up for the last row of odd sized frames. */
+	stride_alignment = MAX(capabilities->stride_alignment, 1) * ((fmt_info->num_planes == 3) ? fmt_info->x_subsampling : 1);
+	desc.plane_strides[0] = BENCH_ALIGN_VAL_TO(BENCH_ALIGN_VAL_TO(width, fmt_info->x_subsampling) * fmt_info->pixel_stride, stride_alignment);
+
+	/* Amphion tiled planes consist of whole tiles. Their stride is the
+	 * number of bytes of a row of packed samples (10 bits per sample
+	 * in the 10-bit variants), rounded up to whole tile columns, and
+	 * their number of rows is rounded up to whole tile rows. */
+	is_tiled = is_amphion_tiled_format(format, &is_10bit);
+	if (is_tiled)
+	{
+		int num_row_samples = BENCH_ALIGN_VAL_TO(width, fmt_info->x_subsampling);
+		int num_row_bytes = is_10bit ? ((num_row_samples * 10 + 7) / 8) : num_row_samples;
+		desc.plane_strides[0] = BENCH_ALIGN_VAL_TO(BENCH_ALIGN_VAL_TO(num_row_bytes, AMPHION_TILE_WIDTH), stride_alignment);
+		assert((desc.plane_strides[0] % AMPHION_TILE_WIDTH) == 0);
+	}
+
+	num_plane_rows = is_tiled ? BENCH_ALIGN_VAL_TO(total_num_rows, AMPHION_TILE_HEIGHT) : total_num_rows;
+	total_size = (size_t)(desc.plane_strides[0]) * num_plane_rows;
+
+	for (plane_nr = 1; plane_nr < fmt_info->num_planes; ++plane_nr)
+	{
+		desc.plane_strides[plane_nr] = fmt_info->is_semi_planar ? desc.plane_strides[0] : (desc.plane_strides[0] / fmt_info->x_subsampling);
+		num_plane_rows = (total_num_rows + fmt_info->y_subsampling - 1) / fmt_info->y_subsampling;
+		if (is_tiled)
+			num_plane_rows = BENCH_ALIGN_VAL_TO(num_plane_rows, AMPHION_TILE_HEIGHT);
+		plane_offsets[plane_nr] = total_size;
+		total_size += (size_t)(desc.plane_strides[plane_nr]) * num_plane_rows;
+	}
+
+	bench_surface->dma_buffer = imx_dma_buffer_allocate(allocator, total_size, 64, &error);
+	if (bench_surface->dma_buffer == NULL)
+	{
+		fprintf(stderr, "could not allocate %zu byte(s) for %s surface: %s (%d)\n", total_size, pixel_format_name(format), strerror(error), error);
+		goto error;
+	}
+
+	if (fill_pattern)
+	{
+		uint8_t *pixels = imx_dma_buffer_map(bench_surface->dma_buffer, IMX_DMA_BUFFER_MAPPING_FLAG_WRITE, &error);
+		size_t i;
+
+		if (pixels == NULL)
+		{
+			fprintf(stderr, "could not map %s surface: %s (%d)\n", pixel_format_name(format), strerror(error), error);
+			goto error;
+		}
+
+		/* Fill with a deterministic non-constant pattern so that
+		 * backends cannot take shortcuts on uniform content. */
+		for (i = 0; i < total_size; ++i)
+			pixels[i] = (uint8_t)((i * 7u) ^ (i >> 9));
+
+		imx_dma_buffer_unmap(bench_surface->dma_buffer);
+	}
+
+	bench_surface->surface = imx_2d_surface_create(&desc);
+	if (bench_surface->surface == NULL)
+	{
+		fprintf(stderr, "could not create %s surface\n", pixel_format_name(format));
+		goto error;
+	}
+
+	for (plane_nr = 0; plane_nr < fmt_info->num_planes; ++plane_nr)
+		imx_2d_surface_set_dma_buffer(bench_surface->surface, bench_surface->dma_buffer, plane_nr, plane_offsets[plane_nr]);
+
+	bench_surface->width = width;
+	bench_surface->height = height;
+
+	return TRUE;
+
+error:
+	bench_surface_free(bench_surface);
+	return FALSE;
+}
+
+
+
+
+/***********************/
+/****** STATISTICS *****/
+/***********************/
+
+
+typedef struct
+{
+	double total_seconds;
+	double min_usecs, p50_usecs, p90_usecs, p99_usecs, max_usecs;
+}
+BenchTimings;
+
+
+static double get_monotonic_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)(ts.tv_sec) + (double)(ts.tv_nsec) / 1e9;
+}
+
+
+static int compare_doubles(void const *first, void const *second)
+{
+	double a = *((double const *)first);
+	double b = *((double const *)second);
+	return (a > b) - (a < b);
+}
+
+
+/* Nearest-rank percentile of an already sorted array. */
+static double get_percentile(double const *sorted_values, int num_values, double percentile)
+{
+	int index = (int)ceil(percentile / 100.0 * num_values) - 1;
+	index = MAX(MIN(index, num_values - 1), 0);
+	return sorted_values[index];
+}
+
+
+static void compute_timings(BenchTimings *timings, double *latencies, int num_latencies)
+{
+	int i;
+
+	timings->total_seconds = 0.0;
+	for (i = 0; i < num_latencies; ++i)
+		timings->total_seconds += latencies[i];
+
+	qsort(latencies, num_latencies, sizeof(double), compare_doubles);
+
+	timings->min_usecs = latencies[0] * 1e6;
+	timings->p50_usecs = get_percentile(latencies, num_latencies, 50.0) * 1e6;
+	timings->p90_usecs = get_percentile(latencies, num_latencies, 90.0) * 1e6;
+	timings->p99_usecs = get_percentile(latencies, num_latencies, 99.0) * 1e6;
+	timings->max_usecs = latencies[num_latencies - 1] * 1e6;
+}
+
+
+
+
+/***********************/
+/****** JSON OUTPUT ****/
+/***********************/
+
+
+typedef struct
+{
+	FILE *file;
+	BOOL first_entry;
+}
+BenchOutput;
+
+
+static void output_begin_entry(BenchOutput *output)
+{
+	fprintf(output->file, "%s\n\t\t{", output->first_entry ? "" : ",");
+	output->first_entry = FALSE;
+}
+
+
+static void output_timings(BenchOutput *output, char const *ops_per_second_name, BenchTimings const *timings, int num_iterations, long num_pixels_per_op)
+{
+	double ops_per_second = (timings->total_seconds > 0.0) ? (num_iterations / timings->total_seconds) : 0.0;
+
+	fprintf(
+		output->file,
+		", \"%s\": %.2f, \"mpixels_per_second\": %.2f"
+		", \"latency_us\": { \"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f }",
+		ops_per_second_name,
+		ops_per_second,
+		ops_per_second * num_pixels_per_op / 1e6,
+		timings->min_usecs,
+		timings->p50_usecs,
+		timings->p90_usecs,
+		timings->p99_usecs,
+		timings->max_usecs
+	);
+}
+
+
+
+
+/***********************/
+/****** BENCHMARKS *****/
+/***********************/
+
+
+typedef struct
+{
+	Imx2dBlitter *blitter;
+	Imx2dHardwareCapabilities const *capabilities;
+	ImxDmaBufferAllocator *allocator;
+	int num_iterations;
+	int num_warmup_iterations;
+	BOOL use_plans;
+	/* If TRUE, the per-band timings of the last iteration are
+	 * added to the results. Only used with the software backend. */
+	BOOL output_band_timings;
+	double *latencies;
+}
+BenchContext;
+
+
+static void output_band_timings(BenchContext *context, BenchOutput *output)
+{
+#ifdef WITH_IMX2D_SW_BACKEND
+	Imx2dSwBandTiming const *band_timings;
+	int num_bands, band;
+
+	if (!context->output_band_timings)
+		return;
+
+	num_bands = imx_2d_backend_sw_blitter_get_last_band_timings(context->blitter, &band_timings);
+
+	fprintf(output->file, ", \"bands\": [");
+	for (band = 0; band < num_bands; ++band)
+	{
+		fprintf(
+			output->file,
+			"%s{ \"thread\": %d, \"start_ns\": %" PRId64 ", \"duration_ns\": %" PRId64 " }",
+			(band == 0) ? " " : ", ",
+			band_timings[band].thread_index, band_timings[band].start_offset, band_timings[band].duration
+		);
+	}
+	fprintf(output->file, " ]");
+#else
+	IMX_2D_UNUSED_PARAM(context);
+	IMX_2D_UNUSED_PARAM(output);
+#endif
+}
+
+
+static BOOL is_format_supported(Imx2dPixelFormat const *formats, int num_formats, Imx2dPixelFormat format)
+{
+	int i;
+	for (i = 0; i < num_formats; ++i)
+	{
+		if (formats[i] == format)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+
+static BOOL is_size_supported(Imx2dHardwareCapabilities const *capabilities, int width, int height)
+{
+	return (width >= capabilities->min_width) && (width <= capabilities->max_width)
+	    && (height >= capabilities->min_height) && (height <= capabilities->max_height)
+	    && (((width - capabilities->min_width) % MAX(capabilities->width_step_size, 1)) == 0)
+	    && (((height - capabilities->min_height) % MAX(capabilities->height_step_size, 1)) == 0);
+}
+
+
+static BOOL run_blit_iteration(BenchContext *context, BenchSurface *source, BenchSurface *dest, Imx2dBlitParams const *params, Imx2dBlitPlan *plan)
+{
+	BOOL ok;
+
+	if (!imx_2d_blitter_start(context->blitter, dest->surface))
+		return FALSE;
+
+	if (plan != NULL)
+		ok = imx_2d_blitter_do_planned_blit(context->blitter, plan);
+	else
+		ok = imx_2d_blitter_do_blit(context->blitter, source->surface, params);
+
+	/* Always finish, even if the blit failed, to
+	 * keep the blitter in a consistent state. */
+	if (!imx_2d_blitter_finish(context->blitter))
+		ok = FALSE;
+
+	return ok;
+}
+
+
+static char const * run_blit_benchmark(BenchContext *context, BenchSurface *source, BenchSurface *dest, Imx2dRotation rotation, int alpha, int margin_size, BenchTimings *timings)
+{
+	Imx2dBlitParams params;
+	Imx2dRegion dest_region;
+	Imx2dBlitMargin margin;
+	Imx2dBlitPlan *plan = NULL;
+	char const *failure = NULL;
+	int i;
+
+	dest_region.x1 = margin_size;
+	dest_region.y1 = margin_size;
+	dest_region.x2 = dest->width - margin_size;
+	dest_region.y2 = dest->height - margin_size;
+
+	margin.left_margin = margin.top_margin = margin.right_margin = margin.bottom_margin = margin_size;
+	margin.color = MARGIN_COLOR;
+
+	memset(&params, 0, sizeof(params));
+	params.source_region = NULL;
+	params.dest_region = &dest_region;
+	params.rotation = rotation;
+	params.margin = (margin_size > 0) ? &margin : NULL;
+	params.alpha = alpha;
+
+	if (context->use_plans)
+	{
+		plan = imx_2d_blit_plan_create(context->blitter, source->surface, dest->surface, &params);
+		if (plan == NULL)
+			return "could not create blit plan";
+	}
+
+	for (i = 0; i < context->num_warmup_iterations; ++i)
+	{
+		if (!run_blit_iteration(context, source, dest, &params, plan))
+		{
+			failure = "blit failed";
+			goto finish;
+		}
+	}
+
+	for (i = 0; i < context->num_iterations; ++i)
+	{
+		double start_time = get_monotonic_seconds();
+
+		if (!run_blit_iteration(context, source, dest, &params, plan))
+		{
+			failure = "blit failed";
+			goto finish;
+		}
+
+		context->latencies[i] = get_monotonic_seconds() - start_time;
+	}
+
+	compute_timings(timings, context->latencies, context->num_iterations);
+
+finish:
+	imx_2d_blit_plan_destroy(plan);
+	return failure;
+}
+
+
+static BOOL run_fill_iteration(BenchContext *context, BenchSurface *dest, Imx2dRegion const *region)
+{
+	BOOL ok;
+
+	if (!imx_2d_blitter_start(context->blitter, dest->surface))
+		return FALSE;
+
+	ok = imx_2d_blitter_fill_region(context->blitter, region, FILL_COLOR);
+
+	if (!imx_2d_blitter_finish(context->blitter))
+		ok = FALSE;
+
+	return ok;
+}
+
+
+static char const * run_fill_benchmark(BenchContext *context, BenchSurface *dest, BenchTimings *timings)
+{
+	Imx2dRegion region;
+	int i;
+
+	region.x1 = 0;
+	region.y1 = 0;
+	region.x2 = dest->width;
+	region.y2 = dest->height;
+
+	for (i = 0; i < context->num_warmup_iterations; ++i)
+	{
+		if (!run_fill_iteration(context, dest, &region))
+			return "fill failed";
+	}
+
+	for (i = 0; i < context->num_iterations; ++i)
+	{
+		double start_time = get_monotonic_seconds();
+
+		if (!run_fill_iteration(context, dest, &region))
+			return "fill failed";
+
+		context->latencies[i] = get_monotonic_seconds() - start_time;
+	}
+
+	compute_timings(timings, context->latencies, context->num_iterations);
+
+	return NULL;
+}
+
+
+
+
+/***********************/
+/****** COMMAND LINE ***/
+/***********************/
+
+
+typedef struct
+{
+	int width, height;
+}
+BenchSize;
+
+
+typedef struct
+{
+	char const *backend_name;
+	char const *allocator_name;
+	char const *output_filename;
+
+	Imx2dPixelFormat source_formats[MAX_LIST_ENTRIES];
+	int num_source_formats;
+	Imx2dPixelFormat dest_formats[MAX_LIST_ENTRIES];
+	int num_dest_formats;
+	BenchSize source_sizes[MAX_LIST_ENTRIES];
+	int num_source_sizes;
+	BenchSize dest_sizes[MAX_LIST_ENTRIES];
+	int num_dest_sizes;
+	Imx2dRotation rotations[MAX_LIST_ENTRIES];
+	int num_rotations;
+	int alphas[MAX_LIST_ENTRIES];
+	int num_alphas;
+	int margins[MAX_LIST_ENTRIES];
+	int num_margins;
+
+	int num_iterations;
+	int num_warmup_iterations;
+	int num_threads;
+	char const *cpu_affinity;
+	BOOL use_plans;
+	BOOL skip_fills;
+	BOOL band_timings;
+	BOOL verbose;
+}
+BenchOptions;
+
+
+typedef BOOL (*BenchParseEntryFunc)(char const *entry, void *values, int index);
+
+
+static BOOL parse_list(char const *option_name, char const *list, BenchParseEntryFunc parse_entry, void *values, int *num_values)
+{
+	char *list_copy = strdup(list);
+	char *saveptr = NULL;
+	char *entry;
+	BOOL ok = TRUE;
+
+	*num_values = 0;
+
+	for (entry = strtok_r(list_copy, ",", &saveptr); entry != NULL; entry = strtok_r(NULL, ",", &saveptr))
+	{
+		if (*num_values >= MAX_LIST_ENTRIES)
+		{
+			fprintf(stderr, "too many entries for --%s (maximum is %d)\n", option_name, MAX_LIST_ENTRIES);
+			ok = FALSE;
+			break;
+		}
+
+		if (!parse_entry(entry, values, *num_values))
+		{
+			fprintf(stderr, "invalid entry \"%s\" for --%s\n", entry, option_name);
+			ok = FALSE;
+			break;
+		}
+
+		(*num_values)++;
+	}
+
+	if (ok && (*num_values == 0))
+	{
+		fprintf(stderr, "--%s requires at least one entry\n", option_name);
+		ok = FALSE;
+	}
+
+	free(list_copy);
+	return ok;
+}
+
+
+static BOOL parse_pixel_format_entry(char const *entry, void *values, int index)
+{
+	int i;
+	for (i = 0; pixel_format_names[i].name != NULL; ++i)
+	{
+		if (strcmp(pixel_format_names[i].name, entry) == 0)
+		{
+			((Imx2dPixelFormat *)values)[index] = pixel_format_names[i].format;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+
+static BOOL parse_size_entry(char const *entry, void *values, int index)
+{
+	BenchSize *size = &(((BenchSize *)values)[index]);
+	char trailing;
+
+	if (sscanf(entry, "%dx%d%c", &(size->width), &(size->height), &trailing) != 2)
+		return FALSE;
+
+	return (size->width > 0) && (size->height > 0);
+}
+
+
+static BOOL parse_rotation_entry(char const *entry, void *values, int index)
+{
+	int i;
+	for (i = 0; rotation_names[i].name != NULL; ++i)
+	{
+		if (strcmp(rotation_names[i].name, entry) == 0)
+		{
+			((Imx2dRotation *)values)[index] = rotation_names[i].rotation;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+
+static BOOL parse_int_entry(char const *entry, int min_value, int max_value, int *value)
+{
+	char *endptr;
+	long parsed;
+
+	errno = 0;
+	parsed = strtol(entry, &endptr, 10);
+	if ((errno != 0) || (endptr == entry) || (*endptr != '\0') || (parsed < min_value) || (parsed > max_value))
+		return FALSE;
+
+	*value = (int)parsed;
+	return TRUE;
+}
+
+
+static BOOL parse_alpha_entry(char const *entry, void *values, int index)
+{
+	return parse_int_entry(entry, 0, 255, &(((int *)values)[index]));
+}
+
+
+static BOOL parse_margin_entry(char const *entry, void *values, int index)
+{
+	return parse_int_entry(entry, 0, INT_MAX, &(((int *)values)[index]));
+}
+
+
+static void print_usage(char const *program_name)
+{
+	int i;
+
+	fprintf(stderr, "Usage: %s [OPTION...]\n\n", program_name);
+	fprintf(stderr, "Measures imx2d blitter throughput and latency and prints the results as JSON.\n\n");
+	fprintf(stderr, "  -b, --backend=NAME          Blitter backend to use (default: first available)\n");
+	fprintf(stderr, "  -a, --allocator=NAME        DMA buffer allocator: \"dma\", \"heap\" or \"auto\" (default: auto;\n");
+	fprintf(stderr, "                              uses heap memory with the software backend and DMA memory otherwise)\n");
+	fprintf(stderr, "  -s, --source-formats=LIST   Comma separated source pixel formats (default: %s)\n", DEFAULT_SOURCE_FORMATS);
+	fprintf(stderr, "  -d, --dest-formats=LIST     Comma separated destination pixel formats (default: %s)\n", DEFAULT_DEST_FORMATS);
+	fprintf(stderr, "  -S, --source-sizes=LIST     Comma separated WIDTHxHEIGHT source sizes (default: %s)\n", DEFAULT_SOURCE_SIZES);
+	fprintf(stderr, "  -D, --dest-sizes=LIST       Comma separated WIDTHxHEIGHT destination sizes (default: %s)\n", DEFAULT_DEST_SIZES);
+	fprintf(stderr, "  -r, --rotations=LIST        Comma separated rotations (default: %s)\n", DEFAULT_ROTATIONS);
+	fprintf(stderr, "  -A, --alphas=LIST           Comma separated alpha values in the 0-255 range (default: %s)\n", DEFAULT_ALPHAS);
+	fprintf(stderr, "  -m, --margins=LIST          Comma separated margin sizes in pixels (default: %s)\n", DEFAULT_MARGINS);
+	fprintf(stderr, "  -n, --iterations=N          Number of measured iterations per configuration (default: %d)\n", DEFAULT_NUM_ITERATIONS);
+	fprintf(stderr, "  -w, --warmup=N              Number of unmeasured warmup iterations (default: %d)\n", DEFAULT_NUM_WARMUP_ITERATIONS);
+	fprintf(stderr, "  -p, --plans                 Use precomputed blit plans\n");
+	fprintf(stderr, "  -t, --threads=N             Number of threads of the software backend; 0 = one per online\n");
+	fprintf(stderr, "                              CPU core (default: 1)\n");
+	fprintf(stderr, "  -c, --cpu-affinity=LIST     CPUs to pin the software backend worker threads to, like \"0-3,6\",\n");
+	fprintf(stderr, "                              or \"big\" for the cores with the highest capacity (default: no pinning)\n");
+	fprintf(stderr, "  -B, --band-timings          Add per-band timings of the software backend to the results\n");
+	fprintf(stderr, "  -F, --no-fills              Skip the fill benchmarks\n");
+	fprintf(stderr, "  -o, --output=FILE           Write JSON to FILE instead of stdout\n");
+	fprintf(stderr, "  -v, --verbose               Print imx2d log output to stderr\n");
+	fprintf(stderr, "  -h, --help                  Show this help\n");
+
+	fprintf(stderr, "\nAvailable backends:");
+	for (i = 0; backends[i].name != NULL; ++i)
+		fprintf(stderr, " %s", backends[i].name);
+
+	fprintf(stderr, "\nPixel formats:");
+	for (i = 0; pixel_format_names[i].name != NULL; ++i)
+		fprintf(stderr, " %s", pixel_format_names[i].name);
+
+	fprintf(stderr, "\nRotations:");
+	for (i = 0; rotation_names[i].name != NULL; ++i)
+		fprintf(stderr, " %s", rotation_names[i].name);
+
+	fprintf(stderr, "\n");
+}
+
+
+static BOOL parse_options(BenchOptions *options, int argc, char *argv[])
+{
+	static struct option const long_options[] =
+	{
+		{ "backend", required_argument, NULL, 'b' },
+		{ "allocator", required_argument, NULL, 'a' },
+		{ "source-formats", required_argument, NULL, 's' },
+		{ "dest-formats", required_argument, NULL, 'd' },
+		{ "source-sizes", required_argument, NULL, 'S' },
+		{ "dest-sizes", required_argument, NULL, 'D' },
+		{ "rotations", required_argument, NULL, 'r' },
+		{ "alphas", required_argument, NULL, 'A' },
+		{ "margins", required_argument, NULL, 'm' },
+		{ "iterations", required_argument, NULL, 'n' },
+		{ "warmup", required_argument, NULL, 'w' },
+		{ "plans", no_argument, NULL, 'p' },
+		{ "threads", required_argument, NULL, 't' },
+		{ "cpu-affinity", required_argument, NULL, 'c' },
+		{ "band-timings", no_argument, NULL, 'B' },
+		{ "no-fills", no_argument, NULL, 'F' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "verbose", no_argument, NULL, 'v' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+
+	char const *source_formats = DEFAULT_SOURCE_FORMATS;
+	char const *dest_formats = DEFAULT_DEST_FORMATS;
+	char const *source_sizes = DEFAULT_SOURCE_SIZES;
+	char const *dest_sizes = DEFAULT_DEST_SIZES;
+	char const *rotations = DEFAULT_ROTATIONS;
+	char const *alphas = DEFAULT_ALPHAS;
+	char const *margins = DEFAULT_MARGINS;
+	int opt;
+
+	memset(options, 0, sizeof(BenchOptions));
+	options->allocator_name = "auto";
+	options->num_iterations = DEFAULT_NUM_ITERATIONS;
+	options->num_warmup_iterations = DEFAULT_NUM_WARMUP_ITERATIONS;
+	options->num_threads = 1;
+
+	while ((opt = getopt_long(argc, argv, "b:a:s:d:S:D:r:A:m:n:w:pt:c:BFo:vh", long_options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+			case 'b': options->backend_name = optarg; break;
+			case 'a': options->allocator_name = optarg; break;
+			case 's': source_formats = optarg; break;
+			case 'd': dest_formats = optarg; break;
+			case 'S': source_sizes = optarg; break;
+			case 'D': dest_sizes = optarg; break;
+			case 'r': rotations = optarg; break;
+			case 'A': alphas = optarg; break;
+			case 'm': margins = optarg; break;
+			case 'p': options->use_plans = TRUE; break;
+			case 'c': options->cpu_affinity = optarg; break;
+			case 'B': options->band_timings = TRUE; break;
+			case 'F': options->skip_fills = TRUE; break;
+			case 'o': options->output_filename = optarg; break;
+			case 'v': options->verbose = TRUE; break;
+
+			case 'n':
+				if (!parse_int_entry(optarg, 1, INT_MAX, &(options->num_iterations)))
+				{
+					fprintf(stderr, "invalid number of iterations \"%s\"\n", optarg);
+					return FALSE;
+				}
+				break;
+
+			case 'w':
+				if (!parse_int_entry(optarg, 0, INT_MAX, &(options->num_warmup_iterations)))
+				{
+					fprintf(stderr, "invalid number of warmup iterations \"%s\"\n", optarg);
+					return FALSE;
+				}
+				break;
+
+			case 't':
+				if (!parse_int_entry(optarg, 0, INT_MAX, &(options->num_threads)))
+				{
+					fprintf(stderr, "invalid number of threads \"%s\"\n", optarg);
+					return FALSE;
+				}
+				break;
+
+			case 'h':
+			default:
+				print_usage(argv[0]);
+				return FALSE;
+		}
+	}
+
+	if (optind < argc)
+	{
+		fprintf(stderr, "unexpected argument \"%s\"\n", argv[optind]);
+		print_usage(argv[0]);
+		return FALSE;
+	}
+
+	return parse_list("source-formats", source_formats, parse_pixel_format_entry, options->source_formats, &(options->num_source_formats))
+	    && parse_list("dest-formats", dest_formats, parse_pixel_format_entry, options->dest_formats, &(options->num_dest_formats))
+	    && parse_list("source-sizes", source_sizes, parse_size_entry, options->source_sizes, &(options->num_source_sizes))
+	    && parse_list("dest-sizes", dest_sizes, parse_size_entry, options->dest_sizes, &(options->num_dest_sizes))
+	    && parse_list("rotations", rotations, parse_rotation_entry, options->rotations, &(options->num_rotations))
+	    && parse_list("alphas", alphas, parse_alpha_entry, options->alphas, &(options->num_alphas))
+	    && parse_list("margins", margins, parse_margin_entry, options->margins, &(options->num_margins));
+}
+
+
+
+
+/***********************/
+/****** MAIN ***********/
+/***********************/
+
+
+static void bench_logging_function(Imx2dLogLevel level, char const *file, int const line, char const *function_name, const char *format, ...)
+{
+	static char const *level_names[] = { "ERROR", "WARNING", "INFO", "DEBUG", "TRACE" };
+	va_list args;
+
+	fprintf(stderr, "[%s] %s:%d %s: ", level_names[level], file, line, function_name);
+
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+
+	fprintf(stderr, "\n");
+}
+
+
+static void run_blit_matrix(BenchContext *context, BenchOptions const *options, BenchOutput *output)
+{
+	Imx2dHardwareCapabilities const *capabilities = context->capabilities;
+	int src_fmt_idx, dest_fmt_idx, src_size_idx, dest_size_idx;
+	int rotation_idx, alpha_idx, margin_idx;
+
+	for (src_fmt_idx = 0; src_fmt_idx < options->num_source_formats; ++src_fmt_idx)
+	for (src_size_idx = 0; src_size_idx < options->num_source_sizes; ++src_size_idx)
+	{
+		Imx2dPixelFormat source_format = options->source_formats[src_fmt_idx];
+		BenchSize const *source_size = &(options->source_sizes[src_size_idx]);
+		BenchSurface source;
+		char const *source_skip_reason = NULL;
+
+		memset(&source, 0, sizeof(source));
+
+		if (!is_format_supported(capabilities->supported_source_pixel_formats, capabilities->num_supported_source_pixel_formats, source_format))
+			source_skip_reason = "source format not supported by backend";
+		else if (!is_size_supported(capabilities, source_size->width, source_size->height))
+			source_skip_reason = "source size not supported by backend";
+		else if (!bench_surface_alloc(&source, context->allocator, capabilities, source_format, source_size->width, source_size->height, TRUE))
+			source_skip_reason = "could not allocate source surface";
+
+		for (dest_fmt_idx = 0; dest_fmt_idx < options->num_dest_formats; ++dest_fmt_idx)
+		for (dest_size_idx = 0; dest_size_idx < options->num_dest_sizes; ++dest_size_idx)
+		{
+			Imx2dPixelFormat dest_format = options->dest_formats[dest_fmt_idx];
+			BenchSize const *dest_size = &(options->dest_sizes[dest_size_idx]);
+			BenchSurface dest;
+			char const *dest_skip_reason = source_skip_reason;
+
+			memset(&dest, 0, sizeof(dest));
+
+			if (dest_skip_reason != NULL)
+				;
+			else if (!is_format_supported(capabilities->supported_dest_pixel_formats, capabilities->num_supported_dest_pixel_formats, dest_format))
+				dest_skip_reason = "destination format not supported by backend";
+			else if (!is_size_supported(capabilities, dest_size->width, dest_size->height))
+				dest_skip_reason = "destination size not supported by backend";
+			else if (!bench_surface_alloc(&dest, context->allocator, capabilities, dest_format, dest_size->width, dest_size->height, FALSE))
+				dest_skip_reason = "could not allocate destination surface";
+
+			for (rotation_idx = 0; rotation_idx < options->num_rotations; ++rotation_idx)
+			for (alpha_idx = 0; alpha_idx < options->num_alphas; ++alpha_idx)
+			for (margin_idx = 0; margin_idx < options->num_margins; ++margin_idx)
+			{
+				Imx2dRotation rotation = options->rotations[rotation_idx];
+				int alpha = options->alphas[alpha_idx];
+				int margin_size = options->margins[margin_idx];
+				char const *failure = dest_skip_reason;
+				BenchTimings timings;
+
+				if ((failure == NULL) && (((margin_size * 2) >= dest_size->width) || ((margin_size * 2) >= dest_size->height)))
+					failure = "margin does not fit in destination";
+
+				if (failure == NULL)
+					failure = run_blit_benchmark(context, &source, &dest, rotation, alpha, margin_size, &timings);
+
+				output_begin_entry(output);
+				fprintf(
+					output->file,
+					" \"source_format\": \"%s\", \"source_width\": %d, \"source_height\": %d"
+					", \"dest_format\": \"%s\", \"dest_width\": %d, \"dest_height\": %d"
+					", \"rotation\": \"%s\", \"alpha\": %d, \"margin\": %d",
+					pixel_format_name(source_format), source_size->width, source_size->height,
+					pixel_format_name(dest_format), dest_size->width, dest_size->height,
+					rotation_name(rotation), alpha, margin_size
+				);
+
+				if (failure == NULL)
+				{
+					long num_blitted_pixels = (long)(dest_size->width - margin_size * 2) * (dest_size->height - margin_size * 2);
+					output_timings(output, "blits_per_second", &timings, context->num_iterations, num_blitted_pixels);
+					output_band_timings(context, output);
+				}
+				else
+					fprintf(output->file, ", \"skipped\": \"%s\"", failure);
+
+				fprintf(output->file, " }");
+				fflush(output->file);
+			}
+
+			bench_surface_free(&dest);
+		}
+
+		bench_surface_free(&source);
+	}
+}
+
+
+static void run_fill_matrix(BenchContext *context, BenchOptions const *options, BenchOutput *output)
+{
+	Imx2dHardwareCapabilities const *capabilities = context->capabilities;
+	int dest_fmt_idx, dest_size_idx;
+
+	for (dest_fmt_idx = 0; dest_fmt_idx < options->num_dest_formats; ++dest_fmt_idx)
+	for (dest_size_idx = 0; dest_size_idx < options->num_dest_sizes; ++dest_size_idx)
+	{
+		Imx2dPixelFormat dest_format = options->dest_formats[dest_fmt_idx];
+		BenchSize const *dest_size = &(options->dest_sizes[dest_size_idx]);
+		BenchSurface dest;
+		char const *failure = NULL;
+		BenchTimings timings;
+
+		memset(&dest, 0, sizeof(dest));
+
+		if (!is_format_supported(capabilities->supported_dest_pixel_formats, capabilities->num_supported_dest_pixel_formats, dest_format))
+			failure = "destination format not supported by backend";
+		else if (!is_size_supported(capabilities, dest_size->width, dest_size->height))
+			failure = "destination size not supported by backend";
+		else if (!bench_surface_alloc(&dest, context->allocator, capabilities, dest_format, dest_size->width, dest_size->height, FALSE))
+			failure = "could not allocate destination surface";
+		else
+			failure = run_fill_benchmark(context, &dest, &timings);
+
+		output_begin_entry(output);
+		fprintf(
+			output->file,
+			" \"dest_format\": \"%s\", \"dest_width\": %d, \"dest_height\": %d",
+			pixel_format_name(dest_format), dest_size->width, dest_size->height
+		);
+
+		if (failure == NULL)
+		{
+			output_timings(output, "fills_per_second", &timings, context->num_iterations, (long)(dest_size->width) * dest_size->height);
+			output_band_timings(context, output);
+		}
+		else
+			fprintf(output->file, ", \"skipped\": \"%s\"", failure);
+
+		fprintf(output->file, " }");
+		fflush(output->file);
+
+		bench_surface_free(&dest);
+	}
+}
+
+
+int main(int argc, char *argv[])
+{
+	BenchOptions options;
+	BenchContext context;
+	BenchOutput output;
+	BenchBackend const *backend = NULL;
+	BOOL use_heap_allocator;
+	BOOL is_sw_backend;
+	int exit_code = EXIT_FAILURE;
+	int error = 0;
+	int i;
+
+	memset(&context, 0, sizeof(context));
+	memset(&output, 0, sizeof(output));
+
+	if (!parse_options(&options, argc, argv))
+		return EXIT_FAILURE;
+
+	if (options.verbose)
+	{
+		imx_2d_set_logging_function(bench_logging_function);
+		imx_2d_set_logging_threshold(IMX_2D_LOG_LEVEL_DEBUG);
+	}
+
+	for (i = 0; backends[i].name != NULL; ++i)
+	{
+		if ((options.backend_name == NULL) || (strcmp(options.backend_name, backends[i].name) == 0))
+		{
+			backend = &(backends[i]);
+			break;
+		}
+	}
+
+	if (backend == NULL)
+	{
+		if (options.backend_name != NULL)
+			fprintf(stderr, "backend \"%s\" is not available\n", options.backend_name);
+		else
+			fprintf(stderr, "no imx2d backend available\n");
+		goto finish;
+	}
+
+	if (strcmp(options.allocator_name, "auto") == 0)
+		use_heap_allocator = (strcmp(backend->name, "sw") == 0);
+	else if (strcmp(options.allocator_name, "heap") == 0)
+		use_heap_allocator = TRUE;
+	else if (strcmp(options.allocator_name, "dma") == 0)
+		use_heap_allocator = FALSE;
+	else
+	{
+		fprintf(stderr, "unknown allocator \"%s\"\n", options.allocator_name);
+		goto finish;
+	}
+
+	if (use_heap_allocator)
+	{
+		context.allocator = &bench_heap_allocator;
+	}
+	else
+	{
+		context.allocator = imx_dma_buffer_allocator_new(&error);
+		if (context.allocator == NULL)
+		{
+			fprintf(stderr, "could not create DMA buffer allocator: %s (%d)\n", strerror(error), error);
+			goto finish;
+		}
+	}
+
+	is_sw_backend = (strcmp(backend->name, "sw") == 0);
+
+	if (!is_sw_backend && ((options.num_threads != 1) || (options.cpu_affinity != NULL) || options.band_timings))
+	{
+		fprintf(stderr, "threads, CPU affinity and band timings are only supported by the sw backend\n");
+		goto finish;
+	}
+
+#ifdef WITH_IMX2D_SW_BACKEND
+	if (is_sw_backend)
+	{
+		uint64_t cpu_affinity_mask;
+
+		if (!imx_2d_backend_sw_parse_cpu_affinity(options.cpu_affinity, &cpu_affinity_mask))
+		{
+			fprintf(stderr, "invalid CPU affinity \"%s\"\n", options.cpu_affinity);
+			goto finish;
+		}
+
+		context.blitter = imx_2d_backend_sw_blitter_create_threaded(options.num_threads, cpu_affinity_mask);
+		context.output_band_timings = options.band_timings;
+	}
+	else
+#endif
+		context.blitter = backend->create();
+
+	if (context.blitter == NULL)
+	{
+		fprintf(stderr, "could not create %s blitter\n", backend->name);
+		goto finish;
+	}
+
+	context.capabilities = imx_2d_blitter_get_hardware_capabilities(context.blitter);
+	context.num_iterations = options.num_iterations;
+	context.num_warmup_iterations = options.num_warmup_iterations;
+	context.use_plans = options.use_plans;
+
+	context.latencies = malloc(sizeof(double) * options.num_iterations);
+	if (context.latencies == NULL)
+	{
+		fprintf(stderr, "could not allocate latency array\n");
+		goto finish;
+	}
+
+	if (options.output_filename != NULL)
+	{
+		output.file = fopen(options.output_filename, "w");
+		if (output.file == NULL)
+		{
+			fprintf(stderr, "could not open \"%s\" for writing: %s (%d)\n", options.output_filename, strerror(errno), errno);
+			goto finish;
+		}
+	}
+	else
+		output.file = stdout;
+
+	fprintf(output.file, "{\n");
+	fprintf(output.file, "\t\"backend\": \"%s\",\n", backend->name);
+	fprintf(output.file, "\t\"allocator\": \"%s\",\n", use_heap_allocator ? "heap" : "dma");
+	fprintf(output.file, "\t\"iterations\": %d,\n", options.num_iterations);
+	fprintf(output.file, "\t\"warmup_iterations\": %d,\n", options.num_warmup_iterations);
+	fprintf(output.file, "\t\"plans\": %s,\n", options.use_plans ? "true" : "false");
+#ifdef WITH_IMX2D_SW_BACKEND
+	if (is_sw_backend)
+		fprintf(output.file, "\t\"threads\": %d,\n", imx_2d_backend_sw_blitter_get_num_threads(context.blitter));
+#endif
+
+	fprintf(output.file, "\t\"blits\": [");
+	output.first_entry = TRUE;
+	run_blit_matrix(&context, &options, &output);
+	fprintf(output.file, "\n\t],\n");
+
+	fprintf(output.file, "\t\"fills\": [");
+	output.first_entry = TRUE;
+	if (!options.skip_fills)
+		run_fill_matrix(&context, &options, &output);
+	fprintf(output.file, "\n\t]\n");
+
+	fprintf(output.file, "}\n");
+
+	exit_code = EXIT_SUCCESS;
+
+finish:
+	if ((output.file != NULL) && (output.file != stdout))
+		fclose(output.file);
+	free(context.latencies);
+	if (context.blitter != NULL)
+		imx_2d_blitter_destroy(context.blitter);
+	if ((context.allocator != NULL) && (context.allocator != &bench_heap_allocator))
+		imx_dma_buffer_allocator_destroy(context.allocator);
+
+	return exit_code;
+}
@@ -1,7 +1,11 @@
+/* Needed for clock_gettime() */
+#define _POSIX_C_SOURCE 199309L
+
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <time.h>
 #include "imx2d.h"
 #include "imx2d_priv.h"
 
@@ -60,6 +64,31 @@ char const * imx_2d_rotation_to_string(Imx2dRotation rotation)
 }
 
 
+char const * imx_2d_color_matrix_to_string(Imx2dColorMatrix matrix)
+{
+	switch (matrix)
+	{
+		case IMX_2D_COLOR_MATRIX_DEFAULT: return "default";
+		case IMX_2D_COLOR_MATRIX_BT601: return "BT.601";
+		case IMX_2D_COLOR_MATRIX_BT709: return "BT.709";
+		case IMX_2D_COLOR_MATRIX_BT2020: return "BT.2020";
+		default: return "<unknown>";
+	}
+}
+
+
+char const * imx_2d_color_range_to_string(Imx2dColorRange range)
+{
+	switch (range)
+	{
+		case IMX_2D_COLOR_RANGE_DEFAULT: return "default";
+		case IMX_2D_COLOR_RANGE_LIMITED: return "limited";
+		case IMX_2D_COLOR_RANGE_FULL: return "full";
+		default: return "<unknown>";
+	}
+}
+
+
 Imx2dPixelFormatInfo const * imx_2d_get_pixel_format_info(Imx2dPixelFormat format)
 {
 #define PIXEL_FORMAT_DESC(DESC, FMT, NUM_PLANES, PIXEL_STRIDE, X_SS, Y_SS, IS_SEMI_PLANAR, IS_TILED) \
@@ -206,6 +235,9 @@ Imx2dSurface* imx_2d_surface_create(Imx2dSurfaceDesc const *desc)
 
 	memset(&(surface->region), 0, sizeof(surface->region));
 
+	surface->damage_tracking = FALSE;
+	surface->num_damage_regions = 0;
+
 	if (desc != NULL)
 		imx_2d_surface_set_desc(surface, desc);
 
@@ -267,428 +299,1659 @@ Imx2dRegion const * imx_2d_surface_get_region(Imx2dSurface *surface)
 }
 
 
+static int64_t get_region_area(Imx2dRegion const *region)
+{
+	return (int64_t)(region->x2 - region->x1) * (region->y2 - region->y1);
+}
 
 
-void imx_2d_blitter_destroy(Imx2dBlitter *blitter)
+static BOOL region_is_empty(Imx2dRegion const *region)
 {
-	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->destroy != NULL));
-	blitter->blitter_class->destroy(blitter);
+	return (region->x1 >= region->x2) || (region->y1 >= region->y2);
 }
 
 
-int imx_2d_blitter_start(Imx2dBlitter *blitter, Imx2dSurface *dest)
+static void remove_damage_region(Imx2dSurface *surface, int index)
 {
-	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->start != NULL));
-	assert(dest != NULL);
-	blitter->dest = dest;
-	return blitter->blitter_class->start(blitter);
+	surface->num_damage_regions--;
+	if (index != surface->num_damage_regions)
+		surface->damage_regions[index] = surface->damage_regions[surface->num_damage_regions];
 }
 
 
-int imx_2d_blitter_finish(Imx2dBlitter *blitter)
+void imx_2d_surface_set_damage_tracking(Imx2dSurface *surface, int enabled)
 {
-	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->start != NULL));
-	return blitter->blitter_class->finish(blitter);
+	assert(surface != NULL);
+	surface->damage_tracking = !!enabled;
 }
 
 
-int imx_2d_blitter_do_blit(Imx2dBlitter *blitter, Imx2dSurface *source, Imx2dBlitParams const *params)
+int imx_2d_surface_get_damage_tracking(Imx2dSurface *surface)
 {
-	static Imx2dBlitParams const default_params =
-	{
-		.source_region = NULL,
-		.dest_region = NULL,
-		.rotation = IMX_2D_ROTATION_NONE,
-		.alpha = 255
-	};
+	assert(surface != NULL);
+	return surface->damage_tracking;
+}
 
-	Imx2dBlitParams const *params_in_use = (params != NULL) ? params : &default_params;
 
-	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->do_blit != NULL));
+void imx_2d_surface_add_damage_region(Imx2dSurface *surface, Imx2dRegion const *region)
+{
+	Imx2dRegion new_region;
+	int i;
 
-	if (params_in_use->alpha == 0)
-	{
-		/* If alpha is set to 0, then the blitting would effectively
-		 * do nothing due to the pixels being 100% translucent. */
-		IMX_2D_LOG(TRACE, "not blitting because params alpha value is 0");
-		return TRUE;
-	}
-	else if (params_in_use->alpha < 0)
-	{
-		IMX_2D_LOG(ERROR, "attempting to blit with alpha value %u; minimum allowed value is 0", params_in_use->alpha);
-		return FALSE;
-	}
-	else if (params_in_use->alpha > 255)
-	{
-		IMX_2D_LOG(ERROR, "attempting to blit with alpha value %u; maximum allowed value is 255", params_in_use->alpha);
-		return FALSE;
-	}
+	assert(surface != NULL);
 
-	if (params_in_use->dest_region != NULL)
-	{
-		/* dest_region is set, so we need to check if and to what
-		 * degree dest_region is inside the dest surface. */
+	if (region != NULL)
+		imx_2d_region_intersect(&new_region, region, &(surface->region));
+	else
+		new_region = surface->region;
 
-		Imx2dRegionInclusion dest_region_inclusion = IMX_2D_REGION_INCLUSION_FULL;
-		Imx2dRegion const *expanded_dest_region_to_use = NULL;
-		Imx2dRegion full_expanded_dest_region;
-		Imx2dRegion clipped_expanded_dest_region;
-		uint32_t margin_fill_color = 0x00000000;
+	if (region_is_empty(&new_region))
+		return;
 
-		/* Get the margin and look at its alpha value. If it is 0,
-		 * then the margin cannot be visible, so we disable it.
-		 * Otherwise, modulate the alpha value with the alpha value
-		 * from the params. If the result from that is 0, again,
-		 * disable the margin. */
-		Imx2dBlitMargin const *margin = params_in_use->margin;
-		if (margin != NULL)
+	while (TRUE)
+	{
+		BOOL merged = FALSE;
+
+		/* Merge all existing regions that overlap with the new one.
+		 * Merging can make the new region overlap with regions that
+		 * were checked earlier, so start over after each merge. */
+		for (i = 0; i < surface->num_damage_regions; ++i)
 		{
-			int margin_alpha = (margin->color >> 24) & 0xFF;
-			if (margin_alpha != 0)
-			{
-				int combined_alpha = margin_alpha * params_in_use->alpha / 255;
-				IMX_2D_LOG(
-					TRACE,
-					"global alpha: %d  margin alpha: %d  combined alpha: %d",
-					params_in_use->alpha,
-					margin_alpha,
-					combined_alpha
-				);
-				if (combined_alpha != 0)
-				{
-					uint32_t orig_margin_color_without_alpha = margin->color & 0x00FFFFFF;
-					margin_fill_color = orig_margin_color_without_alpha | (((uint32_t)combined_alpha) << 24);
-					IMX_2D_LOG(
-						TRACE,
-						"merging margin fill color %#06" PRIx32 " and combined alpha %d to new margin fill color %#08" PRIx32,
-						orig_margin_color_without_alpha,
-						combined_alpha,
-						margin_fill_color
-					);
-				}
-				else
-				{
-					IMX_2D_LOG(TRACE, "combined alpha is 0; disabling margin");
-					margin = NULL;
-				}
-			}
-			else
+			Imx2dRegion intersection;
+
+			imx_2d_region_intersect(&intersection, &new_region, &(surface->damage_regions[i]));
+			if (!region_is_empty(&intersection))
 			{
-				IMX_2D_LOG(TRACE, "margin alpha is 0; disabling margin");
-				margin = NULL;
+				imx_2d_region_merge(&new_region, &new_region, &(surface->damage_regions[i]));
+				remove_damage_region(surface, i);
+				merged = TRUE;
+				break;
 			}
 		}
 
-		if (margin != NULL)
-		{
-			Imx2dRegionInclusion expanded_dest_region_inclusion;
-
-			assert(margin->left_margin >= 0);
-			assert(margin->top_margin >= 0);
-			assert(margin->right_margin >= 0);
-			assert(margin->bottom_margin >= 0);
-
-			full_expanded_dest_region.x1 = params_in_use->dest_region->x1 - margin->left_margin;
-			full_expanded_dest_region.y1 = params_in_use->dest_region->y1 - margin->top_margin;
-			full_expanded_dest_region.x2 = params_in_use->dest_region->x2 + margin->right_margin;
-			full_expanded_dest_region.y2 = params_in_use->dest_region->y2 + margin->bottom_margin;
+		if (merged)
+			continue;
 
-			expanded_dest_region_inclusion = imx_2d_region_check_inclusion(
-				&full_expanded_dest_region,
-				&(blitter->dest->region)
-			);
+		if (surface->num_damage_regions < IMX_2D_MAX_NUM_DAMAGE_REGIONS)
+			break;
 
-			IMX_2D_LOG(TRACE, "margin defined; expanded dest region: %" IMX_2D_REGION_FORMAT, IMX_2D_REGION_ARGS(&full_expanded_dest_region));
+		/* No room left. Merge with the region whose
+		 * bounding box grows the least by doing so. */
+		{
+			int best_index = 0;
+			int64_t best_growth = INT64_MAX;
 
-			switch (expanded_dest_region_inclusion)
+			for (i = 0; i < surface->num_damage_regions; ++i)
 			{
-				case IMX_2D_REGION_INCLUSION_NONE:
-				{
-					/* if the expanded dest region is fully outside of the
-					 * dest surface, then we can exit right away, since then,
-					 * neither the margin nor the actual dest region can
-					 * possibly be visible, so there is nothing to blit. */
-					IMX_2D_LOG(TRACE, "expanded dest region is fully outside of the dest surface bounds; skipping blitter operation");
-					return TRUE;
-				}
+				Imx2dRegion merged_region;
+				int64_t growth;
 
-				case IMX_2D_REGION_INCLUSION_FULL:
+				imx_2d_region_merge(&merged_region, &new_region, &(surface->damage_regions[i]));
+				growth = get_region_area(&merged_region) - get_region_area(&(surface->damage_regions[i]));
+				if (growth < best_growth)
 				{
-					/* If the expanded dest region is fully inside the dest
-					 * surface, this implies that the original dest region is too.
-					 * Therefore, set dest_region_inclusion to "full" to let
-					 * the rest of the code know that no more checks are needed. */
-					IMX_2D_LOG(TRACE, "expanded dest region is fully inside of the dest surface bounds");
-					dest_region_inclusion = IMX_2D_REGION_INCLUSION_FULL;
-					expanded_dest_region_to_use = &full_expanded_dest_region;
-					break;
+					best_growth = growth;
+					best_index = i;
 				}
+			}
 
-				case IMX_2D_REGION_INCLUSION_PARTIAL:
-					/* Partial inclusion -> check the inclusion of the original
-					 * dest region, and also clip the expanded dest region against
-					 * the dest surface. */
+			imx_2d_region_merge(&new_region, &new_region, &(surface->damage_regions[best_index]));
+			remove_damage_region(surface, best_index);
+		}
+	}
 
-					IMX_2D_LOG(TRACE, "expanded dest region is partially inside of the dest surface bounds");
+	surface->damage_regions[surface->num_damage_regions] = new_region;
+	surface->num_damage_regions++;
+}
 
-					dest_region_inclusion = imx_2d_region_check_inclusion(
-						params_in_use->dest_region,
-						&(blitter->dest->region)
-					);
 
-					imx_2d_region_intersect(
-						&clipped_expanded_dest_region,
-						&full_expanded_dest_region,
-						&(blitter->dest->region)
-					);
-					expanded_dest_region_to_use = &clipped_expanded_dest_region;
+void imx_2d_surface_clear_damage(Imx2dSurface *surface)
+{
+	assert(surface != NULL);
+	surface->num_damage_regions = 0;
+}
 
-					break;
 
-				default:
-					assert(FALSE);
-			}
-		}
-		else
-		{
-			IMX_2D_LOG(TRACE, "no margin defined");
-			dest_region_inclusion = imx_2d_region_check_inclusion(
-				params_in_use->dest_region,
-				&(blitter->dest->region)
-			);
-		}
+int imx_2d_surface_get_damage_regions(Imx2dSurface *surface, Imx2dRegion const **regions)
+{
+	assert(surface != NULL);
+	assert(regions != NULL);
 
-		/* If we reach this point, then either dest_region is
-		 * at least partially visible, or there is a margin &
-		 * it is partially visible, or both. In other words,
-		 * it is not possible that we have a margin which is
-		 * fully invisible if we made it to this point. */
+	*regions = surface->damage_regions;
+	return surface->num_damage_regions;
+}
 
-		switch (dest_region_inclusion)
-		{
-			case IMX_2D_REGION_INCLUSION_NONE:
-				if (margin != NULL)
-				{
-					Imx2dInternalFillRegionParams params =
-					{
-						expanded_dest_region_to_use,
-						margin_fill_color
-					};
 
-					IMX_2D_LOG(TRACE, "dest region is fully outside of the dest surface bounds, but margin is visible; skipping blitter operation, filling margin");
 
-					return blitter->blitter_class->fill_region(blitter, &params);
-				}
-				else
-				{
-					IMX_2D_LOG(TRACE, "dest region is fully outside of the dest surface bounds; skipping blitter operation");
-					return TRUE;
-				}
-				break;
 
-			case IMX_2D_REGION_INCLUSION_FULL:
-			{
-				Imx2dInternalBlitParams params =
-				{
-					source, params_in_use->source_region,
-					params_in_use->dest_region,
-					params_in_use->rotation,
-					expanded_dest_region_to_use,
-					params_in_use->alpha,
-					margin_fill_color
-				};
+/* Statistics helpers */
 
-				/* We can blit with zero adjustments, since the dest
-				 * region is fully inside the dest surface. */
-				IMX_2D_LOG(TRACE, "dest region is fully inside of the dest surface bounds");
-				return blitter->blitter_class->do_blit(blitter, &params);
-			}
 
-			case IMX_2D_REGION_INCLUSION_PARTIAL:
-			{
-				/* We must adjust both the dest and the source region,
-				 * since the dest region is only partially inside the
-				 * dest surface. We also have to adjust the source region,
-				 * because we can only blit a subset of the source region. */
+int64_t imx_2d_get_monotonic_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((int64_t)(ts.tv_sec)) * 1000000000 + ts.tv_nsec;
+}
 
-				Imx2dRegion const *source_region = (params_in_use->source_region != NULL) ? params_in_use->source_region : &(source->region);
-				Imx2dRegion const *dest_region = params_in_use->dest_region;
-				Imx2dRegion clipped_source_region;
-				Imx2dRegion clipped_dest_region;
 
-				int source_region_width = source_region->x2 - source_region->x1;
-				int source_region_height = source_region->y2 - source_region->y1;
-				int dest_region_width = dest_region->x2 - dest_region->x1;
-				int dest_region_height = dest_region->y2 - dest_region->y1;
+/* Approximates the number of bytes occupied by num_pixels pixels of
+ * the given format. With multi-planar formats, the chroma planes are
+ * included. Tiling and bit depths other than 8 are not accounted for. */
+static int64_t get_num_bytes(Imx2dPixelFormat format, int64_t num_pixels)
+{
+	Imx2dPixelFormatInfo const *fmt_info = imx_2d_get_pixel_format_info(format);
 
-				imx_2d_region_intersect(
-					&clipped_dest_region,
-					dest_region,
-					&(blitter->dest->region)
-				);
+	if (fmt_info == NULL)
+		return 0;
 
-				memcpy(&clipped_source_region, source_region, sizeof(Imx2dRegion));
+	if (fmt_info->num_planes == 1)
+		return num_pixels * fmt_info->pixel_stride;
 
-				switch (params_in_use->rotation)
-				{
-					case IMX_2D_ROTATION_NONE:
-						if (dest_region->x1 < 0)
-							clipped_source_region.x1 += source_region_width * (-dest_region->x1) / dest_region_width;
-						if (dest_region->y1 < 0)
-							clipped_source_region.y1 += source_region_height * (-dest_region->y1) / dest_region_height;
-						if (dest_region->x2 > blitter->dest->region.x2)
-							clipped_source_region.x2 -= source_region_width * (dest_region->x2 - blitter->dest->region.x2) / dest_region_width;
-						if (dest_region->y2 > blitter->dest->region.y2)
-							clipped_source_region.y2 -= source_region_height * (dest_region->y2 - blitter->dest->region.y2) / dest_region_height;
-						break;
+	/* Both semi-planar and fully planar formats have two chroma
+	 * samples for each x_subsampling * y_subsampling luma pixels. */
+	return num_pixels * fmt_info->pixel_stride
+	     + num_pixels * fmt_info->pixel_stride * 2 / (fmt_info->x_subsampling * fmt_info->y_subsampling);
+}
 
-					case IMX_2D_ROTATION_90:
-						if (dest_region->x1 < 0)
-							clipped_source_region.y2 -= source_region_height * (-dest_region->x1) / dest_region_width;
-						if (dest_region->y1 < 0)
-							clipped_source_region.x1 += source_region_width * (-dest_region->y1) / dest_region_height;
-						if (dest_region->x2 > blitter->dest->region.x2)
-							clipped_source_region.y1 += source_region_height * (dest_region->x2 - blitter->dest->region.x2) / dest_region_width;
-						if (dest_region->y2 > blitter->dest->region.y2)
-							clipped_source_region.x2 -= source_region_width * (dest_region->y2 - blitter->dest->region.y2) / dest_region_height;
-						break;
 
-					case IMX_2D_ROTATION_180:
-						if (dest_region->x1 < 0)
-							clipped_source_region.x2 -= source_region_width * (-dest_region->x1) / dest_region_width;
-						if (dest_region->y1 < 0)
-							clipped_source_region.y2 -= source_region_height * (-dest_region->y1) / dest_region_height;
-						if (dest_region->x2 > blitter->dest->region.x2)
-							clipped_source_region.x1 += source_region_width * (dest_region->x2 - blitter->dest->region.x2) / dest_region_width;
-						if (dest_region->y2 > blitter->dest->region.y2)
-							clipped_source_region.y1 += source_region_height * (dest_region->y2 - blitter->dest->region.y2) / dest_region_height;
-						break;
+static void get_blit_sizes(Imx2dBlitter *blitter, Imx2dInternalBlitParams const *internal_blit_params, int64_t *num_pixels, int64_t *num_bytes)
+{
+	Imx2dRegion const *source_region;
+	Imx2dRegion const *expanded_dest_region;
 
-					case IMX_2D_ROTATION_270:
-						if (dest_region->x1 < 0)
-							clipped_source_region.y1 += source_region_height * (-dest_region->x1) / dest_region_width;
-						if (dest_region->y1 < 0)
-							clipped_source_region.x2 -= source_region_width * (-dest_region->y1) / dest_region_height;
-						if (dest_region->x2 > blitter->dest->region.x2)
-							clipped_source_region.y2 -= source_region_height * (dest_region->x2 - blitter->dest->region.x2) / dest_region_width;
-						if (dest_region->y2 > blitter->dest->region.y2)
-							clipped_source_region.x1 += source_region_width * (dest_region->y2 - blitter->dest->region.y2) / dest_region_height;
-						break;
+	source_region = (internal_blit_params->source_region != NULL) ? internal_blit_params->source_region : &(internal_blit_params->source->region);
+	expanded_dest_region = (internal_blit_params->expanded_dest_region != NULL) ? internal_blit_params->expanded_dest_region : internal_blit_params->dest_region;
 
-					case IMX_2D_ROTATION_FLIP_HORIZONTAL:
-						if (dest_region->x1 < 0)
-							clipped_source_region.x2 -= source_region_width * (-dest_region->x1) / dest_region_width;
-						if (dest_region->y1 < 0)
-							clipped_source_region.y1 += source_region_height * (-dest_region->y1) / dest_region_height;
-						if (dest_region->x2 > blitter->dest->region.x2)
-							clipped_source_region.x1 += source_region_width * (dest_region->x2 - blitter->dest->region.x2) / dest_region_width;
-						if (dest_region->y2 > blitter->dest->region.y2)
-							clipped_source_region.y2 -= source_region_height * (dest_region->y2 - blitter->dest->region.y2) / dest_region_height;
-						break;
+	*num_pixels = get_region_area(expanded_dest_region);
+	*num_bytes = get_num_bytes(internal_blit_params->source->desc.format, get_region_area(source_region))
+	           + get_num_bytes(blitter->dest->desc.format, *num_pixels);
+}
 
-					case IMX_2D_ROTATION_FLIP_VERTICAL:
-						if (dest_region->x1 < 0)
-							clipped_source_region.x1 += source_region_width * (-dest_region->x1) / dest_region_width;
-						if (dest_region->y1 < 0)
-							clipped_source_region.y2 -= source_region_height * (-dest_region->y1) / dest_region_height;
-						if (dest_region->x2 > blitter->dest->region.x2)
-							clipped_source_region.x2 -= source_region_width * (dest_region->x2 - blitter->dest->region.x2) / dest_region_width;
-						if (dest_region->y2 > blitter->dest->region.y2)
-							clipped_source_region.y1 += source_region_height * (dest_region->y2 - blitter->dest->region.y2) / dest_region_height;
-						break;
 
-					case IMX_2D_ROTATION_UL_LR:
-						if (dest_region->x1 < 0)
-							clipped_source_region.y1 += source_region_height * (-dest_region->x1) / dest_region_width;
-						if (dest_region->y1 < 0)
-							clipped_source_region.x1 += source_region_width * (-dest_region->y1) / dest_region_height;
-						if (dest_region->x2 > blitter->dest->region.x2)
-							clipped_source_region.y2 -= source_region_height * (dest_region->x2 - blitter->dest->region.x2) / dest_region_width;
-						if (dest_region->y2 > blitter->dest->region.y2)
-							clipped_source_region.x2 -= source_region_width * (dest_region->y2 - blitter->dest->region.y2) / dest_region_height;
-						break;
+static void get_fill_region_sizes(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams const *internal_fill_region_params, int64_t *num_pixels, int64_t *num_bytes)
+{
+	*num_pixels = get_region_area(internal_fill_region_params->dest_region);
+	*num_bytes = get_num_bytes(blitter->dest->desc.format, *num_pixels);
+}
+
+
+static void report_op_stats(Imx2dBlitter *blitter, Imx2dOpType op_type, int num_ops, int64_t num_pixels, int64_t num_bytes, int64_t submit_time, int64_t completion_time)
+{
+	Imx2dOpStats op_stats;
+
+	op_stats.op_type = op_type;
+	op_stats.backend_name = imx_2d_blitter_get_backend_name(blitter);
+	op_stats.num_ops = num_ops;
+	op_stats.num_pixels = num_pixels;
+	op_stats.num_bytes = num_bytes;
+	op_stats.submit_time = submit_time;
+	op_stats.completion_time = completion_time;
+
+	imx_2d_blitter_stats_add(&(blitter->stats), &op_stats);
+
+	if (blitter->stats_func != NULL)
+		blitter->stats_func(&op_stats, blitter->stats_user_data);
+}
+
+
+/* Reports the statistics of finish_async fences that got signaled.
+ * The fences are reported in the order they were added, so this
+ * stops at the first fence that is not yet signaled. */
+static void report_signaled_stats_fences(Imx2dBlitter *blitter)
+{
+	int num_reported = 0;
+	int i;
+
+	while (num_reported < blitter->num_pending_stats_fences)
+	{
+		Imx2dFence *fence = blitter->pending_stats_fences[num_reported];
+		Imx2dOpStats *op_stats = &(blitter->pending_stats_fence_ops[num_reported]);
+
+		if (!imx_2d_fence_poll(fence))
+			break;
+
+		/* The signal time is written before the signaled flag under
+		 * the fence mutex, and imx_2d_fence_poll() locked that mutex,
+		 * so the signal time can safely be read here. */
+		op_stats->completion_time = fence->signal_time;
+		imx_2d_blitter_stats_add(&(blitter->stats), op_stats);
+		if (blitter->stats_func != NULL)
+			blitter->stats_func(op_stats, blitter->stats_user_data);
+
+		imx_2d_fence_unref(fence);
+		num_reported++;
+	}
+
+	if (num_reported == 0)
+		return;
+
+	for (i = num_reported; i < blitter->num_pending_stats_fences; ++i)
+	{
+		blitter->pending_stats_fences[i - num_reported] = blitter->pending_stats_fences[i];
+		blitter->pending_stats_fence_ops[i - num_reported] = blitter->pending_stats_fence_ops[i];
+	}
+
+	blitter->num_pending_stats_fences -= num_reported;
+}
+
+
+static void add_pending_stats_fence(Imx2dBlitter *blitter, Imx2dFence *fence, int64_t submit_time)
+{
+	Imx2dOpStats *op_stats;
+
+	if (blitter->num_pending_stats_fences == IMX_2D_MAX_NUM_PENDING_STATS_FENCES)
+	{
+		int i;
+
+		IMX_2D_LOG(DEBUG, "too many pending finish_async fences; discarding statistics of the oldest one");
+
+		imx_2d_fence_unref(blitter->pending_stats_fences[0]);
+		for (i = 1; i < blitter->num_pending_stats_fences; ++i)
+		{
+			blitter->pending_stats_fences[i - 1] = blitter->pending_stats_fences[i];
+			blitter->pending_stats_fence_ops[i - 1] = blitter->pending_stats_fence_ops[i];
+		}
+		blitter->num_pending_stats_fences--;
+	}
+
+	blitter->pending_stats_fences[blitter->num_pending_stats_fences] = imx_2d_fence_ref(fence);
+
+	op_stats = &(blitter->pending_stats_fence_ops[blitter->num_pending_stats_fences]);
+	memset(op_stats, 0, sizeof(Imx2dOpStats));
+	op_stats->op_type = IMX_2D_OP_TYPE_FINISH;
+	op_stats->backend_name = imx_2d_blitter_get_backend_name(blitter);
+	op_stats->submit_time = submit_time;
+
+	blitter->num_pending_stats_fences++;
+}
+
+
+
+
+static Imx2dInternalBatchOp* add_batch_op(Imx2dBlitter *blitter, Imx2dInternalBatchOpType type)
+{
+	Imx2dInternalBatchOp *op;
+
+	if (blitter->num_batch_ops >= blitter->max_num_batch_ops)
+	{
+		int new_max_num_batch_ops = (blitter->max_num_batch_ops > 0) ? (blitter->max_num_batch_ops * 2) : 16;
+		Imx2dInternalBatchOp *new_batch_ops = realloc(blitter->batch_ops, sizeof(Imx2dInternalBatchOp) * new_max_num_batch_ops);
+		if (new_batch_ops == NULL)
+		{
+			IMX_2D_LOG(ERROR, "could not allocate space for %d batch operations", new_max_num_batch_ops);
+			return NULL;
+		}
+
+		blitter->batch_ops = new_batch_ops;
+		blitter->max_num_batch_ops = new_max_num_batch_ops;
+	}
+
+	op = &(blitter->batch_ops[blitter->num_batch_ops++]);
+	memset(op, 0, sizeof(Imx2dInternalBatchOp));
+	op->type = type;
+
+	return op;
+}
+
+
+/* These two functions store the params in op, along with copies of
+ * the regions, since the pointers in the params typically refer to
+ * local variables of the caller. The region pointers in the stored
+ * params are set to refer to these copies. Note that these pointers
+ * become invalid if op is moved to another location in memory. */
+
+static void store_blit_op(Imx2dInternalBatchOp *op, Imx2dInternalBlitParams const *internal_blit_params)
+{
+	op->type = IMX_2D_INTERNAL_BATCH_OP_TYPE_BLIT;
+	op->blit_params = *internal_blit_params;
+
+	if (internal_blit_params->source_region != NULL)
+	{
+		op->source_region = *(internal_blit_params->source_region);
+		op->blit_params.source_region = &(op->source_region);
+	}
+	if (internal_blit_params->dest_region != NULL)
+	{
+		op->dest_region = *(internal_blit_params->dest_region);
+		op->blit_params.dest_region = &(op->dest_region);
+	}
+	if (internal_blit_params->expanded_dest_region != NULL)
+	{
+		op->expanded_dest_region = *(internal_blit_params->expanded_dest_region);
+		op->blit_params.expanded_dest_region = &(op->expanded_dest_region);
+	}
+}
+
+
+static void store_fill_region_op(Imx2dInternalBatchOp *op, Imx2dInternalFillRegionParams const *internal_fill_region_params)
+{
+	op->type = IMX_2D_INTERNAL_BATCH_OP_TYPE_FILL_REGION;
+	op->fill_region_params = *internal_fill_region_params;
+	op->dest_region = *(internal_fill_region_params->dest_region);
+	op->fill_region_params.dest_region = &(op->dest_region);
+}
+
+
+/* These two functions either pass the operation directly to the
+ * backend or, if a batch is being recorded, add it to the batch.
+ * plan_data is the backend plan data if the blit comes from a
+ * blit plan, and NULL otherwise. */
+
+static int dispatch_blit(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params, void *plan_data)
+{
+	Imx2dInternalBatchOp *op;
+
+	if (!blitter->batch_active)
+	{
+		int64_t submit_time, num_pixels, num_bytes;
+		int ret;
+
+		submit_time = imx_2d_get_monotonic_time();
+
+		if (plan_data != NULL)
+			ret = blitter->blitter_class->do_planned_blit(blitter, internal_blit_params, plan_data);
+		else
+			ret = blitter->blitter_class->do_blit(blitter, internal_blit_params);
+
+		if (ret)
+		{
+			get_blit_sizes(blitter, internal_blit_params, &num_pixels, &num_bytes);
+			report_op_stats(blitter, IMX_2D_OP_TYPE_BLIT, 1, num_pixels, num_bytes, submit_time, imx_2d_get_monotonic_time());
+		}
+
+		return ret;
+	}
+
+	op = add_batch_op(blitter, IMX_2D_INTERNAL_BATCH_OP_TYPE_BLIT);
+	if (op == NULL)
+		return FALSE;
+
+	store_blit_op(op, internal_blit_params);
+	op->plan_data = plan_data;
+
+	return TRUE;
+}
+
+
+static int dispatch_fill_region(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams *internal_fill_region_params)
+{
+	Imx2dInternalBatchOp *op;
+
+	if (!blitter->batch_active)
+	{
+		int64_t submit_time, num_pixels, num_bytes;
+		int ret;
+
+		submit_time = imx_2d_get_monotonic_time();
+
+		ret = blitter->blitter_class->fill_region(blitter, internal_fill_region_params);
+
+		if (ret)
+		{
+			get_fill_region_sizes(blitter, internal_fill_region_params, &num_pixels, &num_bytes);
+			report_op_stats(blitter, IMX_2D_OP_TYPE_FILL_REGION, 1, num_pixels, num_bytes, submit_time, imx_2d_get_monotonic_time());
+		}
+
+		return ret;
+	}
+
+	op = add_batch_op(blitter, IMX_2D_INTERNAL_BATCH_OP_TYPE_FILL_REGION);
+	if (op == NULL)
+		return FALSE;
+
+	store_fill_region_op(op, internal_fill_region_params);
+
+	return TRUE;
+}
+
+
+/* Fills several regions with one fill_regions call if the backend
+ * supports it. Otherwise, and when recording a batch, the regions
+ * are passed on individually with dispatch_fill_region(). */
+static int dispatch_fill_regions(Imx2dBlitter *blitter, Imx2dRegion const *dest_regions, int num_dest_regions, uint32_t fill_color)
+{
+	int i;
+
+	if (blitter->batch_active || (blitter->blitter_class->fill_regions == NULL) || (num_dest_regions == 1))
+	{
+		for (i = 0; i < num_dest_regions; ++i)
+		{
+			Imx2dInternalFillRegionParams params =
+			{
+				&(dest_regions[i]),
+				fill_color
+			};
+
+			if (!dispatch_fill_region(blitter, &params))
+				return FALSE;
+		}
+
+		return TRUE;
+	}
+	else
+	{
+		Imx2dInternalFillRegionsParams params =
+		{
+			dest_regions,
+			num_dest_regions,
+			fill_color
+		};
+		int64_t submit_time, num_pixels = 0;
+		int ret;
+
+		submit_time = imx_2d_get_monotonic_time();
+
+		ret = blitter->blitter_class->fill_regions(blitter, &params);
+
+		if (ret)
+		{
+			for (i = 0; i < num_dest_regions; ++i)
+				num_pixels += get_region_area(&(dest_regions[i]));
+			report_op_stats(blitter, IMX_2D_OP_TYPE_FILL_REGION, num_dest_regions, num_pixels, get_num_bytes(blitter->dest->desc.format, num_pixels), submit_time, imx_2d_get_monotonic_time());
+		}
+
+		return ret;
+	}
+}
+
+
+static int dispatch_op(Imx2dBlitter *blitter, Imx2dInternalBatchOp *op)
+{
+	switch (op->type)
+	{
+		case IMX_2D_INTERNAL_BATCH_OP_TYPE_NONE:
+			return TRUE;
+
+		case IMX_2D_INTERNAL_BATCH_OP_TYPE_BLIT:
+			return dispatch_blit(blitter, &(op->blit_params), op->plan_data);
+
+		case IMX_2D_INTERNAL_BATCH_OP_TYPE_FILL_REGION:
+			return dispatch_fill_region(blitter, &(op->fill_region_params));
+
+		default:
+			assert(FALSE);
+			return FALSE;
+	}
+}
+
+
+int imx_2d_blit_margin_get_regions(Imx2dBlitMargin const *margin, Imx2dRegion const *dest_region, Imx2dRegion *margin_regions)
+{
+	Imx2dRegion candidates[4];
+	int i, num_margin_regions = 0;
+
+	assert(margin != NULL);
+	assert(dest_region != NULL);
+	assert(margin_regions != NULL);
+
+	/* Top */
+	candidates[0].x1 = dest_region->x1 - margin->left_margin;
+	candidates[0].y1 = dest_region->y1 - margin->top_margin;
+	candidates[0].x2 = dest_region->x2 + margin->right_margin;
+	candidates[0].y2 = dest_region->y1;
+
+	/* Bottom */
+	candidates[1].x1 = dest_region->x1 - margin->left_margin;
+	candidates[1].y1 = dest_region->y2;
+	candidates[1].x2 = dest_region->x2 + margin->right_margin;
+	candidates[1].y2 = dest_region->y2 + margin->bottom_margin;
+
+	/* Left */
+	candidates[2].x1 = dest_region->x1 - margin->left_margin;
+	candidates[2].y1 = dest_region->y1;
+	candidates[2].x2 = dest_region->x1;
+	candidates[2].y2 = dest_region->y2;
+
+	/* Right */
+	candidates[3].x1 = dest_region->x2;
+	candidates[3].y1 = dest_region->y1;
+	candidates[3].x2 = dest_region->x2 + margin->right_margin;
+	candidates[3].y2 = dest_region->y2;
+
+	for (i = 0; i < 4; ++i)
+	{
+		if (!region_is_empty(&(candidates[i])))
+			margin_regions[num_margin_regions++] = candidates[i];
+	}
+
+	return num_margin_regions;
+}
+
+
+void imx_2d_blitter_destroy(Imx2dBlitter *blitter)
+{
+	int i;
+
+	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->destroy != NULL));
+
+	report_signaled_stats_fences(blitter);
+	for (i = 0; i < blitter->num_pending_stats_fences; ++i)
+		imx_2d_fence_unref(blitter->pending_stats_fences[i]);
+
+	free(blitter->batch_ops);
+
+	for (i = 0; i < (IMX_2D_MAX_NUM_SCALING_PASSES - 1); ++i)
+	{
+		if (blitter->intermediate_dma_buffers[i] != NULL)
+			imx_dma_buffer_deallocate(blitter->intermediate_dma_buffers[i]);
+	}
+	if (blitter->intermediate_allocator != NULL)
+		imx_dma_buffer_allocator_destroy(blitter->intermediate_allocator);
+
+	blitter->blitter_class->destroy(blitter);
+}
+
+
+int imx_2d_blitter_start(Imx2dBlitter *blitter, Imx2dSurface *dest)
+{
+	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->start != NULL));
+	assert(dest != NULL);
+	blitter->dest = dest;
+	/* Discard any batch that was left over by a sequence
+	 * that was aborted before it could be finished. */
+	blitter->batch_active = FALSE;
+	blitter->num_batch_ops = 0;
+	report_signaled_stats_fences(blitter);
+	return blitter->blitter_class->start(blitter);
+}
+
+
+static int submit_pending_batch(Imx2dBlitter *blitter)
+{
+	if (!blitter->batch_active)
+		return TRUE;
+
+	IMX_2D_LOG(DEBUG, "batch still active when finishing sequence; submitting it");
+	if (!imx_2d_blitter_submit_batch(blitter))
+	{
+		/* Still finish the sequence to not leave the backend
+		 * in a half-started state, but report the failure. */
+		blitter->blitter_class->finish(blitter);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+int imx_2d_blitter_finish(Imx2dBlitter *blitter)
+{
+	int64_t submit_time;
+	int ret;
+
+	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->finish != NULL));
+
+	if (!submit_pending_batch(blitter))
+		return FALSE;
+
+	submit_time = imx_2d_get_monotonic_time();
+	ret = blitter->blitter_class->finish(blitter);
+	if (ret)
+		report_op_stats(blitter, IMX_2D_OP_TYPE_FINISH, 0, 0, 0, submit_time, imx_2d_get_monotonic_time());
+
+	return ret;
+}
+
+
+int imx_2d_blitter_finish_async(Imx2dBlitter *blitter, Imx2dFence **fence)
+{
+	Imx2dFence *new_fence;
+	int64_t submit_time;
+	int ret;
+
+	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->finish != NULL));
+	assert(fence != NULL);
+
+	*fence = NULL;
+
+	if (!submit_pending_batch(blitter))
+		return FALSE;
+
+	report_signaled_stats_fences(blitter);
+	submit_time = imx_2d_get_monotonic_time();
+
+	new_fence = imx_2d_fence_new();
+	if (new_fence == NULL)
+	{
+		/* Without a fence, fall back to a blocking finish
+		 * to at least not leave the sequence unfinished. */
+		blitter->blitter_class->finish(blitter);
+		return FALSE;
+	}
+
+	if (blitter->blitter_class->finish_async != NULL)
+	{
+		ret = blitter->blitter_class->finish_async(blitter, new_fence);
+	}
+	else
+	{
+		ret = blitter->blitter_class->finish(blitter);
+		imx_2d_fence_signal(new_fence, ret);
+	}
+
+	if (!ret)
+	{
+		imx_2d_fence_unref(new_fence);
+		return FALSE;
+	}
+
+	add_pending_stats_fence(blitter, new_fence, submit_time);
+
+	*fence = new_fence;
+	return TRUE;
+}
+
+
+int imx_2d_blitter_begin_batch(Imx2dBlitter *blitter)
+{
+	assert(blitter != NULL);
+
+	if (blitter->batch_active)
+	{
+		IMX_2D_LOG(ERROR, "a batch is already being recorded");
+		return FALSE;
+	}
+
+	blitter->batch_active = TRUE;
+	blitter->num_batch_ops = 0;
+
+	return TRUE;
+}
+
+
+int imx_2d_blitter_submit_batch(Imx2dBlitter *blitter)
+{
+	int i;
+	int ret = TRUE;
+	int num_ops;
+	Imx2dInternalBatchOp *ops;
+
+	assert((blitter != NULL) && (blitter->blitter_class != NULL));
+
+	if (!blitter->batch_active)
+	{
+		IMX_2D_LOG(ERROR, "no batch is being recorded");
+		return FALSE;
+	}
+
+	blitter->batch_active = FALSE;
+
+	ops = blitter->batch_ops;
+	num_ops = blitter->num_batch_ops;
+	blitter->num_batch_ops = 0;
+
+	if (num_ops == 0)
+	{
+		IMX_2D_LOG(TRACE, "batch is empty; nothing to submit");
+		return TRUE;
+	}
+
+	/* Let the region pointers refer to the region copies.
+	 * This can only be done now, since the batch_ops array
+	 * may have been reallocated while recording. */
+	for (i = 0; i < num_ops; ++i)
+	{
+		Imx2dInternalBatchOp *op = &(ops[i]);
+
+		switch (op->type)
+		{
+			case IMX_2D_INTERNAL_BATCH_OP_TYPE_BLIT:
+				if (op->blit_params.source_region != NULL)
+					op->blit_params.source_region = &(op->source_region);
+				if (op->blit_params.dest_region != NULL)
+					op->blit_params.dest_region = &(op->dest_region);
+				if (op->blit_params.expanded_dest_region != NULL)
+					op->blit_params.expanded_dest_region = &(op->expanded_dest_region);
+				break;
+
+			case IMX_2D_INTERNAL_BATCH_OP_TYPE_FILL_REGION:
+				op->fill_region_params.dest_region = &(op->dest_region);
+				break;
+
+			default:
+				assert(FALSE);
+		}
+	}
+
+	IMX_2D_LOG(TRACE, "submitting batch with %d operation(s)", num_ops);
+
+	if (blitter->blitter_class->submit_batch != NULL)
+	{
+		int64_t submit_time, total_num_pixels = 0, total_num_bytes = 0;
+
+		submit_time = imx_2d_get_monotonic_time();
+		ret = blitter->blitter_class->submit_batch(blitter, ops, num_ops);
+
+		if (ret)
+		{
+			for (i = 0; i < num_ops; ++i)
+			{
+				int64_t num_pixels, num_bytes;
+
+				if (ops[i].type == IMX_2D_INTERNAL_BATCH_OP_TYPE_BLIT)
+					get_blit_sizes(blitter, &(ops[i].blit_params), &num_pixels, &num_bytes);
+				else
+					get_fill_region_sizes(blitter, &(ops[i].fill_region_params), &num_pixels, &num_bytes);
+
+				total_num_pixels += num_pixels;
+				total_num_bytes += num_bytes;
+			}
+
+			report_op_stats(blitter, IMX_2D_OP_TYPE_BATCH, num_ops, total_num_pixels, total_num_bytes, submit_time, imx_2d_get_monotonic_time());
+		}
+
+		return ret;
+	}
+
+	/* The backend executes the operations one by one,
+	 * so they are also reported as individual operations. */
+	for (i = 0; (i < num_ops) && ret; ++i)
+	{
+		Imx2dInternalBatchOp *op = &(ops[i]);
+		int64_t submit_time, num_pixels, num_bytes;
+
+		/* Consecutive fills with the same color, like the sides of
+		 * a margin, can be combined into one fill_regions call. */
+		if ((op->type == IMX_2D_INTERNAL_BATCH_OP_TYPE_FILL_REGION) && (blitter->blitter_class->fill_regions != NULL))
+		{
+			Imx2dRegion fill_regions[IMX_2D_MAX_NUM_FILL_REGIONS_PER_CALL];
+			int num_fill_regions = 0;
+
+			while (((i + num_fill_regions) < num_ops)
+			    && (num_fill_regions < IMX_2D_MAX_NUM_FILL_REGIONS_PER_CALL)
+			    && (ops[i + num_fill_regions].type == IMX_2D_INTERNAL_BATCH_OP_TYPE_FILL_REGION)
+			    && (ops[i + num_fill_regions].fill_region_params.fill_color == op->fill_region_params.fill_color))
+			{
+				fill_regions[num_fill_regions] = ops[i + num_fill_regions].dest_region;
+				++num_fill_regions;
+			}
+
+			if (num_fill_regions > 1)
+			{
+				ret = dispatch_fill_regions(blitter, fill_regions, num_fill_regions, op->fill_region_params.fill_color);
+				i += num_fill_regions - 1;
+				continue;
+			}
+		}
+
+		submit_time = imx_2d_get_monotonic_time();
+
+		switch (op->type)
+		{
+			case IMX_2D_INTERNAL_BATCH_OP_TYPE_BLIT:
+				if (op->plan_data != NULL)
+					ret = blitter->blitter_class->do_planned_blit(blitter, &(op->blit_params), op->plan_data);
+				else
+					ret = blitter->blitter_class->do_blit(blitter, &(op->blit_params));
+				if (ret)
+				{
+					get_blit_sizes(blitter, &(op->blit_params), &num_pixels, &num_bytes);
+					report_op_stats(blitter, IMX_2D_OP_TYPE_BLIT, 1, num_pixels, num_bytes, submit_time, imx_2d_get_monotonic_time());
+				}
+				break;
+
+			case IMX_2D_INTERNAL_BATCH_OP_TYPE_FILL_REGION:
+				ret = blitter->blitter_class->fill_region(blitter, &(op->fill_region_params));
+				if (ret)
+				{
+					get_fill_region_sizes(blitter, &(op->fill_region_params), &num_pixels, &num_bytes);
+					report_op_stats(blitter, IMX_2D_OP_TYPE_FILL_REGION, 1, num_pixels, num_bytes, submit_time, imx_2d_get_monotonic_time());
+				}
+				break;
+
+			default:
+				assert(FALSE);
+		}
+	}
+
+	return ret;
+}
+
+
+static Imx2dBlitParams const default_blit_params =
+{
+	.source_region = NULL,
+	.dest_region = NULL,
+	.rotation = IMX_2D_ROTATION_NONE,
+	.margin = NULL,
+	.alpha = 255
+};
+
+
+/* Performs the region inclusion checks, the clipping, and the margin
+ * color computation for blitting from source to dest, and stores the
+ * resulting operation in op. This is either a blit, a fill region (if
+ * only the margin is visible), or nothing (IMX_2D_INTERNAL_BATCH_OP_TYPE_NONE).
+ * Only the surface regions are accessed, not the DMA buffers, so the
+ * result can be reused for as long as the regions stay the same.
+ * The blit is clipped against clip_region, which is either the dest
+ * surface region or one of its damage regions. */
+static int compute_blit_op(Imx2dSurface *source, Imx2dSurface *dest, Imx2dRegion const *clip_region, Imx2dBlitParams const *params_in_use, Imx2dInternalBatchOp *op)
+{
+	Imx2dBlitParams params_with_dest_region;
+
+	memset(op, 0, sizeof(Imx2dInternalBatchOp));
+	op->type = IMX_2D_INTERNAL_BATCH_OP_TYPE_NONE;
+
+	if (params_in_use->alpha == 0)
+	{
+		/* If alpha is set to 0, then the blitting would effectively
+		 * do nothing due to the pixels being 100% translucent. */
+		IMX_2D_LOG(TRACE, "not blitting because params alpha value is 0");
+		return TRUE;
+	}
+	else if (params_in_use->alpha < 0)
+	{
+		IMX_2D_LOG(ERROR, "attempting to blit with alpha value %u; minimum allowed value is 0", params_in_use->alpha);
+		return FALSE;
+	}
+	else if (params_in_use->alpha > 255)
+	{
+		IMX_2D_LOG(ERROR, "attempting to blit with alpha value %u; maximum allowed value is 255", params_in_use->alpha);
+		return FALSE;
+	}
+
+	if ((params_in_use->dest_region == NULL) && (clip_region != &(dest->region)))
+	{
+		/* Not setting dest_region means that the blit covers the
+		 * entire dest surface. This is then clipped like any other
+		 * dest region, since the clip region is smaller than that. */
+		params_with_dest_region = *params_in_use;
+		params_with_dest_region.dest_region = &(dest->region);
+		params_in_use = &params_with_dest_region;
+	}
+
+	if (params_in_use->dest_region != NULL)
+	{
+		/* dest_region is set, so we need to check if and to what
+		 * degree dest_region is inside the clip region. */
+
+		Imx2dRegionInclusion dest_region_inclusion = IMX_2D_REGION_INCLUSION_FULL;
+		Imx2dRegion const *expanded_dest_region_to_use = NULL;
+		Imx2dRegion full_expanded_dest_region;
+		Imx2dRegion clipped_expanded_dest_region;
+		uint32_t margin_fill_color = 0x00000000;
+
+		/* Get the margin and look at its alpha value. If it is 0,
+		 * then the margin cannot be visible, so we disable it.
+		 * Otherwise, modulate the alpha value with the alpha value
+		 * from the params. If the result from that is 0, again,
+		 * disable the margin. */
+		Imx2dBlitMargin const *margin = params_in_use->margin;
+		if (margin != NULL)
+		{
+			int margin_alpha = (margin->color >> 24) & 0xFF;
+			if (margin_alpha != 0)
+			{
+				int combined_alpha = margin_alpha * params_in_use->alpha / 255;
+				IMX_2D_LOG(
+					TRACE,
+					"global alpha: %d  margin alpha: %d  combined alpha: %d",
+					params_in_use->alpha,
+					margin_alpha,
+					combined_alpha
+				);
+				if (combined_alpha != 0)
+				{
+					uint32_t orig_margin_color_without_alpha = margin->color & 0x00FFFFFF;
+					margin_fill_color = orig_margin_color_without_alpha | (((uint32_t)combined_alpha) << 24);
+					IMX_2D_LOG(
+						TRACE,
+						"merging margin fill color %#06" PRIx32 " and combined alpha %d to new margin fill color %#08" PRIx32,
+						orig_margin_color_without_alpha,
+						combined_alpha,
+						margin_fill_color
+					);
+				}
+				else
+				{
+					IMX_2D_LOG(TRACE, "combined alpha is 0; disabling margin");
+					margin = NULL;
+				}
+			}
+			else
+			{
+				IMX_2D_LOG(TRACE, "margin alpha is 0; disabling margin");
+				margin = NULL;
+			}
+		}
+
+		if (margin != NULL)
+		{
+			Imx2dRegionInclusion expanded_dest_region_inclusion;
+
+			assert(margin->left_margin >= 0);
+			assert(margin->top_margin >= 0);
+			assert(margin->right_margin >= 0);
+			assert(margin->bottom_margin >= 0);
+
+			full_expanded_dest_region.x1 = params_in_use->dest_region->x1 - margin->left_margin;
+			full_expanded_dest_region.y1 = params_in_use->dest_region->y1 - margin->top_margin;
+			full_expanded_dest_region.x2 = params_in_use->dest_region->x2 + margin->right_margin;
+			full_expanded_dest_region.y2 = params_in_use->dest_region->y2 + margin->bottom_margin;
+
+			expanded_dest_region_inclusion = imx_2d_region_check_inclusion(
+				&full_expanded_dest_region,
+				clip_region
+			);
+
+			IMX_2D_LOG(TRACE, "margin defined; expanded dest region: %" IMX_2D_REGION_FORMAT, IMX_2D_REGION_ARGS(&full_expanded_dest_region));
+
+			switch (expanded_dest_region_inclusion)
+			{
+				case IMX_2D_REGION_INCLUSION_NONE:
+				{
+					/* if the expanded dest region is fully outside of the
+					 * dest surface, then we can exit right away, since then,
+					 * neither the margin nor the actual dest region can
+					 * possibly be visible, so there is nothing to blit. */
+					IMX_2D_LOG(TRACE, "expanded dest region is fully outside of the dest surface bounds; skipping blitter operation");
+					return TRUE;
+				}
+
+				case IMX_2D_REGION_INCLUSION_FULL:
+				{
+					/* If the expanded dest region is fully inside the dest
+					 * surface, this implies that the original dest region is too.
+					 * Therefore, set dest_region_inclusion to "full" to let
+					 * the rest of the code know that no more checks are needed. */
+					IMX_2D_LOG(TRACE, "expanded dest region is fully inside of the dest surface bounds");
+					dest_region_inclusion = IMX_2D_REGION_INCLUSION_FULL;
+					expanded_dest_region_to_use = &full_expanded_dest_region;
+					break;
+				}
+
+				case IMX_2D_REGION_INCLUSION_PARTIAL:
+					/* Partial inclusion -> check the inclusion of the original
+					 * dest region, and also clip the expanded dest region against
+					 * the dest surface. */
+
+					IMX_2D_LOG(TRACE, "expanded dest region is partially inside of the dest surface bounds");
+
+					dest_region_inclusion = imx_2d_region_check_inclusion(
+						params_in_use->dest_region,
+						clip_region
+					);
+
+					imx_2d_region_intersect(
+						&clipped_expanded_dest_region,
+						&full_expanded_dest_region,
+						clip_region
+					);
+					expanded_dest_region_to_use = &clipped_expanded_dest_region;
+
+					break;
+
+				default:
+					assert(FALSE);
+			}
+		}
+		else
+		{
+			IMX_2D_LOG(TRACE, "no margin defined");
+			dest_region_inclusion = imx_2d_region_check_inclusion(
+				params_in_use->dest_region,
+				clip_region
+			);
+		}
+
+		/* If we reach this point, then either dest_region is
+		 * at least partially visible, or there is a margin &
+		 * it is partially visible, or both. In other words,
+		 * it is not possible that we have a margin which is
+		 * fully invisible if we made it to this point. */
+
+		switch (dest_region_inclusion)
+		{
+			case IMX_2D_REGION_INCLUSION_NONE:
+				if (margin != NULL)
+				{
+					Imx2dInternalFillRegionParams params =
+					{
+						expanded_dest_region_to_use,
+						margin_fill_color
+					};
+
+					IMX_2D_LOG(TRACE, "dest region is fully outside of the dest surface bounds, but margin is visible; skipping blitter operation, filling margin");
+
+					store_fill_region_op(op, &params);
+					return TRUE;
+				}
+				else
+				{
+					IMX_2D_LOG(TRACE, "dest region is fully outside of the dest surface bounds; skipping blitter operation");
+					return TRUE;
+				}
+				break;
+
+			case IMX_2D_REGION_INCLUSION_FULL:
+			{
+				Imx2dInternalBlitParams params =
+				{
+					source, params_in_use->source_region,
+					params_in_use->dest_region,
+					params_in_use->rotation,
+					expanded_dest_region_to_use,
+					params_in_use->alpha,
+					margin_fill_color
+				};
+
+				/* We can blit with zero adjustments, since the dest
+				 * region is fully inside the dest surface. */
+				IMX_2D_LOG(TRACE, "dest region is fully inside of the dest surface bounds");
+				store_blit_op(op, &params);
+				return TRUE;
+			}
+
+			case IMX_2D_REGION_INCLUSION_PARTIAL:
+			{
+				/* We must adjust both the dest and the source region,
+				 * since the dest region is only partially inside the
+				 * dest surface. We also have to adjust the source region,
+				 * because we can only blit a subset of the source region. */
+
+				Imx2dRegion const *source_region = (params_in_use->source_region != NULL) ? params_in_use->source_region : &(source->region);
+				Imx2dRegion const *dest_region = params_in_use->dest_region;
+				Imx2dRegion clipped_source_region;
+				Imx2dRegion clipped_dest_region;
+
+				int source_region_width = source_region->x2 - source_region->x1;
+				int source_region_height = source_region->y2 - source_region->y1;
+				int dest_region_width = dest_region->x2 - dest_region->x1;
+				int dest_region_height = dest_region->y2 - dest_region->y1;
+
+				imx_2d_region_intersect(
+					&clipped_dest_region,
+					dest_region,
+					clip_region
+				);
+
+				memcpy(&clipped_source_region, source_region, sizeof(Imx2dRegion));
+
+				switch (params_in_use->rotation)
+				{
+					case IMX_2D_ROTATION_NONE:
+						if (dest_region->x1 < clip_region->x1)
+							clipped_source_region.x1 += source_region_width * (clip_region->x1 - dest_region->x1) / dest_region_width;
+						if (dest_region->y1 < clip_region->y1)
+							clipped_source_region.y1 += source_region_height * (clip_region->y1 - dest_region->y1) / dest_region_height;
+						if (dest_region->x2 > clip_region->x2)
+							clipped_source_region.x2 -= source_region_width * (dest_region->x2 - clip_region->x2) / dest_region_width;
+						if (dest_region->y2 > clip_region->y2)
+							clipped_source_region.y2 -= source_region_height * (dest_region->y2 - clip_region->y2) / dest_region_height;
+						break;
+
+					case IMX_2D_ROTATION_90:
+						if (dest_region->x1 < clip_region->x1)
+							clipped_source_region.y2 -= source_region_height * (clip_region->x1 - dest_region->x1) / dest_region_width;
+						if (dest_region->y1 < clip_region->y1)
+							clipped_source_region.x1 += source_region_width * (clip_region->y1 - dest_region->y1) / dest_region_height;
+						if (dest_region->x2 > clip_region->x2)
+							clipped_source_region.y1 += source_region_height * (dest_region->x2 - clip_region->x2) / dest_region_width;
+						if (dest_region->y2 > clip_region->y2)
+							clipped_source_region.x2 -= source_region_width * (dest_region->y2 - clip_region->y2) / dest_region_height;
+						break;
+
+					case IMX_2D_ROTATION_180:
+						if (dest_region->x1 < clip_region->x1)
+							clipped_source_region.x2 -= source_region_width * (clip_region->x1 - dest_region->x1) / dest_region_width;
+						if (dest_region->y1 < clip_region->y1)
+							clipped_source_region.y2 -= source_region_height * (clip_region->y1 - dest_region->y1) / dest_region_height;
+						if (dest_region->x2 > clip_region->x2)
+							clipped_source_region.x1 += source_region_width * (dest_region->x2 - clip_region->x2) / dest_region_width;
+						if (dest_region->y2 > clip_region->y2)
+							clipped_source_region.y1 += source_region_height * (dest_region->y2 - clip_region->y2) / dest_region_height;
+						break;
+
+					case IMX_2D_ROTATION_270:
+						if (dest_region->x1 < clip_region->x1)
+							clipped_source_region.y1 += source_region_height * (clip_region->x1 - dest_region->x1) / dest_region_width;
+						if (dest_region->y1 < clip_region->y1)
+							clipped_source_region.x2 -= source_region_width * (clip_region->y1 - dest_region->y1) / dest_region_height;
+						if (dest_region->x2 > clip_region->x2)
+							clipped_source_region.y2 -= source_region_height * (dest_region->x2 - clip_region->x2) / dest_region_width;
+						if (dest_region->y2 > clip_region->y2)
+							clipped_source_region.x1 += source_region_width * (dest_region->y2 - clip_region->y2) / dest_region_height;
+						break;
+
+					case IMX_2D_ROTATION_FLIP_HORIZONTAL:
+						if (dest_region->x1 < clip_region->x1)
+							clipped_source_region.x2 -= source_region_width * (clip_region->x1 - dest_region->x1) / dest_region_width;
+						if (dest_region->y1 < clip_region->y1)
+							clipped_source_region.y1 += source_region_height * (clip_region->y1 - dest_region->y1) / dest_region_height;
+						if (dest_region->x2 > clip_region->x2)
+							clipped_source_region.x1 += source_region_width * (dest_region->x2 - clip_region->x2) / dest_region_width;
+						if (dest_region->y2 > clip_region->y2)
+							clipped_source_region.y2 -= source_region_height * (dest_region->y2 - clip_region->y2) / dest_region_height;
+						break;
+
+					case IMX_2D_ROTATION_FLIP_VERTICAL:
+						if (dest_region->x1 < clip_region->x1)
+							clipped_source_region.x1 += source_region_width * (clip_region->x1 - dest_region->x1) / dest_region_width;
+						if (dest_region->y1 < clip_region->y1)
+							clipped_source_region.y2 -= source_region_height * (clip_region->y1 - dest_region->y1) / dest_region_height;
+						if (dest_region->x2 > clip_region->x2)
+							clipped_source_region.x2 -= source_region_width * (dest_region->x2 - clip_region->x2) / dest_region_width;
+						if (dest_region->y2 > clip_region->y2)
+							clipped_source_region.y1 += source_region_height * (dest_region->y2 - clip_region->y2) / dest_region_height;
+						break;
+
+					case IMX_2D_ROTATION_UL_LR:
+						if (dest_region->x1 < clip_region->x1)
+							clipped_source_region.y1 += source_region_height * (clip_region->x1 - dest_region->x1) / dest_region_width;
+						if (dest_region->y1 < clip_region->y1)
+							clipped_source_region.x1 += source_region_width * (clip_region->y1 - dest_region->y1) / dest_region_height;
+						if (dest_region->x2 > clip_region->x2)
+							clipped_source_region.y2 -= source_region_height * (dest_region->x2 - clip_region->x2) / dest_region_width;
+						if (dest_region->y2 > clip_region->y2)
+							clipped_source_region.x2 -= source_region_width * (dest_region->y2 - clip_region->y2) / dest_region_height;
+						break;
+
+					case IMX_2D_ROTATION_UR_LL:
+						if (dest_region->x1 < clip_region->x1)
+							clipped_source_region.y2 -= source_region_height * (clip_region->x1 - dest_region->x1) / dest_region_width;
+						if (dest_region->y1 < clip_region->y1)
+							clipped_source_region.x2 -= source_region_width * (clip_region->y1 - dest_region->y1) / dest_region_height;
+						if (dest_region->x2 > clip_region->x2)
+							clipped_source_region.y1 += source_region_height * (dest_region->x2 - clip_region->x2) / dest_region_width;
+						if (dest_region->y2 > clip_region->y2)
+							clipped_source_region.x1 += source_region_width * (dest_region->y2 - clip_region->y2) / dest_region_height;
+						break;
+
+					default:
+						assert(FALSE);
+				}
+
+				IMX_2D_LOG(TRACE, "dest region is partially inside of the dest surface bounds");
+				IMX_2D_LOG(
+					TRACE,
+					"clipped source region: %" IMX_2D_REGION_FORMAT " clipped dest region: %" IMX_2D_REGION_FORMAT,
+					IMX_2D_REGION_ARGS(&clipped_source_region),
+					IMX_2D_REGION_ARGS(&clipped_dest_region)
+				);
+
+				{
+					Imx2dInternalBlitParams params =
+					{
+						source, &clipped_source_region,
+						&clipped_dest_region,
+						params_in_use->rotation,
+						expanded_dest_region_to_use,
+						params_in_use->alpha,
+						margin_fill_color
+					};
+					store_blit_op(op, &params);
+					return TRUE;
+				}
+			}
+
+			default:
+				assert(FALSE);
+		}
+
+		/* Should not be reached. Just here to shut up superfluous compiler warnings. */
+		return FALSE;
+	}
+	else
+	{
+		/* dest_region is not set. This implies that we can directly
+		 * go ahead and do the blitter operation, since then, the
+		 * entire dest surface is the dest region, so a full inclusion
+		 * of the dest region is implied. No need to calculate
+		 * inclusions, intersections etc. */
+
+		Imx2dInternalBlitParams params =
+		{
+			source, params_in_use->source_region,
+			clip_region,
+			params_in_use->rotation,
+			NULL,
+			params_in_use->alpha,
+			/* Setting the margin fill color to 0 since the margin is anyway not present in this case */
+			0x00000000
+		};
+
+		store_blit_op(op, &params);
+		return TRUE;
+	}
+}
+
+
+/* Blits once for each damage region of the dest surface,
+ * clipped to that region. Used if damage tracking is enabled. */
+static int do_damage_clipped_blit(Imx2dBlitter *blitter, Imx2dSurface *source, Imx2dBlitParams const *params_in_use)
+{
+	Imx2dSurface *dest = blitter->dest;
+	int i;
+
+	IMX_2D_LOG(TRACE, "clipping blit against %d damage region(s)", dest->num_damage_regions);
+
+	for (i = 0; i < dest->num_damage_regions; ++i)
+	{
+		Imx2dInternalBatchOp op;
+
+		if (!compute_blit_op(source, dest, &(dest->damage_regions[i]), params_in_use, &op))
+			return FALSE;
+
+		if (!dispatch_op(blitter, &op))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+/* Multi-pass downscaling. Blits that downscale by more than the
+ * hardware's max_downscale_factor are split into a chain of passes.
+ * All but the last pass downscale into intermediate surfaces, each by
+ * at most that factor; the last one blits the smallest intermediate
+ * surface to the actual dest surface with the original params.
+ * The intermediate sizes are picked greedily, that is, each pass
+ * downscales as much as it may. This keeps the intermediate
+ * surfaces as small as possible, which saves memory bandwidth. */
+
+
+typedef struct
+{
+	/* Source region, clipped against the source surface. */
+	Imx2dRegion source_region;
+	Imx2dPixelFormat format;
+	int num_intermediates;
+	int widths[IMX_2D_MAX_NUM_SCALING_PASSES - 1];
+	int heights[IMX_2D_MAX_NUM_SCALING_PASSES - 1];
+}
+Imx2dScalingChain;
+
+
+static BOOL rotation_transposes(Imx2dRotation rotation)
+{
+	switch (rotation)
+	{
+		case IMX_2D_ROTATION_90:
+		case IMX_2D_ROTATION_270:
+		case IMX_2D_ROTATION_UL_LR:
+		case IMX_2D_ROTATION_UR_LL:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+
+/* Rounds size up to the next valid size according to min_size
+ * and step_size (see Imx2dHardwareCapabilities), but does not
+ * go beyond max_size. */
+static int round_intermediate_size(int size, int min_size, int step_size, int max_size)
+{
+	if (size <= min_size)
+		size = min_size;
+	else
+		size = min_size + (size - min_size + step_size - 1) / step_size * step_size;
+
+	return MIN(size, max_size);
+}
+
+
+/* Picks the pixel format of the intermediate surfaces. The source
+ * format is preferred, since it avoids color space conversions, but
+ * the hardware must be able to blit to it. The dest format always
+ * works, since the final pass blits to the dest surface anyway. */
+static Imx2dPixelFormat get_intermediate_format(Imx2dHardwareCapabilities const *caps, Imx2dSurface *source, Imx2dSurface *dest)
+{
+	int i;
+
+	for (i = 0; i < caps->num_supported_dest_pixel_formats; ++i)
+	{
+		if (caps->supported_dest_pixel_formats[i] == source->desc.format)
+			return source->desc.format;
+	}
+
+	return dest->desc.format;
+}
+
+
+/* Computes the chain of intermediate surface sizes for the blit.
+ * Returns FALSE if the blit does not need multiple passes. */
+static BOOL plan_scaling_chain(Imx2dBlitter *blitter, Imx2dSurface *source, Imx2dBlitParams const *params, Imx2dScalingChain *chain)
+{
+	Imx2dHardwareCapabilities const *caps = imx_2d_blitter_get_hardware_capabilities(blitter);
+	Imx2dRegion const *dest_region;
+	Imx2dPixelFormatInfo const *fmt_info;
+	int max_factor = caps->max_downscale_factor;
+	int target_width, target_height;
+	int width, height;
+	int width_step, height_step;
+
+	if (max_factor <= 1)
+		return FALSE;
+
+	if (params->source_region != NULL)
+		imx_2d_region_intersect(&(chain->source_region), params->source_region, &(source->region));
+	else
+		chain->source_region = source->region;
+
+	if (region_is_empty(&(chain->source_region)))
+		return FALSE;
+
+	dest_region = (params->dest_region != NULL) ? params->dest_region : &(blitter->dest->region);
+
+	/* The intermediate passes do not rotate, so with 90 and 270
+	 * degree rotations, the dest width corresponds to the source
+	 * height and vice versa. */
+	if (rotation_transposes(params->rotation))
+	{
+		target_width = dest_region->y2 - dest_region->y1;
+		target_height = dest_region->x2 - dest_region->x1;
+	}
+	else
+	{
+		target_width = dest_region->x2 - dest_region->x1;
+		target_height = dest_region->y2 - dest_region->y1;
+	}
+
+	if ((target_width <= 0) || (target_height <= 0))
+		return FALSE;
+
+	width = chain->source_region.x2 - chain->source_region.x1;
+	height = chain->source_region.y2 - chain->source_region.y1;
+
+	if ((width <= (int64_t)target_width * max_factor) && (height <= (int64_t)target_height * max_factor))
+		return FALSE;
+
+	chain->format = get_intermediate_format(caps, source, blitter->dest);
+	fmt_info = imx_2d_get_pixel_format_info(chain->format);
+	assert(fmt_info != NULL);
+
+	/* Intermediate sizes must be valid surface sizes, and YUV
+	 * surfaces need sizes that are a multiple of the chroma
+	 * subsampling. (Both are powers of two.) */
+	width_step = MAX(caps->width_step_size, fmt_info->x_subsampling);
+	height_step = MAX(caps->height_step_size, fmt_info->y_subsampling);
+
+	chain->num_intermediates = 0;
+
+	while ((chain->num_intermediates < (IMX_2D_MAX_NUM_SCALING_PASSES - 1))
+	    && ((width > (int64_t)target_width * max_factor) || (height > (int64_t)target_height * max_factor)))
+	{
+		/* Directions that do not need downscaling, or that
+		 * upscale, keep their size until the last pass. */
+		int next_width = MIN(width, MAX(target_width, (width + max_factor - 1) / max_factor));
+		int next_height = MIN(height, MAX(target_height, (height + max_factor - 1) / max_factor));
+
+		next_width = round_intermediate_size(next_width, caps->min_width, width_step, width);
+		next_height = round_intermediate_size(next_height, caps->min_height, height_step, height);
+
+		if ((next_width == width) && (next_height == height))
+			break;
+
+		chain->widths[chain->num_intermediates] = width = next_width;
+		chain->heights[chain->num_intermediates] = height = next_height;
+		chain->num_intermediates++;
+	}
+
+	return (chain->num_intermediates > 0);
+}
+
+
+/* Sets up the intermediate surface with the given index. Its DMA
+ * buffer is only reallocated if the existing one is too small. */
+static BOOL setup_intermediate_surface(Imx2dBlitter *blitter, int index, Imx2dPixelFormat format, int width, int height, Imx2dSurfaceDesc const *source_desc)
+{
+	Imx2dHardwareCapabilities const *caps = imx_2d_blitter_get_hardware_capabilities(blitter);
+	Imx2dPixelFormatInfo const *fmt_info = imx_2d_get_pixel_format_info(format);
+	Imx2dSurface *surface = &(blitter->intermediate_surfaces[index]);
+	Imx2dSurfaceDesc desc;
+	int plane_offsets[3];
+	int stride_alignment, num_rows, num_plane_rows;
+	size_t total_size;
+	int plane_nr;
+
+	memset(&desc, 0, sizeof(desc));
+	desc.width = width;
+	desc.height = height;
+	desc.format = format;
+	desc.is_opaque = source_desc->is_opaque;
+	desc.color_matrix = source_desc->color_matrix;
+	desc.color_range = source_desc->color_range;
+
+	/* With fully planar formats, the chroma strides are derived from
+	 * the luma stride, so the luma stride is aligned such that the
+	 * chroma strides are aligned as well. */
+	stride_alignment = caps->stride_alignment * ((fmt_info->num_planes == 3) ? fmt_info->x_subsampling : 1);
+	num_rows = (height + caps->total_row_count_alignment - 1) / caps->total_row_count_alignment * caps->total_row_count_alignment;
+	desc.num_padding_rows = num_rows - height;
+
+	total_size = 0;
+	for (plane_nr = 0; plane_nr < fmt_info->num_planes; ++plane_nr)
+	{
+		if (plane_nr == 0)
+		{
+			desc.plane_strides[0] = (width * fmt_info->pixel_stride + stride_alignment - 1) / stride_alignment * stride_alignment;
+			num_plane_rows = num_rows;
+		}
+		else
+		{
+			desc.plane_strides[plane_nr] = fmt_info->is_semi_planar ? desc.plane_strides[0] : (desc.plane_strides[0] / fmt_info->x_subsampling);
+			num_plane_rows = (num_rows + fmt_info->y_subsampling - 1) / fmt_info->y_subsampling;
+		}
+
+		plane_offsets[plane_nr] = total_size;
+		total_size += (size_t)(desc.plane_strides[plane_nr]) * num_plane_rows;
+	}
+
+	if ((blitter->intermediate_dma_buffers[index] != NULL) && (imx_dma_buffer_get_size(blitter->intermediate_dma_buffers[index]) < total_size))
+	{
+		imx_dma_buffer_deallocate(blitter->intermediate_dma_buffers[index]);
+		blitter->intermediate_dma_buffers[index] = NULL;
+	}
+
+	if (blitter->intermediate_dma_buffers[index] == NULL)
+	{
+		int error = 0;
+
+		if (blitter->intermediate_allocator == NULL)
+		{
+			blitter->intermediate_allocator = imx_dma_buffer_allocator_new(&error);
+			if (blitter->intermediate_allocator == NULL)
+			{
+				IMX_2D_LOG(ERROR, "could not create DMA buffer allocator for intermediate surfaces: %s (%d)", strerror(error), error);
+				return FALSE;
+			}
+		}
+
+		blitter->intermediate_dma_buffers[index] = imx_dma_buffer_allocate(blitter->intermediate_allocator, total_size, caps->stride_alignment, &error);
+		if (blitter->intermediate_dma_buffers[index] == NULL)
+		{
+			IMX_2D_LOG(ERROR, "could not allocate %zu byte(s) for intermediate surface #%d: %s (%d)", total_size, index, strerror(error), error);
+			return FALSE;
+		}
 
-					case IMX_2D_ROTATION_UR_LL:
-						if (dest_region->x1 < 0)
-							clipped_source_region.y2 -= source_region_height * (-dest_region->x1) / dest_region_width;
-						if (dest_region->y1 < 0)
-							clipped_source_region.x2 -= source_region_width * (-dest_region->y1) / dest_region_height;
-						if (dest_region->x2 > blitter->dest->region.x2)
-							clipped_source_region.y1 += source_region_height * (dest_region->x2 - blitter->dest->region.x2) / dest_region_width;
-						if (dest_region->y2 > blitter->dest->region.y2)
-							clipped_source_region.x1 += source_region_width * (dest_region->y2 - blitter->dest->region.y2) / dest_region_height;
-						break;
+		IMX_2D_LOG(DEBUG, "allocated %zu byte(s) for intermediate surface #%d", total_size, index);
+	}
 
-					default:
-						assert(FALSE);
-				}
+	imx_2d_surface_set_desc(surface, &desc);
+	for (plane_nr = 0; plane_nr < fmt_info->num_planes; ++plane_nr)
+		imx_2d_surface_set_dma_buffer(surface, blitter->intermediate_dma_buffers[index], plane_nr, plane_offsets[plane_nr]);
 
-				IMX_2D_LOG(TRACE, "dest region is partially inside of the dest surface bounds");
-				IMX_2D_LOG(
-					TRACE,
-					"clipped source region: %" IMX_2D_REGION_FORMAT " clipped dest region: %" IMX_2D_REGION_FORMAT,
-					IMX_2D_REGION_ARGS(&clipped_source_region),
-					IMX_2D_REGION_ARGS(&clipped_dest_region)
-				);
+	return TRUE;
+}
 
-				{
-					Imx2dInternalBlitParams params =
-					{
-						source, &clipped_source_region,
-						&clipped_dest_region,
-						params_in_use->rotation,
-						expanded_dest_region_to_use,
-						params_in_use->alpha,
-						margin_fill_color
-					};
-					return blitter->blitter_class->do_blit(blitter, &params);
-				}
-			}
 
-			default:
-				assert(FALSE);
-		}
+static int do_multi_pass_blit(Imx2dBlitter *blitter, Imx2dSurface *source, Imx2dBlitParams const *params, Imx2dScalingChain const *chain)
+{
+	Imx2dBlitterClass *blitter_class = blitter->blitter_class;
+	Imx2dSurface *dest = blitter->dest;
+	Imx2dSurface *last_intermediate;
+	Imx2dSurface pass_source;
+	Imx2dBlitParams pass_params;
+	Imx2dBlitParams final_params;
+	Imx2dInternalBatchOp op;
+	BOOL batch_was_active = blitter->batch_active;
+	BOOL passes_ok = TRUE;
+	int i;
+
+	IMX_2D_LOG(
+		DEBUG,
+		"splitting blit into %d passes; source region: %" IMX_2D_REGION_FORMAT " intermediate format: %s",
+		chain->num_intermediates + 1,
+		IMX_2D_REGION_ARGS(&(chain->source_region)),
+		imx_2d_pixel_format_to_string(chain->format)
+	);
+
+	for (i = 0; i < chain->num_intermediates; ++i)
+	{
+		IMX_2D_LOG(DEBUG, "intermediate surface #%d: %dx%d", i, chain->widths[i], chain->heights[i]);
+		if (!setup_intermediate_surface(blitter, i, chain->format, chain->widths[i], chain->heights[i], &(source->desc)))
+			return FALSE;
+	}
 
-		/* Should not be reached. Just here to shut up superfluous compiler warnings. */
+	/* Operations that were queued (or recorded in a batch) before
+	 * this blit have to be executed first, and the backend can only
+	 * blit to the intermediate surfaces in sequences of their own.
+	 * So, the current sequence is finished, and restarted after
+	 * the intermediate passes. */
+	if (batch_was_active && !imx_2d_blitter_submit_batch(blitter))
 		return FALSE;
-	}
-	else
+
+	if (!blitter_class->finish(blitter))
+		return FALSE;
+
+	/* The intermediate passes copy the alpha values instead of blending
+	 * them onto the undefined intermediate pixels, so they use a copy
+	 * of their source surface that is marked as opaque. The original
+	 * opaque flag is in the intermediate surfaces' descriptions, and
+	 * is therefore honored by the final pass. */
+	pass_source = *source;
+	pass_source.desc.is_opaque = TRUE;
+	pass_source.damage_tracking = FALSE;
+
+	memset(&pass_params, 0, sizeof(pass_params));
+	pass_params.source_region = &(chain->source_region);
+	pass_params.rotation = IMX_2D_ROTATION_NONE;
+	pass_params.alpha = 255;
+
+	for (i = 0; passes_ok && (i < chain->num_intermediates); ++i)
 	{
-		/* dest_region is not set. This implies that we can directly
-		 * go ahead and do the blitter operation, since then, the
-		 * entire dest surface is the dest region, so a full inclusion
-		 * of the dest region is implied. No need to calculate
-		 * inclusions, intersections etc. */
+		Imx2dSurface *intermediate = &(blitter->intermediate_surfaces[i]);
 
-		Imx2dInternalBlitParams params =
+		blitter->dest = intermediate;
+		if (!blitter_class->start(blitter))
 		{
-			source, params_in_use->source_region,
-			&(blitter->dest->region),
-			params_in_use->rotation,
-			NULL,
-			params_in_use->alpha,
-			/* Setting the margin fill color to 0 since the margin is anyway not present in this case */
-			0x00000000
-		};
+			passes_ok = FALSE;
+			break;
+		}
+
+		passes_ok = compute_blit_op(&pass_source, intermediate, &(intermediate->region), &pass_params, &op)
+		         && dispatch_op(blitter, &op);
+		passes_ok = blitter_class->finish(blitter) && passes_ok;
 
-		return blitter->blitter_class->do_blit(blitter, &params);
+		pass_source = *intermediate;
+		pass_source.desc.is_opaque = TRUE;
+		pass_params.source_region = NULL;
 	}
+
+	blitter->dest = dest;
+	if (!blitter_class->start(blitter) || !passes_ok)
+		return FALSE;
+
+	if (batch_was_active)
+		blitter->batch_active = TRUE;
+
+	last_intermediate = &(blitter->intermediate_surfaces[chain->num_intermediates - 1]);
+
+	final_params = *params;
+	final_params.source_region = NULL;
+
+	if (dest->damage_tracking)
+		return do_damage_clipped_blit(blitter, last_intermediate, &final_params);
+
+	if (!compute_blit_op(last_intermediate, dest, &(dest->region), &final_params, &op))
+		return FALSE;
+
+	return dispatch_op(blitter, &op);
+}
+
+
+int imx_2d_blitter_do_blit(Imx2dBlitter *blitter, Imx2dSurface *source, Imx2dBlitParams const *params)
+{
+	Imx2dInternalBatchOp op;
+	Imx2dScalingChain scaling_chain;
+	Imx2dBlitParams const *params_in_use = (params != NULL) ? params : &default_blit_params;
+
+	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->do_blit != NULL));
+	assert(blitter->dest != NULL);
+
+	if (plan_scaling_chain(blitter, source, params_in_use, &scaling_chain))
+		return do_multi_pass_blit(blitter, source, params_in_use, &scaling_chain);
+
+	if (blitter->dest->damage_tracking)
+		return do_damage_clipped_blit(blitter, source, params_in_use);
+
+	if (!compute_blit_op(source, blitter->dest, &(blitter->dest->region), params_in_use, &op))
+		return FALSE;
+
+	return dispatch_op(blitter, &op);
 }
 
 
 int imx_2d_blitter_fill_region(Imx2dBlitter *blitter, Imx2dRegion const *dest_region, uint32_t fill_color)
 {
+	assert(blitter != NULL);
+	assert(blitter->dest != NULL);
+
+	if (dest_region == NULL)
+		dest_region = &(blitter->dest->region);
+
+	return imx_2d_blitter_fill_regions(blitter, dest_region, 1, fill_color);
+}
+
+
+int imx_2d_blitter_fill_regions(Imx2dBlitter *blitter, Imx2dRegion const *dest_regions, int num_dest_regions, uint32_t fill_color)
+{
+	Imx2dSurface *dest;
+	Imx2dRegion clipped_dest_regions[IMX_2D_MAX_NUM_FILL_REGIONS_PER_CALL];
+	int num_clipped_dest_regions = 0;
+	int i, j;
+
 	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->fill_region != NULL));
+	assert(blitter->dest != NULL);
+	assert((dest_regions != NULL) || (num_dest_regions == 0));
+
+	dest = blitter->dest;
 
+	/* Clip the regions against the dest surface, or, if damage tracking
+	 * is enabled, against each damage region (these are always inside
+	 * the dest surface). The clipped regions are collected so that the
+	 * backend can fill several of them in one go. */
+	for (i = 0; i < num_dest_regions; ++i)
 	{
-		Imx2dInternalFillRegionParams params =
+		Imx2dRegion const *clip_regions = dest->damage_tracking ? dest->damage_regions : &(dest->region);
+		int num_clip_regions = dest->damage_tracking ? dest->num_damage_regions : 1;
+
+		for (j = 0; j < num_clip_regions; ++j)
 		{
-			(dest_region != NULL) ? dest_region : &(blitter->dest->region),
-			fill_color
-		};
+			Imx2dRegion *clipped_dest_region = &(clipped_dest_regions[num_clipped_dest_regions]);
+
+			imx_2d_region_intersect(clipped_dest_region, &(dest_regions[i]), &(clip_regions[j]));
+			if (region_is_empty(clipped_dest_region))
+				continue;
 
-		return blitter->blitter_class->fill_region(blitter, &params);
+			++num_clipped_dest_regions;
+
+			if (num_clipped_dest_regions == IMX_2D_MAX_NUM_FILL_REGIONS_PER_CALL)
+			{
+				if (!dispatch_fill_regions(blitter, clipped_dest_regions, num_clipped_dest_regions, fill_color))
+					return FALSE;
+				num_clipped_dest_regions = 0;
+			}
+		}
 	}
+
+	if (num_clipped_dest_regions > 0)
+		return dispatch_fill_regions(blitter, clipped_dest_regions, num_clipped_dest_regions, fill_color);
+	else
+		return TRUE;
 }
 
 
@@ -697,3 +1960,358 @@ Imx2dHardwareCapabilities const * imx_2d_blitter_get_hardware_capabilities(Imx2d
 	assert((blitter != NULL) && (blitter->blitter_class != NULL) && (blitter->blitter_class->get_hardware_capabilities != NULL));
 	return blitter->blitter_class->get_hardware_capabilities(blitter);
 }
+
+
+char const * imx_2d_blitter_get_backend_name(Imx2dBlitter *blitter)
+{
+	assert((blitter != NULL) && (blitter->blitter_class != NULL));
+	return (blitter->blitter_class->name != NULL) ? blitter->blitter_class->name : "<unknown>";
+}
+
+
+
+
+/***********************/
+/****** STATISTICS *****/
+/***********************/
+
+
+char const * imx_2d_op_type_to_string(Imx2dOpType op_type)
+{
+	switch (op_type)
+	{
+		case IMX_2D_OP_TYPE_BLIT: return "blit";
+		case IMX_2D_OP_TYPE_FILL_REGION: return "fill-region";
+		case IMX_2D_OP_TYPE_BATCH: return "batch";
+		case IMX_2D_OP_TYPE_FINISH: return "finish";
+		default: return "<unknown>";
+	}
+}
+
+
+void imx_2d_blitter_set_stats_func(Imx2dBlitter *blitter, Imx2dStatsFunc stats_func, void *user_data)
+{
+	assert(blitter != NULL);
+	blitter->stats_func = stats_func;
+	blitter->stats_user_data = user_data;
+}
+
+
+void imx_2d_blitter_get_stats(Imx2dBlitter *blitter, Imx2dBlitterStats *stats)
+{
+	assert(blitter != NULL);
+	assert(stats != NULL);
+	*stats = blitter->stats;
+}
+
+
+void imx_2d_blitter_reset_stats(Imx2dBlitter *blitter)
+{
+	assert(blitter != NULL);
+	memset(&(blitter->stats), 0, sizeof(Imx2dBlitterStats));
+}
+
+
+void imx_2d_blitter_stats_add(Imx2dBlitterStats *stats, Imx2dOpStats const *op_stats)
+{
+	int64_t duration;
+	Imx2dOpType op_type;
+
+	assert(stats != NULL);
+	assert(op_stats != NULL);
+	assert((op_stats->op_type >= 0) && (op_stats->op_type < IMX_2D_NUM_OP_TYPES));
+
+	op_type = op_stats->op_type;
+	duration = op_stats->completion_time - op_stats->submit_time;
+
+	stats->num_ops[op_type]++;
+	stats->num_pixels[op_type] += op_stats->num_pixels;
+	stats->num_bytes[op_type] += op_stats->num_bytes;
+	stats->total_duration[op_type] += duration;
+	stats->max_duration[op_type] = MAX(stats->max_duration[op_type], duration);
+}
+
+
+
+
+/***********************/
+/****** BLIT PLAN ******/
+/***********************/
+
+
+static void destroy_backend_plan_data(Imx2dBlitPlan *plan)
+{
+	if (plan->backend_plan_data == NULL)
+		return;
+
+	assert(plan->blitter->blitter_class->destroy_plan_data != NULL);
+	plan->blitter->blitter_class->destroy_plan_data(plan->blitter, plan->backend_plan_data);
+	plan->backend_plan_data = NULL;
+}
+
+
+static int build_plan(Imx2dBlitPlan *plan)
+{
+	Imx2dBlitterClass *blitter_class = plan->blitter->blitter_class;
+
+	destroy_backend_plan_data(plan);
+	plan->built = FALSE;
+
+	IMX_2D_LOG(DEBUG, "building blit plan %p", (void *)plan);
+
+	/* The op is stored inside the plan, so the region
+	 * pointers in its params stay valid as long as
+	 * the plan exists. */
+	if (!compute_blit_op(plan->source, plan->dest, &(plan->dest->region), &(plan->params), &(plan->op)))
+		return FALSE;
+
+	if ((plan->op.type == IMX_2D_INTERNAL_BATCH_OP_TYPE_BLIT) && (blitter_class->create_plan_data != NULL))
+	{
+		assert(blitter_class->do_planned_blit != NULL);
+		plan->backend_plan_data = blitter_class->create_plan_data(plan->blitter, plan->dest, &(plan->op.blit_params));
+		plan->op.plan_data = plan->backend_plan_data;
+	}
+
+	memcpy(&(plan->source_desc), imx_2d_surface_get_desc(plan->source), sizeof(Imx2dSurfaceDesc));
+	memcpy(&(plan->dest_desc), imx_2d_surface_get_desc(plan->dest), sizeof(Imx2dSurfaceDesc));
+	plan->built = TRUE;
+
+	return TRUE;
+}
+
+
+static BOOL regions_match(Imx2dRegion const *first_region, Imx2dRegion const *second_region)
+{
+	if ((first_region == NULL) || (second_region == NULL))
+		return (first_region == NULL) && (second_region == NULL);
+	else
+		return imx_2d_region_check_if_equal(first_region, second_region);
+}
+
+
+static BOOL margins_match(Imx2dBlitMargin const *first_margin, Imx2dBlitMargin const *second_margin)
+{
+	if ((first_margin == NULL) || (second_margin == NULL))
+		return (first_margin == NULL) && (second_margin == NULL);
+	else
+		return (first_margin->left_margin == second_margin->left_margin)
+		    && (first_margin->top_margin == second_margin->top_margin)
+		    && (first_margin->right_margin == second_margin->right_margin)
+		    && (first_margin->bottom_margin == second_margin->bottom_margin)
+		    && (first_margin->color == second_margin->color);
+}
+
+
+Imx2dBlitPlan* imx_2d_blit_plan_create(Imx2dBlitter *blitter, Imx2dSurface *source, Imx2dSurface *dest, Imx2dBlitParams const *params)
+{
+	Imx2dBlitPlan *plan;
+
+	assert(blitter != NULL);
+	assert(source != NULL);
+	assert(dest != NULL);
+
+	plan = malloc(sizeof(Imx2dBlitPlan));
+	if (plan == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not allocate blit plan");
+		return NULL;
+	}
+
+	memset(plan, 0, sizeof(Imx2dBlitPlan));
+
+	plan->blitter = blitter;
+	plan->source = source;
+	plan->dest = dest;
+
+	plan->params = (params != NULL) ? *params : default_blit_params;
+	if (plan->params.source_region != NULL)
+	{
+		plan->source_region = *(plan->params.source_region);
+		plan->params.source_region = &(plan->source_region);
+	}
+	if (plan->params.dest_region != NULL)
+	{
+		plan->dest_region = *(plan->params.dest_region);
+		plan->params.dest_region = &(plan->dest_region);
+	}
+	if (plan->params.margin != NULL)
+	{
+		plan->margin = *(plan->params.margin);
+		plan->params.margin = &(plan->margin);
+	}
+
+	plan->built = FALSE;
+	plan->backend_plan_data = NULL;
+
+	return plan;
+}
+
+
+void imx_2d_blit_plan_destroy(Imx2dBlitPlan *plan)
+{
+	if (plan == NULL)
+		return;
+
+	destroy_backend_plan_data(plan);
+	free(plan);
+}
+
+
+int imx_2d_blit_plan_matches(Imx2dBlitPlan const *plan, Imx2dSurface *source, Imx2dSurface *dest, Imx2dBlitParams const *params)
+{
+	Imx2dBlitParams const *params_in_use = (params != NULL) ? params : &default_blit_params;
+
+	assert(plan != NULL);
+
+	return (plan->source == source)
+	    && (plan->dest == dest)
+	    && (plan->params.rotation == params_in_use->rotation)
+	    && (plan->params.alpha == params_in_use->alpha)
+	    && regions_match(plan->params.source_region, params_in_use->source_region)
+	    && regions_match(plan->params.dest_region, params_in_use->dest_region)
+	    && margins_match(plan->params.margin, params_in_use->margin);
+}
+
+
+int imx_2d_blitter_do_planned_blit(Imx2dBlitter *blitter, Imx2dBlitPlan *plan)
+{
+	Imx2dScalingChain scaling_chain;
+
+	assert((blitter != NULL) && (blitter->blitter_class != NULL));
+	assert(plan != NULL);
+	assert(plan->blitter == blitter);
+
+	if (blitter->dest != plan->dest)
+	{
+		IMX_2D_LOG(ERROR, "blit plan was created for a different dest surface than the one the sequence was started with");
+		return FALSE;
+	}
+
+	/* The planned op is a single blit, so multi-pass blits
+	 * are done as if imx_2d_blitter_do_blit() was called. */
+	if (plan_scaling_chain(blitter, plan->source, &(plan->params), &scaling_chain))
+		return do_multi_pass_blit(blitter, plan->source, &(plan->params), &scaling_chain);
+
+	/* The planned op covers the entire dest surface. With damage
+	 * tracking, the blit has to be clipped against the damage
+	 * regions, which change from one sequence to the next, so
+	 * the plan's params are used directly in that case. */
+	if (plan->dest->damage_tracking)
+		return do_damage_clipped_blit(blitter, plan->source, &(plan->params));
+
+	/* Imx2dSurfaceDesc only contains integers, so memcmp()
+	 * is a reliable way to compare two of these. */
+	if (!(plan->built)
+	 || (memcmp(&(plan->source_desc), imx_2d_surface_get_desc(plan->source), sizeof(Imx2dSurfaceDesc)) != 0)
+	 || (memcmp(&(plan->dest_desc), imx_2d_surface_get_desc(plan->dest), sizeof(Imx2dSurfaceDesc)) != 0))
+	{
+		if (!build_plan(plan))
+			return FALSE;
+	}
+
+	return dispatch_op(blitter, &(plan->op));
+}
+
+
+
+
+/***********************/
+/******** FENCE ********/
+/***********************/
+
+
+Imx2dFence* imx_2d_fence_new(void)
+{
+	Imx2dFence *fence = malloc(sizeof(Imx2dFence));
+	if (fence == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not allocate fence");
+		return NULL;
+	}
+
+	pthread_mutex_init(&(fence->mutex), NULL);
+	pthread_cond_init(&(fence->cond), NULL);
+	fence->refcount = 1;
+	fence->signaled = FALSE;
+	fence->result = FALSE;
+	fence->signal_time = 0;
+
+	return fence;
+}
+
+
+void imx_2d_fence_signal(Imx2dFence *fence, int result)
+{
+	assert(fence != NULL);
+
+	pthread_mutex_lock(&(fence->mutex));
+	assert(!fence->signaled);
+	fence->signaled = TRUE;
+	fence->result = result;
+	fence->signal_time = imx_2d_get_monotonic_time();
+	pthread_cond_broadcast(&(fence->cond));
+	pthread_mutex_unlock(&(fence->mutex));
+}
+
+
+Imx2dFence* imx_2d_fence_ref(Imx2dFence *fence)
+{
+	assert(fence != NULL);
+
+	pthread_mutex_lock(&(fence->mutex));
+	assert(fence->refcount > 0);
+	fence->refcount++;
+	pthread_mutex_unlock(&(fence->mutex));
+
+	return fence;
+}
+
+
+void imx_2d_fence_unref(Imx2dFence *fence)
+{
+	int refcount;
+
+	assert(fence != NULL);
+
+	pthread_mutex_lock(&(fence->mutex));
+	assert(fence->refcount > 0);
+	refcount = --fence->refcount;
+	pthread_mutex_unlock(&(fence->mutex));
+
+	if (refcount == 0)
+	{
+		pthread_cond_destroy(&(fence->cond));
+		pthread_mutex_destroy(&(fence->mutex));
+		free(fence);
+	}
+}
+
+
+int imx_2d_fence_poll(Imx2dFence *fence)
+{
+	BOOL signaled;
+
+	assert(fence != NULL);
+
+	pthread_mutex_lock(&(fence->mutex));
+	signaled = fence->signaled;
+	pthread_mutex_unlock(&(fence->mutex));
+
+	return signaled;
+}
+
+
+int imx_2d_fence_wait(Imx2dFence *fence)
+{
+	int result;
+
+	assert(fence != NULL);
+
+	pthread_mutex_lock(&(fence->mutex));
+	while (!fence->signaled)
+		pthread_cond_wait(&(fence->cond), &(fence->mutex));
+	result = fence->result;
+	pthread_mutex_unlock(&(fence->mutex));
+
+	return result;
+}
@@ -212,6 +212,67 @@ Imx2dRotation;
 char const * imx_2d_rotation_to_string(Imx2dRotation rotation);
 
 
+/**
+ * Imx2dColorMatrix:
+ * @IMX_2D_COLOR_MATRIX_DEFAULT: Backend default (BT.601).
+ * @IMX_2D_COLOR_MATRIX_BT601: ITU-R BT.601 coefficients (SD video).
+ * @IMX_2D_COLOR_MATRIX_BT709: ITU-R BT.709 coefficients (HD video).
+ * @IMX_2D_COLOR_MATRIX_BT2020: ITU-R BT.2020 non-constant luminance coefficients.
+ *
+ * Matrix coefficients for converting between YUV and RGB.
+ */
+typedef enum
+{
+	IMX_2D_COLOR_MATRIX_DEFAULT = 0,
+	IMX_2D_COLOR_MATRIX_BT601,
+	IMX_2D_COLOR_MATRIX_BT709,
+	IMX_2D_COLOR_MATRIX_BT2020
+}
+Imx2dColorMatrix;
+
+/**
+ * imx_2d_color_matrix_to_string:
+ * @matrix: Color matrix to return a string for.
+ *
+ * Returns a human-readable string representation of the given color matrix.
+ *
+ * This string is not suitable as an ID and is meant purely for logging and for information on user interfaces.
+ *
+ * Returns: Human-readable string representation
+ */
+char const * imx_2d_color_matrix_to_string(Imx2dColorMatrix matrix);
+
+
+/**
+ * Imx2dColorRange:
+ * @IMX_2D_COLOR_RANGE_DEFAULT: Backend default (limited range).
+ * @IMX_2D_COLOR_RANGE_LIMITED: Limited ("studio swing") range, with Y
+ *     values in the 16-235 range and U/V values in the 16-240 range.
+ * @IMX_2D_COLOR_RANGE_FULL: Full range, with Y/U/V values in the 0-255 range.
+ *
+ * Value range of YUV samples.
+ */
+typedef enum
+{
+	IMX_2D_COLOR_RANGE_DEFAULT = 0,
+	IMX_2D_COLOR_RANGE_LIMITED,
+	IMX_2D_COLOR_RANGE_FULL
+}
+Imx2dColorRange;
+
+/**
+ * imx_2d_color_range_to_string:
+ * @range: Color range to return a string for.
+ *
+ * Returns a human-readable string representation of the given color range.
+ *
+ * This string is not suitable as an ID and is meant purely for logging and for information on user interfaces.
+ *
+ * Returns: Human-readable string representation
+ */
+char const * imx_2d_color_range_to_string(Imx2dColorRange range);
+
+
 typedef struct _Imx2dPixelFormatInfo Imx2dPixelFormatInfo;
 
 
@@ -283,6 +344,15 @@ typedef struct _Imx2dHardwareCapabilities Imx2dHardwareCapabilities;
  *     supports blitting from/to multi-buffer surfaces. If a
  *     surface uses a different DMA buffer for at least one
  *     of its planes, it is considered a multi-buffer surface.
+ * @draws_blit_margins_for_free: Nonzero if the hardware draws
+ *     blit margins (see @Imx2dBlitMargin) as part of the blit
+ *     itself, at no extra cost. If this is zero, margins are
+ *     drawn with separate fill operations, and drawing them
+ *     with @imx_2d_blitter_fill_regions instead costs the same.
+ * @max_downscale_factor: Largest factor by which the hardware can
+ *     downscale in one blit without losing quality or speed, or 0
+ *     if there is no such limit. See @imx_2d_blitter_do_blit for
+ *     how blits that downscale by more than this are handled.
  *
  * Describes the capabilities of the underlying 2D hardware.
  *
@@ -306,6 +376,10 @@ struct _Imx2dHardwareCapabilities
 	int total_row_count_alignment;
 
 	int can_handle_multi_buffer_surfaces;
+
+	int draws_blit_margins_for_free;
+
+	int max_downscale_factor;
 };
 
 
@@ -485,6 +559,10 @@ typedef struct _Imx2dSurface Imx2dSurface;
  * @plane_strides: Plane stride values, in bytes.
  * @num_padding_rows: Number of extra padding rows at the bottom.
  * @format: Pixel format of the surface.
+ * @is_opaque: Nonzero if all pixels of the surface are known to be
+ *     fully opaque, even though @format has an alpha channel.
+ * @color_matrix: YUV<->RGB matrix of the surface's pixels.
+ * @color_range: Value range of the surface's YUV samples.
  *
  * Describes a surface by specifying metrics like width, height,
  * plane strides etc.
@@ -497,6 +575,25 @@ typedef struct _Imx2dSurface Imx2dSurface;
  * YUV formats typically have two of three planes. The number
  * of planes defines how many of the values in the @plane_stride
  * and @plane_offset arrays are used.
+ *
+ * Blits from surfaces with an alpha channel normally use alpha
+ * blending. If @is_opaque is set, backends skip the blending and
+ * perform a plain copy or scale blit instead, unless the blit's
+ * global alpha value is below 255. This is useful with sources
+ * like decoded video in BGRA, where the alpha values are always
+ * 255. If @is_opaque is set even though some pixels are not fully
+ * opaque, their alpha values are copied instead of blended.
+ * @is_opaque has no effect with formats that have no alpha channel.
+ *
+ * @color_matrix and @color_range describe how the samples of YUV
+ * formats relate to RGB. Backends use them when converting between
+ * YUV and RGB, either by selecting the corresponding conversion mode
+ * of the hardware or, in the software blitter, with corresponding
+ * coefficients. Not all backends support all combinations; those
+ * that don't fall back to the closest one they support. With RGB and
+ * grayscale formats, these fields are ignored. Both default to zero,
+ * which means BT.601 limited range, the conversion that was used
+ * before these fields existed.
  */
 struct _Imx2dSurfaceDesc
 {
@@ -504,6 +601,9 @@ struct _Imx2dSurfaceDesc
 	int plane_strides[3];
 	int num_padding_rows;
 	Imx2dPixelFormat format;
+	int is_opaque;
+	Imx2dColorMatrix color_matrix;
+	Imx2dColorRange color_range;
 };
 
 
@@ -623,6 +723,81 @@ int imx_2d_surface_get_dma_buffer_offset(Imx2dSurface *surface, int plane_nr);
 Imx2dRegion const * imx_2d_surface_get_region(Imx2dSurface *surface);
 
 
+#define IMX_2D_MAX_NUM_DAMAGE_REGIONS 16
+
+/**
+ * imx_2d_surface_set_damage_tracking:
+ * @surface: Surface to enable or disable damage tracking for.
+ * @enabled: Nonzero to enable damage tracking, zero to disable it.
+ *
+ * Enables or disables damage tracking for this surface. This is disabled
+ * by default. It is useful when the surface is used as the destination
+ * of blitter operations and its contents persist from one sequence to the
+ * next, like with a framebuffer or with recycled output buffers.
+ *
+ * If damage tracking is enabled, @imx_2d_blitter_do_blit,
+ * @imx_2d_blitter_do_planned_blit, @imx_2d_blitter_fill_region, and
+ * @imx_2d_blitter_fill_regions only write to the parts of the surface
+ * that are inside its damage regions (see @imx_2d_surface_add_damage_region).
+ * Pixels outside of these regions keep their previous contents. If there
+ * are no damage regions, these operations do nothing.
+ *
+ * Blits are clipped to each damage region separately. If a blit scales
+ * the source, the clipped parts may be off by one source pixel compared
+ * to a full blit, due to rounding.
+ */
+void imx_2d_surface_set_damage_tracking(Imx2dSurface *surface, int enabled);
+
+/**
+ * imx_2d_surface_get_damage_tracking:
+ * @surface: Surface to query.
+ *
+ * Returns: Nonzero if damage tracking is enabled for this surface.
+ */
+int imx_2d_surface_get_damage_tracking(Imx2dSurface *surface);
+
+/**
+ * imx_2d_surface_add_damage_region:
+ * @surface: Surface to add a damage region to.
+ * @region: Region to mark as damaged, or NULL to mark the entire surface.
+ *
+ * Marks a region of the surface as damaged, meaning that it needs to be
+ * redrawn. The region is clipped against the surface's region.
+ *
+ * The damage regions never overlap, since otherwise, blending blits would
+ * blend the overlapping pixels twice. If the new region overlaps existing
+ * ones, they are merged into their bounding box. If the maximum number of
+ * damage regions (IMX_2D_MAX_NUM_DAMAGE_REGIONS) is reached, the new region
+ * is merged with the existing region whose bounding box grows the least.
+ * The damage regions therefore may cover more than what was added.
+ *
+ * The damage regions are not modified by blitter operations. Remove
+ * them with @imx_2d_surface_clear_damage once they were redrawn.
+ */
+void imx_2d_surface_add_damage_region(Imx2dSurface *surface, Imx2dRegion const *region);
+
+/**
+ * imx_2d_surface_clear_damage:
+ * @surface: Surface to clear the damage regions of.
+ *
+ * Removes all damage regions from the surface.
+ */
+void imx_2d_surface_clear_damage(Imx2dSurface *surface);
+
+/**
+ * imx_2d_surface_get_damage_regions:
+ * @surface: Surface to get the damage regions of.
+ * @regions: Pointer to a const region pointer that will be set to
+ *     the surface's internal array of damage regions.
+ *
+ * Retrieves the damage regions of the surface. The array stays valid
+ * until the damage regions are modified.
+ *
+ * Returns: Number of damage regions.
+ */
+int imx_2d_surface_get_damage_regions(Imx2dSurface *surface, Imx2dRegion const **regions);
+
+
 
 
 /* Blitter */
@@ -632,6 +807,16 @@ typedef struct _Imx2dBlitMargin Imx2dBlitMargin;
 typedef struct _Imx2dBlitParams Imx2dBlitParams;
 
 
+/**
+ * IMX_2D_MAX_NUM_SCALING_PASSES:
+ *
+ * Maximum number of passes a blit that downscales by more
+ * than the hardware's max_downscale_factor is split into.
+ * See @imx_2d_blitter_do_blit for details.
+ */
+#define IMX_2D_MAX_NUM_SCALING_PASSES 4
+
+
 /**
  * Imx2dBlitter:
  *
@@ -648,6 +833,8 @@ typedef struct _Imx2dBlitParams Imx2dBlitParams;
  */
 typedef struct _Imx2dBlitter Imx2dBlitter;
 typedef struct _Imx2dBlitterClass Imx2dBlitterClass;
+typedef struct _Imx2dFence Imx2dFence;
+typedef struct _Imx2dBlitPlan Imx2dBlitPlan;
 
 
 /**
@@ -710,6 +897,24 @@ struct _Imx2dBlitParams
 };
 
 
+/**
+ * imx_2d_blit_margin_get_regions:
+ * @margin: Margin to get the regions of.
+ * @dest_region: Region the margin is placed around.
+ * @margin_regions: Array of at least 4 regions to write the margin regions to.
+ *
+ * Computes the rectangles that make up @margin when it is placed around
+ * @dest_region, in top, bottom, left, right order. The top and bottom
+ * rectangles span the entire width of the margin, the left and right
+ * ones only the height of @dest_region. Rectangles without pixels are
+ * omitted. This is useful for drawing the margin separately with
+ * @imx_2d_blitter_fill_regions.
+ *
+ * Returns: Number of regions written to @margin_regions (0 to 4).
+ */
+int imx_2d_blit_margin_get_regions(Imx2dBlitMargin const *margin, Imx2dRegion const *dest_region, Imx2dRegion *margin_regions);
+
+
 /**
  * imx_2d_blitter_destroy:
  * @blitter Blitter to destroy.
@@ -746,8 +951,13 @@ void imx_2d_blitter_destroy(Imx2dBlitter *blitter);
  *
  * - @imx_2d_blitter_start
  * - @imx_2d_blitter_finish
+ * - @imx_2d_blitter_finish_async
  * - @imx_2d_blitter_do_blit
+ * - @imx_2d_blitter_do_planned_blit
  * - @imx_2d_blitter_fill_region
+ * - @imx_2d_blitter_fill_regions
+ * - @imx_2d_blitter_begin_batch
+ * - @imx_2d_blitter_submit_batch
  *
  * This limitation is present in some underlying APIs such as G2D.
  *
@@ -774,6 +984,42 @@ int imx_2d_blitter_start(Imx2dBlitter *blitter, Imx2dSurface *dest);
  */
 int imx_2d_blitter_finish(Imx2dBlitter *blitter);
 
+/**
+ * imx_2d_blitter_finish_async:
+ * @blitter: Blitter to use.
+ * @fence: Pointer to an @Imx2dFence pointer that will be set to
+ *     the fence of the finished sequence. Must not be NULL.
+ *
+ * Non-blocking variant of @imx_2d_blitter_finish. The queued operations
+ * are flushed and the sequence is ended, but this function does not wait
+ * until the operations are done. Instead, it returns a fence in @fence
+ * that gets signaled once they are. Use @imx_2d_fence_poll and
+ * @imx_2d_fence_wait to check for and wait for the completion.
+ * Once the fence is no longer needed, unref it with @imx_2d_fence_unref.
+ *
+ * The DMA buffers of the destination surface and the source surfaces
+ * of the sequence must stay valid until the fence is signaled, and the
+ * pixels in the destination surface must not be accessed before that.
+ * The @Imx2dSurface objects themselves are resolved when the operations
+ * are queued, so they can be reconfigured for the next sequence right
+ * away (for example with @imx_2d_surface_set_dma_buffer). This allows
+ * for having several sequences in flight at the same time.
+ *
+ * A new sequence can be started right away. Its operations are
+ * executed after the ones from the previous sequence.
+ *
+ * Not all backends can finish asynchronously. With these, this
+ * function blocks like @imx_2d_blitter_finish, and the returned
+ * fence is already signaled.
+ *
+ * See @imx_2d_blitter_start for an important note about calling
+ * this from a particular thread.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure. In case
+ *     of failure, *fence is set to NULL.
+ */
+int imx_2d_blitter_finish_async(Imx2dBlitter *blitter, Imx2dFence **fence);
+
 /**
  * imx_2d_blitter_do_blit:
  * @blitter: Blitter to use.
@@ -812,6 +1058,23 @@ int imx_2d_blitter_finish(Imx2dBlitter *blitter);
  * In other words, the default parameters produce a simple blit
  * operation with scaling as-needed (as explained above).
  *
+ * If the blit downscales by more than the max_downscale_factor of the
+ * blitter's hardware capabilities, it is split into several passes.
+ * The first passes downscale the source region into intermediate
+ * surfaces, each by at most that factor, and the last pass blits the
+ * smallest intermediate surface to the destination surface with the
+ * original rotation, alpha, and margin. For example, with a factor of
+ * 4, a 3840x2160 source is blitted to a 160x90 region in three passes:
+ * 3840x2160 -> 960x540 -> 240x135 -> 160x90. The intermediate surfaces
+ * use the source's pixel format if the hardware can blit to it, and
+ * the destination's pixel format otherwise. Their DMA buffers are kept
+ * by the blitter and reused by subsequent multi-pass blits. Since each
+ * pass reads what the previous one wrote, the passes are finished one
+ * by one, so any operations queued in the current sequence before such
+ * a blit are finished by it as well. The sequence itself remains
+ * started, and the caller does not have to do anything differently.
+ * At most @IMX_2D_MAX_NUM_SCALING_PASSES passes are used.
+ *
  * See @imx_2d_blitter_start for an important note about calling
  * this from a particular thread.
  *
@@ -819,6 +1082,32 @@ int imx_2d_blitter_finish(Imx2dBlitter *blitter);
  */
 int imx_2d_blitter_do_blit(Imx2dBlitter *blitter, Imx2dSurface *source, Imx2dBlitParams const *params);
 
+/**
+ * imx_2d_blitter_do_planned_blit:
+ * @blitter: Blitter to use.
+ * @plan: Blit plan to execute.
+ *
+ * Blits pixels from the plan's source surface to the destination
+ * surface, using the params the plan was created with. The result
+ * is the same as that of an @imx_2d_blitter_do_blit call with these
+ * params, but the region checks and clipping are not redone. Some
+ * backends also reuse their precomputed hardware specific surface
+ * descriptors, and only fill in the current DMA buffer addresses.
+ *
+ * The destination surface passed to @imx_2d_blitter_start must be
+ * the one the plan was created with.
+ *
+ * If the description of the source or destination surface changed
+ * since the last call, the plan is rebuilt automatically. Changes
+ * in the DMA buffers of the surfaces do not require a rebuild.
+ *
+ * See @imx_2d_blitter_start for an important note about calling
+ * this from a particular thread.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_blitter_do_planned_blit(Imx2dBlitter *blitter, Imx2dBlitPlan *plan);
+
 /**
  * imx_2d_blitter_fill_region:
  * @blitter: Blitter to use.
@@ -843,6 +1132,71 @@ int imx_2d_blitter_do_blit(Imx2dBlitter *blitter, Imx2dSurface *source, Imx2dBli
  */
 int imx_2d_blitter_fill_region(Imx2dBlitter *blitter, Imx2dRegion const *dest_region, uint32_t fill_color);
 
+/**
+ * imx_2d_blitter_fill_regions:
+ * @blitter: Blitter to use.
+ * @dest_regions: Array of regions in the destination surface to fill.
+ * @num_dest_regions: Number of regions in the @dest_regions array.
+ * @fill_color: Color to use for filling.
+ *
+ * Fills all of the @dest_regions with the same color. The result is the
+ * same as calling @imx_2d_blitter_fill_region for each region, but the
+ * backend can set up its fill state once for all regions, which makes
+ * this much cheaper when filling several small regions, like the four
+ * sides of a letterbox. Regions are clipped like in
+ * @imx_2d_blitter_fill_region, and regions that are fully outside of the
+ * destination surface are skipped. The @fill_color format is the same as
+ * in @imx_2d_blitter_fill_region.
+ *
+ * See @imx_2d_blitter_start for an important note about calling
+ * this from a particular thread.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_blitter_fill_regions(Imx2dBlitter *blitter, Imx2dRegion const *dest_regions, int num_dest_regions, uint32_t fill_color);
+
+/**
+ * imx_2d_blitter_begin_batch:
+ * @blitter: Blitter to use.
+ *
+ * Begins recording a batch of blitter operations.
+ *
+ * After this call, @imx_2d_blitter_do_blit and @imx_2d_blitter_fill_region
+ * do not pass their operations to the backend right away. Instead, they
+ * perform their usual checks and region clipping and then append the
+ * operation to the batch. @imx_2d_blitter_submit_batch then hands all
+ * recorded operations to the backend in one go. This allows backends
+ * to set up shared state only once per batch, and backends that can
+ * blit multiple sources in one hardware job (like G2D's multiblit)
+ * can combine operations.
+ *
+ * Regions and parameters are copied when an operation is recorded, so
+ * they do not have to exist until the batch is submitted. The source
+ * surfaces however must exist until the sequence is finished, just
+ * like with unbatched blits.
+ *
+ * Batches can only be recorded in between @imx_2d_blitter_start and
+ * @imx_2d_blitter_finish calls. If a batch is still being recorded
+ * when @imx_2d_blitter_finish is called, it is submitted first.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_blitter_begin_batch(Imx2dBlitter *blitter);
+
+/**
+ * imx_2d_blitter_submit_batch:
+ * @blitter: Blitter to use.
+ *
+ * Submits all operations that were recorded since the last
+ * @imx_2d_blitter_begin_batch call to the backend and ends
+ * the batch. The operations are executed in the order they
+ * were recorded. Like with unbatched operations, they may run
+ * asynchronously until @imx_2d_blitter_finish is called.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_blitter_submit_batch(Imx2dBlitter *blitter);
+
 /**
  * imx_2d_blitter_get_hardware_capabilities:
  * @blitter: Blitter to get hardware capabilities from.
@@ -865,6 +1219,285 @@ int imx_2d_blitter_fill_region(Imx2dBlitter *blitter, Imx2dRegion const *dest_re
  */
 Imx2dHardwareCapabilities const * imx_2d_blitter_get_hardware_capabilities(Imx2dBlitter *blitter);
 
+/**
+ * imx_2d_blitter_get_backend_name:
+ * @blitter: Blitter to get the backend name of.
+ *
+ * Returns: Short name of the blitter's backend, like "g2d" or "sw".
+ */
+char const * imx_2d_blitter_get_backend_name(Imx2dBlitter *blitter);
+
+
+
+
+/* Statistics */
+
+
+/**
+ * Imx2dOpType:
+ * @IMX_2D_OP_TYPE_BLIT: @imx_2d_blitter_do_blit or @imx_2d_blitter_do_planned_blit call.
+ * @IMX_2D_OP_TYPE_FILL_REGION: @imx_2d_blitter_fill_region or @imx_2d_blitter_fill_regions
+ *     call. The latter is reported once per region, or, if the backend fills
+ *     all regions at once, once for all regions.
+ * @IMX_2D_OP_TYPE_BATCH: Submission of a batch that the backend executes as a whole.
+ *     Batches that the backend cannot execute as a whole are instead reported
+ *     as individual blits and fills.
+ * @IMX_2D_OP_TYPE_FINISH: @imx_2d_blitter_finish or @imx_2d_blitter_finish_async call.
+ *
+ * Types of operations that statistics are recorded for.
+ */
+typedef enum
+{
+	IMX_2D_OP_TYPE_BLIT = 0,
+	IMX_2D_OP_TYPE_FILL_REGION,
+	IMX_2D_OP_TYPE_BATCH,
+	IMX_2D_OP_TYPE_FINISH,
+
+	IMX_2D_NUM_OP_TYPES
+}
+Imx2dOpType;
+
+
+/**
+ * imx_2d_op_type_to_string:
+ * @op_type: Operation type to return a string for.
+ *
+ * Returns: Short string representation of @op_type, like "blit".
+ */
+char const * imx_2d_op_type_to_string(Imx2dOpType op_type);
+
+
+typedef struct _Imx2dOpStats Imx2dOpStats;
+typedef struct _Imx2dBlitterStats Imx2dBlitterStats;
+
+
+/**
+ * Imx2dOpStats:
+ * @op_type: Type of the operation.
+ * @backend_name: Name of the backend that executed the operation.
+ * @num_ops: Number of blits and fills covered by this operation. This is 1
+ *     for blits and fills, the number of regions for fills of several regions
+ *     at once, the number of operations in the batch for batches,
+ *     and 0 for finish operations.
+ * @num_pixels: Number of destination pixels written by the operation,
+ *     including margins. 0 for finish operations.
+ * @num_bytes: Approximate number of bytes the operation read and wrote.
+ *     0 for finish operations.
+ * @submit_time: Monotonic timestamp of when the operation was passed
+ *     to the backend, in nanoseconds.
+ * @completion_time: Monotonic timestamp of when the backend was done
+ *     with the operation, in nanoseconds. For blits, fills, and batches,
+ *     this is when the backend call returned. Hardware backends may
+ *     continue to process the operation until the sequence is finished,
+ *     so this time is then spent in the finish operation. For
+ *     @imx_2d_blitter_finish_async, this is when the fence was signaled.
+ *
+ * Statistics of one operation.
+ *
+ * The timestamps use the same clock as clock_gettime() with CLOCK_MONOTONIC.
+ */
+struct _Imx2dOpStats
+{
+	Imx2dOpType op_type;
+	char const *backend_name;
+	int num_ops;
+	int64_t num_pixels;
+	int64_t num_bytes;
+	int64_t submit_time;
+	int64_t completion_time;
+};
+
+
+/**
+ * Imx2dBlitterStats:
+ * @num_ops: Number of operations of each type.
+ * @num_pixels: Sum of the num_pixels values of the operations of each type.
+ * @num_bytes: Sum of the num_bytes values of the operations of each type.
+ * @total_duration: Sum of the durations (completion time minus submit
+ *     time) of the operations of each type, in nanoseconds.
+ * @max_duration: Longest duration of an operation of each type, in nanoseconds.
+ *
+ * Accumulated statistics. The arrays are indexed by @Imx2dOpType.
+ */
+struct _Imx2dBlitterStats
+{
+	int64_t num_ops[IMX_2D_NUM_OP_TYPES];
+	int64_t num_pixels[IMX_2D_NUM_OP_TYPES];
+	int64_t num_bytes[IMX_2D_NUM_OP_TYPES];
+	int64_t total_duration[IMX_2D_NUM_OP_TYPES];
+	int64_t max_duration[IMX_2D_NUM_OP_TYPES];
+};
+
+
+/**
+ * Imx2dStatsFunc:
+ * @op_stats: Statistics of the operation.
+ * @user_data: Optional user-defined pointer passed to @imx_2d_blitter_set_stats_func.
+ *
+ * Function that is called once per operation with its statistics.
+ * It is called from the thread that uses the blitter.
+ */
+typedef void (*Imx2dStatsFunc)(Imx2dOpStats const *op_stats, void *user_data);
+
+
+/**
+ * imx_2d_blitter_set_stats_func:
+ * @blitter: Blitter to set the statistics function of.
+ * @stats_func: Function to call for each operation, or NULL to not call any.
+ * @user_data: Optional user-defined pointer to pass to @stats_func.
+ *
+ * Sets the function that gets the statistics of each operation
+ * the blitter performs.
+ *
+ * Since @imx_2d_blitter_finish_async does not wait for the operations to
+ * be done, its statistics are reported later, during the first
+ * @imx_2d_blitter_start, @imx_2d_blitter_finish_async, or
+ * @imx_2d_blitter_destroy call after its fence was signaled. If the
+ * fence is still not signaled when the blitter is destroyed, its
+ * statistics are not reported.
+ */
+void imx_2d_blitter_set_stats_func(Imx2dBlitter *blitter, Imx2dStatsFunc stats_func, void *user_data);
+
+/**
+ * imx_2d_blitter_get_stats:
+ * @blitter: Blitter to get the statistics of.
+ * @stats: Structure to copy the statistics to.
+ *
+ * Copies the statistics the blitter accumulated since it was
+ * created or since @imx_2d_blitter_reset_stats was last called.
+ * This must not be called while another thread uses the blitter.
+ * To access statistics from other threads, accumulate them with
+ * a function set by @imx_2d_blitter_set_stats_func instead.
+ */
+void imx_2d_blitter_get_stats(Imx2dBlitter *blitter, Imx2dBlitterStats *stats);
+
+/**
+ * imx_2d_blitter_reset_stats:
+ * @blitter: Blitter to reset the statistics of.
+ *
+ * Resets the statistics the blitter accumulated to zero.
+ */
+void imx_2d_blitter_reset_stats(Imx2dBlitter *blitter);
+
+/**
+ * imx_2d_blitter_stats_add:
+ * @stats: Statistics to add the operation to.
+ * @op_stats: Statistics of the operation to add.
+ *
+ * Adds the statistics of one operation to accumulated statistics.
+ * Useful in functions set by @imx_2d_blitter_set_stats_func.
+ */
+void imx_2d_blitter_stats_add(Imx2dBlitterStats *stats, Imx2dOpStats const *op_stats);
+
+
+
+
+/**
+ * Imx2dBlitPlan:
+ *
+ * Precomputed blit operation, meant for blits whose regions and
+ * surface descriptions stay the same across many frames, which is
+ * the typical case in video playback.
+ *
+ * @imx_2d_blitter_do_blit checks and clips the regions for each call,
+ * and backends fill in their hardware specific surface descriptors
+ * for each call as well. A plan performs these computations once.
+ * Afterwards, @imx_2d_blitter_do_planned_blit only needs the current
+ * DMA buffers of the surfaces.
+ */
+
+/**
+ * imx_2d_blit_plan_create:
+ * @blitter: Blitter the plan is created for.
+ * @source: Surface to blit pixels from.
+ * @dest: Surface to blit pixels to.
+ * @params: Optional blitter parameters. NULL sets default ones.
+ *
+ * Creates a new blit plan for blitting from @source to @dest with
+ * the given params. The params (including the regions and the margin
+ * they point to) are copied. See @imx_2d_blitter_do_blit for details
+ * about the params.
+ *
+ * The actual computations happen when the plan is used for the first
+ * time, so the surfaces do not need to have a description yet.
+ *
+ * The plan can only be used with @blitter, and must be destroyed
+ * before @blitter, @source, and @dest are.
+ *
+ * Returns: Pointer to the newly created plan, or NULL in case of failure.
+ */
+Imx2dBlitPlan* imx_2d_blit_plan_create(Imx2dBlitter *blitter, Imx2dSurface *source, Imx2dSurface *dest, Imx2dBlitParams const *params);
+
+/**
+ * imx_2d_blit_plan_destroy:
+ * @plan: Plan to destroy.
+ *
+ * Destroys the given plan. The plan pointer is invalid
+ * after this call and must not be used anymore.
+ */
+void imx_2d_blit_plan_destroy(Imx2dBlitPlan *plan);
+
+/**
+ * imx_2d_blit_plan_matches:
+ * @plan: Plan to check.
+ * @source: Surface to blit pixels from.
+ * @dest: Surface to blit pixels to.
+ * @params: Optional blitter parameters. NULL means default ones.
+ *
+ * Checks if @plan was created with the given surfaces and params.
+ * Regions and margins are compared by value. This is useful for
+ * deciding whether or not an existing plan must be replaced.
+ *
+ * Returns: Nonzero if the plan matches, zero otherwise.
+ */
+int imx_2d_blit_plan_matches(Imx2dBlitPlan const *plan, Imx2dSurface *source, Imx2dSurface *dest, Imx2dBlitParams const *params);
+
+
+
+
+/**
+ * imx_2d_fence_ref:
+ * @fence: Fence to ref.
+ *
+ * Increases the reference count of @fence by one.
+ *
+ * Returns: @fence.
+ */
+Imx2dFence* imx_2d_fence_ref(Imx2dFence *fence);
+
+/**
+ * imx_2d_fence_unref:
+ * @fence: Fence to unref.
+ *
+ * Decreases the reference count of @fence by one. If it reaches
+ * zero, @fence is destroyed. Unref'ing a fence that is not yet
+ * signaled does not cancel the operations it is associated with.
+ */
+void imx_2d_fence_unref(Imx2dFence *fence);
+
+/**
+ * imx_2d_fence_poll:
+ * @fence: Fence to check.
+ *
+ * Checks if @fence is signaled, that is, if the operations
+ * associated with it are done. This function does not block.
+ *
+ * Returns: Nonzero if the fence is signaled, zero otherwise.
+ */
+int imx_2d_fence_poll(Imx2dFence *fence);
+
+/**
+ * imx_2d_fence_wait:
+ * @fence: Fence to wait for.
+ *
+ * Blocks until @fence is signaled. If it already is, this
+ * function returns immediately. Any thread may wait for a fence.
+ *
+ * Returns: Nonzero if the operations associated with @fence
+ *     succeeded, zero if they failed.
+ */
+int imx_2d_fence_wait(Imx2dFence *fence);
+
 
 #ifdef __cplusplus
 }
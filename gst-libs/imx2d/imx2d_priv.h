@@ -1,6 +1,7 @@
 #ifndef IMX2D_PRIV_H
 #define IMX2D_PRIV_H
 
+#include <pthread.h>
 #include "imx2d.h"
 
 
@@ -58,6 +59,39 @@ extern Imx2dLoggingFunc imx_2d_cur_logging_fn;
 typedef struct _Imx2dSurfaceClass Imx2dSurfaceClass;
 typedef struct _Imx2dInternalBlitParams Imx2dInternalBlitParams;
 typedef struct _Imx2dInternalFillRegionParams Imx2dInternalFillRegionParams;
+typedef struct _Imx2dInternalFillRegionsParams Imx2dInternalFillRegionsParams;
+typedef struct _Imx2dInternalBatchOp Imx2dInternalBatchOp;
+
+
+struct _Imx2dFence
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int refcount;
+	BOOL signaled;
+	int result;
+	/* Monotonic timestamp of when the fence was signaled,
+	 * in nanoseconds. Used for statistics. */
+	int64_t signal_time;
+};
+
+
+/* Returns the current time of the CLOCK_MONOTONIC clock, in nanoseconds. */
+int64_t imx_2d_get_monotonic_time(void);
+
+
+/* Creates a new, unsignaled fence with a reference count of 1. */
+Imx2dFence* imx_2d_fence_new(void);
+
+/* Marks the fence as signaled and wakes up all waiting threads.
+ * result is what imx_2d_fence_wait() shall return. */
+void imx_2d_fence_signal(Imx2dFence *fence, int result);
+
+
+/* Maximum number of imx_2d_blitter_finish_async() fences whose
+ * statistics can be pending at the same time. If more are pending,
+ * the statistics of the oldest one are discarded. */
+#define IMX_2D_MAX_NUM_PENDING_STATS_FENCES 8
 
 
 struct _Imx2dSurface
@@ -66,6 +100,12 @@ struct _Imx2dSurface
 	Imx2dRegion region;
 	ImxDmaBuffer *dma_buffers[3];
 	int dma_buffer_offsets[3];
+
+	/* Damage regions. These never overlap each other,
+	 * and are always inside the surface region. */
+	BOOL damage_tracking;
+	Imx2dRegion damage_regions[IMX_2D_MAX_NUM_DAMAGE_REGIONS];
+	int num_damage_regions;
 };
 
 
@@ -73,6 +113,36 @@ struct _Imx2dBlitter
 {
 	Imx2dBlitterClass *blitter_class;
 	Imx2dSurface *dest;
+
+	/* Batch recording states. Backends zero-initialize
+	 * these when they allocate their blitter structure.
+	 * batch_ops is freed by imx_2d_blitter_destroy(). */
+	BOOL batch_active;
+	Imx2dInternalBatchOp *batch_ops;
+	int num_batch_ops;
+	int max_num_batch_ops;
+
+	/* Statistics states. Like the batch states, these are
+	 * zero-initialized by the backends. Fences passed to
+	 * imx_2d_blitter_finish_async() are kept here until they
+	 * are signaled, since their statistics are only complete
+	 * at that point. The fences are unref'd by
+	 * imx_2d_blitter_destroy(). */
+	Imx2dStatsFunc stats_func;
+	void *stats_user_data;
+	Imx2dBlitterStats stats;
+	Imx2dFence *pending_stats_fences[IMX_2D_MAX_NUM_PENDING_STATS_FENCES];
+	Imx2dOpStats pending_stats_fence_ops[IMX_2D_MAX_NUM_PENDING_STATS_FENCES];
+	int num_pending_stats_fences;
+
+	/* Multi-pass downscaling states. Also zero-initialized by
+	 * the backends. The intermediate surfaces and their DMA
+	 * buffers are reused by subsequent multi-pass blits. The
+	 * allocator is created when it is first needed. All of
+	 * these are freed by imx_2d_blitter_destroy(). */
+	ImxDmaBufferAllocator *intermediate_allocator;
+	Imx2dSurface intermediate_surfaces[IMX_2D_MAX_NUM_SCALING_PASSES - 1];
+	ImxDmaBuffer *intermediate_dma_buffers[IMX_2D_MAX_NUM_SCALING_PASSES - 1];
 };
 
 
@@ -101,6 +171,84 @@ struct _Imx2dInternalFillRegionParams
 };
 
 
+/* Maximum number of regions passed to the fill_regions vfunc
+ * in one call. Longer lists are split into several calls. */
+#define IMX_2D_MAX_NUM_FILL_REGIONS_PER_CALL 16
+
+/* The dest_regions are already clipped against the dest
+ * surface (and its damage regions), and are never empty.
+ * num_dest_regions is at least 1. Fills are opaque, so
+ * the regions may overlap. */
+struct _Imx2dInternalFillRegionsParams
+{
+	Imx2dRegion const *dest_regions;
+	int num_dest_regions;
+	uint32_t fill_color;
+};
+
+
+typedef enum
+{
+	/* Nothing to do, for example because the dest region lies
+	 * outside of the dest surface. Never recorded in batches. */
+	IMX_2D_INTERNAL_BATCH_OP_TYPE_NONE,
+	IMX_2D_INTERNAL_BATCH_OP_TYPE_BLIT,
+	IMX_2D_INTERNAL_BATCH_OP_TYPE_FILL_REGION
+}
+Imx2dInternalBatchOpType;
+
+
+/* A recorded blit or fill region operation. The operations are
+ * recorded after imx_2d_blitter_do_blit() and
+ * imx_2d_blitter_fill_region() finished their region checks and
+ * clipping, so they can be passed to the backend unchanged.
+ * The region pointers in blit_params / fill_region_params
+ * point to the region copies in this structure. */
+struct _Imx2dInternalBatchOp
+{
+	Imx2dInternalBatchOpType type;
+
+	Imx2dInternalBlitParams blit_params;
+	Imx2dInternalFillRegionParams fill_region_params;
+
+	Imx2dRegion source_region;
+	Imx2dRegion dest_region;
+	Imx2dRegion expanded_dest_region;
+
+	/* Backend plan data if this blit comes from a blit plan
+	 * (see imx_2d_blitter_do_planned_blit()), NULL otherwise.
+	 * Backends pass it to their do_planned_blit code. */
+	void *plan_data;
+};
+
+
+struct _Imx2dBlitPlan
+{
+	Imx2dBlitter *blitter;
+	Imx2dSurface *source;
+	Imx2dSurface *dest;
+
+	/* Copy of the params the plan was created with. The region
+	 * and margin pointers in params refer to the copies below. */
+	Imx2dBlitParams params;
+	Imx2dRegion source_region;
+	Imx2dRegion dest_region;
+	Imx2dBlitMargin margin;
+
+	/* The operation computed out of the params and the source and
+	 * dest surface descriptions. If these descriptions no longer
+	 * match source_desc and dest_desc, the plan is rebuilt.
+	 * op.plan_data is set to backend_plan_data. */
+	BOOL built;
+	Imx2dSurfaceDesc source_desc;
+	Imx2dSurfaceDesc dest_desc;
+	Imx2dInternalBatchOp op;
+
+	/* Created by the backend's create_plan_data vfunc. */
+	void *backend_plan_data;
+};
+
+
 struct _Imx2dBlitterClass
 {
 	void (*destroy)(Imx2dBlitter *blitter);
@@ -112,6 +260,41 @@ struct _Imx2dBlitterClass
 	int (*fill_region)(Imx2dBlitter *blitter, Imx2dInternalFillRegionParams *internal_fill_region_params);
 
 	Imx2dHardwareCapabilities const * (*get_hardware_capabilities)(Imx2dBlitter *blitter);
+
+	/* Optional. Executes all recorded operations in the given order.
+	 * Backends that can combine operations (for example, by blitting
+	 * several sources in one hardware job) implement this. If this is
+	 * NULL, the operations are replayed with do_blit / fill_region. */
+	int (*submit_batch)(Imx2dBlitter *blitter, Imx2dInternalBatchOp *ops, int num_ops);
+
+	/* Optional. Like finish, but does not wait for the operations
+	 * to be done. Instead, the backend refs the fence and signals
+	 * it (then unrefs it) once they are done. If this returns zero,
+	 * the fence must not be signaled by the backend. If this is NULL,
+	 * finish is called instead, and the fence is signaled right away. */
+	int (*finish_async)(Imx2dBlitter *blitter, Imx2dFence *fence);
+
+	/* Optional. These let backends precompute their native descriptors
+	 * for a planned blit (see imx_2d_blit_plan_create()). create_plan_data
+	 * computes everything that does not depend on the DMA buffers of
+	 * the surfaces; it may return NULL if it cannot precompute anything
+	 * for these params, in which case do_blit is used. do_planned_blit
+	 * then only has to fill in the DMA buffer addresses. The params
+	 * passed to do_planned_blit are the ones create_plan_data got, and
+	 * blitter->dest is the same surface that create_plan_data got. */
+	void* (*create_plan_data)(Imx2dBlitter *blitter, Imx2dSurface *dest, Imx2dInternalBlitParams const *internal_blit_params);
+	void (*destroy_plan_data)(Imx2dBlitter *blitter, void *plan_data);
+	int (*do_planned_blit)(Imx2dBlitter *blitter, Imx2dInternalBlitParams *internal_blit_params, void *plan_data);
+
+	/* Optional. Fills several regions with the same color. Backends
+	 * implement this if they can set up the fill state once for all
+	 * regions. If this is NULL, fill_region is called for each region.
+	 * This is also used for consecutive fill operations with the same
+	 * color in batches if submit_batch is NULL. */
+	int (*fill_regions)(Imx2dBlitter *blitter, Imx2dInternalFillRegionsParams *internal_fill_regions_params);
+
+	/* Short name of the backend, like "g2d". Used for statistics. */
+	char const *name;
 };
 
 
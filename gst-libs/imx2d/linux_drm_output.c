@@ -0,0 +1,830 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+#include <drm_fourcc.h>
+#include <imxdmabuffer/imxdmabuffer_config.h>
+#ifdef IMXDMABUFFER_DMA_HEAP_ALLOCATOR_ENABLED
+#include <imxdmabuffer/imxdmabuffer_dma_heap_allocator.h>
+#endif
+#include "imx2d.h"
+#include "imx2d_priv.h"
+#include "linux_drm_output.h"
+
+
+typedef struct
+{
+	uint32_t id;
+
+	uint32_t prop_fb_id;
+	uint32_t prop_crtc_id;
+	uint32_t prop_src_x, prop_src_y, prop_src_w, prop_src_h;
+	uint32_t prop_crtc_x, prop_crtc_y, prop_crtc_w, prop_crtc_h;
+}
+Imx2dLinuxDrmPlane;
+
+
+typedef struct
+{
+	/* This must be the first field, since the
+	 * map function casts the wrapped DMA buffer
+	 * back to an Imx2dLinuxDrmPage. */
+	ImxWrappedDmaBuffer dma_buffer;
+
+	uint32_t gem_handle;
+	uint32_t framebuffer_id;
+	uint8_t *virtual_address;
+	size_t size;
+}
+Imx2dLinuxDrmPage;
+
+
+struct _Imx2dLinuxDrmOutput
+{
+	int fd;
+
+	uint32_t connector_id;
+	uint32_t connector_prop_crtc_id;
+
+	uint32_t crtc_id;
+	uint32_t crtc_prop_mode_id;
+	uint32_t crtc_prop_active;
+
+	drmModeModeInfo mode;
+	uint32_t mode_blob_id;
+
+	Imx2dLinuxDrmPlane primary_plane;
+	/* The id of overlay_plane is 0 if the
+	 * CRTC has no usable overlay plane. */
+	Imx2dLinuxDrmPlane overlay_plane;
+
+	Imx2dLinuxDrmPage pages[IMX_2D_LINUX_DRM_OUTPUT_NUM_PAGES];
+	Imx2dSurface *surface;
+
+	int current_page;
+};
+
+
+static uint32_t imx_2d_linux_drm_output_get_drm_format(Imx2dPixelFormat format);
+static uint32_t imx_2d_linux_drm_output_find_property(int fd, uint32_t object_id, uint32_t object_type, char const *name, uint64_t *value);
+static BOOL imx_2d_linux_drm_output_init_plane(Imx2dLinuxDrmOutput *drm_output, Imx2dLinuxDrmPlane *plane, uint32_t plane_id);
+static void imx_2d_linux_drm_output_add_plane_properties(Imx2dLinuxDrmOutput *drm_output, drmModeAtomicReq *request, Imx2dLinuxDrmPlane const *plane, uint32_t framebuffer_id, Imx2dRegion const *source_region, Imx2dRegion const *dest_region);
+static BOOL imx_2d_linux_drm_output_create_page(Imx2dLinuxDrmOutput *drm_output, Imx2dLinuxDrmPage *page, Imx2dSurfaceDesc *desc);
+static void imx_2d_linux_drm_output_destroy_page(Imx2dLinuxDrmOutput *drm_output, Imx2dLinuxDrmPage *page);
+static uint8_t* imx_2d_linux_drm_output_page_map(ImxWrappedDmaBuffer *wrapped_dma_buffer, unsigned int flags, int *error);
+static void imx_2d_linux_drm_output_page_unmap(ImxWrappedDmaBuffer *wrapped_dma_buffer);
+
+
+static uint32_t imx_2d_linux_drm_output_get_drm_format(Imx2dPixelFormat format)
+{
+	/* imx2d formats specify the order of the bytes in memory,
+	 * while DRM formats specify the order of the bits in a
+	 * little endian word. For this reason, the RGB component
+	 * order of the two appears reversed. */
+	switch (format)
+	{
+		case IMX_2D_PIXEL_FORMAT_RGB565: return DRM_FORMAT_RGB565;
+		case IMX_2D_PIXEL_FORMAT_BGR565: return DRM_FORMAT_BGR565;
+		case IMX_2D_PIXEL_FORMAT_RGB888: return DRM_FORMAT_BGR888;
+		case IMX_2D_PIXEL_FORMAT_BGR888: return DRM_FORMAT_RGB888;
+		case IMX_2D_PIXEL_FORMAT_RGBX8888: return DRM_FORMAT_XBGR8888;
+		case IMX_2D_PIXEL_FORMAT_RGBA8888: return DRM_FORMAT_ABGR8888;
+		case IMX_2D_PIXEL_FORMAT_BGRX8888: return DRM_FORMAT_XRGB8888;
+		case IMX_2D_PIXEL_FORMAT_BGRA8888: return DRM_FORMAT_ARGB8888;
+		case IMX_2D_PIXEL_FORMAT_XRGB8888: return DRM_FORMAT_BGRX8888;
+		case IMX_2D_PIXEL_FORMAT_ARGB8888: return DRM_FORMAT_BGRA8888;
+		case IMX_2D_PIXEL_FORMAT_XBGR8888: return DRM_FORMAT_RGBX8888;
+		case IMX_2D_PIXEL_FORMAT_ABGR8888: return DRM_FORMAT_RGBA8888;
+		case IMX_2D_PIXEL_FORMAT_GRAY8: return DRM_FORMAT_R8;
+		case IMX_2D_PIXEL_FORMAT_PACKED_YUV422_UYVY: return DRM_FORMAT_UYVY;
+		case IMX_2D_PIXEL_FORMAT_PACKED_YUV422_YUYV: return DRM_FORMAT_YUYV;
+		case IMX_2D_PIXEL_FORMAT_PACKED_YUV422_YVYU: return DRM_FORMAT_YVYU;
+		case IMX_2D_PIXEL_FORMAT_PACKED_YUV422_VYUY: return DRM_FORMAT_VYUY;
+		case IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV12: return DRM_FORMAT_NV12;
+		case IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV21: return DRM_FORMAT_NV21;
+		case IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV16: return DRM_FORMAT_NV16;
+		case IMX_2D_PIXEL_FORMAT_SEMI_PLANAR_NV61: return DRM_FORMAT_NV61;
+		case IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_YV12: return DRM_FORMAT_YVU420;
+		case IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_I420: return DRM_FORMAT_YUV420;
+		case IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_Y42B: return DRM_FORMAT_YUV422;
+		case IMX_2D_PIXEL_FORMAT_FULLY_PLANAR_Y444: return DRM_FORMAT_YUV444;
+		default: return 0;
+	}
+}
+
+
+static uint32_t imx_2d_linux_drm_output_find_property(int fd, uint32_t object_id, uint32_t object_type, char const *name, uint64_t *value)
+{
+	drmModeObjectProperties *properties;
+	uint32_t i;
+	uint32_t property_id = 0;
+
+	properties = drmModeObjectGetProperties(fd, object_id, object_type);
+	if (properties == NULL)
+		return 0;
+
+	for (i = 0; (i < properties->count_props) && (property_id == 0); ++i)
+	{
+		drmModePropertyRes *property = drmModeGetProperty(fd, properties->props[i]);
+		if (property == NULL)
+			continue;
+
+		if (strcmp(property->name, name) == 0)
+		{
+			property_id = property->prop_id;
+			if (value != NULL)
+				*value = properties->prop_values[i];
+		}
+
+		drmModeFreeProperty(property);
+	}
+
+	drmModeFreeObjectProperties(properties);
+
+	return property_id;
+}
+
+
+static BOOL imx_2d_linux_drm_output_init_plane(Imx2dLinuxDrmOutput *drm_output, Imx2dLinuxDrmPlane *plane, uint32_t plane_id)
+{
+	int fd = drm_output->fd;
+
+	plane->id = plane_id;
+
+	plane->prop_fb_id   = imx_2d_linux_drm_output_find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "FB_ID", NULL);
+	plane->prop_crtc_id = imx_2d_linux_drm_output_find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_ID", NULL);
+	plane->prop_src_x   = imx_2d_linux_drm_output_find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_X", NULL);
+	plane->prop_src_y   = imx_2d_linux_drm_output_find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_Y", NULL);
+	plane->prop_src_w   = imx_2d_linux_drm_output_find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_W", NULL);
+	plane->prop_src_h   = imx_2d_linux_drm_output_find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_H", NULL);
+	plane->prop_crtc_x  = imx_2d_linux_drm_output_find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_X", NULL);
+	plane->prop_crtc_y  = imx_2d_linux_drm_output_find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_Y", NULL);
+	plane->prop_crtc_w  = imx_2d_linux_drm_output_find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_W", NULL);
+	plane->prop_crtc_h  = imx_2d_linux_drm_output_find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_H", NULL);
+
+	if ((plane->prop_fb_id == 0) || (plane->prop_crtc_id == 0)
+	 || (plane->prop_src_x == 0) || (plane->prop_src_y == 0) || (plane->prop_src_w == 0) || (plane->prop_src_h == 0)
+	 || (plane->prop_crtc_x == 0) || (plane->prop_crtc_y == 0) || (plane->prop_crtc_w == 0) || (plane->prop_crtc_h == 0))
+	{
+		IMX_2D_LOG(ERROR, "plane %" PRIu32 " lacks one or more of the standard plane properties", plane_id);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+static void imx_2d_linux_drm_output_add_plane_properties(Imx2dLinuxDrmOutput *drm_output, drmModeAtomicReq *request, Imx2dLinuxDrmPlane const *plane, uint32_t framebuffer_id, Imx2dRegion const *source_region, Imx2dRegion const *dest_region)
+{
+	if (framebuffer_id == 0)
+	{
+		drmModeAtomicAddProperty(request, plane->id, plane->prop_fb_id, 0);
+		drmModeAtomicAddProperty(request, plane->id, plane->prop_crtc_id, 0);
+		return;
+	}
+
+	drmModeAtomicAddProperty(request, plane->id, plane->prop_fb_id, framebuffer_id);
+	drmModeAtomicAddProperty(request, plane->id, plane->prop_crtc_id, drm_output->crtc_id);
+
+	/* Source coordinates are in 16.16 fixed point format. */
+	drmModeAtomicAddProperty(request, plane->id, plane->prop_src_x, ((uint64_t)(source_region->x1)) << 16);
+	drmModeAtomicAddProperty(request, plane->id, plane->prop_src_y, ((uint64_t)(source_region->y1)) << 16);
+	drmModeAtomicAddProperty(request, plane->id, plane->prop_src_w, ((uint64_t)(source_region->x2 - source_region->x1)) << 16);
+	drmModeAtomicAddProperty(request, plane->id, plane->prop_src_h, ((uint64_t)(source_region->y2 - source_region->y1)) << 16);
+
+	/* CRTC_X and CRTC_Y are signed. */
+	drmModeAtomicAddProperty(request, plane->id, plane->prop_crtc_x, (uint64_t)(int64_t)(dest_region->x1));
+	drmModeAtomicAddProperty(request, plane->id, plane->prop_crtc_y, (uint64_t)(int64_t)(dest_region->y1));
+	drmModeAtomicAddProperty(request, plane->id, plane->prop_crtc_w, dest_region->x2 - dest_region->x1);
+	drmModeAtomicAddProperty(request, plane->id, plane->prop_crtc_h, dest_region->y2 - dest_region->y1);
+}
+
+
+static BOOL imx_2d_linux_drm_output_create_page(Imx2dLinuxDrmOutput *drm_output, Imx2dLinuxDrmPage *page, Imx2dSurfaceDesc *desc)
+{
+	struct drm_mode_create_dumb create_dumb;
+	struct drm_mode_map_dumb map_dumb;
+	uint32_t handles[4] = { 0, 0, 0, 0 };
+	uint32_t pitches[4] = { 0, 0, 0, 0 };
+	uint32_t offsets[4] = { 0, 0, 0, 0 };
+	int dmabuf_fd = -1;
+
+	memset(&create_dumb, 0, sizeof(create_dumb));
+	create_dumb.width = drm_output->mode.hdisplay;
+	create_dumb.height = drm_output->mode.vdisplay;
+	create_dumb.bpp = 32;
+
+	if (drmIoctl(drm_output->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create_dumb) == -1)
+	{
+		IMX_2D_LOG(ERROR, "could not create dumb buffer: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	page->gem_handle = create_dumb.handle;
+	page->size = create_dumb.size;
+
+	handles[0] = create_dumb.handle;
+	pitches[0] = create_dumb.pitch;
+
+	/* XRGB8888 corresponds to the imx2d BGRX8888 format. */
+	if (drmModeAddFB2(drm_output->fd, create_dumb.width, create_dumb.height, DRM_FORMAT_XRGB8888, handles, pitches, offsets, &(page->framebuffer_id), 0) != 0)
+	{
+		IMX_2D_LOG(ERROR, "could not create framebuffer for dumb buffer: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	memset(&map_dumb, 0, sizeof(map_dumb));
+	map_dumb.handle = create_dumb.handle;
+
+	if (drmIoctl(drm_output->fd, DRM_IOCTL_MODE_MAP_DUMB, &map_dumb) == -1)
+	{
+		IMX_2D_LOG(ERROR, "could not prepare dumb buffer for mapping: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	page->virtual_address = mmap(NULL, page->size, PROT_READ | PROT_WRITE, MAP_SHARED, drm_output->fd, map_dumb.offset);
+	if (page->virtual_address == MAP_FAILED)
+	{
+		page->virtual_address = NULL;
+		IMX_2D_LOG(ERROR, "could not map dumb buffer: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	/* Start with black pixels. */
+	memset(page->virtual_address, 0, page->size);
+
+	/* Export the dumb buffer as a DMA-BUF so that 2D
+	 * engines which can handle DMA-BUF FDs can use it. */
+	if (drmPrimeHandleToFD(drm_output->fd, create_dumb.handle, DRM_CLOEXEC | DRM_RDWR, &dmabuf_fd) != 0)
+	{
+		IMX_2D_LOG(DEBUG, "could not export dumb buffer as DMA-BUF: %s (%d)", strerror(errno), errno);
+		dmabuf_fd = -1;
+	}
+
+	imx_dma_buffer_init_wrapped_buffer(&(page->dma_buffer));
+	page->dma_buffer.map = imx_2d_linux_drm_output_page_map;
+	page->dma_buffer.unmap = imx_2d_linux_drm_output_page_unmap;
+	page->dma_buffer.fd = dmabuf_fd;
+	page->dma_buffer.size = page->size;
+	page->dma_buffer.physical_address = 0;
+
+#ifdef IMXDMABUFFER_DMA_HEAP_ALLOCATOR_ENABLED
+	/* 2D engines that cannot use DMA-BUF FDs need a physical
+	 * address. This only works if the display controller
+	 * allocates dumb buffers from physically contiguous memory,
+	 * which is the case with display controllers that have no
+	 * IOMMU. If it does not work, only blitters that can map
+	 * the buffer (like the software blitter) can use the pages. */
+	if (dmabuf_fd >= 0)
+	{
+		int error;
+		page->dma_buffer.physical_address = imx_dma_buffer_dma_heap_get_physical_address_from_dmabuf_fd(dmabuf_fd, &error);
+		if (page->dma_buffer.physical_address == 0)
+			IMX_2D_LOG(DEBUG, "could not get physical address of dumb buffer: %s (%d)", strerror(error), error);
+	}
+#endif
+
+	desc->width = create_dumb.width;
+	desc->height = create_dumb.height;
+	desc->plane_strides[0] = create_dumb.pitch;
+	desc->num_padding_rows = 0;
+	desc->format = IMX_2D_PIXEL_FORMAT_BGRX8888;
+
+	return TRUE;
+}
+
+
+static void imx_2d_linux_drm_output_destroy_page(Imx2dLinuxDrmOutput *drm_output, Imx2dLinuxDrmPage *page)
+{
+	if (page->dma_buffer.fd >= 0)
+	{
+		close(page->dma_buffer.fd);
+		page->dma_buffer.fd = -1;
+	}
+
+	if (page->virtual_address != NULL)
+	{
+		munmap(page->virtual_address, page->size);
+		page->virtual_address = NULL;
+	}
+
+	if (page->framebuffer_id != 0)
+	{
+		drmModeRmFB(drm_output->fd, page->framebuffer_id);
+		page->framebuffer_id = 0;
+	}
+
+	if (page->gem_handle != 0)
+	{
+		struct drm_mode_destroy_dumb destroy_dumb;
+
+		memset(&destroy_dumb, 0, sizeof(destroy_dumb));
+		destroy_dumb.handle = page->gem_handle;
+		drmIoctl(drm_output->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy_dumb);
+
+		page->gem_handle = 0;
+	}
+}
+
+
+static uint8_t* imx_2d_linux_drm_output_page_map(ImxWrappedDmaBuffer *wrapped_dma_buffer, unsigned int flags, int *error)
+{
+	Imx2dLinuxDrmPage *page = (Imx2dLinuxDrmPage *)wrapped_dma_buffer;
+
+	IMX_2D_UNUSED_PARAM(flags);
+	IMX_2D_UNUSED_PARAM(error);
+
+	/* Pages stay mapped for their whole lifetime. */
+	return page->virtual_address;
+}
+
+
+static void imx_2d_linux_drm_output_page_unmap(ImxWrappedDmaBuffer *wrapped_dma_buffer)
+{
+	IMX_2D_UNUSED_PARAM(wrapped_dma_buffer);
+}
+
+
+Imx2dLinuxDrmOutput* imx_2d_linux_drm_output_create(char const *device_name)
+{
+	Imx2dLinuxDrmOutput *drm_output;
+	Imx2dSurfaceDesc desc;
+	drmModeRes *resources = NULL;
+	drmModeConnector *connector = NULL;
+	drmModePlaneRes *plane_resources = NULL;
+	drmModeAtomicReq *request = NULL;
+	Imx2dRegion full_region;
+	uint64_t dumb_buffer_supported = 0;
+	int crtc_index = -1;
+	int i, j;
+
+	assert(device_name != NULL);
+	assert(device_name[0] != '\0');
+
+	drm_output = malloc(sizeof(Imx2dLinuxDrmOutput));
+	assert(drm_output != NULL);
+
+	memset(drm_output, 0, sizeof(Imx2dLinuxDrmOutput));
+	for (i = 0; i < IMX_2D_LINUX_DRM_OUTPUT_NUM_PAGES; ++i)
+		drm_output->pages[i].dma_buffer.fd = -1;
+
+	drm_output->fd = open(device_name, O_RDWR | O_CLOEXEC, 0);
+	if (drm_output->fd < 0)
+	{
+		IMX_2D_LOG(ERROR, "could not open DRM device \"%s\": %s (%d)", device_name, strerror(errno), errno);
+		goto error;
+	}
+
+	if ((drmSetClientCap(drm_output->fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) != 0)
+	 || (drmSetClientCap(drm_output->fd, DRM_CLIENT_CAP_ATOMIC, 1) != 0))
+	{
+		IMX_2D_LOG(ERROR, "DRM device \"%s\" does not support atomic modesetting", device_name);
+		goto error;
+	}
+
+	if ((drmGetCap(drm_output->fd, DRM_CAP_DUMB_BUFFER, &dumb_buffer_supported) != 0) || !dumb_buffer_supported)
+	{
+		IMX_2D_LOG(ERROR, "DRM device \"%s\" does not support dumb buffers", device_name);
+		goto error;
+	}
+
+
+	/* Find the first connected connector and pick its mode. */
+
+	resources = drmModeGetResources(drm_output->fd);
+	if (resources == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not get DRM resources: %s (%d)", strerror(errno), errno);
+		goto error;
+	}
+
+	for (i = 0; i < resources->count_connectors; ++i)
+	{
+		connector = drmModeGetConnector(drm_output->fd, resources->connectors[i]);
+		if (connector == NULL)
+			continue;
+
+		if ((connector->connection == DRM_MODE_CONNECTED) && (connector->count_modes > 0))
+			break;
+
+		drmModeFreeConnector(connector);
+		connector = NULL;
+	}
+
+	if (connector == NULL)
+	{
+		IMX_2D_LOG(ERROR, "no connected connector found");
+		goto error;
+	}
+
+	drm_output->connector_id = connector->connector_id;
+
+	drm_output->mode = connector->modes[0];
+	for (i = 0; i < connector->count_modes; ++i)
+	{
+		if (connector->modes[i].type & DRM_MODE_TYPE_PREFERRED)
+		{
+			drm_output->mode = connector->modes[i];
+			break;
+		}
+	}
+
+	IMX_2D_LOG(
+		INFO,
+		"using connector %" PRIu32 " with mode \"%s\" (%dx%d @ %" PRIu32 " Hz)",
+		drm_output->connector_id,
+		drm_output->mode.name,
+		(int)(drm_output->mode.hdisplay), (int)(drm_output->mode.vdisplay),
+		drm_output->mode.vrefresh
+	);
+
+
+	/* Find a CRTC that can drive the connector. */
+
+	for (i = 0; (i < connector->count_encoders) && (crtc_index < 0); ++i)
+	{
+		drmModeEncoder *encoder = drmModeGetEncoder(drm_output->fd, connector->encoders[i]);
+		if (encoder == NULL)
+			continue;
+
+		for (j = 0; j < resources->count_crtcs; ++j)
+		{
+			if (encoder->possible_crtcs & (1u << j))
+			{
+				crtc_index = j;
+				drm_output->crtc_id = resources->crtcs[j];
+				break;
+			}
+		}
+
+		drmModeFreeEncoder(encoder);
+	}
+
+	if (crtc_index < 0)
+	{
+		IMX_2D_LOG(ERROR, "no CRTC found for connector %" PRIu32, drm_output->connector_id);
+		goto error;
+	}
+
+	IMX_2D_LOG(DEBUG, "using CRTC %" PRIu32, drm_output->crtc_id);
+
+
+	/* Find the CRTC's primary plane and the first overlay plane. */
+
+	plane_resources = drmModeGetPlaneResources(drm_output->fd);
+	if (plane_resources == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not get DRM plane resources: %s (%d)", strerror(errno), errno);
+		goto error;
+	}
+
+	for (i = 0; i < (int)(plane_resources->count_planes); ++i)
+	{
+		drmModePlane *plane = drmModeGetPlane(drm_output->fd, plane_resources->planes[i]);
+		uint64_t plane_type = 0;
+		BOOL usable;
+
+		if (plane == NULL)
+			continue;
+
+		usable = (plane->possible_crtcs & (1u << crtc_index)) != 0;
+		drmModeFreePlane(plane);
+
+		if (!usable || (imx_2d_linux_drm_output_find_property(drm_output->fd, plane_resources->planes[i], DRM_MODE_OBJECT_PLANE, "type", &plane_type) == 0))
+			continue;
+
+		if ((plane_type == DRM_PLANE_TYPE_PRIMARY) && (drm_output->primary_plane.id == 0))
+		{
+			if (!imx_2d_linux_drm_output_init_plane(drm_output, &(drm_output->primary_plane), plane_resources->planes[i]))
+				goto error;
+		}
+		else if ((plane_type == DRM_PLANE_TYPE_OVERLAY) && (drm_output->overlay_plane.id == 0))
+		{
+			/* An unusable overlay plane is not an error,
+			 * since imported frames can also be shown
+			 * with the primary plane. */
+			if (!imx_2d_linux_drm_output_init_plane(drm_output, &(drm_output->overlay_plane), plane_resources->planes[i]))
+				memset(&(drm_output->overlay_plane), 0, sizeof(Imx2dLinuxDrmPlane));
+		}
+	}
+
+	if (drm_output->primary_plane.id == 0)
+	{
+		IMX_2D_LOG(ERROR, "no primary plane found for CRTC %" PRIu32, drm_output->crtc_id);
+		goto error;
+	}
+
+	IMX_2D_LOG(DEBUG, "using primary plane %" PRIu32 " and overlay plane %" PRIu32 " (0 = none)", drm_output->primary_plane.id, drm_output->overlay_plane.id);
+
+
+	/* Get the connector and CRTC properties for the modeset. */
+
+	drm_output->connector_prop_crtc_id = imx_2d_linux_drm_output_find_property(drm_output->fd, drm_output->connector_id, DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID", NULL);
+	drm_output->crtc_prop_mode_id = imx_2d_linux_drm_output_find_property(drm_output->fd, drm_output->crtc_id, DRM_MODE_OBJECT_CRTC, "MODE_ID", NULL);
+	drm_output->crtc_prop_active = imx_2d_linux_drm_output_find_property(drm_output->fd, drm_output->crtc_id, DRM_MODE_OBJECT_CRTC, "ACTIVE", NULL);
+
+	if ((drm_output->connector_prop_crtc_id == 0) || (drm_output->crtc_prop_mode_id == 0) || (drm_output->crtc_prop_active == 0))
+	{
+		IMX_2D_LOG(ERROR, "connector or CRTC lacks one or more of the standard properties");
+		goto error;
+	}
+
+	if (drmModeCreatePropertyBlob(drm_output->fd, &(drm_output->mode), sizeof(drm_output->mode), &(drm_output->mode_blob_id)) != 0)
+	{
+		IMX_2D_LOG(ERROR, "could not create mode property blob: %s (%d)", strerror(errno), errno);
+		goto error;
+	}
+
+
+	/* Set up the pages and the surface. */
+
+	memset(&desc, 0, sizeof(desc));
+
+	for (i = 0; i < IMX_2D_LINUX_DRM_OUTPUT_NUM_PAGES; ++i)
+	{
+		if (!imx_2d_linux_drm_output_create_page(drm_output, &(drm_output->pages[i]), &desc))
+			goto error;
+	}
+
+	IMX_2D_LOG(
+		DEBUG,
+		"DRM output surface desc: width: %d height: %d stride: %d format: %s",
+		desc.width, desc.height,
+		desc.plane_strides[0],
+		imx_2d_pixel_format_to_string(desc.format)
+	);
+
+	drm_output->surface = imx_2d_surface_create(&desc);
+	if (drm_output->surface == NULL)
+	{
+		IMX_2D_LOG(ERROR, "could not create DRM output surface");
+		goto error;
+	}
+
+	imx_2d_linux_drm_output_set_write_page(drm_output, 0);
+
+
+	/* Perform the modeset and show the first page. */
+
+	request = drmModeAtomicAlloc();
+	assert(request != NULL);
+
+	full_region.x1 = 0;
+	full_region.y1 = 0;
+	full_region.x2 = desc.width;
+	full_region.y2 = desc.height;
+
+	drmModeAtomicAddProperty(request, drm_output->connector_id, drm_output->connector_prop_crtc_id, drm_output->crtc_id);
+	drmModeAtomicAddProperty(request, drm_output->crtc_id, drm_output->crtc_prop_mode_id, drm_output->mode_blob_id);
+	drmModeAtomicAddProperty(request, drm_output->crtc_id, drm_output->crtc_prop_active, 1);
+	imx_2d_linux_drm_output_add_plane_properties(drm_output, request, &(drm_output->primary_plane), drm_output->pages[0].framebuffer_id, &full_region, &full_region);
+	if (drm_output->overlay_plane.id != 0)
+		imx_2d_linux_drm_output_add_plane_properties(drm_output, request, &(drm_output->overlay_plane), 0, NULL, NULL);
+
+	if (drmModeAtomicCommit(drm_output->fd, request, DRM_MODE_ATOMIC_ALLOW_MODESET, NULL) != 0)
+	{
+		IMX_2D_LOG(ERROR, "could not perform modeset: %s (%d)", strerror(errno), errno);
+		goto error;
+	}
+
+	drm_output->current_page = 0;
+
+
+finish:
+	if (request != NULL)
+		drmModeAtomicFree(request);
+	if (plane_resources != NULL)
+		drmModeFreePlaneResources(plane_resources);
+	if (connector != NULL)
+		drmModeFreeConnector(connector);
+	if (resources != NULL)
+		drmModeFreeResources(resources);
+	return drm_output;
+
+error:
+	imx_2d_linux_drm_output_destroy(drm_output);
+	drm_output = NULL;
+	goto finish;
+}
+
+
+void imx_2d_linux_drm_output_destroy(Imx2dLinuxDrmOutput *drm_output)
+{
+	int i;
+
+	if (drm_output == NULL)
+		return;
+
+	if (drm_output->surface != NULL)
+		imx_2d_surface_destroy(drm_output->surface);
+
+	if (drm_output->fd >= 0)
+	{
+		/* Removing the framebuffer that is being shown disables
+		 * the CRTC. Once the DRM device is closed, the kernel
+		 * restores the framebuffer console (if there is one). */
+		for (i = 0; i < IMX_2D_LINUX_DRM_OUTPUT_NUM_PAGES; ++i)
+			imx_2d_linux_drm_output_destroy_page(drm_output, &(drm_output->pages[i]));
+
+		if (drm_output->mode_blob_id != 0)
+			drmModeDestroyPropertyBlob(drm_output->fd, drm_output->mode_blob_id);
+
+		close(drm_output->fd);
+	}
+
+	free(drm_output);
+}
+
+
+Imx2dSurface* imx_2d_linux_drm_output_get_surface(Imx2dLinuxDrmOutput *drm_output)
+{
+	assert(drm_output != NULL);
+	return drm_output->surface;
+}
+
+
+int imx_2d_linux_drm_output_get_num_pages(Imx2dLinuxDrmOutput *drm_output)
+{
+	IMX_2D_UNUSED_PARAM(drm_output);
+	return IMX_2D_LINUX_DRM_OUTPUT_NUM_PAGES;
+}
+
+
+void imx_2d_linux_drm_output_set_write_page(Imx2dLinuxDrmOutput *drm_output, int page)
+{
+	assert(drm_output != NULL);
+	assert((page >= 0) && (page < IMX_2D_LINUX_DRM_OUTPUT_NUM_PAGES));
+
+	IMX_2D_LOG(TRACE, "setting write page to %d", page);
+
+	imx_2d_surface_set_dma_buffer(drm_output->surface, (ImxDmaBuffer *)&(drm_output->pages[page].dma_buffer), 0, 0);
+}
+
+
+int64_t imx_2d_linux_drm_output_get_refresh_period(Imx2dLinuxDrmOutput *drm_output)
+{
+	drmModeModeInfo const *mode;
+
+	assert(drm_output != NULL);
+
+	mode = &(drm_output->mode);
+
+	/* The mode's clock is the pixel clock in kHz. */
+	if ((mode->clock == 0) || (mode->htotal == 0) || (mode->vtotal == 0))
+		return 0;
+
+	return (int64_t)(mode->htotal) * mode->vtotal * 1000000 / mode->clock;
+}
+
+
+uint32_t imx_2d_linux_drm_output_import_surface(Imx2dLinuxDrmOutput *drm_output, Imx2dSurface *surface)
+{
+	Imx2dSurfaceDesc const *desc;
+	Imx2dPixelFormatInfo const *format_info;
+	uint32_t drm_format;
+	uint32_t handles[4] = { 0, 0, 0, 0 };
+	uint32_t pitches[4] = { 0, 0, 0, 0 };
+	uint32_t offsets[4] = { 0, 0, 0, 0 };
+	uint32_t framebuffer_id = 0;
+	int plane_nr, i;
+
+	assert(drm_output != NULL);
+	assert(surface != NULL);
+
+	desc = imx_2d_surface_get_desc(surface);
+
+	drm_format = imx_2d_linux_drm_output_get_drm_format(desc->format);
+	if (drm_format == 0)
+	{
+		IMX_2D_LOG(DEBUG, "format %s has no DRM equivalent; cannot import surface", imx_2d_pixel_format_to_string(desc->format));
+		return 0;
+	}
+
+	format_info = imx_2d_get_pixel_format_info(desc->format);
+	assert(format_info != NULL);
+
+	for (plane_nr = 0; plane_nr < format_info->num_planes; ++plane_nr)
+	{
+		ImxDmaBuffer *dma_buffer = imx_2d_surface_get_dma_buffer(surface, plane_nr);
+		int dmabuf_fd = (dma_buffer != NULL) ? imx_dma_buffer_get_fd(dma_buffer) : -1;
+
+		if (dmabuf_fd < 0)
+		{
+			IMX_2D_LOG(DEBUG, "DMA buffer of plane %d has no DMA-BUF FD; cannot import surface", plane_nr);
+			goto finish;
+		}
+
+		if (drmPrimeFDToHandle(drm_output->fd, dmabuf_fd, &(handles[plane_nr])) != 0)
+		{
+			IMX_2D_LOG(ERROR, "could not import DMA-BUF FD %d of plane %d: %s (%d)", dmabuf_fd, plane_nr, strerror(errno), errno);
+			goto finish;
+		}
+
+		pitches[plane_nr] = desc->plane_strides[plane_nr];
+		offsets[plane_nr] = imx_2d_surface_get_dma_buffer_offset(surface, plane_nr);
+	}
+
+	if (drmModeAddFB2(drm_output->fd, desc->width, desc->height, drm_format, handles, pitches, offsets, &framebuffer_id, 0) != 0)
+	{
+		IMX_2D_LOG(DEBUG, "could not create framebuffer out of imported surface: %s (%d)", strerror(errno), errno);
+		framebuffer_id = 0;
+	}
+
+finish:
+	/* The framebuffer holds its own references to the
+	 * buffer objects, so the GEM handles are not needed
+	 * anymore. Several planes may share one handle if
+	 * they are in the same DMA-BUF, so close each only once. */
+	for (plane_nr = 0; plane_nr < 4; ++plane_nr)
+	{
+		BOOL already_closed = FALSE;
+
+		if (handles[plane_nr] == 0)
+			continue;
+
+		for (i = 0; i < plane_nr; ++i)
+			already_closed = already_closed || (handles[i] == handles[plane_nr]);
+
+		if (!already_closed)
+		{
+			struct drm_gem_close gem_close;
+			memset(&gem_close, 0, sizeof(gem_close));
+			gem_close.handle = handles[plane_nr];
+			drmIoctl(drm_output->fd, DRM_IOCTL_GEM_CLOSE, &gem_close);
+		}
+	}
+
+	return framebuffer_id;
+}
+
+
+void imx_2d_linux_drm_output_release_framebuffer(Imx2dLinuxDrmOutput *drm_output, uint32_t framebuffer_id)
+{
+	assert(drm_output != NULL);
+
+	if (framebuffer_id != 0)
+		drmModeRmFB(drm_output->fd, framebuffer_id);
+}
+
+
+int imx_2d_linux_drm_output_commit(Imx2dLinuxDrmOutput *drm_output, int page, uint32_t framebuffer_id, Imx2dRegion const *source_region, Imx2dRegion const *dest_region, int test_only)
+{
+	drmModeAtomicReq *request;
+	Imx2dRegion full_region;
+	Imx2dSurfaceDesc const *desc;
+	int ret;
+
+	assert(drm_output != NULL);
+	assert(page < IMX_2D_LINUX_DRM_OUTPUT_NUM_PAGES);
+	assert((framebuffer_id == 0) || ((source_region != NULL) && (dest_region != NULL)));
+
+	if (page < 0)
+		page = drm_output->current_page;
+
+	desc = imx_2d_surface_get_desc(drm_output->surface);
+	full_region.x1 = 0;
+	full_region.y1 = 0;
+	full_region.x2 = desc->width;
+	full_region.y2 = desc->height;
+
+	request = drmModeAtomicAlloc();
+	assert(request != NULL);
+
+	if ((framebuffer_id != 0) && (drm_output->overlay_plane.id == 0))
+	{
+		imx_2d_linux_drm_output_add_plane_properties(drm_output, request, &(drm_output->primary_plane), framebuffer_id, source_region, dest_region);
+	}
+	else
+	{
+		imx_2d_linux_drm_output_add_plane_properties(drm_output, request, &(drm_output->primary_plane), drm_output->pages[page].framebuffer_id, &full_region, &full_region);
+		if (drm_output->overlay_plane.id != 0)
+			imx_2d_linux_drm_output_add_plane_properties(drm_output, request, &(drm_output->overlay_plane), framebuffer_id, source_region, dest_region);
+	}
+
+	IMX_2D_LOG(TRACE, "%s commit with page %d and imported framebuffer %" PRIu32, test_only ? "test-only" : "performing", page, framebuffer_id);
+
+	ret = drmModeAtomicCommit(drm_output->fd, request, test_only ? DRM_MODE_ATOMIC_TEST_ONLY : 0, NULL);
+	drmModeAtomicFree(request);
+
+	if (ret != 0)
+	{
+		/* Failed test-only commits are expected, since they
+		 * are used for finding out what is supported. */
+		if (test_only)
+			IMX_2D_LOG(DEBUG, "test-only commit failed: %s (%d)", strerror(errno), errno);
+		else
+			IMX_2D_LOG(ERROR, "commit failed: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	if (!test_only)
+		drm_output->current_page = page;
+
+	return TRUE;
+}
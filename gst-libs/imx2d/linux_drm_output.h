@@ -0,0 +1,185 @@
+#ifndef IMX_2D_LINUX_DRM_OUTPUT_H
+#define IMX_2D_LINUX_DRM_OUTPUT_H
+
+#include "imx2d.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * IMX_2D_LINUX_DRM_OUTPUT_NUM_PAGES:
+ *
+ * Number of pages an @Imx2dLinuxDrmOutput allocates for page flipping.
+ */
+#define IMX_2D_LINUX_DRM_OUTPUT_NUM_PAGES 3
+
+
+/**
+ * Imx2dLinuxDrmOutput:
+ *
+ * Output to a display using the Linux DRM/KMS atomic API. This is
+ * the KMS counterpart of @Imx2dLinuxFramebuffer. It picks the first
+ * connected connector of the DRM device, a CRTC that can drive it,
+ * and the primary plane of that CRTC, and sets the connector's
+ * preferred mode. If the CRTC also has an overlay plane, that one
+ * is used for showing imported frames (see below).
+ *
+ * Like @Imx2dLinuxFramebuffer, this incorporates an @Imx2dSurface
+ * that can be used as a target for blitting. Its pages are DRM dumb
+ * buffers in the XRGB8888 format that are scanned out by the primary
+ * plane. They are written into with @imx_2d_linux_drm_output_set_write_page
+ * and shown with @imx_2d_linux_drm_output_commit. Page flipping always
+ * happens at the vertical blank with KMS.
+ *
+ * In addition, frames that are in DMA-BUF backed DMA buffers can be
+ * imported as DRM framebuffers with @imx_2d_linux_drm_output_import_surface
+ * and then shown by a plane directly, with the display controller
+ * doing the scaling. This makes the blit unnecessary. Not all display
+ * controllers can scale, or can scan out all pixel formats, so use
+ * a test-only commit first to check that.
+ *
+ * The DRM device must not be in use by another DRM master, like
+ * a Wayland compositor or an X server.
+ *
+ * @imx_2d_linux_drm_output_commit and @imx_2d_linux_drm_output_release_framebuffer
+ * may be called from a different thread than the other functions, for
+ * example to flip pages in a dedicated thread. They must not be called
+ * concurrently with each other though.
+ */
+typedef struct _Imx2dLinuxDrmOutput Imx2dLinuxDrmOutput;
+
+/**
+ * imx_2d_linux_drm_output_create:
+ * @device_name: Device name of the DRM device to access, for example "/dev/dri/card0".
+ *
+ * Creates a new DRM output. This performs a modeset that shows
+ * the first page (which is filled with black pixels).
+ *
+ * Returns: Pointer to the new DRM output, or NULL in case of an error.
+ */
+Imx2dLinuxDrmOutput* imx_2d_linux_drm_output_create(char const *device_name);
+
+/**
+ * imx_2d_linux_drm_output_destroy:
+ * @drm_output: DRM output to destroy.
+ *
+ * Destroys the DRM output. Framebuffers that were imported with
+ * @imx_2d_linux_drm_output_import_surface must be released before
+ * calling this.
+ */
+void imx_2d_linux_drm_output_destroy(Imx2dLinuxDrmOutput *drm_output);
+
+/**
+ * imx_2d_linux_drm_output_get_surface:
+ * @drm_output: DRM output to get a surface from.
+ *
+ * Returns the @Imx2dSurface that refers to the current write page.
+ * This surface is owned by the DRM output.
+ *
+ * Returns: Pointer to the surface.
+ */
+Imx2dSurface* imx_2d_linux_drm_output_get_surface(Imx2dLinuxDrmOutput *drm_output);
+
+/**
+ * imx_2d_linux_drm_output_get_num_pages:
+ * @drm_output: DRM output to get the number of pages of.
+ *
+ * Returns: Number of pages available for writing / displaying.
+ *     This is always IMX_2D_LINUX_DRM_OUTPUT_NUM_PAGES.
+ */
+int imx_2d_linux_drm_output_get_num_pages(Imx2dLinuxDrmOutput *drm_output);
+
+/**
+ * imx_2d_linux_drm_output_set_write_page:
+ * @drm_output: DRM output to set the write page of.
+ * @page: Page to write to.
+ *
+ * Sets the page that the surface (see @imx_2d_linux_drm_output_get_surface)
+ * refers to. Like with @imx_2d_linux_framebuffer_set_write_fb_page, do not
+ * call this while an imx2d sequence is ongoing.
+ *
+ * @page must be in the 0 .. (numpages-1) range.
+ */
+void imx_2d_linux_drm_output_set_write_page(Imx2dLinuxDrmOutput *drm_output, int page);
+
+/**
+ * imx_2d_linux_drm_output_get_refresh_period:
+ * @drm_output: DRM output to get the refresh period of.
+ *
+ * Calculates the refresh period out of the current mode's pixel clock
+ * and its total width and height.
+ *
+ * Returns: Refresh period in nanoseconds, or 0 if the mode does
+ *          not provide the necessary timings.
+ */
+int64_t imx_2d_linux_drm_output_get_refresh_period(Imx2dLinuxDrmOutput *drm_output);
+
+/**
+ * imx_2d_linux_drm_output_import_surface:
+ * @drm_output: DRM output to import the surface into.
+ * @surface: Surface to import.
+ *
+ * Creates a DRM framebuffer out of the surface's DMA buffers. These
+ * must have DMA-BUF file descriptors (see @imx_dma_buffer_get_fd).
+ * The surface's plane offsets and strides are used as they are. The
+ * framebuffer keeps a reference to the DMA-BUF memory, but the pixels
+ * are not copied, so the surface's DMA buffers must not be written
+ * into while the framebuffer is being shown. Release the framebuffer
+ * with @imx_2d_linux_drm_output_release_framebuffer once it is no
+ * longer shown.
+ *
+ * Returns: ID of the new framebuffer, or 0 if the surface could not be
+ *     imported (for example, because its pixel format has no DRM
+ *     equivalent, or because its DMA buffers have no DMA-BUF FD).
+ */
+uint32_t imx_2d_linux_drm_output_import_surface(Imx2dLinuxDrmOutput *drm_output, Imx2dSurface *surface);
+
+/**
+ * imx_2d_linux_drm_output_release_framebuffer:
+ * @drm_output: DRM output the framebuffer was imported into.
+ * @framebuffer_id: ID of the framebuffer to release.
+ *
+ * Releases a framebuffer that was created by @imx_2d_linux_drm_output_import_surface.
+ * If @framebuffer_id is 0, this function does nothing.
+ */
+void imx_2d_linux_drm_output_release_framebuffer(Imx2dLinuxDrmOutput *drm_output, uint32_t framebuffer_id);
+
+/**
+ * imx_2d_linux_drm_output_commit:
+ * @drm_output: DRM output to commit a new display state to.
+ * @page: Page to show with the primary plane, or -1 to keep
+ *     showing the page that is currently being shown.
+ * @framebuffer_id: Imported framebuffer to show, or 0 to show none.
+ * @source_region: Region of the imported framebuffer to show.
+ *     Ignored if @framebuffer_id is 0.
+ * @dest_region: Region on screen to show the imported framebuffer's
+ *     @source_region in. Ignored if @framebuffer_id is 0.
+ * @test_only: If nonzero, only check if the display controller
+ *     can show this state, without actually changing the display.
+ *
+ * Shows a new state on the display with one atomic commit. This blocks
+ * until the new state is shown (except when @test_only is nonzero),
+ * which happens at the next vertical blank.
+ *
+ * If @framebuffer_id is nonzero, and the output has an overlay plane,
+ * that plane shows the imported framebuffer on top of @page. If the
+ * output has no overlay plane, the primary plane shows the imported
+ * framebuffer instead of @page; only the region around @dest_region
+ * is then black. If the display controller cannot scale between
+ * @source_region and @dest_region, or cannot scan out the imported
+ * framebuffer's format, the commit fails.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_linux_drm_output_commit(Imx2dLinuxDrmOutput *drm_output, int page, uint32_t framebuffer_id, Imx2dRegion const *source_region, Imx2dRegion const *dest_region, int test_only);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* IMX_2D_LINUX_DRM_OUTPUT_H */
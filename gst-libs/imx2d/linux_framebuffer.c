@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <linux/fb.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include "imx2d.h"
 #include "imx2d_priv.h"
@@ -13,17 +14,27 @@
 
 struct _Imx2dLinuxFramebuffer
 {
+	/* This must be the first field, since the
+	 * map function casts the wrapped DMA buffer
+	 * back to an Imx2dLinuxFramebuffer. */
+	ImxWrappedDmaBuffer dma_buffer;
+
 	int fd;
 
-	ImxWrappedDmaBuffer dma_buffer;
 	Imx2dSurface *surface;
 
+	/* Only mapped if a blitter maps the surface's
+	 * DMA buffer (like the software blitter does). */
+	uint8_t *mapped_framebuffer;
+	size_t mapped_framebuffer_size;
+
 	imx_physical_address_t basic_physical_address;
 
 	struct fb_var_screeninfo fb_var;
 	struct fb_fix_screeninfo fb_fix;
 
 	BOOL enable_page_flipping;
+	int num_pages;
 
 	int current_fb_virt_height;
 	int original_fb_virt_height;
@@ -35,13 +46,18 @@ struct _Imx2dLinuxFramebuffer
 /* The i.MX MXC framebuffer driver contains a hard-coded
  * assumption that either one or three pages are used.
  * If we want to use page flipping, we have to use 3 pages,
- * even though 2 would be enough in theory. */
+ * even though 2 would be enough in theory. If the virtual
+ * height was already configured (for example, with the
+ * kernel command line) to fit more pages, those are used
+ * as well, up to IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES. */
 #define NUM_PAGE_FLIPPING_PAGES 3
 
 
 static Imx2dPixelFormat imx_2d_linux_framebuffer_get_format_from_fb(struct fb_var_screeninfo *fb_var, struct fb_fix_screeninfo *fb_fix);
 static BOOL imx_2d_linux_framebuffer_set_virtual_fb_height(Imx2dLinuxFramebuffer *linux_framebuffer, int virtual_fb_height);
 static BOOL imx_2d_linux_framebuffer_restore_original_fb_height(Imx2dLinuxFramebuffer *linux_framebuffer);
+static uint8_t* imx_2d_linux_framebuffer_map(ImxWrappedDmaBuffer *wrapped_dma_buffer, unsigned int flags, int *error);
+static void imx_2d_linux_framebuffer_unmap(ImxWrappedDmaBuffer *wrapped_dma_buffer);
 
 
 static Imx2dPixelFormat imx_2d_linux_framebuffer_get_format_from_fb(struct fb_var_screeninfo *fb_var, struct fb_fix_screeninfo *fb_fix)
@@ -151,6 +167,43 @@ static BOOL imx_2d_linux_framebuffer_restore_original_fb_height(Imx2dLinuxFrameb
 }
 
 
+static uint8_t* imx_2d_linux_framebuffer_map(ImxWrappedDmaBuffer *wrapped_dma_buffer, unsigned int flags, int *error)
+{
+	Imx2dLinuxFramebuffer *linux_framebuffer = (Imx2dLinuxFramebuffer *)wrapped_dma_buffer;
+
+	IMX_2D_UNUSED_PARAM(flags);
+
+	/* Map all pages at once, and keep them mapped until the
+	 * framebuffer wrapper is destroyed. The write page is
+	 * selected by the physical address (see
+	 * imx_2d_linux_framebuffer_set_write_fb_page()). */
+	if (linux_framebuffer->mapped_framebuffer == NULL)
+	{
+		size_t size = (size_t)(linux_framebuffer->page_size_in_bytes) * linux_framebuffer->num_pages;
+		uint8_t *mapped_framebuffer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, linux_framebuffer->fd, 0);
+
+		if (mapped_framebuffer == MAP_FAILED)
+		{
+			if (error != NULL)
+				*error = errno;
+			IMX_2D_LOG(ERROR, "could not map framebuffer: %s (%d)", strerror(errno), errno);
+			return NULL;
+		}
+
+		linux_framebuffer->mapped_framebuffer = mapped_framebuffer;
+		linux_framebuffer->mapped_framebuffer_size = size;
+	}
+
+	return linux_framebuffer->mapped_framebuffer + (linux_framebuffer->dma_buffer.physical_address - linux_framebuffer->basic_physical_address);
+}
+
+
+static void imx_2d_linux_framebuffer_unmap(ImxWrappedDmaBuffer *wrapped_dma_buffer)
+{
+	IMX_2D_UNUSED_PARAM(wrapped_dma_buffer);
+}
+
+
 Imx2dLinuxFramebuffer* imx_2d_linux_framebuffer_create(char const *device_name, int enable_page_flipping)
 {
 	Imx2dLinuxFramebuffer *linux_framebuffer;
@@ -203,6 +256,9 @@ Imx2dLinuxFramebuffer* imx_2d_linux_framebuffer_create(char const *device_name,
 	desc.plane_strides[0] = linux_framebuffer->fb_fix.line_length;
 	desc.num_padding_rows = 0;
 
+	linux_framebuffer->page_size_in_bytes = desc.plane_strides[0] * desc.height;
+	linux_framebuffer->num_pages = 1;
+
 	IMX_2D_LOG(INFO, "page flipping enabled: %d", enable_page_flipping);
 
 	if (enable_page_flipping)
@@ -227,6 +283,8 @@ Imx2dLinuxFramebuffer* imx_2d_linux_framebuffer_create(char const *device_name,
 		}
 		else
 		{
+			int max_num_pages;
+
 			IMX_2D_LOG(
 				INFO,
 				"min required virtual framebuffer height for %d pages: %d  current height: %u  => enough room for pages; no need to reconfigure framebuffer",
@@ -234,10 +292,20 @@ Imx2dLinuxFramebuffer* imx_2d_linux_framebuffer_create(char const *device_name,
 				min_required_virtual_height,
 				linux_framebuffer->fb_var.yres_virtual
 			);
+
+			/* Use all of the pages that fit in both the virtual
+			 * height and the framebuffer memory. (The memory size
+			 * is only known to be correct here, since we did not
+			 * reconfigure the framebuffer.) */
+			max_num_pages = linux_framebuffer->fb_var.yres_virtual / linux_framebuffer->fb_var.yres;
+			if ((linux_framebuffer->fb_fix.smem_len / linux_framebuffer->page_size_in_bytes) < (unsigned int)max_num_pages)
+				max_num_pages = linux_framebuffer->fb_fix.smem_len / linux_framebuffer->page_size_in_bytes;
+			linux_framebuffer->num_pages = max_num_pages;
 		}
-	}
 
-	linux_framebuffer->page_size_in_bytes = desc.plane_strides[0] * desc.height;
+		linux_framebuffer->num_pages = MIN(MAX(linux_framebuffer->num_pages, NUM_PAGE_FLIPPING_PAGES), IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES);
+		IMX_2D_LOG(INFO, "using %d framebuffer pages", linux_framebuffer->num_pages);
+	}
 
 	/* Store the "basic" physical address to the framebuffer.
 	 * We need this to be able to later pick which page to
@@ -251,8 +319,11 @@ Imx2dLinuxFramebuffer* imx_2d_linux_framebuffer_create(char const *device_name,
 	}
 
 	imx_dma_buffer_init_wrapped_buffer(&(linux_framebuffer->dma_buffer));
+	linux_framebuffer->dma_buffer.map = imx_2d_linux_framebuffer_map;
+	linux_framebuffer->dma_buffer.unmap = imx_2d_linux_framebuffer_unmap;
 	linux_framebuffer->dma_buffer.fd = -1;
 	linux_framebuffer->dma_buffer.physical_address = linux_framebuffer->basic_physical_address;
+	linux_framebuffer->dma_buffer.size = linux_framebuffer->page_size_in_bytes;
 
 	IMX_2D_LOG(
 		DEBUG,
@@ -310,6 +381,9 @@ void imx_2d_linux_framebuffer_destroy(Imx2dLinuxFramebuffer *linux_framebuffer)
 	if (linux_framebuffer->surface != NULL)
 		imx_2d_surface_destroy(linux_framebuffer->surface);
 
+	if (linux_framebuffer->mapped_framebuffer != NULL)
+		munmap(linux_framebuffer->mapped_framebuffer, linux_framebuffer->mapped_framebuffer_size);
+
 	if (linux_framebuffer->fd > 0)
 	{
 		imx_2d_linux_framebuffer_restore_original_fb_height(linux_framebuffer);
@@ -322,7 +396,30 @@ void imx_2d_linux_framebuffer_destroy(Imx2dLinuxFramebuffer *linux_framebuffer)
 
 int imx_2d_linux_framebuffer_get_num_fb_pages(Imx2dLinuxFramebuffer *linux_framebuffer)
 {
-	return linux_framebuffer->enable_page_flipping ? NUM_PAGE_FLIPPING_PAGES : 1;
+	return linux_framebuffer->num_pages;
+}
+
+
+int imx_2d_linux_framebuffer_get_fd(Imx2dLinuxFramebuffer *linux_framebuffer)
+{
+	assert(linux_framebuffer != NULL);
+	return linux_framebuffer->fd;
+}
+
+
+int imx_2d_linux_framebuffer_get_page_size(Imx2dLinuxFramebuffer *linux_framebuffer)
+{
+	assert(linux_framebuffer != NULL);
+	return linux_framebuffer->page_size_in_bytes;
+}
+
+
+imx_physical_address_t imx_2d_linux_framebuffer_get_page_physical_address(Imx2dLinuxFramebuffer *linux_framebuffer, int page)
+{
+	assert(linux_framebuffer != NULL);
+	assert((page >= 0) && (page < imx_2d_linux_framebuffer_get_num_fb_pages(linux_framebuffer)));
+
+	return linux_framebuffer->basic_physical_address + linux_framebuffer->page_size_in_bytes * page;
 }
 
 
@@ -348,6 +445,44 @@ void imx_2d_linux_framebuffer_set_write_fb_page(Imx2dLinuxFramebuffer *linux_fra
 }
 
 
+int imx_2d_linux_framebuffer_wait_for_vsync(Imx2dLinuxFramebuffer *linux_framebuffer)
+{
+	uint32_t crtc = 0;
+
+	assert(linux_framebuffer != NULL);
+	assert(linux_framebuffer->fd > 0);
+
+	if (ioctl(linux_framebuffer->fd, FBIO_WAITFORVSYNC, &crtc) == -1)
+	{
+		IMX_2D_LOG(DEBUG, "FBIO_WAITFORVSYNC error: %s (%d)", strerror(errno), errno);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+int64_t imx_2d_linux_framebuffer_get_refresh_period(Imx2dLinuxFramebuffer *linux_framebuffer)
+{
+	struct fb_var_screeninfo const *fb_var;
+	int64_t total_width, total_height;
+
+	assert(linux_framebuffer != NULL);
+
+	fb_var = &(linux_framebuffer->fb_var);
+
+	/* pixclock is the duration of one pixel in picoseconds.
+	 * It is 0 if the driver does not provide timings. */
+	if (fb_var->pixclock == 0)
+		return 0;
+
+	total_width = (int64_t)(fb_var->left_margin) + fb_var->xres + fb_var->right_margin + fb_var->hsync_len;
+	total_height = (int64_t)(fb_var->upper_margin) + fb_var->yres + fb_var->lower_margin + fb_var->vsync_len;
+
+	return total_width * total_height * fb_var->pixclock / 1000;
+}
+
+
 int imx_2d_linux_framebuffer_set_display_fb_page(Imx2dLinuxFramebuffer *linux_framebuffer, int page)
 {
 	assert(linux_framebuffer != NULL);
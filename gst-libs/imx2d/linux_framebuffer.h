@@ -9,6 +9,14 @@ extern "C" {
 #endif
 
 
+/**
+ * IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES:
+ *
+ * Maximum number of pages an @Imx2dLinuxFramebuffer uses for page flipping.
+ */
+#define IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES 8
+
+
 /**
  * Imx2dLinuxFramebuffer:
  *
@@ -25,6 +33,12 @@ extern "C" {
  * address of the wrapped DMA buffer of the surface, so
  * do not do page flipping while an imx2d sequene is ongoing
  * (see @imx_2d_blitter_start).
+ *
+ * @imx_2d_linux_framebuffer_set_display_fb_page and
+ * @imx_2d_linux_framebuffer_wait_for_vsync may be called from
+ * a different thread than the other functions, for example
+ * to flip pages in a dedicated thread. They must not be
+ * called concurrently with each other though.
  */
 typedef struct _Imx2dLinuxFramebuffer Imx2dLinuxFramebuffer;
 
@@ -38,8 +52,10 @@ typedef struct _Imx2dLinuxFramebuffer Imx2dLinuxFramebuffer;
  * See @Imx2dLinuxFramebuffer for notes about page flipping.
  * If @enable_page_flipping is nonzero, the Linux framebuffer
  * specified by @device_name has its virtual height enlarged
- * to accomodate for sufficient pages (unless said virtual
- * height is large enough already). Page flipping is done by
+ * to accomodate for three pages (unless said virtual
+ * height is large enough already). If the virtual height
+ * already fits more than three pages, up to
+ * IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES pages are used. Page flipping is done by
  * setting the write position in the framebuffer and the
  * display Y offset the framebuffer reads pixels from.
  * Both of these are reset back to zero when this framebuffer
@@ -85,7 +101,8 @@ Imx2dSurface* imx_2d_linux_framebuffer_get_surface(Imx2dLinuxFramebuffer *linux_
  *
  * This return value never changes after creating the framebuffer wrapper,
  * so it can be safely cached. If page flipping is not enabled (see
- * @imx_2d_linux_framebuffer_create), the return value is 1.
+ * @imx_2d_linux_framebuffer_create), the return value is 1. Otherwise,
+ * it is in the 3 .. IMX_2D_LINUX_FRAMEBUFFER_MAX_NUM_PAGES range.
  *
  * Returns: Number of pages available for writing / displaying.
  */
@@ -123,6 +140,72 @@ void imx_2d_linux_framebuffer_set_write_fb_page(Imx2dLinuxFramebuffer *linux_fra
  */
 int imx_2d_linux_framebuffer_set_display_fb_page(Imx2dLinuxFramebuffer *linux_framebuffer, int page);
 
+/**
+ * imx_2d_linux_framebuffer_wait_for_vsync:
+ * @linux_framebuffer: Framebuffer wrapper to wait for the vertical blank of.
+ *
+ * Blocks until the next vertical blank, using the FBIO_WAITFORVSYNC ioctl.
+ * Not all framebuffer drivers support this ioctl. If it is not supported,
+ * this function returns immediately with a zero value.
+ *
+ * Returns: Nonzero if the call succeeds, zero on failure.
+ */
+int imx_2d_linux_framebuffer_wait_for_vsync(Imx2dLinuxFramebuffer *linux_framebuffer);
+
+/**
+ * imx_2d_linux_framebuffer_get_refresh_period:
+ * @linux_framebuffer: Framebuffer wrapper to get the refresh period of.
+ *
+ * Calculates the refresh period out of the pixel clock and the
+ * horizontal and vertical timings of the framebuffer.
+ *
+ * Returns: Refresh period in nanoseconds, or 0 if the framebuffer
+ *          driver does not provide the necessary timings.
+ */
+int64_t imx_2d_linux_framebuffer_get_refresh_period(Imx2dLinuxFramebuffer *linux_framebuffer);
+
+/**
+ * imx_2d_linux_framebuffer_get_fd:
+ * @linux_framebuffer: Framebuffer wrapper to get the file descriptor of.
+ *
+ * This is useful for memory-mapping the framebuffer pages, for example
+ * to let other components write directly into them ("direct scanout").
+ * The file descriptor is owned by the framebuffer wrapper, and is closed
+ * by @imx_2d_linux_framebuffer_destroy. Memory mappings made with it
+ * remain valid after it is closed.
+ *
+ * Returns: File descriptor of the framebuffer device.
+ */
+int imx_2d_linux_framebuffer_get_fd(Imx2dLinuxFramebuffer *linux_framebuffer);
+
+/**
+ * imx_2d_linux_framebuffer_get_page_size:
+ * @linux_framebuffer: Framebuffer wrapper to get the page size of.
+ *
+ * The page size is the stride of the framebuffer surface multiplied
+ * by its height. Page N starts at byte offset N * page-size, both
+ * in physical memory and in a memory mapping of the framebuffer.
+ *
+ * Returns: Size of one framebuffer page, in bytes.
+ */
+int imx_2d_linux_framebuffer_get_page_size(Imx2dLinuxFramebuffer *linux_framebuffer);
+
+/**
+ * imx_2d_linux_framebuffer_get_page_physical_address:
+ * @linux_framebuffer: Framebuffer wrapper to get a page's physical address from.
+ * @page Page number to get the physical address of.
+ *
+ * @page must be a number in the range 0 .. (num-pages - 1), where num-pages
+ * is the return value of @imx_2d_linux_framebuffer_get_num_fb_pages.
+ *
+ * Unlike the physical address of the surface (see
+ * @imx_2d_linux_framebuffer_get_surface), this is not
+ * affected by @imx_2d_linux_framebuffer_set_write_fb_page.
+ *
+ * Returns: Physical address of the first byte of the page.
+ */
+imx_physical_address_t imx_2d_linux_framebuffer_get_page_physical_address(Imx2dLinuxFramebuffer *linux_framebuffer, int page);
+
 
 #ifdef __cplusplus
 }
@@ -18,6 +18,8 @@
 
 #include "gstimxv4l2prelude.h"
 
+#include <config.h>
+
 #include <time.h>
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
@@ -41,7 +43,12 @@
 #include "gstimxv4l2amphionmisc.h"
 
 #include "imx2d/imx2d.h"
+#ifdef WITH_IMX2D_G2D_BACKEND
 #include "imx2d/backend/g2d/g2d_blitter.h"
+#endif
+#ifdef WITH_IMX2D_SW_BACKEND
+#include "imx2d/backend/sw/sw_blitter.h"
+#endif
 
 
 GST_DEBUG_CATEGORY_STATIC(imx_v4l2_amphion_dec_debug);
@@ -89,6 +96,15 @@ GST_DEBUG_CATEGORY_STATIC(imx_v4l2_amphion_dec_out_debug);
  * frames are corrupted. The _source_ surface is not affected. */
 #define G2D_DEST_AMPHION_STRIDE_ALIGNMENT 128
 
+#define DEFAULT_DETILER GST_IMX_V4L2_AMPHION_DEC_DETILER_AUTO
+
+
+enum
+{
+	PROP_0,
+	PROP_DETILER
+};
+
 #define ALIGN_VAL_TO(VALUE, ALIGN_SIZE) \
 	( \
 		( \
@@ -187,6 +203,9 @@ struct _GstImxV4L2AmphionDec
 
 	/*< private >*/
 
+	/* Property value, read in start(). */
+	GstImxV4L2AmphionDecDetiler detiler;
+
 	/* The flow error that was reported in the last decoder loop run.
 	 * GST_FLOW_OK indicates that no error happened. Any other value
 	 * implies that the decoder loop srcpad task is paused.
@@ -247,15 +266,19 @@ struct _GstImxV4L2AmphionDec
 	 * is necessary for proper draining / finishing. */
 	gboolean finishing_decoding;
 
-	/* imx2d G2D blitter and surfaces, needed for detiling decoded frames,
+	/* imx2d blitter and surfaces, needed for detiling decoded frames,
 	 * since the Amphion Malone VPU only produces Amphion-tiled frames.
+	 * The blitter is either a G2D blitter or a software blitter (which
+	 * uses a multi-threaded CPU detiler internally), depending on the
+	 * detiler property and on what is available.
 	 * Note that the tiled surface exists as a multi-buffer frame (that is,
 	 * one DMA-BUF FD per plane), while the detiled surface exists as a
 	 * single-buffer plane (one DMA-BUF FD for the whole frame). This
 	 * is done because the Amphion VPU driver can only handle multi-buffer
 	 * frames, while some other gstreamer-imx elements as well as elements
 	 * from other packages can only handle single-buffer frames. */
-	Imx2dBlitter *g2d_blitter;
+	Imx2dBlitter *detiler_blitter;
+	gboolean detiler_uses_g2d;
 	Imx2dSurface *tiled_surface;
 	Imx2dSurface *detiled_surface;
 	Imx2dSurfaceDesc tiled_surface_desc;
@@ -339,9 +362,35 @@ static GQuark gst_imx_v4l2_amphion_dec_format_details_quark(void)
 	((GstImxV4L2AmphionDecSupportedFormatDetails const *)g_type_get_qdata(G_OBJECT_CLASS_TYPE(GST_OBJECT_GET_CLASS(obj)), gst_imx_v4l2_amphion_dec_format_details_quark()))
 
 
+GType gst_imx_v4l2_amphion_dec_detiler_get_type(void)
+{
+	static GType gst_imx_v4l2_amphion_dec_detiler_type = 0;
+
+	if (!gst_imx_v4l2_amphion_dec_detiler_type)
+	{
+		static GEnumValue detiler_values[] =
+		{
+			{ GST_IMX_V4L2_AMPHION_DEC_DETILER_AUTO, "Use G2D if available, CPU otherwise", "auto" },
+			{ GST_IMX_V4L2_AMPHION_DEC_DETILER_G2D, "G2D", "g2d" },
+			{ GST_IMX_V4L2_AMPHION_DEC_DETILER_CPU, "CPU", "cpu" },
+			{ 0, NULL, NULL },
+		};
+
+		gst_imx_v4l2_amphion_dec_detiler_type = g_enum_register_static(
+			"GstImxV4L2AmphionDecDetiler",
+			detiler_values
+		);
+	}
+
+	return gst_imx_v4l2_amphion_dec_detiler_type;
+}
+
+
 G_DEFINE_ABSTRACT_TYPE(GstImxV4L2AmphionDec, gst_imx_v4l2_amphion_dec, GST_TYPE_VIDEO_DECODER)
 
 
+static void gst_imx_v4l2_amphion_dec_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec);
+static void gst_imx_v4l2_amphion_dec_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
 static GstStateChangeReturn gst_imx_v4l2_amphion_dec_change_state(GstElement *element, GstStateChange transition);
 
 static gboolean gst_imx_v4l2_amphion_dec_start(GstVideoDecoder *decoder);
@@ -367,6 +416,7 @@ static GstFlowReturn gst_imx_v4l2_amphion_dec_process_decoded_frame(GstImxV4L2Am
 
 static void gst_imx_v4l2_amphion_dec_class_init(GstImxV4L2AmphionDecClass *klass)
 {
+	GObjectClass *object_class;
 	GstElementClass *element_class;
 	GstVideoDecoderClass *video_decoder_class;
 
@@ -374,9 +424,13 @@ static void gst_imx_v4l2_amphion_dec_class_init(GstImxV4L2AmphionDecClass *klass
 	GST_DEBUG_CATEGORY_INIT(imx_v4l2_amphion_dec_in_debug, "imxv4l2amphiondec_in", 0, "NXP i.MX V4L2 Amphion Malone decoder, input (= V4L2 output queue) code path");
 	GST_DEBUG_CATEGORY_INIT(imx_v4l2_amphion_dec_out_debug, "imxv4l2amphiondec_out", 0, "NXP i.MX V4L2 Amphion Malone decoder, output (= V4L2 capture queue) code path");
 
+	object_class = G_OBJECT_CLASS(klass);
 	element_class = GST_ELEMENT_CLASS(klass);
 	video_decoder_class = GST_VIDEO_DECODER_CLASS(klass);
 
+	object_class->set_property = GST_DEBUG_FUNCPTR(gst_imx_v4l2_amphion_dec_set_property);
+	object_class->get_property = GST_DEBUG_FUNCPTR(gst_imx_v4l2_amphion_dec_get_property);
+
 	element_class->change_state = GST_DEBUG_FUNCPTR(gst_imx_v4l2_amphion_dec_change_state);
 
 	video_decoder_class->start             = GST_DEBUG_FUNCPTR(gst_imx_v4l2_amphion_dec_start);
@@ -390,11 +444,26 @@ static void gst_imx_v4l2_amphion_dec_class_init(GstImxV4L2AmphionDecClass *klass
 
 	klass->is_frame_reordering_required = NULL;
 	klass->requires_codec_data = FALSE;
+
+	g_object_class_install_property(
+		object_class,
+		PROP_DETILER,
+		g_param_spec_enum(
+			"detiler",
+			"Detiler",
+			"What to use for detiling decoded frames (takes effect when the decoder is started)",
+			gst_imx_v4l2_amphion_dec_detiler_get_type(),
+			DEFAULT_DETILER,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+		)
+	);
 }
 
 
 static void gst_imx_v4l2_amphion_dec_init(GstImxV4L2AmphionDec *self)
 {
+	self->detiler = DEFAULT_DETILER;
+
 	self->decoder_loop_flow_error = GST_FLOW_OK;
 
 	self->v4l2_fd = -1;
@@ -414,7 +483,8 @@ static void gst_imx_v4l2_amphion_dec_init(GstImxV4L2AmphionDec *self)
 
 	self->finishing_decoding = FALSE;
 
-	self->g2d_blitter = NULL;
+	self->detiler_blitter = NULL;
+	self->detiler_uses_g2d = FALSE;
 	self->tiled_surface = NULL;
 	self->detiled_surface = NULL;
 
@@ -431,6 +501,48 @@ static void gst_imx_v4l2_amphion_dec_init(GstImxV4L2AmphionDec *self)
 }
 
 
+static void gst_imx_v4l2_amphion_dec_set_property(GObject *object, guint prop_id, GValue const *value, GParamSpec *pspec)
+{
+	GstImxV4L2AmphionDec *self = GST_IMX_V4L2_AMPHION_DEC(object);
+
+	switch (prop_id)
+	{
+		case PROP_DETILER:
+		{
+			GST_OBJECT_LOCK(self);
+			self->detiler = g_value_get_enum(value);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
+static void gst_imx_v4l2_amphion_dec_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	GstImxV4L2AmphionDec *self = GST_IMX_V4L2_AMPHION_DEC(object);
+
+	switch (prop_id)
+	{
+		case PROP_DETILER:
+		{
+			GST_OBJECT_LOCK(self);
+			g_value_set_enum(value, self->detiler);
+			GST_OBJECT_UNLOCK(self);
+			break;
+		}
+
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+			break;
+	}
+}
+
+
 static GstStateChangeReturn gst_imx_v4l2_amphion_dec_change_state(GstElement *element, GstStateChange transition)
 {
 	GstImxV4L2AmphionDec *self = GST_IMX_V4L2_AMPHION_DEC(element);
@@ -470,6 +582,7 @@ static gboolean gst_imx_v4l2_amphion_dec_start(GstVideoDecoder *decoder)
 {
 	GstImxV4L2AmphionDec *self = GST_IMX_V4L2_AMPHION_DEC(decoder);
 	GstImxV4L2AmphionDecSupportedFormatDetails const *supported_format_details = GST_IMX_V4L2_AMPHION_DEC_GET_ELEMENT_COMPRESSION_FORMAT(decoder);
+	GstImxV4L2AmphionDecDetiler detiler;
 
 	gst_imx_v4l2_amphion_device_filenames_init();
 
@@ -481,13 +594,55 @@ static gboolean gst_imx_v4l2_amphion_dec_start(GstVideoDecoder *decoder)
 
 	self->imx_dma_buffer_allocator = gst_imx_dmabuf_allocator_new();
 
-	self->g2d_blitter = imx_2d_backend_g2d_blitter_create();
-	if (G_UNLIKELY(self->g2d_blitter == NULL))
+	GST_OBJECT_LOCK(self);
+	detiler = self->detiler;
+	GST_OBJECT_UNLOCK(self);
+
+	self->detiler_uses_g2d = FALSE;
+
+#ifdef WITH_IMX2D_G2D_BACKEND
+	if (detiler != GST_IMX_V4L2_AMPHION_DEC_DETILER_CPU)
+	{
+		self->detiler_blitter = imx_2d_backend_g2d_blitter_create();
+		if (self->detiler_blitter != NULL)
+			self->detiler_uses_g2d = TRUE;
+		else if (detiler == GST_IMX_V4L2_AMPHION_DEC_DETILER_G2D)
+		{
+			GST_ERROR_OBJECT(self, "creating G2D blitter failed");
+			goto error;
+		}
+		else
+			GST_WARNING_OBJECT(self, "creating G2D blitter failed; falling back to CPU based detiling");
+	}
+#else
+	if (detiler == GST_IMX_V4L2_AMPHION_DEC_DETILER_G2D)
+	{
+		GST_ERROR_OBJECT(self, "G2D detiling requested, but G2D support was not enabled at build time");
+		goto error;
+	}
+#endif
+
+#ifdef WITH_IMX2D_SW_BACKEND
+	if (self->detiler_blitter == NULL)
+	{
+		/* Use one detiler thread per CPU core. */
+		self->detiler_blitter = imx_2d_backend_sw_blitter_create_threaded(0, 0);
+		if (G_UNLIKELY(self->detiler_blitter == NULL))
+		{
+			GST_ERROR_OBJECT(self, "creating software blitter failed");
+			goto error;
+		}
+	}
+#endif
+
+	if (G_UNLIKELY(self->detiler_blitter == NULL))
 	{
-		GST_ERROR_OBJECT(self, "creating G2D blitter failed");
+		GST_ERROR_OBJECT(self, "no detiler available");
 		goto error;
 	}
 
+	GST_DEBUG_OBJECT(self, "detiling decoded frames with the %s", self->detiler_uses_g2d ? "G2D blitter" : "CPU");
+
 	self->tiled_surface = imx_2d_surface_create(NULL);
 	if (G_UNLIKELY(self->tiled_surface == NULL))
 	{
@@ -564,10 +719,10 @@ static gboolean gst_imx_v4l2_amphion_dec_stop(GstVideoDecoder *decoder)
 		self->detiled_surface = NULL;
 	}
 
-	if (self->g2d_blitter != NULL)
+	if (self->detiler_blitter != NULL)
 	{
-		imx_2d_blitter_destroy(self->g2d_blitter);
-		self->g2d_blitter = NULL;
+		imx_2d_blitter_destroy(self->detiler_blitter);
+		self->detiler_blitter = NULL;
 	}
 
 	if (self->imx_dma_buffer_allocator != NULL)
@@ -1624,7 +1779,7 @@ static gboolean gst_imx_v4l2_amphion_dec_handle_resolution_change(GstImxV4L2Amph
 	struct v4l2_requestbuffers capture_buffer_request;
 	GstVideoDecoder *decoder = GST_VIDEO_DECODER_CAST(self);
 	GstImxDmaBufAllocator *dma_buf_allocator = GST_IMX_DMABUF_ALLOCATOR(self->imx_dma_buffer_allocator);
-	Imx2dHardwareCapabilities const *imx2d_hw_caps = imx_2d_blitter_get_hardware_capabilities(self->g2d_blitter);
+	Imx2dHardwareCapabilities const *imx2d_hw_caps = imx_2d_blitter_get_hardware_capabilities(self->detiler_blitter);
 
 	/* Get resolution and format for decoded frames from
 	 * the driver so we can set up the capture buffers. */
@@ -1663,6 +1818,16 @@ static gboolean gst_imx_v4l2_amphion_dec_handle_resolution_change(GstImxV4L2Amph
 		);
 	}
 
+	if (!self->detiler_uses_g2d && (self->final_output_format != GST_VIDEO_FORMAT_NV12) && (self->final_output_format != GST_VIDEO_FORMAT_NV21))
+	{
+		GST_CAT_INFO_OBJECT(
+			imx_v4l2_amphion_dec_out_debug,
+			self,
+			"CPU based detiling to %s requires a color space conversion; NV12 and NV21 output is considerably faster",
+			gst_video_format_to_string(self->final_output_format)
+		);
+	}
+
 	gst_video_info_set_format(
 		&(self->detiler_output_info),
 		self->final_output_format,
@@ -1687,7 +1852,7 @@ static gboolean gst_imx_v4l2_amphion_dec_handle_resolution_change(GstImxV4L2Amph
 			aligned_num_rows = ALIGN_VAL_TO(unaligned_num_rows, imx2d_hw_caps->total_row_count_alignment);
 
 			unaligned_stride = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH(self->detiler_output_info.finfo, plane_nr, detiler_output_width) * GST_VIDEO_INFO_COMP_PSTRIDE(&(self->detiler_output_info), plane_nr);
-			aligned_stride = ALIGN_VAL_TO(unaligned_stride, G2D_DEST_AMPHION_STRIDE_ALIGNMENT);
+			aligned_stride = ALIGN_VAL_TO(unaligned_stride, self->detiler_uses_g2d ? G2D_DEST_AMPHION_STRIDE_ALIGNMENT : imx2d_hw_caps->stride_alignment);
 
 			GST_VIDEO_INFO_PLANE_STRIDE(&(self->detiler_output_info), plane_nr) = aligned_stride;
 			GST_VIDEO_INFO_PLANE_OFFSET(&(self->detiler_output_info), plane_nr) = plane_offset;
@@ -2137,7 +2302,7 @@ static GstFlowReturn gst_imx_v4l2_amphion_dec_process_decoded_frame(GstImxV4L2Am
 		goto requeue_buffer;
 
 	/* Prepare the intermediate buffer. It will be used
-	 * as the target for the G2D based detiler. This call
+	 * as the target for the detiler. This call
 	 * acquires a new separate GstBuffer for intermediate
 	 * data if necessary, otherwise it just refs the
 	 * output buffer. */
@@ -2176,26 +2341,26 @@ static GstFlowReturn gst_imx_v4l2_amphion_dec_process_decoded_frame(GstImxV4L2Am
 		);
 	}
 
-	/* Perform the detiling. As mentioned in the imx2d G2D blitter and surfaces
+	/* Perform the detiling. As mentioned in the imx2d blitter and surfaces
 	 * documentation at the top, the blitter input is of a multi-buffer frame
 	 * (= 1 DMA-BUF FD per plane), while the output is a single-buffer frame.
 	 * Consult that documentation for details why this is done. */
 
-	if (G_UNLIKELY(imx_2d_blitter_start(self->g2d_blitter, self->detiled_surface) == 0))
+	if (G_UNLIKELY(imx_2d_blitter_start(self->detiler_blitter, self->detiled_surface) == 0))
 	{
-		GST_CAT_ERROR_OBJECT(imx_v4l2_amphion_dec_out_debug, self, "could not start G2D blitter detiling");
+		GST_CAT_ERROR_OBJECT(imx_v4l2_amphion_dec_out_debug, self, "could not start blitter detiling");
 		goto error;
 	}
 
-	if (G_UNLIKELY(imx_2d_blitter_do_blit(self->g2d_blitter, self->tiled_surface, NULL) == 0))
+	if (G_UNLIKELY(imx_2d_blitter_do_blit(self->detiler_blitter, self->tiled_surface, NULL) == 0))
 	{
-		GST_CAT_ERROR_OBJECT(imx_v4l2_amphion_dec_out_debug, self, "could not detile with the G2D blitter");
+		GST_CAT_ERROR_OBJECT(imx_v4l2_amphion_dec_out_debug, self, "could not detile with the blitter");
 		goto error;
 	}
 
-	if (G_UNLIKELY(imx_2d_blitter_finish(self->g2d_blitter) == 0))
+	if (G_UNLIKELY(imx_2d_blitter_finish(self->detiler_blitter) == 0))
 	{
-		GST_CAT_ERROR_OBJECT(imx_v4l2_amphion_dec_out_debug, self, "could not finish G2D blitter detiling");
+		GST_CAT_ERROR_OBJECT(imx_v4l2_amphion_dec_out_debug, self, "could not finish blitter detiling");
 		goto error;
 	}
 
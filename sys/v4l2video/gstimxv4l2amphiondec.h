@@ -34,10 +34,33 @@ G_BEGIN_DECLS
 #define GST_IS_IMX_V4L2_AMPHION_DEC_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_IMX_V4L2_AMPHION_DEC))
 
 
+#define GST_TYPE_IMX_V4L2_AMPHION_DEC_DETILER      (gst_imx_v4l2_amphion_dec_detiler_get_type())
+
+
 typedef struct _GstImxV4L2AmphionDec GstImxV4L2AmphionDec;
 typedef struct _GstImxV4L2AmphionDecClass GstImxV4L2AmphionDecClass;
 
 
+/**
+ * GstImxV4L2AmphionDecDetiler:
+ * @GST_IMX_V4L2_AMPHION_DEC_DETILER_AUTO: Use G2D if available, otherwise the CPU.
+ * @GST_IMX_V4L2_AMPHION_DEC_DETILER_G2D: Detile with the G2D blitter.
+ * @GST_IMX_V4L2_AMPHION_DEC_DETILER_CPU: Detile with the multi-threaded CPU detiler
+ *     of the imx2d software blitter. This keeps G2D free for other users.
+ *
+ * How decoded Amphion-tiled frames are detiled.
+ */
+typedef enum
+{
+	GST_IMX_V4L2_AMPHION_DEC_DETILER_AUTO,
+	GST_IMX_V4L2_AMPHION_DEC_DETILER_G2D,
+	GST_IMX_V4L2_AMPHION_DEC_DETILER_CPU
+}
+GstImxV4L2AmphionDecDetiler;
+
+
+GType gst_imx_v4l2_amphion_dec_detiler_get_type(void);
+
 GType gst_imx_v4l2_amphion_dec_get_type(void);
 
 gboolean gst_imx_v4l2_amphion_dec_register_decoder_types(GstPlugin *plugin);